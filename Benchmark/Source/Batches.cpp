@@ -0,0 +1,243 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#include "Batches.h"
+
+#include <iostream>
+#include <limits>
+
+//==============================================================================
+
+static Array<BatchPreset> getAllBatchPresets()
+{
+    Array<BatchPreset> presets;
+    presets.addArray (getCompressorExpanderBatchPresets());
+    presets.addArray (getParametricEQBatchPresets());
+    return presets;
+}
+
+//==============================================================================
+
+static const double differenceSeconds = 1.0;
+
+/** Noise in bursts of a quarter of a second, loud and then 26 dB lower, with a seed
+    and a burst offset of its own on every channel, so that the instances of a batch
+    do not all see the same signal.
+*/
+static AudioSampleBuffer createInput (const int numChannels, const int numSamples, const double sampleRate)
+{
+    const int burstSamples = jmax (1, roundToInt (0.25 * sampleRate));
+
+    AudioSampleBuffer input (numChannels, numSamples);
+    for (int channel = 0; channel < numChannels; ++channel) {
+        Random random (0x5eed + channel);
+        const int offset = (channel * burstSamples) / 7;
+        float* data = input.getWritePointer (channel);
+
+        for (int sample = 0; sample < numSamples; ++sample) {
+            const float level = (((sample + offset) / burstSamples) % 2 == 0) ? 0.5f : 0.025f;
+            data[sample] = level * (2.0f * random.nextFloat() - 1.0f);
+        }
+    }
+
+    return input;
+}
+
+/** Processes the same block over and over for the given time after a warm-up, and
+    returns the nanoseconds spent per sample of one instance.
+*/
+static double timeEngine (BatchEngine& engine, const AudioSampleBuffer& input,
+                          const double sampleRate, const double seconds)
+{
+    const int numInstances = input.getNumChannels();
+    const int blockSize = input.getNumSamples();
+    engine.prepare (sampleRate, numInstances);
+
+    AudioSampleBuffer buffer (numInstances, blockSize);
+
+    const int numBlocks = jmax (1, roundToInt (seconds * sampleRate / (double)blockSize));
+    const int numWarmUpBlocks = jmin (numBlocks, 16);
+
+    for (int block = 0; block < numWarmUpBlocks; ++block) {
+        buffer.makeCopyOf (input, true);
+        engine.process (buffer);
+    }
+
+    int64 ticks = 0;
+    for (int block = 0; block < numBlocks; ++block) {
+        buffer.makeCopyOf (input, true);
+
+        const int64 startTicks = Time::getHighResolutionTicks();
+        engine.process (buffer);
+        ticks += Time::getHighResolutionTicks() - startTicks;
+    }
+
+    return 1.0e9 * Time::highResolutionTicksToSeconds (ticks)
+         / ((double)numBlocks * (double)blockSize * (double)numInstances);
+}
+
+static void renderEngine (BatchEngine& engine, const AudioSampleBuffer& input, AudioSampleBuffer& output,
+                          const double sampleRate, const int blockSize)
+{
+    const int numInstances = input.getNumChannels();
+    engine.prepare (sampleRate, numInstances);
+
+    output.makeCopyOf (input, true);
+    for (int position = 0; position < output.getNumSamples(); position += blockSize) {
+        const int numSamples = jmin (blockSize, output.getNumSamples() - position);
+        AudioSampleBuffer part (output.getArrayOfWritePointers(), numInstances, position, numSamples);
+        engine.process (part);
+    }
+}
+
+/** The largest absolute difference of a sample between the two renders. */
+static double getMaxDifference (const AudioSampleBuffer& output, const AudioSampleBuffer& separateOutput)
+{
+    double maxDifference = 0.0;
+
+    for (int channel = 0; channel < output.getNumChannels(); ++channel) {
+        const float* data = output.getReadPointer (channel);
+        const float* separateData = separateOutput.getReadPointer (channel);
+
+        for (int sample = 0; sample < output.getNumSamples(); ++sample) {
+            const double error = (double)data[sample] - (double)separateData[sample];
+            if (! std::isfinite (error))
+                return std::numeric_limits<double>::infinity();
+            maxDifference = jmax (maxDifference, std::abs (error));
+        }
+    }
+
+    return maxDifference;
+}
+
+//==============================================================================
+
+struct BatchResult
+{
+    double nanosecondsPerSample = 0.0;
+    double separateNanosecondsPerSample = 0.0;
+    double maxDifference = 0.0;
+};
+
+static BatchResult runBatch (const BatchPreset& preset,
+                             const BatchSettings& settings,
+                             const double sampleRate,
+                             const int blockSize,
+                             const int numInstances)
+{
+    BatchResult result;
+
+    // Fresh engines for each measurement, so that neither starts from the state the
+    // other one left
+    {
+        const AudioSampleBuffer block = createInput (numInstances, blockSize, sampleRate);
+
+        std::unique_ptr<BatchEngine> batched (preset.createBatched());
+        result.nanosecondsPerSample = timeEngine (*batched, block, sampleRate, settings.secondsPerRun);
+
+        std::unique_ptr<BatchEngine> separate (preset.createSeparate());
+        result.separateNanosecondsPerSample = timeEngine (*separate, block, sampleRate, settings.secondsPerRun);
+    }
+
+    {
+        const int numSamples = roundToInt (differenceSeconds * sampleRate);
+        const AudioSampleBuffer input = createInput (numInstances, numSamples, sampleRate);
+        AudioSampleBuffer output;
+        AudioSampleBuffer separateOutput;
+
+        std::unique_ptr<BatchEngine> batched (preset.createBatched());
+        renderEngine (*batched, input, output, sampleRate, blockSize);
+
+        std::unique_ptr<BatchEngine> separate (preset.createSeparate());
+        renderEngine (*separate, input, separateOutput, sampleRate, blockSize);
+
+        result.maxDifference = getMaxDifference (output, separateOutput);
+    }
+
+    return result;
+}
+
+//==============================================================================
+
+static String getDecibelsText (const double gain)
+{
+    return (gain == 0.0) ? String ("exact")
+         : std::isinf (gain) ? String ("n/a")
+         : String (Decibels::gainToDecibels (gain), 1) + " dB";
+}
+
+static void printBatchHeader (const BatchSettings& settings)
+{
+    if (settings.csv)
+        std::cout << "effect,preset,instances,sample_rate,block_size,ns_per_sample,separate_ns_per_sample,speedup,"
+                     "max_difference" << std::endl;
+    else
+        std::cout << String::formatted ("%-20s %-14s %9s %8s %6s %10s %12s %8s %10s",
+                                        "Effect", "Preset", "Instances", "Rate", "Block", "ns/sample",
+                                        "separate ns", "speedup", "max diff") << std::endl;
+}
+
+static void printBatchResult (const BatchSettings& settings,
+                              const BatchPreset& preset,
+                              const int numInstances,
+                              const double sampleRate,
+                              const int blockSize,
+                              const BatchResult& result)
+{
+    const double speedup = (result.nanosecondsPerSample > 0.0)
+                         ? result.separateNanosecondsPerSample / result.nanosecondsPerSample : 0.0;
+    const String maxDifference = getDecibelsText (result.maxDifference);
+
+    if (settings.csv)
+        std::cout << preset.effectName << "," << preset.presetName << "," << numInstances << ","
+                  << (int)sampleRate << "," << blockSize << ","
+                  << String (result.nanosecondsPerSample, 3) << ","
+                  << String (result.separateNanosecondsPerSample, 3) << ","
+                  << String (speedup, 2) << "," << maxDifference << std::endl;
+    else
+        std::cout << String::formatted ("%-20s %-14s %9d %8d %6d %10.3f %12.3f %8.2f %10s",
+                                        preset.effectName.toRawUTF8(), preset.presetName.toRawUTF8(),
+                                        numInstances, (int)sampleRate, blockSize,
+                                        result.nanosecondsPerSample, result.separateNanosecondsPerSample,
+                                        speedup, maxDifference.toRawUTF8()) << std::endl;
+}
+
+//==============================================================================
+
+void runBatchComparisons (const BatchSettings& settings)
+{
+    printBatchHeader (settings);
+
+    for (auto& preset : getAllBatchPresets()) {
+        if (! settings.effectNames.isEmpty() && ! settings.effectNames.contains (preset.effectName, true))
+            continue;
+
+        for (auto numInstances : settings.instanceCounts)
+            for (auto sampleRate : settings.sampleRates)
+                for (auto blockSize : settings.blockSizes) {
+                    const BatchResult result = runBatch (preset, settings, sampleRate, blockSize, numInstances);
+                    printBatchResult (settings, preset, numInstances, sampleRate, blockSize, result);
+                }
+    }
+}
+
+//==============================================================================
@@ -0,0 +1,70 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+
+struct BatchSettings
+{
+    Array<int> blockSizes;
+    Array<double> sampleRates;
+    StringArray effectNames;
+    Array<int> instanceCounts = { 1, 4, 8, 16, 64 };
+    double secondsPerRun = 2.0;
+    bool csv = false;
+};
+
+/** numInstances instances of a preset of an effect, each on a channel of its own,
+    run either by the batched processor of the effect or by as many of its DSP cores
+    one after the other. Every instance gets settings of its own.
+*/
+class BatchEngine
+{
+public:
+    virtual ~BatchEngine() {}
+
+    virtual void prepare (const double sampleRate, const int numInstances) = 0;
+    virtual void process (AudioSampleBuffer& buffer) = 0;
+};
+
+struct BatchPreset
+{
+    String effectName;
+    String presetName;
+    std::function<BatchEngine*()> createBatched;
+    std::function<BatchEngine*()> createSeparate;
+};
+
+/** Built with the sources of each effect, where its DSP classes are visible. */
+Array<BatchPreset> getCompressorExpanderBatchPresets();
+Array<BatchPreset> getParametricEQBatchPresets();
+
+/** Runs every preset that has a batched processor for a number of instances, next
+    to the same number of separate instances, and prints their time per sample of
+    one instance, the speedup, and how far apart their outputs are.
+*/
+void runBatchComparisons (const BatchSettings& settings);
+
+//==============================================================================
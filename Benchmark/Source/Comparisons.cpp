@@ -0,0 +1,572 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+
+#include "Comparisons.h"
+#include "Effects.h"
+
+#include <iostream>
+#include <limits>
+
+//==============================================================================
+
+/** One side of a comparison: an effect of this project, or a processor of the JUCE
+    dsp module set up to do the same.
+*/
+class ComparisonEngine
+{
+public:
+    virtual ~ComparisonEngine() {}
+
+    virtual void prepare (const double sampleRate, const int maxBlockSize, const int numChannels) = 0;
+    virtual void process (AudioSampleBuffer& buffer) = 0;
+    virtual int getLatencySamples() const = 0;
+};
+
+//======================================
+
+class EffectEngine : public ComparisonEngine
+{
+public:
+    EffectEngine (const EffectDescription& effectToRun, const EffectPreset& presetToApply)
+        : effect (effectToRun), preset (presetToApply)
+    {
+    }
+
+    ~EffectEngine()
+    {
+        if (processor != nullptr)
+            processor->releaseResources();
+    }
+
+    void prepare (const double sampleRate, const int maxBlockSize, const int numChannels) override
+    {
+        processor.reset (effect.create());
+
+        // Applies the preset straight away and keeps the quality governor out of the way,
+        // as the JUCE processors always run at full quality
+        processor->setNonRealtime (true);
+        processor->setPlayConfigDetails (numChannels, numChannels, sampleRate, maxBlockSize);
+        applyPreset (*processor, preset);
+        processor->prepareToPlay (sampleRate, maxBlockSize);
+    }
+
+    void process (AudioSampleBuffer& buffer) override
+    {
+        midiMessages.clear();
+        processor->processBlock (buffer, midiMessages);
+    }
+
+    int getLatencySamples() const override
+    {
+        return processor->getLatencySamples();
+    }
+
+private:
+    const EffectDescription& effect;
+    const EffectPreset preset;
+    std::unique_ptr<AudioProcessor> processor;
+    MidiBuffer midiMessages;
+};
+
+//======================================
+
+/** Any processor of the dsp module, or a ProcessorChain of them. The setup function
+    sets its parameters before it is prepared.
+*/
+template <typename ProcessorType>
+class DspEngine : public ComparisonEngine
+{
+public:
+    explicit DspEngine (std::function<void (ProcessorType&)> setupFunction)
+        : setup (setupFunction)
+    {
+    }
+
+    void prepare (const double sampleRate, const int maxBlockSize, const int numChannels) override
+    {
+        setup (processor);
+        processor.prepare ({ sampleRate, (uint32)maxBlockSize, (uint32)numChannels });
+        processor.reset();
+    }
+
+    void process (AudioSampleBuffer& buffer) override
+    {
+        ScopedNoDenormals noDenormals;
+
+        dsp::AudioBlock<float> block (buffer);
+        processor.process (dsp::ProcessContextReplacing<float> (block));
+    }
+
+    int getLatencySamples() const override
+    {
+        return 0;
+    }
+
+private:
+    std::function<void (ProcessorType&)> setup;
+    ProcessorType processor;
+};
+
+//======================================
+
+/** Feedback delay built on dsp::DelayLine, the same loop as the float delay line of
+    the Delay effect: the delayed sample is mixed with the input, and written back
+    with the input scaled by the feedback.
+*/
+class FeedbackDelayEngine : public ComparisonEngine
+{
+public:
+    FeedbackDelayEngine (const double delayTimeInSeconds, const float feedbackGain, const float mixGain)
+        : delayTime (delayTimeInSeconds), feedback (feedbackGain), mix (mixGain)
+    {
+    }
+
+    void prepare (const double sampleRate, const int maxBlockSize, const int numChannels) override
+    {
+        delaySamples = jmax (1, roundToInt (delayTime * sampleRate));
+        delayLine.setMaximumDelayInSamples (delaySamples + 1);
+        delayLine.prepare ({ sampleRate, (uint32)maxBlockSize, (uint32)numChannels });
+        delayLine.setDelay ((float)delaySamples);
+    }
+
+    void process (AudioSampleBuffer& buffer) override
+    {
+        ScopedNoDenormals noDenormals;
+
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel) {
+            float* channelData = buffer.getWritePointer (channel);
+
+            for (int sample = 0; sample < buffer.getNumSamples(); ++sample) {
+                const float in = channelData[sample];
+                const float out = delayLine.popSample (channel);
+
+                delayLine.pushSample (channel, in + out * feedback);
+                channelData[sample] = in + mix * (out - in);
+            }
+        }
+    }
+
+    int getLatencySamples() const override
+    {
+        return 0;
+    }
+
+private:
+    const double delayTime;
+    const float feedback;
+    const float mix;
+    int delaySamples = 1;
+    dsp::DelayLine<float, dsp::DelayLineInterpolationTypes::None> delayLine;
+};
+
+//======================================
+
+/** Hard clipper between the gains of the Distortion effect, oversampled by
+    dsp::Oversampling with the same filters.
+*/
+class OversampledClipperEngine : public ComparisonEngine
+{
+public:
+    OversampledClipperEngine (const int factorLog2, const float inputGainDecibels, const float outputGainDecibels,
+                              const float clippingThreshold)
+        : oversamplingFactor (factorLog2),
+          inputGain (Decibels::decibelsToGain (inputGainDecibels)),
+          outputGain (Decibels::decibelsToGain (outputGainDecibels)),
+          threshold (clippingThreshold)
+    {
+    }
+
+    void prepare (const double, const int maxBlockSize, const int numChannels) override
+    {
+        oversampler.reset (new dsp::Oversampling<float> ((size_t)numChannels, (size_t)oversamplingFactor,
+                                                         dsp::Oversampling<float>::filterHalfBandPolyphaseIIR,
+                                                         true, true));
+        oversampler->initProcessing ((size_t)maxBlockSize);
+        oversampler->reset();
+    }
+
+    void process (AudioSampleBuffer& buffer) override
+    {
+        ScopedNoDenormals noDenormals;
+
+        buffer.applyGain (inputGain);
+
+        dsp::AudioBlock<float> block (buffer);
+        dsp::AudioBlock<float> oversampledBlock = oversampler->processSamplesUp (block);
+        for (size_t channel = 0; channel < oversampledBlock.getNumChannels(); ++channel) {
+            float* channelData = oversampledBlock.getChannelPointer (channel);
+            for (size_t sample = 0; sample < oversampledBlock.getNumSamples(); ++sample)
+                channelData[sample] = jlimit (-threshold, threshold, channelData[sample]);
+        }
+        oversampler->processSamplesDown (block);
+
+        buffer.applyGain (outputGain);
+    }
+
+    int getLatencySamples() const override
+    {
+        return roundToInt (oversampler->getLatencyInSamples());
+    }
+
+private:
+    const int oversamplingFactor;
+    const float inputGain;
+    const float outputGain;
+    const float threshold;
+    std::unique_ptr<dsp::Oversampling<float>> oversampler;
+};
+
+//==============================================================================
+
+/** A preset of one of the effects and its JUCE counterpart. The parameters of both
+    are matched as far as they go, but the modulated effects do not share their
+    LFOs or their delay line interpolation, so for them the output difference tells
+    how far apart they sound rather than an error.
+*/
+struct Comparison
+{
+    String effectName;
+    EffectPreset preset;
+    String juceName;
+    std::function<ComparisonEngine*()> createJuceEngine;
+};
+
+static const Array<Comparison>& getAllComparisons()
+{
+    static const Array<Comparison> comparisons = {
+        // Two voices add a delayed copy to the dry sound, which is twice the mix of
+        // 0.5 of dsp::Chorus. Its centre delay sits in the middle of the width
+        { "Chorus",
+          { "2 voices mono", { { "numberofvoices", 0 }, { "stereo", 0 }, { "delay", 30.0f }, { "width", 20.0f },
+                               { "depth", 1.0f }, { "lfofrequency", 0.2f } } },
+          "dsp::Chorus",
+          [] { return new DspEngine<dsp::ProcessorChain<dsp::Chorus<float>, dsp::Gain<float>>> (
+                   [] (dsp::ProcessorChain<dsp::Chorus<float>, dsp::Gain<float>>& chain) {
+                       auto& chorus = chain.get<0>();
+                       chorus.setRate (0.2f);
+                       chorus.setDepth (0.5f);
+                       chorus.setCentreDelay (40.0f);
+                       chorus.setFeedback (0.0f);
+                       chorus.setMix (0.5f);
+                       chain.get<1>().setGainDecibels (6.0206f);
+                   }); } },
+
+        // dsp::Phaser always runs six first-order all-pass filters, and mixes them
+        // with the dry sound like a depth of one
+        { "Phaser",
+          { "6 filters mono", { { "numberoffilters", 2 }, { "stereo", 0 }, { "depth", 1.0f }, { "feedback", 0.7f },
+                                { "minfrequency", 80.0f }, { "sweepwidth", 1000.0f }, { "lfofrequency", 0.05f } } },
+          "dsp::Phaser",
+          [] { return new DspEngine<dsp::Phaser<float>> ([] (dsp::Phaser<float>& phaser) {
+                   phaser.setRate (0.05f);
+                   phaser.setDepth (1.0f);
+                   phaser.setCentreFrequency (580.0f);
+                   phaser.setFeedback (0.7f);
+                   phaser.setMix (0.5f);
+               }); } },
+
+        { "Compressor-Expander",
+          { "Compressor 4:1", { { "mode", 0 }, { "threshold", -24.0f }, { "ratio", 4.0f }, { "attack", 2.0f },
+                                { "release", 300.0f }, { "makeupgain", 0.0f } } },
+          "dsp::Compressor",
+          [] { return new DspEngine<dsp::Compressor<float>> ([] (dsp::Compressor<float>& compressor) {
+                   compressor.setThreshold (-24.0f);
+                   compressor.setRatio (4.0f);
+                   compressor.setAttack (2.0f);
+                   compressor.setRelease (300.0f);
+               }); } },
+
+        { "Delay",
+          { "250 ms feedback", { { "delaytime", 0.25f }, { "feedback", 0.5f }, { "mix", 1.0f } } },
+          "dsp::DelayLine",
+          [] { return new FeedbackDelayEngine (0.25, 0.5f, 1.0f); } },
+
+        // The tone filter is flat at 0 dB, which leaves the gains and the clipper
+        { "Distortion",
+          { "Hard clipping 4x", { { "distortiontype", 0 }, { "oversampling", 2 }, { "tone", 0.0f },
+                                  { "inputgain", 12.0f }, { "outputgain", -24.0f } } },
+          "dsp::Oversampling",
+          [] { return new OversampledClipperEngine (2, 12.0f, -24.0f, 0.5f); } },
+    };
+
+    return comparisons;
+}
+
+static const EffectDescription* findEffect (const String& name)
+{
+    for (auto& effect : getAllEffects())
+        if (effect.name == name)
+            return &effect;
+
+    return nullptr;
+}
+
+//==============================================================================
+
+static const double differenceSeconds = 1.0;
+
+/** Noise in bursts of a quarter of a second, loud and then 26 dB lower, so that the
+    compressors go through their attack and their release.
+*/
+static AudioSampleBuffer createInput (const int numChannels, const int numSamples, const double sampleRate)
+{
+    const int burstSamples = jmax (1, roundToInt (0.25 * sampleRate));
+
+    AudioSampleBuffer input (numChannels, numSamples);
+    for (int channel = 0; channel < numChannels; ++channel) {
+        Random random (0x5eed + channel);
+        float* data = input.getWritePointer (channel);
+
+        for (int sample = 0; sample < numSamples; ++sample) {
+            const float level = ((sample / burstSamples) % 2 == 0) ? 0.5f : 0.025f;
+            data[sample] = level * (2.0f * random.nextFloat() - 1.0f);
+        }
+    }
+
+    return input;
+}
+
+/** Processes the same block over and over for the given time after a warm-up, as
+    the per-effect benchmark does, and returns the nanoseconds spent per sample.
+*/
+static double timeEngine (ComparisonEngine& engine, const AudioSampleBuffer& input,
+                          const double sampleRate, const double seconds)
+{
+    const int blockSize = input.getNumSamples();
+    engine.prepare (sampleRate, blockSize, input.getNumChannels());
+
+    AudioSampleBuffer buffer (input.getNumChannels(), blockSize);
+
+    const int numBlocks = jmax (1, roundToInt (seconds * sampleRate / (double)blockSize));
+    const int numWarmUpBlocks = jmin (numBlocks, 16);
+
+    for (int block = 0; block < numWarmUpBlocks; ++block) {
+        buffer.makeCopyOf (input, true);
+        engine.process (buffer);
+    }
+
+    int64 ticks = 0;
+    for (int block = 0; block < numBlocks; ++block) {
+        buffer.makeCopyOf (input, true);
+
+        const int64 startTicks = Time::getHighResolutionTicks();
+        engine.process (buffer);
+        ticks += Time::getHighResolutionTicks() - startTicks;
+    }
+
+    return 1.0e9 * Time::highResolutionTicksToSeconds (ticks) / ((double)numBlocks * (double)blockSize);
+}
+
+/** Renders the whole input in blocks of the given size, and returns the latency the
+    engine reported.
+*/
+static int renderEngine (ComparisonEngine& engine, const AudioSampleBuffer& input, AudioSampleBuffer& output,
+                         const double sampleRate, const int blockSize)
+{
+    const int numChannels = input.getNumChannels();
+    engine.prepare (sampleRate, blockSize, numChannels);
+
+    output.makeCopyOf (input, true);
+    for (int position = 0; position < output.getNumSamples(); position += blockSize) {
+        const int numSamples = jmin (blockSize, output.getNumSamples() - position);
+        AudioSampleBuffer part (output.getArrayOfWritePointers(), numChannels, position, numSamples);
+        engine.process (part);
+    }
+
+    return engine.getLatencySamples();
+}
+
+struct OutputDifference
+{
+    double maxDifference = 0.0;         // largest absolute difference of a sample
+    double relativeDifference = 0.0;    // energy of the difference over the energy of the JUCE output
+};
+
+/** Compares the two renders after taking out the latency each one reported. */
+static OutputDifference getDifference (const AudioSampleBuffer& output, const int latency,
+                                       const AudioSampleBuffer& juceOutput, const int juceLatency)
+{
+    OutputDifference difference;
+    double differenceEnergy = 0.0;
+    double juceEnergy = 0.0;
+
+    const int numSamples = output.getNumSamples() - jmax (latency, juceLatency);
+    for (int channel = 0; channel < output.getNumChannels(); ++channel) {
+        const float* data = output.getReadPointer (channel) + latency;
+        const float* juceData = juceOutput.getReadPointer (channel) + juceLatency;
+
+        for (int sample = 0; sample < numSamples; ++sample) {
+            const double error = (double)data[sample] - (double)juceData[sample];
+            difference.maxDifference = jmax (difference.maxDifference, std::abs (error));
+            differenceEnergy += error * error;
+            juceEnergy += (double)juceData[sample] * (double)juceData[sample];
+        }
+    }
+
+    if (numSamples <= 0 || ! std::isfinite (differenceEnergy))
+        difference.maxDifference = difference.relativeDifference = std::numeric_limits<double>::infinity();
+    else
+        difference.relativeDifference = (juceEnergy > 0.0) ? std::sqrt (differenceEnergy / juceEnergy)
+                                                           : std::numeric_limits<double>::infinity();
+    return difference;
+}
+
+//==============================================================================
+
+struct ComparisonResult
+{
+    double nanosecondsPerSample = 0.0;
+    double juceNanosecondsPerSample = 0.0;
+    int latency = 0;
+    int juceLatency = 0;
+    OutputDifference difference;
+};
+
+static ComparisonResult runComparison (const Comparison& comparison,
+                                       const EffectDescription& effect,
+                                       const ComparisonSettings& settings,
+                                       const double sampleRate,
+                                       const int blockSize)
+{
+    ComparisonResult result;
+
+    // Fresh instances for each measurement, so that neither starts from the state the
+    // other one left
+    {
+        const AudioSampleBuffer block = createInput (settings.numChannels, blockSize, sampleRate);
+
+        EffectEngine engine (effect, comparison.preset);
+        result.nanosecondsPerSample = timeEngine (engine, block, sampleRate, settings.secondsPerRun);
+
+        std::unique_ptr<ComparisonEngine> juceEngine (comparison.createJuceEngine());
+        result.juceNanosecondsPerSample = timeEngine (*juceEngine, block, sampleRate, settings.secondsPerRun);
+    }
+
+    {
+        const int numSamples = roundToInt (differenceSeconds * sampleRate);
+        const AudioSampleBuffer input = createInput (settings.numChannels, numSamples, sampleRate);
+        AudioSampleBuffer output;
+        AudioSampleBuffer juceOutput;
+
+        EffectEngine engine (effect, comparison.preset);
+        result.latency = renderEngine (engine, input, output, sampleRate, blockSize);
+
+        std::unique_ptr<ComparisonEngine> juceEngine (comparison.createJuceEngine());
+        result.juceLatency = renderEngine (*juceEngine, input, juceOutput, sampleRate, blockSize);
+
+        result.difference = getDifference (output, result.latency, juceOutput, result.juceLatency);
+    }
+
+    return result;
+}
+
+//==============================================================================
+
+static String getDecibelsText (const double gain)
+{
+    return (gain == 0.0) ? String ("exact")
+         : std::isinf (gain) ? String ("n/a")
+         : String (Decibels::gainToDecibels (gain), 1) + " dB";
+}
+
+static void printComparisonHeader (const ComparisonSettings& settings)
+{
+    if (settings.csv)
+        std::cout << "effect,preset,juce,sample_rate,block_size,ns_per_sample,juce_ns_per_sample,speedup,"
+                     "latency,juce_latency,max_difference,relative_difference" << std::endl;
+    else
+        std::cout << String::formatted ("%-20s %-18s %-18s %8s %6s %10s %10s %8s %7s %7s %10s %10s",
+                                        "Effect", "Preset", "JUCE", "Rate", "Block", "ns/sample", "JUCE ns",
+                                        "speedup", "latency", "JUCE", "max diff", "rel diff") << std::endl;
+}
+
+static void printComparisonResult (const ComparisonSettings& settings,
+                                   const Comparison& comparison,
+                                   const double sampleRate,
+                                   const int blockSize,
+                                   const ComparisonResult& result)
+{
+    const double speedup = (result.nanosecondsPerSample > 0.0)
+                         ? result.juceNanosecondsPerSample / result.nanosecondsPerSample : 0.0;
+    const String maxDifference = getDecibelsText (result.difference.maxDifference);
+    const String relativeDifference = getDecibelsText (result.difference.relativeDifference);
+
+    if (settings.csv)
+        std::cout << comparison.effectName << "," << comparison.preset.name << "," << comparison.juceName << ","
+                  << (int)sampleRate << "," << blockSize << ","
+                  << String (result.nanosecondsPerSample, 3) << ","
+                  << String (result.juceNanosecondsPerSample, 3) << ","
+                  << String (speedup, 2) << ","
+                  << result.latency << "," << result.juceLatency << ","
+                  << maxDifference << "," << relativeDifference << std::endl;
+    else
+        std::cout << String::formatted ("%-20s %-18s %-18s %8d %6d %10.3f %10.3f %8.2f %7d %7d %10s %10s",
+                                        comparison.effectName.toRawUTF8(), comparison.preset.name.toRawUTF8(),
+                                        comparison.juceName.toRawUTF8(), (int)sampleRate, blockSize,
+                                        result.nanosecondsPerSample, result.juceNanosecondsPerSample, speedup,
+                                        result.latency, result.juceLatency,
+                                        maxDifference.toRawUTF8(), relativeDifference.toRawUTF8()) << std::endl;
+}
+
+//==============================================================================
+
+void runComparisons (const ComparisonSettings& settings)
+{
+    StringArray slowerConfigurations;
+
+    printComparisonHeader (settings);
+
+    for (auto& comparison : getAllComparisons()) {
+        if (! settings.effectNames.isEmpty() && ! settings.effectNames.contains (comparison.effectName, true))
+            continue;
+
+        const EffectDescription* effect = findEffect (comparison.effectName);
+        if (effect == nullptr)
+            continue;
+
+        for (auto sampleRate : settings.sampleRates)
+            for (auto blockSize : settings.blockSizes) {
+                const ComparisonResult result = runComparison (comparison, *effect, settings, sampleRate, blockSize);
+                printComparisonResult (settings, comparison, sampleRate, blockSize, result);
+
+                if (result.nanosecondsPerSample > result.juceNanosecondsPerSample)
+                    slowerConfigurations.add (String::formatted ("%s, %s at %d Hz in blocks of %d: %.2fx the time of %s",
+                                                                 comparison.effectName.toRawUTF8(),
+                                                                 comparison.preset.name.toRawUTF8(),
+                                                                 (int)sampleRate, blockSize,
+                                                                 result.nanosecondsPerSample
+                                                                     / jmax (1.0e-9, result.juceNanosecondsPerSample),
+                                                                 comparison.juceName.toRawUTF8()));
+            }
+    }
+
+    // The summary would break the comma-separated values
+    if (settings.csv || slowerConfigurations.isEmpty())
+        return;
+
+    std::cout << std::endl << "Slower than the JUCE dsp module:" << std::endl;
+    for (auto& configuration : slowerConfigurations)
+        std::cout << "  " << configuration << std::endl;
+}
+
+//==============================================================================
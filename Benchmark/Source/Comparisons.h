@@ -0,0 +1,46 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+
+struct ComparisonSettings
+{
+    Array<int> blockSizes;
+    Array<double> sampleRates;
+    StringArray effectNames;
+    double secondsPerRun = 2.0;
+    int numChannels = 2;
+    bool csv = false;
+};
+
+/** Runs a preset of some of the effects next to the closest processor of the JUCE
+    dsp module, set up to do the same, and prints their throughput, their latencies
+    and how far apart their outputs are. The configurations in which the effect of
+    this project was slower are listed again at the end.
+*/
+void runComparisons (const ComparisonSettings& settings);
+
+//==============================================================================
@@ -0,0 +1,150 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#include "Effects.h"
+
+//==============================================================================
+
+AudioProcessor* JUCE_CALLTYPE createChainAudioProcessor();
+AudioProcessor* JUCE_CALLTYPE createChorusAudioProcessor();
+AudioProcessor* JUCE_CALLTYPE createCompressorExpanderAudioProcessor();
+AudioProcessor* JUCE_CALLTYPE createDelayAudioProcessor();
+AudioProcessor* JUCE_CALLTYPE createDistortionAudioProcessor();
+AudioProcessor* JUCE_CALLTYPE createFlangerAudioProcessor();
+AudioProcessor* JUCE_CALLTYPE createPanningAudioProcessor();
+AudioProcessor* JUCE_CALLTYPE createParametricEQAudioProcessor();
+AudioProcessor* JUCE_CALLTYPE createPhaserAudioProcessor();
+AudioProcessor* JUCE_CALLTYPE createPingPongDelayAudioProcessor();
+AudioProcessor* JUCE_CALLTYPE createPitchShiftAudioProcessor();
+AudioProcessor* JUCE_CALLTYPE createRingModulationAudioProcessor();
+AudioProcessor* JUCE_CALLTYPE createRobotizationWhisperizationAudioProcessor();
+AudioProcessor* JUCE_CALLTYPE createTemplateFrequencyDomainAudioProcessor();
+AudioProcessor* JUCE_CALLTYPE createTemplateTimeDomainAudioProcessor();
+AudioProcessor* JUCE_CALLTYPE createTremoloAudioProcessor();
+AudioProcessor* JUCE_CALLTYPE createVibratoAudioProcessor();
+AudioProcessor* JUCE_CALLTYPE createWahWahAudioProcessor();
+
+//==============================================================================
+
+const Array<EffectDescription>& getAllEffects()
+{
+    static const Array<EffectDescription> effects = {
+        { "Template Time Domain", createTemplateTimeDomainAudioProcessor, {
+            { "Default", {} } } },
+        { "Template Frequency Domain", createTemplateFrequencyDomainAudioProcessor, {
+            { "Default", {} },
+            { "FFT 4096", { { "fftsize", 7 } } },
+            { "FFT 4096 low latency", { { "fftsize", 7 }, { "lowlatency", 1 } } },
+            { "FFT 4096 worker thread", { { "fftsize", 7 }, { "workerthread", 1 } } } } },
+        { "Delay", createDelayAudioProcessor, {
+            { "Default", {} },
+            { "Long feedback", { { "delaytime", 2.0f }, { "feedback", 0.85f } } },
+            { "16-bit 30 s", { { "delayline", 1 }, { "longdelaytime", 30.0f } } },
+            { "8 taps", { { "numberoftaps", 7 } } },
+            { "Crossfade", { { "delaytimechanges", 1 } } },
+            { "Tempo sync 1/8 dotted", { { "temposync", 1 }, { "notedivision", 8 } } } } },
+        { "Vibrato", createVibratoAudioProcessor, {
+            { "Default", {} },
+            { "Cubic", { { "interpolation", 2 } } },
+            { "Windowed sinc", { { "interpolation", 3 } } } } },
+        { "Flanger", createFlangerAudioProcessor, {
+            { "Default", {} },
+            { "Stereo cubic", { { "interpolation", 2 }, { "stereo", 1 } } },
+            { "Stereo windowed sinc", { { "interpolation", 3 }, { "stereo", 1 } } } } },
+        { "Chorus", createChorusAudioProcessor, {
+            { "Default", {} },
+            { "5 voices cubic", { { "numberofvoices", 3 }, { "interpolation", 2 } } },
+            { "5 voices windowed sinc", { { "numberofvoices", 3 }, { "interpolation", 3 } } },
+            { "Ensemble 16 voices", { { "ensemble", 1 } } },
+            { "Ensemble 32 voices", { { "ensemble", 3 } } } } },
+        { "Ping-Pong Delay", createPingPongDelayAudioProcessor, {
+            { "Default", {} },
+            { "Long feedback", { { "delaytime", 1.5f }, { "feedback", 0.85f } } },
+            { "Crossfade", { { "delaytimechanges", 1 } } } } },
+        { "Parametric EQ", createParametricEQAudioProcessor, {
+            { "Default", {} },
+            { "Low-shelf", { { "filtertype", 2 }, { "gain", -6.0f } } },
+            { "8 bands", { { "numberofbands", 7 } } },
+            { "Linear phase", { { "phase", 1 }, { "numberofbands", 7 } } },
+            { "State variable", { { "topology", 1 }, { "numberofbands", 7 } } } } },
+        { "Wah-Wah", createWahWahAudioProcessor, {
+            { "Manual", {} },
+            { "Automatic", { { "mode", 1 } } },
+            { "Automatic, state variable", { { "mode", 1 }, { "topology", 1 }, { "controlrate", 0 } } } } },
+        { "Phaser", createPhaserAudioProcessor, {
+            { "Default", {} },
+            { "10 filters", { { "numberoffilters", 4 } } } } },
+        { "Tremolo", createTremoloAudioProcessor, {
+            { "Default", {} },
+            { "Square with sloped edges", { { "lfowaveform", 5 } } } } },
+        { "Ring Modulation", createRingModulationAudioProcessor, {
+            { "Default", {} },
+            { "Sawtooth", { { "carrierwaveform", 2 } } } } },
+        { "Compressor-Expander", createCompressorExpanderAudioProcessor, {
+            { "Expander", {} },
+            { "Compressor", { { "mode", 0 } } },
+            { "Look-ahead limiter", { { "mode", 2 } } },
+            { "Compressor 5 bands", { { "mode", 0 }, { "bands", 4 } } },
+            { "Compressor per channel", { { "mode", 0 }, { "stereolink", 2 } } } } },
+        { "Distortion", createDistortionAudioProcessor, {
+            { "Default", {} },
+            { "Soft clipping", { { "distortiontype", 1 } } },
+            { "Hard clipping 4x", { { "distortiontype", 0 }, { "oversampling", 2 } } },
+            { "Hard clipping antialiased", { { "distortiontype", 0 }, { "antialiasing", 1 } } } } },
+        { "Robotization-Whisperization", createRobotizationWhisperizationAudioProcessor, {
+            { "Robotization", { { "effect", 1 } } },
+            { "Whisperization FFT 4096", { { "effect", 2 }, { "fftsize", 7 } } },
+            { "Whisperization low latency", { { "effect", 2 }, { "fftsize", 7 }, { "lowlatency", 1 } } },
+            { "Whisperization worker thread", { { "effect", 2 }, { "fftsize", 7 }, { "workerthread", 1 } } } } },
+        { "Pitch Shift", createPitchShiftAudioProcessor, {
+            { "Fifth up", { { "shift", 7.0f } } },
+            { "Fifth up FFT 4096", { { "shift", 7.0f }, { "fftsize", 7 } } },
+            { "Fifth up time domain", { { "shift", 7.0f }, { "mode", 1 } } },
+            { "Triad harmonizer", { { "voices", 2 } } } } },
+        { "Panning", createPanningAudioProcessor, {
+            { "ITD + ILD", {} },
+            { "Panorama + Precedence", { { "method", 0 } } },
+            { "HRTF", { { "method", 2 } } },
+            { "Panorama spread", { { "method", 0 }, { "sources", 1 }, { "spread", 1.0f } } } } },
+        { "Chain", createChainAudioProcessor, {
+            { "Default", {} },
+            { "Chorus || Ping-Pong Delay", { { "stage5", 9 }, { "stage5routing", 1 } } } } },
+    };
+
+    return effects;
+}
+
+//==============================================================================
+
+void applyPreset (AudioProcessor& processor, const EffectPreset& preset)
+{
+    for (auto* parameter : processor.getParameters()) {
+        if (auto* ranged = dynamic_cast<RangedAudioProcessorParameter*> (parameter)) {
+            if (const var* value = preset.values.getVarPointer (ranged->paramID)) {
+                const float normalisedValue = ranged->convertTo0to1 ((float)*value);
+                ranged->setValueNotifyingHost (normalisedValue);
+            }
+        }
+    }
+}
+
+//==============================================================================
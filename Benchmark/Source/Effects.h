@@ -0,0 +1,48 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+
+struct EffectPreset
+{
+    String name;
+    NamedValueSet values;   // parameter ID -> unnormalised value
+};
+
+struct EffectDescription
+{
+    String name;
+    std::function<AudioProcessor*()> create;
+    Array<EffectPreset> presets;
+};
+
+//==============================================================================
+
+const Array<EffectDescription>& getAllEffects();
+
+void applyPreset (AudioProcessor& processor, const EffectPreset& preset);
+
+//==============================================================================
@@ -0,0 +1,126 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+// Builds the Compressor-Expander plugin sources into the benchmark, renaming its factory
+// function so that all the effects can be linked into the same executable.
+
+#define JUCE_DONT_DECLARE_PROJECTINFO 1
+#define JucePlugin_Name "Compressor-Expander"
+#define createPluginFilter createCompressorExpanderAudioProcessor
+
+#include "../../../Compressor-Expander/Source/PluginProcessor.cpp"
+#include "../../../Compressor-Expander/Source/PluginEditor.cpp"
+
+#include "../Batches.h"
+
+//==============================================================================
+
+/** The settings of one instance of a batch: thresholds and ratios spread over the
+    instances, and every third instance an expander.
+*/
+template <typename SetterType>
+static void setCompressorExpanderInstance (SetterType setParameter, const int instance, const bool mixedModes)
+{
+    const bool expander = mixedModes && (instance % 3 == 2);
+
+    setParameter (CompressorExpanderDSP::parameterMode, expander ? (float)CompressorExpanderDSP::modeExpander
+                                                                 : (float)CompressorExpanderDSP::modeCompressor);
+    setParameter (CompressorExpanderDSP::parameterThreshold, expander ? -50.0f - (float)(instance % 5)
+                                                                      : -30.0f + 2.0f * (float)(instance % 7));
+    setParameter (CompressorExpanderDSP::parameterRatio, expander ? 2.0f : 2.0f + (float)(instance % 4));
+    setParameter (CompressorExpanderDSP::parameterAttack, 1.0e-3f * (float)(1 + instance % 10));
+    setParameter (CompressorExpanderDSP::parameterRelease, 0.05f * (float)(1 + instance % 6));
+    setParameter (CompressorExpanderDSP::parameterMakeupGain, (float)(instance % 4));
+}
+
+class CompressorExpanderBatchEngine : public BatchEngine
+{
+public:
+    explicit CompressorExpanderBatchEngine (const bool useMixedModes) : mixedModes (useMixedModes) {}
+
+    void prepare (const double sampleRate, const int numInstances) override
+    {
+        batch.prepare (sampleRate, numInstances, smoothTime);
+        for (int instance = 0; instance < numInstances; ++instance)
+            setCompressorExpanderInstance ([this, instance] (const int index, const float value) {
+                                               batch.setParameter (instance, index, value);
+                                           }, instance, mixedModes);
+        batch.reset();
+    }
+
+    void process (AudioSampleBuffer& buffer) override
+    {
+        ScopedNoDenormals noDenormals;
+        batch.process (buffer.getArrayOfWritePointers(), buffer.getNumSamples());
+    }
+
+private:
+    static constexpr double smoothTime = 1.0e-3;
+    const bool mixedModes;
+    CompressorExpanderBatch batch;
+};
+
+class CompressorExpanderSeparateEngine : public BatchEngine
+{
+public:
+    explicit CompressorExpanderSeparateEngine (const bool useMixedModes) : mixedModes (useMixedModes) {}
+
+    void prepare (const double sampleRate, const int numInstances) override
+    {
+        instances.clear();
+        for (int instance = 0; instance < numInstances; ++instance) {
+            CompressorExpanderDSP* dsp = instances.add (new CompressorExpanderDSP());
+            dsp->prepare (sampleRate, 1, 0, false, smoothTime);
+            setCompressorExpanderInstance ([dsp] (const int index, const float value) {
+                                               dsp->setParameter (index, value);
+                                           }, instance, mixedModes);
+            dsp->reset();
+        }
+    }
+
+    void process (AudioSampleBuffer& buffer) override
+    {
+        ScopedNoDenormals noDenormals;
+
+        for (int instance = 0; instance < instances.size(); ++instance) {
+            float* channel = buffer.getWritePointer (instance);
+            instances.getUnchecked (instance)->process (&channel, 1, buffer.getNumSamples());
+        }
+    }
+
+private:
+    static constexpr double smoothTime = 1.0e-3;
+    const bool mixedModes;
+    OwnedArray<CompressorExpanderDSP> instances;
+};
+
+Array<BatchPreset> getCompressorExpanderBatchPresets()
+{
+    return {
+        { "Compressor-Expander", "Compressors",
+          [] { return new CompressorExpanderBatchEngine (false); },
+          [] { return new CompressorExpanderSeparateEngine (false); } },
+        { "Compressor-Expander", "Mixed modes",
+          [] { return new CompressorExpanderBatchEngine (true); },
+          [] { return new CompressorExpanderSeparateEngine (true); } },
+    };
+}
@@ -0,0 +1,136 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+// Builds the Parametric EQ plugin sources into the benchmark, renaming its factory
+// function so that all the effects can be linked into the same executable.
+
+#define JUCE_DONT_DECLARE_PROJECTINFO 1
+#define JucePlugin_Name "Parametric EQ"
+#define createPluginFilter createParametricEQAudioProcessor
+
+#include "../../../Parametric EQ/Source/PluginProcessor.cpp"
+#include "../../../Parametric EQ/Source/PluginEditor.cpp"
+
+#include "../Batches.h"
+
+//==============================================================================
+
+/** The settings of one instance of a batch: numBands bands, each a filter type of
+    its own, with frequencies and gains spread over the instances.
+*/
+template <typename SetterType>
+static void setParametricEQInstance (SetterType setParameter, const int instance, const int numBands)
+{
+    static const int filterTypes[] = {
+        ParametricEQDSP::filterTypeHighPass,
+        ParametricEQDSP::filterTypeLowShelf,
+        ParametricEQDSP::filterTypePeakingNotch,
+        ParametricEQDSP::filterTypePeakingNotch,
+        ParametricEQDSP::filterTypePeakingNotch,
+        ParametricEQDSP::filterTypeHighShelf,
+        ParametricEQDSP::filterTypeBandStop,
+        ParametricEQDSP::filterTypeLowPass,
+    };
+
+    setParameter (ParametricEQDSP::parameterNumBands, (float)numBands);
+
+    for (int band = 0; band < numBands; ++band) {
+        const int first = (band == 0) ? 0 : ParametricEQDSP::getBandParameterIndex (band + 1, 0);
+        const float frequency = 40.0f * std::pow (2.0f, (float)band + 0.1f * (float)(instance % 10));
+
+        setParameter (first + ParametricEQDSP::bandFrequency, frequency);
+        setParameter (first + ParametricEQDSP::bandQfactor, 0.7f + 0.1f * (float)(instance % 5));
+        setParameter (first + ParametricEQDSP::bandGain, (float)((instance + band) % 13) - 6.0f);
+        setParameter (first + ParametricEQDSP::bandFilterType, (float)filterTypes[band]);
+    }
+}
+
+class ParametricEQBatchEngine : public BatchEngine
+{
+public:
+    explicit ParametricEQBatchEngine (const int numBandsToUse) : numBands (numBandsToUse) {}
+
+    void prepare (const double sampleRate, const int numInstances) override
+    {
+        batch.prepare (sampleRate, numInstances);
+        for (int instance = 0; instance < numInstances; ++instance)
+            setParametricEQInstance ([this, instance] (const int index, const float value) {
+                                         batch.setParameter (instance, index, value);
+                                     }, instance, numBands);
+        batch.reset();
+    }
+
+    void process (AudioSampleBuffer& buffer) override
+    {
+        ScopedNoDenormals noDenormals;
+        batch.process (buffer.getArrayOfWritePointers(), buffer.getNumSamples());
+    }
+
+private:
+    const int numBands;
+    ParametricEQBatch batch;
+};
+
+class ParametricEQSeparateEngine : public BatchEngine
+{
+public:
+    explicit ParametricEQSeparateEngine (const int numBandsToUse) : numBands (numBandsToUse) {}
+
+    void prepare (const double sampleRate, const int numInstances) override
+    {
+        instances.clear();
+        for (int instance = 0; instance < numInstances; ++instance) {
+            ParametricEQDSP* dsp = instances.add (new ParametricEQDSP());
+            dsp->prepare (sampleRate, 1);
+            setParametricEQInstance ([dsp] (const int index, const float value) {
+                                         dsp->setParameter (index, value);
+                                     }, instance, numBands);
+            dsp->reset();
+        }
+    }
+
+    void process (AudioSampleBuffer& buffer) override
+    {
+        ScopedNoDenormals noDenormals;
+
+        for (int instance = 0; instance < instances.size(); ++instance) {
+            float* channel = buffer.getWritePointer (instance);
+            instances.getUnchecked (instance)->process (&channel, 1, buffer.getNumSamples());
+        }
+    }
+
+private:
+    const int numBands;
+    OwnedArray<ParametricEQDSP> instances;
+};
+
+Array<BatchPreset> getParametricEQBatchPresets()
+{
+    return {
+        { "Parametric EQ", "4 bands",
+          [] { return new ParametricEQBatchEngine (4); },
+          [] { return new ParametricEQSeparateEngine (4); } },
+        { "Parametric EQ", "8 bands",
+          [] { return new ParametricEQBatchEngine (8); },
+          [] { return new ParametricEQSeparateEngine (8); } },
+    };
+}
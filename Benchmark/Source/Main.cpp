@@ -0,0 +1,679 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "Batches.h"
+#include "Comparisons.h"
+#include "Effects.h"
+#include "../../Template Time Domain/Source/MemoryFootprint.h"
+
+#include <iostream>
+#include <limits>
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+//==============================================================================
+
+struct BenchmarkSettings
+{
+    Array<int> blockSizes = { 16, 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+    Array<double> sampleRates = { 44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0 };
+    StringArray effectNames;
+    double secondsPerRun = 2.0;
+    int numChannels = 2;    // every effect supports stereo, Panning and Ping-Pong Delay require it
+    int numInstances = 100; // instances loaded at once by --startup
+    bool csv = false;
+};
+
+struct GoldenSettings
+{
+    File directory;
+    bool write = false;         // writes the golden files instead of checking against them
+    double tolerance = 1.0e-4;  // largest absolute difference from a golden sample
+};
+
+struct BenchmarkResult
+{
+    double nanosecondsPerSample = 0.0;
+    double realtimeFactor = 0.0;
+    double cyclesPerSample = 0.0;
+};
+
+//==============================================================================
+
+static bool isCycleCounterAvailable()
+{
+   #if JUCE_INTEL
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+static uint64 readCycleCounter()
+{
+   #if JUCE_INTEL
+    return (uint64)__rdtsc();
+   #else
+    return 0;
+   #endif
+}
+
+//==============================================================================
+
+static BenchmarkResult runBenchmark (const EffectDescription& effect,
+                                     const EffectPreset& preset,
+                                     const BenchmarkSettings& settings,
+                                     const double sampleRate,
+                                     const int blockSize)
+{
+    std::unique_ptr<AudioProcessor> processor (effect.create());
+    processor->setPlayConfigDetails (settings.numChannels, settings.numChannels, sampleRate, blockSize);
+    applyPreset (*processor, preset);
+    processor->prepareToPlay (sampleRate, blockSize);
+
+    AudioSampleBuffer input (settings.numChannels, blockSize);
+    AudioSampleBuffer buffer (settings.numChannels, blockSize);
+    MidiBuffer midiMessages;
+
+    Random random (0x5eed);
+    for (int channel = 0; channel < settings.numChannels; ++channel)
+        for (int sample = 0; sample < blockSize; ++sample)
+            input.setSample (channel, sample, 0.5f * (2.0f * random.nextFloat() - 1.0f));
+
+    const int numBlocks = jmax (1, roundToInt (settings.secondsPerRun * sampleRate / (double)blockSize));
+    const int numWarmUpBlocks = jmin (numBlocks, 16);
+
+    for (int block = 0; block < numWarmUpBlocks; ++block) {
+        buffer.makeCopyOf (input, true);
+        processor->processBlock (buffer, midiMessages);
+    }
+
+    int64 ticks = 0;
+    uint64 cycles = 0;
+    for (int block = 0; block < numBlocks; ++block) {
+        buffer.makeCopyOf (input, true);
+        midiMessages.clear();
+
+        const int64 startTicks = Time::getHighResolutionTicks();
+        const uint64 startCycles = readCycleCounter();
+        processor->processBlock (buffer, midiMessages);
+        cycles += readCycleCounter() - startCycles;
+        ticks += Time::getHighResolutionTicks() - startTicks;
+    }
+
+    processor->releaseResources();
+
+    //======================================
+
+    const double numSamples = (double)numBlocks * (double)blockSize;
+    const double seconds = Time::highResolutionTicksToSeconds (ticks);
+
+    BenchmarkResult result;
+    result.nanosecondsPerSample = 1.0e9 * seconds / numSamples;
+    result.realtimeFactor = (seconds > 0.0) ? (numSamples / sampleRate) / seconds : 0.0;
+    result.cyclesPerSample = (double)cycles / numSamples;
+    return result;
+}
+
+//==============================================================================
+
+static void printHeader (const BenchmarkSettings& settings)
+{
+    if (settings.csv)
+        std::cout << "effect,preset,sample_rate,block_size,ns_per_sample,realtime_factor,cycles_per_sample" << std::endl;
+    else
+        std::cout << String::formatted ("%-28s %-26s %8s %6s %12s %12s %12s",
+                                        "Effect", "Preset", "Rate", "Block",
+                                        "ns/sample", "x realtime", "cycles/smp") << std::endl;
+}
+
+static void printResult (const BenchmarkSettings& settings,
+                         const EffectDescription& effect,
+                         const EffectPreset& preset,
+                         const double sampleRate,
+                         const int blockSize,
+                         const BenchmarkResult& result)
+{
+    const String cycles = isCycleCounterAvailable() ? String (result.cyclesPerSample, 2) : String ("n/a");
+
+    if (settings.csv)
+        std::cout << effect.name << "," << preset.name << ","
+                  << (int)sampleRate << "," << blockSize << ","
+                  << String (result.nanosecondsPerSample, 3) << ","
+                  << String (result.realtimeFactor, 2) << ","
+                  << cycles << std::endl;
+    else
+        std::cout << String::formatted ("%-28s %-26s %8d %6d %12.3f %12.2f %12s",
+                                        effect.name.toRawUTF8(), preset.name.toRawUTF8(),
+                                        (int)sampleRate, blockSize,
+                                        result.nanosecondsPerSample, result.realtimeFactor,
+                                        cycles.toRawUTF8()) << std::endl;
+}
+
+//==============================================================================
+
+/** The golden renders run under fixed conditions, so that the files written by one
+    build can be compared with the output of another. The blocks take an irregular
+    sequence of sizes, to catch mistakes at block boundaries, and the input ends
+    with silence, to catch the tails.
+*/
+static const double goldenSampleRate = 48000.0;
+static const double goldenSeconds = 2.0;
+static const int goldenMaxBlockSize = 512;
+static const int goldenBlockSizes[] = { 512, 1, 64, 333, 17, 128, 500 };
+static const int goldenNumRuns = 3;
+static const char* const goldenIndexName = "golden.xml";
+
+static AudioSampleBuffer createGoldenInput (const int numChannels)
+{
+    const int numSamples = roundToInt (goldenSeconds * goldenSampleRate);
+    const int numSignalSamples = numSamples * 3 / 4;
+
+    AudioSampleBuffer input (numChannels, numSamples);
+    input.clear();
+
+    for (int channel = 0; channel < numChannels; ++channel) {
+        Random random (0x5eed + channel);
+        float* data = input.getWritePointer (channel);
+        double phase = 0.5 * MathConstants<double>::pi * (double)channel;
+
+        // Exponential sweep from 20 Hz to 20 kHz over some noise
+        for (int sample = 0; sample < numSignalSamples; ++sample) {
+            const double frequency = 20.0 * std::pow (1000.0, (double)sample / (double)numSignalSamples);
+            phase += MathConstants<double>::twoPi * frequency / goldenSampleRate;
+            data[sample] = 0.4f * (float)std::sin (phase) + 0.1f * (2.0f * random.nextFloat() - 1.0f);
+        }
+    }
+
+    return input;
+}
+
+/** Renders the input through a new instance of the effect, and returns the ticks
+    spent in processBlock.
+*/
+static int64 renderGolden (const EffectDescription& effect,
+                           const EffectPreset& preset,
+                           const AudioSampleBuffer& input,
+                           AudioSampleBuffer& output)
+{
+    const int numChannels = input.getNumChannels();
+
+    std::unique_ptr<AudioProcessor> processor (effect.create());
+
+    // Applies parameter changes straight away and keeps the quality governor out of the
+    // way, see PluginParameter::parameterChanged() and ProcessBlockProfiler
+    processor->setNonRealtime (true);
+    processor->setPlayConfigDetails (numChannels, numChannels, goldenSampleRate, goldenMaxBlockSize);
+    applyPreset (*processor, preset);
+    processor->prepareToPlay (goldenSampleRate, goldenMaxBlockSize);
+
+    output.makeCopyOf (input, true);
+    MidiBuffer midiMessages;
+    int64 ticks = 0;
+
+    for (int block = 0, position = 0; position < output.getNumSamples(); ++block) {
+        const int numSamples = jmin (goldenBlockSizes[block % numElementsInArray (goldenBlockSizes)],
+                                     output.getNumSamples() - position);
+        AudioSampleBuffer part (output.getArrayOfWritePointers(), numChannels, position, numSamples);
+        midiMessages.clear();
+
+        const int64 startTicks = Time::getHighResolutionTicks();
+        processor->processBlock (part, midiMessages);
+        ticks += Time::getHighResolutionTicks() - startTicks;
+
+        position += numSamples;
+    }
+
+    processor->releaseResources();
+    return ticks;
+}
+
+static File getGoldenFile (const GoldenSettings& golden, const EffectDescription& effect, const EffectPreset& preset)
+{
+    return golden.directory.getChildFile (File::createLegalFileName (effect.name + " - " + preset.name) + ".wav");
+}
+
+static bool writeGoldenFile (const File& file, const AudioSampleBuffer& output)
+{
+    file.deleteFile();
+    std::unique_ptr<FileOutputStream> stream (file.createOutputStream());
+    if (stream == nullptr)
+        return false;
+
+    // 32 bits are stored as floats, so the samples are kept exactly
+    std::unique_ptr<AudioFormatWriter> writer (WavAudioFormat().createWriterFor (stream.get(), goldenSampleRate,
+                                                                                 (unsigned int)output.getNumChannels(),
+                                                                                 32, {}, 0));
+    if (writer == nullptr)
+        return false;
+    stream.release();   // owned by the writer from now on
+
+    return writer->writeFromAudioSampleBuffer (output, 0, output.getNumSamples());
+}
+
+static bool readGoldenFile (const File& file, AudioSampleBuffer& golden)
+{
+    std::unique_ptr<AudioFormatReader> reader (WavAudioFormat().createReaderFor (file.createInputStream(), true));
+    if (reader == nullptr)
+        return false;
+
+    golden.setSize ((int)reader->numChannels, (int)reader->lengthInSamples);
+    return reader->read (&golden, 0, golden.getNumSamples(), 0, true, true);
+}
+
+/** Largest absolute difference between two renders, infinite if they do not have the
+    same size or either has a NaN.
+*/
+static double getMaxError (const AudioSampleBuffer& output, const AudioSampleBuffer& golden)
+{
+    if (output.getNumChannels() != golden.getNumChannels() || output.getNumSamples() != golden.getNumSamples())
+        return std::numeric_limits<double>::infinity();
+
+    double maxError = 0.0;
+    for (int channel = 0; channel < output.getNumChannels(); ++channel) {
+        const float* outputData = output.getReadPointer (channel);
+        const float* goldenData = golden.getReadPointer (channel);
+
+        for (int sample = 0; sample < output.getNumSamples(); ++sample) {
+            const double error = std::abs ((double)outputData[sample] - (double)goldenData[sample]);
+            if (! (error <= maxError))
+                maxError = std::isnan (error) ? std::numeric_limits<double>::infinity() : error;
+        }
+    }
+
+    return maxError;
+}
+
+//==============================================================================
+
+static void printGoldenHeader (const BenchmarkSettings& settings)
+{
+    if (settings.csv)
+        std::cout << "effect,preset,max_error,ns_per_sample,golden_ns_per_sample,speedup,result" << std::endl;
+    else
+        std::cout << String::formatted ("%-28s %-26s %12s %12s %12s %8s  %s",
+                                        "Effect", "Preset", "Max error", "ns/sample",
+                                        "golden ns", "speedup", "Result") << std::endl;
+}
+
+static void printGoldenResult (const BenchmarkSettings& settings,
+                               const EffectDescription& effect,
+                               const EffectPreset& preset,
+                               const double maxError,
+                               const double nanosecondsPerSample,
+                               const double goldenNanosecondsPerSample,
+                               const String& result)
+{
+    const String error = (maxError == 0.0) ? String ("exact")
+                       : std::isinf (maxError) ? String ("n/a")
+                       : String (Decibels::gainToDecibels (maxError), 1) + " dB";
+    const String golden = (goldenNanosecondsPerSample > 0.0) ? String (goldenNanosecondsPerSample, 3) : String ("n/a");
+    const String speedup = (goldenNanosecondsPerSample > 0.0 && nanosecondsPerSample > 0.0)
+                         ? String (goldenNanosecondsPerSample / nanosecondsPerSample, 2) : String ("n/a");
+
+    if (settings.csv)
+        std::cout << effect.name << "," << preset.name << "," << error << ","
+                  << String (nanosecondsPerSample, 3) << "," << golden << ","
+                  << speedup << "," << result << std::endl;
+    else
+        std::cout << String::formatted ("%-28s %-26s %12s %12.3f %12s %8s  %s",
+                                        effect.name.toRawUTF8(), preset.name.toRawUTF8(),
+                                        error.toRawUTF8(), nanosecondsPerSample, golden.toRawUTF8(),
+                                        speedup.toRawUTF8(), result.toRawUTF8()) << std::endl;
+}
+
+/** Renders every preset, and writes the outputs and their timings as the golden
+    files, or compares them with the golden files written before. Returns the number
+    of renders that failed.
+*/
+static int runGolden (const BenchmarkSettings& settings, const GoldenSettings& golden)
+{
+    if (golden.write && ! golden.directory.createDirectory()) {
+        std::cerr << "Cannot create " << golden.directory.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    // The timings are kept in an index next to the files
+    const File indexFile = golden.directory.getChildFile (goldenIndexName);
+    std::unique_ptr<XmlElement> index (XmlDocument::parse (indexFile));
+    if (index == nullptr)
+        index.reset (new XmlElement ("GOLDEN"));
+
+    const AudioSampleBuffer input = createGoldenInput (settings.numChannels);
+    AudioSampleBuffer output;
+    AudioSampleBuffer reference;
+    int numFailures = 0;
+
+    printGoldenHeader (settings);
+
+    for (auto& effect : getAllEffects()) {
+        if (! settings.effectNames.isEmpty() && ! settings.effectNames.contains (effect.name, true))
+            continue;
+
+        for (auto& preset : effect.presets) {
+            const File file = getGoldenFile (golden, effect, preset);
+
+            // The output of every run is the same, the fastest one is timed
+            int64 ticks = std::numeric_limits<int64>::max();
+            for (int run = 0; run < goldenNumRuns; ++run)
+                ticks = jmin (ticks, renderGolden (effect, preset, input, output));
+
+            const double nanosecondsPerSample = 1.0e9 * Time::highResolutionTicksToSeconds (ticks)
+                                              / (double)output.getNumSamples();
+
+            XmlElement* entry = index->getChildByAttribute ("file", file.getFileName());
+            String result;
+            double maxError = 0.0;
+
+            if (golden.write) {
+                if (entry == nullptr) {
+                    entry = index->createNewChildElement ("RENDER");
+                    entry->setAttribute ("file", file.getFileName());
+                }
+                entry->setAttribute ("effect", effect.name);
+                entry->setAttribute ("preset", preset.name);
+                entry->setAttribute ("nsPerSample", nanosecondsPerSample);
+
+                result = writeGoldenFile (file, output) ? String ("written") : "cannot write " + file.getFullPathName();
+            } else if (! readGoldenFile (file, reference)) {
+                maxError = std::numeric_limits<double>::infinity();
+                result = "missing " + file.getFullPathName();
+            } else {
+                maxError = getMaxError (output, reference);
+                result = (maxError <= golden.tolerance) ? "pass" : "FAIL";
+            }
+
+            if (result != "pass" && result != "written")
+                ++numFailures;
+
+            const double goldenNanosecondsPerSample = (entry != nullptr && ! golden.write)
+                                                    ? entry->getDoubleAttribute ("nsPerSample") : 0.0;
+            printGoldenResult (settings, effect, preset, maxError, nanosecondsPerSample,
+                               goldenNanosecondsPerSample, result);
+        }
+    }
+
+    if (golden.write && ! index->writeToFile (indexFile, {})) {
+        std::cerr << "Cannot write " << indexFile.getFullPathName() << std::endl;
+        ++numFailures;
+    }
+
+    return numFailures;
+}
+
+//==============================================================================
+
+/** Prints the memory that every preset holds once prepared, at the largest block
+    size, and what is left of it after trimMemory(). The effects run offline, so
+    the deferred callbacks that reallocate run before it returns.
+*/
+static void runMemoryReport (const BenchmarkSettings& settings)
+{
+    const int blockSize = settings.blockSizes.getLast();
+
+    if (settings.csv)
+        std::cout << "effect,preset,sample_rate,prepared_bytes,trimmed_bytes" << std::endl;
+
+    for (auto& effect : getAllEffects()) {
+        if (! settings.effectNames.isEmpty() && ! settings.effectNames.contains (effect.name, true))
+            continue;
+
+        for (auto& preset : effect.presets)
+            for (auto sampleRate : settings.sampleRates) {
+                std::unique_ptr<AudioProcessor> processor (effect.create());
+                MemoryFootprintSource* source = dynamic_cast<MemoryFootprintSource*> (processor.get());
+                if (source == nullptr)
+                    continue;
+
+                processor->setNonRealtime (true);
+                processor->setPlayConfigDetails (settings.numChannels, settings.numChannels, sampleRate, blockSize);
+                applyPreset (*processor, preset);
+                processor->prepareToPlay (sampleRate, blockSize);
+
+                const MemoryFootprint prepared = source->getMemoryFootprint();
+                source->trimMemory();
+                const MemoryFootprint trimmed = source->getMemoryFootprint();
+
+                if (settings.csv)
+                    std::cout << effect.name << "," << preset.name << "," << (int)sampleRate << ","
+                              << (int64)prepared.getTotalBytes() << "," << (int64)trimmed.getTotalBytes() << std::endl;
+                else
+                    std::cout << effect.name << ", " << preset.name << ", " << (int)sampleRate << " Hz" << std::endl
+                              << "  prepared: " << prepared.toString() << std::endl
+                              << "  trimmed:  " << trimmed.toString() << std::endl;
+
+                processor->releaseResources();
+            }
+    }
+}
+
+//==============================================================================
+
+/** Prints what it costs to load a session with many instances of every preset: the
+    construction of the processors, and their first prepareToPlay after the preset
+    is set, as a host restores their state in between. The times are averages per
+    instance, at the largest block size.
+*/
+static void runStartupReport (const BenchmarkSettings& settings)
+{
+    const int blockSize = settings.blockSizes.getLast();
+
+    if (settings.csv)
+        std::cout << "effect,preset,sample_rate,construction_us,first_prepare_us" << std::endl;
+
+    for (auto& effect : getAllEffects()) {
+        if (! settings.effectNames.isEmpty() && ! settings.effectNames.contains (effect.name, true))
+            continue;
+
+        for (auto& preset : effect.presets)
+            for (auto sampleRate : settings.sampleRates) {
+                OwnedArray<AudioProcessor> processors;
+
+                const int64 constructionStartTicks = Time::getHighResolutionTicks();
+                for (int instance = 0; instance < settings.numInstances; ++instance)
+                    processors.add (effect.create());
+                const int64 constructionTicks = Time::getHighResolutionTicks() - constructionStartTicks;
+
+                for (AudioProcessor* processor : processors) {
+                    processor->setPlayConfigDetails (settings.numChannels, settings.numChannels, sampleRate, blockSize);
+                    applyPreset (*processor, preset);
+                }
+
+                const int64 prepareStartTicks = Time::getHighResolutionTicks();
+                for (AudioProcessor* processor : processors)
+                    processor->prepareToPlay (sampleRate, blockSize);
+                const int64 prepareTicks = Time::getHighResolutionTicks() - prepareStartTicks;
+
+                const double constructionMicroseconds = 1.0e6 * Time::highResolutionTicksToSeconds (constructionTicks)
+                                                      / (double)settings.numInstances;
+                const double prepareMicroseconds = 1.0e6 * Time::highResolutionTicksToSeconds (prepareTicks)
+                                                 / (double)settings.numInstances;
+
+                if (settings.csv)
+                    std::cout << effect.name << "," << preset.name << "," << (int)sampleRate << ","
+                              << String (constructionMicroseconds, 2) << "," << String (prepareMicroseconds, 2) << std::endl;
+                else
+                    std::cout << effect.name << ", " << preset.name << ", " << (int)sampleRate << " Hz: "
+                              << String (constructionMicroseconds, 2) << " us to construct, "
+                              << String (prepareMicroseconds, 2) << " us to prepare, per instance" << std::endl;
+
+                for (AudioProcessor* processor : processors)
+                    processor->releaseResources();
+            }
+    }
+}
+
+//==============================================================================
+
+static BenchmarkSettings parseSettings (const ArgumentList& args)
+{
+    BenchmarkSettings settings;
+
+    if (args.containsOption ("--block-sizes")) {
+        settings.blockSizes.clear();
+        for (auto& token : StringArray::fromTokens (args.getValueForOption ("--block-sizes"), ",", ""))
+            settings.blockSizes.add (jlimit (1, 65536, token.getIntValue()));
+    }
+
+    if (args.containsOption ("--sample-rates")) {
+        settings.sampleRates.clear();
+        for (auto& token : StringArray::fromTokens (args.getValueForOption ("--sample-rates"), ",", ""))
+            settings.sampleRates.add (jmax (1.0, token.getDoubleValue()));
+    }
+
+    if (args.containsOption ("--effects"))
+        settings.effectNames = StringArray::fromTokens (args.getValueForOption ("--effects"), ",", "\"");
+
+    if (args.containsOption ("--seconds"))
+        settings.secondsPerRun = jmax (0.01, args.getValueForOption ("--seconds").getDoubleValue());
+
+    if (args.containsOption ("--instances"))
+        settings.numInstances = jmax (1, args.getValueForOption ("--instances").getIntValue());
+
+    settings.csv = args.containsOption ("--csv");
+
+    return settings;
+}
+
+static GoldenSettings parseGoldenSettings (const ArgumentList& args)
+{
+    GoldenSettings golden;
+
+    golden.write = args.containsOption ("--write-golden");
+    golden.directory = File::getCurrentWorkingDirectory()
+                           .getChildFile (args.getValueForOption (golden.write ? "--write-golden" : "--check-golden"));
+
+    if (args.containsOption ("--tolerance"))
+        golden.tolerance = jmax (0.0, args.getValueForOption ("--tolerance").getDoubleValue());
+
+    return golden;
+}
+
+static void printUsage()
+{
+    std::cout << "Usage: Benchmark [options]" << std::endl
+              << "  --effects=Delay,Chorus        Effects to run (default: all)" << std::endl
+              << "  --block-sizes=16,64,512       Block sizes (default: 16 to 4096)" << std::endl
+              << "  --sample-rates=44100,192000   Sample rates (default: 44.1k to 192k)" << std::endl
+              << "  --seconds=2                   Audio rendered per configuration" << std::endl
+              << "  --csv                         Print comma-separated values" << std::endl
+              << "  --list                        List effects and presets" << std::endl
+              << "  --write-golden=folder         Write the golden renders of the presets" << std::endl
+              << "  --check-golden=folder         Compare the renders with the golden ones" << std::endl
+              << "  --tolerance=0.0001            Largest difference from a golden sample" << std::endl
+              << "  --compare                     Compare with the processors of the JUCE dsp module" << std::endl
+              << "  --memory                      Report the memory of every preset, before and after trimming" << std::endl
+              << "  --startup                     Report the construction and first prepareToPlay of every preset" << std::endl
+              << "  --batch                       Compare the batched processors with as many separate instances" << std::endl
+              << "  --instances=100               Instances loaded at once by --startup, or run by --batch" << std::endl;
+}
+
+//==============================================================================
+
+int main (int argc, char* argv[])
+{
+    ScopedJuceInitialiser_GUI juceInitialiser;
+    ArgumentList args (argc, argv);
+
+    if (args.containsOption ("--help|-h")) {
+        printUsage();
+        return 0;
+    }
+
+    if (args.containsOption ("--list")) {
+        for (auto& effect : getAllEffects())
+            for (auto& preset : effect.presets)
+                std::cout << effect.name << ": " << preset.name << std::endl;
+        return 0;
+    }
+
+    const BenchmarkSettings settings = parseSettings (args);
+
+    if (args.containsOption ("--write-golden") || args.containsOption ("--check-golden"))
+        return (runGolden (settings, parseGoldenSettings (args)) > 0) ? 1 : 0;
+
+    if (args.containsOption ("--compare")) {
+        ComparisonSettings comparison;
+        comparison.blockSizes = settings.blockSizes;
+        comparison.sampleRates = settings.sampleRates;
+        comparison.effectNames = settings.effectNames;
+        comparison.secondsPerRun = settings.secondsPerRun;
+        comparison.numChannels = settings.numChannels;
+        comparison.csv = settings.csv;
+
+        runComparisons (comparison);
+        return 0;
+    }
+
+    if (args.containsOption ("--batch")) {
+        BatchSettings batch;
+        batch.blockSizes = settings.blockSizes;
+        batch.sampleRates = settings.sampleRates;
+        batch.effectNames = settings.effectNames;
+        batch.secondsPerRun = settings.secondsPerRun;
+        batch.csv = settings.csv;
+
+        if (args.containsOption ("--instances")) {
+            batch.instanceCounts.clear();
+            for (auto& token : StringArray::fromTokens (args.getValueForOption ("--instances"), ",", ""))
+                batch.instanceCounts.add (jlimit (1, 1024, token.getIntValue()));
+        }
+
+        runBatchComparisons (batch);
+        return 0;
+    }
+
+    if (args.containsOption ("--memory")) {
+        runMemoryReport (settings);
+        return 0;
+    }
+
+    if (args.containsOption ("--startup")) {
+        runStartupReport (settings);
+        return 0;
+    }
+
+    printHeader (settings);
+
+    for (auto& effect : getAllEffects()) {
+        if (! settings.effectNames.isEmpty() && ! settings.effectNames.contains (effect.name, true))
+            continue;
+
+        for (auto& preset : effect.presets)
+            for (auto sampleRate : settings.sampleRates)
+                for (auto blockSize : settings.blockSizes) {
+                    BenchmarkResult result = runBenchmark (effect, preset, settings, sampleRate, blockSize);
+                    printResult (settings, effect, preset, sampleRate, blockSize, result);
+                }
+    }
+
+    return 0;
+}
+
+//==============================================================================
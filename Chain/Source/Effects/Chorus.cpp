@@ -0,0 +1,32 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+// Builds the Chorus plugin sources into the chain, renaming its factory
+// function so that all the effects can be linked into the same plugin.
+
+#define JUCE_DONT_DECLARE_PROJECTINFO 1
+#define AUDIO_EFFECTS_EMBEDDED_EDITOR 1
+#define JucePlugin_Name "Chorus"
+#define createPluginFilter createChorusAudioProcessor
+
+#include "../../../Chorus/Source/PluginProcessor.cpp"
+#include "../../../Chorus/Source/PluginEditor.cpp"
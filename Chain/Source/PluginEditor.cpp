@@ -0,0 +1,194 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#include "PluginProcessor.h"
+#include "PluginEditor.h"
+
+//==============================================================================
+
+ChainAudioProcessorEditor::ChainAudioProcessorEditor (ChainAudioProcessor& p)
+    : AudioProcessorEditor (&p), processor (p), stageTabs (TabbedButtonBar::TabsAtTop)
+{
+    const Array<AudioProcessorParameter*> parameters = processor.getParameters();
+    int comboBoxCounter = 0;
+
+    int editorHeight = 2 * editorMargin;
+    for (int i = 0; i < parameters.size(); ++i) {
+        if (const AudioProcessorParameterWithID* parameter =
+                dynamic_cast<AudioProcessorParameterWithID*> (parameters[i])) {
+
+            if (processor.parameters.parameterTypes[i] == "Slider") {
+                Slider* aSlider;
+                sliders.add (aSlider = new Slider());
+                aSlider->setTextValueSuffix (parameter->label);
+                aSlider->setTextBoxStyle (Slider::TextBoxLeft,
+                                          false,
+                                          sliderTextEntryBoxWidth,
+                                          sliderTextEntryBoxHeight);
+
+                SliderAttachment* aSliderAttachment;
+                sliderAttachments.add (aSliderAttachment =
+                    new SliderAttachment (processor.parameters.apvts, parameter->paramID, *aSlider));
+
+                components.add (aSlider);
+                editorHeight += sliderHeight;
+            }
+
+            //======================================
+
+            else if (processor.parameters.parameterTypes[i] == "ToggleButton") {
+                ToggleButton* aButton;
+                toggles.add (aButton = new ToggleButton());
+                aButton->setToggleState (parameter->getDefaultValue(), dontSendNotification);
+
+                ButtonAttachment* aButtonAttachment;
+                buttonAttachments.add (aButtonAttachment =
+                    new ButtonAttachment (processor.parameters.apvts, parameter->paramID, *aButton));
+
+                components.add (aButton);
+                editorHeight += buttonHeight;
+            }
+
+            //======================================
+
+            else if (processor.parameters.parameterTypes[i] == "ComboBox") {
+                ComboBox* aComboBox;
+                comboBoxes.add (aComboBox = new ComboBox());
+                aComboBox->setEditableText (false);
+                aComboBox->setJustificationType (Justification::left);
+                aComboBox->addItemList (processor.parameters.comboBoxItemLists[comboBoxCounter++], 1);
+
+                ComboBoxAttachment* aComboBoxAttachment;
+                comboBoxAttachments.add (aComboBoxAttachment =
+                    new ComboBoxAttachment (processor.parameters.apvts, parameter->paramID, *aComboBox));
+
+                components.add (aComboBox);
+                editorHeight += comboBoxHeight;
+            }
+
+            //======================================
+
+            Label* aLabel;
+            labels.add (aLabel = new Label (parameter->name, parameter->name));
+            aLabel->attachToComponent (components.getLast(), true);
+            addAndMakeVisible (aLabel);
+
+            components.getLast()->setName (parameter->name);
+            components.getLast()->setComponentID (parameter->paramID);
+            addAndMakeVisible (components.getLast());
+        }
+    }
+
+    //======================================
+
+    editorHeight += components.size() * editorPadding;
+    controlsHeight = editorHeight;
+
+    stageTabs.setTabBarDepth (tabBarDepth);
+    addAndMakeVisible (stageTabs);
+
+    setSize (editorWidth, editorHeight);
+
+    setOpaque (true);
+
+    setLookAndFeel (lookAndFeel);
+    renderingContext.attachTo (*this);
+    updateUIcomponents();
+    startTimer (50);
+}
+
+ChainAudioProcessorEditor::~ChainAudioProcessorEditor()
+{
+    renderingContext.detach();
+    setLookAndFeel (nullptr);
+}
+
+//==============================================================================
+
+void ChainAudioProcessorEditor::paint (Graphics& g)
+{
+    g.fillAll (getLookAndFeel().findColour (ResizableWindow::backgroundColourId));
+}
+
+void ChainAudioProcessorEditor::resized()
+{
+    Rectangle<int> r = getLocalBounds().reduced (editorMargin);
+    stageTabs.setBounds (r.removeFromBottom (getHeight() - controlsHeight));
+    r = r.removeFromRight (r.getWidth() - labelWidth);
+
+    for (int i = 0; i < components.size(); ++i) {
+        if (Slider* aSlider = dynamic_cast<Slider*> (components[i]))
+            components[i]->setBounds (r.removeFromTop (sliderHeight));
+
+        if (ToggleButton* aButton = dynamic_cast<ToggleButton*> (components[i]))
+            components[i]->setBounds (r.removeFromTop (buttonHeight));
+
+        if (ComboBox* aComboBox = dynamic_cast<ComboBox*> (components[i]))
+            components[i]->setBounds (r.removeFromTop (comboBoxHeight));
+
+        r = r.removeFromBottom (r.getHeight() - editorPadding);
+    }
+}
+
+//==============================================================================
+
+void ChainAudioProcessorEditor::timerCallback()
+{
+    // The stages only change with the parameters
+    if (uiValues.generationChanged (processor.parameters.getChangeGeneration()))
+        updateUIcomponents();
+}
+
+void ChainAudioProcessorEditor::updateUIcomponents()
+{
+    const Array<int> stageEffects = processor.getStageEffects();
+    if (stageEffects == stageTabEffects)
+        return;
+
+    // The chain changed, so all the tabs are built again with the new stages
+    stageTabs.clearTabs();
+    stageTabEffects = stageEffects;
+
+    int stagesWidth = editorWidth - 2 * editorMargin;
+    int stagesHeight = 0;
+    {
+        const ScopedLock lock (processor.parameters.deferredCallbackLock);
+
+        for (int effect : stageTabEffects) {
+            if (AudioProcessor* stage = processor.getEffect (effect)) {
+                if (AudioProcessorEditor* stageEditor = stage->createEditorIfNeeded()) {
+                    stagesWidth = jmax (stagesWidth, stageEditor->getWidth());
+                    stagesHeight = jmax (stagesHeight, stageEditor->getHeight());
+                    stageTabs.addTab (processor.effectItemsUI[effect],
+                                      getLookAndFeel().findColour (ResizableWindow::backgroundColourId),
+                                      stageEditor, true);
+                }
+            }
+        }
+    }
+
+    const int tabsHeight = (stageTabs.getNumTabs() > 0) ? tabBarDepth + stagesHeight : 0;
+    setSize (stagesWidth + 2 * editorMargin, controlsHeight + tabsHeight);
+    resized();
+}
+
+//==============================================================================
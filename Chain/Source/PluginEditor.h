@@ -0,0 +1,104 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "PluginProcessor.h"
+#include "EditorRendering.h"
+
+//==============================================================================
+
+class ChainAudioProcessorEditor : public AudioProcessorEditor, private Timer
+{
+public:
+    //==============================================================================
+
+    ChainAudioProcessorEditor (ChainAudioProcessor&);
+    ~ChainAudioProcessorEditor();
+
+    //==============================================================================
+
+    void paint (Graphics&) override;
+    void resized() override;
+
+private:
+    //==============================================================================
+
+    ChainAudioProcessor& processor;
+
+    enum {
+        editorWidth = 500,
+        editorMargin = 10,
+        editorPadding = 10,
+
+        sliderTextEntryBoxWidth = 100,
+        sliderTextEntryBoxHeight = 25,
+        sliderHeight = 25,
+        buttonHeight = 25,
+        comboBoxHeight = 25,
+        labelWidth = 100,
+        tabBarDepth = 30,
+    };
+
+    //======================================
+
+    OwnedArray<Slider> sliders;
+    OwnedArray<ToggleButton> toggles;
+    OwnedArray<ComboBox> comboBoxes;
+
+    OwnedArray<Label> labels;
+    Array<Component*> components;
+
+    typedef AudioProcessorValueTreeState::SliderAttachment SliderAttachment;
+    typedef AudioProcessorValueTreeState::ButtonAttachment ButtonAttachment;
+    typedef AudioProcessorValueTreeState::ComboBoxAttachment ComboBoxAttachment;
+
+    OwnedArray<SliderAttachment> sliderAttachments;
+    OwnedArray<ButtonAttachment> buttonAttachments;
+    OwnedArray<ComboBoxAttachment> comboBoxAttachments;
+
+    int controlsHeight;
+
+    //======================================
+
+    // One tab with the editor of each effect in the chain
+    TabbedComponent stageTabs;
+    Array<int> stageTabEffects;
+
+    //======================================
+
+    void timerCallback() override;
+    void updateUIcomponents();
+    EditorValueSnapshot uiValues;
+
+    //======================================
+
+    EditorRenderingContext renderingContext;
+    SharedResourcePointer<EditorLookAndFeel> lookAndFeel;
+
+    //==============================================================================
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ChainAudioProcessorEditor)
+};
+
+//==============================================================================
@@ -0,0 +1,911 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "RealtimeSafety.h"
+#include "TraceMarkers.h"
+#include <atomic>
+#include <cstring>
+using Parameter = AudioProcessorValueTreeState::Parameter;
+
+class PluginParameter;
+
+//==============================================================================
+
+/** Lock-free FIFO of up to capacity - 1 items between exactly one producer thread
+    and one consumer thread.
+*/
+template <typename ItemType, int capacity>
+class SingleProducerSingleConsumerQueue
+{
+public:
+    SingleProducerSingleConsumerQueue() : fifo (capacity)
+    {
+    }
+
+    /** Returns false, and drops the item, if the queue is full. */
+    bool push (const ItemType& item) noexcept
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite (1, start1, size1, start2, size2);
+        if (size1 + size2 == 0)
+            return false;
+
+        items[(size1 > 0) ? start1 : start2] = item;
+        fifo.finishedWrite (1);
+        return true;
+    }
+
+    /** Returns false if the queue is empty. */
+    bool pop (ItemType& item) noexcept
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead (1, start1, size1, start2, size2);
+        if (size1 + size2 == 0)
+            return false;
+
+        item = items[(size1 > 0) ? start1 : start2];
+        fifo.finishedRead (1);
+        return true;
+    }
+
+private:
+    AbstractFifo fifo;
+    ItemType items[capacity];
+
+    JUCE_DECLARE_NON_COPYABLE (SingleProducerSingleConsumerQueue)
+};
+
+//==============================================================================
+
+class PluginParametersManager : private AsyncUpdater
+{
+public:
+    PluginParametersManager (AudioProcessor& p) : apvts (p, nullptr)
+    {
+    }
+
+    ~PluginParametersManager()
+    {
+        cancelPendingUpdate();
+        stopDeferredCallbacks();
+    }
+
+    //======================================
+
+    /** Parameters with deferred callbacks, see PluginParameter::deferCallback(), have
+        them run on a background worker. The values they return are handed to the
+        audio thread through a lock-free queue, and stored when processBlock calls
+        applyDeferredValues().
+
+        The thread of the worker is only started by the first flushDeferredCallbacks(),
+        so an instance that a session loads but never prepares costs no thread. The
+        changes made before then stay pending, and that first flush runs them.
+    */
+    void addDeferredParameter (PluginParameter* parameter)
+    {
+        const ScopedLock lock (deferredCallbackLock);
+
+        deferredParameters.add (parameter);
+        if (worker == nullptr)
+            worker = std::make_unique<DeferredCallbackWorker> (*this);
+    }
+
+    void triggerDeferredCallbacks() noexcept
+    {
+        // Waking the worker locks its event for a moment
+        const RealtimeSafety::ScopedExemption exemption;
+
+        if (worker != nullptr)
+            worker->notify();
+    }
+
+    /** Called by the audio thread at the start of every block. */
+    void applyDeferredValues() noexcept;
+
+    /** Runs any pending deferred callbacks on the calling thread and stores their
+        values. For prepareToPlay, where the audio thread is not running.
+    */
+    void flushDeferredCallbacks()
+    {
+        runDeferredCallbacks();
+        applyDeferredValues();
+
+        if (worker != nullptr && ! worker->isThreadRunning())
+            worker->startThread();
+    }
+
+    void stopDeferredCallbacks()
+    {
+        if (worker != nullptr)
+            worker->stopThread (-1);
+    }
+
+    //======================================
+
+    /** Compact state used by getStateInformation(): a magic number and a version,
+        then the ID and value of every parameter. Unlike the XML of copyState(), it
+        needs no copy of the tree and no parsing to load, which adds up in sessions
+        with hundreds of instances. A processor with more state than its parameters
+        writes it to the stream after the table, and reads it back after readState().
+    */
+    void writeState (OutputStream& stream) const;
+
+    /** Sets the parameters found in the table of a writeState() stream, leaving the
+        stream just after the table. Returns false, and leaves the parameters alone,
+        if the data is not in that format, so that the caller can fall back to the
+        XML of older sessions.
+    */
+    bool readState (InputStream& stream);
+
+    enum {
+        stateMagic = 0x53464541, // "AEFS" in little endian
+        stateVersion = 1,
+    };
+
+    //======================================
+
+    /** Presets held in memory for live morphs. A slot keeps the normalised value of
+        every parameter, checked and snapped to its range when it is stored, so
+        morphSnapshots() only has to ask for a point between two slots. The next
+        applySnapshotMorph() on the audio thread then moves all the parameters
+        there in one pass, through their callbacks and smoothing as for a change
+        from the host, without any XML or ValueTree work.
+
+        Only the parameters whose value moves are changed. Those with deferred
+        callbacks, which reallocate buffers or rebuild engines, only take their
+        value when the morph reaches either end, at a position of 0 or 1, so a morph
+        in between does not rebuild them at every step.
+
+        On its way between the ends, a morph drives the processing only: the
+        parameters the host sees keep their values, and the next change to one of
+        them takes over from the morph. Once it reaches an end, the message thread
+        sets them to the slot of that end, as a gesture, so that the host, the
+        editor and the saved state agree with what is heard. It skips that if
+        another morph was applied in the meantime.
+    */
+    enum { numSnapshotSlots = 8 };
+
+    /** Stores the current values of the parameters in a slot. Not real-time safe.
+        Returns false if the slot does not exist.
+    */
+    bool storeSnapshot (const int slot);
+
+    /** Stores in a slot the table of a writeState() stream, for example a preset
+        loaded ahead of time, with the same rules as readState(). Parameters missing
+        from the table keep their current values. Not real-time safe. Returns false
+        if the slot does not exist or the data is not in that format.
+    */
+    bool storeSnapshot (const int slot, InputStream& stream);
+
+    /** Asks for the point at position, from 0 to 1, between two stored slots. Any
+        thread can call it, and the last request before a block wins. Returns false
+        if either slot is empty.
+    */
+    bool morphSnapshots (const int slotA, const int slotB, const float position) noexcept;
+
+    /** Called by the audio thread at the start of every block. Costs a relaxed load
+        while no morph is pending.
+    */
+    void applySnapshotMorph() noexcept;
+
+    //======================================
+
+    /** Moves on whenever a parameter takes a new value, on whichever thread, and
+        whenever a deferred callback runs or its result is stored. An editor compares
+        it with the one of its last timer tick, and skips gathering and updating
+        whatever only depends on the parameters while it is the same.
+    */
+    uint32 getChangeGeneration() const noexcept
+    {
+        return changeGeneration.load (std::memory_order_acquire);
+    }
+
+    void markChanged() noexcept
+    {
+        changeGeneration.fetch_add (1, std::memory_order_release);
+    }
+
+    //======================================
+
+    AudioProcessorValueTreeState apvts;
+    StringArray parameterTypes;
+    Array<StringArray> comboBoxItemLists;
+    Array<PluginParameter*> pluginParameters;
+
+    /** Held while deferred callbacks run, so that code they share with other
+        threads, such as prepareToPlay, can be serialised with them.
+    */
+    CriticalSection deferredCallbackLock;
+
+private:
+    //======================================
+
+    friend class PluginParameter;
+
+    class DeferredCallbackWorker : public Thread
+    {
+    public:
+        DeferredCallbackWorker (PluginParametersManager& owner)
+            : Thread ("Deferred parameter callbacks")
+            , owner (owner)
+        {
+        }
+
+        ~DeferredCallbackWorker()
+        {
+            stopThread (-1);
+        }
+
+        void run() override
+        {
+            while (! threadShouldExit()) {
+                // Waits again briefly when the queue to the audio thread was full
+                const bool queueFull = ! owner.runDeferredCallbacks();
+                wait (queueFull ? 10 : -1);
+            }
+        }
+
+    private:
+        PluginParametersManager& owner;
+    };
+
+    struct DeferredValue
+    {
+        PluginParameter* parameter;
+        float value;
+    };
+
+    /** Returns false if some results did not fit in the queue and are still pending. */
+    bool runDeferredCallbacks();
+
+    /** Sets the parameters the host sees to the slot a morph ended on. */
+    void handleAsyncUpdate() override;
+
+    struct SnapshotSlot
+    {
+        std::unique_ptr<std::atomic<float>[]> values;
+        std::atomic<uint32> sequence { 0 };    // Odd while written, zero while empty
+    };
+
+    /** Finds the parameters of the PluginParameters and allocates the slots, the
+        first time a slot is stored, once all the parameters exist.
+    */
+    void prepareSnapshots();
+    void writeSnapshot (const int slot, const float* normalisedValues);
+
+    CriticalSection snapshotLock;
+    Array<RangedAudioParameter*> snapshotParameters;
+    SnapshotSlot snapshotSlots[numSnapshotSlots];
+    HeapBlock<float> morphValues;
+    std::atomic<uint64> morphRequest { 0 };
+    std::atomic<uint32> morphGeneration { 0 };
+    std::atomic<uint64> morphEnd { 0 };    // Slot sequence, generation and slot of the last morph to reach an end
+    bool notifyingHostOfMorph = false;
+
+    std::atomic<uint32> changeGeneration { 0 };
+
+    Array<PluginParameter*> deferredParameters;
+    SingleProducerSingleConsumerQueue<DeferredValue, 64> deferredValues;
+    std::unique_ptr<DeferredCallbackWorker> worker;
+};
+
+//==============================================================================
+
+class PluginParameter
+    : public LinearSmoothedValue<float>
+    , public AudioProcessorValueTreeState::Listener
+{
+protected:
+    PluginParameter (PluginParametersManager& parametersManager,
+                     const std::function<float (float)> callback = nullptr)
+        : parametersManager (parametersManager)
+        , callback (callback)
+    {
+        parametersManager.pluginParameters.add (this);
+    }
+
+    ~PluginParameter()
+    {
+        // The worker may be running callbacks that use the other parameters
+        if (deferred)
+            parametersManager.stopDeferredCallbacks();
+    }
+
+public:
+    void updateValue (float value)
+    {
+        deferredValue.store (value);
+
+        TRACE_INSTANCE_SCOPE ("parameter callback", &parametersManager.apvts.processor);
+        const float newValue = (callback != nullptr) ? callback (value) : value;
+        if (smoothed)
+            setTargetValue (newValue);
+        else
+            setCurrentAndTargetValue (newValue);
+
+        parametersManager.markChanged();
+    }
+
+    void parameterChanged (const String& parameterID, float newValue) override
+    {
+        if (parametersManager.notifyingHostOfMorph && newValue == deferredValue.load())
+            return;
+
+        if (! deferred) {
+            updateValue (newValue);
+        } else if (parametersManager.apvts.processor.isNonRealtime()) {
+            // Offline renders apply every change straight away, so that they are repeatable
+            const ScopedLock lock (parametersManager.deferredCallbackLock);
+            updateValue (newValue);
+        } else {
+            deferredValue.store (newValue);
+            deferredCallbackPending.store (true);
+            parametersManager.triggerDeferredCallbacks();
+        }
+    }
+
+    /** Flags the callback as too heavy for the thread that changes the parameter,
+        for example because it reallocates buffers or FFT plans. From then on it runs
+        on the background worker of the PluginParametersManager, and only its result
+        reaches the audio thread. Changes made while it runs are coalesced.
+    */
+    void deferCallback()
+    {
+        deferred = true;
+        parametersManager.addDeferredParameter (this);
+    }
+
+    /** Makes the changes ramp over the time given to reset(), from the start of the
+        next block, instead of taking effect at once. For parameters that processBlock
+        reads at every sample, through getNextValue() or getNextValues(), and whose
+        callbacks are not deferred.
+    */
+    void smoothChanges() noexcept
+    {
+        jassert (! deferred);
+        smoothed = true;
+    }
+
+    /** Runs a deferred callback again on the background worker, with the last value
+        of the parameter, for a callback that also reads state from outside of it.
+        It only sets a flag and wakes the worker, so the audio thread can call it.
+    */
+    void retriggerDeferredCallback() noexcept
+    {
+        jassert (deferred);
+        deferredCallbackPending.store (true);
+        parametersManager.triggerDeferredCallbacks();
+    }
+
+    /** Block version of getNextValue(). While the parameter is smoothing, this writes
+        its next numSamples values into ramp and returns true. Otherwise ramp is left
+        alone, and the function returns false as getTargetValue() holds for the whole
+        block, so that the caller can take a constant-parameter path.
+    */
+    bool getNextValues (float* ramp, const int numSamples) noexcept
+    {
+        if (! isSmoothing())
+            return false;
+
+        for (int sample = 0; sample < numSamples; ++sample)
+            ramp[sample] = getNextValue();
+
+        return true;
+    }
+
+    /** Same as getNextValues(), but fills ramp with the constant value when the
+        parameter is not smoothing.
+    */
+    void fillNextValues (float* ramp, const int numSamples) noexcept
+    {
+        if (! getNextValues (ramp, numSamples))
+            FloatVectorOperations::fill (ramp, getTargetValue(), numSamples);
+    }
+
+    /** Number of samples left until the parameter reaches its target value. */
+    int getNumSmoothingSamples() const noexcept
+    {
+        return this->countdown;
+    }
+
+    /** Length of the start of a block of numSamples over which any of parameters is
+        smoothing. The hosts hand the changes over before processBlock, so the ramps
+        all start with a block and a processor can split it there: the first part
+        takes the ramps, and the rest a constant-parameter path.
+
+        This is the only split. Automation is not sample accurate: the plugin
+        wrappers apply the changes through parameterChanged() without the offsets of
+        the host's events, so there are no offsets within the block to split at, and
+        a change lands at the start of the next block, ramped.
+    */
+    static int getNumSmoothingSamples (std::initializer_list<const PluginParameter*> parameters,
+                                       const int numSamples) noexcept
+    {
+        int numSmoothingSamples = 0;
+        for (const PluginParameter* parameter : parameters)
+            numSmoothingSamples = jmax (numSmoothingSamples, parameter->getNumSmoothingSamples());
+
+        return jmin (numSmoothingSamples, numSamples);
+    }
+
+    PluginParametersManager& parametersManager;
+    std::function<float (float)> callback;
+    String paramID;
+
+private:
+    friend class PluginParametersManager;
+
+    bool deferred = false;
+    bool smoothed = false;
+    std::atomic<bool> deferredCallbackPending { false };
+    std::atomic<float> deferredValue { 0.0f };    // The last value, deferred or not
+
+    float deferredResult = 0.0f;
+    bool deferredResultQueued = true;
+};
+
+//==============================================================================
+
+inline void PluginParametersManager::applyDeferredValues() noexcept
+{
+    DeferredValue deferredValue;
+    bool changed = false;
+    while (deferredValues.pop (deferredValue)) {
+        deferredValue.parameter->setCurrentAndTargetValue (deferredValue.value);
+        changed = true;
+    }
+
+    if (changed)
+        markChanged();
+}
+
+inline bool PluginParametersManager::runDeferredCallbacks()
+{
+    const ScopedLock lock (deferredCallbackLock);
+
+    bool allQueued = true;
+    for (PluginParameter* parameter : deferredParameters) {
+        if (parameter->deferredCallbackPending.exchange (false)) {
+            TRACE_INSTANCE_SCOPE ("deferred parameter callback", &apvts.processor);
+            const float value = parameter->deferredValue.load();
+            parameter->deferredResult = (parameter->callback != nullptr) ? parameter->callback (value) : value;
+            parameter->deferredResultQueued = false;
+            markChanged();
+        }
+
+        // A result that did not fit is queued again later, without running the callback again
+        if (! parameter->deferredResultQueued) {
+            parameter->deferredResultQueued = deferredValues.push ({ parameter, parameter->deferredResult });
+            allQueued = allQueued && parameter->deferredResultQueued;
+        }
+    }
+
+    return allQueued;
+}
+
+//==============================================================================
+
+inline bool PluginParametersManager::storeSnapshot (const int slot)
+{
+    const ScopedLock lock (snapshotLock);
+
+    if (! isPositiveAndBelow (slot, (int)numSnapshotSlots))
+        return false;
+
+    prepareSnapshots();
+
+    HeapBlock<float> values (snapshotParameters.size());
+    for (int i = 0; i < snapshotParameters.size(); ++i)
+        values[i] = snapshotParameters[i]->getValue();
+
+    writeSnapshot (slot, values);
+    return true;
+}
+
+inline bool PluginParametersManager::storeSnapshot (const int slot, InputStream& stream)
+{
+    const ScopedLock lock (snapshotLock);
+
+    if (! isPositiveAndBelow (slot, (int)numSnapshotSlots) || stream.getNumBytesRemaining() < 8)
+        return false;
+
+    const int64 start = stream.getPosition();
+    if (stream.readInt() != stateMagic) {
+        stream.setPosition (start);
+        return false;
+    }
+    stream.readInt();
+
+    prepareSnapshots();
+
+    HeapBlock<float> values (snapshotParameters.size());
+    for (int i = 0; i < snapshotParameters.size(); ++i)
+        values[i] = snapshotParameters[i]->getValue();
+
+    const int numParameters = stream.readCompressedInt();
+    for (int i = 0; i < numParameters && ! stream.isExhausted(); ++i) {
+        const String parameterID = stream.readString();
+        const float value = stream.readFloat();
+
+        // convertTo0to1() snaps the value into the range, and to its steps
+        const int index = snapshotParameters.indexOf (apvts.getParameter (parameterID));
+        if (index >= 0 && std::isfinite (value))
+            values[index] = snapshotParameters[index]->convertTo0to1 (value);
+    }
+
+    writeSnapshot (slot, values);
+    return true;
+}
+
+inline bool PluginParametersManager::morphSnapshots (const int slotA, const int slotB, const float position) noexcept
+{
+    if (! isPositiveAndBelow (slotA, (int)numSnapshotSlots) || ! isPositiveAndBelow (slotB, (int)numSnapshotSlots)
+        || snapshotSlots[slotA].sequence.load (std::memory_order_acquire) == 0
+        || snapshotSlots[slotB].sequence.load (std::memory_order_acquire) == 0)
+        return false;
+
+    // The whole request in one word, so the audio thread never sees half of it
+    const float clippedPosition = std::isfinite (position) ? jlimit (0.0f, 1.0f, position) : 0.0f;
+    uint32 positionBits;
+    std::memcpy (&positionBits, &clippedPosition, sizeof (positionBits));
+
+    morphRequest.store (((uint64)1 << 63) | ((uint64)slotA << 40) | ((uint64)slotB << 32) | (uint64)positionBits,
+                        std::memory_order_release);
+    return true;
+}
+
+inline void PluginParametersManager::applySnapshotMorph() noexcept
+{
+    if (morphRequest.load (std::memory_order_relaxed) == 0)
+        return;
+
+    const uint64 request = morphRequest.exchange (0, std::memory_order_acquire);
+    if (request == 0)
+        return;
+
+    TRACE_INSTANCE_SCOPE ("snapshot morph", &apvts.processor);
+
+    const SnapshotSlot& slotA = snapshotSlots[(int)((request >> 40) & 0xff)];
+    const SnapshotSlot& slotB = snapshotSlots[(int)((request >> 32) & 0xff)];
+    const uint32 positionBits = (uint32)request;
+    float position;
+    std::memcpy (&position, &positionBits, sizeof (position));
+
+    const uint32 sequenceA = slotA.sequence.load (std::memory_order_acquire);
+    const uint32 sequenceB = slotB.sequence.load (std::memory_order_acquire);
+
+    if (((sequenceA | sequenceB) & 1) == 0) {
+        const int numParameters = snapshotParameters.size();
+        for (int i = 0; i < numParameters; ++i) {
+            const float valueA = slotA.values[i].load (std::memory_order_relaxed);
+            const float valueB = slotB.values[i].load (std::memory_order_relaxed);
+            morphValues[i] = (position == 1.0f) ? valueB : valueA + position * (valueB - valueA);
+        }
+
+        std::atomic_thread_fence (std::memory_order_acquire);
+        if (slotA.sequence.load (std::memory_order_relaxed) == sequenceA
+            && slotB.sequence.load (std::memory_order_relaxed) == sequenceB) {
+            // parameterChanged() defers or runs the callbacks as for a host change
+            const bool atEnd = (position == 0.0f || position == 1.0f);
+            for (int i = 0; i < numParameters; ++i) {
+                PluginParameter* parameter = pluginParameters.getUnchecked (i);
+                if (parameter->deferred && ! atEnd)
+                    continue;
+
+                const float value = snapshotParameters.getUnchecked (i)->convertFrom0to1 (morphValues[i]);
+                if (value != parameter->deferredValue.load (std::memory_order_relaxed))
+                    parameter->parameterChanged (parameter->paramID, value);
+            }
+
+            const uint32 generation = morphGeneration.fetch_add (1, std::memory_order_relaxed) + 1;
+            if (atEnd) {
+                const uint64 sequence = (position == 0.0f) ? sequenceA : sequenceB;
+                const uint64 slot = (position == 0.0f) ? ((request >> 40) & 0xff) : ((request >> 32) & 0xff);
+                morphEnd.store ((sequence << 32) | ((uint64)(generation & 0xffffff) << 8) | slot,
+                                std::memory_order_release);
+
+                // Posting the message may lock for a moment
+                const RealtimeSafety::ScopedExemption exemption;
+                triggerAsyncUpdate();
+            }
+            return;
+        }
+    }
+
+    // A slot was being stored, so the request is tried again on the next block,
+    // unless a newer one came in the meantime
+    uint64 expected = 0;
+    morphRequest.compare_exchange_strong (expected, request, std::memory_order_relaxed);
+}
+
+inline void PluginParametersManager::handleAsyncUpdate()
+{
+    const uint64 end = morphEnd.load (std::memory_order_acquire);
+    if ((uint32)((end >> 8) & 0xffffff) != (morphGeneration.load (std::memory_order_relaxed) & 0xffffff))
+        return;
+
+    const ScopedLock lock (snapshotLock);
+
+    // Stored again since the audio thread read it, so its values are not the ones heard
+    const SnapshotSlot& slot = snapshotSlots[(int)(end & 0xff)];
+    if (slot.sequence.load (std::memory_order_acquire) != (uint32)(end >> 32))
+        return;
+
+    // The parameters already have these values, so they do not run their callbacks again
+    const ScopedValueSetter<bool> notifying (notifyingHostOfMorph, true);
+
+    for (int i = 0; i < snapshotParameters.size(); ++i) {
+        RangedAudioParameter* parameter = snapshotParameters.getUnchecked (i);
+        const float value = slot.values[i].load (std::memory_order_relaxed);
+
+        if (value != parameter->getValue()) {
+            parameter->beginChangeGesture();
+            parameter->setValueNotifyingHost (value);
+            parameter->endChangeGesture();
+        }
+    }
+}
+
+inline void PluginParametersManager::prepareSnapshots()
+{
+    if (! snapshotParameters.isEmpty())
+        return;
+
+    for (PluginParameter* parameter : pluginParameters) {
+        RangedAudioParameter* rangedParameter = apvts.getParameter (parameter->paramID);
+        jassert (rangedParameter != nullptr);
+        snapshotParameters.add (rangedParameter);
+    }
+
+    // Allocated before any slot is stored, so the audio thread only reads them once
+    // the sequence of a slot says so
+    for (SnapshotSlot& slot : snapshotSlots)
+        slot.values.reset (new std::atomic<float>[(size_t)snapshotParameters.size()]);
+    morphValues.allocate (snapshotParameters.size(), true);
+}
+
+inline void PluginParametersManager::writeSnapshot (const int slot, const float* normalisedValues)
+{
+    SnapshotSlot& snapshot = snapshotSlots[slot];
+    const uint32 sequence = snapshot.sequence.load (std::memory_order_relaxed);
+
+    snapshot.sequence.store (sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence (std::memory_order_release);
+
+    for (int i = 0; i < snapshotParameters.size(); ++i)
+        snapshot.values[i].store (normalisedValues[i], std::memory_order_relaxed);
+
+    snapshot.sequence.store (sequence + 2, std::memory_order_release);
+}
+
+//==============================================================================
+
+inline void PluginParametersManager::writeState (OutputStream& stream) const
+{
+    const Array<AudioProcessorParameter*>& processorParameters = apvts.processor.getParameters();
+
+    stream.writeInt (stateMagic);
+    stream.writeInt (stateVersion);
+    stream.writeCompressedInt (processorParameters.size());
+
+    for (AudioProcessorParameter* processorParameter : processorParameters) {
+        auto* parameter = dynamic_cast<RangedAudioParameter*> (processorParameter);
+        jassert (parameter != nullptr);
+
+        stream.writeString (parameter->paramID);
+        stream.writeFloat (parameter->convertFrom0to1 (parameter->getValue()));
+    }
+}
+
+inline bool PluginParametersManager::readState (InputStream& stream)
+{
+    if (stream.getNumBytesRemaining() < 8)
+        return false;
+
+    const int64 start = stream.getPosition();
+    if (stream.readInt() != stateMagic) {
+        stream.setPosition (start);
+        return false;
+    }
+
+    // Later versions may only append to the format, so the table is always readable
+    stream.readInt();
+
+    const int numParameters = stream.readCompressedInt();
+    for (int i = 0; i < numParameters && ! stream.isExhausted(); ++i) {
+        const String parameterID = stream.readString();
+        const float value = stream.readFloat();
+
+        // Parameters that no longer exist are skipped, and new ones keep their value
+        if (RangedAudioParameter* parameter = apvts.getParameter (parameterID))
+            parameter->setValueNotifyingHost (parameter->convertTo0to1 (value));
+    }
+
+    return true;
+}
+
+//==============================================================================
+
+class PluginParameterSlider : public PluginParameter
+{
+protected:
+    PluginParameterSlider (PluginParametersManager& parametersManager,
+                           const String& paramName,
+                           const String& labelText,
+                           const float minValue,
+                           const float maxValue,
+                           const float defaultValue,
+                           const std::function<float (float)> callback,
+                           const bool logarithmic)
+        : PluginParameter (parametersManager, callback)
+        , paramName (paramName)
+        , labelText (labelText)
+        , minValue (minValue)
+        , maxValue (maxValue)
+        , defaultValue (defaultValue)
+    {
+        paramID = paramName.removeCharacters (" ").toLowerCase();
+        parametersManager.parameterTypes.add ("Slider");
+
+        NormalisableRange<float> range (minValue, maxValue);
+        if (logarithmic)
+            range.setSkewForCentre (sqrt (minValue * maxValue));
+
+        parametersManager.apvts.createAndAddParameter (std::make_unique<Parameter>
+            (paramID, paramName, labelText, range, defaultValue,
+             [](float value){ return String (value, 2); },
+             [](const String& text){ return text.getFloatValue(); })
+        );
+
+        parametersManager.apvts.addParameterListener (paramID, this);
+        updateValue (defaultValue);
+    }
+
+public:
+    const String& paramName;
+    const String& labelText;
+    const float minValue;
+    const float maxValue;
+    const float defaultValue;
+};
+
+//======================================
+
+class PluginParameterLinSlider : public PluginParameterSlider
+{
+public:
+    PluginParameterLinSlider (PluginParametersManager& parametersManager,
+                              const String& paramName,
+                              const String& labelText,
+                              const float minValue,
+                              const float maxValue,
+                              const float defaultValue,
+                              const std::function<float (float)> callback = nullptr)
+        : PluginParameterSlider (parametersManager,
+                                 paramName,
+                                 labelText,
+                                 minValue,
+                                 maxValue,
+                                 defaultValue,
+                                 callback,
+                                 false)
+    {
+    }
+};
+
+//======================================
+
+class PluginParameterLogSlider : public PluginParameterSlider
+{
+public:
+    PluginParameterLogSlider (PluginParametersManager& parametersManager,
+                              const String& paramName,
+                              const String& labelText,
+                              const float minValue,
+                              const float maxValue,
+                              const float defaultValue,
+                              const std::function<float (float)> callback = nullptr)
+        : PluginParameterSlider (parametersManager,
+                                 paramName,
+                                 labelText,
+                                 minValue,
+                                 maxValue,
+                                 defaultValue,
+                                 callback,
+                                 true)
+    {
+    }
+};
+
+//==============================================================================
+
+class PluginParameterToggle : public PluginParameter
+{
+public:
+    PluginParameterToggle (PluginParametersManager& parametersManager,
+                           const String& paramName,
+                           const bool defaultState = false,
+                           const std::function<float (float)> callback = nullptr)
+        : PluginParameter (parametersManager, callback)
+        , paramName (paramName)
+        , defaultState (defaultState)
+    {
+        paramID = paramName.removeCharacters (" ").toLowerCase();
+        parametersManager.parameterTypes.add ("ToggleButton");
+
+        const StringArray toggleStates = {"False", "True"};
+        NormalisableRange<float> range (0.0f, 1.0f, 1.0f);
+
+        parametersManager.apvts.createAndAddParameter (std::make_unique<Parameter>
+            (paramID, paramName, "", range, (float)defaultState,
+             [toggleStates](float value){ return toggleStates[(int)value]; },
+             [toggleStates](const String& text){ return toggleStates.indexOf (text); })
+        );
+
+        parametersManager.apvts.addParameterListener (paramID, this);
+        updateValue ((float)defaultState);
+    }
+
+    const String& paramName;
+    const bool defaultState;
+};
+
+//==============================================================================
+
+class PluginParameterComboBox : public PluginParameter
+{
+public:
+    PluginParameterComboBox (PluginParametersManager& parametersManager,
+                             const String& paramName,
+                             const StringArray items,
+                             const int defaultChoice = 0,
+                             const std::function<float (const float)> callback = nullptr)
+        : PluginParameter (parametersManager, callback)
+        , paramName (paramName)
+        , items (items)
+        , defaultChoice (defaultChoice)
+    {
+        paramID = paramName.removeCharacters (" ").toLowerCase();
+        parametersManager.parameterTypes.add ("ComboBox");
+
+        parametersManager.comboBoxItemLists.add (items);
+        NormalisableRange<float> range (0.0f, (float)items.size() - 1.0f, 1.0f);
+
+        parametersManager.apvts.createAndAddParameter (std::make_unique<Parameter>
+            (paramID, paramName, "", range, (float)defaultChoice,
+             [items](float value){ return items[(int)value]; },
+             [items](const String& text){ return items.indexOf (text); })
+        );
+
+        parametersManager.apvts.addParameterListener (paramID, this);
+        updateValue ((float)defaultChoice);
+    }
+
+    const String& paramName;
+    const StringArray items;
+    const int defaultChoice;
+};
+
+//==============================================================================
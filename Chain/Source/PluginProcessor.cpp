@@ -0,0 +1,722 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#include "PluginProcessor.h"
+#include "PluginEditor.h"
+#include "PluginParameter.h"
+
+//==============================================================================
+
+// Defined by the sources in the Effects folder
+AudioProcessor* JUCE_CALLTYPE createChorusAudioProcessor();
+AudioProcessor* JUCE_CALLTYPE createCompressorExpanderAudioProcessor();
+AudioProcessor* JUCE_CALLTYPE createDelayAudioProcessor();
+AudioProcessor* JUCE_CALLTYPE createDistortionAudioProcessor();
+AudioProcessor* JUCE_CALLTYPE createFlangerAudioProcessor();
+AudioProcessor* JUCE_CALLTYPE createPanningAudioProcessor();
+AudioProcessor* JUCE_CALLTYPE createParametricEQAudioProcessor();
+AudioProcessor* JUCE_CALLTYPE createPhaserAudioProcessor();
+AudioProcessor* JUCE_CALLTYPE createPingPongDelayAudioProcessor();
+AudioProcessor* JUCE_CALLTYPE createPitchShiftAudioProcessor();
+AudioProcessor* JUCE_CALLTYPE createRingModulationAudioProcessor();
+AudioProcessor* JUCE_CALLTYPE createRobotizationWhisperizationAudioProcessor();
+AudioProcessor* JUCE_CALLTYPE createTremoloAudioProcessor();
+AudioProcessor* JUCE_CALLTYPE createVibratoAudioProcessor();
+AudioProcessor* JUCE_CALLTYPE createWahWahAudioProcessor();
+
+// In the order of ChainAudioProcessor::effectIndex
+static AudioProcessor* (JUCE_CALLTYPE *const effectFactories[ChainAudioProcessor::numEffects])() = {
+    nullptr,
+    createChorusAudioProcessor,
+    createCompressorExpanderAudioProcessor,
+    createDelayAudioProcessor,
+    createDistortionAudioProcessor,
+    createFlangerAudioProcessor,
+    createPanningAudioProcessor,
+    createParametricEQAudioProcessor,
+    createPhaserAudioProcessor,
+    createPingPongDelayAudioProcessor,
+    createPitchShiftAudioProcessor,
+    createRingModulationAudioProcessor,
+    createRobotizationWhisperizationAudioProcessor,
+    createTremoloAudioProcessor,
+    createVibratoAudioProcessor,
+    createWahWahAudioProcessor,
+};
+
+static_assert (ChainAudioProcessor::numEffects - 1 <= ChainAudioProcessor::stageMask,
+               "Every effect index must fit in the bits of one stage");
+static_assert (ChainAudioProcessor::maxNumStages * ChainAudioProcessor::bitsPerStage <= 32,
+               "All the stages must fit in stageOrder");
+static_assert ((ChainAudioProcessor::compensationBufferSamples & (ChainAudioProcessor::compensationBufferSamples - 1)) == 0,
+               "The compensation delay lines wrap with a mask");
+
+//==============================================================================
+
+ChainAudioProcessor::ChainAudioProcessor():
+#ifndef JucePlugin_PreferredChannelConfigurations
+    AudioProcessor (BusesProperties()
+                    #if ! JucePlugin_IsMidiEffect
+                     #if ! JucePlugin_IsSynth
+                      .withInput  ("Input",  AudioChannelSet::stereo(), true)
+                     #endif
+                      .withOutput ("Output", AudioChannelSet::stereo(), true)
+                    #endif
+                   ),
+#endif
+    stageEffects(), stageParallel(), stageOrder (0), graphStageOrder (0), graphHasBranches (false)
+    , graphBuffer (nullptr), graphMidiMessages (nullptr)
+    , preparedSampleRate (0.0), preparedBlockSize (0), preparedNumChannels (0)
+    , parameters (*this)
+    , paramStage1 (parameters, "Stage 1", effectItemsUI, effectCompressorExpander,
+                   [this](float value){ stageEffects[0] = (int)value; updateStages(); return value; })
+    , paramStage2 (parameters, "Stage 2", effectItemsUI, effectParametricEQ,
+                   [this](float value){ stageEffects[1] = (int)value; updateStages(); return value; })
+    , paramRouting2 (parameters, "Stage 2 routing", routingItemsUI, routingSeries,
+                     [this](float value){ stageParallel[1] = ((int)value == routingParallel); updateStages(); return value; })
+    , paramStage3 (parameters, "Stage 3", effectItemsUI, effectDistortion,
+                   [this](float value){ stageEffects[2] = (int)value; updateStages(); return value; })
+    , paramRouting3 (parameters, "Stage 3 routing", routingItemsUI, routingSeries,
+                     [this](float value){ stageParallel[2] = ((int)value == routingParallel); updateStages(); return value; })
+    , paramStage4 (parameters, "Stage 4", effectItemsUI, effectChorus,
+                   [this](float value){ stageEffects[3] = (int)value; updateStages(); return value; })
+    , paramRouting4 (parameters, "Stage 4 routing", routingItemsUI, routingSeries,
+                     [this](float value){ stageParallel[3] = ((int)value == routingParallel); updateStages(); return value; })
+    , paramStage5 (parameters, "Stage 5", effectItemsUI, effectDelay,
+                   [this](float value){ stageEffects[4] = (int)value; updateStages(); return value; })
+    , paramRouting5 (parameters, "Stage 5 routing", routingItemsUI, routingSeries,
+                     [this](float value){ stageParallel[4] = ((int)value == routingParallel); updateStages(); return value; })
+    , bypass (*this, parameters)
+{
+    parameters.apvts.state = ValueTree (Identifier (getName().removeCharacters ("- ")));
+
+    // Selecting a new effect creates and prepares its processor
+    paramStage1.deferCallback();
+    paramStage2.deferCallback();
+    paramRouting2.deferCallback();
+    paramStage3.deferCallback();
+    paramRouting3.deferCallback();
+    paramStage4.deferCallback();
+    paramRouting4.deferCallback();
+    paramStage5.deferCallback();
+    paramRouting5.deferCallback();
+}
+
+ChainAudioProcessor::~ChainAudioProcessor()
+{
+}
+
+//==============================================================================
+
+void ChainAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
+{
+    TRACE_INSTANCE_SCOPE ("prepareToPlay", this);
+
+    const double smoothTime = 1e-3;
+    paramStage1.reset (sampleRate, smoothTime);
+    paramStage2.reset (sampleRate, smoothTime);
+    paramRouting2.reset (sampleRate, smoothTime);
+    paramStage3.reset (sampleRate, smoothTime);
+    paramRouting3.reset (sampleRate, smoothTime);
+    paramStage4.reset (sampleRate, smoothTime);
+    paramRouting4.reset (sampleRate, smoothTime);
+    paramStage5.reset (sampleRate, smoothTime);
+    paramRouting5.reset (sampleRate, smoothTime);
+
+    //======================================
+
+    parameters.flushDeferredCallbacks();
+
+    {
+        const ScopedLock lock (parameters.deferredCallbackLock);
+        preparedSampleRate = sampleRate;
+        preparedBlockSize = samplesPerBlock;
+        preparedNumChannels = getTotalNumInputChannels();
+
+        for (int effect = 0; effect < numEffects; ++effect)
+            if (effects[effect] != nullptr)
+                prepareEffect (*effects[effect]);
+
+        updateStages();
+    }
+
+    const int numChannels = jmax (getTotalNumInputChannels(), getTotalNumOutputChannels());
+    for (int scratch = 0; scratch < maxNumStages; ++scratch) {
+        scratchBuffers[scratch].setSize (numChannels, samplesPerBlock);
+        compensationBuffers[scratch].setSize (numChannels, compensationBufferSamples);
+        compensationBuffers[scratch].clear();
+        compensationPositions[scratch] = 0;
+    }
+
+    // One worker less than branches, as the audio thread runs one of them
+    const int numWorkers = jmin ((int)maxNumStages - 1, SystemStats::getNumCpus() - 1);
+    if (scheduler.getNumWorkers() != numWorkers)
+        scheduler.setNumWorkers (numWorkers);
+
+    profiler.prepare (sampleRate);
+    silenceDetector.prepare (sampleRate);
+    bypass.prepare (sampleRate, samplesPerBlock, (int)maxNumStages * maxStageLatencySamples);
+}
+
+void ChainAudioProcessor::releaseResources()
+{
+    const ScopedLock lock (parameters.deferredCallbackLock);
+
+    for (int effect = 0; effect < numEffects; ++effect)
+        if (effects[effect] != nullptr)
+            effects[effect]->releaseResources();
+}
+
+void ChainAudioProcessor::reset()
+{
+    for (int effect = 0; effect < numEffects; ++effect)
+        if (effects[effect] != nullptr)
+            effects[effect]->reset();
+
+    for (auto& compensationBuffer : compensationBuffers)
+        compensationBuffer.clear();
+}
+
+void ChainAudioProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
+{
+    const ProcessBlockProfiler::ScopedMeasurement measurement (profiler, buffer.getNumSamples(), isNonRealtime());
+    TRACE_INSTANCE_SCOPE ("processBlock", this);
+
+    // One scope for the whole chain, the ones of the stages find the flags already set
+    ScopedNoDenormals noDenormals;
+
+    const int numInputChannels = getTotalNumInputChannels();
+    const int numOutputChannels = getTotalNumOutputChannels();
+    const int numSamples = buffer.getNumSamples();
+
+    //======================================
+
+    parameters.applyDeferredValues();
+    parameters.applySnapshotMorph();
+
+    if (silenceDetector.skipBlock (*this, buffer))
+        return;
+
+    if (bypass.begin (buffer))
+        return;
+
+    const uint32 stages = stageOrder.load (std::memory_order_acquire);
+    if (stages != graphStageOrder)
+        buildGraph (stages);
+
+    if (graphHasBranches)
+        processGraph (buffer, midiMessages);
+    else
+        for (uint32 stage = stages; stage != 0; stage >>= bitsPerStage)
+            effects[stage & stageMask]->processBlock (buffer, midiMessages);
+
+    //======================================
+
+    for (int channel = numInputChannels; channel < numOutputChannels; ++channel)
+        buffer.clear (channel, 0, numSamples);
+
+    bypass.end (buffer);
+}
+
+//==============================================================================
+
+void ChainAudioProcessor::updateStages()
+{
+    // Called from the stage callbacks before prepareToPlay too, when there is
+    // nothing to configure yet
+    if (preparedSampleRate == 0.0)
+        return;
+
+    bool used[numEffects] = {};
+    uint32 newStageOrder = 0;
+    int numStages = 0;
+    int latency = 0;
+    int groupLatency = 0;
+
+    for (int stage = 0; stage < maxNumStages; ++stage) {
+        const int effect = stageEffects[stage];
+        if (effect == effectNone || used[effect])
+            continue;
+
+        // The first active stage has nothing to be parallel to
+        const bool parallel = stageParallel[stage] && numStages > 0;
+        const int stageLatency = getOrCreateEffect (effect)->getLatencySamples();
+        if (parallel) {
+            groupLatency = jmax (groupLatency, stageLatency);
+        } else {
+            latency += groupLatency;
+            groupLatency = stageLatency;
+        }
+
+        used[effect] = true;
+        newStageOrder |= ((uint32)effect | (parallel ? stageParallelFlag : 0)) << (bitsPerStage * numStages++);
+    }
+
+    // Releases the new processors to the audio thread together with the order
+    stageOrder.store (newStageOrder, std::memory_order_release);
+    setLatencySamples (latency + groupLatency);
+
+    // prepareToPlay changes the stages too, and the editor follows the generation
+    parameters.markChanged();
+}
+
+AudioProcessor* ChainAudioProcessor::getOrCreateEffect (const int effect)
+{
+    if (effects[effect] == nullptr) {
+        AudioProcessor* newEffect = effectFactories[effect]();
+        newEffect->setNonRealtime (isNonRealtime());
+        if (preparedSampleRate > 0.0)
+            prepareEffect (*newEffect);
+
+        effects[effect].reset (newEffect);
+    }
+
+    return effects[effect].get();
+}
+
+void ChainAudioProcessor::prepareEffect (AudioProcessor& effect)
+{
+    effect.setPlayConfigDetails (preparedNumChannels, preparedNumChannels, preparedSampleRate, preparedBlockSize);
+    effect.prepareToPlay (preparedSampleRate, preparedBlockSize);
+}
+
+//==============================================================================
+
+void ChainAudioProcessor::buildGraph (const uint32 stages)
+{
+    // Every group of stages runs after the task that ends the previous group
+    graph.clear();
+    graphHasBranches = false;
+    int lastTask = -1;
+
+    uint32 stage = stages;
+    while (stage != 0) {
+        int groupEffects[maxNumStages];
+        int groupSize = 0;
+        do {
+            groupEffects[groupSize++] = (int)(stage & stageMask);
+            stage >>= bitsPerStage;
+        } while (stage != 0 && (stage & stageParallelFlag) != 0);
+
+        if (groupSize == 1) {
+            const int task = graph.addTask();
+            graphTasks[task] = { groupEffects[0], -1, 0, 0 };
+            if (lastTask >= 0)
+                graph.addEdge (lastTask, task);
+
+            lastTask = task;
+        } else {
+            int branchTasks[maxNumStages];
+            for (int branch = 0; branch < groupSize; ++branch) {
+                branchTasks[branch] = graph.addTask();
+                graphTasks[branchTasks[branch]] = { groupEffects[branch], branch, 0, 0 };
+                if (lastTask >= 0)
+                    graph.addEdge (lastTask, branchTasks[branch]);
+            }
+
+            const int sumTask = graph.addTask();
+            graphTasks[sumTask] = { effectNone, 0, groupSize, 0 };
+            for (int branch = 0; branch < groupSize; ++branch)
+                graph.addEdge (branchTasks[branch], sumTask);
+
+            lastTask = sumTask;
+            graphHasBranches = true;
+        }
+    }
+
+    graphStageOrder = stages;
+}
+
+void ChainAudioProcessor::updateBranchDelays() noexcept
+{
+    // The effects change their latencies without any change of the stages, so the
+    // delays are worked out for every block. The branches of a group are the tasks
+    // right before its sum task.
+    for (int task = 0; task < graph.numTasks; ++task) {
+        const GraphTask& sumTask = graphTasks[task];
+        if (sumTask.effect != effectNone)
+            continue;
+
+        const int firstBranch = task - sumTask.numSummed;
+        int groupLatency = 0;
+        for (int branch = firstBranch; branch < task; ++branch)
+            groupLatency = jmax (groupLatency, effects[graphTasks[branch].effect]->getLatencySamples());
+
+        for (int branch = firstBranch; branch < task; ++branch)
+            graphTasks[branch].delay = jlimit (0, (int)maxStageLatencySamples,
+                                               groupLatency - effects[graphTasks[branch].effect]->getLatencySamples());
+    }
+}
+
+void ChainAudioProcessor::processGraph (AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
+{
+    const int numChannels = jmin (buffer.getNumChannels(), scratchBuffers[0].getNumChannels());
+    const int numSamples = buffer.getNumSamples();
+    const int maxSliceSize = scratchBuffers[0].getNumSamples();
+    jassert (maxSliceSize > 0);
+
+    updateBranchDelays();
+
+    // Blocks longer than the scratch buffers run in slices
+    for (int startSample = 0; startSample < numSamples && maxSliceSize > 0; startSample += maxSliceSize) {
+        AudioSampleBuffer slice (buffer.getArrayOfWritePointers(), numChannels, startSample,
+                                 jmin (maxSliceSize, numSamples - startSample));
+        graphBuffer = &slice;
+        graphMidiMessages = &midiMessages;
+        scheduler.run (graph, *this, true);
+    }
+}
+
+void ChainAudioProcessor::runTask (const int task) noexcept
+{
+    const GraphTask& graphTask = graphTasks[task];
+    AudioSampleBuffer& buffer = *graphBuffer;
+    const int numChannels = buffer.getNumChannels();
+    const int numSamples = buffer.getNumSamples();
+
+    if (graphTask.effect == effectNone) {
+        for (int channel = 0; channel < numChannels; ++channel) {
+            float* channelData = buffer.getWritePointer (channel);
+            FloatVectorOperations::copy (channelData,
+                                         scratchBuffers[graphTask.scratch].getReadPointer (channel),
+                                         numSamples);
+            for (int branch = 1; branch < graphTask.numSummed; ++branch)
+                FloatVectorOperations::add (channelData,
+                                            scratchBuffers[graphTask.scratch + branch].getReadPointer (channel),
+                                            numSamples);
+        }
+    }
+
+    else if (graphTask.scratch < 0) {
+        effects[graphTask.effect]->processBlock (buffer, *graphMidiMessages);
+    }
+
+    else {
+        // The other branches read the group input at the same time, so this one works on a copy
+        AudioSampleBuffer branch (scratchBuffers[graphTask.scratch].getArrayOfWritePointers(),
+                                  numChannels, numSamples);
+        for (int channel = 0; channel < numChannels; ++channel)
+            FloatVectorOperations::copy (branch.getWritePointer (channel), buffer.getReadPointer (channel), numSamples);
+
+        MidiBuffer& branchMidiMessages = scratchMidiBuffers[graphTask.scratch];
+        branchMidiMessages.clear();
+        effects[graphTask.effect]->processBlock (branch, branchMidiMessages);
+
+        delayBranch (branch, graphTask.scratch, graphTask.delay);
+    }
+}
+
+void ChainAudioProcessor::delayBranch (AudioSampleBuffer& branch, const int scratch, const int delay) noexcept
+{
+    // Every block goes through the delay line, even without delay, so that it holds
+    // the history when the latencies change
+    AudioSampleBuffer& compensationBuffer = compensationBuffers[scratch];
+    const int numChannels = jmin (branch.getNumChannels(), compensationBuffer.getNumChannels());
+    const int numSamples = branch.getNumSamples();
+    const int mask = (int)compensationBufferSamples - 1;
+    const int writePosition = compensationPositions[scratch];
+
+    for (int channel = 0; channel < numChannels; ++channel) {
+        float* channelData = branch.getWritePointer (channel);
+        float* delayData = compensationBuffer.getWritePointer (channel);
+
+        int position = writePosition;
+        for (int sample = 0; sample < numSamples; ++sample) {
+            delayData[position] = channelData[sample];
+            channelData[sample] = delayData[(position - delay) & mask];
+            position = (position + 1) & mask;
+        }
+    }
+
+    compensationPositions[scratch] = (writePosition + numSamples) & mask;
+}
+
+//==============================================================================
+
+Array<int> ChainAudioProcessor::getStageEffects()
+{
+    Array<int> stageEffectsInOrder;
+    for (uint32 stages = stageOrder.load (std::memory_order_acquire); stages != 0; stages >>= bitsPerStage)
+        stageEffectsInOrder.add ((int)(stages & stageMask));
+
+    return stageEffectsInOrder;
+}
+
+AudioProcessor* ChainAudioProcessor::getEffect (const int effect) const
+{
+    return effects[effect].get();
+}
+
+void ChainAudioProcessor::setNonRealtime (bool isNonRealtime) noexcept
+{
+    AudioProcessor::setNonRealtime (isNonRealtime);
+
+    const ScopedLock lock (parameters.deferredCallbackLock);
+
+    for (int effect = 0; effect < numEffects; ++effect)
+        if (effects[effect] != nullptr)
+            effects[effect]->setNonRealtime (isNonRealtime);
+}
+
+//==============================================================================
+
+void ChainAudioProcessor::getStateInformation (MemoryBlock& destData)
+{
+    MemoryOutputStream stream (destData, false);
+    parameters.writeState (stream);
+
+    // The settings of every effect created so far, so that they survive even if no
+    // stage is using them right now. Each one is its name, then its own state.
+    {
+        const ScopedLock lock (parameters.deferredCallbackLock);
+
+        int numCreatedEffects = 0;
+        for (int effect = effectNone + 1; effect < numEffects; ++effect)
+            if (effects[effect] != nullptr)
+                ++numCreatedEffects;
+
+        stream.writeCompressedInt (numCreatedEffects);
+
+        for (int effect = effectNone + 1; effect < numEffects; ++effect) {
+            if (effects[effect] != nullptr) {
+                MemoryBlock effectState;
+                effects[effect]->getStateInformation (effectState);
+
+                stream.writeString (effectItemsUI[effect]);
+                stream.writeCompressedInt ((int)effectState.getSize());
+                stream.write (effectState.getData(), effectState.getSize());
+            }
+        }
+    }
+}
+
+void ChainAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
+{
+    MemoryInputStream stream (data, (size_t)sizeInBytes, false);
+
+    if (parameters.readState (stream)) {
+        const ScopedLock lock (parameters.deferredCallbackLock);
+
+        const int numCreatedEffects = stream.readCompressedInt();
+        for (int i = 0; i < numCreatedEffects && ! stream.isExhausted(); ++i) {
+            const int effect = effectItemsUI.indexOf (stream.readString());
+
+            MemoryBlock effectState;
+            const int effectStateSize = stream.readCompressedInt();
+            if (effectStateSize < 0 || stream.readIntoMemoryBlock (effectState, effectStateSize) != (size_t)effectStateSize)
+                break;
+
+            if (effect > effectNone)
+                getOrCreateEffect (effect)->setStateInformation (effectState.getData(),
+                                                                 (int)effectState.getSize());
+        }
+
+        return;
+    }
+
+    // Sessions saved in the XML format of older versions
+    std::unique_ptr<XmlElement> xmlState (getXmlFromBinary (data, sizeInBytes));
+
+    if (xmlState.get() != nullptr) {
+        if (xmlState->hasTagName (parameters.apvts.state.getType())) {
+            {
+                const ScopedLock lock (parameters.deferredCallbackLock);
+
+                for (int i = 0; i < xmlState->getNumChildElements(); ++i) {
+                    const XmlElement* effectXml = xmlState->getChildElement (i);
+                    const int effect = effectItemsUI.indexOf (effectXml->getStringAttribute ("name"));
+
+                    if (effectXml->hasTagName ("EFFECT") && effect > effectNone) {
+                        MemoryBlock effectState;
+                        if (effectState.fromBase64Encoding (effectXml->getStringAttribute ("state")))
+                            getOrCreateEffect (effect)->setStateInformation (effectState.getData(),
+                                                                             (int)effectState.getSize());
+                    }
+                }
+            }
+
+            xmlState->deleteAllChildElementsWithTagName ("EFFECT");
+            parameters.apvts.replaceState (ValueTree::fromXml (*xmlState));
+        }
+    }
+}
+
+//==============================================================================
+
+AudioProcessorEditor* ChainAudioProcessor::createEditor()
+{
+    return new ChainAudioProcessorEditor (*this);
+}
+
+bool ChainAudioProcessor::hasEditor() const
+{
+    return true; // (change this to false if you choose to not supply an editor)
+}
+
+//==============================================================================
+
+#ifndef JucePlugin_PreferredChannelConfigurations
+bool ChainAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
+{
+  #if JucePlugin_IsMidiEffect
+    ignoreUnused (layouts);
+    return true;
+  #else
+    // Every effect in the chain supports mono and stereo.
+    if (layouts.getMainOutputChannelSet() != AudioChannelSet::mono()
+     && layouts.getMainOutputChannelSet() != AudioChannelSet::stereo())
+        return false;
+
+    // This checks if the input layout matches the output layout
+   #if ! JucePlugin_IsSynth
+    if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
+        return false;
+   #endif
+
+    return true;
+  #endif
+}
+#endif
+
+//==============================================================================
+
+const String ChainAudioProcessor::getName() const
+{
+    return JucePlugin_Name;
+}
+
+bool ChainAudioProcessor::acceptsMidi() const
+{
+   #if JucePlugin_WantsMidiInput
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+bool ChainAudioProcessor::producesMidi() const
+{
+   #if JucePlugin_ProducesMidiOutput
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+bool ChainAudioProcessor::isMidiEffect() const
+{
+   #if JucePlugin_IsMidiEffect
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+double ChainAudioProcessor::getTailLengthSeconds() const
+{
+    double tailLengthSeconds = 0.0;
+    double groupTailLengthSeconds = 0.0;
+    for (uint32 stages = stageOrder.load (std::memory_order_acquire); stages != 0; stages >>= bitsPerStage) {
+        const double stageTailLengthSeconds = effects[stages & stageMask]->getTailLengthSeconds();
+        if ((stages & stageParallelFlag) != 0) {
+            groupTailLengthSeconds = jmax (groupTailLengthSeconds, stageTailLengthSeconds);
+        } else {
+            tailLengthSeconds += groupTailLengthSeconds;
+            groupTailLengthSeconds = stageTailLengthSeconds;
+        }
+    }
+
+    return tailLengthSeconds + groupTailLengthSeconds;
+}
+
+AudioProcessorParameter* ChainAudioProcessor::getBypassParameter() const
+{
+    return bypass.getParameter();
+}
+
+//==============================================================================
+
+int ChainAudioProcessor::getNumPrograms()
+{
+    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
+                // so this should be at least 1, even if you're not really implementing programs.
+}
+
+int ChainAudioProcessor::getCurrentProgram()
+{
+    return 0;
+}
+
+void ChainAudioProcessor::setCurrentProgram (int index)
+{
+}
+
+const String ChainAudioProcessor::getProgramName (int index)
+{
+    return {};
+}
+
+void ChainAudioProcessor::changeProgramName (int index, const String& newName)
+{
+}
+
+//==============================================================================
+
+MemoryFootprint ChainAudioProcessor::getMemoryFootprint() const
+{
+    const ScopedLock lock (parameters.deferredCallbackLock);
+
+    MemoryFootprint footprint;
+    footprint.add (MemoryFootprint::other, sizeof (*this));
+    bypass.addMemoryFootprint (footprint);
+
+    for (auto& scratchBuffer : scratchBuffers)
+        footprint.add (MemoryFootprint::other, scratchBuffer);
+    for (auto& compensationBuffer : compensationBuffers)
+        footprint.add (MemoryFootprint::delayLines, compensationBuffer);
+
+    // Effects that were selected once stay allocated, in use or not
+    for (auto& effect : effects)
+        if (const MemoryFootprintSource* source = dynamic_cast<const MemoryFootprintSource*> (effect.get()))
+            footprint.add (source->getMemoryFootprint());
+
+    return footprint;
+}
+
+void ChainAudioProcessor::trimMemory()
+{
+    const ScopedLock lock (parameters.deferredCallbackLock);
+
+    for (auto& effect : effects)
+        if (MemoryFootprintSource* source = dynamic_cast<MemoryFootprintSource*> (effect.get()))
+            source->trimMemory();
+}
+
+//==============================================================================
+
+// This creates new instances of the plugin..
+AudioProcessor* JUCE_CALLTYPE createPluginFilter()
+{
+    return new ChainAudioProcessor();
+}
+
+//==============================================================================
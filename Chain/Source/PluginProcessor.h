@@ -0,0 +1,274 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "PluginParameter.h"
+#include "ProcessBlockProfiler.h"
+#include "SilenceDetector.h"
+#include "PluginBypass.h"
+#include "MemoryFootprint.h"
+#include "TaskGraphScheduler.h"
+
+//==============================================================================
+
+/** Runs an ordered subset of the other effects of this repository inside a single
+    plugin instance.
+
+    Every stage processes the host buffer in place, one after the other, inside one
+    processBlock call, so the audio never leaves the buffer (and the cache) between
+    effects. Each effect is created the first time a stage selects it and is kept
+    until the chain is destroyed, so switching stages back and forth keeps its
+    settings, and its editor can be shown next to the chain controls. An effect can
+    be used only once per chain; a later stage selecting the same effect is skipped.
+
+    A stage routed in parallel takes the same input as the stage before it instead
+    of its output. Consecutive parallel stages form a group of branches, which run
+    at the same time on a TaskGraphScheduler and are summed when the group ends.
+    Every branch processes a copy of the group input in its own scratch buffer, and
+    is delayed by the latency it lacks to the slowest branch of its group before
+    they are summed, so that they do not comb-filter.
+*/
+class ChainAudioProcessor : public AudioProcessor, public MemoryFootprintSource, private TaskGraphScheduler::TaskRunner
+{
+public:
+    //==============================================================================
+
+    ChainAudioProcessor();
+    ~ChainAudioProcessor();
+
+    //==============================================================================
+
+    void prepareToPlay (double sampleRate, int samplesPerBlock) override;
+    void releaseResources() override;
+    void reset() override;
+    void processBlock (AudioSampleBuffer&, MidiBuffer&) override;
+
+    //==============================================================================
+
+    /** Returns the effects run by the chain, in order, as indices into effectItemsUI.
+        To be called from the message thread.
+    */
+    Array<int> getStageEffects();
+
+    /** Returns the processor of an effect, or nullptr if no stage has selected it yet.
+        To be called from the message thread, with parameters.deferredCallbackLock held.
+    */
+    AudioProcessor* getEffect (const int effect) const;
+
+    void setNonRealtime (bool isNonRealtime) noexcept override;
+
+    //==============================================================================
+
+    void getStateInformation (MemoryBlock& destData) override;
+    void setStateInformation (const void* data, int sizeInBytes) override;
+
+    //==============================================================================
+
+    AudioProcessorEditor* createEditor() override;
+    bool hasEditor() const override;
+
+    //==============================================================================
+
+   #ifndef JucePlugin_PreferredChannelConfigurations
+    bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
+   #endif
+
+    //==============================================================================
+
+    const String getName() const override;
+
+    bool acceptsMidi() const override;
+    bool producesMidi() const override;
+    bool isMidiEffect () const override;
+    double getTailLengthSeconds() const override;
+    AudioProcessorParameter* getBypassParameter() const override;
+
+    //==============================================================================
+
+    int getNumPrograms() override;
+    int getCurrentProgram() override;
+    void setCurrentProgram (int index) override;
+    const String getProgramName (int index) override;
+    void changeProgramName (int index, const String& newName) override;
+
+    //==============================================================================
+
+    /** Includes every effect that was ever selected, as they are kept. */
+    MemoryFootprint getMemoryFootprint() const override;
+    void trimMemory() override;
+
+    //==============================================================================
+
+    StringArray effectItemsUI = {
+        "None",
+        "Chorus",
+        "Compressor-Expander",
+        "Delay",
+        "Distortion",
+        "Flanger",
+        "Panning",
+        "Parametric EQ",
+        "Phaser",
+        "Ping-Pong Delay",
+        "Pitch Shift",
+        "Ring Modulation",
+        "Robotization-Whisperization",
+        "Tremolo",
+        "Vibrato",
+        "Wah-Wah"
+    };
+
+    enum effectIndex {
+        effectNone = 0,
+        effectChorus,
+        effectCompressorExpander,
+        effectDelay,
+        effectDistortion,
+        effectFlanger,
+        effectPanning,
+        effectParametricEQ,
+        effectPhaser,
+        effectPingPongDelay,
+        effectPitchShift,
+        effectRingModulation,
+        effectRobotizationWhisperization,
+        effectTremolo,
+        effectVibrato,
+        effectWahWah,
+        numEffects,
+    };
+
+    enum {
+        maxNumStages = 5,
+
+        // Bound on the latency of one stage, taken by an STFT of 8192 samples with
+        // the hop of its worker thread
+        maxStageLatencySamples = 2 * 8192,
+    };
+
+    StringArray routingItemsUI = {
+        "Series",
+        "Parallel"
+    };
+
+    enum routingIndex {
+        routingSeries = 0,
+        routingParallel,
+    };
+
+    //======================================
+
+    void updateStages();
+    AudioProcessor* getOrCreateEffect (const int effect);
+    void prepareEffect (AudioProcessor& effect);
+
+    // Written by the stage callbacks, read by updateStages()
+    int stageEffects[maxNumStages];
+    bool stageParallel[maxNumStages];
+
+    // Owned here and never deleted while the chain exists, so that the audio thread
+    // and the stage editors can use them without further synchronisation
+    std::unique_ptr<AudioProcessor> effects[numEffects];
+
+    // The effects of the active stages, packed into bitsPerStage bits each, the first
+    // stage in the lowest bits, followed by a flag for the stages routed in parallel
+    // with the previous one. Zero (effectNone) ends the chain.
+    enum {
+        bitsPerStage = 6,
+        stageMask = (1 << (bitsPerStage - 1)) - 1,
+        stageParallelFlag = 1 << (bitsPerStage - 1),
+    };
+    std::atomic<uint32> stageOrder;
+
+    //======================================
+
+    void buildGraph (const uint32 stages);
+    void updateBranchDelays() noexcept;
+    void processGraph (AudioSampleBuffer& buffer, MidiBuffer& midiMessages);
+    void runTask (const int task) noexcept override;
+    void delayBranch (AudioSampleBuffer& branch, const int scratch, const int delay) noexcept;
+
+    // Built on the audio thread from stageOrder whenever it changes. Every stage is a
+    // task; a group of parallel stages also gets a task that sums its branches.
+    struct GraphTask
+    {
+        int effect;     // effectNone for a sum task
+        int scratch;    // The scratch buffer of a branch, or of the first summed branch; -1 in place
+        int numSummed;  // Branches summed by a sum task
+        int delay;      // Samples by which a branch is delayed to line up with its group
+    };
+
+    uint32 graphStageOrder;
+    bool graphHasBranches;
+    TaskGraph graph;
+    GraphTask graphTasks[TaskGraph::maxNumTasks];
+    TaskGraphScheduler scheduler;
+
+    // Shared by all the groups, as they never run at the same time
+    AudioSampleBuffer scratchBuffers[maxNumStages];
+    MidiBuffer scratchMidiBuffers[maxNumStages];
+
+    // The delay line of the branch of every scratch buffer, long enough for the
+    // latency of a whole stage
+    enum { compensationBufferSamples = 2 * maxStageLatencySamples };
+    AudioSampleBuffer compensationBuffers[maxNumStages];
+    int compensationPositions[maxNumStages] = {};
+
+    // The block being run by the scheduler
+    AudioSampleBuffer* graphBuffer;
+    MidiBuffer* graphMidiMessages;
+
+    double preparedSampleRate;
+    int preparedBlockSize;
+    int preparedNumChannels;
+
+    //==============================================================================
+
+    ProcessBlockProfiler profiler;
+    SilenceDetector silenceDetector;
+
+    //======================================
+
+    PluginParametersManager parameters;
+
+    PluginParameterComboBox paramStage1;
+    PluginParameterComboBox paramStage2;
+    PluginParameterComboBox paramRouting2;
+    PluginParameterComboBox paramStage3;
+    PluginParameterComboBox paramRouting3;
+    PluginParameterComboBox paramStage4;
+    PluginParameterComboBox paramRouting4;
+    PluginParameterComboBox paramStage5;
+    PluginParameterComboBox paramRouting5;
+
+    PluginBypass bypass;
+
+private:
+    //==============================================================================
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ChainAudioProcessor)
+};
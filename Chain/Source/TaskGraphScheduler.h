@@ -0,0 +1,319 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "RealtimeSafety.h"
+#include <atomic>
+
+//==============================================================================
+
+/** A directed acyclic graph of up to maxNumTasks tasks, stored in fixed arrays so
+    that it can be built and run on the audio thread without allocating.
+    A task runs once all the tasks with an edge to it have finished.
+*/
+class TaskGraph
+{
+public:
+    enum {
+        maxNumTasks = 16,
+        maxNumSuccessors = 8,
+    };
+
+    TaskGraph()
+    {
+        clear();
+    }
+
+    void clear() noexcept
+    {
+        numTasks = 0;
+    }
+
+    /** Returns the index of the new task. */
+    int addTask() noexcept
+    {
+        jassert (numTasks < maxNumTasks);
+        numPredecessors[numTasks] = 0;
+        numSuccessors[numTasks] = 0;
+        return numTasks++;
+    }
+
+    void addEdge (const int fromTask, const int toTask) noexcept
+    {
+        jassert (fromTask < toTask && numSuccessors[fromTask] < maxNumSuccessors);
+        successors[fromTask][numSuccessors[fromTask]++] = toTask;
+        ++numPredecessors[toTask];
+    }
+
+    int numTasks;
+    int numPredecessors[maxNumTasks];
+    int numSuccessors[maxNumTasks];
+    int successors[maxNumTasks][maxNumSuccessors];
+};
+
+//==============================================================================
+
+/** Fixed-capacity Chase-Lev deque of task indices. Only its owner thread pushes
+    and pops, at the bottom, while any other thread can steal from the top.
+*/
+class WorkStealingDeque
+{
+public:
+    enum {
+        capacity = TaskGraph::maxNumTasks,
+        mask = capacity - 1,
+    };
+
+    static_assert ((capacity & mask) == 0, "The capacity must be a power of two");
+
+    /** Owner only. Never holds more than TaskGraph::maxNumTasks tasks. */
+    void push (const int task) noexcept
+    {
+        const int64 b = bottom.load (std::memory_order_relaxed);
+        tasks[b & mask].store (task, std::memory_order_relaxed);
+        std::atomic_thread_fence (std::memory_order_release);
+        bottom.store (b + 1, std::memory_order_relaxed);
+    }
+
+    /** Owner only. Returns false if the deque is empty. */
+    bool pop (int& task) noexcept
+    {
+        const int64 b = bottom.load (std::memory_order_relaxed) - 1;
+        bottom.store (b, std::memory_order_relaxed);
+        std::atomic_thread_fence (std::memory_order_seq_cst);
+        int64 t = top.load (std::memory_order_relaxed);
+
+        if (t > b) {
+            bottom.store (b + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        task = tasks[b & mask].load (std::memory_order_relaxed);
+        if (t < b)
+            return true;
+
+        // The last task, which a thief may be taking at the same time
+        const bool won = top.compare_exchange_strong (t, t + 1, std::memory_order_seq_cst,
+                                                             std::memory_order_relaxed);
+        bottom.store (b + 1, std::memory_order_relaxed);
+        return won;
+    }
+
+    /** Any thread. Returns false if the deque is empty or another thread won the task. */
+    bool steal (int& task) noexcept
+    {
+        int64 t = top.load (std::memory_order_acquire);
+        std::atomic_thread_fence (std::memory_order_seq_cst);
+        const int64 b = bottom.load (std::memory_order_acquire);
+        if (t >= b)
+            return false;
+
+        task = tasks[t & mask].load (std::memory_order_relaxed);
+        return top.compare_exchange_strong (t, t + 1, std::memory_order_seq_cst,
+                                                      std::memory_order_relaxed);
+    }
+
+private:
+    // 64-bit so that they never wrap around
+    std::atomic<int64> top { 0 };
+    std::atomic<int64> bottom { 0 };
+    std::atomic<int> tasks[capacity];
+};
+
+//==============================================================================
+
+/** Runs a TaskGraph on the calling (audio) thread and a pool of worker threads, using
+    work stealing.
+
+    The calling thread is one more participant: it queues the tasks without
+    predecessors, wakes the workers and runs tasks until the whole graph has finished.
+    A participant that runs out of tasks steals from the others. The tasks that a
+    finished task makes ready go to the deque of the thread that ran it, so that a
+    chain of tasks tends to stay on one core. Running a graph does not allocate or
+    lock; waking the workers takes one WaitableEvent::signal() per worker and block.
+*/
+class TaskGraphScheduler
+{
+public:
+    enum {
+        maxNumWorkers = 7,
+    };
+
+    class TaskRunner
+    {
+    public:
+        virtual ~TaskRunner() {}
+
+        /** Called on any of the participating threads. */
+        virtual void runTask (const int task) noexcept = 0;
+    };
+
+    TaskGraphScheduler()
+    {
+    }
+
+    ~TaskGraphScheduler()
+    {
+        setNumWorkers (0);
+    }
+
+    //======================================
+
+    /** Stops the current workers and starts new ones. Not to be called while run() is
+        running, for example from prepareToPlay.
+    */
+    void setNumWorkers (const int newNumWorkers)
+    {
+        for (Worker* worker : workers)
+            worker->signalThreadShouldExit();
+        for (Worker* worker : workers)
+            worker->wake.signal();
+        workers.clear();
+
+        numParticipants = 1 + jlimit (0, (int)maxNumWorkers, newNumWorkers);
+        for (int participant = 1; participant < numParticipants; ++participant) {
+            Worker* worker = workers.add (new Worker (*this, participant));
+            worker->startThread (10);
+        }
+    }
+
+    int getNumWorkers() const noexcept
+    {
+        return numParticipants - 1;
+    }
+
+    //======================================
+
+    /** Runs every task of graph through runner and returns when all have finished.
+        The workers are only woken when wakeWorkers is true, that is, when the graph
+        has tasks that can run at the same time.
+    */
+    void run (const TaskGraph& graph, TaskRunner& runner, const bool wakeWorkers) noexcept
+    {
+        // Seen by the workers through the task they steal, see runOneTask()
+        currentGraph = &graph;
+        currentRunner = &runner;
+
+        for (int task = 0; task < graph.numTasks; ++task)
+            remainingPredecessors[task].store (graph.numPredecessors[task], std::memory_order_relaxed);
+        numPendingTasks.store (graph.numTasks, std::memory_order_release);
+
+        for (int task = graph.numTasks - 1; task >= 0; --task)
+            if (graph.numPredecessors[task] == 0)
+                deques[0].push (task);
+
+        if (wakeWorkers) {
+            // Waking the workers locks their events for a moment
+            const RealtimeSafety::ScopedExemption exemption;
+            for (Worker* worker : workers)
+                worker->wake.signal();
+        }
+
+        while (numPendingTasks.load (std::memory_order_acquire) > 0)
+            runOneTask (0);
+    }
+
+private:
+    //======================================
+
+    class Worker : public Thread
+    {
+    public:
+        Worker (TaskGraphScheduler& owner, const int participant)
+            : Thread ("Chain worker " + String (participant))
+            , owner (owner)
+            , participant (participant)
+        {
+        }
+
+        ~Worker()
+        {
+            stopThread (-1);
+        }
+
+        void run() override
+        {
+            ScopedNoDenormals noDenormals;
+
+            while (! threadShouldExit()) {
+                wake.wait (-1);
+
+                // Spins for the rest of the block, then sleeps until the next one
+                while (owner.numPendingTasks.load (std::memory_order_acquire) > 0 && ! threadShouldExit())
+                    if (! owner.runOneTask (participant))
+                        Thread::yield();
+            }
+        }
+
+        WaitableEvent wake;
+
+    private:
+        TaskGraphScheduler& owner;
+        const int participant;
+    };
+
+    //======================================
+
+    /** Returns false if there was no task to run. */
+    bool runOneTask (const int participant) noexcept
+    {
+        int task;
+        bool found = deques[participant].pop (task);
+        for (int i = 1; i < numParticipants && ! found; ++i)
+            found = deques[(participant + i) % numParticipants].steal (task);
+
+        if (! found)
+            return false;
+
+        // Written before the first task of the graph was pushed, so the pointers are
+        // current for any task taken from a deque
+        const TaskGraph& graph = *currentGraph;
+        currentRunner->runTask (task);
+
+        for (int i = 0; i < graph.numSuccessors[task]; ++i) {
+            const int successor = graph.successors[task][i];
+            if (remainingPredecessors[successor].fetch_sub (1, std::memory_order_acq_rel) == 1)
+                deques[participant].push (successor);
+        }
+
+        // Only after queueing the successors, so that the count cannot reach zero early
+        numPendingTasks.fetch_sub (1, std::memory_order_release);
+        return true;
+    }
+
+    //======================================
+
+    int numParticipants = 1;
+    OwnedArray<Worker> workers;
+    WorkStealingDeque deques[1 + maxNumWorkers];
+
+    const TaskGraph* currentGraph = nullptr;
+    TaskRunner* currentRunner = nullptr;
+    std::atomic<int> remainingPredecessors[TaskGraph::maxNumTasks];
+    std::atomic<int> numPendingTasks { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE (TaskGraphScheduler)
+};
+
+//==============================================================================
@@ -0,0 +1,538 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "MemoryFootprint.h"
+#include "ChannelWorkerPool.h"
+#include "WavetableLFO.h"
+#include "ModulatedDelayLine.h"
+
+//==============================================================================
+
+/** The audio processing of the Chorus, without the parameters, state, editor or
+    buses of the plugin, for hosts that only need the audio and run many instances.
+    ChorusAudioProcessor wraps one and hands it the values of its parameters once a
+    block, in their natural units: the delay and the width in seconds, the depth,
+    the number of voices from 2 to 5, the frequency in Hz, the indices of the
+    waveform and of the interpolation, the stereo mode as 0 or 1 and the index of
+    the ensemble mode.
+*/
+class ChorusDSP
+{
+public:
+    enum parameterIndex {
+        parameterDelay = 0,
+        parameterWidth,
+        parameterDepth,
+        parameterNumVoices,
+        parameterFrequency,
+        parameterWaveform,
+        parameterInterpolation,
+        parameterStereo,
+        parameterEnsemble,
+        numParameters,
+    };
+
+    enum ensembleIndex {
+        ensembleOff = 0,
+        ensemble16Voices,
+        ensemble24Voices,
+        ensemble32Voices,
+    };
+
+    /** Allocates the delay line of the layout, of maxDelayTime seconds. */
+    void prepare (const double newSampleRate, const int numChannels, const float maxDelayTime)
+    {
+        sampleRate = (float)newSampleRate;
+        delayLine.prepare (numChannels, (int)(maxDelayTime * sampleRate) + 1);
+
+        lfoPhase = 0.0f;
+        inverseSampleRate = 1.0f / sampleRate;
+
+        // Steps of the golden ratio spread the phases evenly over the cycle for any
+        // number of voices
+        for (int voice = 0; voice < maxNumEnsembleVoices; ++voice) {
+            const float phase = (float)voice * 0.618034f;
+            ensemblePhases[voice] = phase - std::floor (phase);
+        }
+
+        channelWorkers->prepare (numChannels);
+    }
+
+    void reset() noexcept
+    {
+        delayLine.clear();
+    }
+
+    void setParameter (const int index, const float value) noexcept
+    {
+        switch (index) {
+            case parameterDelay:         currentDelay = value; break;
+            case parameterWidth:         currentWidth = value; break;
+            case parameterDepth:         currentDepth = value; break;
+            case parameterNumVoices:     currentNumVoices = jlimit (2, 5, (int)value); break;
+            case parameterFrequency:     currentFrequency = value; break;
+            case parameterWaveform:      currentWaveform = jlimit (0, WavetableLFO::numWaveforms - 1, (int)value); break;
+            case parameterInterpolation: currentInterpolation = jlimit ((int)ModulatedDelayLine::interpolationNearestNeighbour,
+                                                                        (int)ModulatedDelayLine::interpolationSinc, (int)value); break;
+            case parameterStereo:        currentStereo = (value != 0.0f); break;
+            case parameterEnsemble:      currentEnsemble = jlimit ((int)ensembleOff, (int)ensemble32Voices, (int)value); break;
+        }
+    }
+
+    /** The steps of reduction of a quality governor, under which the taps are read
+        with a cheaper interpolation.
+    */
+    void setQualityReduction (const int newQualityReduction) noexcept
+    {
+        qualityReduction = newQualityReduction;
+    }
+
+    /** Processes numSamples samples of numChannels channels in place. */
+    void process (float* const* channels, const int numChannels, const int numSamples) noexcept;
+
+    void addMemoryFootprint (MemoryFootprint& footprint) const
+    {
+        delayLine.addMemoryFootprint (footprint);
+    }
+
+private:
+    //==============================================================================
+
+    ModulatedDelayLine delayLine;
+
+    WavetableLFO lfo;
+    float lfoPhase = 0.0f;
+    float sampleRate = 44100.0f;
+    float inverseSampleRate = 1.0f / 44100.0f;
+
+    //======================================
+
+    /** The delayed voices are processed ModulatedDelayLine::maxBlockSize samples at a
+        time, one tap of the delay line per voice. The LFO and the read positions of
+        the voices are worked out once for the whole sub-block, as they are the same on
+        every channel. Layouts with enough channels for the ChannelWorkerPool run every
+        channel through all the sub-blocks on a worker instead, with its own copy of the
+        read positions.
+    */
+    enum {
+        maxNumDelayedVoices = ModulatedDelayLine::maxNumTaps,
+        maxBlockSize = ModulatedDelayLine::maxBlockSize,
+    };
+
+    static void advanceLfo (float* phases, float& phase, const int numSamples, const float phaseIncrement);
+
+    void updateReadPositions (ModulatedDelayLine::ReadPositions& positions,
+                              const float* phases,
+                              const int writePosition,
+                              const int numSamples,
+                              const int numDelayedVoices,
+                              const float* phaseOffsets,
+                              const float delayTime,
+                              const float width,
+                              const int interpolation) const;
+
+    void processChannel (float* channelData,
+                         const int channel,
+                         const ModulatedDelayLine::ReadPositions& positions,
+                         const int writePosition,
+                         const int interpolation,
+                         const float depth,
+                         const float dryGain,
+                         const float* weights);
+
+    float lfoPhases[maxBlockSize];
+    ModulatedDelayLine::ReadPositions readPositions;
+
+    //======================================
+
+    /** The ensemble mode detunes up to maxNumEnsembleVoices voices, each with an LFO
+        of its own rate, from ensembleDetune below to ensembleDetune above the LFO
+        frequency, and its own phase. Instead of a delay per voice and sample, every
+        voice looks up the shared wavetable at the start and at the end of each
+        sub-block, and its delay goes in a straight line in between, so the read
+        position steps by a constant amount and needs no table lookups nor divisions.
+        The voices are read in the order of their delays, so that voices that read
+        nearby stretches of the history find them in the cache. Every voice is read
+        with linear interpolation.
+    */
+    enum { maxNumEnsembleVoices = 32 };
+
+    static constexpr float ensembleDetune = 0.1f;
+
+    struct EnsemblePositions
+    {
+        int numVoices = 0;
+        float readPositions[maxNumEnsembleVoices];
+        float steps[maxNumEnsembleVoices];
+        int order[maxNumEnsembleVoices];
+    };
+
+    void updateEnsemblePositions (EnsemblePositions& positions,
+                                  float* phases,
+                                  const int writePosition,
+                                  const int numSamples,
+                                  const int numVoices,
+                                  const float phaseIncrement,
+                                  const float delayTime,
+                                  const float width) const;
+
+    void processEnsembleChannel (float* channelData,
+                                 const int channel,
+                                 const EnsemblePositions& positions,
+                                 const int writePosition,
+                                 const int numSamples,
+                                 const float gain,
+                                 const float* weights);
+
+    float ensemblePhases[maxNumEnsembleVoices];
+    EnsemblePositions ensemblePositions;
+
+    SharedResourcePointer<ChannelWorkerPool> channelWorkers;
+
+    //======================================
+
+    float currentDelay = 0.03f;
+    float currentWidth = 0.02f;
+    float currentDepth = 1.0f;
+    int currentNumVoices = 2;
+    float currentFrequency = 0.2f;
+    int currentWaveform = WavetableLFO::waveformSine;
+    int currentInterpolation = ModulatedDelayLine::interpolationLinear;
+    bool currentStereo = true;
+    int currentEnsemble = ensembleOff;
+    int qualityReduction = 0;
+};
+
+//==============================================================================
+
+inline void ChorusDSP::process (float* const* channels, const int numChannels, const int numSamples) noexcept
+{
+    const int numVoices = currentNumVoices;
+    const bool stereo = currentStereo;
+
+    // Under a reduction of the quality governor the taps are read with a cheaper
+    // interpolation, from read positions that keep the lookahead of the one chosen
+    const int interpolation = currentInterpolation;
+    const int readInterpolation = ModulatedDelayLine::getReducedInterpolation (interpolation, qualityReduction);
+    const int numDelayedVoices = jmin (numVoices - 1, (int)maxNumDelayedVoices);
+
+    lfo.setWaveform (currentWaveform);
+
+    float phaseOffsets[maxNumDelayedVoices];
+    float phaseOffset = 0.0f;
+    for (int voice = 0; voice < numDelayedVoices; ++voice) {
+        phaseOffsets[voice] = phaseOffset;
+
+        if (numVoices == 3)
+            phaseOffset += 0.25f;
+        else if (numVoices > 3)
+            phaseOffset += 1.0f / (float)(numVoices - 1);
+    }
+
+    float weights[2][maxNumDelayedVoices];
+    float dryGains[2];
+    for (int channel = 0; channel < 2; ++channel) {
+        dryGains[channel] = (stereo && numVoices == 2 && channel != 0) ? 0.0f : 1.0f;
+
+        for (int voice = 0; voice < numDelayedVoices; ++voice) {
+            float weight;
+            if (stereo && numVoices > 2) {
+                weight = (float)voice / (float)(numVoices - 2);
+                if (channel != 0)
+                    weight = 1.0f - weight;
+            } else if (stereo && numVoices == 2) {
+                weight = (channel == 0) ? 0.0f : 1.0f;
+            } else {
+                weight = 1.0f;
+            }
+            weights[channel][voice] = weight;
+        }
+    }
+
+    const float phaseIncrement = currentFrequency * inverseSampleRate;
+    const int numDelayChannels = jmin (numChannels, delayLine.getNumChannels());
+    const int ensemble = currentEnsemble;
+
+    if (ensemble != ensembleOff) {
+        const int numEnsembleVoices = jmin (8 + 8 * ensemble, (int)maxNumEnsembleVoices);
+
+        float ensembleWeights[2][maxNumEnsembleVoices];
+        for (int channel = 0; channel < 2; ++channel) {
+            for (int voice = 0; voice < numEnsembleVoices; ++voice) {
+                float weight = 1.0f;
+                if (stereo) {
+                    weight = (float)voice / (float)(numEnsembleVoices - 1);
+                    if (channel != 0)
+                        weight = 1.0f - weight;
+                }
+                ensembleWeights[channel][voice] = weight;
+            }
+        }
+
+        // The voices are not correlated, so they add up in power, and the wet
+        // signal is kept at the level of four voices
+        const float ensembleGain = currentDepth * 2.0f / std::sqrt ((float)numEnsembleVoices);
+
+        if (numDelayChannels < (int)ChannelWorkerPool::minChannelsForWorkers) {
+            for (int blockStart = 0; blockStart < numSamples; blockStart += maxBlockSize) {
+                const int blockSamples = jmin ((int)maxBlockSize, numSamples - blockStart);
+                const int writePosition = delayLine.getWritePosition();
+
+                updateEnsemblePositions (ensemblePositions, ensemblePhases, writePosition, blockSamples,
+                                         numEnsembleVoices, phaseIncrement, currentDelay, currentWidth);
+
+                for (int channel = 0; channel < numDelayChannels; ++channel)
+                    processEnsembleChannel (channels[channel] + blockStart, channel, ensemblePositions,
+                                            writePosition, blockSamples, ensembleGain, ensembleWeights[channel % 2]);
+
+                delayLine.advance (blockSamples);
+            }
+        } else {
+            channelWorkers->forEachChannel (numDelayChannels, [&] (const int channel) {
+                float channelPhases[maxNumEnsembleVoices];
+                EnsemblePositions channelPositions;
+
+                std::copy (ensemblePhases, ensemblePhases + numEnsembleVoices, channelPhases);
+                int channelWritePosition = delayLine.getWritePosition();
+
+                for (int blockStart = 0; blockStart < numSamples; blockStart += maxBlockSize) {
+                    const int blockSamples = jmin ((int)maxBlockSize, numSamples - blockStart);
+
+                    updateEnsemblePositions (channelPositions, channelPhases, channelWritePosition, blockSamples,
+                                             numEnsembleVoices, phaseIncrement, currentDelay, currentWidth);
+                    processEnsembleChannel (channels[channel] + blockStart, channel, channelPositions,
+                                            channelWritePosition, blockSamples, ensembleGain, ensembleWeights[channel % 2]);
+
+                    channelWritePosition = delayLine.wrap (channelWritePosition + blockSamples);
+                }
+            });
+
+            for (int blockStart = 0; blockStart < numSamples; blockStart += maxBlockSize) {
+                const int blockSamples = jmin ((int)maxBlockSize, numSamples - blockStart);
+                updateEnsemblePositions (ensemblePositions, ensemblePhases, 0, blockSamples,
+                                         numEnsembleVoices, phaseIncrement, currentDelay, currentWidth);
+            }
+
+            delayLine.advance (numSamples);
+        }
+    } else if (numDelayChannels < (int)ChannelWorkerPool::minChannelsForWorkers) {
+        for (int blockStart = 0; blockStart < numSamples; blockStart += maxBlockSize) {
+            const int blockSamples = jmin ((int)maxBlockSize, numSamples - blockStart);
+            const int writePosition = delayLine.getWritePosition();
+
+            advanceLfo (lfoPhases, lfoPhase, blockSamples, phaseIncrement);
+            updateReadPositions (readPositions, lfoPhases, writePosition, blockSamples, numDelayedVoices,
+                                 phaseOffsets, currentDelay, currentWidth, interpolation);
+
+            for (int channel = 0; channel < numDelayChannels; ++channel) {
+                const int side = channel % 2;
+                processChannel (channels[channel] + blockStart, channel, readPositions, writePosition,
+                                readInterpolation, currentDepth, dryGains[side], weights[side]);
+            }
+
+            delayLine.advance (blockSamples);
+        }
+    } else {
+        // With many channels, every channel works out the read positions on its own
+        // worker instead of sharing them, as it would otherwise wait for them
+        channelWorkers->forEachChannel (numDelayChannels, [&] (const int channel) {
+            float channelLfoPhases[maxBlockSize];
+            ModulatedDelayLine::ReadPositions channelReadPositions;
+
+            float channelLfoPhase = lfoPhase;
+            int channelWritePosition = delayLine.getWritePosition();
+            const int side = channel % 2;
+
+            for (int blockStart = 0; blockStart < numSamples; blockStart += maxBlockSize) {
+                const int blockSamples = jmin ((int)maxBlockSize, numSamples - blockStart);
+
+                advanceLfo (channelLfoPhases, channelLfoPhase, blockSamples, phaseIncrement);
+                updateReadPositions (channelReadPositions, channelLfoPhases, channelWritePosition, blockSamples,
+                                     numDelayedVoices, phaseOffsets, currentDelay, currentWidth, interpolation);
+                processChannel (channels[channel] + blockStart, channel, channelReadPositions,
+                                channelWritePosition, readInterpolation, currentDepth, dryGains[side], weights[side]);
+
+                channelWritePosition = delayLine.wrap (channelWritePosition + blockSamples);
+            }
+        });
+
+        for (int blockStart = 0; blockStart < numSamples; blockStart += maxBlockSize) {
+            const int blockSamples = jmin ((int)maxBlockSize, numSamples - blockStart);
+            advanceLfo (lfoPhases, lfoPhase, blockSamples, phaseIncrement);
+        }
+
+        delayLine.advance (numSamples);
+    }
+}
+
+inline void ChorusDSP::advanceLfo (float* phases, float& phase, const int numSamples, const float phaseIncrement)
+{
+    for (int sample = 0; sample < numSamples; ++sample) {
+        phases[sample] = phase;
+
+        phase += phaseIncrement;
+        if (phase >= 1.0f)
+            phase -= 1.0f;
+    }
+}
+
+inline void ChorusDSP::updateReadPositions (ModulatedDelayLine::ReadPositions& positions,
+                                            const float* phases,
+                                            const int writePosition,
+                                            const int numSamples,
+                                            const int numDelayedVoices,
+                                            const float* phaseOffsets,
+                                            const float delayTime,
+                                            const float width,
+                                            const int interpolation) const
+{
+    float delays[maxBlockSize * maxNumDelayedVoices];
+
+    for (int sample = 0; sample < numSamples; ++sample) {
+        for (int voice = 0; voice < numDelayedVoices; ++voice) {
+            float phase = phases[sample] + phaseOffsets[voice];
+            if (phase >= 1.0f)
+                phase -= 1.0f;
+
+            delays[sample * numDelayedVoices + voice] = (delayTime + width * lfo.getValue (phase)) * sampleRate;
+        }
+    }
+
+    delayLine.computeReadPositions (positions, delays, numSamples, numDelayedVoices, writePosition, interpolation);
+}
+
+inline void ChorusDSP::processChannel (float* channelData,
+                                       const int channel,
+                                       const ModulatedDelayLine::ReadPositions& positions,
+                                       const int writePosition,
+                                       const int interpolation,
+                                       const float depth,
+                                       const float dryGain,
+                                       const float* weights)
+{
+    alignas (ModulatedDelayLine::Lanes::SIMDRegisterSize) float delayedVoices[maxBlockSize * maxNumDelayedVoices];
+
+    delayLine.write (channel, channelData, positions.numSamples, writePosition);
+    delayLine.read (channel, positions, delayedVoices, interpolation);
+
+    for (int sample = 0; sample < positions.numSamples; ++sample) {
+        const float* voices = delayedVoices + sample * positions.tapStride;
+
+        float mixed = dryGain * channelData[sample];
+        for (int voice = 0; voice < positions.numTaps; ++voice)
+            mixed += voices[voice] * depth * weights[voice];
+        channelData[sample] = mixed;
+    }
+}
+
+inline void ChorusDSP::updateEnsemblePositions (EnsemblePositions& positions,
+                                                float* phases,
+                                                const int writePosition,
+                                                const int numSamples,
+                                                const int numVoices,
+                                                const float phaseIncrement,
+                                                const float delayTime,
+                                                const float width) const
+{
+    const float bufferSamples = (float)delayLine.getBufferSamples();
+    const float maxDelay = bufferSamples - (float)maxBlockSize - 2.0f;
+    const float inverseNumSamples = 1.0f / (float)numSamples;
+
+    float startDelays[maxNumEnsembleVoices];
+    positions.numVoices = numVoices;
+
+    for (int voice = 0; voice < numVoices; ++voice) {
+        const float rate = 1.0f + ensembleDetune * (2.0f * (float)voice / (float)(numVoices - 1) - 1.0f);
+
+        float endPhase = phases[voice] + rate * phaseIncrement * (float)numSamples;
+        endPhase -= std::floor (endPhase);
+
+        const float startDelay = jlimit (1.0f, maxDelay, (delayTime + width * lfo.getValue (phases[voice])) * sampleRate);
+        const float endDelay = jlimit (1.0f, maxDelay, (delayTime + width * lfo.getValue (endPhase)) * sampleRate);
+
+        float readPosition = (float)writePosition - startDelay;
+        if (readPosition < 0.0f)
+            readPosition += bufferSamples;
+
+        positions.readPositions[voice] = readPosition;
+        positions.steps[voice] = 1.0f - (endDelay - startDelay) * inverseNumSamples;
+        phases[voice] = endPhase;
+
+        // Insertion sort by delay, the order hardly changes from one sub-block to the next
+        startDelays[voice] = startDelay;
+        int slot = voice;
+        for (; slot > 0 && startDelays[positions.order[slot - 1]] > startDelay; --slot)
+            positions.order[slot] = positions.order[slot - 1];
+        positions.order[slot] = voice;
+    }
+}
+
+inline void ChorusDSP::processEnsembleChannel (float* channelData,
+                                               const int channel,
+                                               const EnsemblePositions& positions,
+                                               const int writePosition,
+                                               const int numSamples,
+                                               const float gain,
+                                               const float* weights)
+{
+    const float* data = delayLine.getReadPointer (channel);
+    const int bufferSamples = delayLine.getBufferSamples();
+
+    float wetSamples[maxBlockSize];
+    FloatVectorOperations::clear (wetSamples, numSamples);
+
+    delayLine.write (channel, channelData, numSamples, writePosition);
+
+    for (int i = 0; i < positions.numVoices; ++i) {
+        const int voice = positions.order[i];
+        const float weight = weights[voice];
+        if (weight == 0.0f)
+            continue;
+
+        float readPosition = positions.readPositions[voice];
+        const float step = positions.steps[voice];
+
+        for (int sample = 0; sample < numSamples; ++sample) {
+            int index = (int)readPosition;
+            const float fraction = readPosition - (float)index;
+            if (index >= bufferSamples)
+                index -= bufferSamples;
+
+            const float sample1 = data[index];
+            const float sample2 = data[(index + 1 < bufferSamples) ? index + 1 : 0];
+            wetSamples[sample] += weight * (sample1 + fraction * (sample2 - sample1));
+
+            readPosition += step;
+            if (readPosition >= (float)bufferSamples)
+                readPosition -= (float)bufferSamples;
+        }
+    }
+
+    FloatVectorOperations::addWithMultiply (channelData, wetSamples, gain, numSamples);
+}
+
+//==============================================================================
@@ -0,0 +1,404 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <cstring>
+#include <map>
+
+#if JUCE_LINUX || JUCE_MAC
+ #include <sys/mman.h>
+#endif
+#if JUCE_MAC
+ #include <mach/vm_statistics.h>
+#endif
+
+/** Set to 0 to give every delay buffer its own heap allocation instead. */
+#ifndef AUDIO_EFFECTS_DELAY_MEMORY_ARENA
+ #define AUDIO_EFFECTS_DELAY_MEMORY_ARENA 1
+#endif
+
+//==============================================================================
+
+/** Process-wide allocator for the history of the delay lines.
+
+    Sessions with hundreds of delay based effects would otherwise scatter as many
+    large buffers over the heap. The arena carves them out of a few regions of
+    regionBytes instead, mapped on large pages where the system offers them
+    (transparent huge pages on Linux, superpages on Intel Macs), so that the
+    buffers also take fewer TLB entries. Buffers larger than a quarter of a region
+    get a region of their own, and a region is given back to the system as soon as
+    nothing uses it. Every buffer starts on a cache line.
+
+    It takes a lock, so allocate() and release() belong in prepareToPlay and in
+    deferred parameter callbacks, never on the audio thread.
+*/
+class DelayMemoryArena
+{
+public:
+    enum {
+        alignment = 64,
+        regionBytes = 2 * 1024 * 1024,
+    };
+
+    static DelayMemoryArena& getInstance()
+    {
+        static DelayMemoryArena arena;
+        return arena;
+    }
+
+    /** Cleared memory of at least numBytes, or nullptr if the system has none. */
+    void* allocate (size_t numBytes)
+    {
+        numBytes = roundUp (jmax ((size_t)1, numBytes), alignment);
+
+       #if AUDIO_EFFECTS_DELAY_MEMORY_ARENA
+        const ScopedLock lock (regionsLock);
+
+        if (numBytes > regionBytes / 4) {
+            Region region;
+            if (! allocateRegion (region, roundUp (numBytes, regionBytes)))
+                return nullptr;
+
+            region.dedicated = true;
+            regions[region.base] = region;
+            std::memset (region.base, 0, numBytes);
+            return region.base;
+        }
+
+        for (auto& entry : regions)
+            if (void* data = allocateFrom (entry.second, numBytes))
+                return data;
+
+        Region region;
+        if (! allocateRegion (region, regionBytes))
+            return nullptr;
+
+        region.freeRanges[0] = regionBytes;
+        regions[region.base] = region;
+        return allocateFrom (regions[region.base], numBytes);
+       #else
+        // One allocation each, with the offset to the start of the allocation just
+        // before the aligned data
+        char* allocation = static_cast<char*> (std::calloc (numBytes + alignment, 1));
+        if (allocation == nullptr)
+            return nullptr;
+
+        char* data = allocation + alignment - ((uintptr_t)allocation % alignment);
+        reinterpret_cast<uint8*> (data)[-1] = (uint8)(data - allocation);
+        return data;
+       #endif
+    }
+
+    /** Takes back the memory of an allocate() call of the same numBytes. */
+    void release (void* data, size_t numBytes) noexcept
+    {
+        if (data == nullptr)
+            return;
+
+        numBytes = roundUp (jmax ((size_t)1, numBytes), alignment);
+
+       #if AUDIO_EFFECTS_DELAY_MEMORY_ARENA
+        const ScopedLock lock (regionsLock);
+
+        char* const address = static_cast<char*> (data);
+        auto entry = regions.upper_bound (address);
+        jassert (entry != regions.begin());
+        --entry;
+
+        Region& region = entry->second;
+        jassert (address + numBytes <= region.base + region.numBytes);
+
+        if (! region.dedicated) {
+            // Merged with the free ranges right before and after it
+            size_t offset = (size_t)(address - region.base);
+            size_t size = numBytes;
+
+            auto next = region.freeRanges.lower_bound (offset);
+            if (next != region.freeRanges.end() && next->first == offset + size) {
+                size += next->second;
+                next = region.freeRanges.erase (next);
+            }
+            if (next != region.freeRanges.begin()) {
+                auto previous = std::prev (next);
+                if (previous->first + previous->second == offset) {
+                    offset = previous->first;
+                    size += previous->second;
+                    region.freeRanges.erase (previous);
+                }
+            }
+
+            region.freeRanges[offset] = size;
+            if (size < region.numBytes)
+                return;
+        }
+
+        releaseRegion (region);
+        regions.erase (entry);
+       #else
+        ignoreUnused (numBytes);
+        char* const address = static_cast<char*> (data);
+        std::free (address - reinterpret_cast<uint8*> (address)[-1]);
+       #endif
+    }
+
+private:
+    //======================================
+
+    DelayMemoryArena() = default;
+
+    ~DelayMemoryArena()
+    {
+        // Every buffer is gone by now, unless some plugin object was leaked
+        jassert (regions.empty());
+    }
+
+    static size_t roundUp (const size_t numBytes, const size_t multiple) noexcept
+    {
+        return (numBytes + multiple - 1) / multiple * multiple;
+    }
+
+    struct Region
+    {
+        char* base = nullptr;
+        size_t numBytes = 0;
+        void* allocation = nullptr;
+        bool mapped = false;
+        bool dedicated = false;
+
+        // Offset and size of every unused range, never adjacent to each other
+        std::map<size_t, size_t> freeRanges;
+    };
+
+    /** First fit, so that the ranges at the end of a region stay free for longer. */
+    static void* allocateFrom (Region& region, const size_t numBytes) noexcept
+    {
+        if (region.dedicated)
+            return nullptr;
+
+        for (auto range = region.freeRanges.begin(); range != region.freeRanges.end(); ++range) {
+            if (range->second >= numBytes) {
+                const size_t offset = range->first;
+                const size_t remainingBytes = range->second - numBytes;
+
+                region.freeRanges.erase (range);
+                if (remainingBytes > 0)
+                    region.freeRanges[offset + numBytes] = remainingBytes;
+
+                char* data = region.base + offset;
+                std::memset (data, 0, numBytes);
+                return data;
+            }
+        }
+
+        return nullptr;
+    }
+
+    static bool allocateRegion (Region& region, const size_t numBytes) noexcept
+    {
+        region.numBytes = numBytes;
+
+       #if JUCE_LINUX
+        // Mapped one large page longer, so that the region can start on a large
+        // page boundary, as transparent huge pages need
+        void* mapping = mmap (nullptr, numBytes + regionBytes, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapping != MAP_FAILED) {
+            char* const start = static_cast<char*> (mapping);
+            char* const base = start + (regionBytes - (uintptr_t)start % regionBytes) % regionBytes;
+            char* const end = base + numBytes;
+
+            if (base > start)
+                munmap (start, (size_t)(base - start));
+            if (start + numBytes + regionBytes > end)
+                munmap (end, (size_t)(start + numBytes + regionBytes - end));
+
+           #ifdef MADV_HUGEPAGE
+            madvise (base, numBytes, MADV_HUGEPAGE);
+           #endif
+
+            region.base = base;
+            region.mapped = true;
+            return true;
+        }
+       #elif JUCE_MAC
+        void* mapping = MAP_FAILED;
+       #ifdef VM_FLAGS_SUPERPAGE_SIZE_2MB
+        mapping = mmap (nullptr, numBytes, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, VM_FLAGS_SUPERPAGE_SIZE_2MB, 0);
+       #endif
+        if (mapping == MAP_FAILED)
+            mapping = mmap (nullptr, numBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (mapping != MAP_FAILED) {
+            region.base = static_cast<char*> (mapping);
+            region.mapped = true;
+            return true;
+        }
+       #endif
+
+        region.allocation = std::calloc (numBytes + alignment, 1);
+        if (region.allocation == nullptr)
+            return false;
+
+        char* const allocation = static_cast<char*> (region.allocation);
+        region.base = allocation + (alignment - (uintptr_t)allocation % alignment) % alignment;
+        return true;
+    }
+
+    static void releaseRegion (Region& region) noexcept
+    {
+       #if JUCE_LINUX || JUCE_MAC
+        if (region.mapped) {
+            munmap (region.base, region.numBytes);
+            return;
+        }
+       #endif
+        std::free (region.allocation);
+    }
+
+    //======================================
+
+    CriticalSection regionsLock;
+    std::map<char*, Region> regions;
+
+    JUCE_DECLARE_NON_COPYABLE (DelayMemoryArena)
+};
+
+//==============================================================================
+
+/** Channels of samples for a delay line, in memory from the DelayMemoryArena.
+    Every channel starts on a cache line. Only setSize() and free() allocate or
+    release; everything else can run on the audio thread.
+*/
+template <typename SampleType>
+class DelayBuffer
+{
+public:
+    DelayBuffer() = default;
+
+    ~DelayBuffer()
+    {
+        free();
+    }
+
+    DelayBuffer (DelayBuffer&& other) noexcept
+    {
+        swapWith (other);
+    }
+
+    DelayBuffer& operator= (DelayBuffer&& other) noexcept
+    {
+        swapWith (other);
+        return *this;
+    }
+
+    //======================================
+
+    /** Replaces the contents with silence of the new size. The memory only grows:
+        while the new size fits in what is already allocated, it is reused and only
+        the part in use is cleared, so preparing again for the same or a smaller
+        size neither allocates nor frees.
+    */
+    void setSize (const int newNumChannels, const int newNumSamples)
+    {
+        const size_t channelBytes = (size_t)jmax (0, newNumSamples) * sizeof (SampleType);
+        const size_t stride = (channelBytes + DelayMemoryArena::alignment - 1) / DelayMemoryArena::alignment
+                            * DelayMemoryArena::alignment / sizeof (SampleType);
+        const size_t newNumBytes = (size_t)jmax (0, newNumChannels) * stride * sizeof (SampleType);
+
+        if (data == nullptr || newNumBytes > capacityBytes) {
+            free();
+
+            data = static_cast<SampleType*> (DelayMemoryArena::getInstance().allocate (newNumBytes));
+            jassert (data != nullptr);
+
+            if (data == nullptr)
+                return;
+
+            capacityBytes = newNumBytes;
+        }
+
+        numBytes = newNumBytes;
+        numChannels = newNumChannels;
+        numSamples = newNumSamples;
+        channelStride = (int)stride;
+        clear();
+    }
+
+    void free() noexcept
+    {
+        DelayMemoryArena::getInstance().release (data, capacityBytes);
+
+        data = nullptr;
+        capacityBytes = 0;
+        numBytes = 0;
+        numChannels = 0;
+        numSamples = 0;
+        channelStride = 0;
+    }
+
+    void clear() noexcept
+    {
+        if (data != nullptr)
+            std::memset (data, 0, numBytes);
+    }
+
+    void swapWith (DelayBuffer& other) noexcept
+    {
+        std::swap (data, other.data);
+        std::swap (capacityBytes, other.capacityBytes);
+        std::swap (numBytes, other.numBytes);
+        std::swap (numChannels, other.numChannels);
+        std::swap (numSamples, other.numSamples);
+        std::swap (channelStride, other.channelStride);
+    }
+
+    //======================================
+
+    int getNumChannels() const noexcept { return numChannels; }
+    int getNumSamples() const noexcept { return numSamples; }
+
+    SampleType* getWritePointer (const int channel) const noexcept
+    {
+        jassert (isPositiveAndBelow (channel, numChannels));
+        return data + (size_t)channel * (size_t)channelStride;
+    }
+
+    const SampleType* getReadPointer (const int channel) const noexcept
+    {
+        return getWritePointer (channel);
+    }
+
+private:
+    SampleType* data = nullptr;
+    size_t capacityBytes = 0;   // allocated, never less than numBytes
+    size_t numBytes = 0;        // in use by numChannels channels
+    int numChannels = 0;
+    int numSamples = 0;
+    int channelStride = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (DelayBuffer)
+};
+
+//==============================================================================
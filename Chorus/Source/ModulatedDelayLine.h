@@ -0,0 +1,412 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "SincInterpolator.h"
+#include "DelayMemoryArena.h"
+#include "MemoryFootprint.h"
+
+//==============================================================================
+
+/** Circular delay line read at modulated, fractional delays, with one history per
+    channel. It is the delay line of the Chorus, the Flanger and the Vibrato.
+
+    Effects without feedback process up to maxBlockSize samples at a time: the input
+    of the block is written first, then every sample reads up to maxNumTaps taps,
+    each at its own delay behind that sample. The read positions only depend on the
+    delays, so computeReadPositions() works them out once for all the channels, and
+    read() gathers and interpolates numLanes taps per SIMD register. Effects with
+    feedback read and write one sample at a time with readSample() and writeSample().
+
+    The write position is passed to every call and only advance() moves it on, once
+    all the channels are done, so that the channels can run on different threads.
+*/
+class ModulatedDelayLine
+{
+public:
+    //==============================================================================
+
+    typedef dsp::SIMDRegister<float> Lanes;
+
+    enum interpolationIndex {
+        interpolationNearestNeighbour = 0,
+        interpolationLinear,
+        interpolationCubic,
+        interpolationSinc,
+    };
+
+    enum {
+        numLanes = (int)Lanes::SIMDNumElements,
+        maxBlockSize = 32,
+        maxNumTaps = 16,
+    };
+
+    static_assert (maxNumTaps % numLanes == 0, "The taps must fill whole SIMD registers");
+
+    /** Where every tap of a block reads, the same on every channel. The positions
+        and the output of read() hold tapStride values per sample.
+    */
+    struct ReadPositions
+    {
+        int numSamples = 0;
+        int numTaps = 0;
+        int tapStride = 1;
+
+        int indices[maxBlockSize * maxNumTaps];
+        alignas (Lanes::SIMDRegisterSize) float fractions[maxBlockSize * maxNumTaps];
+    };
+
+    //==============================================================================
+
+    /** Clears the history, with room for delays of up to maxDelaySamples with any
+        interpolation. It only allocates if the history grows, so preparing again
+        with the same settings is cheap. Not for the audio thread.
+    */
+    void prepare (const int numChannels, const int maxDelaySamples)
+    {
+        bufferSamples = jmax (1, maxDelaySamples) + maxBlockSize + 2 * SincInterpolator::numTaps;
+        maxDelay = (float)(bufferSamples - maxBlockSize - SincInterpolator::numTaps);
+
+        // Also clears it
+        buffer.setSize (numChannels, bufferSamples);
+        writePosition = 0;
+    }
+
+    void clear() noexcept
+    {
+        buffer.clear();
+        writePosition = 0;
+    }
+
+    int getNumChannels() const noexcept
+    {
+        return buffer.getNumChannels();
+    }
+
+    int getWritePosition() const noexcept
+    {
+        return writePosition;
+    }
+
+    /** The history of a channel, getBufferSamples() long. The sample written at a
+        position is at that index.
+    */
+    const float* getReadPointer (const int channel) const noexcept
+    {
+        return buffer.getReadPointer (channel);
+    }
+
+    int getBufferSamples() const noexcept
+    {
+        return bufferSamples;
+    }
+
+    void addMemoryFootprint (MemoryFootprint& footprint) const noexcept
+    {
+        footprint.add (MemoryFootprint::delayLines, buffer);
+    }
+
+    /** Moves the write position on once every channel has processed numSamples. */
+    void advance (const int numSamples) noexcept
+    {
+        writePosition = (writePosition + numSamples) % bufferSamples;
+    }
+
+    /** Wraps a position that is at most one buffer length out of range. */
+    int wrap (const int position) const noexcept
+    {
+        if (position >= bufferSamples)
+            return position - bufferSamples;
+        if (position < 0)
+            return position + bufferSamples;
+        return position;
+    }
+
+    /** Number of samples that the taps of an interpolation reach past its read
+        position. Shorter delays are raised to it, so that no tap reads a sample
+        that has not been written yet.
+    */
+    static int getLookahead (const int interpolation) noexcept
+    {
+        switch (interpolation) {
+            case interpolationLinear:
+                return 1;
+            case interpolationCubic:
+                return 2;
+            case interpolationSinc:
+                return (int)SincInterpolator::latencySamples;
+            default:
+                return 0;
+        }
+    }
+
+    /** The interpolation to use under a reduction of the QualityGovernor: one step
+        cheaper for every step of reduction, but never below linear. The read
+        positions have to keep the lookahead of the interpolation chosen, so that
+        the delays do not jump when it switches.
+    */
+    static int getReducedInterpolation (const int interpolation, const int reduction) noexcept
+    {
+        return jmax (jmin (interpolation, (int)interpolationLinear), interpolation - reduction);
+    }
+
+    /** The interpolation of offline renders, which spend more on quality: the
+        windowed sinc, unless nearest neighbour was chosen for its roughness.
+    */
+    static int getRenderInterpolation (const int interpolation) noexcept
+    {
+        return (interpolation == interpolationNearestNeighbour) ? interpolation : (int)interpolationSinc;
+    }
+
+    //==============================================================================
+
+    /** Tap t of sample s reads delays[s * numTaps + t] samples behind that sample,
+        for a block that starts at position.
+    */
+    void computeReadPositions (ReadPositions& positions,
+                               const float* delays,
+                               const int numSamples,
+                               const int numTaps,
+                               const int position,
+                               const int interpolation) const noexcept
+    {
+        jassert (numSamples <= (int)maxBlockSize && numTaps <= (int)maxNumTaps);
+
+        positions.numSamples = numSamples;
+        positions.numTaps = numTaps;
+        positions.tapStride = (numTaps == 1) ? 1 : (numTaps + numLanes - 1) / numLanes * numLanes;
+
+        const float minDelay = (float)getLookahead (interpolation);
+
+        for (int sample = 0; sample < numSamples; ++sample) {
+            const float samplePosition = (float)wrap (position + sample);
+            int* indices = positions.indices + sample * positions.tapStride;
+            float* fractions = positions.fractions + sample * positions.tapStride;
+
+            for (int tap = 0; tap < numTaps; ++tap) {
+                float readPosition = samplePosition - jlimit (minDelay, maxDelay, delays[sample * numTaps + tap]);
+                if (readPosition < 0.0f)
+                    readPosition += (float)bufferSamples;
+
+                const int index = (int)readPosition;
+                indices[tap] = (index < bufferSamples) ? index : index - bufferSamples;
+                fractions[tap] = readPosition - (float)index;
+            }
+
+            // Pads the last register with taps that read a valid sample
+            for (int tap = numTaps; tap < positions.tapStride; ++tap) {
+                indices[tap] = 0;
+                fractions[tap] = 0.0f;
+            }
+        }
+    }
+
+    /** Writes the input of a block that starts at position. */
+    void write (const int channel, const float* input, const int numSamples, const int position) noexcept
+    {
+        float* data = buffer.getWritePointer (channel);
+        const int firstSamples = jmin (numSamples, bufferSamples - position);
+
+        FloatVectorOperations::copy (data + position, input, firstSamples);
+        FloatVectorOperations::copy (data, input + firstSamples, numSamples - firstSamples);
+    }
+
+    /** Interpolates every tap of the block after it has been written. Unless there
+        is only one tap per sample, the output must be aligned to the SIMD registers.
+    */
+    void read (const int channel, const ReadPositions& positions, float* output, const int interpolation) const noexcept
+    {
+        const float* data = buffer.getReadPointer (channel);
+
+        switch (interpolation) {
+            case interpolationNearestNeighbour:
+                readTaps<interpolationNearestNeighbour> (data, positions, output);
+                break;
+            case interpolationLinear:
+                readTaps<interpolationLinear> (data, positions, output);
+                break;
+            case interpolationCubic:
+                readTaps<interpolationCubic> (data, positions, output);
+                break;
+            case interpolationSinc:
+                readTaps<interpolationSinc> (data, positions, output);
+                break;
+        }
+    }
+
+    //==============================================================================
+
+    /** One tap for the sample that is about to be written at position, so the delay
+        is at least one sample longer than the lookahead.
+    */
+    float readSample (const int channel, const int position, const float delay, const int interpolation) const noexcept
+    {
+        const float minDelay = (float)(1 + getLookahead (interpolation));
+
+        float readPosition = (float)position - jlimit (minDelay, maxDelay, delay);
+        if (readPosition < 0.0f)
+            readPosition += (float)bufferSamples;
+
+        int index = (int)readPosition;
+        const float fraction = readPosition - (float)index;
+        if (index >= bufferSamples)
+            index -= bufferSamples;
+
+        const float* data = buffer.getReadPointer (channel);
+
+        switch (interpolation) {
+            case interpolationLinear:
+                return interpolate<interpolationLinear> (data, index, fraction);
+            case interpolationCubic:
+                return interpolate<interpolationCubic> (data, index, fraction);
+            case interpolationSinc:
+                return interpolate<interpolationSinc> (data, index, fraction);
+            default:
+                return interpolate<interpolationNearestNeighbour> (data, index, fraction);
+        }
+    }
+
+    void writeSample (const int channel, const int position, const float value) noexcept
+    {
+        buffer.getWritePointer (channel)[position] = value;
+    }
+
+private:
+    //==============================================================================
+
+    template <int interpolation>
+    float interpolate (const float* data, const int index, const float fraction) const noexcept
+    {
+        switch (interpolation) {
+            case interpolationLinear: {
+                const float sample1 = data[index];
+                const float sample2 = data[(index + 1 < bufferSamples) ? index + 1 : 0];
+                return sample1 + fraction * (sample2 - sample1);
+            }
+            case interpolationCubic: {
+                const float fractionSqrt = fraction * fraction;
+                const float fractionCube = fractionSqrt * fraction;
+
+                const float sample0 = data[(index > 0) ? index - 1 : bufferSamples - 1];
+                const float sample1 = data[index];
+                const float sample2 = data[wrap (index + 1)];
+                const float sample3 = data[wrap (index + 2)];
+
+                const float a0 = - 0.5f * sample0 + 1.5f * sample1 - 1.5f * sample2 + 0.5f * sample3;
+                const float a1 = sample0 - 2.5f * sample1 + 2.0f * sample2 - 0.5f * sample3;
+                const float a2 = - 0.5f * sample0 + 0.5f * sample2;
+                const float a3 = sample1;
+                return a0 * fractionCube + a1 * fractionSqrt + a2 * fraction + a3;
+            }
+            case interpolationSinc:
+                return sincInterpolator.read (data, bufferSamples, index, fraction);
+            default:
+                return data[index];
+        }
+    }
+
+    template <int interpolation>
+    void readTaps (const float* data, const ReadPositions& positions, float* output) const noexcept
+    {
+        const int stride = positions.tapStride;
+
+        // The windowed sinc is already a dot product in SIMD registers
+        if (stride == 1 || interpolation == interpolationSinc) {
+            for (int sample = 0; sample < positions.numSamples; ++sample) {
+                for (int tap = 0; tap < positions.numTaps; ++tap) {
+                    const int i = sample * stride + tap;
+                    output[i] = interpolate<interpolation> (data, positions.indices[i], positions.fractions[i]);
+                }
+            }
+            return;
+        }
+
+        alignas (Lanes::SIMDRegisterSize) float taps[4][numLanes];
+
+        for (int sample = 0; sample < positions.numSamples; ++sample) {
+            const int* indices = positions.indices + sample * stride;
+            const float* fractions = positions.fractions + sample * stride;
+
+            for (int firstTap = 0; firstTap < positions.numTaps; firstTap += numLanes) {
+                for (int lane = 0; lane < numLanes; ++lane) {
+                    const int index = indices[firstTap + lane];
+                    switch (interpolation) {
+                        case interpolationLinear: {
+                            taps[1][lane] = data[index];
+                            taps[2][lane] = data[(index + 1 < bufferSamples) ? index + 1 : 0];
+                            break;
+                        }
+                        case interpolationCubic: {
+                            taps[0][lane] = data[(index > 0) ? index - 1 : bufferSamples - 1];
+                            taps[1][lane] = data[index];
+                            taps[2][lane] = data[wrap (index + 1)];
+                            taps[3][lane] = data[wrap (index + 2)];
+                            break;
+                        }
+                        default: {
+                            taps[1][lane] = data[index];
+                            break;
+                        }
+                    }
+                }
+
+                const Lanes sample1 = Lanes::fromRawArray (taps[1]);
+                Lanes out = sample1;
+
+                if (interpolation == interpolationLinear) {
+                    const Lanes fraction = Lanes::fromRawArray (fractions + firstTap);
+                    const Lanes sample2 = Lanes::fromRawArray (taps[2]);
+                    out = sample1 + fraction * (sample2 - sample1);
+                } else if (interpolation == interpolationCubic) {
+                    const Lanes fraction = Lanes::fromRawArray (fractions + firstTap);
+                    const Lanes fractionSqrt = fraction * fraction;
+                    const Lanes fractionCube = fractionSqrt * fraction;
+
+                    const Lanes sample0 = Lanes::fromRawArray (taps[0]);
+                    const Lanes sample2 = Lanes::fromRawArray (taps[2]);
+                    const Lanes sample3 = Lanes::fromRawArray (taps[3]);
+
+                    const Lanes a0 = sample0 * -0.5f + sample1 * 1.5f - sample2 * 1.5f + sample3 * 0.5f;
+                    const Lanes a1 = sample0 - sample1 * 2.5f + sample2 * 2.0f - sample3 * 0.5f;
+                    const Lanes a2 = sample0 * -0.5f + sample2 * 0.5f;
+                    const Lanes a3 = sample1;
+                    out = a0 * fractionCube + a1 * fractionSqrt + a2 * fraction + a3;
+                }
+
+                out.copyToRawArray (output + sample * stride + firstTap);
+            }
+        }
+    }
+
+    //==============================================================================
+
+    DelayBuffer<float> buffer;
+    int bufferSamples = 1;
+    int writePosition = 0;
+    float maxDelay = 0.0f;
+
+    SincInterpolator sincInterpolator;
+};
+
+//==============================================================================
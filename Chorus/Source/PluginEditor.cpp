@@ -102,10 +102,15 @@ ChorusAudioProcessorEditor::ChorusAudioProcessorEditor (ChorusAudioProcessor& p)
 
     editorHeight += components.size() * editorPadding;
     setSize (editorWidth, editorHeight);
+    setOpaque (true);
+    setLookAndFeel (lookAndFeel);
+    renderingContext.attachTo (*this);
 }
 
 ChorusAudioProcessorEditor::~ChorusAudioProcessorEditor()
 {
+    renderingContext.detach();
+    setLookAndFeel (nullptr);
 }
 
 //==============================================================================
@@ -24,6 +24,7 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "PluginProcessor.h"
+#include "EditorRendering.h"
 
 //==============================================================================
 
@@ -75,6 +76,11 @@ private:
     OwnedArray<ButtonAttachment> buttonAttachments;
     OwnedArray<ComboBoxAttachment> comboBoxAttachments;
 
+    //======================================
+
+    EditorRenderingContext renderingContext;
+    SharedResourcePointer<EditorLookAndFeel> lookAndFeel;
+
     //==============================================================================
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ChorusAudioProcessorEditor)
@@ -49,6 +49,8 @@ ChorusAudioProcessor::ChorusAudioProcessor():
     , paramWaveform (parameters, "LFO Waveform", waveformItemsUI, waveformSine)
     , paramInterpolation (parameters, "Interpolation", interpolationItemsUI, interpolationLinear)
     , paramStereo (parameters, "Stereo", true)
+    , paramEnsemble (parameters, "Ensemble", ensembleItemsUI, ensembleOff)
+    , bypass (*this, parameters)
 {
     parameters.apvts.state = ValueTree (Identifier (getName().removeCharacters ("- ")));
 }
@@ -61,6 +63,8 @@ ChorusAudioProcessor::~ChorusAudioProcessor()
 
 void ChorusAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
+    TRACE_INSTANCE_SCOPE ("prepareToPlay", this);
+
     const double smoothTime = 1e-3;
     paramDelay.reset (sampleRate, smoothTime);
     paramWidth.reset (sampleRate, smoothTime);
@@ -70,178 +74,69 @@ void ChorusAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock
     paramWaveform.reset (sampleRate, smoothTime);
     paramInterpolation.reset (sampleRate, smoothTime);
     paramStereo.reset (sampleRate, smoothTime);
+    paramEnsemble.reset (sampleRate, smoothTime);
 
     //======================================
 
-    float maxDelayTime = paramDelay.maxValue + paramWidth.maxValue;
-    delayBufferSamples = (int)(maxDelayTime * (float)sampleRate) + 1;
-    if (delayBufferSamples < 1)
-        delayBufferSamples = 1;
-
-    delayBufferChannels = getTotalNumInputChannels();
-    delayBuffer.setSize (delayBufferChannels, delayBufferSamples);
-    delayBuffer.clear();
+    float maxDelayTime = paramDelay.callback (paramDelay.maxValue) + paramWidth.callback (paramWidth.maxValue);
+    chorus.prepare (sampleRate, getTotalNumInputChannels(), maxDelayTime);
 
-    delayWritePosition = 0;
-    lfoPhase = 0.0f;
-    inverseSampleRate = 1.0f / (float)sampleRate;
-    twoPi = 2.0f * M_PI;
+    profiler.prepare (sampleRate);
+    silenceDetector.prepare (sampleRate);
+    bypass.prepare (sampleRate, samplesPerBlock, 0);
 }
 
 void ChorusAudioProcessor::releaseResources()
 {
 }
 
+void ChorusAudioProcessor::reset()
+{
+    chorus.reset();
+}
+
 void ChorusAudioProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
 {
+    const ProcessBlockProfiler::ScopedMeasurement measurement (profiler, buffer.getNumSamples(), isNonRealtime());
+    TRACE_INSTANCE_SCOPE ("processBlock", this);
     ScopedNoDenormals noDenormals;
 
+    parameters.applySnapshotMorph();
+
     const int numInputChannels = getTotalNumInputChannels();
     const int numOutputChannels = getTotalNumOutputChannels();
     const int numSamples = buffer.getNumSamples();
 
     //======================================
 
-    float currentDelay = paramDelay.getNextValue();
-    float currentWidth = paramWidth.getNextValue();
-    float currentDepth = paramDepth.getNextValue();
-    int numVoices = (int)paramNumVoices.getTargetValue();
-    float currentFrequency = paramFrequency.getNextValue();
-    bool stereo = (bool)paramStereo.getTargetValue();
-
-    int localWritePosition;
-    float phase;
-
-    for (int channel = 0; channel < numInputChannels; ++channel) {
-        float* channelData = buffer.getWritePointer (channel);
-        float* delayData = delayBuffer.getWritePointer (channel);
-        localWritePosition = delayWritePosition;
-        phase = lfoPhase;
-
-        for (int sample = 0; sample < numSamples; ++sample) {
-            const float in = channelData[sample];
-            float out = 0.0f;
-            float phaseOffset = 0.0f;
-            float weight;
-
-            for (int voice = 0; voice < numVoices - 1; ++voice) {
-                if (stereo && numVoices > 2) {
-                    weight = (float)voice / (float)(numVoices - 2);
-                    if (channel != 0)
-                        weight = 1.0f - weight;
-                } else {
-                    weight = 1.0f;
-                }
-
-                float localDelayTime =
-                    (currentDelay + currentWidth * lfo (phase + phaseOffset, (int)paramWaveform.getTargetValue())) * (float)getSampleRate();
-
-                float readPosition =
-                    fmodf ((float)localWritePosition - localDelayTime + (float)delayBufferSamples, delayBufferSamples);
-                int localReadPosition = floorf (readPosition);
-
-                switch ((int)paramInterpolation.getTargetValue()) {
-                    case interpolationNearestNeighbour: {
-                        float closestSample = delayData[localReadPosition % delayBufferSamples];
-                        out = closestSample;
-                        break;
-                    }
-                    case interpolationLinear: {
-                        float fraction = readPosition - (float)localReadPosition;
-                        float delayed0 = delayData[(localReadPosition + 0)];
-                        float delayed1 = delayData[(localReadPosition + 1) % delayBufferSamples];
-                        out = delayed0 + fraction * (delayed1 - delayed0);
-                        break;
-                    }
-                    case interpolationCubic: {
-                        float fraction = readPosition - (float)localReadPosition;
-                        float fractionSqrt = fraction * fraction;
-                        float fractionCube = fractionSqrt * fraction;
-
-                        float sample0 = delayData[(localReadPosition - 1 + delayBufferSamples) % delayBufferSamples];
-                        float sample1 = delayData[(localReadPosition + 0)];
-                        float sample2 = delayData[(localReadPosition + 1) % delayBufferSamples];
-                        float sample3 = delayData[(localReadPosition + 2) % delayBufferSamples];
-
-                        float a0 = - 0.5f * sample0 + 1.5f * sample1 - 1.5f * sample2 + 0.5f * sample3;
-                        float a1 = sample0 - 2.5f * sample1 + 2.0f * sample2 - 0.5f * sample3;
-                        float a2 = - 0.5f * sample0 + 0.5f * sample2;
-                        float a3 = sample1;
-                        out = a0 * fractionCube + a1 * fractionSqrt + a2 * fraction + a3;
-                        break;
-                    }
-                }
-
-                if (stereo && numVoices == 2)
-                    channelData[sample] = (channel == 0) ? in : out * currentDepth;
-                else
-                    channelData[sample] += out * currentDepth * weight;
-
-                if (numVoices == 3)
-                    phaseOffset += 0.25f;
-                else if (numVoices > 3)
-                    phaseOffset += 1.0f / (float)(numVoices - 1);
-            }
-
-            delayData[localWritePosition] = in;
-
-            if (++localWritePosition >= delayBufferSamples)
-                localWritePosition -= delayBufferSamples;
-
-            phase += currentFrequency * inverseSampleRate;
-            if (phase >= 1.0f)
-                phase -= 1.0f;
-        }
-    }
-
-    delayWritePosition = localWritePosition;
-    lfoPhase = phase;
+    if (silenceDetector.skipBlock (*this, buffer))
+        return;
+
+    if (bypass.begin (buffer))
+        return;
+
+    chorus.setParameter (ChorusDSP::parameterDelay, paramDelay.getNextValue());
+    chorus.setParameter (ChorusDSP::parameterWidth, paramWidth.getNextValue());
+    chorus.setParameter (ChorusDSP::parameterDepth, paramDepth.getNextValue());
+    chorus.setParameter (ChorusDSP::parameterNumVoices, paramNumVoices.getTargetValue());
+    chorus.setParameter (ChorusDSP::parameterFrequency, paramFrequency.getNextValue());
+    chorus.setParameter (ChorusDSP::parameterWaveform, paramWaveform.getTargetValue());
+    chorus.setParameter (ChorusDSP::parameterInterpolation, (float)getInterpolation());
+    chorus.setParameter (ChorusDSP::parameterStereo, paramStereo.getTargetValue());
+    chorus.setParameter (ChorusDSP::parameterEnsemble, paramEnsemble.getTargetValue());
+    chorus.setQualityReduction (profiler.getQualityReduction());
+    chorus.process (buffer.getArrayOfWritePointers(), numInputChannels, numSamples);
 
     //======================================
 
     for (int channel = numInputChannels; channel < numOutputChannels; ++channel)
         buffer.clear (channel, 0, numSamples);
+
+    bypass.end (buffer);
 }
 
 //==============================================================================
 
-float ChorusAudioProcessor::lfo (float phase, int waveform)
-{
-    float out = 0.0f;
-
-    switch (waveform) {
-        case waveformSine: {
-            out = 0.5f + 0.5f * sinf (twoPi * phase);
-            break;
-        }
-        case waveformTriangle: {
-            if (phase < 0.25f)
-                out = 0.5f + 2.0f * phase;
-            else if (phase < 0.75f)
-                out = 1.0f - 2.0f * (phase - 0.25f);
-            else
-                out = 2.0f * (phase - 0.75f);
-            break;
-        }
-        case waveformSawtooth: {
-            if (phase < 0.5f)
-                out = 0.5f + phase;
-            else
-                out = phase - 0.5f;
-            break;
-        }
-        case waveformInverseSawtooth: {
-            if (phase < 0.5f)
-                out = 0.5f - phase;
-            else
-                out = 1.5f - phase;
-            break;
-        }
-    }
-
-    return out;
-}
-
 //==============================================================================
 
 
@@ -253,13 +148,17 @@ float ChorusAudioProcessor::lfo (float phase, int waveform)
 
 void ChorusAudioProcessor::getStateInformation (MemoryBlock& destData)
 {
-    auto state = parameters.apvts.copyState();
-    std::unique_ptr<XmlElement> xml (state.createXml());
-    copyXmlToBinary (*xml, destData);
+    MemoryOutputStream stream (destData, false);
+    parameters.writeState (stream);
 }
 
 void ChorusAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
+    MemoryInputStream stream (data, (size_t)sizeInBytes, false);
+    if (parameters.readState (stream))
+        return;
+
+    // Sessions saved in the XML format of older versions
     std::unique_ptr<XmlElement> xmlState (getXmlFromBinary (data, sizeInBytes));
 
     if (xmlState.get() != nullptr)
@@ -288,10 +187,9 @@ bool ChorusAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) c
     ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    if (layouts.getMainOutputChannelSet() != AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != AudioChannelSet::stereo())
+    // The channels are processed independently, so any layout with at least one
+    // channel is supported, from mono to surround sets or ambisonic stems.
+    if (layouts.getMainOutputChannelSet().isDisabled())
         return false;
 
     // This checks if the input layout matches the output layout
@@ -341,7 +239,13 @@ bool ChorusAudioProcessor::isMidiEffect() const
 
 double ChorusAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // The longest delay any voice reaches
+    return paramDelay.getTargetValue() + paramWidth.getTargetValue();
+}
+
+AudioProcessorParameter* ChorusAudioProcessor::getBypassParameter() const
+{
+    return bypass.getParameter();
 }
 
 //==============================================================================
@@ -372,6 +276,21 @@ void ChorusAudioProcessor::changeProgramName (int index, const String& newName)
 
 //==============================================================================
 
+MemoryFootprint ChorusAudioProcessor::getMemoryFootprint() const
+{
+    const ScopedLock lock (parameters.deferredCallbackLock);
+
+    MemoryFootprint footprint;
+    footprint.add (MemoryFootprint::other, sizeof (*this));
+    bypass.addMemoryFootprint (footprint);
+
+    chorus.addMemoryFootprint (footprint);
+
+    return footprint;
+}
+
+//==============================================================================
+
 // This creates new instances of the plugin..
 AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
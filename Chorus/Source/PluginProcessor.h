@@ -30,10 +30,15 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "PluginParameter.h"
+#include "ProcessBlockProfiler.h"
+#include "SilenceDetector.h"
+#include "PluginBypass.h"
+#include "MemoryFootprint.h"
+#include "ChorusDSP.h"
 
 //==============================================================================
 
-class ChorusAudioProcessor : public AudioProcessor
+class ChorusAudioProcessor : public AudioProcessor, public MemoryFootprintSource
 {
 public:
     //==============================================================================
@@ -45,6 +50,7 @@ public:
 
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
+    void reset() override;
     void processBlock (AudioSampleBuffer&, MidiBuffer&) override;
 
     //==============================================================================
@@ -78,6 +84,7 @@ public:
     bool producesMidi() const override;
     bool isMidiEffect () const override;
     double getTailLengthSeconds() const override;
+    AudioProcessorParameter* getBypassParameter() const override;
 
     //==============================================================================
 
@@ -89,10 +96,7 @@ public:
 
     //==============================================================================
 
-
-
-
-
+    MemoryFootprint getMemoryFootprint() const override;
 
     //==============================================================================
 
@@ -115,27 +119,50 @@ public:
     StringArray interpolationItemsUI = {
         "None",
         "Linear",
-        "Cubic"
+        "Cubic",
+        "Windowed sinc"
     };
 
     enum interpolationIndex {
-        interpolationNearestNeighbour = 0,
-        interpolationLinear,
-        interpolationCubic,
+        interpolationNearestNeighbour = ModulatedDelayLine::interpolationNearestNeighbour,
+        interpolationLinear = ModulatedDelayLine::interpolationLinear,
+        interpolationCubic = ModulatedDelayLine::interpolationCubic,
+        interpolationSinc = ModulatedDelayLine::interpolationSinc,
     };
 
+    /** The interpolation chosen, raised to the windowed sinc in offline renders.
+        The delays keep its lookahead, as with the one chosen.
+    */
+    int getInterpolation() const noexcept
+    {
+        const int interpolation = (int)paramInterpolation.getTargetValue();
+        return isNonRealtime() ? ModulatedDelayLine::getRenderInterpolation (interpolation) : interpolation;
+    }
+
     //======================================
 
-    AudioSampleBuffer delayBuffer;
-    int delayBufferSamples;
-    int delayBufferChannels;
-    int delayWritePosition;
+    StringArray ensembleItemsUI = {
+        "Off",
+        "16 voices",
+        "24 voices",
+        "32 voices"
+    };
 
-    float lfoPhase;
-    float inverseSampleRate;
-    float twoPi;
+    enum ensembleIndex {
+        ensembleOff = ChorusDSP::ensembleOff,
+        ensemble16Voices = ChorusDSP::ensemble16Voices,
+        ensemble24Voices = ChorusDSP::ensemble24Voices,
+        ensemble32Voices = ChorusDSP::ensemble32Voices,
+    };
 
-    float lfo (float phase, int waveform);
+    //======================================
+
+    ChorusDSP chorus;
+
+    //======================================
+
+    ProcessBlockProfiler profiler;
+    SilenceDetector silenceDetector;
 
     //======================================
 
@@ -149,6 +176,9 @@ public:
     PluginParameterComboBox paramWaveform;
     PluginParameterComboBox paramInterpolation;
     PluginParameterToggle paramStereo;
+    PluginParameterComboBox paramEnsemble;
+
+    PluginBypass bypass;
 
 private:
     //==============================================================================
@@ -0,0 +1,224 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+
+/** Low frequency oscillator read from precomputed tables, with outputs between
+    0 and 1 and phases between 0 and 1.
+
+    Every waveform is sampled once into a table of tableSize points shared by all
+    the instances, and read back with linear interpolation. This is exact for the
+    piecewise linear waveforms, as their corners fall on table points, and within
+    about 1e-6 for the sine. Steps are spread over one table point, 1 / tableSize
+    of a cycle, instead of being instantaneous.
+*/
+class WavetableLFO
+{
+public:
+    //==============================================================================
+
+    enum waveformIndex {
+        waveformSine = 0,
+        waveformTriangle,
+        waveformSawtooth,
+        waveformInverseSawtooth,
+        waveformSquare,
+        waveformSquareSlopedEdges,
+        numWaveforms,
+    };
+
+    enum {
+        tableSize = 2048,
+    };
+
+    WavetableLFO()
+    {
+        // Builds the tables, if this is the first instance, outside of the audio thread
+        setWaveform (waveformSine);
+    }
+
+    //==============================================================================
+
+    void setWaveform (const int newWaveform) noexcept
+    {
+        jassert (isPositiveAndBelow (newWaveform, (int)numWaveforms));
+        table = getTables().data[newWaveform];
+    }
+
+    void setFrequency (const float frequency, const float inverseSampleRate) noexcept
+    {
+        phaseIncrement = frequency * inverseSampleRate;
+    }
+
+    void setPhase (const float newPhase) noexcept
+    {
+        phase = newPhase;
+    }
+
+    float getPhase() const noexcept
+    {
+        return phase;
+    }
+
+    //==============================================================================
+
+    /** Value of the current waveform at any phase between 0 and 1, without
+        advancing the oscillator.
+    */
+    float getValue (const float phaseToRead) const noexcept
+    {
+        const float position = phaseToRead * (float)tableSize;
+        const int index = (int)position;
+        const float fraction = position - (float)index;
+
+        // A phase rounded up to 1 reads the first point of the next cycle
+        const float* points = table + (index & (tableSize - 1));
+        return points[0] + fraction * (points[1] - points[0]);
+    }
+
+    /** Writes the next numSamples values of the oscillator and advances its phase. */
+    void fill (float* output, const int numSamples) noexcept
+    {
+        for (int sample = 0; sample < numSamples; ++sample) {
+            output[sample] = getValue (phase);
+
+            phase += phaseIncrement;
+            if (phase >= 1.0f)
+                phase -= 1.0f;
+        }
+    }
+
+    /** Same as fill(), for a stereo pair: writes numSamples frames of two values,
+        the second of every frame phaseOffset of a cycle, between 0 and 1, ahead of
+        the first. The phase of the oscillator is the one of the first value.
+    */
+    void fillStereo (float* output, const int numSamples, const float phaseOffset) noexcept
+    {
+        for (int sample = 0; sample < numSamples; ++sample) {
+            float secondPhase = phase + phaseOffset;
+            if (secondPhase >= 1.0f)
+                secondPhase -= 1.0f;
+
+            output[2 * sample] = getValue (phase);
+            output[2 * sample + 1] = getValue (secondPhase);
+
+            phase += phaseIncrement;
+            if (phase >= 1.0f)
+                phase -= 1.0f;
+        }
+    }
+
+private:
+    //==============================================================================
+
+    struct Tables
+    {
+        Tables()
+        {
+            for (int waveform = 0; waveform < numWaveforms; ++waveform) {
+                for (int point = 0; point < tableSize; ++point)
+                    data[waveform][point] = evaluate (waveform, (float)point / (float)tableSize);
+
+                // Guard point, so that the last interval wraps without a mask
+                data[waveform][tableSize] = data[waveform][0];
+            }
+        }
+
+        float data[numWaveforms][tableSize + 1];
+    };
+
+    static const Tables& getTables()
+    {
+        static const Tables tables;
+        return tables;
+    }
+
+    static float evaluate (const int waveform, const float phase)
+    {
+        float out = 0.0f;
+
+        switch (waveform) {
+            case waveformSine: {
+                out = 0.5f + 0.5f * (float)sin (2.0 * M_PI * (double)phase);
+                break;
+            }
+            case waveformTriangle: {
+                if (phase < 0.25f)
+                    out = 0.5f + 2.0f * phase;
+                else if (phase < 0.75f)
+                    out = 1.0f - 2.0f * (phase - 0.25f);
+                else
+                    out = 2.0f * (phase - 0.75f);
+                break;
+            }
+            case waveformSawtooth: {
+                if (phase < 0.5f)
+                    out = 0.5f + phase;
+                else
+                    out = phase - 0.5f;
+                break;
+            }
+            case waveformInverseSawtooth: {
+                if (phase < 0.5f)
+                    out = 0.5f - phase;
+                else
+                    out = 1.5f - phase;
+                break;
+            }
+            case waveformSquare: {
+                if (phase < 0.5f)
+                    out = 0.0f;
+                else
+                    out = 1.0f;
+                break;
+            }
+            case waveformSquareSlopedEdges: {
+                if (phase < 0.48f)
+                    out = 1.0f;
+                else if (phase < 0.5f)
+                    out = 1.0f - 50.0f * (phase - 0.48f);
+                else if (phase < 0.98f)
+                    out = 0.0f;
+                else
+                    out = 50.0f * (phase - 0.98f);
+                break;
+            }
+        }
+
+        return out;
+    }
+
+    //==============================================================================
+
+    const float* table = nullptr;
+    float phaseIncrement = 0.0f;
+    float phase = 0.0f;
+};
+
+//==============================================================================
@@ -0,0 +1,351 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "CompressorExpanderDSP.h"
+
+//==============================================================================
+
+/** Many independent single-band compressors or expanders, one per channel, each
+    with settings of its own, for hosts that put the same kind of dynamics on many
+    channels, such as a bus of 64 microphones. Separate CompressorExpanderDSP
+    objects would run one scalar detector each, whose recursion leaves most of the
+    pipeline idle.
+
+    The state of the instances is kept as a structure of arrays with one instance
+    per SIMD lane: the levels hold stride interleaved values per sample, and every
+    stage of the gain computer takes all the instances in one pass over a sub-block,
+    as the per channel stereo link of CompressorExpanderDSP does for the channels of
+    one instance. The detectors of 8 or 16 instances then cost about as much as the
+    one of a single instance.
+
+    The parameters take the indices and units of CompressorExpanderDSP, and ramp
+    over the smoothing time given to prepare(), so a batch renders what separate
+    instances with the same settings would, in floats. Only the compressor and
+    expander modes detecting on the channel itself are batched: the look-ahead
+    limiter, the bands and the sidechain stay with CompressorExpanderDSP, and the
+    other parameters are ignored. The instances exist from prepare() on, and
+    setParameter() has to be called from the thread that calls process().
+*/
+class CompressorExpanderBatch
+{
+public:
+    /** Allocates numInstances instances, which keep their settings if there were as
+        many before. Not real-time safe.
+    */
+    void prepare (const double sampleRate, const int newNumInstances, const double smoothTime)
+    {
+        if (instances.size() != newNumInstances) {
+            instances.clear();
+            for (int instance = 0; instance < newNumInstances; ++instance)
+                instances.add (new Instance());
+        }
+        numInstances = newNumInstances;
+
+        for (auto* instance : instances) {
+            instance->threshold.reset (sampleRate, smoothTime);
+            instance->ratio.reset (sampleRate, smoothTime);
+            instance->attack.reset (sampleRate, smoothTime);
+            instance->release.reset (sampleRate, smoothTime);
+            instance->makeupGain.reset (sampleRate, smoothTime);
+
+            instance->detectorCoefficients.prepare (sampleRate);
+            instance->detectorCoefficients.setTimes (instance->attack.getTargetValue(), instance->release.getTargetValue());
+        }
+
+        //======================================
+
+        // The levels and the ramps of a sub-block, then the states and the settings
+        // that only change once a sub-block, with room to align them
+        numRegisters = (jmax (1, numInstances) + numLanes - 1) / numLanes;
+        stride = numRegisters * numLanes;
+        storage.allocate ((size_t)storageSize(), false);
+
+        levels = snapPointerToAlignment (storage.get(), (size_t)Lanes::SIMDRegisterSize);
+        thresholds = levels + maxBlockSize * stride;
+        ratios = thresholds + maxBlockSize * stride;
+        makeupGains = ratios + maxBlockSize * stride;
+        inputLevels = makeupGains + maxBlockSize * stride;
+        ylPrev = inputLevels + stride;
+        alphaAttack = ylPrev + stride;
+        alphaRelease = alphaAttack + stride;
+        expanderFlags = alphaRelease + stride;
+
+        // The lanes past the last instance run a flat compressor on silence
+        FloatVectorOperations::clear (thresholds, maxBlockSize * stride);
+        FloatVectorOperations::fill (ratios, 1.0f, maxBlockSize * stride);
+        FloatVectorOperations::clear (makeupGains, maxBlockSize * stride);
+        FloatVectorOperations::clear (alphaAttack, stride);
+        FloatVectorOperations::clear (alphaRelease, stride);
+        FloatVectorOperations::clear (expanderFlags, stride);
+
+        for (int lane = 0; lane < numInstances; ++lane)
+            expanderFlags[lane] = (instances.getUnchecked (lane)->mode == CompressorExpanderDSP::modeExpander) ? 1.0f : 0.0f;
+
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        if (inputLevels == nullptr)
+            return;
+
+        FloatVectorOperations::clear (inputLevels, stride);
+        FloatVectorOperations::clear (ylPrev, stride);
+    }
+
+    /** Sets a parameter of one instance, with the index and in the units of
+        CompressorExpanderDSP::setParameter().
+    */
+    void setParameter (const int instance, const int index, const float value) noexcept
+    {
+        if (! isPositiveAndBelow (instance, numInstances))
+            return;
+
+        Instance& settings = *instances.getUnchecked (instance);
+
+        switch (index) {
+            case CompressorExpanderDSP::parameterMode:
+                settings.mode = jlimit ((int)CompressorExpanderDSP::modeCompressor, (int)CompressorExpanderDSP::modeExpander, (int)value);
+                expanderFlags[instance] = (settings.mode == CompressorExpanderDSP::modeExpander) ? 1.0f : 0.0f;
+                break;
+            case CompressorExpanderDSP::parameterThreshold:  settings.threshold.setTargetValue (value); break;
+            case CompressorExpanderDSP::parameterRatio:      settings.ratio.setTargetValue (value); break;
+            case CompressorExpanderDSP::parameterAttack:     settings.attack.setTargetValue (value); break;
+            case CompressorExpanderDSP::parameterRelease:    settings.release.setTargetValue (value); break;
+            case CompressorExpanderDSP::parameterMakeupGain: settings.makeupGain.setTargetValue (value); break;
+        }
+    }
+
+    /** Processes numSamples samples of the numInstances channels in place, the
+        channel of every instance at its index.
+    */
+    void process (float* const* channels, const int numSamples) noexcept;
+
+    int getNumInstances() const noexcept
+    {
+        return numInstances;
+    }
+
+    /** The gain reduction of an instance in dB, as its detector left it. */
+    float getGainReduction (const int instance) const noexcept
+    {
+        return isPositiveAndBelow (instance, numInstances) ? ylPrev[instance] : 0.0f;
+    }
+
+    void addMemoryFootprint (MemoryFootprint& footprint) const
+    {
+        if (storage != nullptr)
+            footprint.add (MemoryFootprint::filters, sizeof (float) * (size_t)storageSize());
+        footprint.add (MemoryFootprint::other, sizeof (Instance) * (size_t)instances.size());
+    }
+
+private:
+    //==============================================================================
+
+    enum { maxBlockSize = 64 };
+
+    typedef dsp::SIMDRegister<float> Lanes;
+
+    enum { numLanes = (int)Lanes::SIMDNumElements };
+
+    int storageSize() const noexcept
+    {
+        return (4 * maxBlockSize + 5) * stride + numLanes;
+    }
+
+    struct Instance
+    {
+        LinearSmoothedValue<float> threshold { -24.0f };
+        LinearSmoothedValue<float> ratio { 50.0f };
+        LinearSmoothedValue<float> attack { 2.0e-3f };
+        LinearSmoothedValue<float> release { 0.3f };
+        LinearSmoothedValue<float> makeupGain { 0.0f };
+
+        EnvelopeFollower::Coefficients detectorCoefficients;
+        int mode = CompressorExpanderDSP::modeExpander;
+    };
+
+    OwnedArray<Instance> instances;
+
+    /** Steps the ramps of every instance through a sub-block. While none of the
+        threshold, ratio and makeup gain ramps moves, only their first row is
+        filled, and settingsStride is 0 so that every sample reads it.
+    */
+    void fillSettings (const int numSamples) noexcept;
+
+    static void fillLane (LinearSmoothedValue<float>& value, float* lane, const int laneStride, const int numSamples) noexcept
+    {
+        if (laneStride == 0) {
+            lane[0] = value.getTargetValue();
+            return;
+        }
+
+        for (int sample = 0; sample < numSamples; ++sample)
+            lane[sample * laneStride] = value.getNextValue();
+    }
+
+    static float getTimeAtEnd (LinearSmoothedValue<float>& value, const int numSamples) noexcept
+    {
+        float time = value.getTargetValue();
+        if (value.isSmoothing())
+            for (int sample = 0; sample < numSamples; ++sample)
+                time = value.getNextValue();
+
+        return time;
+    }
+
+    // Aligned to the SIMD registers inside storage
+    HeapBlock<float> storage;
+    float* levels = nullptr;
+    float* thresholds = nullptr;
+    float* ratios = nullptr;
+    float* makeupGains = nullptr;
+    float* inputLevels = nullptr;
+    float* ylPrev = nullptr;
+    float* alphaAttack = nullptr;
+    float* alphaRelease = nullptr;
+    float* expanderFlags = nullptr;
+
+    int numInstances = 0;
+    int numRegisters = 0;
+    int stride = 0;
+    int settingsStride = 0;
+};
+
+//==============================================================================
+
+inline void CompressorExpanderBatch::fillSettings (const int numSamples) noexcept
+{
+    bool smoothing = false;
+    for (auto* instance : instances)
+        smoothing = smoothing || instance->threshold.isSmoothing() || instance->ratio.isSmoothing()
+                              || instance->makeupGain.isSmoothing();
+    settingsStride = smoothing ? stride : 0;
+
+    for (int lane = 0; lane < numInstances; ++lane) {
+        Instance& instance = *instances.getUnchecked (lane);
+
+        fillLane (instance.threshold, thresholds + lane, settingsStride, numSamples);
+        fillLane (instance.ratio, ratios + lane, settingsStride, numSamples);
+        fillLane (instance.makeupGain, makeupGains + lane, settingsStride, numSamples);
+
+        // The detector takes the times at the end of the sub-block, as
+        // CompressorExpanderDSP does
+        const float attackTime = getTimeAtEnd (instance.attack, numSamples);
+        const float releaseTime = getTimeAtEnd (instance.release, numSamples);
+        instance.detectorCoefficients.setTimes (attackTime, releaseTime);
+        alphaAttack[lane] = instance.detectorCoefficients.getAttack();
+        alphaRelease[lane] = instance.detectorCoefficients.getRelease();
+    }
+}
+
+inline void CompressorExpanderBatch::process (float* const* channels, const int numSamples) noexcept
+{
+    if (numInstances == 0)
+        return;
+
+    const Lanes one = Lanes::expand (1.0f);
+    const Lanes averageFactor = Lanes::expand (0.9999f);
+
+    for (int blockStart = 0; blockStart < numSamples; blockStart += maxBlockSize) {
+        const int blockSamples = jmin ((int)maxBlockSize, numSamples - blockStart);
+        const int numLevels = blockSamples * stride;
+
+        fillSettings (blockSamples);
+
+        // Squared level of the channel of every instance, the lanes past the last
+        // instance stay silent
+        FloatVectorOperations::clear (levels, numLevels);
+        for (int lane = 0; lane < numInstances; ++lane) {
+            const float* channelData = channels[lane] + blockStart;
+            for (int sample = 0; sample < blockSamples; ++sample)
+                levels[sample * stride + lane] = channelData[sample] * channelData[sample];
+        }
+
+        // The expanders average the level, the compressors take it as it is. The
+        // lanes are selected bit by bit, so each one gets exactly its own value.
+        for (int sample = 0; sample < blockSamples; ++sample) {
+            for (int group = 0; group < numRegisters; ++group) {
+                float* lanes = levels + sample * stride + group * numLanes;
+                float* state = inputLevels + group * numLanes;
+                const Lanes::vMaskType expander = Lanes::equal (Lanes::fromRawArray (expanderFlags + group * numLanes), one);
+
+                const Lanes level = Lanes::fromRawArray (lanes);
+                const Lanes averaged = averageFactor * Lanes::fromRawArray (state) + (one - averageFactor) * level;
+                const Lanes inputLevel = (averaged & expander) + (level & ~expander);
+
+                inputLevel.copyToRawArray (state);
+                inputLevel.copyToRawArray (lanes);
+            }
+        }
+
+        // Static curve, in every lane with the settings of its instance
+        for (int sample = 0; sample < blockSamples; ++sample) {
+            float* sampleLevels = levels + sample * stride;
+            const float* sampleThresholds = thresholds + sample * settingsStride;
+            const float* sampleRatios = ratios + sample * settingsStride;
+
+            for (int lane = 0; lane < stride; ++lane)
+                sampleLevels[lane] = CompressorExpanderDSP::getCurveLevel (sampleLevels[lane], sampleThresholds[lane], sampleRatios[lane],
+                                                                            expanderFlags[lane] != 0.0f);
+        }
+
+        // Level detector, which attacks while the gain reduction of a compressor
+        // rises, or while the one of an expander falls
+        for (int sample = 0; sample < blockSamples; ++sample) {
+            const float* sampleMakeupGains = makeupGains + sample * settingsStride;
+
+            for (int group = 0; group < numRegisters; ++group) {
+                float* lanes = levels + sample * stride + group * numLanes;
+                float* state = ylPrev + group * numLanes;
+                const Lanes::vMaskType expander = Lanes::equal (Lanes::fromRawArray (expanderFlags + group * numLanes), one);
+
+                const Lanes xl = Lanes::fromRawArray (lanes);
+                const Lanes ylPrevious = Lanes::fromRawArray (state);
+                const Lanes::vMaskType attack = Lanes::greaterThan (xl, ylPrevious) ^ expander;
+                const Lanes alpha = (Lanes::fromRawArray (alphaAttack + group * numLanes) & attack)
+                                  + (Lanes::fromRawArray (alphaRelease + group * numLanes) & ~attack);
+                const Lanes yl = alpha * ylPrevious + (one - alpha) * xl;
+
+                yl.copyToRawArray (state);
+                (Lanes::fromRawArray (sampleMakeupGains + group * numLanes) - yl).copyToRawArray (lanes);
+            }
+        }
+
+        // 10^(dB / 20) == 2^(dB * log2 (10) / 20)
+        for (int i = 0; i < numLevels; ++i)
+            levels[i] = FastMath::exp2 (levels[i] * 0.166096405f);
+
+        for (int lane = 0; lane < numInstances; ++lane) {
+            float* channelData = channels[lane] + blockStart;
+            for (int sample = 0; sample < blockSamples; ++sample)
+                channelData[sample] *= levels[sample * stride + lane];
+        }
+    }
+}
+
+//==============================================================================
@@ -0,0 +1,902 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+
+
+#pragma once
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "MemoryFootprint.h"
+#include "MeteringFifo.h"
+#include "GainReductionTelemetry.h"
+#include "FastMath.h"
+#include "FixedPoint.h"
+#include "EnvelopeFollower.h"
+#include "SlidingWindowMaximum.h"
+#include "LinkwitzRileyCrossover.h"
+#include <atomic>
+
+//==============================================================================
+
+/** The audio processing of the Compressor-Expander, without the parameters,
+    state, editor or buses of the plugin, for hosts that only need the audio and
+    run many instances. CompressorExpanderAudioProcessor wraps one and hands it the
+    values of its parameters once a block, in their natural units: the index of
+    the mode, the threshold in dB, the ratio, the attack and release times in
+    seconds, the makeup gain in dB, the look-ahead in seconds, the number of bands
+    from 1 to 5, the crossover frequencies in Hz and the index of the stereo link.
+    The threshold, ratio, times and makeup gain ramp over the smoothing time given
+    to prepare(). The look-ahead can be set from any thread, as the latency that
+    it sets is reported by the caller.
+*/
+class CompressorExpanderDSP
+{
+public:
+    enum parameterIndex {
+        parameterMode = 0,
+        parameterThreshold,
+        parameterRatio,
+        parameterAttack,
+        parameterRelease,
+        parameterMakeupGain,
+        parameterLookahead,
+        parameterBands,
+        parameterCrossover1,
+        parameterCrossover2,
+        parameterCrossover3,
+        parameterCrossover4,
+        parameterStereoLink,
+        numParameters,
+    };
+
+    enum modeIndex {
+        modeCompressor = 0,
+        modeExpander,
+        modeLookaheadLimiter,
+    };
+
+    enum stereoLinkIndex {
+        stereoLinkSummed = 0,
+        stereoLinkMaximum,
+        stereoLinkPerChannel,
+    };
+
+    static constexpr float maxLookaheadTime = 10.0e-3f;
+
+    /** Allocates the states of numChannels channels of the main input and of
+        numSidechainChannels of the sidechain, and the delay line of the limiter in
+        the precision that process() will be called with.
+    */
+    void prepare (const double newSampleRate, const int numChannels, const int numSidechainChannels,
+                  const bool doublePrecision, const double smoothTime)
+    {
+        sampleRate = newSampleRate;
+        numTotalChannels = numChannels + numSidechainChannels;
+
+        smoothedThreshold.reset (sampleRate, smoothTime);
+        smoothedRatio.reset (sampleRate, smoothTime);
+        smoothedAttack.reset (sampleRate, smoothTime);
+        smoothedRelease.reset (sampleRate, smoothTime);
+        smoothedMakeupGain.reset (sampleRate, smoothTime);
+
+        //======================================
+
+        // The levels of a sub-block, then the input levels and the detector states,
+        // with room to align them
+        const int numChannelRegisters = (jmax (1, numChannels) + numBandLanes - 1) / numBandLanes;
+        channelStride = numChannelRegisters * numBandLanes;
+        channelStorage.allocate ((size_t)((maxBlockSize + 2) * channelStride + numBandLanes), false);
+        channelLevels = snapPointerToAlignment (channelStorage.get(), (size_t)BandLanes::SIMDRegisterSize);
+        channelInputLevels = channelLevels + maxBlockSize * channelStride;
+        channelYlPrev = channelInputLevels + channelStride;
+        resetChannels();
+
+        detectorCoefficients.prepare (sampleRate);
+        detectorCoefficients.setTimes (smoothedAttack.getTargetValue(), smoothedRelease.getTargetValue());
+
+        //======================================
+
+        const int maxLookaheadSamples = (int)std::ceil (maxLookaheadTime * sampleRate);
+        const int limiterBufferSamples = nextPowerOfTwo (maxLookaheadSamples + 1);
+        if (doublePrecision) {
+            doubleLimiterBuffer.setSize (numTotalChannels, limiterBufferSamples);
+            limiterBuffer.setSize (0, 0);
+        } else {
+            limiterBuffer.setSize (numTotalChannels, limiterBufferSamples);
+            doubleLimiterBuffer.setSize (0, 0);
+        }
+        limiterBufferMask = limiterBufferSamples - 1;
+
+        peakWindow.prepare (maxLookaheadSamples + 1);
+        averageGains.allocate ((size_t)maxLookaheadSamples + 1, false);
+        resetLimiter (getLookaheadSamples (sampleRate));
+
+        crossover.prepare (numTotalChannels);
+        bandSignals.allocate ((size_t)(jmax (1, numTotalChannels) * LinkwitzRileyCrossover::maxNumBands * maxBlockSize), true);
+        resetBands();
+    }
+
+    void reset() noexcept
+    {
+        detectorInputLevel = 0.0;
+        detector.reset();
+        resetChannels();
+
+        if (averageGains != nullptr)
+            resetLimiter (limiterLookahead);
+
+        resetBands();
+    }
+
+    void setParameter (const int index, const float value) noexcept
+    {
+        switch (index) {
+            case parameterMode:         currentMode = jlimit ((int)modeCompressor, (int)modeLookaheadLimiter, (int)value); break;
+            case parameterThreshold:    smoothedThreshold.setTargetValue (value); break;
+            case parameterRatio:        smoothedRatio.setTargetValue (value); break;
+            case parameterAttack:       smoothedAttack.setTargetValue (value); break;
+            case parameterRelease:      smoothedRelease.setTargetValue (value); break;
+            case parameterMakeupGain:   smoothedMakeupGain.setTargetValue (value); break;
+            case parameterLookahead:    lookaheadTime = value; break;
+            case parameterBands:        currentNumBands = jlimit (1, (int)LinkwitzRileyCrossover::maxNumBands, (int)value); break;
+            case parameterCrossover1:   crossoverFrequencies[0] = value; break;
+            case parameterCrossover2:   crossoverFrequencies[1] = value; break;
+            case parameterCrossover3:   crossoverFrequencies[2] = value; break;
+            case parameterCrossover4:   crossoverFrequencies[3] = value; break;
+            case parameterStereoLink:   currentStereoLink = jlimit ((int)stereoLinkSummed, (int)stereoLinkPerChannel, (int)value); break;
+        }
+    }
+
+    /** The delay of the look-ahead limiter, in samples at atSampleRate. */
+    int getLookaheadSamples (const double atSampleRate) const noexcept;
+
+    /** Processes numSamples samples of the numInputChannels channels of the main
+        input in place, in either precision. The detector and the gains follow the processing precision, while
+        the static curve is computed in floats.
+
+        The detector reads the key, in numKeyChannels channels from keyChannel on:
+        the sidechain after the main input, or the main input itself. The key is
+        never copied or mixed down. Its channels are summed, or the maximum of them
+        taken, or each one drives the channel with the same index. The gain
+        reduction of the block goes into levels, and when blockTelemetry is not
+        null, the gain reduction and detector level of every sub-block go into it.
+    */
+    template <typename SampleType>
+    void process (SampleType* const* channels, const int numInputChannels, const int keyChannel, const int numKeyChannels,
+                  const int numSamples, LevelFrame& levels, GainReductionTelemetry::Accumulator* blockTelemetry) noexcept;
+
+    /** The same, with the main input as the key and without the meters. */
+    template <typename SampleType>
+    void process (SampleType* const* channels, const int numChannels, const int numSamples) noexcept
+    {
+        LevelFrame levels;
+        process (channels, numChannels, 0, numChannels, numSamples, levels, nullptr);
+    }
+
+    void addMemoryFootprint (MemoryFootprint& footprint) const
+    {
+        footprint.add (MemoryFootprint::delayLines, limiterBuffer);
+        footprint.add (MemoryFootprint::delayLines, doubleLimiterBuffer);
+        if (averageGains != nullptr)
+            footprint.add (MemoryFootprint::delayLines, sizeof (double) * (size_t)((int)std::ceil (maxLookaheadTime * sampleRate) + 1));
+
+        if (bandSignals != nullptr)
+            footprint.add (MemoryFootprint::filters, sizeof (double) * (size_t)(jmax (1, numTotalChannels)
+                                                                                * LinkwitzRileyCrossover::maxNumBands * maxBlockSize));
+        if (channelStorage != nullptr)
+            footprint.add (MemoryFootprint::filters, sizeof (float) * (size_t)((maxBlockSize + 2) * channelStride + numBandLanes));
+    }
+
+private:
+    //==============================================================================
+
+    // Runs the gain computer of many instances with the same static curve
+    friend class CompressorExpanderBatch;
+
+    /** The gain computer runs maxBlockSize samples at a time, one stage after the
+        other over the whole sub-block, and the resulting gains are applied to every
+        channel with a single vector multiply.
+    */
+    enum { maxBlockSize = 64 };
+
+    /** Squared level of numKeyChannels channels of the key, their mean or their
+        maximum.
+    */
+    template <typename SampleType>
+    static void fillKeyLevels (const AudioBuffer<SampleType>& buffer, const int keyChannel, const int numKeyChannels,
+                               const bool maximum, const int blockStart, const int blockSamples, SampleType* keyLevels) noexcept;
+
+    /** Fills ramp with the next numSamples values of a smoothed parameter, or with
+        its target when it is not smoothing.
+    */
+    static void fillNextValues (LinearSmoothedValue<float>& value, float* ramp, const int numSamples) noexcept
+    {
+        if (! value.isSmoothing()) {
+            FloatVectorOperations::fill (ramp, value.getTargetValue(), numSamples);
+            return;
+        }
+
+        for (int sample = 0; sample < numSamples; ++sample)
+            ramp[sample] = value.getNextValue();
+    }
+
+    float thresholds[maxBlockSize];
+    float ratios[maxBlockSize];
+    float attackTimes[maxBlockSize];
+    float releaseTimes[maxBlockSize];
+    float makeupGains[maxBlockSize];
+
+    // Of the summed or maximum key, kept as a double, which holds the float state
+    // exactly, for either precision
+    double detectorInputLevel = 0.0;
+    EnvelopeFollower detector;
+
+    /** Steps the attack and release times through a sub-block, and updates the
+        detector coefficients to the times at its end.
+    */
+    void updateDetectorTimes (const int numSamples) noexcept;
+    EnvelopeFollower::Coefficients detectorCoefficients;
+
+    /** Level in dB above (compressor) or below (expander) the static curve, for a
+        mean squared input level.
+    */
+    static float getCurveLevel (const float level, const float threshold, const float ratio, const bool expander) noexcept;
+
+    /** Mean squared level in dB, down to -60 dB. */
+    static float getLevelDecibels (const float level) noexcept;
+
+    /** samples *= gains, in fixed point in the builds with AUDIO_EFFECTS_FIXED_POINT.
+        Doubles always stay in floating point.
+    */
+    static void applyGains (float* samples, const float* gains, const int numSamples) noexcept;
+    static void applyGains (double* samples, const double* gains, const int numSamples) noexcept;
+
+    //======================================
+
+    /** Splits the input with the crossover and compresses every band on its own,
+        with the settings shared by all of them. The gain computers of all the bands
+        run side by side in SIMD lanes, in floats for both precisions: the levels
+        hold bandStride interleaved values per sample, so every stage takes the
+        bands together in one pass over the sub-block. The key is split into bands
+        too, and the per channel stereo link takes the maximum of its channels.
+    */
+    template <typename SampleType>
+    void processMultiband (AudioBuffer<SampleType>& buffer, const int numInputChannels, LevelFrame& levels,
+                           const bool expander, const int keyChannel, const int numKeyChannels, const bool maximum);
+
+    void updateCrossovers (const int numBands) noexcept;
+    void resetBands() noexcept;
+
+    typedef dsp::SIMDRegister<float> BandLanes;
+
+    enum {
+        numBandLanes = (int)BandLanes::SIMDNumElements,
+        numBandRegisters = ((int)LinkwitzRileyCrossover::maxNumBands + numBandLanes - 1) / numBandLanes,
+        bandStride = numBandRegisters * numBandLanes,
+    };
+
+    LinkwitzRileyCrossover crossover;
+    HeapBlock<double> bandSignals;
+    alignas (BandLanes::SIMDRegisterSize) float bandLevels[maxBlockSize * bandStride];
+    BandLanes bandInputLevels[numBandRegisters];
+    BandLanes bandYlPrev[numBandRegisters];
+
+    //======================================
+
+    /** With the per channel stereo link, every channel has its own gain computer,
+        and all of them run side by side in SIMD lanes, one channel per lane, as the
+        bands do. The levels hold channelStride interleaved values per sample, so
+        that the detectors of many channels cost about as much as the one of the
+        summed key, whose recursion leaves most of the pipeline idle. The states are
+        floats for both precisions.
+    */
+    template <typename SampleType>
+    void processPerChannel (AudioBuffer<SampleType>& buffer, const int numInputChannels, LevelFrame& levels,
+                            const bool expander, const int keyChannel, const int numKeyChannels);
+
+    void resetChannels() noexcept;
+
+    // Aligned to the SIMD registers inside channelStorage
+    HeapBlock<float> channelStorage;
+    float* channelLevels = nullptr;
+    float* channelInputLevels = nullptr;
+    float* channelYlPrev = nullptr;
+    int channelStride = 0;
+
+    //======================================
+
+    /** Brickwall limiter that delays the audio by the look-ahead, so that the gain is
+        already down when a peak gets to the output. It always detects on its own
+        input, the maximum of all its channels. The peak detector holds the
+        largest peak of a window one sample longer than the look-ahead, the release
+        smooths the gain on its way back up, and a moving average of the same length
+        as the window ramps it down. Every sample of the average is at most the gain
+        that the peak leaving the delay needs, so the threshold is never exceeded.
+    */
+    template <typename SampleType>
+    void processLimiter (AudioBuffer<SampleType>& buffer, const int numInputChannels, LevelFrame& levels);
+
+    template <typename SampleType>
+    AudioBuffer<SampleType>& getLimiterBuffer() noexcept;
+
+    void resetLimiter (const int lookaheadSamples) noexcept;
+
+    std::atomic<float> lookaheadTime { 5.0e-3f };
+
+    AudioBuffer<float> limiterBuffer;
+    AudioBuffer<double> doubleLimiterBuffer;
+    int limiterBufferMask = 0;
+    int limiterWritePosition = 0;
+    int limiterLookahead = 0;
+
+    SlidingWindowMaximum peakWindow;
+    HeapBlock<double> averageGains;
+    double averageGainSum = 0.0;
+    int averagePosition = 0;
+    double limiterGain = 1.0;
+
+    //======================================
+
+    double sampleRate = 44100.0;
+
+    // Of the main input and the sidechain
+    int numTotalChannels = 0;
+
+    LinearSmoothedValue<float> smoothedThreshold { -24.0f };
+    LinearSmoothedValue<float> smoothedRatio { 50.0f };
+    LinearSmoothedValue<float> smoothedAttack { 2.0e-3f };
+    LinearSmoothedValue<float> smoothedRelease { 0.3f };
+    LinearSmoothedValue<float> smoothedMakeupGain { 0.0f };
+
+    int currentMode = modeExpander;
+    int currentNumBands = 1;
+    float crossoverFrequencies[LinkwitzRileyCrossover::maxNumCrossovers] = { 120.0f, 600.0f, 2500.0f, 7000.0f };
+    int currentStereoLink = stereoLinkSummed;
+
+    // Where the sub-blocks of the current process() call add their statistics
+    GainReductionTelemetry::Accumulator* telemetry = nullptr;
+};
+
+//==============================================================================
+
+template <>
+inline AudioBuffer<float>& CompressorExpanderDSP::getLimiterBuffer<float>() noexcept
+{
+    return limiterBuffer;
+}
+
+template <>
+inline AudioBuffer<double>& CompressorExpanderDSP::getLimiterBuffer<double>() noexcept
+{
+    return doubleLimiterBuffer;
+}
+
+template <typename SampleType>
+void CompressorExpanderDSP::process (SampleType* const* channels, const int numInputChannels, const int keyChannel, const int numKeyChannels,
+                                     const int numSamples, LevelFrame& levels, GainReductionTelemetry::Accumulator* blockTelemetry) noexcept
+{
+    AudioBuffer<SampleType> buffer (channels, jmax (numInputChannels, keyChannel + numKeyChannels), numSamples);
+    telemetry = blockTelemetry;
+
+    const int mode = currentMode;
+    const int stereoLink = currentStereoLink;
+
+    updateCrossovers ((mode == modeLookaheadLimiter) ? 1 : currentNumBands);
+
+    if (mode == modeLookaheadLimiter) {
+        processLimiter (buffer, numInputChannels, levels);
+    } else if (crossover.getNumBands() > 1) {
+        processMultiband (buffer, numInputChannels, levels, mode == modeExpander, keyChannel, numKeyChannels, stereoLink != stereoLinkSummed);
+    } else if (stereoLink == stereoLinkPerChannel) {
+        processPerChannel (buffer, numInputChannels, levels, mode == modeExpander, keyChannel, numKeyChannels);
+    } else {
+        const bool expander = (mode == modeExpander);
+
+        SampleType inputLevels[maxBlockSize];
+        SampleType gains[maxBlockSize];
+
+        for (int blockStart = 0; blockStart < numSamples; blockStart += maxBlockSize) {
+            const int blockSamples = jmin ((int)maxBlockSize, numSamples - blockStart);
+
+            fillNextValues (smoothedThreshold, thresholds, blockSamples);
+            fillNextValues (smoothedRatio, ratios, blockSamples);
+            fillNextValues (smoothedMakeupGain, makeupGains, blockSamples);
+            updateDetectorTimes (blockSamples);
+
+            SampleType localInputLevel = (SampleType)detectorInputLevel;
+            fillKeyLevels (buffer, keyChannel, numKeyChannels, stereoLink == stereoLinkMaximum, blockStart, blockSamples, inputLevels);
+
+            if (expander) {
+                const SampleType averageFactor = (SampleType)0.9999;
+                for (int sample = 0; sample < blockSamples; ++sample) {
+                    localInputLevel = averageFactor * localInputLevel + ((SampleType)1 - averageFactor) * inputLevels[sample];
+                    inputLevels[sample] = localInputLevel;
+                }
+            } else {
+                localInputLevel = inputLevels[blockSamples - 1];
+            }
+
+            // Static curve: level above (compressor) or below (expander) the curve, in dB
+            for (int sample = 0; sample < blockSamples; ++sample)
+                gains[sample] = (SampleType)getCurveLevel ((float)inputLevels[sample], thresholds[sample], ratios[sample], expander);
+
+            // Level detector, which attacks while the gain reduction of the compressor
+            // rises, or while the one of the expander falls
+            detector.process (detectorCoefficients, gains, gains, blockSamples, expander);
+            for (int sample = 0; sample < blockSamples; ++sample)
+                gains[sample] = makeupGains[sample] - gains[sample];
+
+            // Sampled once per sub-block, which is plenty for a meter
+            levels.gainReduction = jmax (levels.gainReduction, (float)detector.getEnvelope());
+            if (telemetry != nullptr)
+                telemetry->add ((float)detector.getEnvelope(), getLevelDecibels ((float)localInputLevel));
+
+            // 10^(dB / 20) == 2^(dB * log2 (10) / 20)
+            for (int sample = 0; sample < blockSamples; ++sample)
+                gains[sample] = (SampleType)FastMath::exp2 ((float)gains[sample] * 0.166096405f);
+
+            for (int channel = 0; channel < numInputChannels; ++channel)
+                applyGains (buffer.getWritePointer (channel, blockStart), gains, blockSamples);
+
+            detectorInputLevel = (double)localInputLevel;
+        }
+    }
+
+    // The limiter starts again from silence the next time it is selected
+    if (mode != modeLookaheadLimiter)
+        limiterLookahead = 0;
+
+    telemetry = nullptr;
+}
+
+inline void CompressorExpanderDSP::updateDetectorTimes (const int numSamples) noexcept
+{
+    fillNextValues (smoothedAttack, attackTimes, numSamples);
+    fillNextValues (smoothedRelease, releaseTimes, numSamples);
+    detectorCoefficients.setTimes (attackTimes[numSamples - 1], releaseTimes[numSamples - 1]);
+}
+
+inline float CompressorExpanderDSP::getCurveLevel (const float level, const float threshold, const float ratio, const bool expander) noexcept
+{
+    const float xg = getLevelDecibels (level);
+
+    float yg;
+    if (expander)
+        yg = (xg > threshold) ? xg : threshold + (xg - threshold) * ratio;
+    else
+        yg = (xg < threshold) ? xg : threshold + (xg - threshold) / ratio;
+
+    return xg - yg;
+}
+
+inline float CompressorExpanderDSP::getLevelDecibels (const float level) noexcept
+{
+    const float clippedLevel = jmax (level, 1e-6f);
+    return (clippedLevel <= 1e-6f) ? -60.0f : 3.01029996f * FastMath::log2 (clippedLevel);
+}
+
+inline void CompressorExpanderDSP::applyGains (float* samples, const float* gains, const int numSamples) noexcept
+{
+   #if AUDIO_EFFECTS_FIXED_POINT
+    FixedPointKernels::multiply (samples, gains, numSamples);
+   #else
+    FloatVectorOperations::multiply (samples, gains, numSamples);
+   #endif
+}
+
+inline void CompressorExpanderDSP::applyGains (double* samples, const double* gains, const int numSamples) noexcept
+{
+    FloatVectorOperations::multiply (samples, gains, numSamples);
+}
+
+template <typename SampleType>
+void CompressorExpanderDSP::fillKeyLevels (const AudioBuffer<SampleType>& buffer, const int keyChannel, const int numKeyChannels,
+                                           const bool maximum, const int blockStart, const int blockSamples, SampleType* keyLevels) noexcept
+{
+    if (maximum) {
+        FloatVectorOperations::clear (keyLevels, blockSamples);
+        for (int channel = keyChannel; channel < keyChannel + numKeyChannels; ++channel) {
+            const SampleType* keyData = buffer.getReadPointer (channel, blockStart);
+            for (int sample = 0; sample < blockSamples; ++sample)
+                keyLevels[sample] = jmax (keyLevels[sample], keyData[sample] * keyData[sample]);
+        }
+    } else {
+        const SampleType keyScale = (SampleType)1 / numKeyChannels;
+
+        FloatVectorOperations::copyWithMultiply (keyLevels, buffer.getReadPointer (keyChannel, blockStart), keyScale, blockSamples);
+        for (int channel = keyChannel + 1; channel < keyChannel + numKeyChannels; ++channel)
+            FloatVectorOperations::addWithMultiply (keyLevels, buffer.getReadPointer (channel, blockStart), keyScale, blockSamples);
+        FloatVectorOperations::multiply (keyLevels, keyLevels, blockSamples);
+    }
+}
+
+//==============================================================================
+
+template <typename SampleType>
+void CompressorExpanderDSP::processMultiband (AudioBuffer<SampleType>& buffer, const int numInputChannels, LevelFrame& levels,
+                                              const bool expander, const int keyChannel, const int numKeyChannels, const bool maximum)
+{
+    const int numSamples = buffer.getNumSamples();
+    const int numBands = crossover.getNumBands();
+    const int channelStride = (int)LinkwitzRileyCrossover::maxNumBands * (int)maxBlockSize;
+    const float keyScale = maximum ? 1.0f : 1.0f / (float)numKeyChannels;
+
+    const BandLanes one = BandLanes::expand (1.0f);
+    const BandLanes averageFactor = BandLanes::expand (0.9999f);
+
+    for (int blockStart = 0; blockStart < numSamples; blockStart += maxBlockSize) {
+        const int blockSamples = jmin ((int)maxBlockSize, numSamples - blockStart);
+        const int numLevels = blockSamples * (int)bandStride;
+
+        fillNextValues (smoothedThreshold, thresholds, blockSamples);
+        fillNextValues (smoothedRatio, ratios, blockSamples);
+        fillNextValues (smoothedMakeupGain, makeupGains, blockSamples);
+        updateDetectorTimes (blockSamples);
+
+        // The bands of every channel, one after the other, maxBlockSize samples apart,
+        // and of the sidechain, which comes after the main input
+        const int numSplitChannels = jmax (numInputChannels, keyChannel + numKeyChannels);
+        for (int channel = 0; channel < numSplitChannels; ++channel) {
+            const SampleType* channelData = buffer.getReadPointer (channel, blockStart);
+            double* channelBands = bandSignals + channel * channelStride;
+            double bands[LinkwitzRileyCrossover::maxNumBands];
+
+            for (int sample = 0; sample < blockSamples; ++sample) {
+                crossover.processSample (channel, (double)channelData[sample], bands);
+                for (int band = 0; band < numBands; ++band)
+                    channelBands[band * maxBlockSize + sample] = bands[band];
+            }
+        }
+
+        // Squared mean, or maximum, of the channels of the key in every band
+        FloatVectorOperations::clear (bandLevels, numLevels);
+        for (int channel = keyChannel; channel < keyChannel + numKeyChannels; ++channel) {
+            for (int band = 0; band < numBands; ++band) {
+                const double* bandData = bandSignals + channel * channelStride + band * maxBlockSize;
+                float* keyLevels = bandLevels + band;
+
+                if (maximum) {
+                    for (int sample = 0; sample < blockSamples; ++sample)
+                        keyLevels[sample * bandStride] = jmax (keyLevels[sample * bandStride], std::abs ((float)bandData[sample]));
+                } else {
+                    for (int sample = 0; sample < blockSamples; ++sample)
+                        keyLevels[sample * bandStride] += (float)bandData[sample];
+                }
+            }
+        }
+        for (int i = 0; i < numLevels; ++i) {
+            const float level = bandLevels[i] * keyScale;
+            bandLevels[i] = level * level;
+        }
+
+        if (expander) {
+            for (int sample = 0; sample < blockSamples; ++sample) {
+                for (int group = 0; group < numBandRegisters; ++group) {
+                    float* lanes = bandLevels + sample * bandStride + group * numBandLanes;
+                    bandInputLevels[group] = averageFactor * bandInputLevels[group]
+                                           + (one - averageFactor) * BandLanes::fromRawArray (lanes);
+                    bandInputLevels[group].copyToRawArray (lanes);
+                }
+            }
+        }
+
+        float keyLevel = 0.0f;
+        if (telemetry != nullptr)
+            for (int band = 0; band < numBands; ++band)
+                keyLevel = jmax (keyLevel, bandLevels[(blockSamples - 1) * bandStride + band]);
+
+        // Static curve, in every lane
+        for (int sample = 0; sample < blockSamples; ++sample) {
+            float* sampleLevels = bandLevels + sample * bandStride;
+            for (int band = 0; band < bandStride; ++band)
+                sampleLevels[band] = getCurveLevel (sampleLevels[band], thresholds[sample], ratios[sample], expander);
+        }
+
+        // Level detector, with the attack or release chosen in every lane on every sample
+        const BandLanes alphaAttack = BandLanes::expand (detectorCoefficients.getAttack());
+        const BandLanes alphaRelease = BandLanes::expand (detectorCoefficients.getRelease());
+
+        for (int sample = 0; sample < blockSamples; ++sample) {
+            const BandLanes makeupGain = BandLanes::expand (makeupGains[sample]);
+
+            for (int group = 0; group < numBandRegisters; ++group) {
+                float* lanes = bandLevels + sample * bandStride + group * numBandLanes;
+                const BandLanes xl = BandLanes::fromRawArray (lanes);
+                const BandLanes::vMaskType attack = expander ? BandLanes::lessThan (xl, bandYlPrev[group])
+                                                             : BandLanes::greaterThan (xl, bandYlPrev[group]);
+                const BandLanes alpha = alphaRelease + ((alphaAttack - alphaRelease) & attack);
+
+                bandYlPrev[group] = alpha * bandYlPrev[group] + (one - alpha) * xl;
+                (makeupGain - bandYlPrev[group]).copyToRawArray (lanes);
+            }
+        }
+
+        // Sampled once per sub-block, which is plenty for a meter
+        float gainReduction = 0.0f;
+        for (int band = 0; band < numBands; ++band)
+            gainReduction = jmax (gainReduction, bandYlPrev[band / numBandLanes].get ((size_t)(band % numBandLanes)));
+        levels.gainReduction = jmax (levels.gainReduction, gainReduction);
+        if (telemetry != nullptr)
+            telemetry->add (gainReduction, getLevelDecibels (keyLevel));
+
+        // 10^(dB / 20) == 2^(dB * log2 (10) / 20)
+        for (int i = 0; i < numLevels; ++i)
+            bandLevels[i] = FastMath::exp2 (bandLevels[i] * 0.166096405f);
+
+        for (int channel = 0; channel < numInputChannels; ++channel) {
+            SampleType* channelData = buffer.getWritePointer (channel, blockStart);
+            const double* channelBands = bandSignals + channel * channelStride;
+
+            for (int sample = 0; sample < blockSamples; ++sample) {
+                double sum = 0.0;
+                for (int band = 0; band < numBands; ++band)
+                    sum += channelBands[band * maxBlockSize + sample] * (double)bandLevels[sample * bandStride + band];
+                channelData[sample] = (SampleType)sum;
+            }
+        }
+    }
+}
+
+template <typename SampleType>
+void CompressorExpanderDSP::processPerChannel (AudioBuffer<SampleType>& buffer, const int numInputChannels, LevelFrame& levels,
+                                               const bool expander, const int keyChannel, const int numKeyChannels)
+{
+    const int numChannels = jmin (numInputChannels, channelStride);
+    const int numRegisters = (numChannels + numBandLanes - 1) / numBandLanes;
+    const int stride = numRegisters * numBandLanes;
+    const int numSamples = buffer.getNumSamples();
+
+    const BandLanes one = BandLanes::expand (1.0f);
+    const BandLanes averageFactor = BandLanes::expand (0.9999f);
+
+    for (int blockStart = 0; blockStart < numSamples; blockStart += maxBlockSize) {
+        const int blockSamples = jmin ((int)maxBlockSize, numSamples - blockStart);
+        const int numLevels = blockSamples * stride;
+
+        fillNextValues (smoothedThreshold, thresholds, blockSamples);
+        fillNextValues (smoothedRatio, ratios, blockSamples);
+        fillNextValues (smoothedMakeupGain, makeupGains, blockSamples);
+        updateDetectorTimes (blockSamples);
+
+        // Squared level of the key of every channel, the lanes past the last
+        // channel stay silent
+        FloatVectorOperations::clear (channelLevels, numLevels);
+        for (int channel = 0; channel < numChannels; ++channel) {
+            const SampleType* keyData = buffer.getReadPointer (keyChannel + channel % numKeyChannels, blockStart);
+            for (int sample = 0; sample < blockSamples; ++sample)
+                channelLevels[sample * stride + channel] = (float)(keyData[sample] * keyData[sample]);
+        }
+
+        if (expander) {
+            for (int sample = 0; sample < blockSamples; ++sample) {
+                for (int group = 0; group < numRegisters; ++group) {
+                    float* lanes = channelLevels + sample * stride + group * numBandLanes;
+                    float* state = channelInputLevels + group * numBandLanes;
+                    const BandLanes inputLevel = averageFactor * BandLanes::fromRawArray (state)
+                                               + (one - averageFactor) * BandLanes::fromRawArray (lanes);
+                    inputLevel.copyToRawArray (state);
+                    inputLevel.copyToRawArray (lanes);
+                }
+            }
+        }
+
+        float keyLevel = 0.0f;
+        if (telemetry != nullptr)
+            for (int channel = 0; channel < numChannels; ++channel)
+                keyLevel = jmax (keyLevel, channelLevels[(blockSamples - 1) * stride + channel]);
+
+        // Static curve, in every lane
+        for (int sample = 0; sample < blockSamples; ++sample) {
+            float* sampleLevels = channelLevels + sample * stride;
+            for (int channel = 0; channel < stride; ++channel)
+                sampleLevels[channel] = getCurveLevel (sampleLevels[channel], thresholds[sample], ratios[sample], expander);
+        }
+
+        // Level detector, with the attack or release chosen in every lane on every sample
+        const BandLanes alphaAttack = BandLanes::expand (detectorCoefficients.getAttack());
+        const BandLanes alphaRelease = BandLanes::expand (detectorCoefficients.getRelease());
+
+        for (int sample = 0; sample < blockSamples; ++sample) {
+            const BandLanes makeupGain = BandLanes::expand (makeupGains[sample]);
+
+            for (int group = 0; group < numRegisters; ++group) {
+                float* lanes = channelLevels + sample * stride + group * numBandLanes;
+                float* state = channelYlPrev + group * numBandLanes;
+                const BandLanes xl = BandLanes::fromRawArray (lanes);
+                const BandLanes ylPrev = BandLanes::fromRawArray (state);
+                const BandLanes::vMaskType attack = expander ? BandLanes::lessThan (xl, ylPrev)
+                                                             : BandLanes::greaterThan (xl, ylPrev);
+                const BandLanes alpha = alphaRelease + ((alphaAttack - alphaRelease) & attack);
+                const BandLanes yl = alpha * ylPrev + (one - alpha) * xl;
+
+                yl.copyToRawArray (state);
+                (makeupGain - yl).copyToRawArray (lanes);
+            }
+        }
+
+        // Sampled once per sub-block, which is plenty for a meter
+        float gainReduction = 0.0f;
+        for (int channel = 0; channel < numChannels; ++channel)
+            gainReduction = jmax (gainReduction, channelYlPrev[channel]);
+        levels.gainReduction = jmax (levels.gainReduction, gainReduction);
+        if (telemetry != nullptr)
+            telemetry->add (gainReduction, getLevelDecibels (keyLevel));
+
+        // 10^(dB / 20) == 2^(dB * log2 (10) / 20)
+        for (int i = 0; i < numLevels; ++i)
+            channelLevels[i] = FastMath::exp2 (channelLevels[i] * 0.166096405f);
+
+        for (int channel = 0; channel < numChannels; ++channel) {
+            SampleType* channelData = buffer.getWritePointer (channel, blockStart);
+            for (int sample = 0; sample < blockSamples; ++sample)
+                channelData[sample] *= (SampleType)channelLevels[sample * stride + channel];
+        }
+    }
+}
+
+inline void CompressorExpanderDSP::resetChannels() noexcept
+{
+    if (channelInputLevels == nullptr)
+        return;
+
+    FloatVectorOperations::clear (channelInputLevels, channelStride);
+    FloatVectorOperations::clear (channelYlPrev, channelStride);
+}
+
+inline void CompressorExpanderDSP::updateCrossovers (const int numBands) noexcept
+{
+    if (numBands != crossover.getNumBands())
+        resetBands();
+
+    const double toDiscrete = 2.0 * M_PI / jmax (1.0, sampleRate);
+    const double discreteFrequencies[LinkwitzRileyCrossover::maxNumCrossovers] = {
+        crossoverFrequencies[0] * toDiscrete,
+        crossoverFrequencies[1] * toDiscrete,
+        crossoverFrequencies[2] * toDiscrete,
+        crossoverFrequencies[3] * toDiscrete,
+    };
+
+    crossover.setCrossovers (numBands, discreteFrequencies);
+}
+
+inline void CompressorExpanderDSP::resetBands() noexcept
+{
+    crossover.reset();
+    for (int group = 0; group < numBandRegisters; ++group) {
+        bandInputLevels[group] = BandLanes::expand (0.0f);
+        bandYlPrev[group] = BandLanes::expand (0.0f);
+    }
+}
+
+//==============================================================================
+
+template <typename SampleType>
+void CompressorExpanderDSP::processLimiter (AudioBuffer<SampleType>& buffer, const int numInputChannels, LevelFrame& levels)
+{
+    const int numSamples = buffer.getNumSamples();
+
+    const int lookahead = getLookaheadSamples (sampleRate);
+    if (lookahead != limiterLookahead)
+        resetLimiter (lookahead);
+
+    AudioBuffer<SampleType>& delayBuffer = getLimiterBuffer<SampleType>();
+    const int windowSize = lookahead + 1;
+    const double inverseWindowSize = 1.0 / (double)windowSize;
+
+    SampleType peaks[maxBlockSize];
+    SampleType gains[maxBlockSize];
+    double localGain = limiterGain;
+    double minimumGain = 1.0;
+    float windowPeak = 0.0f;
+
+    for (int blockStart = 0; blockStart < numSamples; blockStart += maxBlockSize) {
+        const int blockSamples = jmin ((int)maxBlockSize, numSamples - blockStart);
+
+        fillNextValues (smoothedThreshold, thresholds, blockSamples);
+        fillNextValues (smoothedMakeupGain, makeupGains, blockSamples);
+        updateDetectorTimes (blockSamples);
+        const double alphaRelease = (double)detectorCoefficients.getRelease();
+
+        // 10^(dB / 20) == 2^(dB * log2 (10) / 20)
+        for (int sample = 0; sample < blockSamples; ++sample) {
+            thresholds[sample] = FastMath::exp2 (thresholds[sample] * 0.166096405f);
+            makeupGains[sample] = FastMath::exp2 (makeupGains[sample] * 0.166096405f);
+        }
+
+        FloatVectorOperations::clear (peaks, blockSamples);
+        for (int channel = 0; channel < numInputChannels; ++channel) {
+            const SampleType* channelData = buffer.getReadPointer (channel, blockStart);
+            for (int sample = 0; sample < blockSamples; ++sample)
+                peaks[sample] = jmax (peaks[sample], std::abs (channelData[sample]));
+        }
+
+        double blockMinimumGain = 1.0;
+        for (int sample = 0; sample < blockSamples; ++sample) {
+            const float threshold = thresholds[sample];
+            windowPeak = peakWindow.push ((float)peaks[sample] * makeupGains[sample]);
+            const double targetGain = (double)(threshold / jmax (threshold, windowPeak));
+
+            // Down at once, so the average stays under the target, and up with the release
+            if (targetGain < localGain) {
+                localGain = targetGain;
+            } else {
+                localGain = alphaRelease * localGain + (1.0 - alphaRelease) * targetGain;
+            }
+
+            averageGainSum += localGain - averageGains[averagePosition];
+            averageGains[averagePosition] = localGain;
+            if (++averagePosition == windowSize)
+                averagePosition = 0;
+
+            const double gain = jmin (1.0, averageGainSum * inverseWindowSize);
+            blockMinimumGain = jmin (blockMinimumGain, gain);
+            gains[sample] = (SampleType)gain;
+        }
+
+        minimumGain = jmin (minimumGain, blockMinimumGain);
+        if (telemetry != nullptr)
+            telemetry->add ((float)(-20.0 * std::log10 (blockMinimumGain)), getLevelDecibels (windowPeak * windowPeak));
+
+        for (int channel = 0; channel < numInputChannels; ++channel) {
+            SampleType* channelData = buffer.getWritePointer (channel, blockStart);
+            SampleType* delayData = delayBuffer.getWritePointer (channel);
+            int writePosition = limiterWritePosition;
+
+            for (int sample = 0; sample < blockSamples; ++sample) {
+                delayData[writePosition] = channelData[sample] * (SampleType)makeupGains[sample];
+                channelData[sample] = delayData[(writePosition - lookahead) & limiterBufferMask] * gains[sample];
+                writePosition = (writePosition + 1) & limiterBufferMask;
+            }
+        }
+        limiterWritePosition = (limiterWritePosition + blockSamples) & limiterBufferMask;
+    }
+
+    limiterGain = localGain;
+    levels.gainReduction = jmax (levels.gainReduction, (float)(-20.0 * std::log10 (minimumGain)));
+}
+
+inline void CompressorExpanderDSP::resetLimiter (const int lookaheadSamples) noexcept
+{
+    limiterLookahead = lookaheadSamples;
+    limiterWritePosition = 0;
+    limiterBuffer.clear();
+    doubleLimiterBuffer.clear();
+
+    peakWindow.reset (lookaheadSamples + 1);
+
+    for (int i = 0; i <= lookaheadSamples; ++i)
+        averageGains[i] = 1.0;
+    averageGainSum = (double)(lookaheadSamples + 1);
+    averagePosition = 0;
+    limiterGain = 1.0;
+}
+
+inline int CompressorExpanderDSP::getLookaheadSamples (const double atSampleRate) const noexcept
+{
+    const int maxLookaheadSamples = (int)std::ceil (maxLookaheadTime * atSampleRate);
+    return jmax (1, jmin (maxLookaheadSamples, roundToInt (lookaheadTime.load() * atSampleRate)));
+}
+
+//==============================================================================
@@ -0,0 +1,171 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+#include <limits>
+
+//==============================================================================
+
+/** Gain reduction and detector level of the last processed block, published by
+    the audio thread for any number of readers on other threads, such as the
+    editor or a host logging the loudness of a render.
+
+    The values are guarded by a sequence count, odd while the audio thread writes
+    them: read() copies them and tries again if the count was odd or changed in
+    the meantime. Neither side ever locks, and the audio thread never waits.
+
+    The statistics are only gathered while a Reader exists, so without one the
+    audio path only pays for the relaxed load of isWanted() once a block.
+*/
+class GainReductionTelemetry
+{
+public:
+    /** All the levels in dB. The gain reduction is positive, and its minimum,
+        maximum and average are taken over the sub-blocks of the gain computer.
+        The detector level is the largest level of the key seen by the gain
+        computer, in the lookahead limiter its peak. blockCount grows by one with
+        every block published, so a reader can tell whether anything new arrived.
+    */
+    struct Snapshot
+    {
+        float minGainReduction = 0.0f;
+        float maxGainReduction = 0.0f;
+        float averageGainReduction = 0.0f;
+        float detectorLevel = -60.0f;
+        uint32 blockCount = 0;
+    };
+
+    /** Statistics of one block, gathered by the audio thread before publish(). */
+    struct Accumulator
+    {
+        float minGainReduction = std::numeric_limits<float>::max();
+        float maxGainReduction = 0.0f;
+        float sumGainReduction = 0.0f;
+        float detectorLevel = -60.0f;
+        int count = 0;
+
+        void add (const float gainReduction, const float level) noexcept
+        {
+            minGainReduction = jmin (minGainReduction, gainReduction);
+            maxGainReduction = jmax (maxGainReduction, gainReduction);
+            sumGainReduction += gainReduction;
+            detectorLevel = jmax (detectorLevel, level);
+            ++count;
+        }
+    };
+
+    /** Keeps the statistics gathered while it exists. Create one on the thread that
+        reads, and keep it for as long as it reads.
+    */
+    class Reader
+    {
+    public:
+        explicit Reader (const GainReductionTelemetry& telemetryToRead) noexcept
+            : telemetry (telemetryToRead)
+        {
+            telemetry.numReaders.fetch_add (1, std::memory_order_relaxed);
+        }
+
+        ~Reader()
+        {
+            telemetry.numReaders.fetch_sub (1, std::memory_order_relaxed);
+        }
+
+        /** Returns false if nothing was published yet, or if the audio thread kept
+            writing through every attempt.
+        */
+        bool read (Snapshot& snapshot) const noexcept
+        {
+            return telemetry.read (snapshot);
+        }
+
+    private:
+        const GainReductionTelemetry& telemetry;
+
+        JUCE_DECLARE_NON_COPYABLE (Reader)
+    };
+
+    //======================================
+
+    /** Called by the audio thread once a block, before gathering anything. */
+    bool isWanted() const noexcept
+    {
+        return numReaders.load (std::memory_order_relaxed) > 0;
+    }
+
+    /** Called by the audio thread only, with the statistics of a block. */
+    void publish (const Accumulator& block) noexcept
+    {
+        if (block.count == 0)
+            return;
+
+        const uint32 sequenceStart = sequence.load (std::memory_order_relaxed);
+        sequence.store (sequenceStart + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence (std::memory_order_release);
+
+        minGainReduction.store (block.minGainReduction, std::memory_order_relaxed);
+        maxGainReduction.store (block.maxGainReduction, std::memory_order_relaxed);
+        averageGainReduction.store (block.sumGainReduction / (float)block.count, std::memory_order_relaxed);
+        detectorLevel.store (block.detectorLevel, std::memory_order_relaxed);
+        blockCount.store (blockCount.load (std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+        sequence.store (sequenceStart + 2, std::memory_order_release);
+    }
+
+private:
+    bool read (Snapshot& snapshot) const noexcept
+    {
+        for (int attempt = 0; attempt < maxReadAttempts; ++attempt) {
+            const uint32 sequenceStart = sequence.load (std::memory_order_acquire);
+            if ((sequenceStart & 1) != 0)
+                continue;
+
+            snapshot.minGainReduction = minGainReduction.load (std::memory_order_relaxed);
+            snapshot.maxGainReduction = maxGainReduction.load (std::memory_order_relaxed);
+            snapshot.averageGainReduction = averageGainReduction.load (std::memory_order_relaxed);
+            snapshot.detectorLevel = detectorLevel.load (std::memory_order_relaxed);
+            snapshot.blockCount = blockCount.load (std::memory_order_relaxed);
+
+            std::atomic_thread_fence (std::memory_order_acquire);
+            if (sequence.load (std::memory_order_relaxed) == sequenceStart)
+                return snapshot.blockCount > 0;
+        }
+        return false;
+    }
+
+    enum { maxReadAttempts = 16 };
+
+    std::atomic<uint32> sequence { 0 };
+    std::atomic<float> minGainReduction { 0.0f };
+    std::atomic<float> maxGainReduction { 0.0f };
+    std::atomic<float> averageGainReduction { 0.0f };
+    std::atomic<float> detectorLevel { -60.0f };
+    std::atomic<uint32> blockCount { 0 };
+
+    mutable std::atomic<int> numReaders { 0 };
+};
+
+//==============================================================================
@@ -0,0 +1,174 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+
+/** Splits every channel into up to maxNumBands bands with a tree of fourth order
+    Linkwitz-Riley crossovers.
+
+    Each crossover is two Butterworth low-pass and two high-pass biquads, and the
+    upper output feeds the next crossover. The low and high outputs of a crossover
+    add up to a second order all-pass, so the bands below each crossover go through
+    that all-pass too. Then all the bands have the same phase response and add back
+    up to a flat magnitude response. The filters run in doubles for both processing
+    precisions.
+*/
+class LinkwitzRileyCrossover
+{
+public:
+    //==============================================================================
+
+    enum {
+        maxNumBands = 5,
+        maxNumCrossovers = maxNumBands - 1,
+    };
+
+    LinkwitzRileyCrossover()
+        : numBands (1)
+        , numChannels (0)
+    {
+    }
+
+    void prepare (const int newNumChannels)
+    {
+        numChannels = newNumChannels;
+        channels.allocate ((size_t)jmax (1, numChannels), true);
+    }
+
+    void reset() noexcept
+    {
+        if (channels != nullptr)
+            zeromem (channels.get(), sizeof (ChannelState) * (size_t)jmax (1, numChannels));
+    }
+
+    int getNumBands() const noexcept
+    {
+        return numBands;
+    }
+
+    /** Sets the number of bands and the numBands - 1 crossover frequencies in
+        radians per sample, from low to high. Changing the number of bands clears
+        the filters.
+    */
+    void setCrossovers (const int newNumBands, const double* discreteFrequencies) noexcept
+    {
+        jassert (newNumBands >= 1 && newNumBands <= maxNumBands);
+
+        if (newNumBands != numBands) {
+            numBands = newNumBands;
+            reset();
+        }
+
+        double previousFrequency = 0.0;
+        for (int i = 0; i < numBands - 1; ++i) {
+            const double frequency = jlimit (previousFrequency, M_PI * 0.49, discreteFrequencies[i]);
+            updateCoefficients (i, frequency);
+            previousFrequency = frequency;
+        }
+    }
+
+    /** Splits one sample of a channel into getNumBands() bands, from low to high. */
+    void processSample (const int channel, const double input, double* bands) noexcept
+    {
+        jassert (channel < numChannels);
+
+        ChannelState& state = channels[channel];
+        const int numCrossovers = numBands - 1;
+
+        double high = input;
+        for (int i = 0; i < numCrossovers; ++i) {
+            const double low = state.lowPass[i][1].process (lowPass[i], state.lowPass[i][0].process (lowPass[i], high));
+            high = state.highPass[i][1].process (highPass[i], state.highPass[i][0].process (highPass[i], high));
+
+            for (int band = 0; band < i; ++band)
+                bands[band] = state.allPass[i][band].process (allPass[i], bands[band]);
+
+            bands[i] = low;
+        }
+
+        bands[numCrossovers] = high;
+    }
+
+private:
+    //==============================================================================
+
+    struct Coefficients
+    {
+        double b0, b1, b2, a1, a2;
+    };
+
+    /** Transposed direct form II. */
+    struct Biquad
+    {
+        double process (const Coefficients& c, const double in) noexcept
+        {
+            const double out = c.b0 * in + z1;
+            z1 = c.b1 * in - c.a1 * out + z2;
+            z2 = c.b2 * in - c.a2 * out;
+            return out;
+        }
+
+        double z1, z2;
+    };
+
+    struct ChannelState
+    {
+        Biquad lowPass[maxNumCrossovers][2];
+        Biquad highPass[maxNumCrossovers][2];
+        Biquad allPass[maxNumCrossovers][maxNumCrossovers];
+    };
+
+    void updateCoefficients (const int crossover, const double discreteFrequency) noexcept
+    {
+        // Butterworth, Q = 1 / sqrt (2), through the bilinear transform
+        const double K = tan (discreteFrequency / 2.0);
+        const double K2 = K * K;
+        const double norm = 1.0 / (1.0 + M_SQRT2 * K + K2);
+        const double a1 = 2.0 * (K2 - 1.0) * norm;
+        const double a2 = (1.0 - M_SQRT2 * K + K2) * norm;
+
+        lowPass[crossover] = { K2 * norm, 2.0 * K2 * norm, K2 * norm, a1, a2 };
+        highPass[crossover] = { norm, -2.0 * norm, norm, a1, a2 };
+        allPass[crossover] = { a2, a1, 1.0, a1, a2 };
+    }
+
+    //==============================================================================
+
+    int numBands;
+    int numChannels;
+
+    Coefficients lowPass[maxNumCrossovers];
+    Coefficients highPass[maxNumCrossovers];
+    Coefficients allPass[maxNumCrossovers];
+    HeapBlock<ChannelState> channels;
+
+    JUCE_DECLARE_NON_COPYABLE (LinkwitzRileyCrossover)
+};
+
+//==============================================================================
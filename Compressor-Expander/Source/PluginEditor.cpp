@@ -100,12 +100,24 @@ CompressorExpanderAudioProcessorEditor::CompressorExpanderAudioProcessorEditor (
 
     //======================================
 
+    addAndMakeVisible (levelDisplay);
+    editorHeight += LevelMeterDisplay::preferredHeight + editorPadding;
+
     editorHeight += components.size() * editorPadding;
     setSize (editorWidth, editorHeight);
+    setOpaque (true);
+    setLookAndFeel (lookAndFeel);
+    renderingContext.attachTo (*this);
+
+    processor.levelMeter.setEnabled (true);
+    startTimerHz (30);
 }
 
 CompressorExpanderAudioProcessorEditor::~CompressorExpanderAudioProcessorEditor()
 {
+    processor.levelMeter.setEnabled (false);
+    renderingContext.detach();
+    setLookAndFeel (nullptr);
 }
 
 //==============================================================================
@@ -132,6 +144,17 @@ void CompressorExpanderAudioProcessorEditor::resized()
 
         r = r.removeFromBottom (r.getHeight() - editorPadding);
     }
+
+    levelDisplay.setBounds (getLocalBounds().reduced (editorMargin).removeFromBottom (LevelMeterDisplay::preferredHeight));
+}
+
+//==============================================================================
+
+void CompressorExpanderAudioProcessorEditor::timerCallback()
+{
+    LevelFrame frame;
+    const bool received = processor.levelMeter.collect (frame);
+    levelDisplay.update (received ? &frame : nullptr, 0.001f * (float)getTimerInterval());
 }
 
 //==============================================================================
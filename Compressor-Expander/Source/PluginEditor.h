@@ -24,10 +24,12 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "PluginProcessor.h"
+#include "EditorRendering.h"
+#include "MeterComponents.h"
 
 //==============================================================================
 
-class CompressorExpanderAudioProcessorEditor : public AudioProcessorEditor
+class CompressorExpanderAudioProcessorEditor : public AudioProcessorEditor, private Timer
 {
 public:
     //==============================================================================
@@ -75,6 +77,16 @@ private:
     OwnedArray<ButtonAttachment> buttonAttachments;
     OwnedArray<ComboBoxAttachment> comboBoxAttachments;
 
+    //======================================
+
+    void timerCallback() override;
+    LevelMeterDisplay levelDisplay;
+
+    //======================================
+
+    EditorRenderingContext renderingContext;
+    SharedResourcePointer<EditorLookAndFeel> lookAndFeel;
+
     //==============================================================================
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CompressorExpanderAudioProcessorEditor)
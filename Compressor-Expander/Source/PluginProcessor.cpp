@@ -35,19 +35,34 @@ CompressorExpanderAudioProcessor::CompressorExpanderAudioProcessor():
                     #if ! JucePlugin_IsMidiEffect
                      #if ! JucePlugin_IsSynth
                       .withInput  ("Input",  AudioChannelSet::stereo(), true)
+                      .withInput  ("Sidechain", AudioChannelSet::stereo(), false)
                      #endif
                       .withOutput ("Output", AudioChannelSet::stereo(), true)
                     #endif
                    ),
 #endif
     parameters (*this)
-    , paramMode (parameters, "Mode", {"Compressor / Limiter", "Expander / Noise gate"}, 1)
+    , paramMode (parameters, "Mode", modeItemsUI, modeExpander,
+                 [this](float value){ paramMode.setCurrentAndTargetValue (value); updateLatency(); return value; })
     , paramThreshold (parameters, "Threshold", "dB", -60.0f, 0.0f, -24.0f)
     , paramRatio (parameters, "Ratio", ":1", 1.0f, 100.0f, 50.0f)
     , paramAttack (parameters, "Attack", "ms", 0.1f, 100.0f, 2.0f, [](float value){ return value * 0.001f; })
     , paramRelease (parameters, "Release", "ms", 10.0f, 1000.0f, 300.0f, [](float value){ return value * 0.001f; })
     , paramMakeupGain (parameters, "Makeup gain", "dB", -12.0f, 12.0f, 0.0f)
-    , paramBypass (parameters, "Bypass")
+    , paramLookahead (parameters, "Look-ahead", "ms", 0.1f, CompressorExpanderDSP::maxLookaheadTime * 1000.0f, 5.0f,
+                      [this](float value){
+                          compressorExpander.setParameter (CompressorExpanderDSP::parameterLookahead, value * 0.001f);
+                          updateLatency();
+                          return value * 0.001f;
+                      })
+    , paramBands (parameters, "Bands", {"1", "2", "3", "4", "5"}, 0,
+                  [](float value){ return value + 1; })
+    , paramCrossover1 (parameters, "Crossover 1", "Hz", 40.0f, 500.0f, 120.0f)
+    , paramCrossover2 (parameters, "Crossover 2", "Hz", 200.0f, 2000.0f, 600.0f)
+    , paramCrossover3 (parameters, "Crossover 3", "Hz", 1000.0f, 8000.0f, 2500.0f)
+    , paramCrossover4 (parameters, "Crossover 4", "Hz", 3000.0f, 16000.0f, 7000.0f)
+    , paramStereoLink (parameters, "Stereo link", stereoLinkItemsUI, stereoLinkSummed)
+    , bypass (*this, parameters)
 {
     parameters.apvts.state = ValueTree (Identifier (getName().removeCharacters ("- ")));
 }
@@ -60,117 +75,124 @@ CompressorExpanderAudioProcessor::~CompressorExpanderAudioProcessor()
 
 void CompressorExpanderAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
+    TRACE_INSTANCE_SCOPE ("prepareToPlay", this);
+
+    // The threshold, ratio, times and makeup gain ramp in the core
     const double smoothTime = 1e-3;
-    paramThreshold.reset (sampleRate, smoothTime);
-    paramRatio.reset (sampleRate, smoothTime);
-    paramAttack.reset (sampleRate, smoothTime);
-    paramRelease.reset (sampleRate, smoothTime);
-    paramMakeupGain.reset (sampleRate, smoothTime);
-    paramBypass.reset (sampleRate, smoothTime);
+    updateDSPParameters();
+    compressorExpander.prepare (sampleRate, getMainBusNumInputChannels(), getChannelCountOfBus (true, 1),
+                                isUsingDoublePrecision(), smoothTime);
+    updateLatency();
+
+    profiler.prepare (sampleRate);
+    silenceDetector.prepare (sampleRate);
+    bypass.prepare (sampleRate, samplesPerBlock, (int)std::ceil (CompressorExpanderDSP::maxLookaheadTime * sampleRate));
+}
 
-    //======================================
+void CompressorExpanderAudioProcessor::releaseResources()
+{
+}
 
-    mixedDownInput.setSize (1, samplesPerBlock);
+void CompressorExpanderAudioProcessor::reset()
+{
+    compressorExpander.reset();
+}
 
-    inputLevel = 0.0f;
-    ylPrev = 0.0f;
+void CompressorExpanderAudioProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
+{
+    process (buffer);
+}
 
-    inverseSampleRate = 1.0f / (float)getSampleRate();
-    inverseE = 1.0f / M_E;
+void CompressorExpanderAudioProcessor::processBlock (AudioBuffer<double>& buffer, MidiBuffer& midiMessages)
+{
+    process (buffer);
 }
 
-void CompressorExpanderAudioProcessor::releaseResources()
+bool CompressorExpanderAudioProcessor::supportsDoublePrecisionProcessing() const
 {
+    return true;
 }
 
-void CompressorExpanderAudioProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
+template <typename SampleType>
+void CompressorExpanderAudioProcessor::process (AudioBuffer<SampleType>& buffer)
 {
+    const ProcessBlockProfiler::ScopedMeasurement measurement (profiler, buffer.getNumSamples(), isNonRealtime());
+    TRACE_INSTANCE_SCOPE ("processBlock", this);
     ScopedNoDenormals noDenormals;
 
-    const int numInputChannels = getTotalNumInputChannels();
+    parameters.applySnapshotMorph();
+
+    const int numInputChannels = getMainBusNumInputChannels();
     const int numOutputChannels = getTotalNumOutputChannels();
     const int numSamples = buffer.getNumSamples();
 
     //======================================
 
-    if ((bool)paramBypass.getTargetValue())
+    if (silenceDetector.skipBlock (*this, buffer))
+        return;
+
+    if (bypass.begin (buffer))
         return;
 
+    const bool metering = levelMeter.isActive();
+    LevelFrame levels;
+    if (metering)
+        for (int channel = 0; channel < numInputChannels; ++channel)
+            levels.inputPeak = jmax (levels.inputPeak, (float)buffer.getMagnitude (channel, 0, numSamples));
+
+    telemetryActive = telemetry.isWanted();
+    blockTelemetry = {};
+
     //======================================
 
-    mixedDownInput.clear();
-    for (int channel = 0; channel < numInputChannels; ++channel)
-        mixedDownInput.addFrom (0, 0, buffer, channel, 0, numSamples, 1.0f / numInputChannels);
-
-    for (int sample = 0; sample < numSamples; ++sample) {
-        bool expander = (bool)paramMode.getTargetValue();
-        float T = paramThreshold.getNextValue();
-        float R = paramRatio.getNextValue();
-        float alphaA = calculateAttackOrRelease (paramAttack.getNextValue());
-        float alphaR = calculateAttackOrRelease (paramRelease.getNextValue());
-        float makeupGain = paramMakeupGain.getNextValue();
-
-        float inputSquared = powf (mixedDownInput.getSample (0, sample), 2.0f);
-        if (expander) {
-            const float averageFactor = 0.9999f;
-            inputLevel = averageFactor * inputLevel + (1.0f - averageFactor) * inputSquared;
-        } else {
-            inputLevel = inputSquared;
-        }
-        xg = (inputLevel <= 1e-6f) ? -60.0f : 10.0f * log10f (inputLevel);
-
-        // Expander
-        if (expander) {
-            if (xg > T)
-                yg = xg;
-            else
-                yg = T + (xg - T) * R;
-
-            xl = xg - yg;
-
-            if (xl < ylPrev)
-                yl = alphaA * ylPrev + (1.0f - alphaA) * xl;
-            else
-                yl = alphaR * ylPrev + (1.0f - alphaR) * xl;
-
-        // Compressor
-        } else {
-            if (xg < T)
-                yg = xg;
-            else
-                yg = T + (xg - T) / R;
-
-            xl = xg - yg;
-
-            if (xl > ylPrev)
-                yl = alphaA * ylPrev + (1.0f - alphaA) * xl;
-            else
-                yl = alphaR * ylPrev + (1.0f - alphaR) * xl;
-        }
-
-        control = powf (10.0f, (makeupGain - yl) * 0.05f);
-        ylPrev = yl;
-
-        for (int channel = 0; channel < numInputChannels; ++channel) {
-            float newValue = buffer.getSample (channel, sample) * control;
-            buffer.setSample (channel, sample, newValue);
-        }
+    // The sidechain, when the host enables it, follows the main input in the buffer
+    const int numSidechainChannels = getChannelCountOfBus (true, 1);
+    const int keyChannel = (numSidechainChannels > 0) ? numInputChannels : 0;
+    const int numKeyChannels = (numSidechainChannels > 0) ? numSidechainChannels : numInputChannels;
+
+    updateDSPParameters();
+    compressorExpander.process (buffer.getArrayOfWritePointers(), numInputChannels, keyChannel, numKeyChannels,
+                                numSamples, levels, telemetryActive ? &blockTelemetry : nullptr);
+
+    if (metering) {
+        for (int channel = 0; channel < numInputChannels; ++channel)
+            levels.outputPeak = jmax (levels.outputPeak, (float)buffer.getMagnitude (channel, 0, numSamples));
+        levelMeter.add (levels);
     }
 
+    if (telemetryActive)
+        telemetry.publish (blockTelemetry);
+
     //======================================
 
     for (int channel = numInputChannels; channel < numOutputChannels; ++channel)
         buffer.clear (channel, 0, numSamples);
+
+    bypass.end (buffer);
 }
 
 //==============================================================================
 
-float CompressorExpanderAudioProcessor::calculateAttackOrRelease (float value)
+void CompressorExpanderAudioProcessor::updateDSPParameters() noexcept
+{
+    compressorExpander.setParameter (CompressorExpanderDSP::parameterMode, paramMode.getTargetValue());
+    compressorExpander.setParameter (CompressorExpanderDSP::parameterThreshold, paramThreshold.getTargetValue());
+    compressorExpander.setParameter (CompressorExpanderDSP::parameterRatio, paramRatio.getTargetValue());
+    compressorExpander.setParameter (CompressorExpanderDSP::parameterAttack, paramAttack.getTargetValue());
+    compressorExpander.setParameter (CompressorExpanderDSP::parameterRelease, paramRelease.getTargetValue());
+    compressorExpander.setParameter (CompressorExpanderDSP::parameterMakeupGain, paramMakeupGain.getTargetValue());
+    compressorExpander.setParameter (CompressorExpanderDSP::parameterBands, paramBands.getTargetValue());
+    compressorExpander.setParameter (CompressorExpanderDSP::parameterCrossover1, paramCrossover1.getTargetValue());
+    compressorExpander.setParameter (CompressorExpanderDSP::parameterCrossover2, paramCrossover2.getTargetValue());
+    compressorExpander.setParameter (CompressorExpanderDSP::parameterCrossover3, paramCrossover3.getTargetValue());
+    compressorExpander.setParameter (CompressorExpanderDSP::parameterCrossover4, paramCrossover4.getTargetValue());
+    compressorExpander.setParameter (CompressorExpanderDSP::parameterStereoLink, paramStereoLink.getTargetValue());
+}
+
+void CompressorExpanderAudioProcessor::updateLatency()
 {
-    if (value == 0.0f)
-        return 0.0f;
-    else
-        return pow (inverseE, inverseSampleRate / value);
+    const bool limiter = (int)paramMode.getTargetValue() == modeLookaheadLimiter;
+    setLatencySamples (limiter ? compressorExpander.getLookaheadSamples (getSampleRate()) : 0);
 }
 
 //==============================================================================
@@ -184,13 +206,17 @@ float CompressorExpanderAudioProcessor::calculateAttackOrRelease (float value)
 
 void CompressorExpanderAudioProcessor::getStateInformation (MemoryBlock& destData)
 {
-    auto state = parameters.apvts.copyState();
-    std::unique_ptr<XmlElement> xml (state.createXml());
-    copyXmlToBinary (*xml, destData);
+    MemoryOutputStream stream (destData, false);
+    parameters.writeState (stream);
 }
 
 void CompressorExpanderAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
+    MemoryInputStream stream (data, (size_t)sizeInBytes, false);
+    if (parameters.readState (stream))
+        return;
+
+    // Sessions saved in the XML format of older versions
     std::unique_ptr<XmlElement> xmlState (getXmlFromBinary (data, sizeInBytes));
 
     if (xmlState.get() != nullptr)
@@ -219,10 +245,9 @@ bool CompressorExpanderAudioProcessor::isBusesLayoutSupported (const BusesLayout
     ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    if (layouts.getMainOutputChannelSet() != AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != AudioChannelSet::stereo())
+    // The detectors work with any number of channels, so any layout with at least one
+    // channel is supported. The sidechain can have any layout too, or be disabled.
+    if (layouts.getMainOutputChannelSet().isDisabled())
         return false;
 
     // This checks if the input layout matches the output layout
@@ -272,7 +297,22 @@ bool CompressorExpanderAudioProcessor::isMidiEffect() const
 
 double CompressorExpanderAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // The output follows the input straight away, but the level detector has to
+    // release before it is where it would be after the silence
+    const double releaseTailSeconds = SilenceDetector::getDecayTailSeconds (paramRelease.getTargetValue());
+    if ((int)paramMode.getTargetValue() != modeExpander)
+        return releaseTailSeconds;
+
+    // The expander averages the input power with a factor of 0.9999 per sample
+    // first, and closes with the attack time
+    const double averageTimeConstant = 1.0 / (1.0e-4 * jmax (1.0, getSampleRate()));
+    return SilenceDetector::getDecayTailSeconds (averageTimeConstant)
+         + SilenceDetector::getDecayTailSeconds (paramAttack.getTargetValue());
+}
+
+AudioProcessorParameter* CompressorExpanderAudioProcessor::getBypassParameter() const
+{
+    return bypass.getParameter();
 }
 
 //==============================================================================
@@ -303,6 +343,21 @@ void CompressorExpanderAudioProcessor::changeProgramName (int index, const Strin
 
 //==============================================================================
 
+MemoryFootprint CompressorExpanderAudioProcessor::getMemoryFootprint() const
+{
+    const ScopedLock lock (parameters.deferredCallbackLock);
+
+    MemoryFootprint footprint;
+    footprint.add (MemoryFootprint::other, sizeof (*this));
+    bypass.addMemoryFootprint (footprint);
+
+    compressorExpander.addMemoryFootprint (footprint);
+
+    return footprint;
+}
+
+//==============================================================================
+
 // This creates new instances of the plugin..
 AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
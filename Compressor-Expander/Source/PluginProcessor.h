@@ -30,10 +30,17 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "PluginParameter.h"
+#include "ProcessBlockProfiler.h"
+#include "SilenceDetector.h"
+#include "PluginBypass.h"
+#include "MemoryFootprint.h"
+#include "MeteringFifo.h"
+#include "GainReductionTelemetry.h"
+#include "CompressorExpanderDSP.h"
 
 //==============================================================================
 
-class CompressorExpanderAudioProcessor : public AudioProcessor
+class CompressorExpanderAudioProcessor : public AudioProcessor, public MemoryFootprintSource
 {
 public:
     //==============================================================================
@@ -45,7 +52,10 @@ public:
 
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
+    void reset() override;
     void processBlock (AudioSampleBuffer&, MidiBuffer&) override;
+    void processBlock (AudioBuffer<double>&, MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override;
 
     //==============================================================================
 
@@ -78,6 +88,7 @@ public:
     bool producesMidi() const override;
     bool isMidiEffect () const override;
     double getTailLengthSeconds() const override;
+    AudioProcessorParameter* getBypassParameter() const override;
 
     //==============================================================================
 
@@ -89,26 +100,64 @@ public:
 
     //==============================================================================
 
+    MemoryFootprint getMemoryFootprint() const override;
 
+    //==============================================================================
+
+    StringArray modeItemsUI = {
+        "Compressor / Limiter",
+        "Expander / Noise gate",
+        "Look-ahead limiter"
+    };
+
+    enum modeIndex {
+        modeCompressor = CompressorExpanderDSP::modeCompressor,
+        modeExpander = CompressorExpanderDSP::modeExpander,
+        modeLookaheadLimiter = CompressorExpanderDSP::modeLookaheadLimiter,
+    };
+
+    StringArray stereoLinkItemsUI = {
+        "Summed",
+        "Maximum",
+        "Per channel"
+    };
+
+    enum stereoLinkIndex {
+        stereoLinkSummed = CompressorExpanderDSP::stereoLinkSummed,
+        stereoLinkMaximum = CompressorExpanderDSP::stereoLinkMaximum,
+        stereoLinkPerChannel = CompressorExpanderDSP::stereoLinkPerChannel,
+    };
 
+    //======================================
 
+    /** Runs both processBlock() overloads. The key that the core detects on is
+        the sidechain bus when the host enables it, otherwise the main input.
+    */
+    template <typename SampleType>
+    void process (AudioBuffer<SampleType>& buffer);
 
+    /** Hands the values of the parameters to the core, once a block. */
+    void updateDSPParameters() noexcept;
+    void updateLatency();
 
-    //==============================================================================
+    CompressorExpanderDSP compressorExpander;
 
-    AudioSampleBuffer mixedDownInput;
-    float xl;
-    float yl;
-    float xg;
-    float yg;
-    float control;
+    //======================================
+
+    // Levels and gain reduction for the editor
+    MeterSource<LevelFrame> levelMeter;
 
-    float inputLevel;
-    float ylPrev;
+    // Gain reduction and detector level of every block, for the editor and the
+    // host, gathered into blockTelemetry at the same points as the meter while
+    // telemetryActive
+    GainReductionTelemetry telemetry;
+    GainReductionTelemetry::Accumulator blockTelemetry;
+    bool telemetryActive = false;
+
+    //======================================
 
-    float inverseSampleRate;
-    float inverseE;
-    float calculateAttackOrRelease (float value);
+    ProcessBlockProfiler profiler;
+    SilenceDetector silenceDetector;
 
     //======================================
 
@@ -120,7 +169,15 @@ public:
     PluginParameterLinSlider paramAttack;
     PluginParameterLinSlider paramRelease;
     PluginParameterLinSlider paramMakeupGain;
-    PluginParameterToggle paramBypass;
+    PluginParameterLinSlider paramLookahead;
+    PluginParameterComboBox paramBands;
+    PluginParameterLogSlider paramCrossover1;
+    PluginParameterLogSlider paramCrossover2;
+    PluginParameterLogSlider paramCrossover3;
+    PluginParameterLogSlider paramCrossover4;
+    PluginParameterComboBox paramStereoLink;
+
+    PluginBypass bypass;
 
 private:
     //==============================================================================
@@ -0,0 +1,111 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+
+/** Maximum of the last windowSize values pushed, for the peak detector of the
+    look-ahead limiter.
+
+    The values that can still become the maximum are kept in a monotonic deque:
+    every push drops from the back the values it is larger than, and from the front
+    the one that leaves the window. The front is then the maximum. Each value is
+    added and dropped once, so a push costs the same amortised time whatever the
+    window size. prepare() allocates the deque, and nothing else does.
+*/
+class SlidingWindowMaximum
+{
+public:
+    //==============================================================================
+
+    SlidingWindowMaximum()
+        : capacity (0)
+        , mask (0)
+    {
+        reset (1);
+    }
+
+    void prepare (const int maxWindowSize)
+    {
+        capacity = nextPowerOfTwo (jmax (1, maxWindowSize));
+        mask = capacity - 1;
+        values.allocate ((size_t)capacity, true);
+        positions.allocate ((size_t)capacity, true);
+        reset (jmin (windowSize, capacity));
+    }
+
+    /** Empties the window, and sets the number of values it spans. */
+    void reset (const int newWindowSize) noexcept
+    {
+        jassert (newWindowSize >= 1 && (capacity == 0 || newWindowSize <= capacity));
+
+        windowSize = jmax (1, newWindowSize);
+        front = 0;
+        back = 0;
+        position = 0;
+    }
+
+    int getWindowSize() const noexcept
+    {
+        return windowSize;
+    }
+
+    /** Adds a value, and returns the maximum of the window that now ends with it. */
+    float push (const float value) noexcept
+    {
+        jassert (capacity > 0);
+
+        while (back != front && values[(back - 1) & mask] <= value)
+            --back;
+
+        values[back & mask] = value;
+        positions[back & mask] = position;
+        ++back;
+
+        // One value enters per push, so at most one can leave
+        if (position - positions[front & mask] >= (uint32)windowSize)
+            ++front;
+
+        ++position;
+        return values[front & mask];
+    }
+
+private:
+    //==============================================================================
+
+    HeapBlock<float> values;
+    HeapBlock<uint32> positions;
+    int capacity;
+    uint32 mask;
+
+    int windowSize;
+    uint32 front;
+    uint32 back;
+    uint32 position;
+
+    JUCE_DECLARE_NON_COPYABLE (SlidingWindowMaximum)
+};
+
+//==============================================================================
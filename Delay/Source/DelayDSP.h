@@ -0,0 +1,1064 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "MemoryFootprint.h"
+#include "ChannelWorkerPool.h"
+#include "DelayMemoryArena.h"
+#include "DelayHistoryTransfer.h"
+#include "DelayReadHeads.h"
+#include "TempoSync.h"
+#include "FixedPoint.h"
+
+//==============================================================================
+
+/** The audio processing of the Delay, without the parameters, state, editor or
+    buses of the plugin, for hosts that only need the audio and run many instances.
+    DelayAudioProcessor wraps one and hands it the values of its parameters once a
+    block, in their natural units: the delay times in seconds, the feedback and the
+    mix, the indices of the delay line, of the delay time changes and of the note
+    division, the number of taps from 1 to 16, the tempo sync as 0 or 1, and the
+    time in seconds, gain, pan and feedback of every tap after the first. The tempo
+    of the host comes through setHostTempo().
+
+    The delay line and the maximum delay time reallocate the lines, so setParameter()
+    is not real-time safe for them. It is meant for another thread than process(),
+    which only waits for the swap of the new lines. The configuration is kept under
+    a lock of its own, so that several threads can change it.
+*/
+class DelayDSP
+{
+public:
+    enum { maxNumTaps = 16 };
+
+    enum tapParameterIndex {
+        tapTime = 0,
+        tapGain,
+        tapPan,
+        tapFeedback,
+        numTapParameters,
+    };
+
+    enum parameterIndex {
+        parameterDelayTime = 0,
+        parameterFeedback,
+        parameterMix,
+        parameterDelayLine,
+        parameterLongDelayTime,
+        parameterMaxDelayTime,
+        parameterNumTaps,
+        parameterDelayTimeChanges,
+        parameterTempoSync,
+        parameterNoteDivision,
+        parameterFirstTap,
+        numParameters = parameterFirstTap + numTapParameters * (maxNumTaps - 1),
+    };
+
+    /** Index of a parameter of the taps after the first one, numbered from 2. */
+    static int getTapParameterIndex (const int tapNumber, const int tapParameter) noexcept
+    {
+        return parameterFirstTap + numTapParameters * (tapNumber - 2) + tapParameter;
+    }
+
+    enum delayLineIndex {
+        delayLineFloat = 0,
+        delayLineCompact,
+    };
+
+    enum delayTimeChangesIndex {
+        delayTimeChangesJump = 0,
+        delayTimeChangesCrossfade,
+    };
+
+    /** The longest delays of the two lines, and the highest feedback, which the
+        sends of the taps are scaled down to together.
+    */
+    static constexpr float maxFloatDelayTime = 5.0f;
+    static constexpr float maxCompactDelayTime = 60.0f;
+    static constexpr float maxFeedback = 0.9f;
+
+    //======================================
+
+    /** Delay line for long delays that stores its history as 16-bit samples in
+        block-companded pages: every page of pageSamples samples has its own scale
+        factor, so quiet passages keep the full resolution. The page being written
+        is staged as floats and encoded once it is complete, and reads only decode
+        the samples they ask for.
+    */
+    class CompactDelayLine
+    {
+    public:
+        enum { pageSamples = 64 };
+
+        CompactDelayLine (const int minimumLength);
+
+        void clear() noexcept;
+        void read (float* destination, int position, int numSamples) const noexcept;
+        void write (const float* source, int numSamples) noexcept;
+
+        int getLength() const noexcept { return length; }
+        int getWritePosition() const noexcept { return writePosition; }
+
+    private:
+        void encodePage (const int page) noexcept;
+
+        int numPages;
+        int length;
+        int writePosition;
+
+        DelayBuffer<int16> samples;
+        HeapBlock<float> pageScales;
+        float stagedPage[pageSamples];
+    };
+
+    //======================================
+
+    DelayDSP()
+    {
+        for (int tap = 1; tap < maxNumTaps; ++tap) {
+            const int tapNumber = tap + 1;
+            extraTaps[tap - 1] = { 0.1f * (float)tapNumber, 0.5f, (tapNumber % 2 == 0) ? -0.5f : 0.5f, 0.0f };
+        }
+    }
+
+    /** Allocates the lines of the selected type for the layout, for processing in
+        double precision or not. Preparing again with the same settings neither
+        allocates nor frees. Not real-time safe.
+    */
+    void prepare (const double newSampleRate, const int newNumChannels, const bool newDoublePrecision)
+    {
+        const ScopedLock lock (configurationLock);
+        sampleRate = newSampleRate;
+        numLineChannels = newNumChannels;
+        doublePrecision = newDoublePrecision;
+        prepareDelayLines (selectedDelayLine);
+
+        readHeads.prepare (sampleRate);
+        tempoSync.prepare (sampleRate);
+        channelWorkers->prepare (numLineChannels);
+    }
+
+    /** The buffers may be swapped by then, so the next block clears them, under
+        delayLinesLock. Real-time safe.
+    */
+    void reset() noexcept
+    {
+        clearPending = true;
+    }
+
+    /** Real-time safe, except for the delay line and the maximum delay time, which
+        reallocate the lines.
+    */
+    void setParameter (const int index, const float value)
+    {
+        switch (index) {
+            case parameterDelayTime:        currentDelayTime = value; return;
+            case parameterFeedback:         currentFeedback = value; return;
+            case parameterMix:              currentMix = value; return;
+            case parameterLongDelayTime:    currentLongDelayTime = value; return;
+            case parameterNumTaps:          currentNumTaps = jlimit (1, (int)maxNumTaps, (int)value); return;
+            case parameterDelayTimeChanges: currentDelayTimeChanges = jlimit ((int)delayTimeChangesJump,
+                                                                       (int)delayTimeChangesCrossfade, (int)value); return;
+            case parameterTempoSync:        currentSyncToTempo = (value != 0.0f); return;
+            case parameterNoteDivision:     currentNoteDivision = jlimit (0, TempoSync::numNoteDivisions - 1, (int)value); return;
+
+            case parameterDelayLine: {
+                const ScopedLock lock (configurationLock);
+                selectedDelayLine = jlimit ((int)delayLineFloat, (int)delayLineCompact, (int)value);
+                updateDelayLines (selectedDelayLine);
+                return;
+            }
+            case parameterMaxDelayTime: {
+                const ScopedLock lock (configurationLock);
+                maxDelayTime = value;
+                updateDelayLines (currentDelayLine);
+                return;
+            }
+        }
+
+        if (index >= parameterFirstTap && index < numParameters) {
+            ExtraTap& tap = extraTaps[(index - parameterFirstTap) / numTapParameters];
+            switch ((index - parameterFirstTap) % numTapParameters) {
+                case tapTime:     tap.time = value; break;
+                case tapGain:     tap.gain = value; break;
+                case tapPan:      tap.pan = value; break;
+                case tapFeedback: tap.feedback = value; break;
+            }
+        }
+    }
+
+    /** The tempo of the host in BPM, for the tempo sync, from the thread of
+        process(). Tempos of 0 or less, from hosts that do not report one, keep the
+        last tempo, 120 BPM at first.
+    */
+    void setHostTempo (const double bpm) noexcept
+    {
+        hostBpm = bpm;
+    }
+
+    /** Processes numSamples samples of numChannels channels in place. With double
+        precision, the float delay line keeps its history as doubles too, so the
+        feedback loop does not round to float on every pass.
+    */
+    template <typename SampleType>
+    void process (SampleType* const* channels, const int numChannels, const int numSamples) noexcept;
+
+    /** The longest delay in seconds that the current settings use, up to the
+        maximum delay time, and the feedback of the loop, which is the sum of the
+        sends of the taps.
+    */
+    float getLongestDelayTime() const noexcept;
+    float getTotalFeedback() const noexcept;
+
+    /** 16-bit samples and a scale factor per page for the compact lines. */
+    void addMemoryFootprint (MemoryFootprint& footprint) const
+    {
+        const ScopedLock lock (configurationLock);
+
+        footprint.add (MemoryFootprint::delayLines, delayBuffer);
+        footprint.add (MemoryFootprint::delayLines, doubleDelayBuffer);
+
+        for (int channel = 0; channel < compactDelayLines.size(); ++channel) {
+            const int length = compactDelayLines[channel]->getLength();
+            footprint.add (MemoryFootprint::delayLines, sizeof (int16) * (size_t)length
+                                                        + sizeof (float) * (size_t)(length / CompactDelayLine::pageSamples));
+        }
+    }
+
+private:
+    //==============================================================================
+
+    /** Processes a stretch of samples over which neither the write position nor
+        the two read positions wrap around the delay buffer. The stretch is no longer
+        than maxSegmentSamples, nor than the delay, so none of it reads a sample it
+        writes itself: the delayed samples are all read first, and the mix and the
+        feedback are straight passes over the arrays that vectorise.
+    */
+    template <typename SampleType, typename DelayType>
+    static void processSegment (SampleType* channelData,
+                                DelayType* writeData,
+                                const DelayType* readData1,
+                                const DelayType* readData2,
+                                const int numSamples,
+                                const SampleType fraction,
+                                const SampleType feedback,
+                                const SampleType mix) noexcept;
+
+   #if AUDIO_EFFECTS_FIXED_POINT
+    /** The segments of floats with float histories run in fixed point, the doubles
+        stay in floating point.
+    */
+    template <typename SampleType, typename DelayType>
+    static bool processSegmentFixedPoint (SampleType*, DelayType*, const DelayType*, const DelayType*,
+                                          const int, const SampleType, const SampleType, const SampleType) noexcept
+    {
+        return false;
+    }
+
+    static bool processSegmentFixedPoint (float* channelData, float* writeData, const float* readData1, const float* readData2,
+                                          const int numSamples, const float fraction, const float feedback, const float mix) noexcept
+    {
+        FixedPointKernels::feedbackDelay (channelData, writeData, readData1, readData2, numSamples, fraction, feedback, mix);
+        return true;
+    }
+   #endif
+
+    /** Same as processSegment(), with a delay of whole samples that the line reads
+        from two heads, the gain of the second one going up by gainStep per sample.
+    */
+    template <typename SampleType>
+    static void processCrossfadeSegment (SampleType* channelData,
+                                         SampleType* writeData,
+                                         const SampleType* readDataPrevious,
+                                         const SampleType* readData,
+                                         const int numSamples,
+                                         SampleType gain,
+                                         const SampleType gainStep,
+                                         const SampleType feedback,
+                                         const SampleType mix) noexcept;
+
+    /** Reads the float delay line at whole samples from readHeads, and crossfades
+        between the heads when the delay time changes instead of jumping. Outside of
+        the crossfades, the delayed samples are copied as they are.
+    */
+    template <typename SampleType>
+    void processReadHeads (SampleType* channelData,
+                           SampleType* delayData,
+                           const int numSamples,
+                           const SampleType feedback,
+                           const SampleType mix) const noexcept;
+
+    DelayReadHeads readHeads;
+
+    /** Delay time of the float line in samples, from the host tempo when it is synced. */
+    template <typename SampleType>
+    SampleType getDelayTimeSamples (const SampleType sampleRate) const noexcept;
+
+    TempoSync tempoSync;
+    double hostBpm = 0.0;
+
+    /** Only the buffer of the current processing precision is allocated. */
+    template <typename SampleType>
+    DelayBuffer<SampleType>& getDelayBuffer() noexcept;
+
+    DelayBuffer<float> delayBuffer;
+    DelayBuffer<double> doubleDelayBuffer;
+    int delayBufferSamples = 0;
+    int delayBufferMask = -1;
+    int delayWritePosition = 0;
+
+    /** Counts the samples written for updateDelayLines(), which moves them into
+        the next buffer.
+    */
+    DelayHistoryTransfer historyTransfer;
+    double delayLinesSampleRate = 0.0;
+
+    void advanceDelayWritePosition (const int numSamples) noexcept
+    {
+        delayWritePosition = (delayWritePosition + numSamples) & delayBufferMask;
+        historyTransfer.advance (numSamples);
+    }
+
+    template <typename SampleType>
+    static void processCompactDelayLine (CompactDelayLine& delayLine,
+                                         SampleType* channelData,
+                                         const int numSamples,
+                                         const SampleType delayTime,
+                                         const SampleType feedback,
+                                         const SampleType mix) noexcept;
+
+    enum { maxSegmentSamples = 256 };
+
+    //======================================
+
+    /** Settings of the taps after the first one, which takes the delay time and
+        feedback of the single delay, at full gain and centred.
+    */
+    struct ExtraTap
+    {
+        float time;
+        float gain;
+        float pan;
+        float feedback;
+    };
+
+    ExtraTap extraTaps[maxNumTaps - 1];
+
+    /** Delay, output gain and feedback send of a tap over one block. */
+    template <typename SampleType>
+    struct TapSettings
+    {
+        int readOffset;
+        SampleType fraction;
+        SampleType gain;
+        SampleType pan;
+        SampleType feedback;
+    };
+
+    /** Gathers the settings of the active taps with a delay of at least a sample,
+        and returns how many there are. The feedback sends are scaled down together
+        when their sum would make the loop unstable.
+    */
+    template <typename SampleType>
+    int getTapSettings (TapSettings<SampleType>* taps,
+                        const SampleType sampleRate,
+                        const SampleType firstDelayTime) const noexcept;
+
+    /** Multi-tap version of the float delay line for one channel. All the taps read
+        the one delay buffer of the channel, a segment at a time: each tap adds its
+        stretch of the segment to the wet and feedback sums, and the sums are then
+        mixed and written back in one pass, so the traffic is that of a single line
+        that is read a few more times from the cache.
+    */
+    template <typename SampleType>
+    void processTaps (SampleType* channelData,
+                      SampleType* delayData,
+                      const int channel,
+                      const int numChannels,
+                      const int numSamples,
+                      const TapSettings<SampleType>* taps,
+                      const int numTaps,
+                      const SampleType mix) const noexcept;
+
+    OwnedArray<CompactDelayLine> compactDelayLines;
+
+    /** Allocates the storage for the selected delay line type and swaps it in
+        under delayLinesLock, so the type can be changed while playing. It only
+        holds delays up to maxDelayTime, when that is below the range of the
+        delay time of the type, so sessions with many instances can keep their
+        buffers to what they use. Longer delays are clamped to it.
+
+        When only maxDelayTime changes on the float line, the history is copied
+        into the new buffer before the swap, as much of it as fits, so the echoes
+        carry on instead of stopping. Called under configurationLock.
+    */
+    void updateDelayLines (const int newDelayLine);
+
+    /** For prepare(), while the audio thread is stopped: resizes the storage in
+        use in place when it is of the same type, so preparing again with the same
+        settings neither allocates nor frees.
+    */
+    void prepareDelayLines (const int newDelayLine);
+
+    /** The configuration of the lines, only changed under configurationLock. */
+    CriticalSection configurationLock;
+    double sampleRate = 0.0;
+    int numLineChannels = 0;
+    bool doublePrecision = false;
+    int selectedDelayLine = delayLineFloat;
+    float maxDelayTime = maxCompactDelayTime;
+
+    SpinLock delayLinesLock;
+    int currentDelayLine = delayLineFloat;
+    std::atomic<bool> clearPending { false };
+
+    // The channels do not interact, so they can run on the workers
+    SharedResourcePointer<ChannelWorkerPool> channelWorkers;
+
+    //======================================
+
+    float currentDelayTime = 0.1f;
+    float currentFeedback = 0.7f;
+    float currentMix = 1.0f;
+    float currentLongDelayTime = 10.0f;
+    int currentNumTaps = 1;
+    int currentDelayTimeChanges = delayTimeChangesJump;
+    bool currentSyncToTempo = false;
+    int currentNoteDivision = TempoSync::noteDivisionQuarter;
+};
+
+//==============================================================================
+
+template <>
+inline DelayBuffer<float>& DelayDSP::getDelayBuffer<float>() noexcept
+{
+    return delayBuffer;
+}
+
+template <>
+inline DelayBuffer<double>& DelayDSP::getDelayBuffer<double>() noexcept
+{
+    return doubleDelayBuffer;
+}
+
+template <typename SampleType>
+void DelayDSP::process (SampleType* const* channels, const int numChannels, const int numSamples) noexcept
+{
+    const SampleType typedFeedback = (SampleType)currentFeedback;
+    const SampleType typedMix = (SampleType)currentMix;
+    const SampleType typedSampleRate = (SampleType)sampleRate;
+
+    const SpinLock::ScopedLockType lock (delayLinesLock);
+
+    if (clearPending.exchange (false)) {
+        getDelayBuffer<SampleType>().clear();
+        for (int channel = 0; channel < compactDelayLines.size(); ++channel)
+            compactDelayLines[channel]->clear();
+        readHeads.reset();
+    }
+
+    // The tempo changes the delay time without any automation, so it always
+    // takes the crossfade
+    if (currentSyncToTempo)
+        tempoSync.update (hostBpm, currentNoteDivision);
+
+    const bool crossfadeDelayTime = currentSyncToTempo || currentDelayTimeChanges == delayTimeChangesCrossfade;
+
+    // Only the single delay of the float line reads from the heads, so the other
+    // paths leave them to start again from their next delay
+    if (currentDelayLine == delayLineCompact || currentNumTaps > 1 || ! crossfadeDelayTime)
+        readHeads.reset();
+
+    if (currentDelayLine == delayLineCompact) {
+        const SampleType delaySamples = (SampleType)currentLongDelayTime * typedSampleRate;
+
+        channelWorkers->forEachChannel (jmin (numChannels, compactDelayLines.size()), [&] (const int channel) {
+            processCompactDelayLine (*compactDelayLines[channel], channels[channel],
+                                     numSamples, delaySamples, typedFeedback, typedMix);
+        });
+    } else if (currentNumTaps > 1) {
+        DelayBuffer<SampleType>& typedDelayBuffer = getDelayBuffer<SampleType>();
+        const int numDelayChannels = jmin (numChannels, typedDelayBuffer.getNumChannels());
+
+        TapSettings<SampleType> taps[maxNumTaps];
+        const int numActiveTaps = getTapSettings (taps, typedSampleRate, getDelayTimeSamples (typedSampleRate));
+
+        if (numActiveTaps > 0) {
+            channelWorkers->forEachChannel (numDelayChannels, [&] (const int channel) {
+                processTaps (channels[channel], typedDelayBuffer.getWritePointer (channel),
+                             channel, numDelayChannels, numSamples, taps, numActiveTaps, typedMix);
+            });
+        }
+
+        advanceDelayWritePosition (numSamples);
+    } else if (crossfadeDelayTime) {
+        const SampleType delaySamples = getDelayTimeSamples (typedSampleRate);
+        DelayBuffer<SampleType>& typedDelayBuffer = getDelayBuffer<SampleType>();
+
+        readHeads.setTarget (jlimit (0, delayBufferMask, roundToInt (delaySamples)));
+
+        if (readHeads.getOffset() > 0) {
+            channelWorkers->forEachChannel (jmin (numChannels, typedDelayBuffer.getNumChannels()), [&] (const int channel) {
+                processReadHeads (channels[channel], typedDelayBuffer.getWritePointer (channel),
+                                  numSamples, typedFeedback, typedMix);
+            });
+        }
+
+        readHeads.advance (numSamples);
+        advanceDelayWritePosition (numSamples);
+    } else {
+        const SampleType delaySamples = (SampleType)currentDelayTime * typedSampleRate;
+        DelayBuffer<SampleType>& typedDelayBuffer = getDelayBuffer<SampleType>();
+
+        // The delay time is constant over the block, so the read position trails
+        // the write position by a fixed offset and only the wrap-arounds of the
+        // buffer have to be found, once per segment instead of once per sample.
+        const int readOffset = jlimit (0, delayBufferMask, (int)std::ceil (delaySamples));
+        const SampleType fraction = (SampleType)readOffset - delaySamples;
+
+        // The second read is one sample closer, so a segment shorter than the delay
+        // does not depend on itself, as in processTaps()
+        const int maxSamples = jlimit (1, (int)maxSegmentSamples, readOffset - 1);
+
+        if (readOffset > 0) {
+            channelWorkers->forEachChannel (jmin (numChannels, typedDelayBuffer.getNumChannels()), [&] (const int channel) {
+                SampleType* channelData = channels[channel];
+                SampleType* delayData = typedDelayBuffer.getWritePointer (channel);
+                int localWritePosition = delayWritePosition;
+
+                for (int sample = 0; sample < numSamples;) {
+                    const int readPosition1 = (localWritePosition - readOffset) & delayBufferMask;
+                    const int readPosition2 = (readPosition1 + 1) & delayBufferMask;
+                    const int segmentSamples = jmin (jmin (numSamples - sample, maxSamples),
+                                                     delayBufferSamples - localWritePosition,
+                                                     delayBufferSamples - readPosition1,
+                                                     delayBufferSamples - readPosition2);
+
+                    processSegment (channelData + sample,
+                                    delayData + localWritePosition,
+                                    delayData + readPosition1,
+                                    delayData + readPosition2,
+                                    segmentSamples, fraction, typedFeedback, typedMix);
+
+                    sample += segmentSamples;
+                    localWritePosition = (localWritePosition + segmentSamples) & delayBufferMask;
+                }
+            });
+        }
+
+        advanceDelayWritePosition (numSamples);
+    }
+}
+
+//==============================================================================
+
+template <typename SampleType, typename DelayType>
+void DelayDSP::processSegment (SampleType* channelData,
+                               DelayType* writeData,
+                               const DelayType* readData1,
+                               const DelayType* readData2,
+                               const int numSamples,
+                               const SampleType fraction,
+                               const SampleType feedback,
+                               const SampleType mix) noexcept
+{
+    jassert (numSamples <= maxSegmentSamples);
+
+   #if AUDIO_EFFECTS_FIXED_POINT
+    if (processSegmentFixedPoint (channelData, writeData, readData1, readData2, numSamples, fraction, feedback, mix))
+        return;
+   #endif
+
+    // On the stack, as the channels may run at the same time
+    SampleType delayedSamples[maxSegmentSamples];
+
+    for (int sample = 0; sample < numSamples; ++sample) {
+        const SampleType delayed1 = readData1[sample];
+        const SampleType delayed2 = readData2[sample];
+        delayedSamples[sample] = delayed1 + fraction * (delayed2 - delayed1);
+    }
+
+    for (int sample = 0; sample < numSamples; ++sample) {
+        const SampleType in = channelData[sample];
+        const SampleType out = delayedSamples[sample];
+
+        channelData[sample] = in + mix * (out - in);
+        writeData[sample] = (DelayType)(in + out * feedback);
+    }
+}
+
+template <typename SampleType>
+void DelayDSP::processCrossfadeSegment (SampleType* channelData,
+                                        SampleType* writeData,
+                                        const SampleType* readDataPrevious,
+                                        const SampleType* readData,
+                                        const int numSamples,
+                                        SampleType gain,
+                                        const SampleType gainStep,
+                                        const SampleType feedback,
+                                        const SampleType mix) noexcept
+{
+    for (int sample = 0; sample < numSamples; ++sample) {
+        const SampleType in = channelData[sample];
+        const SampleType delayedPrevious = readDataPrevious[sample];
+        const SampleType out = delayedPrevious + gain * (readData[sample] - delayedPrevious);
+
+        channelData[sample] = in + mix * (out - in);
+        writeData[sample] = in + out * feedback;
+        gain += gainStep;
+    }
+}
+
+template <typename SampleType>
+void DelayDSP::processReadHeads (SampleType* channelData,
+                                 SampleType* delayData,
+                                 const int numSamples,
+                                 const SampleType feedback,
+                                 const SampleType mix) const noexcept
+{
+    const int readOffset = readHeads.getOffset();
+    const int previousReadOffset = readHeads.getPreviousOffset();
+    int localWritePosition = delayWritePosition;
+
+    for (int sample = 0; sample < numSamples;) {
+        const int readPosition = (localWritePosition - readOffset) & delayBufferMask;
+        const int fadeSamples = readHeads.getFadeSamplesLeft (sample);
+        int segmentSamples = jmin (numSamples - sample,
+                                   delayBufferSamples - localWritePosition,
+                                   delayBufferSamples - readPosition);
+
+        SampleType* segmentData = channelData + sample;
+        SampleType* writeData = delayData + localWritePosition;
+        const SampleType* readData = delayData + readPosition;
+
+        if (fadeSamples > 0) {
+            // The segment ends with the crossfade, so the rest of the block is a copy
+            const int previousReadPosition = (localWritePosition - previousReadOffset) & delayBufferMask;
+            segmentSamples = jmin (segmentSamples, fadeSamples, delayBufferSamples - previousReadPosition);
+
+            processCrossfadeSegment (segmentData, writeData, delayData + previousReadPosition, readData,
+                                     segmentSamples, readHeads.getFadeGain<SampleType> (sample),
+                                     readHeads.getFadeStep<SampleType>(), feedback, mix);
+        } else {
+            // No longer than the delay, so the copy does not read what it writes
+            segmentSamples = jmin (segmentSamples, readOffset);
+
+            for (int i = 0; i < segmentSamples; ++i) {
+                const SampleType in = segmentData[i];
+                const SampleType out = readData[i];
+
+                segmentData[i] = in + mix * (out - in);
+                writeData[i] = in + out * feedback;
+            }
+        }
+
+        sample += segmentSamples;
+        localWritePosition = (localWritePosition + segmentSamples) & delayBufferMask;
+    }
+}
+
+template <typename SampleType>
+SampleType DelayDSP::getDelayTimeSamples (const SampleType atSampleRate) const noexcept
+{
+    if (currentSyncToTempo)
+        return (SampleType)tempoSync.getDelaySamples();
+
+    return (SampleType)currentDelayTime * atSampleRate;
+}
+
+template <typename SampleType>
+int DelayDSP::getTapSettings (TapSettings<SampleType>* taps,
+                              const SampleType atSampleRate,
+                              const SampleType firstDelayTime) const noexcept
+{
+    SampleType totalFeedback = 0;
+    int numActiveTaps = 0;
+
+    for (int tap = 0; tap < currentNumTaps; ++tap) {
+        const bool first = (tap == 0);
+        const SampleType tapDelayTime = first ? firstDelayTime
+                                              : (SampleType)extraTaps[tap - 1].time * atSampleRate;
+
+        // As with the single delay, a tap with no delay leaves the input dry
+        const int readOffset = jlimit (0, delayBufferMask, (int)std::ceil (tapDelayTime));
+        if (readOffset == 0)
+            continue;
+
+        TapSettings<SampleType>& settings = taps[numActiveTaps++];
+        settings.readOffset = readOffset;
+        settings.fraction = (SampleType)readOffset - tapDelayTime;
+        settings.gain = first ? (SampleType)1 : (SampleType)extraTaps[tap - 1].gain;
+        settings.pan = first ? (SampleType)0 : (SampleType)extraTaps[tap - 1].pan;
+        settings.feedback = (SampleType)(first ? currentFeedback : extraTaps[tap - 1].feedback);
+        totalFeedback += settings.feedback;
+    }
+
+    // Every send is below 1, but their sum is not, so it is brought back to the
+    // range of the feedback of a single tap
+    const SampleType maxTotalFeedback = (SampleType)maxFeedback;
+    if (totalFeedback > maxTotalFeedback)
+        for (int tap = 0; tap < numActiveTaps; ++tap)
+            taps[tap].feedback *= maxTotalFeedback / totalFeedback;
+
+    return numActiveTaps;
+}
+
+template <typename SampleType>
+void DelayDSP::processTaps (SampleType* channelData,
+                            SampleType* delayData,
+                            const int channel,
+                            const int numChannels,
+                            const int numSamples,
+                            const TapSettings<SampleType>* taps,
+                            const int numTaps,
+                            const SampleType mix) const noexcept
+{
+    // The pan balances the two channels of a stereo layout, and other layouts ignore it
+    SampleType gains[maxNumTaps];
+    int minReadOffset = delayBufferSamples;
+    for (int tap = 0; tap < numTaps; ++tap) {
+        const SampleType pan = (numChannels == 2) ? taps[tap].pan : (SampleType)0;
+        const SampleType balance = (channel == 0) ? (SampleType)1 - pan : (SampleType)1 + pan;
+        gains[tap] = taps[tap].gain * jmin ((SampleType)1, balance);
+        minReadOffset = jmin (minReadOffset, taps[tap].readOffset);
+    }
+
+    // All the taps of a segment are read before any of it is written back, so it
+    // must not reach the samples it writes itself
+    const int maxSamples = jlimit (1, (int)maxSegmentSamples, minReadOffset - 1);
+
+    // On the stack, as the channels may run at the same time
+    SampleType wetSamples[maxSegmentSamples];
+    SampleType feedbackSamples[maxSegmentSamples];
+    int localWritePosition = delayWritePosition;
+
+    for (int sample = 0; sample < numSamples;) {
+        // Neither the write position nor the read positions of any tap wrap inside
+        // a segment, except for the second read of a tap at the end of the buffer,
+        // which is left a segment of one sample
+        int segmentSamples = jmin (numSamples - sample, maxSamples, delayBufferSamples - localWritePosition);
+        for (int tap = 0; tap < numTaps; ++tap) {
+            const int readPosition1 = (localWritePosition - taps[tap].readOffset) & delayBufferMask;
+            segmentSamples = jmin (segmentSamples, jmax (1, delayBufferSamples - 1 - readPosition1));
+        }
+
+        FloatVectorOperations::clear (wetSamples, segmentSamples);
+        FloatVectorOperations::clear (feedbackSamples, segmentSamples);
+
+        for (int tap = 0; tap < numTaps; ++tap) {
+            const int readPosition1 = (localWritePosition - taps[tap].readOffset) & delayBufferMask;
+            const int readPosition2 = (readPosition1 + 1) & delayBufferMask;
+            const SampleType* readData1 = delayData + readPosition1;
+            const SampleType* readData2 = delayData + readPosition2;
+            const SampleType fraction = taps[tap].fraction;
+            const SampleType gain = gains[tap];
+            const SampleType feedback = taps[tap].feedback;
+
+            for (int i = 0; i < segmentSamples; ++i) {
+                const SampleType delayed = readData1[i] + fraction * (readData2[i] - readData1[i]);
+                wetSamples[i] += gain * delayed;
+                feedbackSamples[i] += feedback * delayed;
+            }
+        }
+
+        SampleType* segmentData = channelData + sample;
+        SampleType* writeData = delayData + localWritePosition;
+        for (int i = 0; i < segmentSamples; ++i) {
+            const SampleType in = segmentData[i];
+            segmentData[i] = in + mix * (wetSamples[i] - in);
+            writeData[i] = in + feedbackSamples[i];
+        }
+
+        sample += segmentSamples;
+        localWritePosition = (localWritePosition + segmentSamples) & delayBufferMask;
+    }
+}
+
+template <typename SampleType>
+void DelayDSP::processCompactDelayLine (CompactDelayLine& delayLine,
+                                        SampleType* channelData,
+                                        const int numSamples,
+                                        const SampleType delayTime,
+                                        const SampleType feedback,
+                                        const SampleType mix) noexcept
+{
+    const int readOffset = jlimit (0, delayLine.getLength() - 1, (int)std::ceil (delayTime));
+    const SampleType fraction = (SampleType)readOffset - delayTime;
+
+    // Same as the float delay line, no delay leaves the input dry
+    if (readOffset == 0)
+        return;
+
+    // Each segment is decoded before any of it is written back, so it must not
+    // reach the samples it writes itself
+    const int maxSamples = jlimit (1, (int)maxSegmentSamples, readOffset - 1);
+
+    // On the stack, as the channels may run at the same time. The history is
+    // 16-bit, so it is decoded to floats for either processing precision
+    float delayedSamples[maxSegmentSamples + 1];
+    float feedbackSamples[maxSegmentSamples];
+
+    for (int sample = 0; sample < numSamples;) {
+        const int segmentSamples = jmin (numSamples - sample, maxSamples);
+
+        int readPosition = delayLine.getWritePosition() - readOffset;
+        if (readPosition < 0)
+            readPosition += delayLine.getLength();
+
+        delayLine.read (delayedSamples, readPosition, segmentSamples + 1);
+        processSegment (channelData + sample, feedbackSamples, delayedSamples, delayedSamples + 1,
+                        segmentSamples, fraction, feedback, mix);
+        delayLine.write (feedbackSamples, segmentSamples);
+
+        sample += segmentSamples;
+    }
+}
+
+//==============================================================================
+
+inline float DelayDSP::getLongestDelayTime() const noexcept
+{
+    if (currentDelayLine == delayLineCompact)
+        return jmin (currentLongDelayTime, maxDelayTime);
+
+    float longestDelayTime = currentSyncToTempo ? (float)tempoSync.getDelaySeconds() : currentDelayTime;
+    for (int tap = 1; tap < currentNumTaps; ++tap)
+        longestDelayTime = jmax (longestDelayTime, extraTaps[tap - 1].time);
+
+    return jmin (longestDelayTime, maxDelayTime);
+}
+
+inline float DelayDSP::getTotalFeedback() const noexcept
+{
+    if (currentDelayLine == delayLineCompact)
+        return currentFeedback;
+
+    float totalFeedback = currentFeedback;
+    for (int tap = 1; tap < currentNumTaps; ++tap)
+        totalFeedback += extraTaps[tap - 1].feedback;
+
+    return jmin (totalFeedback, maxFeedback);
+}
+
+inline void DelayDSP::updateDelayLines (const int newDelayLine)
+{
+    // Called from setParameter() before prepare() too
+    if (sampleRate <= 0.0)
+        return;
+
+    DelayBuffer<float> newDelayBuffer;
+    DelayBuffer<double> newDoubleDelayBuffer;
+    OwnedArray<CompactDelayLine> newCompactDelayLines;
+    int newDelayBufferSamples = 0;
+
+    if (newDelayLine == delayLineCompact) {
+        const float lineMaxDelayTime = jmin (maxCompactDelayTime, maxDelayTime);
+        for (int channel = 0; channel < numLineChannels; ++channel)
+            newCompactDelayLines.add (new CompactDelayLine ((int)(lineMaxDelayTime * (float)sampleRate) + 2));
+    } else {
+        const float lineMaxDelayTime = jmin (maxFloatDelayTime, maxDelayTime);
+        newDelayBufferSamples = nextPowerOfTwo ((int)(lineMaxDelayTime * (float)sampleRate) + 2);
+
+        if (doublePrecision)
+            newDoubleDelayBuffer.setSize (numLineChannels, newDelayBufferSamples);
+        else
+            newDelayBuffer.setSize (numLineChannels, newDelayBufferSamples);
+    }
+
+    // Only a float line of the same rate keeps its history. Its echoes go on
+    // while it is copied, and the audio thread only waits for the last few blocks.
+    const bool keepHistory = newDelayLine == currentDelayLine
+                          && newDelayLine != delayLineCompact
+                          && sampleRate == delayLinesSampleRate
+                          && delayBufferSamples > 0;
+
+    if (keepHistory) {
+        if (doublePrecision)
+            historyTransfer.copy (doubleDelayBuffer, delayBufferSamples, newDoubleDelayBuffer, newDelayBufferSamples, 1);
+        else
+            historyTransfer.copy (delayBuffer, delayBufferSamples, newDelayBuffer, newDelayBufferSamples, 1);
+    }
+
+    // The previous storage is freed after the lock is released
+    const SpinLock::ScopedLockType lock (delayLinesLock);
+
+    if (keepHistory) {
+        if (doublePrecision)
+            delayWritePosition = historyTransfer.finish (doubleDelayBuffer, delayBufferSamples, newDoubleDelayBuffer, newDelayBufferSamples, 1);
+        else
+            delayWritePosition = historyTransfer.finish (delayBuffer, delayBufferSamples, newDelayBuffer, newDelayBufferSamples, 1);
+
+        // The heads keep their delays unless the new buffer is too short for them
+        if (newDelayBufferSamples < delayBufferSamples)
+            readHeads.reset();
+    } else {
+        delayWritePosition = 0;
+        historyTransfer.reset();
+        readHeads.reset();
+    }
+
+    std::swap (delayBuffer, newDelayBuffer);
+    std::swap (doubleDelayBuffer, newDoubleDelayBuffer);
+    compactDelayLines.swapWith (newCompactDelayLines);
+
+    delayBufferSamples = newDelayBufferSamples;
+    delayBufferMask = delayBufferSamples - 1;
+    delayLinesSampleRate = sampleRate;
+    currentDelayLine = newDelayLine;
+}
+
+inline void DelayDSP::prepareDelayLines (const int newDelayLine)
+{
+    if (newDelayLine != currentDelayLine) {
+        updateDelayLines (newDelayLine);
+        return;
+    }
+
+    if (newDelayLine == delayLineCompact) {
+        // The compact lines are only built again when their length changes
+        const float lineMaxDelayTime = jmin (maxCompactDelayTime, maxDelayTime);
+        const int minimumLength = (int)(lineMaxDelayTime * (float)sampleRate) + 2;
+        const int length = (minimumLength + CompactDelayLine::pageSamples - 1)
+                         / CompactDelayLine::pageSamples * CompactDelayLine::pageSamples;
+
+        if (compactDelayLines.size() != numLineChannels || compactDelayLines[0]->getLength() != length) {
+            updateDelayLines (newDelayLine);
+            return;
+        }
+
+        for (CompactDelayLine* line : compactDelayLines)
+            line->clear();
+    } else {
+        const float lineMaxDelayTime = jmin (maxFloatDelayTime, maxDelayTime);
+        delayBufferSamples = nextPowerOfTwo ((int)(lineMaxDelayTime * (float)sampleRate) + 2);
+        delayBufferMask = delayBufferSamples - 1;
+
+        // Only allocates if the history grows or the precision changed
+        if (doublePrecision) {
+            doubleDelayBuffer.setSize (numLineChannels, delayBufferSamples);
+            delayBuffer.free();
+        } else {
+            delayBuffer.setSize (numLineChannels, delayBufferSamples);
+            doubleDelayBuffer.free();
+        }
+    }
+
+    delayWritePosition = 0;
+    delayLinesSampleRate = sampleRate;
+    historyTransfer.reset();
+    readHeads.reset();
+}
+
+//==============================================================================
+
+inline DelayDSP::CompactDelayLine::CompactDelayLine (const int minimumLength)
+    : numPages ((minimumLength + pageSamples - 1) / pageSamples)
+    , length (numPages * pageSamples)
+{
+    samples.setSize (1, length);
+    pageScales.calloc (numPages);
+    clear();
+}
+
+inline void DelayDSP::CompactDelayLine::clear() noexcept
+{
+    samples.clear();
+    zeromem (pageScales, sizeof (float) * (size_t)numPages);
+    zeromem (stagedPage, sizeof (stagedPage));
+    writePosition = 0;
+}
+
+inline void DelayDSP::CompactDelayLine::read (float* destination, int position, int numSamples) const noexcept
+{
+    const int writePage = writePosition / pageSamples;
+    const int numStagedSamples = writePosition % pageSamples;
+
+    while (numSamples > 0) {
+        const int page = position / pageSamples;
+        const int offset = position % pageSamples;
+        const int pageReadSamples = jmin (numSamples, pageSamples - offset);
+
+        const float scale = pageScales[page];
+        const int16* source = samples.getReadPointer (0) + position;
+
+        if (page == writePage) {
+            // Samples already written to this page are still staged as floats, the
+            // rest of the page holds its previous, encoded contents
+            for (int i = 0; i < pageReadSamples; ++i)
+                destination[i] = offset + i < numStagedSamples ? stagedPage[offset + i] : scale * (float)source[i];
+        } else {
+            for (int i = 0; i < pageReadSamples; ++i)
+                destination[i] = scale * (float)source[i];
+        }
+
+        destination += pageReadSamples;
+        numSamples -= pageReadSamples;
+        position += pageReadSamples;
+        if (position >= length)
+            position -= length;
+    }
+}
+
+inline void DelayDSP::CompactDelayLine::write (const float* source, int numSamples) noexcept
+{
+    while (numSamples > 0) {
+        const int offset = writePosition % pageSamples;
+        const int pageWriteSamples = jmin (numSamples, pageSamples - offset);
+
+        FloatVectorOperations::copy (stagedPage + offset, source, pageWriteSamples);
+
+        source += pageWriteSamples;
+        numSamples -= pageWriteSamples;
+        writePosition += pageWriteSamples;
+
+        if (offset + pageWriteSamples == pageSamples) {
+            encodePage (writePosition / pageSamples - 1);
+            if (writePosition >= length)
+                writePosition = 0;
+        }
+    }
+}
+
+inline void DelayDSP::CompactDelayLine::encodePage (const int page) noexcept
+{
+    const float peak = jmax (FloatVectorOperations::findMaximum (stagedPage, pageSamples),
+                             -FloatVectorOperations::findMinimum (stagedPage, pageSamples));
+
+    if (peak < 1.0e-30f) {
+        pageScales[page] = 0.0f;
+        zeromem (samples.getWritePointer (0) + page * pageSamples, sizeof (int16) * pageSamples);
+        return;
+    }
+
+    const float inverseScale = 32767.0f / peak;
+    pageScales[page] = peak / 32767.0f;
+
+    int16* destination = samples.getWritePointer (0) + page * pageSamples;
+    for (int i = 0; i < pageSamples; ++i)
+        destination[i] = (int16)roundToInt (stagedPage[i] * inverseScale);
+}
+
+//==============================================================================
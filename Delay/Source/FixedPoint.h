@@ -0,0 +1,220 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <limits>
+
+/** Set to 1 to run the kernels below in fixed point instead of float, for targets
+    without a fast FPU. The plugins build them instead of their float loops.
+*/
+#ifndef AUDIO_EFFECTS_FIXED_POINT
+ #define AUDIO_EFFECTS_FIXED_POINT 0
+#endif
+
+//==============================================================================
+
+/** Fixed-point versions of the per-sample loops of the Delay, the Tremolo, the
+    Distortion and the Compressor/Expander, with the signatures of their float
+    versions, so the processors and SimdKernels only swap the function they call.
+
+    The buffers of the host stay in float, so every kernel converts the samples as
+    it loads and stores them. The arithmetic in between is integer and saturates
+    instead of wrapping around:
+    - the samples are Q31 words with four integer bits (Q4.27), which leaves room
+      for the sums of the feedback loops and the makeup gains,
+    - the gains, fades and fractions are Q2.29, up to 4 (+12 dB),
+    - the clippers, whose outputs stay below 1, work in Q15; the conversion
+      saturates at 1 first, which does not change what they clip.
+*/
+class FixedPointKernels
+{
+public:
+    enum {
+        sampleBits = 27,
+        gainBits = 29,
+        clipBits = 15,
+    };
+
+    //==============================================================================
+
+    static int32 saturate (const int64 x) noexcept
+    {
+        return (int32)jlimit ((int64)std::numeric_limits<int32>::min(), (int64)std::numeric_limits<int32>::max(), x);
+    }
+
+    static int32 add (const int32 a, const int32 b) noexcept      { return saturate ((int64)a + (int64)b); }
+    static int32 subtract (const int32 a, const int32 b) noexcept { return saturate ((int64)a - (int64)b); }
+
+    /** a * b, with b in the format of the given number of fraction bits, rounded. */
+    template <int bits>
+    static int32 multiply (const int32 a, const int32 b) noexcept
+    {
+        return saturate (((int64)a * (int64)b + ((int64)1 << (bits - 1))) >> bits);
+    }
+
+    /** Truncates toward zero and saturates, NaN gives 0. */
+    static int32 toFixed (const float x, const int bits) noexcept
+    {
+        const float scaled = x * (float)(1 << bits);
+        if (scaled >= 2147483648.0f)
+            return std::numeric_limits<int32>::max();
+        if (scaled <= -2147483648.0f)
+            return std::numeric_limits<int32>::min();
+        return (scaled == scaled) ? (int32)scaled : 0;
+    }
+
+    static float fromFixed (const int32 x, const int bits) noexcept
+    {
+        return (float)x * (1.0f / (float)(1 << bits));
+    }
+
+    /** Q15 in an int32, saturated to the range of an int16. */
+    static int32 toQ15 (const float x) noexcept
+    {
+        return jlimit (-32768, 32767, toFixed (x, clipBits));
+    }
+
+    //==============================================================================
+
+    static void hardClip (float* samples, const int numSamples, const float threshold) noexcept
+    {
+        const int32 limit = toQ15 (threshold);
+
+        for (int sample = 0; sample < numSamples; ++sample)
+            samples[sample] = fromFixed (jlimit (-limit, limit, toQ15 (samples[sample])), clipBits);
+    }
+
+    /** The curve of SimdKernels::softClip(): 2x up to 1/3, 1 - (2 - 3x)^2 / 3 up to
+        2/3, then 1. The square is Q30 and its third is rounded back to Q15.
+    */
+    static void softClip (float* samples, const int numSamples, const float scale) noexcept
+    {
+        const int32 scaleQ15 = toQ15 (scale);
+
+        for (int sample = 0; sample < numSamples; ++sample) {
+            const int32 in = toQ15 (samples[sample]);
+            const int32 x = jmin (std::abs (in), (int32)twoThirds);
+
+            int32 shaped = 2 * x;
+            if (x > oneThird) {
+                const int32 quadratic = 2 * one - 3 * x;
+                shaped = one - multiply<30> (quadratic * quadratic, oneThird);
+            }
+
+            const int32 out = multiply<clipBits> (shaped, scaleQ15);
+            samples[sample] = fromFixed ((in < 0) ? -out : out, clipBits);
+        }
+    }
+
+    static void fullWaveRectify (float* samples, const int numSamples) noexcept
+    {
+        for (int sample = 0; sample < numSamples; ++sample) {
+            const int32 x = toFixed (samples[sample], sampleBits);
+            samples[sample] = fromFixed ((x == std::numeric_limits<int32>::min()) ? std::numeric_limits<int32>::max()
+                                                                                   : std::abs (x), sampleBits);
+        }
+    }
+
+    static void halfWaveRectify (float* samples, const int numSamples) noexcept
+    {
+        for (int sample = 0; sample < numSamples; ++sample)
+            samples[sample] = fromFixed (jmax (0, toFixed (samples[sample], sampleBits)), sampleBits);
+    }
+
+    /** samples = offset + scale * samples. */
+    static void scaleAndOffset (float* samples, const int numSamples, const float scale, const float offset) noexcept
+    {
+        const int32 scaleQ = toFixed (scale, gainBits);
+        const int32 offsetQ = toFixed (offset, sampleBits);
+
+        for (int sample = 0; sample < numSamples; ++sample) {
+            const int32 x = toFixed (samples[sample], sampleBits);
+            samples[sample] = fromFixed (add (offsetQ, multiply<gainBits> (x, scaleQ)), sampleBits);
+        }
+    }
+
+    /** Fades samples in over previous, as SimdKernels::crossfade(). The fade of each
+        sample is worked out in Q2.29 from the index, and the one returned in float.
+    */
+    static float crossfade (float* samples, const float* previous, const int numSamples,
+                            const float fade, const float step) noexcept
+    {
+        const int32 fadeQ = toFixed (fade, gainBits);
+        const int32 stepQ = toFixed (step, gainBits);
+        const int32 full = 1 << gainBits;
+
+        for (int sample = 0; sample < numSamples; ++sample) {
+            const int32 gain = (int32)jmin ((int64)full, (int64)fadeQ + (int64)stepQ * (int64)(sample + 1));
+            const int32 x = toFixed (samples[sample], sampleBits);
+            const int32 before = toFixed (previous[sample], sampleBits);
+            samples[sample] = fromFixed (add (before, multiply<gainBits> (subtract (x, before), gain)), sampleBits);
+        }
+
+        return jmin (1.0f, fade + step * (float)numSamples);
+    }
+
+    /** samples *= gains, such as for the gain computer of a compressor or an LFO. */
+    static void multiply (float* samples, const float* gains, const int numSamples) noexcept
+    {
+        for (int sample = 0; sample < numSamples; ++sample) {
+            const int32 x = toFixed (samples[sample], sampleBits);
+            samples[sample] = fromFixed (multiply<gainBits> (x, toFixed (gains[sample], gainBits)), sampleBits);
+        }
+    }
+
+    /** One segment of a feedback delay line read between two samples: the delayed
+        sample is mixed with the input, and written back with the input scaled by
+        the feedback. The reads must not overlap the writes.
+    */
+    static void feedbackDelay (float* samples, float* writeData, const float* readData1, const float* readData2,
+                               const int numSamples, const float fraction, const float feedback, const float mix) noexcept
+    {
+        const int32 fractionQ = toFixed (fraction, gainBits);
+        const int32 feedbackQ = toFixed (feedback, gainBits);
+        const int32 mixQ = toFixed (mix, gainBits);
+
+        for (int sample = 0; sample < numSamples; ++sample) {
+            const int32 in = toFixed (samples[sample], sampleBits);
+            const int32 delayed1 = toFixed (readData1[sample], sampleBits);
+            const int32 delayed2 = toFixed (readData2[sample], sampleBits);
+
+            const int32 out = add (delayed1, multiply<gainBits> (subtract (delayed2, delayed1), fractionQ));
+            samples[sample] = fromFixed (add (in, multiply<gainBits> (subtract (out, in), mixQ)), sampleBits);
+            writeData[sample] = fromFixed (add (in, multiply<gainBits> (out, feedbackQ)), sampleBits);
+        }
+    }
+
+private:
+    //==============================================================================
+
+    /** 1, a third and two thirds in Q15, the first one only in an int32. */
+    enum {
+        one = 1 << clipBits,
+        oneThird = 10923,
+        twoThirds = 21845,
+    };
+};
+
+//==============================================================================
@@ -102,10 +102,16 @@ DelayAudioProcessorEditor::DelayAudioProcessorEditor (DelayAudioProcessor& p)
 
     editorHeight += components.size() * editorPadding;
     setSize (editorWidth, editorHeight);
+    setOpaque (true);
+    setLookAndFeel (lookAndFeel);
+    renderingContext.attachTo (*this);
+    startTimer (50);
 }
 
 DelayAudioProcessorEditor::~DelayAudioProcessorEditor()
 {
+    renderingContext.detach();
+    setLookAndFeel (nullptr);
 }
 
 //==============================================================================
@@ -135,3 +141,26 @@ void DelayAudioProcessorEditor::resized()
 }
 
 //==============================================================================
+
+void DelayAudioProcessorEditor::timerCallback()
+{
+    // Only touches the components when something they show changed
+    if (uiValues.generationChanged (processor.parameters.getChangeGeneration())
+        && uiValues.changed ({ processor.paramDelayLine.getTargetValue(), processor.paramTempoSync.getTargetValue() }))
+        updateUIcomponents();
+}
+
+void DelayAudioProcessorEditor::updateUIcomponents()
+{
+    const bool compactDelayLine = processor.paramDelayLine.getTargetValue() == processor.delayLineCompact;
+
+    const bool tempoSync = (bool)processor.paramTempoSync.getTargetValue();
+
+    findChildWithID (processor.paramDelayTime.paramID)->setEnabled (! compactDelayLine && ! tempoSync);
+    findChildWithID (processor.paramLongDelayTime.paramID)->setEnabled (compactDelayLine);
+    findChildWithID (processor.paramDelayTimeChanges.paramID)->setEnabled (! compactDelayLine && ! tempoSync);
+    findChildWithID (processor.paramTempoSync.paramID)->setEnabled (! compactDelayLine);
+    findChildWithID (processor.paramNoteDivision.paramID)->setEnabled (! compactDelayLine && tempoSync);
+}
+
+//==============================================================================
@@ -41,13 +41,44 @@ DelayAudioProcessor::DelayAudioProcessor():
                    ),
 #endif
     parameters (*this)
-    , paramDelayTime (parameters, "Delay time", "s", 0.0f, 5.0f, 0.1f)
-    , paramFeedback (parameters, "Feedback", "", 0.0f, 0.9f, 0.7f)
+    , paramDelayTime (parameters, "Delay time", "s", 0.0f, DelayDSP::maxFloatDelayTime, 0.1f)
+    , paramFeedback (parameters, "Feedback", "", 0.0f, DelayDSP::maxFeedback, 0.7f)
     , paramMix (parameters, "Mix", "", 0.0f, 1.0f, 1.0f)
+    , paramDelayLine (parameters, "Delay line", delayLineItemsUI, delayLineFloat,
+                      [this](float value){ delay.setParameter (DelayDSP::parameterDelayLine, value); return value; })
+    , paramLongDelayTime (parameters, "Long delay time", "s", 0.0f, DelayDSP::maxCompactDelayTime, 10.0f)
+    , paramMaxDelayTime (parameters, "Max delay time", "s", 0.1f, DelayDSP::maxCompactDelayTime, DelayDSP::maxCompactDelayTime,
+                         [this](float value){ delay.setParameter (DelayDSP::parameterMaxDelayTime, value); return value; })
+    , paramNumTaps (parameters, "Number of taps",
+                    {"1", "2", "3", "4", "5", "6", "7", "8", "9", "10", "11", "12", "13", "14", "15", "16"}, 0,
+                    [](float value){ return value + 1; })
+    , paramDelayTimeChanges (parameters, "Delay time changes", delayTimeChangesItemsUI, delayTimeChangesJump)
+    , paramTempoSync (parameters, "Tempo sync", false)
+    , paramNoteDivision (parameters, "Note division", TempoSync::getNoteDivisionItems(), TempoSync::noteDivisionQuarter)
+    , bypass (*this, parameters)
 {
+    // Both reallocate the delay lines
+    paramDelayLine.deferCallback();
+    paramMaxDelayTime.deferCallback();
+
+    for (int tap = 1; tap < maxNumTaps; ++tap)
+        extraTaps.add (new Tap (*this, tap + 1));
+
     parameters.apvts.state = ValueTree (Identifier (getName().removeCharacters ("- ")));
 }
 
+DelayAudioProcessor::Tap::Tap (DelayAudioProcessor& p, const int tapNumber)
+    : timeName ("Tap " + String (tapNumber) + " time")
+    , gainName ("Tap " + String (tapNumber) + " gain")
+    , panName ("Tap " + String (tapNumber) + " pan")
+    , feedbackName ("Tap " + String (tapNumber) + " feedback")
+    , paramTime (p.parameters, timeName, "s", 0.0f, 5.0f, 0.1f * (float)tapNumber)
+    , paramGain (p.parameters, gainName, "", 0.0f, 1.0f, 0.5f)
+    , paramPan (p.parameters, panName, "", -1.0f, 1.0f, (tapNumber % 2 == 0) ? -0.5f : 0.5f)
+    , paramFeedback (p.parameters, feedbackName, "", 0.0f, 0.9f, 0.0f)
+{
+}
+
 DelayAudioProcessor::~DelayAudioProcessor()
 {
 }
@@ -56,31 +87,67 @@ DelayAudioProcessor::~DelayAudioProcessor()
 
 void DelayAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
+    TRACE_INSTANCE_SCOPE ("prepareToPlay", this);
+
     const double smoothTime = 1e-3;
     paramDelayTime.reset (sampleRate, smoothTime);
     paramFeedback.reset (sampleRate, smoothTime);
     paramMix.reset (sampleRate, smoothTime);
+    paramDelayLine.reset (sampleRate, smoothTime);
+    paramLongDelayTime.reset (sampleRate, smoothTime);
+    paramMaxDelayTime.reset (sampleRate, smoothTime);
+    paramNumTaps.reset (sampleRate, smoothTime);
+    paramDelayTimeChanges.reset (sampleRate, smoothTime);
+    paramTempoSync.reset (sampleRate, smoothTime);
+    paramNoteDivision.reset (sampleRate, smoothTime);
+    for (Tap* tap : extraTaps) {
+        tap->paramTime.reset (sampleRate, smoothTime);
+        tap->paramGain.reset (sampleRate, smoothTime);
+        tap->paramPan.reset (sampleRate, smoothTime);
+        tap->paramFeedback.reset (sampleRate, smoothTime);
+    }
 
     //======================================
 
-    float maxDelayTime = paramDelayTime.maxValue;
-    delayBufferSamples = (int)(maxDelayTime * (float)sampleRate) + 1;
-    if (delayBufferSamples < 1)
-        delayBufferSamples = 1;
+    parameters.flushDeferredCallbacks();
 
-    delayBufferChannels = getTotalNumInputChannels();
-    delayBuffer.setSize (delayBufferChannels, delayBufferSamples);
-    delayBuffer.clear();
+    updateDSPParameters();
+    delay.prepare (sampleRate, getTotalNumInputChannels(), isUsingDoublePrecision());
 
-    delayWritePosition = 0;
+    profiler.prepare (sampleRate);
+    silenceDetector.prepare (sampleRate);
+    bypass.prepare (sampleRate, samplesPerBlock, 0);
 }
 
 void DelayAudioProcessor::releaseResources()
 {
 }
 
+void DelayAudioProcessor::reset()
+{
+    delay.reset();
+}
+
 void DelayAudioProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
 {
+    process (buffer);
+}
+
+void DelayAudioProcessor::processBlock (AudioBuffer<double>& buffer, MidiBuffer& midiMessages)
+{
+    process (buffer);
+}
+
+bool DelayAudioProcessor::supportsDoublePrecisionProcessing() const
+{
+    return true;
+}
+
+template <typename SampleType>
+void DelayAudioProcessor::process (AudioBuffer<SampleType>& buffer)
+{
+    const ProcessBlockProfiler::ScopedMeasurement measurement (profiler, buffer.getNumSamples(), isNonRealtime());
+    TRACE_INSTANCE_SCOPE ("processBlock", this);
     ScopedNoDenormals noDenormals;
 
     const int numInputChannels = getTotalNumInputChannels();
@@ -89,66 +156,71 @@ void DelayAudioProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& m
 
     //======================================
 
-    float currentDelayTime = paramDelayTime.getTargetValue() * (float)getSampleRate();
-    float currentFeedback = paramFeedback.getNextValue();
-    float currentMix = paramMix.getNextValue();
-
-    int localWritePosition;
-
-    for (int channel = 0; channel < numInputChannels; ++channel) {
-        float* channelData = buffer.getWritePointer (channel);
-        float* delayData = delayBuffer.getWritePointer (channel);
-        localWritePosition = delayWritePosition;
-
-        for (int sample = 0; sample < numSamples; ++sample) {
-            const float in = channelData[sample];
-            float out = 0.0f;
-
-            float readPosition =
-                fmodf ((float)localWritePosition - currentDelayTime + (float)delayBufferSamples, delayBufferSamples);
-            int localReadPosition = floorf (readPosition);
+    parameters.applyDeferredValues();
+    parameters.applySnapshotMorph();
 
-            if (localReadPosition != localWritePosition) {
-                float fraction = readPosition - (float)localReadPosition;
-                float delayed1 = delayData[(localReadPosition + 0)];
-                float delayed2 = delayData[(localReadPosition + 1) % delayBufferSamples];
-                out = delayed1 + fraction * (delayed2 - delayed1);
+    if (silenceDetector.skipBlock (*this, buffer))
+        return;
 
-                channelData[sample] = in + currentMix * (out - in);
-                delayData[localWritePosition] = in + out * currentFeedback;
-            }
+    if (bypass.begin (buffer))
+        return;
 
-            if (++localWritePosition >= delayBufferSamples)
-                localWritePosition -= delayBufferSamples;
-        }
+    // The tempo sync follows the tempo of the host, read once a block
+    if ((bool)paramTempoSync.getTargetValue()) {
+        AudioPlayHead::CurrentPositionInfo position;
+        AudioPlayHead* playHead = getPlayHead();
+        if (playHead != nullptr && playHead->getCurrentPosition (position))
+            delay.setHostTempo (position.bpm);
     }
 
-    delayWritePosition = localWritePosition;
+    updateDSPParameters();
+    delay.process (buffer.getArrayOfWritePointers(), numInputChannels, numSamples);
 
     //======================================
 
     for (int channel = numInputChannels; channel < numOutputChannels; ++channel)
         buffer.clear (channel, 0, numSamples);
+
+    bypass.end (buffer);
 }
 
 //==============================================================================
 
-
-
-
-
+void DelayAudioProcessor::updateDSPParameters() noexcept
+{
+    delay.setParameter (DelayDSP::parameterDelayTime, paramDelayTime.getTargetValue());
+    delay.setParameter (DelayDSP::parameterFeedback, paramFeedback.getTargetValue());
+    delay.setParameter (DelayDSP::parameterMix, paramMix.getTargetValue());
+    delay.setParameter (DelayDSP::parameterLongDelayTime, paramLongDelayTime.getTargetValue());
+    delay.setParameter (DelayDSP::parameterNumTaps, paramNumTaps.getTargetValue());
+    delay.setParameter (DelayDSP::parameterDelayTimeChanges, paramDelayTimeChanges.getTargetValue());
+    delay.setParameter (DelayDSP::parameterTempoSync, paramTempoSync.getTargetValue());
+    delay.setParameter (DelayDSP::parameterNoteDivision, paramNoteDivision.getTargetValue());
+
+    for (int tap = 1; tap < maxNumTaps; ++tap) {
+        const Tap& extraTap = *extraTaps[tap - 1];
+        delay.setParameter (DelayDSP::getTapParameterIndex (tap + 1, DelayDSP::tapTime), extraTap.paramTime.getTargetValue());
+        delay.setParameter (DelayDSP::getTapParameterIndex (tap + 1, DelayDSP::tapGain), extraTap.paramGain.getTargetValue());
+        delay.setParameter (DelayDSP::getTapParameterIndex (tap + 1, DelayDSP::tapPan), extraTap.paramPan.getTargetValue());
+        delay.setParameter (DelayDSP::getTapParameterIndex (tap + 1, DelayDSP::tapFeedback), extraTap.paramFeedback.getTargetValue());
+    }
+}
 
 //==============================================================================
 
 void DelayAudioProcessor::getStateInformation (MemoryBlock& destData)
 {
-    auto state = parameters.apvts.copyState();
-    std::unique_ptr<XmlElement> xml (state.createXml());
-    copyXmlToBinary (*xml, destData);
+    MemoryOutputStream stream (destData, false);
+    parameters.writeState (stream);
 }
 
 void DelayAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
+    MemoryInputStream stream (data, (size_t)sizeInBytes, false);
+    if (parameters.readState (stream))
+        return;
+
+    // Sessions saved in the XML format of older versions
     std::unique_ptr<XmlElement> xmlState (getXmlFromBinary (data, sizeInBytes));
 
     if (xmlState.get() != nullptr)
@@ -177,10 +249,9 @@ bool DelayAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) co
     ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    if (layouts.getMainOutputChannelSet() != AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != AudioChannelSet::stereo())
+    // The channels are processed independently, so any layout with at least one
+    // channel is supported, from mono to surround sets or ambisonic stems.
+    if (layouts.getMainOutputChannelSet().isDisabled())
         return false;
 
     // This checks if the input layout matches the output layout
@@ -230,7 +301,13 @@ bool DelayAudioProcessor::isMidiEffect() const
 
 double DelayAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // With several taps, the loop is bounded by the sum of the sends and the longest tap
+    return SilenceDetector::getFeedbackTailSeconds (delay.getTotalFeedback(), delay.getLongestDelayTime());
+}
+
+AudioProcessorParameter* DelayAudioProcessor::getBypassParameter() const
+{
+    return bypass.getParameter();
 }
 
 //==============================================================================
@@ -261,6 +338,31 @@ void DelayAudioProcessor::changeProgramName (int index, const String& newName)
 
 //==============================================================================
 
+MemoryFootprint DelayAudioProcessor::getMemoryFootprint() const
+{
+    const ScopedLock lock (parameters.deferredCallbackLock);
+
+    MemoryFootprint footprint;
+    footprint.add (MemoryFootprint::other, sizeof (*this));
+    bypass.addMemoryFootprint (footprint);
+
+    delay.addMemoryFootprint (footprint);
+
+    return footprint;
+}
+
+void DelayAudioProcessor::trimMemory()
+{
+    const float delayTime = delay.getLongestDelayTime();
+    const float newMaxDelayTime = jlimit (paramMaxDelayTime.minValue, paramMaxDelayTime.maxValue,
+                                          std::ceil (delayTime * 10.0f) / 10.0f);
+    if (newMaxDelayTime < paramMaxDelayTime.getTargetValue())
+        if (RangedAudioParameter* parameter = parameters.apvts.getParameter (paramMaxDelayTime.paramID))
+            parameter->setValueNotifyingHost (parameter->convertTo0to1 (newMaxDelayTime));
+}
+
+//==============================================================================
+
 // This creates new instances of the plugin..
 AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
@@ -30,10 +30,15 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "PluginParameter.h"
+#include "ProcessBlockProfiler.h"
+#include "SilenceDetector.h"
+#include "PluginBypass.h"
+#include "MemoryFootprint.h"
+#include "DelayDSP.h"
 
 //==============================================================================
 
-class DelayAudioProcessor : public AudioProcessor
+class DelayAudioProcessor : public AudioProcessor, public MemoryFootprintSource
 {
 public:
     //==============================================================================
@@ -45,7 +50,10 @@ public:
 
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
+    void reset() override;
     void processBlock (AudioSampleBuffer&, MidiBuffer&) override;
+    void processBlock (AudioBuffer<double>&, MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override;
 
     //==============================================================================
 
@@ -78,6 +86,7 @@ public:
     bool producesMidi() const override;
     bool isMidiEffect () const override;
     double getTailLengthSeconds() const override;
+    AudioProcessorParameter* getBypassParameter() const override;
 
     //==============================================================================
 
@@ -89,17 +98,80 @@ public:
 
     //==============================================================================
 
+    MemoryFootprint getMemoryFootprint() const override;
 
+    /** Lowers the maximum delay time to the longest delay that the current settings
+        use, so the lines are reallocated to it, with their history, by the deferred
+        callback of paramMaxDelayTime. Longer delays set later, or a slower tempo, are
+        clamped to it until the maximum is raised again.
+    */
+    void trimMemory() override;
 
+    //==============================================================================
 
+    StringArray delayLineItemsUI = {
+        "Float, up to 5 s",
+        "16-bit, up to 60 s"
+    };
 
+    enum delayLineIndex {
+        delayLineFloat = DelayDSP::delayLineFloat,
+        delayLineCompact = DelayDSP::delayLineCompact,
+    };
 
-    //==============================================================================
+    StringArray delayTimeChangesItemsUI = {
+        "Jump",
+        "Crossfade"
+    };
+
+    enum delayTimeChangesIndex {
+        delayTimeChangesJump = DelayDSP::delayTimeChangesJump,
+        delayTimeChangesCrossfade = DelayDSP::delayTimeChangesCrossfade,
+    };
+
+    //======================================
+
+    /** Runs both processBlock() overloads. */
+    template <typename SampleType>
+    void process (AudioBuffer<SampleType>& buffer);
+
+    /** Hands the values of the parameters to the core, once a block. The delay
+        line and the maximum delay time reallocate the lines, so their deferred
+        callbacks hand them over instead.
+    */
+    void updateDSPParameters() noexcept;
+
+    DelayDSP delay;
+
+    //======================================
+
+    enum { maxNumTaps = DelayDSP::maxNumTaps };
+
+    /** Parameters of the taps after the first one, which takes the delay time and
+        feedback of the single delay, at full gain and centred.
+    */
+    class Tap
+    {
+    public:
+        Tap (DelayAudioProcessor& processor, const int tapNumber);
+
+        const String timeName;
+        const String gainName;
+        const String panName;
+        const String feedbackName;
+
+        PluginParameterLinSlider paramTime;
+        PluginParameterLinSlider paramGain;
+        PluginParameterLinSlider paramPan;
+        PluginParameterLinSlider paramFeedback;
+    };
+
+    OwnedArray<Tap> extraTaps;
+
+    //======================================
 
-    AudioSampleBuffer delayBuffer;
-    int delayBufferSamples;
-    int delayBufferChannels;
-    int delayWritePosition;
+    ProcessBlockProfiler profiler;
+    SilenceDetector silenceDetector;
 
     //======================================
 
@@ -108,6 +180,15 @@ public:
     PluginParameterLinSlider paramDelayTime;
     PluginParameterLinSlider paramFeedback;
     PluginParameterLinSlider paramMix;
+    PluginParameterComboBox paramDelayLine;
+    PluginParameterLinSlider paramLongDelayTime;
+    PluginParameterLinSlider paramMaxDelayTime;
+    PluginParameterComboBox paramNumTaps;
+    PluginParameterComboBox paramDelayTimeChanges;
+    PluginParameterToggle paramTempoSync;
+    PluginParameterComboBox paramNoteDivision;
+
+    PluginBypass bypass;
 
 private:
     //==============================================================================
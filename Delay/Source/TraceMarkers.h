@@ -0,0 +1,210 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "RealtimeSafety.h"
+#include <atomic>
+#include <map>
+
+/** Set to 1 to record the trace zones, which compile to nothing otherwise. */
+#ifndef AUDIO_EFFECTS_TRACING
+ #define AUDIO_EFFECTS_TRACING 0
+#endif
+
+//==============================================================================
+
+/** Zone markers for a system tracer.
+
+    TRACE_INSTANCE_SCOPE (name, instance) records the beginning and the end of the
+    enclosing scope for a plugin instance, any pointer that identifies it, usually
+    the processor. TRACE_SCOPE (name) records a zone for the instance of the
+    innermost TRACE_INSTANCE_SCOPE of the thread, so the code that processBlock and
+    the parameter callbacks call does not need to know its processor. The names
+    must be string literals.
+
+    Recording takes an atomic increment and a store into a preallocated array, and
+    the events past its capacity are dropped and counted. When the program exits,
+    or when writeTrace() is called, the events are written in the JSON trace event format,
+    which Perfetto and the Chrome trace viewer open and Tracy imports. Every
+    instance is a process of the trace and every thread a thread of it.
+*/
+#if AUDIO_EFFECTS_TRACING
+ #define TRACE_INSTANCE_SCOPE(name, instance) \
+    const TraceMarkers::ScopedZone JUCE_JOIN_MACRO (traceZone, __LINE__) (name, instance)
+ #define TRACE_SCOPE(name) \
+    const TraceMarkers::ScopedZone JUCE_JOIN_MACRO (traceZone, __LINE__) (name)
+#else
+ #define TRACE_INSTANCE_SCOPE(name, instance)
+ #define TRACE_SCOPE(name)
+#endif
+
+#if AUDIO_EFFECTS_TRACING
+
+class TraceMarkers
+{
+public:
+    class ScopedZone
+    {
+    public:
+        ScopedZone (const char* zoneName, const void* zoneInstance) noexcept
+            : name (zoneName)
+            , instance (zoneInstance)
+            , previousInstance (getCurrentInstance())
+        {
+            getCurrentInstance() = instance;
+            record (name, 'B', instance);
+        }
+
+        explicit ScopedZone (const char* zoneName) noexcept
+            : ScopedZone (zoneName, getCurrentInstance())
+        {
+        }
+
+        ~ScopedZone()
+        {
+            record (name, 'E', instance);
+            getCurrentInstance() = previousInstance;
+        }
+
+    private:
+        const char* name;
+        const void* instance;
+        const void* previousInstance;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedZone)
+    };
+
+    //======================================
+
+    /** Writes the events recorded so far, best called with the audio stopped, as
+        the zones still running may be half written. The trace is written again at
+        exit, to a file of the temporary directory.
+    */
+    static void writeTrace (const File& file)
+    {
+        getRecorder().write (file);
+    }
+
+private:
+    //======================================
+
+    struct Event
+    {
+        const char* name;
+        const void* instance;
+        Thread::ThreadID thread;
+        int64 ticks;
+        char phase;
+    };
+
+    struct Recorder
+    {
+        enum { capacity = 1 << 20 };
+
+        Recorder()
+        {
+            // Made by the first zone, which may well be on the audio thread
+            const RealtimeSafety::ScopedExemption exemption;
+            events.malloc (capacity);
+        }
+
+        ~Recorder()
+        {
+            write (File::getSpecialLocation (File::tempDirectory)
+                       .getChildFile ("AudioEffectsTrace-" + Time::getCurrentTime().formatted ("%Y%m%d-%H%M%S"))
+                       .withFileExtension ("json"));
+        }
+
+        void write (const File& file) const
+        {
+            const int numRecorded = jmin ((int)capacity, numEvents.load());
+            if (numRecorded == 0)
+                return;
+
+            // The pointers and the thread handles become small numbers only here,
+            // off the audio thread, and nullptr is instance 0
+            std::map<const void*, int> instanceIds { { nullptr, 0 } };
+            std::map<Thread::ThreadID, int> threadIds;
+            const double microsecondsPerTick = 1e6 / (double)Time::getHighResolutionTicksPerSecond();
+            const int64 startTicks = events[0].ticks;
+
+            FileOutputStream stream (file);
+            if (! stream.openedOk())
+                return;
+
+            stream.setPosition (0);
+            stream.truncate();
+            stream << "{\"otherData\":{\"droppedEvents\":\"" << jmax (0, numEvents.load() - (int)capacity)
+                   << "\"},\n\"traceEvents\":[";
+
+            const char* separator = "\n";
+            for (int index = 0; index < numRecorded; ++index) {
+                const Event& event = events[index];
+                const int instanceId = instanceIds.emplace (event.instance, (int)instanceIds.size()).first->second;
+                const int threadId = threadIds.emplace (event.thread, (int)threadIds.size() + 1).first->second;
+
+                stream << separator << "{\"name\":\"" << event.name << "\",\"ph\":\"" << String::charToString (event.phase)
+                       << "\",\"ts\":" << String ((double)(event.ticks - startTicks) * microsecondsPerTick, 3)
+                       << ",\"pid\":" << instanceId << ",\"tid\":" << threadId << "}";
+                separator = ",\n";
+            }
+
+            for (const auto& instance : instanceIds)
+                stream << ",\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << instance.second
+                       << ",\"args\":{\"name\":\"Instance " << instance.second << "\"}}";
+
+            stream << "\n]}\n";
+        }
+
+        HeapBlock<Event> events;
+        std::atomic<int> numEvents { 0 };
+    };
+
+    static Recorder& getRecorder()
+    {
+        static Recorder recorder;
+        return recorder;
+    }
+
+    static const void*& getCurrentInstance() noexcept
+    {
+        static thread_local const void* currentInstance = nullptr;
+        return currentInstance;
+    }
+
+    static void record (const char* name, const char phase, const void* instance) noexcept
+    {
+        Recorder& recorder = getRecorder();
+
+        // Past the capacity, the events are only counted
+        const int index = recorder.numEvents.fetch_add (1, std::memory_order_relaxed);
+        if (index < (int)Recorder::capacity)
+            recorder.events[index] = { name, instance, Thread::getCurrentThreadId(), Time::getHighResolutionTicks(), phase };
+    }
+};
+
+#endif
+
+//==============================================================================
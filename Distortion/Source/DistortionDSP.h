@@ -0,0 +1,589 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+
+
+#pragma once
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "MemoryFootprint.h"
+#include "TraceMarkers.h"
+#include "FastMath.h"
+#include "SimdKernels.h"
+
+//==============================================================================
+
+/** The audio processing of the Distortion, without the parameters, state, editor
+    or buses of the plugin, for hosts that only need the audio and run many
+    instances. DistortionAudioProcessor wraps one and hands it the values of its
+    parameters once a block, in their natural units: the index of the distortion
+    type, the output gain as a linear gain, the tone in dB, the index of the
+    oversampling factor and the antialiasing as 0 or 1.
+*/
+class DistortionDSP
+{
+public:
+    enum parameterIndex {
+        parameterDistortionType = 0,
+        parameterOutputGain,
+        parameterTone,
+        parameterOversampling,
+        parameterAntialiasing,
+        numParameters,
+    };
+
+    enum distortionTypeIndex {
+        distortionTypeHardClipping = 0,
+        distortionTypeSoftClipping,
+        distortionTypeExponential,
+        distortionTypeFullWaveRectifier,
+        distortionTypeHalfWaveRectifier,
+    };
+
+    enum oversamplingIndex {
+        oversamplingNone = 0,
+        oversampling2x,
+        oversampling4x,
+        oversampling8x,
+    };
+
+    /** Builds the tone filters and one oversampler per factor, for blocks of up to
+        maxBlockSize samples, so that switching the factor never allocates. The
+        output gain ramps over smoothTime seconds. Not real-time safe.
+    */
+    void prepare (const double sampleRate, const int numChannels, const int maxBlockSize, const double smoothTime);
+
+    void reset() noexcept;
+
+    void setParameter (const int index, const float value) noexcept
+    {
+        switch (index) {
+            case parameterDistortionType: currentDistortionType = jlimit ((int)distortionTypeHardClipping,
+                                                                          (int)distortionTypeHalfWaveRectifier, (int)value); break;
+            case parameterOutputGain:     smoothedOutputGain.setTargetValue (value); break;
+            case parameterOversampling:   selectedOversampling = jlimit ((int)oversamplingNone, (int)oversampling8x, (int)value); break;
+            case parameterAntialiasing:   selectedAntialiasing = (value > 0.5f); break;
+            case parameterTone: {
+                if (value != currentTone) {
+                    currentTone = value;
+                    updateFilters();
+                }
+                break;
+            }
+        }
+    }
+
+    /** The steps of reduction of a quality governor, each of which lowers the
+        oversampling factor below the one chosen by one step, with a crossfade.
+    */
+    void setQualityReduction (const int newQualityReduction) noexcept
+    {
+        qualityReduction = newQualityReduction;
+    }
+
+    /** Latency of an oversampling factor, once prepared, and the highest of them. */
+    int getLatencySamples (const int oversampling) const;
+    int getMaxLatencySamples() const noexcept { return maxOversamplingLatency; }
+
+    /** Processes numSamples samples of numChannels channels in place. */
+    void process (float* const* channels, const int numChannels, const int numSamples) noexcept;
+
+    void addMemoryFootprint (MemoryFootprint& footprint) const;
+
+private:
+    //==============================================================================
+
+    /** Distorts the samples of a channel. With antialiasing, previousInput holds the
+        last input of the channel from one call to the next.
+    */
+    void distort (float* samples, const int numSamples, const int distortionType,
+                  const bool antialiasing, float& previousInput);
+
+    /** One branch-free kernel per distortion type, chosen once per block. The
+        exponential one is left to the compiler, the others run the kernels of the
+        widest instruction set of the CPU.
+    */
+    template <int distortionType>
+    static void distort (float* samples, const int numSamples) noexcept;
+
+    /** First order antiderivative antialiasing: every output is the mean of the shape
+        between the previous input and the current one, the difference of the
+        antiderivative over the difference of the inputs. It smooths the corners that
+        alias, at about twice the cost of the plain kernel and half a sample of delay.
+    */
+    template <int distortionType>
+    static void distortAntialiased (float* samples, const int numSamples, float& previousInput) noexcept;
+
+    template <int distortionType>
+    static float shape (const float in) noexcept;
+
+    template <int distortionType>
+    static double antiderivative (const double in) noexcept;
+
+    /** Below this difference between inputs the quotient is ill-conditioned, and the
+        shape at the midpoint, which is its limit, is used instead.
+    */
+    static constexpr double antialiasingTolerance = 1e-5;
+
+    // The previous input of every channel, for every path
+    HeapBlock<float> antialiasingInputs;
+    int antialiasingStride = 0;
+    bool currentAntialiasing = false;
+
+    //======================================
+
+    /** One oversampler per factor. The index of the choice is the log2 of the factor. */
+    OwnedArray<dsp::Oversampling<float>> oversamplers;
+    int oversamplingBlockSize = 1;
+    int maxOversamplingLatency = 0;
+
+    /** The quality governor lowers the factor below the one chosen. Every factor has
+        its own path, with its own delay up to the latency of the factor chosen, so the
+        latency reported does not change, and the path of the previous factor keeps
+        running on a copy of the input in fadeBuffer while the new one fades in.
+    */
+    enum { numOversamplingPaths = oversampling8x + 1 };
+
+    void startOversamplingPath (const int oversampling);
+    void processOversamplingPath (dsp::AudioBlock<float>& block, const int oversampling,
+                                  const int distortionType, const bool antialiasing);
+
+    static constexpr double oversamplingFadeTime = 10e-3;
+
+    int chosenOversampling = oversamplingNone;
+    int currentOversampling = oversamplingNone;
+    int previousOversampling = -1;
+    float oversamplingFade = 0.0f;
+    float oversamplingFadeStep = 1.0f;
+    AudioSampleBuffer fadeBuffer;
+    AudioSampleBuffer compensationBuffer;
+    int compensationMask = 0;
+    int compensationDelays[numOversamplingPaths] = {};
+    int compensationPositions[numOversamplingPaths] = {};
+
+    //======================================
+
+    class Filter : public IIRFilter
+    {
+    public:
+        void updateCoefficients (const double discreteFrequency,
+                                 const double gain) noexcept
+        {
+            jassert (discreteFrequency > 0);
+
+            double tan_half_wc = tan (discreteFrequency / 2.0);
+            double sqrt_gain = sqrt (gain);
+
+            coefficients = IIRCoefficients (/* b0 */ sqrt_gain * tan_half_wc + gain,
+                                            /* b1 */ sqrt_gain * tan_half_wc - gain,
+                                            /* b2 */ 0.0,
+                                            /* a0 */ sqrt_gain * tan_half_wc + 1.0,
+                                            /* a1 */ sqrt_gain * tan_half_wc - 1.0,
+                                            /* a2 */ 0.0);
+            setCoefficients (coefficients);
+        }
+    };
+
+    OwnedArray<Filter> filters;
+    void updateFilters();
+
+    //======================================
+
+    const SimdKernels& kernels = SimdKernels::get();
+
+    int qualityReduction = 0;
+
+    int currentDistortionType = distortionTypeFullWaveRectifier;
+    float currentTone = 12.0f;
+    int selectedOversampling = oversamplingNone;
+    bool selectedAntialiasing = false;
+    LinearSmoothedValue<float> smoothedOutputGain { 0.0630957f };
+};
+
+//==============================================================================
+
+inline void DistortionDSP::prepare (const double sampleRate, const int numChannels, const int maxBlockSize,
+                                    const double smoothTime)
+{
+    smoothedOutputGain.reset (sampleRate, smoothTime);
+
+    filters.clear();
+    for (int i = 0; i < numChannels; ++i) {
+        Filter* filter;
+        filters.add (filter = new Filter());
+    }
+    updateFilters();
+
+    maxOversamplingLatency = 0;
+    oversamplers.clear();
+    for (int i = oversampling2x; i <= oversampling8x; ++i) {
+        dsp::Oversampling<float>* oversampler;
+        oversamplers.add (oversampler = new dsp::Oversampling<float> ((size_t)numChannels, (size_t)i,
+                                                                     dsp::Oversampling<float>::filterHalfBandPolyphaseIIR,
+                                                                     true, true));
+        oversampler->initProcessing ((size_t)maxBlockSize);
+        maxOversamplingLatency = jmax (maxOversamplingLatency, roundToInt (oversampler->getLatencyInSamples()));
+    }
+    oversamplingBlockSize = jmax (1, maxBlockSize);
+
+    const int numPathChannels = jmax (1, numChannels);
+    antialiasingStride = numPathChannels;
+    antialiasingInputs.calloc ((size_t)(numOversamplingPaths * antialiasingStride));
+    currentAntialiasing = false;
+
+    compensationMask = nextPowerOfTwo (maxOversamplingLatency + 1) - 1;
+    compensationBuffer.setSize (numOversamplingPaths * numPathChannels, compensationMask + 1);
+    fadeBuffer.setSize (numPathChannels, jmax (1, maxBlockSize));
+    oversamplingFadeStep = (float)(1.0 / jmax (1.0, oversamplingFadeTime * sampleRate));
+
+    chosenOversampling = selectedOversampling;
+    previousOversampling = -1;
+    startOversamplingPath (chosenOversampling);
+}
+
+inline void DistortionDSP::reset() noexcept
+{
+    for (int i = 0; i < filters.size(); ++i)
+        filters[i]->reset();
+    for (int i = 0; i < oversamplers.size(); ++i)
+        oversamplers[i]->reset();
+    if (antialiasingInputs != nullptr)
+        zeromem (antialiasingInputs, sizeof (float) * (size_t)(numOversamplingPaths * antialiasingStride));
+    compensationBuffer.clear();
+    previousOversampling = -1;
+}
+
+inline void DistortionDSP::process (float* const* channels, const int numChannels, const int numSamples) noexcept
+{
+    const int distortionType = currentDistortionType;
+    const int oversampling = selectedOversampling;
+    const bool antialiasing = selectedAntialiasing;
+
+    // The previous inputs are stale when antialiasing starts again
+    if (antialiasing != currentAntialiasing) {
+        zeromem (antialiasingInputs, sizeof (float) * (size_t)(numOversamplingPaths * antialiasingStride));
+        currentAntialiasing = antialiasing;
+    }
+
+    // A new factor switches straight away, as the latency changes with it. The quality
+    // governor lowers the factor one step per reduction, and those switches crossfade.
+    const int reducedOversampling = jmax ((int)oversamplingNone, oversampling - qualityReduction);
+    if (oversampling != chosenOversampling) {
+        chosenOversampling = oversampling;
+        previousOversampling = -1;
+        startOversamplingPath (reducedOversampling);
+    } else if (reducedOversampling != currentOversampling && previousOversampling < 0) {
+        if (numSamples <= fadeBuffer.getNumSamples()) {
+            previousOversampling = currentOversampling;
+            oversamplingFade = 0.0f;
+        }
+        startOversamplingPath (reducedOversampling);
+    }
+
+    // Without room for the previous path in fadeBuffer, the crossfade is cut short
+    if (previousOversampling >= 0 && numSamples > fadeBuffer.getNumSamples())
+        previousOversampling = -1;
+
+    if (previousOversampling >= 0) {
+        for (int channel = 0; channel < numChannels; ++channel)
+            fadeBuffer.copyFrom (channel, 0, channels[channel], numSamples);
+
+        dsp::AudioBlock<float> fadeBlock (fadeBuffer.getArrayOfWritePointers(), (size_t)numChannels, (size_t)numSamples);
+        processOversamplingPath (fadeBlock, previousOversampling, distortionType, antialiasing);
+    }
+
+    dsp::AudioBlock<float> block (channels, (size_t)numChannels, (size_t)numSamples);
+    processOversamplingPath (block, currentOversampling, distortionType, antialiasing);
+
+    if (previousOversampling >= 0) {
+        float endFade = oversamplingFade;
+        for (int channel = 0; channel < numChannels; ++channel)
+            endFade = kernels.crossfade (channels[channel], fadeBuffer.getReadPointer (channel),
+                                         numSamples, oversamplingFade, oversamplingFadeStep);
+
+        oversamplingFade = endFade;
+        if (oversamplingFade >= 1.0f)
+            previousOversampling = -1;
+    }
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        filters[channel]->processSamples (channels[channel], numSamples);
+
+    // The output gain ramps up to the end of its smoothing, and is constant after it
+    int sample = 0;
+    for (; sample < numSamples && smoothedOutputGain.isSmoothing(); ++sample) {
+        const float gain = smoothedOutputGain.getNextValue();
+        for (int channel = 0; channel < numChannels; ++channel)
+            channels[channel][sample] *= gain;
+    }
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        FloatVectorOperations::multiply (channels[channel] + sample, smoothedOutputGain.getTargetValue(), numSamples - sample);
+}
+
+//==============================================================================
+
+inline void DistortionDSP::distort (float* samples, const int numSamples, const int distortionType,
+                                    const bool antialiasing, float& previousInput)
+{
+    switch (distortionType) {
+        case distortionTypeHardClipping: {
+            if (antialiasing)
+                distortAntialiased<distortionTypeHardClipping> (samples, numSamples, previousInput);
+            else
+                kernels.hardClip (samples, numSamples, 0.5f);
+            break;
+        }
+        case distortionTypeSoftClipping: {
+            if (antialiasing)
+                distortAntialiased<distortionTypeSoftClipping> (samples, numSamples, previousInput);
+            else
+                kernels.softClip (samples, numSamples, 0.5f);
+            break;
+        }
+        case distortionTypeExponential: {
+            if (antialiasing)
+                distortAntialiased<distortionTypeExponential> (samples, numSamples, previousInput);
+            else
+                distort<distortionTypeExponential> (samples, numSamples);
+            break;
+        }
+        case distortionTypeFullWaveRectifier: {
+            if (antialiasing)
+                distortAntialiased<distortionTypeFullWaveRectifier> (samples, numSamples, previousInput);
+            else
+                kernels.fullWaveRectify (samples, numSamples);
+            break;
+        }
+        case distortionTypeHalfWaveRectifier: {
+            if (antialiasing)
+                distortAntialiased<distortionTypeHalfWaveRectifier> (samples, numSamples, previousInput);
+            else
+                kernels.halfWaveRectify (samples, numSamples);
+            break;
+        }
+    }
+}
+
+template <int distortionType>
+void DistortionDSP::distort (float* samples, const int numSamples) noexcept
+{
+    for (int sample = 0; sample < numSamples; ++sample)
+        samples[sample] = shape<distortionType> (samples[sample]);
+}
+
+template <int distortionType>
+void DistortionDSP::distortAntialiased (float* samples, const int numSamples, float& previousInput) noexcept
+{
+    // The antiderivatives grow with the square of the input, so their difference is
+    // taken in doubles, where it does not cancel down to noise
+    double previous = (double)previousInput;
+    double previousAntiderivative = antiderivative<distortionType> (previous);
+
+    for (int sample = 0; sample < numSamples; ++sample) {
+        const double in = (double)samples[sample];
+        const double inAntiderivative = antiderivative<distortionType> (in);
+        const double difference = in - previous;
+
+        if (std::abs (difference) > antialiasingTolerance)
+            samples[sample] = (float)((inAntiderivative - previousAntiderivative) / difference);
+        else
+            samples[sample] = shape<distortionType> ((float)(0.5 * (in + previous)));
+
+        previous = in;
+        previousAntiderivative = inAntiderivative;
+    }
+
+    previousInput = (float)previous;
+}
+
+template <int distortionType>
+float DistortionDSP::shape (const float in) noexcept
+{
+    switch (distortionType) {
+        case distortionTypeHardClipping: {
+            const float threshold = 0.5f;
+            return jmin (jmax (in, -threshold), threshold);
+        }
+        case distortionTypeSoftClipping: {
+            // Odd symmetric: 2x up to 1/3, 1 - (2 - 3x)^2 / 3 up to 2/3, then 1
+            const float threshold1 = 1.0f / 3.0f;
+            const float threshold2 = 2.0f / 3.0f;
+            const float x = jmin (fabsf (in), threshold2);
+            const float quadratic = 2.0f - 3.0f * x;
+            const float shaped = (x > threshold1) ? 1.0f - quadratic * quadratic / 3.0f : 2.0f * x;
+            return copysignf (shaped, in) * 0.5f;
+        }
+        case distortionTypeExponential: {
+            // sign (x) * (1 - e^-|x|), with e^y == 2^(y * log2 (e))
+            return copysignf (1.0f - FastMath::exp2 (fabsf (in) * -1.44269504f), in);
+        }
+        case distortionTypeFullWaveRectifier: {
+            return fabsf (in);
+        }
+        case distortionTypeHalfWaveRectifier: {
+            return jmax (0.0f, in);
+        }
+    }
+
+    return 0.0f;
+}
+
+template <int distortionType>
+double DistortionDSP::antiderivative (const double in) noexcept
+{
+    switch (distortionType) {
+        case distortionTypeHardClipping: {
+            // x^2 / 2 inside the threshold, continued by straight lines of slope +-t
+            const double threshold = 0.5;
+            const double x = std::abs (in);
+            return (x < threshold) ? 0.5 * x * x : threshold * x - 0.5 * threshold * threshold;
+        }
+        case distortionTypeSoftClipping: {
+            // Even, half of x^2 up to 1/3, 1/9 + (x - 1/3) - (1 - (2 - 3x)^3) / 27 up to
+            // 2/3, then 11/27 + (x - 2/3)
+            const double threshold1 = 1.0 / 3.0;
+            const double threshold2 = 2.0 / 3.0;
+            const double x = std::abs (in);
+            double integral;
+            if (x <= threshold1) {
+                integral = x * x;
+            } else if (x <= threshold2) {
+                const double quadratic = 2.0 - 3.0 * x;
+                integral = 1.0 / 9.0 + (x - threshold1) - (1.0 - quadratic * quadratic * quadratic) / 27.0;
+            } else {
+                integral = 11.0 / 27.0 + (x - threshold2);
+            }
+            return 0.5 * integral;
+        }
+        case distortionTypeExponential: {
+            // |x| + e^-|x| - 1, with expm1 to keep its precision near zero
+            const double x = std::abs (in);
+            return x + std::expm1 (-x);
+        }
+        case distortionTypeFullWaveRectifier: {
+            return 0.5 * in * std::abs (in);
+        }
+        case distortionTypeHalfWaveRectifier: {
+            const double x = jmax (0.0, in);
+            return 0.5 * x * x;
+        }
+    }
+
+    return 0.0;
+}
+
+inline void DistortionDSP::startOversamplingPath (const int oversampling)
+{
+    if (dsp::Oversampling<float>* oversampler = oversamplers[oversampling - 1])
+        oversampler->reset();
+
+    zeromem (antialiasingInputs + oversampling * antialiasingStride, sizeof (float) * (size_t)antialiasingStride);
+    for (int channel = 0; channel < antialiasingStride; ++channel)
+        compensationBuffer.clear (oversampling * antialiasingStride + channel, 0, compensationBuffer.getNumSamples());
+
+    // Lower factors have less latency, made up by a delay up to that of the factor chosen
+    compensationDelays[oversampling] = jlimit (0, compensationMask,
+                                               getLatencySamples (chosenOversampling) - getLatencySamples (oversampling));
+    currentOversampling = oversampling;
+}
+
+inline void DistortionDSP::processOversamplingPath (dsp::AudioBlock<float>& block, const int oversampling,
+                                            const int distortionType, const bool antialiasing)
+{
+    const int numBlockChannels = (int)block.getNumChannels();
+    const int numSamples = (int)block.getNumSamples();
+    float* previousInputs = antialiasingInputs + oversampling * antialiasingStride;
+
+    if (dsp::Oversampling<float>* oversampler = oversamplers[oversampling - 1]) {
+        for (int blockStart = 0; blockStart < numSamples; blockStart += oversamplingBlockSize) {
+            const int blockSamples = jmin (oversamplingBlockSize, numSamples - blockStart);
+            dsp::AudioBlock<float> subBlock = block.getSubBlock ((size_t)blockStart, (size_t)blockSamples);
+
+            dsp::AudioBlock<float> oversampledBlock = oversampler->processSamplesUp (subBlock);
+            for (int channel = 0; channel < numBlockChannels; ++channel)
+                distort (oversampledBlock.getChannelPointer ((size_t)channel), (int)oversampledBlock.getNumSamples(),
+                         distortionType, antialiasing, previousInputs[channel]);
+            oversampler->processSamplesDown (subBlock);
+        }
+    } else {
+        for (int channel = 0; channel < numBlockChannels; ++channel)
+            distort (block.getChannelPointer ((size_t)channel), numSamples, distortionType,
+                     antialiasing, previousInputs[channel]);
+    }
+
+    const int delay = compensationDelays[oversampling];
+    if (delay == 0)
+        return;
+
+    const int writePosition = compensationPositions[oversampling];
+    for (int channel = 0; channel < numBlockChannels; ++channel) {
+        float* channelData = block.getChannelPointer ((size_t)channel);
+        float* history = compensationBuffer.getWritePointer (oversampling * antialiasingStride + channel);
+
+        for (int sample = 0; sample < numSamples; ++sample) {
+            const int position = (writePosition + sample) & compensationMask;
+            history[position] = channelData[sample];
+            channelData[sample] = history[(position - delay) & compensationMask];
+        }
+    }
+
+    compensationPositions[oversampling] = (writePosition + numSamples) & compensationMask;
+}
+
+inline int DistortionDSP::getLatencySamples (const int oversampling) const
+{
+    if (dsp::Oversampling<float>* oversampler = oversamplers[oversampling - 1])
+        return roundToInt (oversampler->getLatencyInSamples());
+
+    return 0;
+}
+
+inline void DistortionDSP::updateFilters()
+{
+    TRACE_SCOPE ("updateFilters");
+
+    double discreteFrequency = M_PI * 0.01;
+    double gain = pow (10.0, (double)currentTone * 0.05);
+
+    for (int i = 0; i < filters.size(); ++i)
+        filters[i]->updateCoefficients (discreteFrequency, gain);
+}
+
+inline void DistortionDSP::addMemoryFootprint (MemoryFootprint& footprint) const
+{
+    // Every stage of an oversampler holds a block at its own rate
+    for (int i = 0; i < oversamplers.size(); ++i)
+        footprint.add (MemoryFootprint::filters, sizeof (float) * (size_t)filters.size() * (size_t)oversamplingBlockSize
+                                                 * (2 * oversamplers[i]->getOversamplingFactor() - 2));
+    footprint.add (MemoryFootprint::filters, sizeof (Filter) * (size_t)filters.size());
+    if (antialiasingInputs != nullptr)
+        footprint.add (MemoryFootprint::filters, sizeof (float) * (size_t)(numOversamplingPaths * antialiasingStride));
+
+    footprint.add (MemoryFootprint::delayLines, compensationBuffer);
+    footprint.add (MemoryFootprint::delayLines, fadeBuffer);
+}
+
+//==============================================================================
@@ -0,0 +1,84 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <cstring>
+
+//==============================================================================
+
+/** Branch-free approximations of log2 and exp2, accurate to about 1e-6, written
+    so that loops calling them over an array are vectorised by the compiler.
+*/
+namespace FastMath
+{
+    /** Only valid for normal, positive values of x. */
+    inline float log2 (const float x) noexcept
+    {
+        uint32 bits;
+        std::memcpy (&bits, &x, sizeof (bits));
+
+        // Split x into 2^exponent * mantissa with the mantissa in [sqrt(1/2), sqrt(2))
+        const int biasedExponent = (int)(bits >> 23);
+        bits = (bits & 0x007fffffu) | 0x3f800000u;
+
+        float mantissa;
+        std::memcpy (&mantissa, &bits, sizeof (mantissa));
+
+        const bool upperHalf = mantissa > 1.41421356f;
+        mantissa = upperHalf ? mantissa * 0.5f : mantissa;
+        const float exponent = (float)(biasedExponent - 127 + (upperHalf ? 1 : 0));
+
+        // log2 (m) = 2 / ln (2) * atanh (z), with |z| < 0.172
+        const float z = (mantissa - 1.0f) / (mantissa + 1.0f);
+        const float z2 = z * z;
+        const float series = 1.0f + z2 * (1.0f / 3.0f + z2 * (1.0f / 5.0f + z2 * (1.0f / 7.0f)));
+
+        return exponent + 2.88539008f * z * series;
+    }
+
+    inline float exp2 (const float x) noexcept
+    {
+        const float clipped = jlimit (-126.0f, 126.0f, x);
+
+        // Split x into an integer and a fraction in [-0.5, 0.5]
+        const float rounded = std::floor (clipped + 0.5f);
+        const float fraction = clipped - rounded;
+
+        const uint32 bits = (uint32)((int)rounded + 127) << 23;
+        float scale;
+        std::memcpy (&scale, &bits, sizeof (scale));
+
+        // Taylor series of exp (fraction * ln (2))
+        const float series = 1.0f + fraction * (0.693147181f
+                                  + fraction * (0.240226507f
+                                  + fraction * (0.0555041087f
+                                  + fraction * (0.00961812911f
+                                  + fraction * (0.00133335581f
+                                  + fraction * 0.000154035304f)))));
+
+        return scale * series;
+    }
+}
+
+//==============================================================================
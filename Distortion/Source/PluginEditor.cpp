@@ -102,10 +102,15 @@ DistortionAudioProcessorEditor::DistortionAudioProcessorEditor (DistortionAudioP
 
     editorHeight += components.size() * editorPadding;
     setSize (editorWidth, editorHeight);
+    setOpaque (true);
+    setLookAndFeel (lookAndFeel);
+    renderingContext.attachTo (*this);
 }
 
 DistortionAudioProcessorEditor::~DistortionAudioProcessorEditor()
 {
+    renderingContext.detach();
+    setLookAndFeel (nullptr);
 }
 
 //==============================================================================
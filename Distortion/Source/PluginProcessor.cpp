@@ -46,8 +46,11 @@ DistortionAudioProcessor::DistortionAudioProcessor():
                       [](float value){ return powf (10.0f, value * 0.05f); })
     , paramOutputGain (parameters, "Output gain", "dB", -24.0f, 24.0f, -24.0f,
                        [](float value){ return powf (10.0f, value * 0.05f); })
-    , paramTone (parameters, "Tone", "dB", -24.0f, 24.0f, 12.0f,
-                 [this](float value){ paramTone.setCurrentAndTargetValue (value); updateFilters(); return value; })
+    , paramTone (parameters, "Tone", "dB", -24.0f, 24.0f, 12.0f)
+    , paramOversampling (parameters, "Oversampling", oversamplingItemsUI, oversamplingNone,
+                         [this](float value){ paramOversampling.setCurrentAndTargetValue (value); updateOversampling(); return value; })
+    , paramAntialiasing (parameters, "Antialiasing")
+    , bypass (*this, parameters)
 {
     parameters.apvts.state = ValueTree (Identifier (getName().removeCharacters ("- ")));
 }
@@ -60,110 +63,96 @@ DistortionAudioProcessor::~DistortionAudioProcessor()
 
 void DistortionAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
+    TRACE_INSTANCE_SCOPE ("prepareToPlay", this);
+
     const double smoothTime = 1e-3;
     paramDistortionType.reset (sampleRate, smoothTime);
     paramInputGain.reset (sampleRate, smoothTime);
     paramOutputGain.reset (sampleRate, smoothTime);
     paramTone.reset (sampleRate, smoothTime);
+    paramOversampling.reset (sampleRate, smoothTime);
+    paramAntialiasing.reset (sampleRate, smoothTime);
 
     //======================================
 
-    filters.clear();
-    for (int i = 0; i < getTotalNumInputChannels(); ++i) {
-        Filter* filter;
-        filters.add (filter = new Filter());
-    }
-    updateFilters();
+    updateDSPParameters();
+    distortion.prepare (sampleRate, getTotalNumInputChannels(), samplesPerBlock, smoothTime);
+    updateOversampling();
+
+    profiler.prepare (sampleRate);
+    silenceDetector.prepare (sampleRate);
+    bypass.prepare (sampleRate, samplesPerBlock, distortion.getMaxLatencySamples());
 }
 
 void DistortionAudioProcessor::releaseResources()
 {
 }
 
+void DistortionAudioProcessor::reset()
+{
+    distortion.reset();
+}
+
 void DistortionAudioProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
 {
+    const ProcessBlockProfiler::ScopedMeasurement measurement (profiler, buffer.getNumSamples(), isNonRealtime());
+    TRACE_INSTANCE_SCOPE ("processBlock", this);
     ScopedNoDenormals noDenormals;
 
+    parameters.applySnapshotMorph();
+
     const int numInputChannels = getTotalNumInputChannels();
     const int numOutputChannels = getTotalNumOutputChannels();
     const int numSamples = buffer.getNumSamples();
 
     //======================================
 
-    for (int channel = 0; channel < numInputChannels; ++channel) {
-        float* channelData = buffer.getWritePointer (channel);
-
-        float out;
-        for (int sample = 0; sample < numSamples; ++sample) {
-            const float in = channelData[sample] * paramInputGain.getNextValue();
-
-            switch ((int)paramDistortionType.getTargetValue()) {
-                case distortionTypeHardClipping: {
-                    float threshold = 0.5f;
-                    if (in > threshold)
-                        out = threshold;
-                    else if (in < -threshold)
-                        out = -threshold;
-                    else
-                        out = in;
-                    break;
-                }
-                case distortionTypeSoftClipping: {
-                    float threshold1 = 1.0f / 3.0f;
-                    float threshold2 = 2.0f / 3.0f;
-                    if (in > threshold2)
-                        out = 1.0f;
-                    else if (in > threshold1)
-                        out = 1.0f - powf (2.0f - 3.0f * in, 2.0f) / 3.0f;
-                    else if (in < -threshold2)
-                        out = -1.0f;
-                    else if (in < -threshold1)
-                        out = -1.0f + powf (2.0f + 3.0f * in, 2.0f) / 3.0f;
-                    else
-                        out = 2.0f * in;
-                    out *= 0.5f;
-                    break;
-                }
-                case distortionTypeExponential: {
-                    if (in > 0.0f)
-                        out = 1.0f - expf (-in);
-                    else
-                        out = -1.0f + expf (in);
-                    break;
-                }
-                case distortionTypeFullWaveRectifier: {
-                    out = fabsf (in);
-                    break;
-                }
-                case distortionTypeHalfWaveRectifier: {
-                    if (in > 0.0f)
-                        out = in;
-                    else
-                        out = 0.0f;
-                    break;
-                }
-            }
-
-            float filtered = filters[channel]->processSingleSampleRaw (out);
-            channelData[sample] = filtered * paramOutputGain.getNextValue();
-        }
-    }
+    if (silenceDetector.skipBlock (*this, buffer))
+        return;
+
+    if (bypass.begin (buffer))
+        return;
+
+    distortion.setQualityReduction (profiler.getQualityReduction());
+    updateDSPParameters();
+    distortion.process (buffer.getArrayOfWritePointers(), numInputChannels, numSamples);
 
     //======================================
 
     for (int channel = numInputChannels; channel < numOutputChannels; ++channel)
         buffer.clear (channel, 0, numSamples);
+
+    bypass.end (buffer);
 }
 
 //==============================================================================
 
-void DistortionAudioProcessor::updateFilters()
+int DistortionAudioProcessor::getChosenOversampling() const noexcept
+{
+    // Offline renders do not run against the clock, so they take the highest factor
+    return isNonRealtime() ? (int)oversampling8x : (int)paramOversampling.getTargetValue();
+}
+
+void DistortionAudioProcessor::updateOversampling()
+{
+    setLatencySamples (distortion.getLatencySamples (getChosenOversampling()));
+}
+
+void DistortionAudioProcessor::setNonRealtime (bool isNonRealtime) noexcept
 {
-    double discreteFrequency = M_PI * 0.01;
-    double gain = pow (10.0, (double)paramTone.getTargetValue() * 0.05);
+    AudioProcessor::setNonRealtime (isNonRealtime);
 
-    for (int i = 0; i < filters.size(); ++i)
-        filters[i]->updateCoefficients (discreteFrequency, gain);
+    // The factor of renders has its own latency
+    updateOversampling();
+}
+
+void DistortionAudioProcessor::updateDSPParameters() noexcept
+{
+    distortion.setParameter (DistortionDSP::parameterDistortionType, paramDistortionType.getTargetValue());
+    distortion.setParameter (DistortionDSP::parameterOutputGain, paramOutputGain.getTargetValue());
+    distortion.setParameter (DistortionDSP::parameterTone, paramTone.getTargetValue());
+    distortion.setParameter (DistortionDSP::parameterOversampling, (float)getChosenOversampling());
+    distortion.setParameter (DistortionDSP::parameterAntialiasing, paramAntialiasing.getTargetValue());
 }
 
 //==============================================================================
@@ -177,13 +166,17 @@ void DistortionAudioProcessor::updateFilters()
 
 void DistortionAudioProcessor::getStateInformation (MemoryBlock& destData)
 {
-    auto state = parameters.apvts.copyState();
-    std::unique_ptr<XmlElement> xml (state.createXml());
-    copyXmlToBinary (*xml, destData);
+    MemoryOutputStream stream (destData, false);
+    parameters.writeState (stream);
 }
 
 void DistortionAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
+    MemoryInputStream stream (data, (size_t)sizeInBytes, false);
+    if (parameters.readState (stream))
+        return;
+
+    // Sessions saved in the XML format of older versions
     std::unique_ptr<XmlElement> xmlState (getXmlFromBinary (data, sizeInBytes));
 
     if (xmlState.get() != nullptr)
@@ -212,10 +205,9 @@ bool DistortionAudioProcessor::isBusesLayoutSupported (const BusesLayout& layout
     ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    if (layouts.getMainOutputChannelSet() != AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != AudioChannelSet::stereo())
+    // The channels are processed independently, so any layout with at least one
+    // channel is supported, from mono to surround sets or ambisonic stems.
+    if (layouts.getMainOutputChannelSet().isDisabled())
         return false;
 
     // This checks if the input layout matches the output layout
@@ -265,7 +257,14 @@ bool DistortionAudioProcessor::isMidiEffect() const
 
 double DistortionAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // The tone filter of updateFilters() decays over 1 / discreteFrequency samples,
+    // the oversampling filters are covered by the latency
+    return SilenceDetector::getDecayTailSeconds (1.0 / (M_PI * 0.01 * jmax (1.0, getSampleRate())));
+}
+
+AudioProcessorParameter* DistortionAudioProcessor::getBypassParameter() const
+{
+    return bypass.getParameter();
 }
 
 //==============================================================================
@@ -296,6 +295,21 @@ void DistortionAudioProcessor::changeProgramName (int index, const String& newNa
 
 //==============================================================================
 
+MemoryFootprint DistortionAudioProcessor::getMemoryFootprint() const
+{
+    const ScopedLock lock (parameters.deferredCallbackLock);
+
+    MemoryFootprint footprint;
+    footprint.add (MemoryFootprint::other, sizeof (*this));
+    bypass.addMemoryFootprint (footprint);
+
+    distortion.addMemoryFootprint (footprint);
+
+    return footprint;
+}
+
+//==============================================================================
+
 // This creates new instances of the plugin..
 AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
@@ -30,10 +30,15 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "PluginParameter.h"
+#include "ProcessBlockProfiler.h"
+#include "SilenceDetector.h"
+#include "PluginBypass.h"
+#include "MemoryFootprint.h"
+#include "DistortionDSP.h"
 
 //==============================================================================
 
-class DistortionAudioProcessor : public AudioProcessor
+class DistortionAudioProcessor : public AudioProcessor, public MemoryFootprintSource
 {
 public:
     //==============================================================================
@@ -45,7 +50,9 @@ public:
 
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
+    void reset() override;
     void processBlock (AudioSampleBuffer&, MidiBuffer&) override;
+    void setNonRealtime (bool isNonRealtime) noexcept override;
 
     //==============================================================================
 
@@ -78,6 +85,7 @@ public:
     bool producesMidi() const override;
     bool isMidiEffect () const override;
     double getTailLengthSeconds() const override;
+    AudioProcessorParameter* getBypassParameter() const override;
 
     //==============================================================================
 
@@ -89,10 +97,7 @@ public:
 
     //==============================================================================
 
-
-
-
-
+    MemoryFootprint getMemoryFootprint() const override;
 
     //==============================================================================
 
@@ -105,39 +110,44 @@ public:
     };
 
     enum distortionTypeIndex {
-        distortionTypeHardClipping = 0,
-        distortionTypeSoftClipping,
-        distortionTypeExponential,
-        distortionTypeFullWaveRectifier,
-        distortionTypeHalfWaveRectifier,
+        distortionTypeHardClipping = DistortionDSP::distortionTypeHardClipping,
+        distortionTypeSoftClipping = DistortionDSP::distortionTypeSoftClipping,
+        distortionTypeExponential = DistortionDSP::distortionTypeExponential,
+        distortionTypeFullWaveRectifier = DistortionDSP::distortionTypeFullWaveRectifier,
+        distortionTypeHalfWaveRectifier = DistortionDSP::distortionTypeHalfWaveRectifier,
     };
 
     //======================================
 
-    class Filter : public IIRFilter
-    {
-    public:
-        void updateCoefficients (const double discreteFrequency,
-                                 const double gain) noexcept
-        {
-            jassert (discreteFrequency > 0);
-
-            double tan_half_wc = tan (discreteFrequency / 2.0);
-            double sqrt_gain = sqrt (gain);
-
-            coefficients = IIRCoefficients (/* b0 */ sqrt_gain * tan_half_wc + gain,
-                                            /* b1 */ sqrt_gain * tan_half_wc - gain,
-                                            /* b2 */ 0.0,
-                                            /* a0 */ sqrt_gain * tan_half_wc + 1.0,
-                                            /* a1 */ sqrt_gain * tan_half_wc - 1.0,
-                                            /* a2 */ 0.0);
-
-            setCoefficients (coefficients);
-        }
+    StringArray oversamplingItemsUI = {
+        "None",
+        "2x",
+        "4x",
+        "8x"
     };
 
-    OwnedArray<Filter> filters;
-    void updateFilters();
+    enum oversamplingIndex {
+        oversamplingNone = DistortionDSP::oversamplingNone,
+        oversampling2x = DistortionDSP::oversampling2x,
+        oversampling4x = DistortionDSP::oversampling4x,
+        oversampling8x = DistortionDSP::oversampling8x,
+    };
+
+    //======================================
+
+    /** Offline renders take the highest factor, which has its own latency. */
+    int getChosenOversampling() const noexcept;
+    void updateOversampling();
+
+    /** Hands the values of the parameters to the core, once a block. */
+    void updateDSPParameters() noexcept;
+
+    DistortionDSP distortion;
+
+    //======================================
+
+    ProcessBlockProfiler profiler;
+    SilenceDetector silenceDetector;
 
     //======================================
 
@@ -147,6 +157,10 @@ public:
     PluginParameterLinSlider paramInputGain;
     PluginParameterLinSlider paramOutputGain;
     PluginParameterLinSlider paramTone;
+    PluginParameterComboBox paramOversampling;
+    PluginParameterToggle paramAntialiasing;
+
+    PluginBypass bypass;
 
 private:
     //==============================================================================
@@ -0,0 +1,277 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <algorithm>
+#include <cstring>
+#include <initializer_list>
+#include <map>
+
+//==============================================================================
+
+/** Set to 1 in the exporter's preprocessor definitions to draw the editors through
+    OpenGL instead of the software renderer, which takes the compositing of their
+    repaints off the message thread.
+*/
+#ifndef AUDIO_EFFECTS_OPENGL_EDITORS
+ #define AUDIO_EFFECTS_OPENGL_EDITORS 0
+#endif
+
+/** Set to 1 by the builds that embed the editors of other plugins inside their own,
+    so that only the outer editor attaches a context.
+*/
+#ifndef AUDIO_EFFECTS_EMBEDDED_EDITOR
+ #define AUDIO_EFFECTS_EMBEDDED_EDITOR 0
+#endif
+
+#define AUDIO_EFFECTS_USE_OPENGL_CONTEXT (AUDIO_EFFECTS_OPENGL_EDITORS && ! AUDIO_EFFECTS_EMBEDDED_EDITOR \
+                                          && JUCE_MODULE_AVAILABLE_juce_opengl)
+
+//==============================================================================
+
+/** OpenGL context of an editor when AUDIO_EFFECTS_OPENGL_EDITORS is enabled,
+    otherwise nothing. It only renders when a component repaints.
+*/
+class EditorRenderingContext
+{
+public:
+    ~EditorRenderingContext()
+    {
+        detach();
+    }
+
+    void attachTo (Component& editor)
+    {
+       #if AUDIO_EFFECTS_USE_OPENGL_CONTEXT
+        context.setContinuousRepainting (false);
+        context.attachTo (editor);
+       #else
+        ignoreUnused (editor);
+       #endif
+    }
+
+    /** To be called from the destructor of the editor, before its children go. */
+    void detach()
+    {
+       #if AUDIO_EFFECTS_USE_OPENGL_CONTEXT
+        context.detach();
+       #endif
+    }
+
+private:
+   #if AUDIO_EFFECTS_USE_OPENGL_CONTEXT
+    OpenGLContext context;
+   #endif
+};
+
+//==============================================================================
+
+/** The values that the timer of an editor last updated its components from. The
+    timer callback checks them first and leaves the components alone, so they are
+    not invalidated, while none of them changed.
+*/
+class EditorValueSnapshot
+{
+public:
+    /** Stores generation, PluginParametersManager::getChangeGeneration() for values
+        that only depend on the parameters, and returns true if it moved since the
+        last call, or if there was none yet. Called first, it spares the timer
+        gathering the values on the ticks where no parameter changed.
+    */
+    bool generationChanged (const uint32 generation) noexcept
+    {
+        if (hasGeneration && generation == lastGeneration)
+            return false;
+
+        lastGeneration = generation;
+        hasGeneration = true;
+        return true;
+    }
+
+    /** Stores the values and returns true if they differ from the stored ones, or
+        if there were none yet.
+    */
+    bool changed (std::initializer_list<float> newValues)
+    {
+        return changed (newValues.begin(), (int)newValues.size());
+    }
+
+    bool changed (const float* newValues, const int numValues)
+    {
+        if (hasValues && numValues == values.size()
+            && std::equal (newValues, newValues + numValues, values.begin()))
+            return false;
+
+        values.clearQuick();
+        values.addArray (newValues, numValues);
+        hasValues = true;
+        return true;
+    }
+
+private:
+    Array<float> values;
+    bool hasValues = false;
+    uint32 lastGeneration = 0;
+    bool hasGeneration = false;
+};
+
+//==============================================================================
+
+/** Look and feel of the editors. It renders the tracks and thumbs of the linear
+    sliders, and the boxes of the combo boxes, once into images, and from then on
+    only draws the images. The images are kept by kind, size in physical pixels
+    and colours, so every display scale gets its own, sharp ones.
+
+    Hold it in a SharedResourcePointer: all the editors of the process then share
+    one instance and one cache, and an editor that opens with the sizes of another
+    one strokes no paths at all. The slider styles it does not cache, and
+    everything else, are drawn by LookAndFeel_V4.
+*/
+class EditorLookAndFeel : public LookAndFeel_V4
+{
+public:
+    void drawLinearSlider (Graphics& g, int x, int y, int width, int height,
+                           float sliderPos, float minSliderPos, float maxSliderPos,
+                           const Slider::SliderStyle style, Slider& slider) override
+    {
+        if (slider.isBar() || slider.isTwoValue() || slider.isThreeValue()) {
+            LookAndFeel_V4::drawLinearSlider (g, x, y, width, height, sliderPos, minSliderPos, maxSliderPos, style, slider);
+            return;
+        }
+
+        // The same geometry as LookAndFeel_V4: a track with round caps along the
+        // middle of the slider, filled up to the thumb
+        const bool horizontal = slider.isHorizontal();
+        const float trackWidth = jmin (6.0f, horizontal ? (float)height * 0.25f : (float)width * 0.25f);
+        const Rectangle<float> trackArea = horizontal
+            ? Rectangle<float> ((float)x, (float)y + (float)height * 0.5f, (float)width, 0.0f).expanded (trackWidth * 0.5f)
+            : Rectangle<float> ((float)x + (float)width * 0.5f, (float)y, 0.0f, (float)height).expanded (trackWidth * 0.5f);
+        const Point<float> thumbCentre = horizontal ? Point<float> (sliderPos, (float)y + (float)height * 0.5f)
+                                                    : Point<float> ((float)x + (float)width * 0.5f, sliderPos);
+
+        const auto drawTrack = [trackWidth](Graphics& ig, Rectangle<float> area) {
+            ig.fillRoundedRectangle (area, trackWidth * 0.5f);
+        };
+
+        drawCachedImage (g, trackArea, imageTrack, { slider.findColour (Slider::backgroundColourId) }, drawTrack);
+
+        {
+            // The thumb covers the square end of the clipped value track
+            Graphics::ScopedSaveState state (g);
+            g.reduceClipRegion ((horizontal ? trackArea.withRight (thumbCentre.x)
+                                            : trackArea.withTop (thumbCentre.y)).getSmallestIntegerContainer());
+            drawCachedImage (g, trackArea, imageTrack, { slider.findColour (Slider::trackColourId) }, drawTrack);
+        }
+
+        const float thumbWidth = (float)getSliderThumbRadius (slider);
+        drawCachedImage (g, Rectangle<float> (thumbWidth, thumbWidth).withCentre (thumbCentre), imageThumb,
+                         { slider.findColour (Slider::thumbColourId) },
+                         [](Graphics& ig, Rectangle<float> area) { ig.fillEllipse (area); });
+    }
+
+    void drawComboBox (Graphics& g, int width, int height, bool isButtonDown,
+                       int buttonX, int buttonY, int buttonW, int buttonH, ComboBox& box) override
+    {
+        const bool square = box.findParentComponentOfClass<ChoicePropertyComponent>() != nullptr;
+        const Colour arrowColour = box.findColour (ComboBox::arrowColourId).withAlpha (box.isEnabled() ? 0.9f : 0.2f);
+
+        drawCachedImage (g, Rectangle<float> ((float)width, (float)height), square ? imageSquareComboBox : imageComboBox,
+                         { box.findColour (ComboBox::backgroundColourId), box.findColour (ComboBox::outlineColourId), arrowColour },
+                         [&](Graphics& ig, Rectangle<float>) {
+                             LookAndFeel_V4::drawComboBox (ig, width, height, isButtonDown,
+                                                           buttonX, buttonY, buttonW, buttonH, box);
+                         });
+    }
+
+private:
+    enum {
+        imageTrack = 0,
+        imageThumb,
+        imageComboBox,
+        imageSquareComboBox,
+    };
+
+    enum { maxNumColours = 3 };
+    enum { maxCachedImages = 256 };
+
+    struct ImageKey
+    {
+        int32 kind;
+        int32 width;
+        int32 height;
+        uint32 colours[maxNumColours];
+
+        bool operator< (const ImageKey& other) const noexcept
+        {
+            return std::memcmp (this, &other, sizeof (ImageKey)) < 0;
+        }
+    };
+
+    /** Draws into area the image of the given kind and colours, which draw renders
+        the first time into an image with the physical pixels of area, drawing into
+        a rectangle of the size of area at the origin.
+    */
+    template <typename DrawFunction>
+    void drawCachedImage (Graphics& g, const Rectangle<float>& area, const int kind,
+                          std::initializer_list<Colour> colours, DrawFunction&& draw)
+    {
+        jassert (colours.size() <= maxNumColours);
+
+        if (area.isEmpty())
+            return;
+
+        const float scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+        const int imageWidth = jmax (1, roundToInt (area.getWidth() * scale));
+        const int imageHeight = jmax (1, roundToInt (area.getHeight() * scale));
+
+        ImageKey key = { kind, imageWidth, imageHeight, {} };
+        int colour = 0;
+        for (const Colour& c : colours)
+            key.colours[colour++] = c.getARGB();
+
+        auto cached = images.find (key);
+        if (cached == images.end()) {
+            if (images.size() >= (size_t)maxCachedImages)
+                images.clear();
+
+            Image image (Image::ARGB, imageWidth, imageHeight, true);
+            {
+                Graphics ig (image);
+                ig.addTransform (AffineTransform::scale ((float)imageWidth / area.getWidth(),
+                                                         (float)imageHeight / area.getHeight()));
+                ig.setColour (*colours.begin());
+                draw (ig, Rectangle<float> (area.getWidth(), area.getHeight()));
+            }
+            cached = images.emplace (key, image).first;
+        }
+
+        g.setOpacity (1.0f);
+        g.drawImage (cached->second, area);
+    }
+
+    std::map<ImageKey, Image> images;
+};
+
+//==============================================================================
@@ -0,0 +1,232 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "MemoryFootprint.h"
+#include "ChannelWorkerPool.h"
+#include "WavetableLFO.h"
+#include "ModulatedDelayLine.h"
+#include "StereoDelayLine.h"
+
+//==============================================================================
+
+/** The audio processing of the Flanger, without the parameters, state, editor or
+    buses of the plugin, for hosts that only need the audio and run many instances.
+    FlangerAudioProcessor wraps one and hands it the values of its parameters once
+    a block, in their natural units: the delay and the width in seconds, the depth
+    and the feedback from 0 to 1, the polarity of the delayed signal as 1 or -1, the
+    frequency in Hz, the indices of the waveform and of the interpolation, and the
+    stereo mode as 0 or 1.
+*/
+class FlangerDSP
+{
+public:
+    enum parameterIndex {
+        parameterDelay = 0,
+        parameterWidth,
+        parameterDepth,
+        parameterFeedback,
+        parameterPolarity,
+        parameterFrequency,
+        parameterWaveform,
+        parameterInterpolation,
+        parameterStereo,
+        numParameters,
+    };
+
+    /** Allocates the delay line of the layout, of maxDelayTime seconds. */
+    void prepare (const double newSampleRate, const int numChannels, const float maxDelayTime)
+    {
+        sampleRate = newSampleRate;
+        inverseSampleRate = 1.0f / (float)sampleRate;
+
+        // Only the line of the layout is allocated
+        stereoLinked = (numChannels == StereoDelayLine::numLanes);
+        if (stereoLinked)
+            stereoDelayLine.prepare ((int)(maxDelayTime * (float)sampleRate) + 1);
+        else
+            delayLine.prepare (numChannels, (int)(maxDelayTime * (float)sampleRate) + 1);
+
+        lfo.setPhase (0.0f);
+        channelWorkers->prepare (numChannels);
+    }
+
+    void reset() noexcept
+    {
+        delayLine.clear();
+        stereoDelayLine.clear();
+    }
+
+    void setParameter (const int index, const float value) noexcept
+    {
+        switch (index) {
+            case parameterDelay:         delay = value; break;
+            case parameterWidth:         width = value; break;
+            case parameterDepth:         depth = value; break;
+            case parameterFeedback:      feedback = value; break;
+            case parameterPolarity:      polarity = value; break;
+            case parameterFrequency:     frequency = value; break;
+            case parameterWaveform:      waveform = jlimit (0, WavetableLFO::numWaveforms - 1, (int)value); break;
+            case parameterInterpolation: interpolation = jlimit ((int)ModulatedDelayLine::interpolationNearestNeighbour,
+                                                                 (int)ModulatedDelayLine::interpolationSinc, (int)value); break;
+            case parameterStereo:        stereo = (value != 0.0f); break;
+        }
+    }
+
+    /** The steps of reduction of a quality governor, under which the taps are read
+        with a cheaper interpolation.
+    */
+    void setQualityReduction (const int newQualityReduction) noexcept
+    {
+        qualityReduction = newQualityReduction;
+    }
+
+    /** Processes numSamples samples of numChannels channels in place. */
+    void process (float* const* channels, const int numChannels, const int numSamples) noexcept
+    {
+        const float phase = lfo.getPhase();
+        float phaseMain = phase;
+
+        lfo.setWaveform (waveform);
+        lfo.setFrequency (frequency, inverseSampleRate);
+
+        // Under a reduction of the quality governor the taps are read with a cheaper
+        // interpolation, at delays that keep the lookahead of the one chosen
+        const int readInterpolation = ModulatedDelayLine::getReducedInterpolation (interpolation, qualityReduction);
+        const float minDelay = (float)(1 + ModulatedDelayLine::getLookahead (interpolation));
+        const float rate = (float)sampleRate;
+
+        if (stereoLinked && numChannels == StereoDelayLine::numLanes) {
+            // In stereo, the right channel runs a quarter cycle ahead
+            const float phaseOffset = stereo ? 0.25f : 0.0f;
+            int localWritePosition = stereoDelayLine.getWritePosition();
+            float lfoValues[StereoDelayLine::numLanes * maxBlockSize];
+
+            for (int sample = 0; sample < numSamples; ++sample) {
+                if (sample % maxBlockSize == 0)
+                    lfo.fillStereo (lfoValues, jmin ((int)maxBlockSize, numSamples - sample), phaseOffset);
+
+                const float* lfoFrame = lfoValues + StereoDelayLine::numLanes * (sample % maxBlockSize);
+                float in[StereoDelayLine::numLanes];
+                float delays[StereoDelayLine::numLanes];
+                float out[StereoDelayLine::numLanes];
+
+                for (int lane = 0; lane < StereoDelayLine::numLanes; ++lane) {
+                    in[lane] = channels[lane][sample];
+                    delays[lane] = jmax (minDelay, (delay + width * lfoFrame[lane]) * rate);
+                }
+
+                stereoDelayLine.readFrame (localWritePosition, delays, out, readInterpolation);
+
+                for (int lane = 0; lane < StereoDelayLine::numLanes; ++lane) {
+                    channels[lane][sample] = in[lane] + out[lane] * depth * polarity;
+                    in[lane] += out[lane] * feedback;
+                }
+
+                stereoDelayLine.writeFrame (localWritePosition, in);
+                localWritePosition = stereoDelayLine.wrap (localWritePosition + 1);
+            }
+
+            stereoDelayLine.advance (numSamples);
+            phaseMain = lfo.getPhase();
+        } else {
+            channelWorkers->forEachChannel (jmin (numChannels, delayLine.getNumChannels()), [&] (const int channel) {
+                float* channelData = channels[channel];
+                int localWritePosition = delayLine.getWritePosition();
+                float lfoValues[maxBlockSize];
+
+                // In stereo, the odd channels of every pair run a quarter cycle ahead
+                WavetableLFO channelLfo (lfo);
+                if (stereo && channel % 2 != 0)
+                    channelLfo.setPhase (fmodf (phase + 0.25f, 1.0f));
+
+                for (int sample = 0; sample < numSamples; ++sample) {
+                    if (sample % maxBlockSize == 0)
+                        channelLfo.fill (lfoValues, jmin ((int)maxBlockSize, numSamples - sample));
+
+                    const float in = channelData[sample];
+                    const float localDelayTime = (delay + width * lfoValues[sample % maxBlockSize]) * rate;
+                    const float out = delayLine.readSample (channel, localWritePosition, jmax (minDelay, localDelayTime), readInterpolation);
+
+                    channelData[sample] = in + out * depth * polarity;
+                    delayLine.writeSample (channel, localWritePosition, in + out * feedback);
+
+                    localWritePosition = delayLine.wrap (localWritePosition + 1);
+                }
+
+                if (channel == 0)
+                    phaseMain = channelLfo.getPhase();
+            });
+
+            delayLine.advance (numSamples);
+        }
+
+        lfo.setPhase (phaseMain);
+    }
+
+    void addMemoryFootprint (MemoryFootprint& footprint) const
+    {
+        delayLine.addMemoryFootprint (footprint);
+        stereoDelayLine.addMemoryFootprint (footprint);
+    }
+
+private:
+    //==============================================================================
+
+    // Read and written one sample at a time, for the feedback
+    ModulatedDelayLine delayLine;
+
+    /** Each channel fills its own copy of the LFO maxBlockSize samples at a time,
+        ahead of its delay line, so that the channels can run on the workers.
+    */
+    enum {
+        maxBlockSize = 256,
+    };
+
+    /** A stereo pair runs through stereoDelayLine in one pass instead, the LFO of
+        both channels filled together.
+    */
+    StereoDelayLine stereoDelayLine;
+    bool stereoLinked = false;
+
+    WavetableLFO lfo;
+    double sampleRate = 44100.0;
+    float inverseSampleRate = 1.0f / 44100.0f;
+
+    SharedResourcePointer<ChannelWorkerPool> channelWorkers;
+
+    float delay = 0.0025f;
+    float width = 0.01f;
+    float depth = 1.0f;
+    float feedback = 0.0f;
+    float polarity = 1.0f;
+    float frequency = 0.2f;
+    int waveform = WavetableLFO::waveformSine;
+    int interpolation = ModulatedDelayLine::interpolationLinear;
+    bool stereo = false;
+    int qualityReduction = 0;
+};
+
+//==============================================================================
@@ -102,10 +102,15 @@ FlangerAudioProcessorEditor::FlangerAudioProcessorEditor (FlangerAudioProcessor&
 
     editorHeight += components.size() * editorPadding;
     setSize (editorWidth, editorHeight);
+    setOpaque (true);
+    setLookAndFeel (lookAndFeel);
+    renderingContext.attachTo (*this);
 }
 
 FlangerAudioProcessorEditor::~FlangerAudioProcessorEditor()
 {
+    renderingContext.detach();
+    setLookAndFeel (nullptr);
 }
 
 //==============================================================================
@@ -50,6 +50,7 @@ FlangerAudioProcessor::FlangerAudioProcessor():
     , paramWaveform (parameters, "LFO Waveform", waveformItemsUI, waveformSine)
     , paramInterpolation (parameters, "Interpolation", interpolationItemsUI, interpolationLinear)
     , paramStereo (parameters, "Stereo")
+    , bypass (*this, parameters)
 {
     parameters.apvts.state = ValueTree (Identifier (getName().removeCharacters ("- ")));
 }
@@ -62,6 +63,8 @@ FlangerAudioProcessor::~FlangerAudioProcessor()
 
 void FlangerAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
+    TRACE_INSTANCE_SCOPE ("prepareToPlay", this);
+
     const double smoothTime = 1e-3;
     paramDelay.reset (sampleRate, smoothTime);
     paramWidth.reset (sampleRate, smoothTime);
@@ -75,158 +78,60 @@ void FlangerAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBloc
 
     //======================================
 
-    float maxDelayTime = paramDelay.maxValue + paramWidth.maxValue;
-    delayBufferSamples = (int)(maxDelayTime * (float)sampleRate) + 1;
-    if (delayBufferSamples < 1)
-        delayBufferSamples = 1;
-
-    delayBufferChannels = getTotalNumInputChannels();
-    delayBuffer.setSize (delayBufferChannels, delayBufferSamples);
-    delayBuffer.clear();
+    flanger.prepare (sampleRate, getTotalNumInputChannels(), paramDelay.maxValue + paramWidth.maxValue);
 
-    delayWritePosition = 0;
-    lfoPhase = 0.0f;
-    inverseSampleRate = 1.0f / (float)sampleRate;
-    twoPi = 2.0f * M_PI;
+    profiler.prepare (sampleRate);
+    silenceDetector.prepare (sampleRate);
+    bypass.prepare (sampleRate, samplesPerBlock, 0);
 }
 
 void FlangerAudioProcessor::releaseResources()
 {
 }
 
+void FlangerAudioProcessor::reset()
+{
+    flanger.reset();
+}
+
 void FlangerAudioProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
 {
+    const ProcessBlockProfiler::ScopedMeasurement measurement (profiler, buffer.getNumSamples(), isNonRealtime());
+    TRACE_INSTANCE_SCOPE ("processBlock", this);
     ScopedNoDenormals noDenormals;
 
+    parameters.applySnapshotMorph();
+
     const int numInputChannels = getTotalNumInputChannels();
     const int numOutputChannels = getTotalNumOutputChannels();
     const int numSamples = buffer.getNumSamples();
 
     //======================================
 
-    float currentDelay = paramDelay.getNextValue();
-    float currentWidth = paramWidth.getNextValue();
-    float currentDepth = paramDepth.getNextValue();
-    float currentFeedback = paramFeedback.getNextValue();
-    float currentInverted = paramInverted.getNextValue();
-    float currentFrequency = paramFrequency.getNextValue();
-
-    int localWritePosition;
-    float phase;
-    float phaseMain;
-
-    for (int channel = 0; channel < numInputChannels; ++channel) {
-        float* channelData = buffer.getWritePointer (channel);
-        float* delayData = delayBuffer.getWritePointer (channel);
-        localWritePosition = delayWritePosition;
-        phase = lfoPhase;
-        if ((bool)paramStereo.getTargetValue() && channel != 0)
-            phase = fmodf (phase + 0.25f, 1.0f);
-
-        for (int sample = 0; sample < numSamples; ++sample) {
-            const float in = channelData[sample];
-            float out = 0.0f;
-
-            float localDelayTime =
-                (currentDelay + currentWidth * lfo (phase, (int)paramWaveform.getTargetValue())) * (float)getSampleRate();
-
-            float readPosition =
-                fmodf ((float)localWritePosition - localDelayTime + (float)delayBufferSamples, delayBufferSamples);
-            int localReadPosition = floorf (readPosition);
-
-            switch ((int)paramInterpolation.getTargetValue()) {
-                case interpolationNearestNeighbour: {
-                    float closestSample = delayData[localReadPosition % delayBufferSamples];
-                    out = closestSample;
-                    break;
-                }
-                case interpolationLinear: {
-                    float fraction = readPosition - (float)localReadPosition;
-                    float delayed0 = delayData[(localReadPosition + 0)];
-                    float delayed1 = delayData[(localReadPosition + 1) % delayBufferSamples];
-                    out = delayed0 + fraction * (delayed1 - delayed0);
-                    break;
-                }
-                case interpolationCubic: {
-                    float fraction = readPosition - (float)localReadPosition;
-                    float fractionSqrt = fraction * fraction;
-                    float fractionCube = fractionSqrt * fraction;
-
-                    float sample0 = delayData[(localReadPosition - 1 + delayBufferSamples) % delayBufferSamples];
-                    float sample1 = delayData[(localReadPosition + 0)];
-                    float sample2 = delayData[(localReadPosition + 1) % delayBufferSamples];
-                    float sample3 = delayData[(localReadPosition + 2) % delayBufferSamples];
-
-                    float a0 = - 0.5f * sample0 + 1.5f * sample1 - 1.5f * sample2 + 0.5f * sample3;
-                    float a1 = sample0 - 2.5f * sample1 + 2.0f * sample2 - 0.5f * sample3;
-                    float a2 = - 0.5f * sample0 + 0.5f * sample2;
-                    float a3 = sample1;
-                    out = a0 * fractionCube + a1 * fractionSqrt + a2 * fraction + a3;
-                    break;
-                }
-            }
-
-            channelData[sample] = in + out * currentDepth * currentInverted;
-            delayData[localWritePosition] = in + out * currentFeedback;
-
-            if (++localWritePosition >= delayBufferSamples)
-                localWritePosition -= delayBufferSamples;
-
-            phase += currentFrequency * inverseSampleRate;
-            if (phase >= 1.0f)
-                phase -= 1.0f;
-        }
-
-        if (channel == 0)
-            phaseMain = phase;
-    }
-
-    delayWritePosition = localWritePosition;
-    lfoPhase = phaseMain;
+    if (silenceDetector.skipBlock (*this, buffer))
+        return;
+
+    if (bypass.begin (buffer))
+        return;
+
+    flanger.setParameter (FlangerDSP::parameterDelay, paramDelay.getNextValue());
+    flanger.setParameter (FlangerDSP::parameterWidth, paramWidth.getNextValue());
+    flanger.setParameter (FlangerDSP::parameterDepth, paramDepth.getNextValue());
+    flanger.setParameter (FlangerDSP::parameterFeedback, paramFeedback.getNextValue());
+    flanger.setParameter (FlangerDSP::parameterPolarity, paramInverted.getNextValue());
+    flanger.setParameter (FlangerDSP::parameterFrequency, paramFrequency.getNextValue());
+    flanger.setParameter (FlangerDSP::parameterWaveform, paramWaveform.getTargetValue());
+    flanger.setParameter (FlangerDSP::parameterInterpolation, (float)getInterpolation());
+    flanger.setParameter (FlangerDSP::parameterStereo, paramStereo.getTargetValue());
+    flanger.setQualityReduction (profiler.getQualityReduction());
+    flanger.process (buffer.getArrayOfWritePointers(), numInputChannels, numSamples);
 
     //======================================
 
     for (int channel = numInputChannels; channel < numOutputChannels; ++channel)
         buffer.clear (channel, 0, numSamples);
-}
 
-//==============================================================================
-
-float FlangerAudioProcessor::lfo (float phase, int waveform)
-{
-    float out = 0.0f;
-
-    switch (waveform) {
-        case waveformSine: {
-            out = 0.5f + 0.5f * sinf (twoPi * phase);
-            break;
-        }
-        case waveformTriangle: {
-            if (phase < 0.25f)
-                out = 0.5f + 2.0f * phase;
-            else if (phase < 0.75f)
-                out = 1.0f - 2.0f * (phase - 0.25f);
-            else
-                out = 2.0f * (phase - 0.75f);
-            break;
-        }
-        case waveformSawtooth: {
-            if (phase < 0.5f)
-                out = 0.5f + phase;
-            else
-                out = phase - 0.5f;
-            break;
-        }
-        case waveformInverseSawtooth: {
-            if (phase < 0.5f)
-                out = 0.5f - phase;
-            else
-                out = 1.5f - phase;
-            break;
-        }
-    }
-
-    return out;
+    bypass.end (buffer);
 }
 
 //==============================================================================
@@ -240,13 +145,17 @@ float FlangerAudioProcessor::lfo (float phase, int waveform)
 
 void FlangerAudioProcessor::getStateInformation (MemoryBlock& destData)
 {
-    auto state = parameters.apvts.copyState();
-    std::unique_ptr<XmlElement> xml (state.createXml());
-    copyXmlToBinary (*xml, destData);
+    MemoryOutputStream stream (destData, false);
+    parameters.writeState (stream);
 }
 
 void FlangerAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
+    MemoryInputStream stream (data, (size_t)sizeInBytes, false);
+    if (parameters.readState (stream))
+        return;
+
+    // Sessions saved in the XML format of older versions
     std::unique_ptr<XmlElement> xmlState (getXmlFromBinary (data, sizeInBytes));
 
     if (xmlState.get() != nullptr)
@@ -275,10 +184,9 @@ bool FlangerAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
     ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    if (layouts.getMainOutputChannelSet() != AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != AudioChannelSet::stereo())
+    // The channels are processed independently, so any layout with at least one
+    // channel is supported, from mono to surround sets or ambisonic stems.
+    if (layouts.getMainOutputChannelSet().isDisabled())
         return false;
 
     // This checks if the input layout matches the output layout
@@ -328,7 +236,14 @@ bool FlangerAudioProcessor::isMidiEffect() const
 
 double FlangerAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // Feedback recirculates at most every delay plus width
+    return SilenceDetector::getFeedbackTailSeconds (paramFeedback.getTargetValue(),
+                                                    paramDelay.getTargetValue() + paramWidth.getTargetValue());
+}
+
+AudioProcessorParameter* FlangerAudioProcessor::getBypassParameter() const
+{
+    return bypass.getParameter();
 }
 
 //==============================================================================
@@ -359,6 +274,21 @@ void FlangerAudioProcessor::changeProgramName (int index, const String& newName)
 
 //==============================================================================
 
+MemoryFootprint FlangerAudioProcessor::getMemoryFootprint() const
+{
+    const ScopedLock lock (parameters.deferredCallbackLock);
+
+    MemoryFootprint footprint;
+    footprint.add (MemoryFootprint::other, sizeof (*this));
+    bypass.addMemoryFootprint (footprint);
+
+    flanger.addMemoryFootprint (footprint);
+
+    return footprint;
+}
+
+//==============================================================================
+
 // This creates new instances of the plugin..
 AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
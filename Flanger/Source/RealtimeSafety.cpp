@@ -0,0 +1,106 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#include "RealtimeSafety.h"
+
+#if AUDIO_EFFECTS_REALTIME_CHECKS
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if JUCE_LINUX || JUCE_MAC
+ #include <dlfcn.h>
+ #include <pthread.h>
+#endif
+
+//==============================================================================
+
+/*  The checks replace the allocator of the whole binary, so this file is compiled
+    once per plugin rather than with the effect sources shared by the Chain and the
+    Benchmark.
+*/
+
+static void* allocate (const std::size_t size, const char* operation) noexcept
+{
+    RealtimeSafety::check (operation);
+    return std::malloc (size > 0 ? size : 1);
+}
+
+static void deallocate (void* pointer) noexcept
+{
+    if (pointer != nullptr) {
+        RealtimeSafety::check ("heap deallocation");
+        std::free (pointer);
+    }
+}
+
+void* operator new (std::size_t size)
+{
+    if (void* pointer = allocate (size, "heap allocation"))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void* operator new[] (std::size_t size)
+{
+    if (void* pointer = allocate (size, "heap allocation"))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void* operator new (std::size_t size, const std::nothrow_t&) noexcept    { return allocate (size, "heap allocation"); }
+void* operator new[] (std::size_t size, const std::nothrow_t&) noexcept  { return allocate (size, "heap allocation"); }
+
+void operator delete (void* pointer) noexcept                            { deallocate (pointer); }
+void operator delete[] (void* pointer) noexcept                          { deallocate (pointer); }
+void operator delete (void* pointer, const std::nothrow_t&) noexcept     { deallocate (pointer); }
+void operator delete[] (void* pointer, const std::nothrow_t&) noexcept   { deallocate (pointer); }
+void operator delete (void* pointer, std::size_t) noexcept               { deallocate (pointer); }
+void operator delete[] (void* pointer, std::size_t) noexcept             { deallocate (pointer); }
+
+//==============================================================================
+
+#if JUCE_LINUX || JUCE_MAC
+
+/*  Hidden, so that it only takes the calls made from this binary, CriticalSection
+    and WaitableEvent included, and passes them on to the system one.
+*/
+typedef int (*MutexLockFunction) (pthread_mutex_t*);
+
+extern "C" __attribute__ ((visibility ("hidden"))) int pthread_mutex_lock (pthread_mutex_t* mutex)
+{
+    RealtimeSafety::check ("mutex lock");
+
+    static std::atomic<MutexLockFunction> systemFunction { nullptr };
+    MutexLockFunction function = systemFunction.load (std::memory_order_acquire);
+    if (function == nullptr) {
+        function = (MutexLockFunction)dlsym (RTLD_NEXT, "pthread_mutex_lock");
+        systemFunction.store (function, std::memory_order_release);
+    }
+
+    return function (mutex);
+}
+
+#endif
+
+#endif // AUDIO_EFFECTS_REALTIME_CHECKS
@@ -0,0 +1,132 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <limits>
+
+//==============================================================================
+
+/** Lets an effect sleep through digital silence.
+
+    processBlock calls skipBlock() first. Once all the inputs have stayed below
+    threshold for longer than the tail of the effect, the time its output takes
+    to fall below threshold after its input does, skipBlock() clears the block and
+    returns true, and the effect returns without running its DSP. By then all of
+    its state has decayed to silence too, so when the signal comes back it picks
+    up from that state as if it had run all along, without a click.
+
+    The tail is getTailLengthSeconds() of the processor, which the effects work
+    out from their parameters with the helpers below, plus its latency.
+*/
+class SilenceDetector
+{
+public:
+    /** About -120 dBFS. */
+    static constexpr float threshold = 1.0e-6f;
+
+    void prepare (const double newSampleRate) noexcept
+    {
+        sampleRate = newSampleRate;
+        reset();
+    }
+
+    /** For effects that clear their state, so they need no tail to wake up. */
+    void reset() noexcept
+    {
+        silentSamples = 0;
+    }
+
+    /** Returns true, with the whole block cleared, if it can be skipped. */
+    template <typename SampleType>
+    bool skipBlock (AudioProcessor& processor, AudioBuffer<SampleType>& buffer) noexcept
+    {
+        const int numInputChannels = processor.getTotalNumInputChannels();
+        const int numSamples = buffer.getNumSamples();
+
+        for (int channel = 0; channel < numInputChannels; ++channel) {
+            if (buffer.getMagnitude (channel, 0, numSamples) > (SampleType)threshold) {
+                silentSamples = 0;
+                return false;
+            }
+        }
+
+        // The block that ends the tail still runs, so the state is silent before
+        // the first skipped one
+        const double tailSeconds = jmax (0.0, processor.getTailLengthSeconds());
+        const int64 tailSamples = (int64)std::ceil (tailSeconds * sampleRate) + processor.getLatencySamples();
+        const bool asleep = silentSamples >= tailSamples;
+        silentSamples = jmin (silentSamples + numSamples, std::numeric_limits<int64>::max() / 2);
+
+        if (asleep)
+            buffer.clear();
+
+        return asleep;
+    }
+
+    //======================================
+
+    /** Time for a loop that feeds back gain feedback every loopSeconds to ring
+        down to the threshold, starting at full scale.
+    */
+    static double getFeedbackTailSeconds (const double feedback, const double loopSeconds) noexcept
+    {
+        const double loopGain = std::abs (feedback);
+        if (loopGain <= (double)threshold)
+            return loopSeconds;
+
+        return loopSeconds * (1.0 + std::log ((double)threshold) / std::log (jmin (loopGain, 0.999)));
+    }
+
+    /** Time for an exponential decay with timeConstant to fall from full scale to
+        the threshold.
+    */
+    static double getDecayTailSeconds (const double timeConstant) noexcept
+    {
+        return -std::log ((double)threshold) * jmax (0.0, timeConstant);
+    }
+
+    /** Time for a second-order filter at frequency with quality factor q to ring
+        down to the threshold. Above q = 1/2 its envelope falls as
+        exp (-pi * frequency * t / q), below it the slower of its two real poles
+        sets the decay.
+    */
+    static double getResonanceTailSeconds (const double frequency, const double q) noexcept
+    {
+        const double omega = 2.0 * M_PI * jmax (frequency, 1.0);
+        const double damping = 0.5 / jmax (q, 1.0e-3);
+        const double decayRate = (damping > 1.0) ? omega * (damping - std::sqrt (damping * damping - 1.0))
+                                                 : omega * damping;
+
+        return getDecayTailSeconds (1.0 / decayRate);
+    }
+
+private:
+    double sampleRate = 44100.0;
+    int64 silentSamples = 0;
+};
+
+//==============================================================================
@@ -0,0 +1,269 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "DelayMemoryArena.h"
+#include "MemoryFootprint.h"
+
+//==============================================================================
+
+/** Interaural time difference (ITD) and level difference (ILD) of a source at
+    some azimuth, from a spherical head model.
+
+    Both ears have a delay line, written a block at a time and read in segments
+    between the wrap-arounds of the buffer, as in MultiSourcePanner. The head
+    shadow filter of each ear is applied in the same pass over the delayed
+    samples. Its pole does not depend on the angle, so when the angle changes
+    only the zero moves, linearly over the block, and no coefficients have to
+    be recomputed in the loop.
+*/
+class InterauralPanner
+{
+public:
+    //==============================================================================
+
+    enum { maxBlockSize = 256 };
+
+    static constexpr float headRadius = 8.5e-2f;
+    static constexpr float speedOfSound = 340.0f;
+
+    void prepare (const double sampleRate, const int newMaximumDelayInSamples)
+    {
+        headFactor = (float)sampleRate * headRadius / speedOfSound;
+        maximumDelayInSamples = newMaximumDelayInSamples;
+
+        // A whole block is written before it is read, so the buffer holds the
+        // longest delay plus one block
+        delayBufferSamples = nextPowerOfTwo (maximumDelayInSamples + maxBlockSize + 2);
+        delayBufferMask = delayBufferSamples - 1;
+        delayBuffers.setSize (2, delayBufferSamples);
+        delayWritePosition = 0;
+
+        clear();
+    }
+
+    void clear() noexcept
+    {
+        delayBuffers.clear();
+
+        for (Ear& ear : ears) {
+            ear.previousInput = 0.0f;
+            ear.previousOutput = 0.0f;
+        }
+
+        // The next angle is taken at once
+        isFirstAngle = true;
+    }
+
+    void addMemoryFootprint (MemoryFootprint& footprint) const noexcept
+    {
+        footprint.add (MemoryFootprint::delayLines, delayBuffers);
+    }
+
+    /** Sets the delays and head shadow of both ears for the next call to process(),
+        with phi between -pi/2 (left) and pi/2 (right).
+    */
+    void setAngle (const float phi) noexcept
+    {
+        const float angles[2] = { phi + (float)M_PI_2, phi - (float)M_PI_2 };
+
+        for (int ear = 0; ear < 2; ++ear) {
+            ears[ear].delayTime = jlimit (0.0f, (float)maximumDelayInSamples, getInterauralTimeDelay (angles[ear], headFactor));
+            ears[ear].targetAlpha = 1.0f + cosf (angles[ear]);
+            if (isFirstAngle)
+                ears[ear].alpha = ears[ear].targetAlpha;
+        }
+
+        isFirstAngle = false;
+    }
+
+    /** Delays inputL into outputL and inputR into outputR, and filters them with the
+        head shadow if headShadow is set. The inputs may be the same buffer, and
+        each may be its own output.
+    */
+    void process (const float* inputL,
+                  const float* inputR,
+                  float* outputL,
+                  float* outputR,
+                  const int numSamples,
+                  const bool headShadow) noexcept
+    {
+        float alphaSteps[2];
+        for (int ear = 0; ear < 2; ++ear)
+            alphaSteps[ear] = (ears[ear].targetAlpha - ears[ear].alpha) / (float)jmax (1, numSamples);
+
+        for (int sample = 0; sample < numSamples;) {
+            const int blockSamples = jmin (numSamples - sample, (int)maxBlockSize);
+
+            write (0, inputL + sample, blockSamples);
+            write (1, inputR + sample, blockSamples);
+
+            if (headShadow) {
+                readAndFilter (0, outputL + sample, blockSamples, alphaSteps[0]);
+                readAndFilter (1, outputR + sample, blockSamples, alphaSteps[1]);
+            } else {
+                read (0, outputL + sample, blockSamples);
+                read (1, outputR + sample, blockSamples);
+            }
+
+            delayWritePosition = (delayWritePosition + blockSamples) & delayBufferMask;
+            sample += blockSamples;
+        }
+
+        // Rounding leaves the ramps a little short of their targets
+        for (Ear& ear : ears)
+            ear.alpha = ear.targetAlpha;
+    }
+
+    static float getInterauralTimeDelay (const float angle, const float headFactor) noexcept
+    {
+        if (abs (angle) < (float)M_PI_2)
+            return headFactor * (1.0f - cosf (angle));
+        else
+            return headFactor * (abs (angle) + 1.0f - (float)M_PI_2);
+    }
+
+private:
+    //==============================================================================
+
+    struct Ear
+    {
+        float delayTime = 0.0f;
+        float alpha = 0.0f;
+        float targetAlpha = 0.0f;
+        float previousInput = 0.0f;
+        float previousOutput = 0.0f;
+    };
+
+    void write (const int ear, const float* input, const int numSamples) noexcept
+    {
+        float* delayData = delayBuffers.getWritePointer (ear);
+
+        const int firstSamples = jmin (numSamples, delayBufferSamples - delayWritePosition);
+        FloatVectorOperations::copy (delayData + delayWritePosition, input, firstSamples);
+        FloatVectorOperations::copy (delayData, input + firstSamples, numSamples - firstSamples);
+    }
+
+    void read (const int ear, float* output, const int numSamples) const noexcept
+    {
+        const float* delayData = delayBuffers.getReadPointer (ear);
+        const int readOffset = (int)std::ceil (ears[ear].delayTime);
+        const float fraction = (float)readOffset - ears[ear].delayTime;
+
+        for (int sample = 0; sample < numSamples;) {
+            const int readPosition1 = (delayWritePosition + sample - readOffset) & delayBufferMask;
+            const int readPosition2 = (readPosition1 + 1) & delayBufferMask;
+            const int segmentSamples = jmin (numSamples - sample,
+                                             delayBufferSamples - readPosition1,
+                                             delayBufferSamples - readPosition2);
+
+            const float* readData1 = delayData + readPosition1;
+            const float* readData2 = delayData + readPosition2;
+            float* segmentOutput = output + sample;
+
+            for (int i = 0; i < segmentSamples; ++i)
+                segmentOutput[i] = readData1[i] + fraction * (readData2[i] - readData1[i]);
+
+            sample += segmentSamples;
+        }
+    }
+
+    /** read() followed by the first order head shadow filter, with the zero ramping
+        by alphaStep every sample.
+    */
+    void readAndFilter (const int ear, float* output, const int numSamples, const float alphaStep) noexcept
+    {
+        const float* delayData = delayBuffers.getReadPointer (ear);
+        const int readOffset = (int)std::ceil (ears[ear].delayTime);
+        const float fraction = (float)readOffset - ears[ear].delayTime;
+
+        // The head factor of the filter is in seconds, as in the original model
+        const float k = headRadius / speedOfSound;
+        const float norm = 1.0f / (k + 1.0f);
+        const float a1 = (k - 1.0f) * norm;
+
+        Ear& state = ears[ear];
+        float alpha = state.alpha;
+        float x1 = state.previousInput;
+        float y1 = state.previousOutput;
+
+        for (int sample = 0; sample < numSamples;) {
+            const int readPosition1 = (delayWritePosition + sample - readOffset) & delayBufferMask;
+            const int readPosition2 = (readPosition1 + 1) & delayBufferMask;
+            const int segmentSamples = jmin (numSamples - sample,
+                                             delayBufferSamples - readPosition1,
+                                             delayBufferSamples - readPosition2);
+
+            const float* readData1 = delayData + readPosition1;
+            const float* readData2 = delayData + readPosition2;
+            float* segmentOutput = output + sample;
+
+            if (alphaStep == 0.0f) {
+                const float b0 = (k + alpha) * norm;
+                const float b1 = (k - alpha) * norm;
+
+                for (int i = 0; i < segmentSamples; ++i) {
+                    const float x = readData1[i] + fraction * (readData2[i] - readData1[i]);
+                    const float y = b0 * x + b1 * x1 - a1 * y1;
+                    segmentOutput[i] = y;
+                    x1 = x;
+                    y1 = y;
+                }
+            } else {
+                for (int i = 0; i < segmentSamples; ++i) {
+                    alpha += alphaStep;
+                    const float x = readData1[i] + fraction * (readData2[i] - readData1[i]);
+                    const float y = ((k + alpha) * x + (k - alpha) * x1) * norm - a1 * y1;
+                    segmentOutput[i] = y;
+                    x1 = x;
+                    y1 = y;
+                }
+            }
+
+            sample += segmentSamples;
+        }
+
+        state.alpha = alpha;
+        state.previousInput = x1;
+        state.previousOutput = y1;
+    }
+
+    //==============================================================================
+
+    float headFactor = 0.0f;
+    int maximumDelayInSamples = 0;
+
+    DelayBuffer<float> delayBuffers;
+    int delayBufferSamples = 0;
+    int delayBufferMask = 0;
+    int delayWritePosition = 0;
+
+    Ear ears[2];
+    bool isFirstAngle = true;
+};
+
+//==============================================================================
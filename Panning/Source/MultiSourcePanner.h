@@ -0,0 +1,183 @@
+/*
+  ==============================================================================
+
+    This code is based on the contents of the book: "Audio Effects: Theory,
+    Implementation and Application" by Joshua D. Reiss and Andrew P. McPherson.
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "DelayMemoryArena.h"
+#include "MemoryFootprint.h"
+
+//==============================================================================
+
+/** Pans any number of mono sources into one stereo output with the panorama
+    (tangent law) and precedence (interaural delay) method.
+
+    The gains and delays of all the sources are computed together once per
+    block into structure-of-arrays buffers. Every source then has its own delay
+    line, and is read and accumulated into the shared output with a straight
+    loop per segment of the delay buffer.
+*/
+class MultiSourcePanner
+{
+public:
+    //==============================================================================
+
+    enum {
+        maxNumSources = 32,
+        maxBlockSize = 256,
+    };
+
+    void prepare (const int newNumSources, const int newMaximumDelayInSamples)
+    {
+        numSources = jlimit (1, (int)maxNumSources, newNumSources);
+        maximumDelayInSamples = newMaximumDelayInSamples;
+
+        // A whole block is written before it is read, so the buffer holds the
+        // longest delay plus one block
+        delayBufferSamples = nextPowerOfTwo (maximumDelayInSamples + maxBlockSize + 2);
+        delayBufferMask = delayBufferSamples - 1;
+        delayBuffers.setSize (numSources, delayBufferSamples);
+        delayBuffers.clear();
+        delayWritePosition = 0;
+    }
+
+    void clear() noexcept
+    {
+        delayBuffers.clear();
+    }
+
+    void addMemoryFootprint (MemoryFootprint& footprint) const noexcept
+    {
+        footprint.add (MemoryFootprint::delayLines, delayBuffers);
+    }
+
+    /** Overwrites outputL and outputR with the mix of the first numSourcesToMix
+        sources, each at its own position between -1 (left) and 1 (right).
+    */
+    void process (const float* const* sources,
+                  const float* positions,
+                  const int numSourcesToMix,
+                  float* outputL,
+                  float* outputR,
+                  const int numSamples) noexcept
+    {
+        jassert (numSamples <= maxBlockSize);
+        jassert (numSourcesToMix <= numSources);
+
+        updateGainsAndDelays (positions, numSourcesToMix);
+
+        FloatVectorOperations::clear (outputL, numSamples);
+        FloatVectorOperations::clear (outputR, numSamples);
+
+        for (int source = 0; source < numSourcesToMix; ++source) {
+            float* delayData = delayBuffers.getWritePointer (source);
+
+            const int firstSamples = jmin (numSamples, delayBufferSamples - delayWritePosition);
+            FloatVectorOperations::copy (delayData + delayWritePosition, sources[source], firstSamples);
+            FloatVectorOperations::copy (delayData, sources[source] + firstSamples, numSamples - firstSamples);
+
+            accumulate (delayData, delaysL[source], gainsL[source], outputL, numSamples);
+            accumulate (delayData, delaysR[source], gainsR[source], outputR, numSamples);
+        }
+
+        delayWritePosition = (delayWritePosition + numSamples) & delayBufferMask;
+    }
+
+private:
+    //==============================================================================
+
+    void updateGainsAndDelays (const float* positions, const int numSourcesToMix) noexcept
+    {
+        // Panorama
+        const float theta = degreesToRadians (30.0f);
+        const float cos_theta = cosf (theta);
+        const float sin_theta = sinf (theta);
+
+        for (int source = 0; source < numSourcesToMix; ++source) {
+            const float phi = -positions[source] * theta;
+            const float cos_phi = cosf (phi);
+            const float sin_phi = sinf (phi);
+            const float gainL = (cos_phi * sin_theta + sin_phi * cos_theta);
+            const float gainR = (cos_phi * sin_theta - sin_phi * cos_theta);
+            const float norm = 1.0f / sqrtf (gainL * gainL + gainR * gainR);
+            gainsL[source] = gainL * norm;
+            gainsR[source] = gainR * norm;
+        }
+
+        // Precedence
+        for (int source = 0; source < numSourcesToMix; ++source) {
+            const float delayFactor = (positions[source] + 1.0f) / 2.0f;
+            delaysL[source] = (float)maximumDelayInSamples * (delayFactor);
+            delaysR[source] = (float)maximumDelayInSamples * (1.0f - delayFactor);
+        }
+    }
+
+    void accumulate (const float* delayData,
+                     const float delayTime,
+                     const float gain,
+                     float* output,
+                     const int numSamples) const noexcept
+    {
+        const int readOffset = (int)std::ceil (delayTime);
+        const float fraction = (float)readOffset - delayTime;
+
+        for (int sample = 0; sample < numSamples;) {
+            const int readPosition1 = (delayWritePosition + sample - readOffset) & delayBufferMask;
+            const int readPosition2 = (readPosition1 + 1) & delayBufferMask;
+            const int segmentSamples = jmin (numSamples - sample,
+                                             delayBufferSamples - readPosition1,
+                                             delayBufferSamples - readPosition2);
+
+            const float* readData1 = delayData + readPosition1;
+            const float* readData2 = delayData + readPosition2;
+            float* segmentOutput = output + sample;
+
+            for (int i = 0; i < segmentSamples; ++i)
+                segmentOutput[i] += gain * (readData1[i] + fraction * (readData2[i] - readData1[i]));
+
+            sample += segmentSamples;
+        }
+    }
+
+    //==============================================================================
+
+    int numSources = 0;
+    int maximumDelayInSamples = 0;
+
+    DelayBuffer<float> delayBuffers;
+    int delayBufferSamples = 0;
+    int delayBufferMask = 0;
+    int delayWritePosition = 0;
+
+    float gainsL[maxNumSources];
+    float gainsR[maxNumSources];
+    float delaysL[maxNumSources];
+    float delaysR[maxNumSources];
+};
+
+//==============================================================================
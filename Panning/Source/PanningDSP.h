@@ -0,0 +1,353 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+
+#pragma once
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "MemoryFootprint.h"
+#include "TraceMarkers.h"
+#include "PartitionedConvolution.h"
+#include "MultiSourcePanner.h"
+#include "InterauralPanner.h"
+
+//==============================================================================
+
+/** The audio processing of the Panning, without the parameters, state, editor or
+    buses of the plugin, for hosts that only need the audio and run many instances.
+    PanningAudioProcessor wraps one and hands it the values of its parameters once
+    a block, in their natural units: the index of the method, the panning from -1
+    (left) to 1 (right), the index of the sources and the spread from 0 to 1.
+*/
+class PanningDSP
+{
+public:
+    enum parameterIndex {
+        parameterMethod = 0,
+        parameterPanning,
+        parameterSources,
+        parameterSpread,
+        numParameters,
+    };
+
+    enum methodIndex {
+        methodPanoramaPrecedence = 0,
+        methodItdIld,
+        methodHrtf,
+    };
+
+    enum sourcesIndex {
+        sourcesFirstInput = 0,
+        sourcesAllInputs,
+    };
+
+    /** Allocates the delays for numInputChannels sources, and the filters of the
+        HRTF method when the sample rate changes. Not real-time safe.
+    */
+    void prepare (const double newSampleRate, const int numInputChannels)
+    {
+        sampleRate = newSampleRate;
+        maximumDelayInSamples = (int)(1e-3f * (float)sampleRate);
+        interauralPanner.prepare (sampleRate, maximumDelayInSamples);
+        panner.prepare (numInputChannels, maximumDelayInSamples);
+
+        updateHrtfFilters (sampleRate);
+        currentMethod = -1;
+    }
+
+    void reset() noexcept
+    {
+        interauralPanner.clear();
+        panner.clear();
+        currentMethod = -1;
+    }
+
+    void setParameter (const int index, const float value) noexcept
+    {
+        switch (index) {
+            case parameterMethod:  method = jlimit ((int)methodPanoramaPrecedence, (int)methodHrtf, (int)value); break;
+            case parameterPanning: panning = value; break;
+            case parameterSources: sources = jlimit ((int)sourcesFirstInput, (int)sourcesAllInputs, (int)value); break;
+            case parameterSpread:  spread = value; break;
+        }
+    }
+
+    /** The HRTF method runs one block of the convolution behind the input. */
+    static int getLatencySamples (const int method) noexcept
+    {
+        return method == methodHrtf ? (int)hrtfBlockSize : 0;
+    }
+
+    /** Length of the interaural delays, and of the HRTF filters. */
+    int getMaximumDelayInSamples() const noexcept     { return maximumDelayInSamples; }
+    int getHrtfImpulseLength() const noexcept         { return convolution.getMaxImpulseLength(); }
+
+    /** Processes numSamples samples of the numInputChannels channels, and writes
+        the stereo output to the first two, which must exist even with one input.
+    */
+    void process (float* const* channels, const int numInputChannels, const int numSamples) noexcept
+    {
+        float* channelDataL = channels[0];
+        float* channelDataR = channels[1];
+
+        const int hrtfAngle = roundToInt ((panning + 1.0f) * 0.5f * (float)(hrtfNumAngles - 1));
+        if (method != currentMethod) {
+            if (method == methodHrtf)
+                resetHrtf (hrtfAngle);
+            currentMethod = method;
+        }
+
+        switch (method) {
+
+            //======================================
+
+            case methodPanoramaPrecedence: {
+                // Every input channel is a source when they are all used, spread
+                // evenly around the panning position
+                int numSources = 1;
+                if (sources == sourcesAllInputs)
+                    numSources = jlimit (1, (int)MultiSourcePanner::maxNumSources, numInputChannels);
+
+                for (int source = 0; source < numSources; ++source) {
+                    float offset = (numSources > 1) ? 2.0f * (float)source / (float)(numSources - 1) - 1.0f : 0.0f;
+                    sourcePositions[source] = jlimit (-1.0f, 1.0f, panning + spread * offset);
+                }
+
+                for (int sample = 0; sample < numSamples; sample += MultiSourcePanner::maxBlockSize) {
+                    const int blockSamples = jmin (numSamples - sample, (int)MultiSourcePanner::maxBlockSize);
+
+                    for (int source = 0; source < numSources; ++source)
+                        sourceData[source] = channels[source] + sample;
+
+                    panner.process (sourceData, sourcePositions, numSources, pannerOutputL, pannerOutputR, blockSamples);
+
+                    FloatVectorOperations::copy (channelDataL + sample, pannerOutputL, blockSamples);
+                    FloatVectorOperations::copy (channelDataR + sample, pannerOutputR, blockSamples);
+                }
+                break;
+            }
+
+            //======================================
+
+            case methodItdIld: {
+                // Interaural Time Difference (ITD) and Interaural Level Difference (ILD)
+                float theta = degreesToRadians (90.0f);
+                float phi = panning * theta;
+                interauralPanner.setAngle (phi);
+                interauralPanner.process (channelDataL, channelDataL, channelDataL, channelDataR, numSamples, true);
+                break;
+            }
+
+            //======================================
+
+            case methodHrtf: {
+                // Interaural Time Difference (ITD)
+                float theta = degreesToRadians (90.0f);
+                float phi = panning * theta;
+                interauralPanner.setAngle (phi);
+
+                // Head-related transfer functions, one block behind the input
+                for (int sample = 0; sample < numSamples;) {
+                    const int blockSamples = jmin (numSamples - sample, hrtfBlockSize - hrtfBlockPosition);
+                    FloatVectorOperations::copy (hrtfInput + hrtfBlockPosition, channelDataL + sample, blockSamples);
+
+                    interauralPanner.process (hrtfOutputL + hrtfBlockPosition, hrtfOutputR + hrtfBlockPosition,
+                                              channelDataL + sample, channelDataR + sample, blockSamples, false);
+
+                    sample += blockSamples;
+                    hrtfBlockPosition += blockSamples;
+                    if (hrtfBlockPosition == hrtfBlockSize) {
+                        processHrtfBlock (hrtfAngle);
+                        hrtfBlockPosition = 0;
+                    }
+                }
+                break;
+            }
+        }
+    }
+
+    void addMemoryFootprint (MemoryFootprint& footprint) const
+    {
+        interauralPanner.addMemoryFootprint (footprint);
+        panner.addMemoryFootprint (footprint);
+
+        convolution.addMemoryFootprint (footprint);
+        if (hrtfFilters != nullptr)
+            footprint.add (MemoryFootprint::filters, sizeof (float) * (size_t)(2 * hrtfNumAngles * convolution.getFilterSize()));
+    }
+
+private:
+    //==============================================================================
+
+    enum {
+        hrtfBlockSize = 64,
+        hrtfNumAngles = 37,
+    };
+
+    /** Fills the head-related impulse responses of every angle, from a spherical
+        head model with pinna echoes after Brown and Duda. The interaural time
+        delay is left out, since the delay lines apply it. The filters only depend
+        on the sample rate, so they are kept while it does not change.
+    */
+    void updateHrtfFilters (const double newSampleRate)
+    {
+        TRACE_SCOPE ("updateHrtfFilters");
+
+        if (newSampleRate == hrtfSampleRate)
+            return;
+        hrtfSampleRate = newSampleRate;
+
+        const double headRadius = 8.5e-2;
+        const double speedOfSound = 340.0;
+
+        // Pinna echoes: gains, and delays in samples at 44.1 kHz as a function of
+        // the azimuth seen from the ear
+        const int numEchoes = 5;
+        const double echoGains[numEchoes] = { 0.5, -1.0, 0.5, -0.25, 0.25 };
+        const double echoDelayRanges[numEchoes] = { 1.0, 5.0, 5.0, 5.0, 5.0 };
+        const double echoDelayOffsets[numEchoes] = { 2.0, 4.0, 7.0, 11.0, 13.0 };
+        const double echoElevationFactors[numEchoes] = { 1.0, 0.5, 0.5, 0.5, 0.5 };
+
+        const int impulseLength = jmax ((int)hrtfBlockSize, nextPowerOfTwo (roundToInt (128.0 * newSampleRate / 48000.0)));
+        convolution.prepare (hrtfBlockSize, impulseLength / hrtfBlockSize);
+        hrtfFilters.realloc (2 * hrtfNumAngles * convolution.getFilterSize());
+
+        HeapBlock<float> impulseResponse (impulseLength);
+
+        for (int angle = 0; angle < hrtfNumAngles; ++angle) {
+            const double phi = M_PI * ((double)angle / (double)(hrtfNumAngles - 1) - 0.5);
+
+            for (int ear = 0; ear < 2; ++ear) {
+                // Angle of incidence measured from the axis of the ear
+                const double incidence = (ear == 0) ? phi + M_PI_2 : M_PI_2 - phi;
+                const double azimuth = M_PI_2 - incidence;
+
+                impulseResponse.clear (impulseLength);
+                impulseResponse[0] = 1.0f;
+                for (int echo = 0; echo < numEchoes; ++echo) {
+                    const double delay = (echoDelayRanges[echo] * cos (azimuth / 2.0) * sin (echoElevationFactors[echo] * M_PI_2)
+                                          + echoDelayOffsets[echo]) * newSampleRate / 44100.0;
+                    const int delayInteger = (int)delay;
+                    const double fraction = delay - (double)delayInteger;
+                    impulseResponse[delayInteger + 0] += (float)(echoGains[echo] * (1.0 - fraction));
+                    impulseResponse[delayInteger + 1] += (float)(echoGains[echo] * fraction);
+                }
+
+                // Head shadow: one pole and one zero, with the zero moving from a high
+                // frequency boost facing the ear to a cut behind the head
+                const double beta = speedOfSound / (headRadius * newSampleRate);
+                const double alpha = 1.05 + 0.95 * cos (incidence * 180.0 / 150.0);
+                const double b0 = (beta + alpha) / (beta + 1.0);
+                const double b1 = (beta - alpha) / (beta + 1.0);
+                const double a1 = (beta - 1.0) / (beta + 1.0);
+
+                double x1 = 0.0;
+                double y1 = 0.0;
+                for (int sample = 0; sample < impulseLength; ++sample) {
+                    const double x0 = (double)impulseResponse[sample];
+                    const double y0 = b0 * x0 + b1 * x1 - a1 * y1;
+                    impulseResponse[sample] = (float)y0;
+                    x1 = x0;
+                    y1 = y0;
+                }
+
+                convolution.prepareFilter (impulseResponse, impulseLength,
+                                           hrtfFilters + (2 * angle + ear) * convolution.getFilterSize());
+            }
+        }
+    }
+
+    void resetHrtf (const int angle) noexcept
+    {
+        convolution.reset();
+        zeromem (hrtfInput, sizeof (hrtfInput));
+        zeromem (hrtfOutputL, sizeof (hrtfOutputL));
+        zeromem (hrtfOutputR, sizeof (hrtfOutputR));
+        hrtfBlockPosition = 0;
+        currentHrtfAngle = angle;
+    }
+
+    void processHrtfBlock (const int angle) noexcept
+    {
+        convolution.pushBlock (hrtfInput);
+        convolution.convolve (getHrtfFilter (angle, 0), hrtfOutputL);
+        convolution.convolve (getHrtfFilter (angle, 1), hrtfOutputR);
+
+        // A new angle fades in over one block from the output of the previous filters
+        if (angle != currentHrtfAngle) {
+            const float fadeStep = 1.0f / (float)hrtfBlockSize;
+
+            convolution.convolve (getHrtfFilter (currentHrtfAngle, 0), hrtfPreviousOutput);
+            for (int sample = 0; sample < hrtfBlockSize; ++sample)
+                hrtfOutputL[sample] = hrtfPreviousOutput[sample]
+                    + (float)(sample + 1) * fadeStep * (hrtfOutputL[sample] - hrtfPreviousOutput[sample]);
+
+            convolution.convolve (getHrtfFilter (currentHrtfAngle, 1), hrtfPreviousOutput);
+            for (int sample = 0; sample < hrtfBlockSize; ++sample)
+                hrtfOutputR[sample] = hrtfPreviousOutput[sample]
+                    + (float)(sample + 1) * fadeStep * (hrtfOutputR[sample] - hrtfPreviousOutput[sample]);
+
+            currentHrtfAngle = angle;
+        }
+    }
+
+    const float* getHrtfFilter (const int angle, const int ear) const noexcept
+    {
+        return hrtfFilters + (2 * angle + ear) * convolution.getFilterSize();
+    }
+
+    //==============================================================================
+
+    double sampleRate = 44100.0;
+
+    // Interaural delays of the ITD + ILD and HRTF methods, and the head shadow
+    // of the first
+    InterauralPanner interauralPanner;
+    int maximumDelayInSamples = 0;
+
+    MultiSourcePanner panner;
+    const float* sourceData[MultiSourcePanner::maxNumSources];
+    float sourcePositions[MultiSourcePanner::maxNumSources];
+    float pannerOutputL[MultiSourcePanner::maxBlockSize];
+    float pannerOutputR[MultiSourcePanner::maxBlockSize];
+
+    PartitionedConvolution convolution;
+    HeapBlock<float> hrtfFilters;
+    double hrtfSampleRate = 0.0;
+    float hrtfInput[hrtfBlockSize];
+    float hrtfOutputL[hrtfBlockSize];
+    float hrtfOutputR[hrtfBlockSize];
+    float hrtfPreviousOutput[hrtfBlockSize];
+    int hrtfBlockPosition = 0;
+    int currentHrtfAngle = 0;
+    int currentMethod = -1;
+
+    int method = methodItdIld;
+    float panning = 0.5f;
+    int sources = sourcesFirstInput;
+    float spread = 0.5f;
+};
+
+//==============================================================================
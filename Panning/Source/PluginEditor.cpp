@@ -102,10 +102,16 @@ PanningAudioProcessorEditor::PanningAudioProcessorEditor (PanningAudioProcessor&
 
     editorHeight += components.size() * editorPadding;
     setSize (editorWidth, editorHeight);
+    setOpaque (true);
+    setLookAndFeel (lookAndFeel);
+    renderingContext.attachTo (*this);
+    startTimer (50);
 }
 
 PanningAudioProcessorEditor::~PanningAudioProcessorEditor()
 {
+    renderingContext.detach();
+    setLookAndFeel (nullptr);
 }
 
 //==============================================================================
@@ -135,3 +141,22 @@ void PanningAudioProcessorEditor::resized()
 }
 
 //==============================================================================
+
+void PanningAudioProcessorEditor::timerCallback()
+{
+    // Only touches the components when something they show changed
+    if (uiValues.generationChanged (processor.parameters.getChangeGeneration())
+        && uiValues.changed ({ processor.paramMethod.getTargetValue(), processor.paramSources.getTargetValue() }))
+        updateUIcomponents();
+}
+
+void PanningAudioProcessorEditor::updateUIcomponents()
+{
+    const bool panoramaPrecedence = processor.paramMethod.getTargetValue() == processor.methodPanoramaPrecedence;
+    const bool allInputs = processor.paramSources.getTargetValue() == processor.sourcesAllInputs;
+
+    findChildWithID (processor.paramSources.paramID)->setEnabled (panoramaPrecedence);
+    findChildWithID (processor.paramSpread.paramID)->setEnabled (panoramaPrecedence && allInputs);
+}
+
+//==============================================================================
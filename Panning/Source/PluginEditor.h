@@ -24,10 +24,11 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "PluginProcessor.h"
+#include "EditorRendering.h"
 
 //==============================================================================
 
-class PanningAudioProcessorEditor : public AudioProcessorEditor
+class PanningAudioProcessorEditor : public AudioProcessorEditor, private Timer
 {
 public:
     //==============================================================================
@@ -75,6 +76,17 @@ private:
     OwnedArray<ButtonAttachment> buttonAttachments;
     OwnedArray<ComboBoxAttachment> comboBoxAttachments;
 
+    //======================================
+
+    void timerCallback() override;
+    void updateUIcomponents();
+    EditorValueSnapshot uiValues;
+
+    //======================================
+
+    EditorRenderingContext renderingContext;
+    SharedResourcePointer<EditorLookAndFeel> lookAndFeel;
+
     //==============================================================================
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PanningAudioProcessorEditor)
@@ -41,8 +41,12 @@ PanningAudioProcessor::PanningAudioProcessor():
                    ),
 #endif
     parameters (*this)
-    , paramMethod (parameters, "Method", methodItemsUI, methodItdIld)
+    , paramMethod (parameters, "Method", methodItemsUI, methodItdIld,
+                   [this](float value){ paramMethod.setCurrentAndTargetValue (value); updateLatency(); return value; })
     , paramPanning (parameters, "Panning", "", -1.0f, 1.0f, 0.5f)
+    , paramSources (parameters, "Sources", sourcesItemsUI, sourcesFirstInput)
+    , paramSpread (parameters, "Spread", "", 0.0f, 1.0f, 0.5f)
+    , bypass (*this, parameters)
 {
     parameters.apvts.state = ValueTree (Identifier (getName().removeCharacters ("- ")));
 }
@@ -55,105 +59,72 @@ PanningAudioProcessor::~PanningAudioProcessor()
 
 void PanningAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
+    TRACE_INSTANCE_SCOPE ("prepareToPlay", this);
+
     const double smoothTime = 1e-3;
     paramMethod.reset (sampleRate, smoothTime);
     paramPanning.reset (sampleRate, smoothTime);
+    paramSources.reset (sampleRate, smoothTime);
+    paramSpread.reset (sampleRate, smoothTime);
 
     //======================================
 
-    maximumDelayInSamples = (int)(1e-3f * (float)getSampleRate());
-    delayLineL.setup (maximumDelayInSamples);
-    delayLineR.setup (maximumDelayInSamples);
+    panning.prepare (sampleRate, getTotalNumInputChannels());
+
+    profiler.prepare (sampleRate);
+    silenceDetector.prepare (sampleRate);
+    bypass.prepare (sampleRate, samplesPerBlock, PanningDSP::getLatencySamples (methodHrtf));
 }
 
 void PanningAudioProcessor::releaseResources()
 {
 }
 
+void PanningAudioProcessor::reset()
+{
+    panning.reset();
+}
+
 void PanningAudioProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
 {
+    const ProcessBlockProfiler::ScopedMeasurement measurement (profiler, buffer.getNumSamples(), isNonRealtime());
+    TRACE_INSTANCE_SCOPE ("processBlock", this);
     ScopedNoDenormals noDenormals;
 
+    parameters.applySnapshotMorph();
+
     const int numInputChannels = getTotalNumInputChannels();
     const int numOutputChannels = getTotalNumOutputChannels();
     const int numSamples = buffer.getNumSamples();
 
     //======================================
 
-    float currentPanning = paramPanning.getNextValue();
+    if (silenceDetector.skipBlock (*this, buffer))
+        return;
 
-    float* channelDataL = buffer.getWritePointer (0);
-    float* channelDataR = buffer.getWritePointer (1);
+    if (bypass.begin (buffer))
+        return;
 
-    switch ((int)paramMethod.getTargetValue()) {
+    panning.setParameter (PanningDSP::parameterMethod, paramMethod.getTargetValue());
+    panning.setParameter (PanningDSP::parameterPanning, paramPanning.getNextValue());
+    panning.setParameter (PanningDSP::parameterSources, paramSources.getTargetValue());
+    panning.setParameter (PanningDSP::parameterSpread, paramSpread.getNextValue());
+    panning.process (buffer.getArrayOfWritePointers(), numInputChannels, numSamples);
 
-        //======================================
-
-        case methodPanoramaPrecedence: {
-            // Panorama
-            float theta = degreesToRadians (30.0f);
-            float phi = -currentPanning * theta;
-            float cos_theta = cosf (theta);
-            float cos_phi = cosf (phi);
-            float sin_theta = sinf (theta);
-            float sin_phi = sinf (phi);
-            float gainL = (cos_phi * sin_theta + sin_phi * cos_theta);
-            float gainR = (cos_phi * sin_theta - sin_phi * cos_theta);
-            float norm = 1.0f / sqrtf (gainL * gainL + gainR * gainR);
-
-            // Precedence
-            float delayFactor = (currentPanning + 1.0f) / 2.0f;
-            float delayTimeL = (float)maximumDelayInSamples * (delayFactor);
-            float delayTimeR = (float)maximumDelayInSamples * (1.0f - delayFactor);
-            for (int sample = 0; sample < numSamples; ++sample) {
-                const float in = channelDataL[sample];
-                delayLineL.writeSample (in);
-                delayLineR.writeSample (in);
-                channelDataL[sample] = delayLineL.readSample (delayTimeL) * gainL * norm;
-                channelDataR[sample] = delayLineR.readSample (delayTimeR) * gainR * norm;
-            }
-            break;
-        }
+    //======================================
 
-        //======================================
+    // Both output channels are always written, whatever the number of inputs
+    for (int channel = 2; channel < numOutputChannels; ++channel)
+        buffer.clear (channel, 0, numSamples);
 
-        case methodItdIld: {
-            float headRadius = 8.5e-2f;
-            float speedOfSound = 340.0f;
-            float headFactor = (float)getSampleRate() * headRadius / speedOfSound;
-
-            // Interaural Time Difference (ITD)
-            auto Td = [headFactor](const float angle){
-                if (abs (angle) < (float)M_PI_2)
-                    return headFactor * (1.0f - cosf (angle));
-                else
-                    return headFactor * (abs (angle) + 1.0f - (float)M_PI_2);
-            };
-            float theta = degreesToRadians (90.0f);
-            float phi = currentPanning * theta;
-            float currentDelayTimeL = Td (phi + (float)M_PI_2);
-            float currentDelayTimeR = Td (phi - (float)M_PI_2);
-            for (int sample = 0; sample < numSamples; ++sample) {
-                const float in = channelDataL[sample];
-                delayLineL.writeSample (in);
-                delayLineR.writeSample (in);
-                channelDataL[sample] = delayLineL.readSample (currentDelayTimeL);
-                channelDataR[sample] = delayLineR.readSample (currentDelayTimeR);
-            }
-
-            // Interaural Level Difference (ILD)
-            filterL.updateCoefficients ((double)phi + M_PI_2, (double)(headRadius / speedOfSound));
-            filterR.updateCoefficients ((double)phi - M_PI_2, (double)(headRadius / speedOfSound));
-            filterL.processSamples (channelDataL, numSamples);
-            filterR.processSamples (channelDataR, numSamples);
-            break;
-        }
-    }
+    bypass.end (buffer);
+}
 
-    //======================================
+//==============================================================================
 
-    for (int channel = numInputChannels; channel < numOutputChannels; ++channel)
-        buffer.clear (channel, 0, numSamples);
+void PanningAudioProcessor::updateLatency()
+{
+    setLatencySamples (PanningDSP::getLatencySamples ((int)paramMethod.getTargetValue()));
 }
 
 //==============================================================================
@@ -167,13 +138,17 @@ void PanningAudioProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer&
 
 void PanningAudioProcessor::getStateInformation (MemoryBlock& destData)
 {
-    auto state = parameters.apvts.copyState();
-    std::unique_ptr<XmlElement> xml (state.createXml());
-    copyXmlToBinary (*xml, destData);
+    MemoryOutputStream stream (destData, false);
+    parameters.writeState (stream);
 }
 
 void PanningAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
+    MemoryInputStream stream (data, (size_t)sizeInBytes, false);
+    if (parameters.readState (stream))
+        return;
+
+    // Sessions saved in the XML format of older versions
     std::unique_ptr<XmlElement> xmlState (getXmlFromBinary (data, sizeInBytes));
 
     if (xmlState.get() != nullptr)
@@ -202,15 +177,13 @@ bool PanningAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
     ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    if (layouts.getMainOutputChannelSet() != AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != AudioChannelSet::stereo())
+    // The output is always stereo, and every input channel can be a source
+    if (layouts.getMainOutputChannelSet() != AudioChannelSet::stereo())
         return false;
 
-    // This checks if the input layout matches the output layout
    #if ! JucePlugin_IsSynth
-    if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
+    const int numInputChannels = layouts.getMainInputChannelSet().size();
+    if (numInputChannels < 1 || numInputChannels > MultiSourcePanner::maxNumSources)
         return false;
    #endif
 
@@ -255,7 +228,28 @@ bool PanningAudioProcessor::isMidiEffect() const
 
 double PanningAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    const double sampleRate = jmax (1.0, getSampleRate());
+    const double delayTailSeconds = (double)panning.getMaximumDelayInSamples() / sampleRate;
+
+    switch ((int)paramMethod.getTargetValue()) {
+        case methodItdIld: {
+            // The pole of the head shadow filters, (1 - k) / (1 + k) with k the head
+            // radius over the speed of sound, decays over (1 + k) / 2k samples
+            const double k = (double)InterauralPanner::headRadius / (double)InterauralPanner::speedOfSound;
+            return delayTailSeconds + SilenceDetector::getDecayTailSeconds ((1.0 + k) / (2.0 * k * sampleRate));
+        }
+        case methodHrtf: {
+            return delayTailSeconds + (double)panning.getHrtfImpulseLength() / sampleRate;
+        }
+        default: {
+            return delayTailSeconds;
+        }
+    }
+}
+
+AudioProcessorParameter* PanningAudioProcessor::getBypassParameter() const
+{
+    return bypass.getParameter();
 }
 
 //==============================================================================
@@ -286,6 +280,21 @@ void PanningAudioProcessor::changeProgramName (int index, const String& newName)
 
 //==============================================================================
 
+MemoryFootprint PanningAudioProcessor::getMemoryFootprint() const
+{
+    const ScopedLock lock (parameters.deferredCallbackLock);
+
+    MemoryFootprint footprint;
+    footprint.add (MemoryFootprint::other, sizeof (*this));
+    bypass.addMemoryFootprint (footprint);
+
+    panning.addMemoryFootprint (footprint);
+
+    return footprint;
+}
+
+//==============================================================================
+
 // This creates new instances of the plugin..
 AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
@@ -30,10 +30,15 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "PluginParameter.h"
+#include "ProcessBlockProfiler.h"
+#include "SilenceDetector.h"
+#include "PluginBypass.h"
+#include "MemoryFootprint.h"
+#include "PanningDSP.h"
 
 //==============================================================================
 
-class PanningAudioProcessor : public AudioProcessor
+class PanningAudioProcessor : public AudioProcessor, public MemoryFootprintSource
 {
 public:
     //==============================================================================
@@ -45,6 +50,7 @@ public:
 
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
+    void reset() override;
     void processBlock (AudioSampleBuffer&, MidiBuffer&) override;
 
     //==============================================================================
@@ -78,6 +84,7 @@ public:
     bool producesMidi() const override;
     bool isMidiEffect () const override;
     double getTailLengthSeconds() const override;
+    AudioProcessorParameter* getBypassParameter() const override;
 
     //==============================================================================
 
@@ -89,92 +96,42 @@ public:
 
     //==============================================================================
 
-
-
-
-
+    MemoryFootprint getMemoryFootprint() const override;
 
     //==============================================================================
 
     StringArray methodItemsUI = {
         "Panorama + Precedence",
         "ITD + ILD",
+        "HRTF",
     };
 
     enum methodIndex {
-        methodPanoramaPrecedence = 0,
-        methodItdIld,
+        methodPanoramaPrecedence = PanningDSP::methodPanoramaPrecedence,
+        methodItdIld = PanningDSP::methodItdIld,
+        methodHrtf = PanningDSP::methodHrtf,
     };
 
-    //======================================
-
-    class DelayLine
-    {
-    public:
-        void setup (const int maxDelayTimeInSamples)
-        {
-            delayBufferSamples = maxDelayTimeInSamples + 2;
-            if (delayBufferSamples < 1)
-                delayBufferSamples = 1;
-
-            delayBuffer.setSize (1, delayBufferSamples);
-            delayBuffer.clear();
-
-            delayWritePosition = 0;
-        }
-
-        void writeSample (const float sampleToWrite)
-        {
-            delayBuffer.setSample (0, delayWritePosition, sampleToWrite);
-
-            if (++delayWritePosition >= delayBufferSamples)
-                delayWritePosition -= delayBufferSamples;
-        }
-
-        float readSample (const float delayTime){
-            float readPosition =
-                fmodf ((float)(delayWritePosition - 1) - delayTime + (float)delayBufferSamples, delayBufferSamples);
-            int localReadPosition = floorf (readPosition);
-
-            float fraction = readPosition - (float)localReadPosition;
-            float delayed1 = delayBuffer.getSample (0, (localReadPosition + 0));
-            float delayed2 = delayBuffer.getSample (0, (localReadPosition + 1) % delayBufferSamples);
-
-            return delayed1 + fraction * (delayed2 - delayed1);
-        }
-
-    private:
-        AudioSampleBuffer delayBuffer;
-        int delayBufferSamples;
-        int delayWritePosition;
+    StringArray sourcesItemsUI = {
+        "First input channel",
+        "All input channels",
     };
 
-    DelayLine delayLineL;
-    DelayLine delayLineR;
-    int maximumDelayInSamples;
+    enum sourcesIndex {
+        sourcesFirstInput = PanningDSP::sourcesFirstInput,
+        sourcesAllInputs = PanningDSP::sourcesAllInputs,
+    };
 
     //======================================
 
-    class Filter : public IIRFilter
-    {
-    public:
-        void updateCoefficients (const double angle, const double headFactor) noexcept
-        {
-            double alpha = 1.0 + cos (angle);
-
-            coefficients = IIRCoefficients (/* b0 */ headFactor + alpha,
-                                            /* b1 */ headFactor - alpha,
-                                            /* b2 */ 0.0,
-                                            /* a0 */ headFactor + 1.0,
-                                            /* a1 */ headFactor - 1.0,
-                                            /* a2 */ 0.0);
-
-            setCoefficients (coefficients);
-        }
-    };
+    void updateLatency();
+
+    PanningDSP panning;
 
-    Filter filterL;
-    Filter filterR;
+    //======================================
+
+    ProcessBlockProfiler profiler;
+    SilenceDetector silenceDetector;
 
     //======================================
 
@@ -182,6 +139,10 @@ public:
 
     PluginParameterComboBox paramMethod;
     PluginParameterLinSlider paramPanning;
+    PluginParameterComboBox paramSources;
+    PluginParameterLinSlider paramSpread;
+
+    PluginBypass bypass;
 
 private:
     //==============================================================================
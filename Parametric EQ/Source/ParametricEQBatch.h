@@ -0,0 +1,340 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+
+
+#pragma once
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "ParametricEQDSP.h"
+
+//==============================================================================
+
+/** Many independent minimum-phase EQs, one per channel, each with bands of its own,
+    for hosts that put an EQ on many channels, such as a bus of 64 microphones.
+    Separate ParametricEQDSP objects would each run a cascade with a single channel
+    in one lane of its registers.
+
+    The coefficients and the state of every band are kept as a structure of arrays
+    with one instance per SIMD lane, so the lanes of a register hold different
+    filters. The input is interleaved into stride values per sample, and every band
+    runs over the whole sub-block with up to maxNumRegisters registers updated side
+    by side, so that their recursions overlap, before the next band. An EQ of 8 or
+    16 instances then costs about as much as one.
+
+    The parameters take the indices and units of ParametricEQDSP::setParameter(),
+    and the bands compute the same coefficients, so a batch renders what separate
+    instances with the same settings would. Only the direct form topology of the
+    minimum phase mode is batched: the phase and the topology are ignored. The bands
+    past the number of bands of an instance pass its signal through, and start from
+    silence when they are switched on. The instances exist from prepare() on, and
+    their bands can be set from any thread.
+*/
+class ParametricEQBatch
+{
+public:
+    /** Allocates numInstances instances, which keep their settings if there were as
+        many before. Not real-time safe.
+    */
+    void prepare (const double newSampleRate, const int newNumInstances)
+    {
+        const SpinLock::ScopedLockType lock (coefficientsLock);
+        sampleRate = newSampleRate;
+
+        if (numInstances != newNumInstances) {
+            numInstances = newNumInstances;
+            instances.realloc ((size_t)jmax (1, numInstances));
+            for (int instance = 0; instance < numInstances; ++instance)
+                instances[instance] = Instance();
+        }
+
+        numRegisters = (jmax (1, numInstances) + numLanes - 1) / numLanes;
+        stride = numRegisters * numLanes;
+        storage.allocate ((size_t)storageSize(), false);
+
+        samples = snapPointerToAlignment (storage.get(), (size_t)Lanes::SIMDRegisterSize);
+        bandData = samples + maxBlockSize * stride;
+
+        // Every band passes the signal through until an instance sets it
+        for (int band = 0; band < ParametricEQDSP::maxNumBands; ++band) {
+            FloatVectorOperations::fill (getBandValues (band, b0), 1.0f, stride);
+            FloatVectorOperations::clear (getBandValues (band, b1), (numValues - 1) * stride);
+        }
+
+        for (int instance = 0; instance < numInstances; ++instance)
+            for (int band = 0; band < instances[instance].numBands; ++band)
+                updateBand (instance, band);
+
+        resetLanes();
+    }
+
+    void reset() noexcept
+    {
+        const SpinLock::ScopedLockType lock (coefficientsLock);
+        resetLanes();
+    }
+
+    /** Sets a parameter of one instance, with the index and in the units of
+        ParametricEQDSP::setParameter().
+    */
+    void setParameter (const int instance, const int index, const float value) noexcept
+    {
+        if (! isPositiveAndBelow (instance, numInstances))
+            return;
+
+        Instance& settings = instances[instance];
+
+        if (index == ParametricEQDSP::parameterNumBands) {
+            const SpinLock::ScopedLockType lock (coefficientsLock);
+
+            // The bands switched off pass the signal through from silence, and so do
+            // the ones switched on again
+            const int numBands = jlimit (1, (int)ParametricEQDSP::maxNumBands, (int)value);
+            for (int band = jmin (numBands, settings.numBands); band < ParametricEQDSP::maxNumBands; ++band)
+                clearBandState (instance, band);
+            settings.numBands = numBands;
+
+            for (int band = 0; band < ParametricEQDSP::maxNumBands; ++band)
+                updateBand (instance, band);
+            return;
+        }
+
+        int band = 0;
+        int bandParameter = index;
+        if (index >= ParametricEQDSP::parameterFirstBand) {
+            band = 1 + (index - ParametricEQDSP::parameterFirstBand) / ParametricEQDSP::numBandParameters;
+            bandParameter = (index - ParametricEQDSP::parameterFirstBand) % ParametricEQDSP::numBandParameters;
+        }
+        if (! isPositiveAndBelow (band, (int)ParametricEQDSP::maxNumBands)
+            || ! isPositiveAndBelow (bandParameter, (int)ParametricEQDSP::numBandParameters))
+            return;
+
+        ParametricEQDSP::Band& bandSettings = settings.bands[band];
+        switch (bandParameter) {
+            case ParametricEQDSP::bandFrequency:  bandSettings.frequency = value; break;
+            case ParametricEQDSP::bandQfactor:    bandSettings.qFactor = value; break;
+            case ParametricEQDSP::bandGain:       bandSettings.gain = value; break;
+            case ParametricEQDSP::bandFilterType:
+                bandSettings.filterType = jlimit ((int)ParametricEQDSP::filterTypeLowPass, (int)ParametricEQDSP::filterTypePeakingNotch, (int)value);
+                break;
+        }
+
+        const SpinLock::ScopedLockType lock (coefficientsLock);
+        updateBand (instance, band);
+    }
+
+    /** Processes numSamples samples of the numInstances channels in place, the
+        channel of every instance at its index.
+    */
+    void process (float* const* channels, const int numSamples) noexcept;
+
+    int getNumInstances() const noexcept
+    {
+        return numInstances;
+    }
+
+    void addMemoryFootprint (MemoryFootprint& footprint) const
+    {
+        if (storage != nullptr)
+            footprint.add (MemoryFootprint::filters, sizeof (float) * (size_t)storageSize());
+        footprint.add (MemoryFootprint::other, sizeof (Instance) * (size_t)numInstances);
+    }
+
+private:
+    //==============================================================================
+
+    enum { maxBlockSize = 64 };
+
+    typedef dsp::SIMDRegister<float> Lanes;
+
+    enum {
+        numLanes = (int)Lanes::SIMDNumElements,
+        maxNumRegisters = 4,
+    };
+
+    // The values of a band, stride floats each, one lane per instance
+    enum valueIndex {
+        b0 = 0,
+        b1,
+        b2,
+        a1,
+        a2,
+        state1,
+        state2,
+        numValues,
+    };
+
+    int storageSize() const noexcept
+    {
+        return (maxBlockSize + ParametricEQDSP::maxNumBands * numValues) * stride + numLanes;
+    }
+
+    float* getBandValues (const int band, const int value) const noexcept
+    {
+        return bandData + (band * numValues + value) * stride;
+    }
+
+    struct Instance
+    {
+        ParametricEQDSP::Band bands[ParametricEQDSP::maxNumBands];
+        int numBands = 1;
+    };
+
+    /** Writes the coefficients of a band to the lane of an instance: its own ones
+        while the band is on, and a pass-through while it is off. Called under
+        coefficientsLock.
+    */
+    void updateBand (const int instance, const int band) noexcept
+    {
+        IIRCoefficients coefficients (1.0, 0.0, 0.0, 1.0, 0.0, 0.0);
+
+        if (band < instances[instance].numBands) {
+            const ParametricEQDSP::Band& settings = instances[instance].bands[band];
+            const double discreteFrequency = 2.0 * M_PI * (double)settings.frequency / sampleRate;
+            const double q = (double)settings.qFactor;
+            const double linearGain = pow (10.0, (double)settings.gain * 0.05);
+
+            coefficients = ParametricEQDSP::BiquadCascade::makeCoefficients (discreteFrequency, q, linearGain, settings.filterType);
+        }
+
+        for (int value = b0; value <= a2; ++value)
+            getBandValues (band, value)[instance] = coefficients.coefficients[value];
+    }
+
+    void clearBandState (const int instance, const int band) noexcept
+    {
+        getBandValues (band, state1)[instance] = 0.0f;
+        getBandValues (band, state2)[instance] = 0.0f;
+    }
+
+    void resetLanes() noexcept
+    {
+        if (bandData == nullptr)
+            return;
+
+        for (int band = 0; band < ParametricEQDSP::maxNumBands; ++band) {
+            FloatVectorOperations::clear (getBandValues (band, state1), stride);
+            FloatVectorOperations::clear (getBandValues (band, state2), stride);
+        }
+    }
+
+    /** Runs one band over a sub-block of samples, in numActiveRegisters registers
+        from firstRegister on. A constant number of registers, so that the loops over
+        them unroll and the coefficients and states stay in registers.
+    */
+    template <int numActiveRegisters>
+    void processBand (const int band, const int firstRegister, const int numSamples) noexcept
+    {
+        Lanes coefficients[a2 + 1][numActiveRegisters];
+        Lanes s1[numActiveRegisters];
+        Lanes s2[numActiveRegisters];
+
+        const int offset = firstRegister * numLanes;
+        for (int reg = 0; reg < numActiveRegisters; ++reg) {
+            for (int value = b0; value <= a2; ++value)
+                coefficients[value][reg] = Lanes::fromRawArray (getBandValues (band, value) + offset + reg * numLanes);
+            s1[reg] = Lanes::fromRawArray (getBandValues (band, state1) + offset + reg * numLanes);
+            s2[reg] = Lanes::fromRawArray (getBandValues (band, state2) + offset + reg * numLanes);
+        }
+
+        for (int sample = 0; sample < numSamples; ++sample) {
+            float* lanes = samples + sample * stride + offset;
+
+            for (int reg = 0; reg < numActiveRegisters; ++reg) {
+                const Lanes x = Lanes::fromRawArray (lanes + reg * numLanes);
+                const Lanes out = coefficients[b0][reg] * x + s1[reg];
+                s1[reg] = coefficients[b1][reg] * x - coefficients[a1][reg] * out + s2[reg];
+                s2[reg] = coefficients[b2][reg] * x - coefficients[a2][reg] * out;
+                out.copyToRawArray (lanes + reg * numLanes);
+            }
+        }
+
+        for (int reg = 0; reg < numActiveRegisters; ++reg) {
+            s1[reg].copyToRawArray (getBandValues (band, state1) + offset + reg * numLanes);
+            s2[reg].copyToRawArray (getBandValues (band, state2) + offset + reg * numLanes);
+        }
+    }
+
+    HeapBlock<Instance> instances;
+
+    // Aligned to the SIMD registers inside storage: a sub-block of interleaved
+    // samples, then the values of every band
+    HeapBlock<float> storage;
+    float* samples = nullptr;
+    float* bandData = nullptr;
+
+    int numInstances = 0;
+    int numRegisters = 0;
+    int stride = 0;
+    double sampleRate = 44100.0;
+
+    SpinLock coefficientsLock;
+};
+
+//==============================================================================
+
+inline void ParametricEQBatch::process (float* const* channels, const int numSamples) noexcept
+{
+    const SpinLock::ScopedLockType lock (coefficientsLock);
+
+    if (numInstances == 0)
+        return;
+
+    // The bands past the largest number of bands are off in every lane
+    int numBands = 1;
+    for (int instance = 0; instance < numInstances; ++instance)
+        numBands = jmax (numBands, instances[instance].numBands);
+
+    for (int blockStart = 0; blockStart < numSamples; blockStart += maxBlockSize) {
+        const int blockSamples = jmin ((int)maxBlockSize, numSamples - blockStart);
+
+        // The lanes past the last instance stay silent
+        FloatVectorOperations::clear (samples, blockSamples * stride);
+        for (int lane = 0; lane < numInstances; ++lane) {
+            const float* channelData = channels[lane] + blockStart;
+            for (int sample = 0; sample < blockSamples; ++sample)
+                samples[sample * stride + lane] = channelData[sample];
+        }
+
+        for (int band = 0; band < numBands; ++band) {
+            for (int firstRegister = 0; firstRegister < numRegisters; firstRegister += maxNumRegisters) {
+                switch (jmin ((int)maxNumRegisters, numRegisters - firstRegister)) {
+                    case 1:  processBand<1> (band, firstRegister, blockSamples); break;
+                    case 2:  processBand<2> (band, firstRegister, blockSamples); break;
+                    case 3:  processBand<3> (band, firstRegister, blockSamples); break;
+                    default: processBand<maxNumRegisters> (band, firstRegister, blockSamples); break;
+                }
+            }
+        }
+
+        for (int lane = 0; lane < numInstances; ++lane) {
+            float* channelData = channels[lane] + blockStart;
+            for (int sample = 0; sample < blockSamples; ++sample)
+                channelData[sample] = samples[sample * stride + lane];
+        }
+    }
+}
+
+//==============================================================================
@@ -0,0 +1,709 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+
+
+#pragma once
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "MemoryFootprint.h"
+#include "TraceMarkers.h"
+#include "PartitionedConvolution.h"
+#include "StateVariableFilter.h"
+
+//==============================================================================
+
+/** The audio processing of the Parametric EQ, without the parameters, state,
+    editor or buses of the plugin, for hosts that only need the audio and run many
+    instances. ParametricEQAudioProcessor wraps one and hands it the values of its
+    parameters in their natural units: the frequency in Hz, Q factor, gain in dB
+    and index of the filter type of every band, the number of bands from 1 to 8,
+    and the indices of the phase and of the topology.
+
+    The bands recompute their coefficients as soon as they are set, under the
+    locks of the filters, so they can be set from any thread as they change. The
+    phase and topology are read by process() and are set once a block. The kernel
+    of the linear-phase mode is only designed again by buildKernel(), which is not
+    real-time safe and is meant for another thread, once the bands have changed.
+*/
+class ParametricEQDSP
+{
+public:
+    enum { maxNumBands = 8 };
+
+    enum bandParameterIndex {
+        bandFrequency = 0,
+        bandQfactor,
+        bandGain,
+        bandFilterType,
+        numBandParameters,
+    };
+
+    enum parameterIndex {
+        parameterFrequency = 0,
+        parameterQfactor,
+        parameterGain,
+        parameterFilterType,
+        parameterNumBands,
+        parameterPhase,
+        parameterTopology,
+        parameterFirstBand,
+        numParameters = parameterFirstBand + numBandParameters * (maxNumBands - 1),
+    };
+
+    /** Index of a parameter of the bands after the first one, numbered from 2. */
+    static int getBandParameterIndex (const int bandNumber, const int bandParameter) noexcept
+    {
+        return parameterFirstBand + numBandParameters * (bandNumber - 2) + bandParameter;
+    }
+
+    enum filterTypeIndex {
+        filterTypeLowPass = 0,
+        filterTypeHighPass,
+        filterTypeLowShelf,
+        filterTypeHighShelf,
+        filterTypeBandPass,
+        filterTypeBandStop,
+        filterTypePeakingNotch,
+    };
+
+    enum topologyIndex {
+        topologyDirectForm = 0,
+        topologyStateVariable,
+    };
+
+    enum phaseIndex {
+        phaseMinimum = 0,
+        phaseLinear,
+    };
+
+    //======================================
+
+    /** Builds the filters of every channel, and the convolutions and kernel of the
+        linear-phase mode for the sample rate. Not real-time safe.
+    */
+    void prepare (const double newSampleRate, const int numChannels);
+
+    void reset() noexcept;
+
+    void setParameter (const int index, const float value) noexcept;
+
+    /** Designs the kernel of the linear-phase mode from the bands as they are, and
+        swaps it in. The audio thread crossfades to it over the next partition. Does
+        nothing before prepare(). Not real-time safe.
+    */
+    void buildKernel();
+
+    /** The latency of the linear-phase mode, and the length of its kernel, 0 before
+        prepare().
+    */
+    int getLinearPhaseLatency() const noexcept { return (int)convolutionBlockSize + kernelSize / 2; }
+    int getKernelSize() const noexcept { return kernelSize; }
+
+    /** The coefficients of a band, numbered from 0, for the response of the editor. */
+    IIRCoefficients getBandCoefficients (const int band) const;
+
+    /** Processes numSamples samples of numChannels channels in place. */
+    void process (float* const* channels, const int numChannels, const int numSamples) noexcept;
+
+    void addMemoryFootprint (MemoryFootprint& footprint) const;
+
+private:
+    //==============================================================================
+
+    // Designs the bands of many instances the same way
+    friend class ParametricEQBatch;
+
+    /** All the bands as TDF-II biquads run one after the other, for up to
+        maxNumChannels channels at once with one channel per SIMD lane. The
+        coefficients and the state of every band live in aligned arrays, so the
+        whole EQ is a single pass over the buffer.
+
+        Every sample of a band waits for the previous one, so a single register
+        leaves most of the pipeline idle. The channels fill up to numRegisters
+        registers that are updated side by side, so that their recursions overlap,
+        and a cascade of 8 or 16 channels costs about as much as one of numLanes.
+    */
+    class BiquadCascade
+    {
+    public:
+        typedef dsp::SIMDRegister<float> Lanes;
+
+        enum {
+            numLanes = (int)Lanes::SIMDNumElements,
+            numRegisters = 4,
+            maxNumChannels = numLanes * numRegisters,
+        };
+
+        BiquadCascade()
+            : numActiveBands (0)
+        {
+            for (int band = 0; band < maxNumBands; ++band) {
+                b0[band] = Lanes::expand (1.0f);
+                b1[band] = b2[band] = a1[band] = a2[band] = Lanes::expand (0.0f);
+                for (int reg = 0; reg < numRegisters; ++reg)
+                    state1[band][reg] = state2[band][reg] = Lanes::expand (0.0f);
+            }
+        }
+
+        static IIRCoefficients makeCoefficients (const double discreteFrequency,
+                                                 const double qFactor,
+                                                 const double gain,
+                                                 const int filterType) noexcept
+        {
+            jassert (discreteFrequency > 0);
+            jassert (qFactor > 0);
+
+            IIRCoefficients newCoefficients;
+
+            double bandwidth = jmin (discreteFrequency / qFactor, M_PI * 0.99);
+            double two_cos_wc = -2.0 * cos (discreteFrequency);
+            double tan_half_bw = tan (bandwidth / 2.0);
+            double tan_half_wc = tan (discreteFrequency / 2.0);
+            double sqrt_gain = sqrt (gain);
+
+            switch (filterType) {
+                case filterTypeLowPass: {
+                    newCoefficients = IIRCoefficients (/* b0 */ tan_half_wc,
+                                                       /* b1 */ tan_half_wc,
+                                                       /* b2 */ 0.0,
+                                                       /* a0 */ tan_half_wc + 1.0,
+                                                       /* a1 */ tan_half_wc - 1.0,
+                                                       /* a2 */ 0.0);
+                    break;
+                }
+                case filterTypeHighPass: {
+                    newCoefficients = IIRCoefficients (/* b0 */ 1.0,
+                                                       /* b1 */ -1.0,
+                                                       /* b2 */ 0.0,
+                                                       /* a0 */ tan_half_wc + 1.0,
+                                                       /* a1 */ tan_half_wc - 1.0,
+                                                       /* a2 */ 0.0);
+                    break;
+                }
+                case filterTypeLowShelf: {
+                    newCoefficients = IIRCoefficients (/* b0 */ gain * tan_half_wc + sqrt_gain,
+                                                       /* b1 */ gain * tan_half_wc - sqrt_gain,
+                                                       /* b2 */ 0.0,
+                                                       /* a0 */ tan_half_wc + sqrt_gain,
+                                                       /* a1 */ tan_half_wc - sqrt_gain,
+                                                       /* a2 */ 0.0);
+                    break;
+                }
+                case filterTypeHighShelf: {
+                    newCoefficients = IIRCoefficients (/* b0 */ sqrt_gain * tan_half_wc + gain,
+                                                       /* b1 */ sqrt_gain * tan_half_wc - gain,
+                                                       /* b2 */ 0.0,
+                                                       /* a0 */ sqrt_gain * tan_half_wc + 1.0,
+                                                       /* a1 */ sqrt_gain * tan_half_wc - 1.0,
+                                                       /* a2 */ 0.0);
+                    break;
+                }
+                case filterTypeBandPass: {
+                    newCoefficients = IIRCoefficients (/* b0 */ tan_half_bw,
+                                                       /* b1 */ 0.0,
+                                                       /* b2 */ -tan_half_bw,
+                                                       /* a0 */ 1.0 + tan_half_bw,
+                                                       /* a1 */ two_cos_wc,
+                                                       /* a2 */ 1.0 - tan_half_bw);
+                    break;
+                }
+                case filterTypeBandStop: {
+                    newCoefficients = IIRCoefficients (/* b0 */ 1.0,
+                                                       /* b1 */ two_cos_wc,
+                                                       /* b2 */ 1.0,
+                                                       /* a0 */ 1.0 + tan_half_bw,
+                                                       /* a1 */ two_cos_wc,
+                                                       /* a2 */ 1.0 - tan_half_bw);
+                    break;
+                }
+                case filterTypePeakingNotch: {
+                    newCoefficients = IIRCoefficients (/* b0 */ sqrt_gain + gain * tan_half_bw,
+                                                       /* b1 */ sqrt_gain * two_cos_wc,
+                                                       /* b2 */ sqrt_gain - gain * tan_half_bw,
+                                                       /* a0 */ sqrt_gain + tan_half_bw,
+                                                       /* a1 */ sqrt_gain * two_cos_wc,
+                                                       /* a2 */ sqrt_gain - tan_half_bw);
+                    break;
+                }
+            }
+
+            return newCoefficients;
+        }
+
+        void updateCoefficients (const int band, const IIRCoefficients& newCoefficients) noexcept
+        {
+            jassert (isPositiveAndBelow (band, (int)maxNumBands));
+
+            const SpinLock::ScopedLockType lock (coefficientsLock);
+            b0[band] = Lanes::expand (newCoefficients.coefficients[0]);
+            b1[band] = Lanes::expand (newCoefficients.coefficients[1]);
+            b2[band] = Lanes::expand (newCoefficients.coefficients[2]);
+            a1[band] = Lanes::expand (newCoefficients.coefficients[3]);
+            a2[band] = Lanes::expand (newCoefficients.coefficients[4]);
+        }
+
+        void reset() noexcept
+        {
+            // The bands are cleared as they become active again
+            const SpinLock::ScopedLockType lock (coefficientsLock);
+            numActiveBands = 0;
+        }
+
+        void processSamples (float* const* channelData,
+                             const int numChannels,
+                             const int numSamples,
+                             const int numBands) noexcept
+        {
+            jassert (numChannels <= maxNumChannels && numBands <= maxNumBands);
+
+            const SpinLock::ScopedLockType lock (coefficientsLock);
+
+            for (int band = numActiveBands; band < numBands; ++band)
+                for (int reg = 0; reg < numRegisters; ++reg)
+                    state1[band][reg] = state2[band][reg] = Lanes::expand (0.0f);
+            numActiveBands = numBands;
+
+            switch ((numChannels + numLanes - 1) / numLanes) {
+                case 1:  processRegisters<1> (channelData, numChannels, numSamples, numBands); break;
+                case 2:  processRegisters<2> (channelData, numChannels, numSamples, numBands); break;
+                case 3:  processRegisters<3> (channelData, numChannels, numSamples, numBands); break;
+                default: processRegisters<numRegisters> (channelData, numChannels, numSamples, numBands); break;
+            }
+        }
+
+    private:
+        /** A constant number of registers, so that the loops over them unroll. */
+        template <int numActiveRegisters>
+        void processRegisters (float* const* channelData,
+                               const int numChannels,
+                               const int numSamples,
+                               const int numBands) noexcept
+        {
+            for (int sample = 0; sample < numSamples; ++sample) {
+                Lanes x[numActiveRegisters];
+                for (int reg = 0; reg < numActiveRegisters; ++reg)
+                    x[reg] = Lanes::expand (0.0f);
+                for (int channel = 0; channel < numChannels; ++channel)
+                    x[channel / numLanes].set ((size_t)(channel % numLanes), channelData[channel][sample]);
+
+                for (int band = 0; band < numBands; ++band) {
+                    for (int reg = 0; reg < numActiveRegisters; ++reg) {
+                        const Lanes out = b0[band] * x[reg] + state1[band][reg];
+                        state1[band][reg] = b1[band] * x[reg] - a1[band] * out + state2[band][reg];
+                        state2[band][reg] = b2[band] * x[reg] - a2[band] * out;
+                        x[reg] = out;
+                    }
+                }
+
+                for (int channel = 0; channel < numChannels; ++channel)
+                    channelData[channel][sample] = x[channel / numLanes].get ((size_t)(channel % numLanes));
+            }
+        }
+
+        Lanes b0[maxNumBands];
+        Lanes b1[maxNumBands];
+        Lanes b2[maxNumBands];
+        Lanes a1[maxNumBands];
+        Lanes a2[maxNumBands];
+        Lanes state1[maxNumBands][numRegisters];
+        Lanes state2[maxNumBands][numRegisters];
+        int numActiveBands;
+
+        SpinLock coefficientsLock;
+    };
+
+    //======================================
+
+    struct Band
+    {
+        float frequency = 1000.0f;
+        float qFactor = 1.41421356f;
+        float gain = 0.0f;
+        int filterType = filterTypePeakingNotch;
+    };
+
+    Band bands[maxNumBands];
+    int currentNumBands = 1;
+    int selectedPhase = phaseMinimum;
+    int selectedTopology = topologyDirectForm;
+    double sampleRate = 44100.0;
+
+    void updateBand (const int band);
+
+    OwnedArray<BiquadCascade> cascades;
+
+    //======================================
+
+    /** The same bands in TPT form, maxNumBands per input channel. The first order
+        types use a one-pole and match the biquads exactly; the second order ones
+        differ slightly in how the bandwidth is warped.
+    */
+    OwnedArray<StateVariableFilter> stateVariableFilters;
+    int stateVariableNumActiveBands = 0;
+    SpinLock stateVariableLock;
+    static int getStateVariableResponse (const int filterType) noexcept;
+    void processStateVariable (float* const* channels, const int numChannels, const int numSamples, const int numBands);
+    int currentTopology = topologyDirectForm;
+
+    //======================================
+
+    /** Linear-phase mode. The magnitude response of the bands, as designed by
+        BiquadCascade::makeCoefficients(), is sampled on the bins of a kernelSize-point
+        FFT with zero phase. Its inverse transform is centred and windowed into a
+        symmetric FIR kernel, which every channel runs through a PartitionedConvolution
+        with partitions of convolutionBlockSize samples. The latency is
+        convolutionBlockSize + kernelSize / 2 samples.
+
+        The kernel is rebuilt by buildKernel() under configurationLock, and swapped in
+        under kernelLock. The audio thread crossfades from the previous kernel over
+        the next partition.
+    */
+    enum { convolutionBlockSize = 512 };
+
+    void processLinearPhase (float* const* channels, const int numChannels, const int numSamples);
+    void processConvolutionBlock (const int numChannels);
+
+    /** The size of the kernel and the buffers that design it, only changed under
+        configurationLock.
+    */
+    CriticalSection configurationLock;
+    int kernelSize = 0;
+    std::unique_ptr<dsp::FFT> kernelFft;
+    HeapBlock<float> kernelBuffer;
+    PartitionedConvolution kernelDesigner;
+
+    HeapBlock<float> kernel;
+    HeapBlock<float> previousKernel;
+    bool kernelChanged = false;
+    SpinLock kernelLock;
+
+    OwnedArray<PartitionedConvolution> convolutions;
+    AudioSampleBuffer convolutionInput;
+    AudioSampleBuffer convolutionOutput;
+    float convolutionPreviousOutput[convolutionBlockSize];
+    int convolutionPosition = 0;
+    int currentPhase = phaseMinimum;
+};
+
+//==============================================================================
+
+inline void ParametricEQDSP::prepare (const double newSampleRate, const int numChannels)
+{
+    const ScopedLock lock (configurationLock);
+    sampleRate = newSampleRate;
+
+    cascades.clear();
+    for (int i = 0; i < numChannels; i += BiquadCascade::maxNumChannels)
+        cascades.add (new BiquadCascade());
+    stateVariableFilters.clear();
+    for (int i = 0; i < numChannels * maxNumBands; ++i)
+        stateVariableFilters.add (new StateVariableFilter());
+    for (int band = 0; band < maxNumBands; ++band)
+        updateBand (band);
+
+    // Around 8192 taps at 48 kHz, so that the kernel resolves the lowest bands
+    kernelSize = jmax ((int)convolutionBlockSize, nextPowerOfTwo (roundToInt (8192.0 * sampleRate / 48000.0)));
+    kernelFft = std::make_unique<dsp::FFT>(log2 (kernelSize));
+    kernelBuffer.realloc (2 * kernelSize);
+    kernelDesigner.prepare (convolutionBlockSize, kernelSize / convolutionBlockSize);
+
+    convolutions.clear();
+    for (int channel = 0; channel < numChannels; ++channel) {
+        convolutions.add (new PartitionedConvolution());
+        convolutions.getLast()->prepare (convolutionBlockSize, kernelSize / convolutionBlockSize);
+    }
+    convolutionInput.setSize (numChannels, convolutionBlockSize);
+    convolutionOutput.setSize (numChannels, convolutionBlockSize);
+
+    kernel.free();
+    previousKernel.free();
+    buildKernel();
+
+    reset();
+}
+
+inline void ParametricEQDSP::reset() noexcept
+{
+    for (int i = 0; i < cascades.size(); ++i)
+        cascades[i]->reset();
+    stateVariableNumActiveBands = 0;
+
+    for (int i = 0; i < convolutions.size(); ++i)
+        convolutions[i]->reset();
+    convolutionInput.clear();
+    convolutionOutput.clear();
+    convolutionPosition = 0;
+}
+
+inline void ParametricEQDSP::setParameter (const int index, const float value) noexcept
+{
+    switch (index) {
+        case parameterNumBands: currentNumBands = jlimit (1, (int)maxNumBands, (int)value); return;
+        case parameterPhase:    selectedPhase = jlimit ((int)phaseMinimum, (int)phaseLinear, (int)value); return;
+        case parameterTopology: selectedTopology = jlimit ((int)topologyDirectForm, (int)topologyStateVariable, (int)value); return;
+    }
+
+    int band = 0;
+    int bandParameter = index;
+    if (index >= parameterFirstBand) {
+        band = 1 + (index - parameterFirstBand) / numBandParameters;
+        bandParameter = (index - parameterFirstBand) % numBandParameters;
+    }
+    if (! isPositiveAndBelow (band, (int)maxNumBands) || ! isPositiveAndBelow (bandParameter, (int)numBandParameters))
+        return;
+
+    switch (bandParameter) {
+        case bandFrequency:  bands[band].frequency = value; break;
+        case bandQfactor:    bands[band].qFactor = value; break;
+        case bandGain:       bands[band].gain = value; break;
+        case bandFilterType: bands[band].filterType = jlimit ((int)filterTypeLowPass, (int)filterTypePeakingNotch, (int)value); break;
+    }
+    updateBand (band);
+}
+
+inline void ParametricEQDSP::process (float* const* channels, const int numChannels, const int numSamples) noexcept
+{
+    const int phase = selectedPhase;
+    const int topology = selectedTopology;
+    if (phase != currentPhase || topology != currentTopology) {
+        reset();
+        currentPhase = phase;
+        currentTopology = topology;
+    }
+
+    if (phase == phaseLinear) {
+        processLinearPhase (channels, jmin (numChannels, convolutions.size()), numSamples);
+    } else if (topology == topologyStateVariable) {
+        processStateVariable (channels, numChannels, numSamples, currentNumBands);
+    } else {
+        for (int group = 0; group < cascades.size(); ++group) {
+            const int firstChannel = group * BiquadCascade::maxNumChannels;
+            const int numGroupChannels = jmin ((int)BiquadCascade::maxNumChannels, numChannels - firstChannel);
+            cascades[group]->processSamples (channels + firstChannel, numGroupChannels, numSamples, currentNumBands);
+        }
+    }
+}
+
+//==============================================================================
+
+inline void ParametricEQDSP::updateBand (const int band)
+{
+    TRACE_SCOPE ("updateBand");
+
+    const IIRCoefficients coefficients = getBandCoefficients (band);
+
+    for (int i = 0; i < cascades.size(); ++i)
+        cascades[i]->updateCoefficients (band, coefficients);
+
+    if (stateVariableFilters.isEmpty())
+        return;
+
+    double discreteFrequency = 2.0 * M_PI * (double)bands[band].frequency / sampleRate;
+    double q = (double)bands[band].qFactor;
+    double linearGain = pow (10.0, (double)bands[band].gain * 0.05);
+    int response = getStateVariableResponse (bands[band].filterType);
+
+    const SpinLock::ScopedLockType lock (stateVariableLock);
+    for (int i = band; i < stateVariableFilters.size(); i += maxNumBands) {
+        stateVariableFilters[i]->setResponse (response, q, linearGain);
+        stateVariableFilters[i]->setCutoff (discreteFrequency);
+    }
+}
+
+inline IIRCoefficients ParametricEQDSP::getBandCoefficients (const int band) const
+{
+    double discreteFrequency = 2.0 * M_PI * (double)bands[band].frequency / sampleRate;
+    double q = (double)bands[band].qFactor;
+    double linearGain = pow (10.0, (double)bands[band].gain * 0.05);
+
+    return BiquadCascade::makeCoefficients (discreteFrequency, q, linearGain, bands[band].filterType);
+}
+
+inline int ParametricEQDSP::getStateVariableResponse (const int filterType) noexcept
+{
+    switch (filterType) {
+        case filterTypeLowPass:
+            return StateVariableFilter::responseFirstOrderLowPass;
+        case filterTypeHighPass:
+            return StateVariableFilter::responseFirstOrderHighPass;
+        case filterTypeLowShelf:
+            return StateVariableFilter::responseFirstOrderLowShelf;
+        case filterTypeHighShelf:
+            return StateVariableFilter::responseFirstOrderHighShelf;
+        case filterTypeBandPass:
+            return StateVariableFilter::responseBandPass;
+        case filterTypeBandStop:
+            return StateVariableFilter::responseBandStop;
+        default:
+            return StateVariableFilter::responsePeaking;
+    }
+}
+
+inline void ParametricEQDSP::processStateVariable (float* const* channels, const int numChannels, const int numSamples,
+                                                   const int numBands)
+{
+    const SpinLock::ScopedLockType lock (stateVariableLock);
+
+    // The bands are cleared as they become active again
+    for (int band = stateVariableNumActiveBands; band < numBands; ++band)
+        for (int channel = 0; channel < numChannels; ++channel)
+            stateVariableFilters[channel * maxNumBands + band]->reset();
+    stateVariableNumActiveBands = numBands;
+
+    for (int channel = 0; channel < numChannels; ++channel) {
+        float* channelData = channels[channel];
+
+        for (int band = 0; band < numBands; ++band) {
+            StateVariableFilter* filter = stateVariableFilters[channel * maxNumBands + band];
+            for (int sample = 0; sample < numSamples; ++sample)
+                channelData[sample] = filter->processSample (channelData[sample]);
+        }
+    }
+}
+
+//==============================================================================
+
+inline void ParametricEQDSP::buildKernel()
+{
+    TRACE_SCOPE ("buildKernel");
+
+    const ScopedLock lock (configurationLock);
+
+    // Not prepared yet
+    if (kernelSize == 0)
+        return;
+
+    IIRCoefficients coefficients[maxNumBands];
+    const int numBands = currentNumBands;
+    for (int band = 0; band < numBands; ++band)
+        coefficients[band] = getBandCoefficients (band);
+
+    // Zero-phase spectrum: the magnitude of the whole cascade at every bin
+    kernelBuffer.clear (2 * kernelSize);
+    for (int bin = 0; bin <= kernelSize / 2; ++bin) {
+        const std::complex<double> z1 = std::polar (1.0, -2.0 * M_PI * (double)bin / (double)kernelSize);
+        const std::complex<double> z2 = z1 * z1;
+
+        double magnitude = 1.0;
+        for (int band = 0; band < numBands; ++band) {
+            const float* c = coefficients[band].coefficients;
+            magnitude *= std::abs (((double)c[0] + (double)c[1] * z1 + (double)c[2] * z2)
+                                 / (1.0 + (double)c[3] * z1 + (double)c[4] * z2));
+        }
+        kernelBuffer[2 * bin] = (float)magnitude;
+    }
+
+    kernelFft->performRealOnlyInverseTransform (kernelBuffer);
+
+    // The impulse response is centred on t = 0, so it is rotated by half the kernel
+    // and windowed to taper the ends. Both keep it symmetric about kernelSize / 2.
+    float* taps = kernelBuffer + kernelSize;
+    for (int n = 0; n < kernelSize; ++n) {
+        const double phase = 2.0 * M_PI * (double)n / (double)kernelSize;
+        const float window = (float)(0.42 - 0.5 * cos (phase) + 0.08 * cos (2.0 * phase));
+        taps[n] = kernelBuffer[(n + kernelSize / 2) % kernelSize] * window;
+    }
+
+    HeapBlock<float> newKernel (kernelDesigner.getFilterSize());
+    kernelDesigner.prepareFilter (taps, kernelSize, newKernel);
+
+    {
+        const SpinLock::ScopedLockType lock (kernelLock);
+        previousKernel.swapWith (kernel);
+        kernel.swapWith (newKernel);
+        kernelChanged = (previousKernel != nullptr);
+    }
+    // newKernel now holds the kernel before the previous one, and frees it here
+}
+
+inline void ParametricEQDSP::processLinearPhase (float* const* channels, const int numChannels, const int numSamples)
+{
+    for (int sample = 0; sample < numSamples;) {
+        const int blockSamples = jmin (numSamples - sample, (int)convolutionBlockSize - convolutionPosition);
+
+        for (int channel = 0; channel < numChannels; ++channel) {
+            float* channelData = channels[channel] + sample;
+            FloatVectorOperations::copy (convolutionInput.getWritePointer (channel, convolutionPosition), channelData, blockSamples);
+            FloatVectorOperations::copy (channelData, convolutionOutput.getReadPointer (channel, convolutionPosition), blockSamples);
+        }
+
+        sample += blockSamples;
+        convolutionPosition += blockSamples;
+        if (convolutionPosition == convolutionBlockSize) {
+            processConvolutionBlock (numChannels);
+            convolutionPosition = 0;
+        }
+    }
+}
+
+inline void ParametricEQDSP::processConvolutionBlock (const int numChannels)
+{
+    const SpinLock::ScopedLockType lock (kernelLock);
+
+    for (int channel = 0; channel < numChannels; ++channel) {
+        PartitionedConvolution& convolution = *convolutions[channel];
+        float* output = convolutionOutput.getWritePointer (channel);
+
+        convolution.pushBlock (convolutionInput.getReadPointer (channel));
+        if (kernel == nullptr) {
+            FloatVectorOperations::clear (output, convolutionBlockSize);
+            continue;
+        }
+        convolution.convolve (kernel, output);
+
+        // Crossfade from the output of the previous kernel over the whole block
+        if (kernelChanged) {
+            const float fadeStep = 1.0f / (float)convolutionBlockSize;
+            convolution.convolve (previousKernel, convolutionPreviousOutput);
+            for (int sample = 0; sample < convolutionBlockSize; ++sample)
+                output[sample] = convolutionPreviousOutput[sample]
+                    + (float)(sample + 1) * fadeStep * (output[sample] - convolutionPreviousOutput[sample]);
+        }
+    }
+
+    kernelChanged = false;
+}
+
+inline void ParametricEQDSP::addMemoryFootprint (MemoryFootprint& footprint) const
+{
+    const ScopedLock lock (configurationLock);
+
+    footprint.add (MemoryFootprint::filters, sizeof (BiquadCascade) * (size_t)cascades.size()
+                                             + sizeof (StateVariableFilter) * (size_t)stateVariableFilters.size());
+
+    // The linear-phase resources are there from prepare() on, whatever the mode
+    if (kernelSize > 0) {
+        footprint.addFftPlan (kernelSize);
+        footprint.add (MemoryFootprint::filters, sizeof (float) * (size_t)(2 * kernelSize + 2 * kernelDesigner.getFilterSize()));
+        kernelDesigner.addMemoryFootprint (footprint);
+    }
+    for (int i = 0; i < convolutions.size(); ++i)
+        convolutions[i]->addMemoryFootprint (footprint);
+    footprint.add (MemoryFootprint::filters, convolutionInput);
+    footprint.add (MemoryFootprint::filters, convolutionOutput);
+}
+
+//==============================================================================
@@ -0,0 +1,172 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "MemoryFootprint.h"
+
+//==============================================================================
+
+/** Uniformly partitioned overlap-save convolution.
+
+    Every block of blockSize input samples is transformed once and kept in a
+    frequency-domain delay line. Filters are split into partitions of blockSize
+    samples and transformed in advance with prepareFilter(), so that convolving
+    a block with any of them is a sum of spectral products and one inverse FFT.
+    The latency is blockSize samples, whatever the length of the filters.
+
+    Spectra use the interleaved real and imaginary layout of the real-only FFT,
+    with the blockSize + 1 non-negative frequency bins of a 2 * blockSize frame.
+*/
+class PartitionedConvolution
+{
+public:
+    //==============================================================================
+
+    void prepare (const int newBlockSize, const int newNumPartitions)
+    {
+        blockSize = newBlockSize;
+        numPartitions = newNumPartitions;
+        numBins = blockSize + 1;
+
+        fft = std::make_unique<dsp::FFT>(log2 (2 * blockSize));
+
+        fftBuffer.realloc (4 * blockSize);
+        frame.realloc (2 * blockSize);
+        inputSpectra.realloc (numPartitions * getSpectrumSize());
+
+        reset();
+    }
+
+    void reset()
+    {
+        fftBuffer.clear (4 * blockSize);
+        frame.clear (2 * blockSize);
+        inputSpectra.clear (numPartitions * getSpectrumSize());
+        newestPartition = 0;
+    }
+
+    /** Number of floats that a filter prepared by prepareFilter() takes. */
+    int getFilterSize() const noexcept
+    {
+        return numPartitions * getSpectrumSize();
+    }
+
+    /** Length in samples of the longest impulse response that prepareFilter() takes. */
+    int getMaxImpulseLength() const noexcept
+    {
+        return numPartitions * blockSize;
+    }
+
+    /** Transforms an impulse response of up to numPartitions * blockSize samples
+        into the partition spectra that convolve() takes. Not real-time safe.
+    */
+    void prepareFilter (const float* impulseResponse, const int length, float* filter)
+    {
+        for (int partition = 0; partition < numPartitions; ++partition) {
+            const int partitionStart = partition * blockSize;
+            const int partitionSamples = jlimit (0, blockSize, length - partitionStart);
+
+            fftBuffer.clear (4 * blockSize);
+            if (partitionSamples > 0)
+                FloatVectorOperations::copy (fftBuffer, impulseResponse + partitionStart, partitionSamples);
+
+            fft->performRealOnlyForwardTransform (fftBuffer, true);
+            FloatVectorOperations::copy (filter + partition * getSpectrumSize(), fftBuffer, getSpectrumSize());
+        }
+    }
+
+    /** Adds the next blockSize input samples to the frequency-domain delay line. */
+    void pushBlock (const float* input) noexcept
+    {
+        // Overlap-save: every frame is the previous input block followed by the new one
+        FloatVectorOperations::copy (frame, frame + blockSize, blockSize);
+        FloatVectorOperations::copy (frame + blockSize, input, blockSize);
+
+        FloatVectorOperations::copy (fftBuffer, frame, 2 * blockSize);
+        FloatVectorOperations::clear (fftBuffer + 2 * blockSize, 2 * blockSize);
+        fft->performRealOnlyForwardTransform (fftBuffer, true);
+
+        if (--newestPartition < 0)
+            newestPartition += numPartitions;
+        FloatVectorOperations::copy (inputSpectra + newestPartition * getSpectrumSize(), fftBuffer, getSpectrumSize());
+    }
+
+    /** Writes the blockSize output samples of the last pushed block convolved with
+        a filter prepared by prepareFilter().
+    */
+    void convolve (const float* filter, float* output) noexcept
+    {
+        FloatVectorOperations::clear (fftBuffer, 4 * blockSize);
+
+        for (int partition = 0; partition < numPartitions; ++partition) {
+            const int delayed = (newestPartition + partition) % numPartitions;
+            const float* input = inputSpectra + delayed * getSpectrumSize();
+            const float* coefficients = filter + partition * getSpectrumSize();
+
+            for (int bin = 0; bin < 2 * numBins; bin += 2) {
+                const float inputReal = input[bin];
+                const float inputImag = input[bin + 1];
+                const float coefficientReal = coefficients[bin];
+                const float coefficientImag = coefficients[bin + 1];
+
+                fftBuffer[bin] += inputReal * coefficientReal - inputImag * coefficientImag;
+                fftBuffer[bin + 1] += inputReal * coefficientImag + inputImag * coefficientReal;
+            }
+        }
+
+        fft->performRealOnlyInverseTransform (fftBuffer);
+
+        // The first half of the frame is circular aliasing, the second half is the output
+        FloatVectorOperations::copy (output, fftBuffer + blockSize, blockSize);
+    }
+
+    /** The plan, the frame and the input spectra. The filters belong to the caller. */
+    void addMemoryFootprint (MemoryFootprint& footprint) const noexcept
+    {
+        if (fft != nullptr)
+            footprint.addFftPlan (2 * blockSize);
+
+        footprint.add (MemoryFootprint::filters, sizeof (float) * (size_t)(6 * blockSize + numPartitions * getSpectrumSize()));
+    }
+
+private:
+    //==============================================================================
+
+    int getSpectrumSize() const noexcept
+    {
+        return 2 * numBins;
+    }
+
+    int blockSize = 0;
+    int numPartitions = 0;
+    int numBins = 0;
+    int newestPartition = 0;
+
+    std::unique_ptr<dsp::FFT> fft;
+    HeapBlock<float> fftBuffer;
+    HeapBlock<float> frame;
+    HeapBlock<float> inputSpectra;
+};
+
+//==============================================================================
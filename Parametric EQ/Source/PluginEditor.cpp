@@ -31,7 +31,6 @@ ParametricEQAudioProcessorEditor::ParametricEQAudioProcessorEditor (ParametricEQ
     const Array<AudioProcessorParameter*> parameters = processor.getParameters();
     int comboBoxCounter = 0;
 
-    int editorHeight = 2 * editorMargin;
     for (int i = 0; i < parameters.size(); ++i) {
         if (const AudioProcessorParameterWithID* parameter =
                 dynamic_cast<AudioProcessorParameterWithID*> (parameters[i])) {
@@ -50,7 +49,6 @@ ParametricEQAudioProcessorEditor::ParametricEQAudioProcessorEditor (ParametricEQ
                     new SliderAttachment (processor.parameters.apvts, parameter->paramID, *aSlider));
 
                 components.add (aSlider);
-                editorHeight += sliderHeight;
             }
 
             //======================================
@@ -65,7 +63,6 @@ ParametricEQAudioProcessorEditor::ParametricEQAudioProcessorEditor (ParametricEQ
                     new ButtonAttachment (processor.parameters.apvts, parameter->paramID, *aButton));
 
                 components.add (aButton);
-                editorHeight += buttonHeight;
             }
 
             //======================================
@@ -82,7 +79,6 @@ ParametricEQAudioProcessorEditor::ParametricEQAudioProcessorEditor (ParametricEQ
                     new ComboBoxAttachment (processor.parameters.apvts, parameter->paramID, *aComboBox));
 
                 components.add (aComboBox);
-                editorHeight += comboBoxHeight;
             }
 
             //======================================
@@ -99,17 +95,20 @@ ParametricEQAudioProcessorEditor::ParametricEQAudioProcessorEditor (ParametricEQ
     }
 
     addAndMakeVisible (&bandwidthLabel);
-    editorHeight += 20;
+    addAndMakeVisible (responseCurve);
 
     //======================================
 
-    editorHeight += components.size() * editorPadding;
-    setSize (editorWidth, editorHeight);
+    setLookAndFeel (lookAndFeel);
+    updateUIcomponents();
+    setSize (editorWidth, getEditorHeight());
     startTimer (50);
 }
 
 ParametricEQAudioProcessorEditor::~ParametricEQAudioProcessorEditor()
 {
+    renderingContext.detach();
+    setLookAndFeel (nullptr);
 }
 
 //==============================================================================
@@ -125,6 +124,9 @@ void ParametricEQAudioProcessorEditor::resized()
     r = r.removeFromRight (r.getWidth() - labelWidth);
 
     for (int i = 0; i < components.size(); ++i) {
+        if (! components[i]->isVisible())
+            continue;
+
         if (Slider* aSlider = dynamic_cast<Slider*> (components[i]))
             components[i]->setBounds (r.removeFromTop (sliderHeight));
 
@@ -138,13 +140,46 @@ void ParametricEQAudioProcessorEditor::resized()
     }
 
     bandwidthLabel.setBounds (0, getBottom() - 20, getWidth(), 20);
+
+    Rectangle<int> curveBounds = getLocalBounds().reduced (editorMargin);
+    curveBounds.removeFromBottom (20);
+    responseCurve.setBounds (curveBounds.removeFromBottom (ResponseCurveDisplay::preferredHeight));
 }
 
 //==============================================================================
 
 void ParametricEQAudioProcessorEditor::timerCallback()
 {
-    updateUIcomponents();
+    // Only touches the components when something they show changed
+    if (uiValues.generationChanged (processor.parameters.getChangeGeneration())) {
+        Array<float> values ({ processor.paramFrequency.getTargetValue(),
+                               processor.paramQfactor.getTargetValue(),
+                               processor.paramFilterType.getTargetValue(),
+                               processor.paramNumBands.getTargetValue() });
+        for (ParametricEQAudioProcessor::Band* band : processor.extraBands)
+            values.add (band->paramFilterType.getTargetValue());
+
+        if (uiValues.changed (values.begin(), values.size()))
+            updateUIcomponents();
+    }
+
+    const uint32 generation = processor.responseGeneration.load();
+    if (responseCurve.needsUpdate (generation))
+        updateResponseCurve (generation);
+}
+
+void ParametricEQAudioProcessorEditor::updateResponseCurve (const uint32 generation)
+{
+    // Not prepared yet
+    if (processor.getSampleRate() <= 0.0)
+        return;
+
+    IIRCoefficients bands[ParametricEQAudioProcessor::maxNumBands];
+    const int numBands = jlimit (1, (int)ParametricEQAudioProcessor::maxNumBands, (int)processor.paramNumBands.getTargetValue());
+    for (int band = 0; band < numBands; ++band)
+        bands[band] = processor.parametricEQ.getBandCoefficients (band);
+
+    responseCurve.setResponse (generation, processor.getSampleRate(), bands, numBands);
 }
 
 void ParametricEQAudioProcessorEditor::updateUIcomponents()
@@ -157,29 +192,75 @@ void ParametricEQAudioProcessorEditor::updateUIcomponents()
 
     //======================================
 
+    bool band1HasQfactor = updateBandComponents (processor.paramFilterType,
+                                                 processor.paramQfactor.paramID,
+                                                 processor.paramGain.paramID);
+    bandwidthLabel.setVisible (band1HasQfactor);
+
+    const int numBands = (int)processor.paramNumBands.getTargetValue();
+    for (int i = 0; i < processor.extraBands.size(); ++i) {
+        ParametricEQAudioProcessor::Band* band = processor.extraBands[i];
+
+        const bool bandIsActive = i + 1 < numBands;
+        findChildWithID (band->paramFrequency.paramID)->setVisible (bandIsActive);
+        findChildWithID (band->paramQfactor.paramID)->setVisible (bandIsActive);
+        findChildWithID (band->paramGain.paramID)->setVisible (bandIsActive);
+        findChildWithID (band->paramFilterType.paramID)->setVisible (bandIsActive);
+
+        updateBandComponents (band->paramFilterType, band->paramQfactor.paramID, band->paramGain.paramID);
+    }
+
+    const int editorHeight = getEditorHeight();
+    if (editorHeight != getHeight())
+        setSize (editorWidth, editorHeight);
+        setOpaque (true);
+        renderingContext.attachTo (*this);
+}
+
+bool ParametricEQAudioProcessorEditor::updateBandComponents (const PluginParameterComboBox& filterType,
+                                                             const String& qFactorID,
+                                                             const String& gainID)
+{
+    const int type = (int)filterType.getTargetValue();
+
     bool filterTypeDoesNotHaveQfactor =
-        processor.paramFilterType.getTargetValue() == processor.filterTypeLowPass ||
-        processor.paramFilterType.getTargetValue() == processor.filterTypeHighPass ||
-        processor.paramFilterType.getTargetValue() == processor.filterTypeLowShelf ||
-        processor.paramFilterType.getTargetValue() == processor.filterTypeHighShelf;
+        type == processor.filterTypeLowPass ||
+        type == processor.filterTypeHighPass ||
+        type == processor.filterTypeLowShelf ||
+        type == processor.filterTypeHighShelf;
     bool filterTypeDoesNotHaveGain =
-        processor.paramFilterType.getTargetValue() == processor.filterTypeLowPass ||
-        processor.paramFilterType.getTargetValue() == processor.filterTypeHighPass ||
-        processor.paramFilterType.getTargetValue() == processor.filterTypeBandPass ||
-        processor.paramFilterType.getTargetValue() == processor.filterTypeBandStop;
-
-    if (filterTypeDoesNotHaveQfactor) {
-        findChildWithID (processor.paramQfactor.paramID)->setEnabled (false);
-        bandwidthLabel.setVisible (false);
-    } else {
-        findChildWithID (processor.paramQfactor.paramID)->setEnabled (true);
-        bandwidthLabel.setVisible (true);
+        type == processor.filterTypeLowPass ||
+        type == processor.filterTypeHighPass ||
+        type == processor.filterTypeBandPass ||
+        type == processor.filterTypeBandStop;
+
+    findChildWithID (qFactorID)->setEnabled (! filterTypeDoesNotHaveQfactor);
+    findChildWithID (gainID)->setEnabled (! filterTypeDoesNotHaveGain);
+
+    return ! filterTypeDoesNotHaveQfactor;
+}
+
+int ParametricEQAudioProcessorEditor::getEditorHeight()
+{
+    int editorHeight = 2 * editorMargin + 20 + ResponseCurveDisplay::preferredHeight + editorPadding;
+
+    for (int i = 0; i < components.size(); ++i) {
+        if (! components[i]->isVisible())
+            continue;
+
+        if (Slider* aSlider = dynamic_cast<Slider*> (components[i]))
+            editorHeight += sliderHeight;
+
+        if (ToggleButton* aButton = dynamic_cast<ToggleButton*> (components[i]))
+            editorHeight += buttonHeight;
+
+        if (ComboBox* aComboBox = dynamic_cast<ComboBox*> (components[i]))
+            editorHeight += comboBoxHeight;
+
+        editorHeight += editorPadding;
     }
 
-    if (filterTypeDoesNotHaveGain)
-        findChildWithID (processor.paramGain.paramID)->setEnabled (false);
-    else
-        findChildWithID (processor.paramGain.paramID)->setEnabled (true);
+    return editorHeight;
 }
 
 //==============================================================================
@@ -24,6 +24,8 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "PluginProcessor.h"
+#include "EditorRendering.h"
+#include "ResponseCurveDisplay.h"
 
 //==============================================================================
 
@@ -79,8 +81,21 @@ private:
 
     void timerCallback() override;
     void updateUIcomponents();
+    bool updateBandComponents (const PluginParameterComboBox& filterType,
+                               const String& qFactorID,
+                               const String& gainID);
+    int getEditorHeight();
     Label bandwidthLabel;
 
+    void updateResponseCurve (const uint32 generation);
+    ResponseCurveDisplay responseCurve;
+    EditorValueSnapshot uiValues;
+
+    //======================================
+
+    EditorRenderingContext renderingContext;
+    SharedResourcePointer<EditorLookAndFeel> lookAndFeel;
+
     //==============================================================================
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ParametricEQAudioProcessorEditor)
@@ -42,14 +42,27 @@ ParametricEQAudioProcessor::ParametricEQAudioProcessor():
 #endif
     parameters (*this)
     , paramFrequency (parameters, "Frequency", "Hz", 10.0f, 20000.0f, 1500.0f,
-                      [this](float value){ paramFrequency.setCurrentAndTargetValue (value); updateFilters(); return value; })
+                      [this](float value){ paramFrequency.setCurrentAndTargetValue (value); setFilterParameter (ParametricEQDSP::parameterFrequency, value); return value; })
     , paramQfactor (parameters, "Q Factor", "", 0.1f, 20.0f, sqrt (2.0f),
-                    [this](float value){ paramQfactor.setCurrentAndTargetValue (value); updateFilters(); return value; })
+                    [this](float value){ paramQfactor.setCurrentAndTargetValue (value); setFilterParameter (ParametricEQDSP::parameterQfactor, value); return value; })
     , paramGain (parameters, "Gain", "dB", -12.0f, 12.0f, 12.0f,
-                 [this](float value){ paramGain.setCurrentAndTargetValue (value); updateFilters(); return value; })
+                 [this](float value){ paramGain.setCurrentAndTargetValue (value); setFilterParameter (ParametricEQDSP::parameterGain, value); return value; })
     , paramFilterType (parameters, "Filter type", filterTypeItemsUI, filterTypePeakingNotch,
-                       [this](float value){ paramFilterType.setCurrentAndTargetValue (value); updateFilters(); return value; })
+                       [this](float value){ paramFilterType.setCurrentAndTargetValue (value); setFilterParameter (ParametricEQDSP::parameterFilterType, value); return value; })
+    , paramNumBands (parameters, "Number of bands", {"1", "2", "3", "4", "5", "6", "7", "8"}, 0,
+                     [this](float value){ paramNumBands.setCurrentAndTargetValue (value + 1); setFilterParameter (ParametricEQDSP::parameterNumBands, value + 1); return value + 1; })
+    , paramPhase (parameters, "Phase", phaseItemsUI, phaseMinimum,
+                  [this](float value){ parametricEQ.buildKernel(); setLatencySamples ((int)value == phaseLinear ? parametricEQ.getLinearPhaseLatency() : 0); return value; })
+    , paramTopology (parameters, "Topology", topologyItemsUI, topologyDirectForm)
+    , bypass (*this, parameters)
 {
+    // Designs the FIR kernel of the linear-phase mode
+    paramPhase.deferCallback();
+
+    const float defaultFrequencies[maxNumBands] = {1500.0f, 50.0f, 150.0f, 400.0f, 1000.0f, 2500.0f, 6000.0f, 12000.0f};
+    for (int band = 1; band < maxNumBands; ++band)
+        extraBands.add (new Band (*this, band + 1, defaultFrequencies[band]));
+
     parameters.apvts.state = ValueTree (Identifier (getName().removeCharacters ("- ")));
 }
 
@@ -57,60 +70,125 @@ ParametricEQAudioProcessor::~ParametricEQAudioProcessor()
 {
 }
 
+ParametricEQAudioProcessor::Band::Band (ParametricEQAudioProcessor& p, const int bandNumber, const float defaultFrequency)
+    : frequencyName ("Frequency " + String (bandNumber))
+    , qFactorName ("Q Factor " + String (bandNumber))
+    , gainName ("Gain " + String (bandNumber))
+    , filterTypeName ("Filter type " + String (bandNumber))
+    , paramFrequency (p.parameters, frequencyName, "Hz", 10.0f, 20000.0f, defaultFrequency,
+                      [this, &p, bandNumber](float value){
+                          paramFrequency.setCurrentAndTargetValue (value);
+                          p.setFilterParameter (ParametricEQDSP::getBandParameterIndex (bandNumber, ParametricEQDSP::bandFrequency), value);
+                          return value; })
+    , paramQfactor (p.parameters, qFactorName, "", 0.1f, 20.0f, sqrt (2.0f),
+                    [this, &p, bandNumber](float value){
+                        paramQfactor.setCurrentAndTargetValue (value);
+                        p.setFilterParameter (ParametricEQDSP::getBandParameterIndex (bandNumber, ParametricEQDSP::bandQfactor), value);
+                        return value; })
+    , paramGain (p.parameters, gainName, "dB", -12.0f, 12.0f, 0.0f,
+                 [this, &p, bandNumber](float value){
+                     paramGain.setCurrentAndTargetValue (value);
+                     p.setFilterParameter (ParametricEQDSP::getBandParameterIndex (bandNumber, ParametricEQDSP::bandGain), value);
+                     return value; })
+    , paramFilterType (p.parameters, filterTypeName, p.filterTypeItemsUI, filterTypePeakingNotch,
+                       [this, &p, bandNumber](float value){
+                           paramFilterType.setCurrentAndTargetValue (value);
+                           p.setFilterParameter (ParametricEQDSP::getBandParameterIndex (bandNumber, ParametricEQDSP::bandFilterType), value);
+                           return value; })
+{
+}
+
 //==============================================================================
 
 void ParametricEQAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
+    TRACE_INSTANCE_SCOPE ("prepareToPlay", this);
+
     const double smoothTime = 1e-3;
     paramFrequency.reset (sampleRate, smoothTime);
     paramQfactor.reset (sampleRate, smoothTime);
     paramGain.reset (sampleRate, smoothTime);
     paramFilterType.reset (sampleRate, smoothTime);
+    paramNumBands.reset (sampleRate, smoothTime);
+    paramPhase.reset (sampleRate, smoothTime);
+    paramTopology.reset (sampleRate, smoothTime);
+    for (int i = 0; i < extraBands.size(); ++i) {
+        extraBands[i]->paramFrequency.reset (sampleRate, smoothTime);
+        extraBands[i]->paramQfactor.reset (sampleRate, smoothTime);
+        extraBands[i]->paramGain.reset (sampleRate, smoothTime);
+        extraBands[i]->paramFilterType.reset (sampleRate, smoothTime);
+    }
 
     //======================================
 
-    filters.clear();
-    for (int i = 0; i < getTotalNumInputChannels(); ++i) {
-        Filter* filter;
-        filters.add (filter = new Filter());
-    }
-    updateFilters();
+    parameters.flushDeferredCallbacks();
+
+    updateDSPParameters();
+    parametricEQ.prepare (sampleRate, getTotalNumInputChannels());
+    setLatencySamples ((int)paramPhase.getTargetValue() == phaseLinear ? parametricEQ.getLinearPhaseLatency() : 0);
+    ++responseGeneration;
+
+    profiler.prepare (sampleRate);
+    silenceDetector.prepare (sampleRate);
+    bypass.prepare (sampleRate, samplesPerBlock, parametricEQ.getLinearPhaseLatency());
 }
 
 void ParametricEQAudioProcessor::releaseResources()
 {
 }
 
+void ParametricEQAudioProcessor::reset()
+{
+    parametricEQ.reset();
+}
+
 void ParametricEQAudioProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
 {
+    const ProcessBlockProfiler::ScopedMeasurement measurement (profiler, buffer.getNumSamples(), isNonRealtime());
+    TRACE_INSTANCE_SCOPE ("processBlock", this);
     ScopedNoDenormals noDenormals;
 
     const int numInputChannels = getTotalNumInputChannels();
     const int numOutputChannels = getTotalNumOutputChannels();
     const int numSamples = buffer.getNumSamples();
 
+    parameters.applyDeferredValues();
+    parameters.applySnapshotMorph();
+
     //======================================
 
-    for (int channel = 0; channel < numInputChannels; ++channel) {
-        float* channelData = buffer.getWritePointer (channel);
-        filters[channel]->processSamples (channelData, numSamples);
-    }
+    if (silenceDetector.skipBlock (*this, buffer))
+        return;
+
+    if (bypass.begin (buffer))
+        return;
+
+    updateDSPParameters();
+    parametricEQ.process (buffer.getArrayOfWritePointers(), numInputChannels, numSamples);
 
     for (int channel = numInputChannels; channel < numOutputChannels; ++channel)
         buffer.clear (channel, 0, numSamples);
+
+    bypass.end (buffer);
 }
 
 //==============================================================================
 
-void ParametricEQAudioProcessor::updateFilters()
+void ParametricEQAudioProcessor::setFilterParameter (const int index, const float value)
 {
-    double discreteFrequency = 2.0 * M_PI * (double)paramFrequency.getTargetValue() / getSampleRate();
-    double qFactor = (double)paramQfactor.getTargetValue();
-    double gain = pow (10.0, (double)paramGain.getTargetValue() * 0.05);
-    int type = (int)paramFilterType.getTargetValue();
+    parametricEQ.setParameter (index, value);
+    ++responseGeneration;
 
-    for (int i = 0; i < filters.size(); ++i)
-        filters[i]->updateCoefficients (discreteFrequency, qFactor, gain, type);
+    // Before prepareToPlay there is no kernel to rebuild, and paramPhase may not
+    // have been constructed yet
+    if (parametricEQ.getKernelSize() > 0 && (int)paramPhase.getTargetValue() == phaseLinear)
+        paramPhase.retriggerDeferredCallback();
+}
+
+void ParametricEQAudioProcessor::updateDSPParameters() noexcept
+{
+    parametricEQ.setParameter (ParametricEQDSP::parameterPhase, paramPhase.getTargetValue());
+    parametricEQ.setParameter (ParametricEQDSP::parameterTopology, paramTopology.getTargetValue());
 }
 
 //==============================================================================
@@ -124,13 +202,17 @@ void ParametricEQAudioProcessor::updateFilters()
 
 void ParametricEQAudioProcessor::getStateInformation (MemoryBlock& destData)
 {
-    auto state = parameters.apvts.copyState();
-    std::unique_ptr<XmlElement> xml (state.createXml());
-    copyXmlToBinary (*xml, destData);
+    MemoryOutputStream stream (destData, false);
+    parameters.writeState (stream);
 }
 
 void ParametricEQAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
+    MemoryInputStream stream (data, (size_t)sizeInBytes, false);
+    if (parameters.readState (stream))
+        return;
+
+    // Sessions saved in the XML format of older versions
     std::unique_ptr<XmlElement> xmlState (getXmlFromBinary (data, sizeInBytes));
 
     if (xmlState.get() != nullptr)
@@ -159,10 +241,9 @@ bool ParametricEQAudioProcessor::isBusesLayoutSupported (const BusesLayout& layo
     ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    if (layouts.getMainOutputChannelSet() != AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != AudioChannelSet::stereo())
+    // The channels are processed independently, so any layout with at least one
+    // channel is supported, from mono to surround sets or ambisonic stems.
+    if (layouts.getMainOutputChannelSet().isDisabled())
         return false;
 
     // This checks if the input layout matches the output layout
@@ -212,7 +293,25 @@ bool ParametricEQAudioProcessor::isMidiEffect() const
 
 double ParametricEQAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // The kernel rings for its whole length after the latency
+    if (parametricEQ.getKernelSize() > 0 && (int)paramPhase.getTargetValue() == phaseLinear)
+        return (double)(parametricEQ.getLinearPhaseLatency() + parametricEQ.getKernelSize() / 2) / getSampleRate();
+
+    // The bands are in series, so their tails add up
+    double tailLengthSeconds = SilenceDetector::getResonanceTailSeconds (paramFrequency.getTargetValue(),
+                                                                         paramQfactor.getTargetValue());
+
+    const int numBands = (int)paramNumBands.getTargetValue();
+    for (int i = 0; i < jmin (numBands - 1, extraBands.size()); ++i)
+        tailLengthSeconds += SilenceDetector::getResonanceTailSeconds (extraBands[i]->paramFrequency.getTargetValue(),
+                                                                       extraBands[i]->paramQfactor.getTargetValue());
+
+    return tailLengthSeconds;
+}
+
+AudioProcessorParameter* ParametricEQAudioProcessor::getBypassParameter() const
+{
+    return bypass.getParameter();
 }
 
 //==============================================================================
@@ -243,6 +342,21 @@ void ParametricEQAudioProcessor::changeProgramName (int index, const String& new
 
 //==============================================================================
 
+MemoryFootprint ParametricEQAudioProcessor::getMemoryFootprint() const
+{
+    const ScopedLock lock (parameters.deferredCallbackLock);
+
+    MemoryFootprint footprint;
+    footprint.add (MemoryFootprint::other, sizeof (*this));
+    bypass.addMemoryFootprint (footprint);
+
+    parametricEQ.addMemoryFootprint (footprint);
+
+    return footprint;
+}
+
+//==============================================================================
+
 // This creates new instances of the plugin..
 AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
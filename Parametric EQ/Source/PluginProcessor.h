@@ -30,10 +30,15 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "PluginParameter.h"
+#include "ProcessBlockProfiler.h"
+#include "SilenceDetector.h"
+#include "PluginBypass.h"
+#include "MemoryFootprint.h"
+#include "ParametricEQDSP.h"
 
 //==============================================================================
 
-class ParametricEQAudioProcessor : public AudioProcessor
+class ParametricEQAudioProcessor : public AudioProcessor, public MemoryFootprintSource
 {
 public:
     //==============================================================================
@@ -45,6 +50,7 @@ public:
 
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
+    void reset() override;
     void processBlock (AudioSampleBuffer&, MidiBuffer&) override;
 
     //==============================================================================
@@ -78,6 +84,7 @@ public:
     bool producesMidi() const override;
     bool isMidiEffect () const override;
     double getTailLengthSeconds() const override;
+    AudioProcessorParameter* getBypassParameter() const override;
 
     //==============================================================================
 
@@ -89,10 +96,7 @@ public:
 
     //==============================================================================
 
-
-
-
-
+    MemoryFootprint getMemoryFootprint() const override;
 
     //==============================================================================
 
@@ -107,106 +111,88 @@ public:
     };
 
     enum filterTypeIndex {
-        filterTypeLowPass = 0,
-        filterTypeHighPass,
-        filterTypeLowShelf,
-        filterTypeHighShelf,
-        filterTypeBandPass,
-        filterTypeBandStop,
-        filterTypePeakingNotch,
+        filterTypeLowPass = ParametricEQDSP::filterTypeLowPass,
+        filterTypeHighPass = ParametricEQDSP::filterTypeHighPass,
+        filterTypeLowShelf = ParametricEQDSP::filterTypeLowShelf,
+        filterTypeHighShelf = ParametricEQDSP::filterTypeHighShelf,
+        filterTypeBandPass = ParametricEQDSP::filterTypeBandPass,
+        filterTypeBandStop = ParametricEQDSP::filterTypeBandStop,
+        filterTypePeakingNotch = ParametricEQDSP::filterTypePeakingNotch,
+    };
+
+    //======================================
+
+    enum { maxNumBands = ParametricEQDSP::maxNumBands };
+
+    /** Incremented whenever the coefficients of the bands change, so that the
+        editor knows when to draw the response again.
+    */
+    std::atomic<uint32> responseGeneration { 0 };
+
+    /** Hands a setting of the bands to the core, which recomputes their
+        coefficients, and has the editor draw the response again and the kernel of
+        the linear-phase mode designed again.
+    */
+    void setFilterParameter (const int index, const float value);
+
+    //======================================
+
+    StringArray topologyItemsUI = {
+        "Direct form",
+        "State variable"
+    };
+
+    enum topologyIndex {
+        topologyDirectForm = ParametricEQDSP::topologyDirectForm,
+        topologyStateVariable = ParametricEQDSP::topologyStateVariable,
     };
 
     //======================================
 
-    class Filter : public IIRFilter
+    StringArray phaseItemsUI = {
+        "Minimum",
+        "Linear"
+    };
+
+    enum phaseIndex {
+        phaseMinimum = ParametricEQDSP::phaseMinimum,
+        phaseLinear = ParametricEQDSP::phaseLinear,
+    };
+
+    //======================================
+
+    /** Hands the phase and topology to the core, once a block. */
+    void updateDSPParameters() noexcept;
+
+    ParametricEQDSP parametricEQ;
+
+    //======================================
+
+    /** Parameters of the bands after the first one, which keeps the original
+        parameter IDs.
+    */
+    class Band
     {
     public:
-        void updateCoefficients (const double discreteFrequency,
-                                 const double qFactor,
-                                 const double gain,
-                                 const int filterType) noexcept
-        {
-            jassert (discreteFrequency > 0);
-            jassert (qFactor > 0);
-
-            double bandwidth = jmin (discreteFrequency / qFactor, M_PI * 0.99);
-            double two_cos_wc = -2.0 * cos (discreteFrequency);
-            double tan_half_bw = tan (bandwidth / 2.0);
-            double tan_half_wc = tan (discreteFrequency / 2.0);
-            double sqrt_gain = sqrt (gain);
-
-            switch (filterType) {
-                case filterTypeLowPass: {
-                    coefficients = IIRCoefficients (/* b0 */ tan_half_wc,
-                                                    /* b1 */ tan_half_wc,
-                                                    /* b2 */ 0.0,
-                                                    /* a0 */ tan_half_wc + 1.0,
-                                                    /* a1 */ tan_half_wc - 1.0,
-                                                    /* a2 */ 0.0);
-                    break;
-                }
-                case filterTypeHighPass: {
-                    coefficients = IIRCoefficients (/* b0 */ 1.0,
-                                                    /* b1 */ -1.0,
-                                                    /* b2 */ 0.0,
-                                                    /* a0 */ tan_half_wc + 1.0,
-                                                    /* a1 */ tan_half_wc - 1.0,
-                                                    /* a2 */ 0.0);
-                    break;
-                }
-                case filterTypeLowShelf: {
-                    coefficients = IIRCoefficients (/* b0 */ gain * tan_half_wc + sqrt_gain,
-                                                    /* b1 */ gain * tan_half_wc - sqrt_gain,
-                                                    /* b2 */ 0.0,
-                                                    /* a0 */ tan_half_wc + sqrt_gain,
-                                                    /* a1 */ tan_half_wc - sqrt_gain,
-                                                    /* a2 */ 0.0);
-                    break;
-                }
-                case filterTypeHighShelf: {
-                    coefficients = IIRCoefficients (/* b0 */ sqrt_gain * tan_half_wc + gain,
-                                                    /* b1 */ sqrt_gain * tan_half_wc - gain,
-                                                    /* b2 */ 0.0,
-                                                    /* a0 */ sqrt_gain * tan_half_wc + 1.0,
-                                                    /* a1 */ sqrt_gain * tan_half_wc - 1.0,
-                                                    /* a2 */ 0.0);
-                    break;
-                }
-                case filterTypeBandPass: {
-                    coefficients = IIRCoefficients (/* b0 */ tan_half_bw,
-                                                    /* b1 */ 0.0,
-                                                    /* b2 */ -tan_half_bw,
-                                                    /* a0 */ 1.0 + tan_half_bw,
-                                                    /* a1 */ two_cos_wc,
-                                                    /* a2 */ 1.0 - tan_half_bw);
-                    break;
-                }
-                case filterTypeBandStop: {
-                    coefficients = IIRCoefficients (/* b0 */ 1.0,
-                                                    /* b1 */ two_cos_wc,
-                                                    /* b2 */ 1.0,
-                                                    /* a0 */ 1.0 + tan_half_bw,
-                                                    /* a1 */ two_cos_wc,
-                                                    /* a2 */ 1.0 - tan_half_bw);
-                    break;
-                }
-                case filterTypePeakingNotch: {
-                    coefficients = IIRCoefficients (/* b0 */ sqrt_gain + gain * tan_half_bw,
-                                                    /* b1 */ sqrt_gain * two_cos_wc,
-                                                    /* b2 */ sqrt_gain - gain * tan_half_bw,
-                                                    /* a0 */ sqrt_gain + tan_half_bw,
-                                                    /* a1 */ sqrt_gain * two_cos_wc,
-                                                    /* a2 */ sqrt_gain - tan_half_bw);
-                    break;
-                }
-            }
-
-            setCoefficients (coefficients);
-        }
+        Band (ParametricEQAudioProcessor& processor, const int bandNumber, const float defaultFrequency);
+
+        const String frequencyName;
+        const String qFactorName;
+        const String gainName;
+        const String filterTypeName;
+
+        PluginParameterLogSlider paramFrequency;
+        PluginParameterLinSlider paramQfactor;
+        PluginParameterLinSlider paramGain;
+        PluginParameterComboBox paramFilterType;
     };
 
-    OwnedArray<Filter> filters;
-    void updateFilters();
+    OwnedArray<Band> extraBands;
+
+    //======================================
+
+    ProcessBlockProfiler profiler;
+    SilenceDetector silenceDetector;
 
     //======================================
 
@@ -216,6 +202,11 @@ public:
     PluginParameterLinSlider paramQfactor;
     PluginParameterLinSlider paramGain;
     PluginParameterComboBox paramFilterType;
+    PluginParameterComboBox paramNumBands;
+    PluginParameterComboBox paramPhase;
+    PluginParameterComboBox paramTopology;
+
+    PluginBypass bypass;
 
 private:
     //==============================================================================
@@ -0,0 +1,152 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <cmath>
+
+//==============================================================================
+
+/** Magnitude response in dB of biquads in series, on a log-spaced grid from 20 Hz
+    to 20 kHz, 0 dB in the middle.
+
+    The response is cached along with the generation of the coefficients it was
+    computed from, so the timer of the editor only works it out again when the
+    processor reports new coefficients. Each band is then a few vector operations
+    over tables of cos (w) and cos (2w), with one log10() per point at the end.
+*/
+class ResponseCurveDisplay : public Component
+{
+public:
+    enum {
+        preferredHeight = 120,
+        numPoints = 256,
+    };
+
+    /** True if the curve was not computed from this generation of coefficients. */
+    bool needsUpdate (const uint32 generation) const noexcept
+    {
+        return ! hasResponse || generation != cachedGeneration;
+    }
+
+    void setResponse (const uint32 generation,
+                      const double sampleRate,
+                      const IIRCoefficients* bands,
+                      const int numBands)
+    {
+        if (sampleRate != gridSampleRate)
+            prepareGrid (sampleRate);
+
+        FloatVectorOperations::fill (numerator, 1.0f, numPoints);
+        FloatVectorOperations::fill (denominator, 1.0f, numPoints);
+
+        // |b0 + b1 z^-1 + b2 z^-2|^2 = b0^2 + b1^2 + b2^2 + 2 (b0 b1 + b1 b2) cos (w) + 2 b0 b2 cos (2w),
+        // and the same for the denominator with a0 = 1
+        for (int band = 0; band < numBands; ++band) {
+            const float* c = bands[band].coefficients;
+            accumulate (numerator,
+                        c[0] * c[0] + c[1] * c[1] + c[2] * c[2],
+                        2.0f * (c[0] * c[1] + c[1] * c[2]),
+                        2.0f * c[0] * c[2]);
+            accumulate (denominator,
+                        1.0f + c[3] * c[3] + c[4] * c[4],
+                        2.0f * (c[3] + c[3] * c[4]),
+                        2.0f * c[4]);
+        }
+
+        for (int point = 0; point < numPoints; ++point)
+            decibels[point] = 10.0f * std::log10 (jmax (numerator[point] / denominator[point], 1e-12f));
+
+        cachedGeneration = generation;
+        hasResponse = true;
+        repaint();
+    }
+
+    void paint (Graphics& g) override
+    {
+        const Rectangle<float> r = getLocalBounds().toFloat();
+        g.setColour (findColour (Slider::backgroundColourId));
+        g.fillRect (r);
+
+        g.setColour (findColour (Label::textColourId).withAlpha (0.3f));
+        g.drawHorizontalLine (roundToInt (r.getCentreY()), r.getX(), r.getRight());
+
+        if (! hasResponse)
+            return;
+
+        Path curve;
+        for (int point = 0; point < numPoints; ++point) {
+            const float x = r.getX() + r.getWidth() * (float)point / (float)(numPoints - 1);
+            const float y = r.getCentreY() - 0.5f * r.getHeight() * jlimit (-1.0f, 1.0f, decibels[point] / maxDecibels);
+
+            if (point == 0)
+                curve.startNewSubPath (x, y);
+            else
+                curve.lineTo (x, y);
+        }
+
+        g.setColour (findColour (Slider::thumbColourId));
+        g.strokePath (curve, PathStrokeType (2.0f));
+    }
+
+private:
+    //==============================================================================
+
+    void prepareGrid (const double sampleRate)
+    {
+        for (int point = 0; point < numPoints; ++point) {
+            const double frequency = minFrequency * pow (maxFrequency / minFrequency, (double)point / (double)(numPoints - 1));
+            const double discreteFrequency = jmin (2.0 * M_PI * frequency / sampleRate, M_PI);
+            cosW[point] = (float)cos (discreteFrequency);
+            cos2W[point] = (float)cos (2.0 * discreteFrequency);
+        }
+
+        gridSampleRate = sampleRate;
+    }
+
+    /** Multiplies product by c0 + c1 cos (w) + c2 cos (2w) at every point. */
+    void accumulate (float* product, const float c0, const float c1, const float c2) noexcept
+    {
+        FloatVectorOperations::copyWithMultiply (term, cosW, c1, numPoints);
+        FloatVectorOperations::addWithMultiply (term, cos2W, c2, numPoints);
+        FloatVectorOperations::add (term, c0, numPoints);
+        FloatVectorOperations::multiply (product, term, numPoints);
+    }
+
+    const double minFrequency = 20.0;
+    const double maxFrequency = 20000.0;
+    const float maxDecibels = 24.0f;
+
+    double gridSampleRate = 0.0;
+    uint32 cachedGeneration = 0;
+    bool hasResponse = false;
+
+    float cosW[numPoints];
+    float cos2W[numPoints];
+    float numerator[numPoints];
+    float denominator[numPoints];
+    float term[numPoints];
+    float decibels[numPoints];
+};
+
+//==============================================================================
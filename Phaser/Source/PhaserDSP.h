@@ -0,0 +1,448 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+
+
+#pragma once
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "MemoryFootprint.h"
+#include "TraceMarkers.h"
+#include "WavetableLFO.h"
+
+//==============================================================================
+
+/** The audio processing of the Phaser, without the parameters, state, editor or
+    buses of the plugin, for hosts that only need the audio and run many instances.
+    PhaserAudioProcessor wraps one and hands it the values of its parameters once a
+    block, in their natural units: the depth and the feedback from 0 to 1, the
+    number of filters, the minimum frequency and the sweep width in Hz, the
+    frequency of the LFO in Hz, the index of its waveform and the stereo mode as 0
+    or 1. The depth, feedback, frequencies and sweep width ramp over the smoothing
+    time given to prepare().
+*/
+class PhaserDSP
+{
+public:
+    enum parameterIndex {
+        parameterDepth = 0,
+        parameterFeedback,
+        parameterNumFilters,
+        parameterMinFrequency,
+        parameterSweepWidth,
+        parameterLFOfrequency,
+        parameterLFOwaveform,
+        parameterStereo,
+        numParameters,
+    };
+
+    enum waveformIndex {
+        waveformSine = 0,
+        waveformTriangle,
+        waveformSquare,
+        waveformSawtooth,
+    };
+
+    enum { maxNumFilters = 10 };
+
+    /** The ranges of the minimum frequency and of the sweep width, in Hz, over which
+        the coefficients of the filters are worked out in prepare().
+    */
+    static constexpr float minMinFrequency = 50.0f;
+    static constexpr float maxMinFrequency = 1000.0f;
+    static constexpr float minSweepWidth = 50.0f;
+    static constexpr float maxSweepWidth = 3000.0f;
+
+    void prepare (const double sampleRate, const int numChannels, const double smoothTime);
+
+    void reset() noexcept;
+
+    void setParameter (const int index, const float value) noexcept
+    {
+        switch (index) {
+            case parameterDepth:        smoothedDepth.setTargetValue (value); break;
+            case parameterFeedback:     smoothedFeedback.setTargetValue (value); break;
+            case parameterNumFilters:   selectedNumFilters = jlimit (2, (int)maxNumFilters, (int)value); break;
+            case parameterMinFrequency: smoothedMinFrequency.setTargetValue (value); break;
+            case parameterSweepWidth:   smoothedSweepWidth.setTargetValue (value); break;
+            case parameterLFOfrequency: smoothedLFOfrequency.setTargetValue (value); break;
+            case parameterLFOwaveform:  currentWaveform = jlimit ((int)waveformSine, (int)waveformSawtooth, (int)value); break;
+            case parameterStereo:       currentStereo = (value != 0.0f); break;
+        }
+    }
+
+    /** The steps of reduction of a quality governor, each of which takes two stages
+        off the number of filters, with a crossfade.
+    */
+    void setQualityReduction (const int newQualityReduction) noexcept
+    {
+        qualityReduction = newQualityReduction;
+    }
+
+    /** Processes numSamples samples of numChannels channels in place. */
+    void process (float* const* channels, const int numChannels, const int numSamples) noexcept;
+
+    void addMemoryFootprint (MemoryFootprint& footprint) const
+    {
+        footprint.add (MemoryFootprint::filters, sizeof (AllPassCascade) * (size_t)cascades.size());
+    }
+
+private:
+    //==============================================================================
+
+    /** First-order all-pass stages for up to numLanes channels at once.
+
+        Each channel runs in its own SIMD lane and state[i] holds stage i for all of
+        them, so a stereo pair goes through the whole cascade for the price of one
+        channel. Every stage of a lane shares the same coefficient.
+    */
+    class AllPassCascade
+    {
+    public:
+        typedef dsp::SIMDRegister<float> Lanes;
+
+        enum {
+            numLanes = (int)Lanes::SIMDNumElements,
+            maxNumStages = maxNumFilters,
+        };
+
+        AllPassCascade()
+        {
+            reset();
+        }
+
+        void reset() noexcept
+        {
+            coefficients = Lanes::expand (0.0f);
+            lastOutput = Lanes::expand (0.0f);
+            for (int i = 0; i < maxNumStages; ++i)
+                state[i] = Lanes::expand (0.0f);
+        }
+
+        /** Sets the coefficient of every stage of every lane in one go. */
+        void setCoefficients (const Lanes newCoefficients) noexcept
+        {
+            coefficients = newCoefficients;
+        }
+
+        Lanes processSample (const Lanes in, const float feedback, const int numStages) noexcept
+        {
+            jassert (numStages <= maxNumStages);
+
+            Lanes filtered = in + lastOutput * feedback;
+            for (int i = 0; i < numStages; ++i) {
+                const Lanes out = coefficients * filtered + state[i];
+                state[i] = filtered - coefficients * out;
+                filtered = out;
+            }
+
+            lastOutput = filtered;
+            return filtered;
+        }
+
+        /** Same as processSample(), crossfading by fade, from 0 to 1, from the output
+            after previousNumStages stages to the output after numStages. The two
+            share their first stages, so it costs as much as the longer one.
+        */
+        Lanes processSample (const Lanes in, const float feedback, const int numStages,
+                             const int previousNumStages, const float fade) noexcept
+        {
+            const int longestNumStages = jmax (numStages, previousNumStages);
+            jassert (longestNumStages <= maxNumStages);
+
+            Lanes filtered = in + lastOutput * feedback;
+            Lanes previousOutput = filtered;
+            Lanes output = filtered;
+            for (int i = 0; i < longestNumStages; ++i) {
+                const Lanes out = coefficients * filtered + state[i];
+                state[i] = filtered - coefficients * out;
+                filtered = out;
+
+                if (i + 1 == previousNumStages)
+                    previousOutput = filtered;
+                if (i + 1 == numStages)
+                    output = filtered;
+            }
+
+            lastOutput = previousOutput + (output - previousOutput) * fade;
+            return lastOutput;
+        }
+
+        /** Clears the stages from firstStage on, before a crossfade brings them in. */
+        void clearStages (const int firstStage) noexcept
+        {
+            for (int i = firstStage; i < maxNumStages; ++i)
+                state[i] = Lanes::expand (0.0f);
+        }
+
+    private:
+        Lanes coefficients;
+        Lanes lastOutput;
+        Lanes state[maxNumStages];
+    };
+
+    OwnedArray<AllPassCascade> cascades;
+
+    //======================================
+
+    /** Coefficients of the all-pass stages over the centre frequencies that the sweep
+        can reach, tableSize intervals apart in frequency and read with linear
+        interpolation, so that the filters update without a tan(). Frequencies out
+        of the range read its nearest end.
+    */
+    class CoefficientTable
+    {
+    public:
+        enum { tableSize = 1024 };
+
+        /** Not for the audio thread. */
+        void prepare (const double sampleRate, const float minFrequency, const float maxFrequency)
+        {
+            firstFrequency = minFrequency;
+            frequencyToPosition = (float)tableSize / (maxFrequency - minFrequency);
+
+            for (int point = 0; point <= tableSize; ++point) {
+                const double frequency = minFrequency + (maxFrequency - minFrequency) * (double)point / (double)tableSize;
+                const double wc = jmin (2.0 * M_PI * frequency / sampleRate, M_PI * 0.99);
+                const double tan_half_wc = tan (wc / 2.0);
+
+                points[point] = (float)((tan_half_wc - 1.0) / (tan_half_wc + 1.0));
+            }
+        }
+
+        float getCoefficient (const float frequency) const noexcept
+        {
+            const float position = jlimit (0.0f, (float)tableSize, (frequency - firstFrequency) * frequencyToPosition);
+            const int index = jmin ((int)position, (int)tableSize - 1);
+            const float fraction = position - (float)index;
+
+            return points[index] + fraction * (points[index + 1] - points[index]);
+        }
+
+    private:
+        float firstFrequency = 0.0f;
+        float frequencyToPosition = 0.0f;
+        float points[tableSize + 1] = {};
+    };
+
+    CoefficientTable coefficientTable;
+
+    /** Looks up the coefficients of the first channel and of the others, which are a
+        quarter of a cycle of the LFO later in stereo, and sets them on all the stages
+        of every cascade at once.
+    */
+    void updateFilters (const float phase, const float sweepWidth, const float minFrequency, const bool stereo);
+
+    unsigned int sampleCountToUpdateFilters = 0;
+    unsigned int updateFiltersInterval = 4;
+
+    /** The number of stages changes with a crossfade over filtersFadeTime, from the
+        outputs of the cascades after previousNumFilters stages.
+    */
+    static constexpr double filtersFadeTime = 10e-3;
+
+    int numActiveFilters = 4;
+    int previousNumFilters = 4;
+    float filtersFade = 1.0f;
+    float filtersFadeStep = 1.0f;
+
+    const int lfoWaveforms[4] = {
+        WavetableLFO::waveformSine,
+        WavetableLFO::waveformTriangle,
+        WavetableLFO::waveformSquare,
+        WavetableLFO::waveformSawtooth,
+    };
+
+    WavetableLFO lfo;
+    float lfoPhase = 0.0f;
+    float inverseSampleRate = 1.0f / 44100.0f;
+
+    //======================================
+
+    /** The smoothed parameters are read maxBlockSize samples at a time. */
+    enum {
+        maxBlockSize = 64,
+    };
+
+    /** Fills ramp with the next numSamples values of a smoothed parameter, or with
+        its target when it is not smoothing.
+    */
+    static void fillNextValues (LinearSmoothedValue<float>& value, float* ramp, const int numSamples) noexcept
+    {
+        if (! value.isSmoothing()) {
+            FloatVectorOperations::fill (ramp, value.getTargetValue(), numSamples);
+            return;
+        }
+
+        for (int sample = 0; sample < numSamples; ++sample)
+            ramp[sample] = value.getNextValue();
+    }
+
+    float sweepWidths[maxBlockSize];
+    float minFrequencies[maxBlockSize];
+    float lfoFrequencies[maxBlockSize];
+    float feedbacks[maxBlockSize];
+    float depths[maxBlockSize];
+
+    LinearSmoothedValue<float> smoothedDepth { 1.0f };
+    LinearSmoothedValue<float> smoothedFeedback { 0.7f };
+    LinearSmoothedValue<float> smoothedMinFrequency { 80.0f };
+    LinearSmoothedValue<float> smoothedSweepWidth { 1000.0f };
+    LinearSmoothedValue<float> smoothedLFOfrequency { 0.05f };
+    int selectedNumFilters = 4;
+    int currentWaveform = waveformSine;
+    bool currentStereo = true;
+    int qualityReduction = 0;
+};
+
+//==============================================================================
+
+inline void PhaserDSP::prepare (const double sampleRate, const int numChannels, const double smoothTime)
+{
+    smoothedDepth.reset (sampleRate, smoothTime);
+    smoothedFeedback.reset (sampleRate, smoothTime);
+    smoothedMinFrequency.reset (sampleRate, smoothTime);
+    smoothedSweepWidth.reset (sampleRate, smoothTime);
+    smoothedLFOfrequency.reset (sampleRate, smoothTime);
+
+    cascades.clear();
+    for (int i = 0; i < numChannels; i += AllPassCascade::numLanes)
+        cascades.add (new AllPassCascade());
+
+    sampleCountToUpdateFilters = 0;
+    updateFiltersInterval = 4;
+
+    coefficientTable.prepare (sampleRate, minMinFrequency, maxMinFrequency + maxSweepWidth);
+
+    numActiveFilters = selectedNumFilters;
+    previousNumFilters = numActiveFilters;
+    filtersFade = 1.0f;
+    filtersFadeStep = (float)(1.0 / jmax (1.0, filtersFadeTime * sampleRate));
+
+    lfoPhase = 0.0f;
+    inverseSampleRate = 1.0f / (float)sampleRate;
+}
+
+inline void PhaserDSP::reset() noexcept
+{
+    for (int i = 0; i < cascades.size(); ++i)
+        cascades[i]->reset();
+
+    // The coefficients are cleared too, so they are updated on the next sample
+    sampleCountToUpdateFilters = 0;
+
+    previousNumFilters = numActiveFilters;
+    filtersFade = 1.0f;
+}
+
+inline void PhaserDSP::process (float* const* channels, const int numChannels, const int numSamples) noexcept
+{
+    // The quality governor takes two stages off for every step of reduction. The
+    // next change, once a crossfade is over, crossfades from the current stages.
+    const int numFilters = jmax (2, selectedNumFilters - 2 * qualityReduction);
+    if (numFilters != numActiveFilters && filtersFade >= 1.0f) {
+        previousNumFilters = numActiveFilters;
+        numActiveFilters = numFilters;
+        filtersFade = 0.0f;
+
+        if (numActiveFilters > previousNumFilters)
+            for (int group = 0; group < cascades.size(); ++group)
+                cascades[group]->clearStages (previousNumFilters);
+    }
+
+    lfo.setWaveform (lfoWaveforms[currentWaveform]);
+
+    for (int blockStart = 0; blockStart < numSamples; blockStart += maxBlockSize) {
+        const int blockSamples = jmin ((int)maxBlockSize, numSamples - blockStart);
+
+        fillNextValues (smoothedSweepWidth, sweepWidths, blockSamples);
+        fillNextValues (smoothedMinFrequency, minFrequencies, blockSamples);
+        fillNextValues (smoothedLFOfrequency, lfoFrequencies, blockSamples);
+        fillNextValues (smoothedFeedback, feedbacks, blockSamples);
+        fillNextValues (smoothedDepth, depths, blockSamples);
+
+        for (int blockSample = 0; blockSample < blockSamples; ++blockSample) {
+            const int sample = blockStart + blockSample;
+
+            if (sampleCountToUpdateFilters++ % updateFiltersInterval == 0)
+                updateFilters (lfoPhase, sweepWidths[blockSample], minFrequencies[blockSample], currentStereo);
+
+            lfoPhase += lfoFrequencies[blockSample] * inverseSampleRate;
+            if (lfoPhase >= 1.0f)
+                lfoPhase -= 1.0f;
+
+            const float feedback = feedbacks[blockSample];
+            const float halfDepth = depths[blockSample] * 0.5f;
+
+            const bool fadingFilters = filtersFade < 1.0f;
+            if (fadingFilters)
+                filtersFade = jmin (1.0f, filtersFade + filtersFadeStep);
+
+            for (int group = 0; group < cascades.size(); ++group) {
+                const int firstChannel = group * AllPassCascade::numLanes;
+                const int numLanes = jmin ((int)AllPassCascade::numLanes, numChannels - firstChannel);
+
+                AllPassCascade::Lanes in = AllPassCascade::Lanes::expand (0.0f);
+                for (int lane = 0; lane < numLanes; ++lane)
+                    in.set ((size_t)lane, channels[firstChannel + lane][sample]);
+
+                const AllPassCascade::Lanes filtered = fadingFilters
+                    ? cascades[group]->processSample (in, feedback, numActiveFilters, previousNumFilters, filtersFade)
+                    : cascades[group]->processSample (in, feedback, numActiveFilters);
+                const AllPassCascade::Lanes out = in + (filtered - in) * halfDepth;
+
+                for (int lane = 0; lane < numLanes; ++lane)
+                    channels[firstChannel + lane][sample] = out.get ((size_t)lane);
+            }
+        }
+    }
+}
+
+//==============================================================================
+
+inline void PhaserDSP::updateFilters (const float phase, const float sweepWidth, const float minFrequency, const bool stereo)
+{
+    TRACE_SCOPE ("updateFilters");
+
+    const float coefficient = coefficientTable.getCoefficient (lfo.getValue (phase) * sweepWidth + minFrequency);
+
+    float otherCoefficient = coefficient;
+    if (stereo) {
+        const float otherPhase = (phase + 0.25f >= 1.0f) ? phase - 0.75f : phase + 0.25f;
+        otherCoefficient = coefficientTable.getCoefficient (lfo.getValue (otherPhase) * sweepWidth + minFrequency);
+    }
+
+    const AllPassCascade::Lanes coefficients = AllPassCascade::Lanes::expand (otherCoefficient);
+    for (int group = 0; group < cascades.size(); ++group)
+        cascades[group]->setCoefficients (coefficients);
+
+    if (cascades.size() > 0) {
+        AllPassCascade::Lanes firstCoefficients = coefficients;
+        firstCoefficients.set (0, coefficient);
+        cascades[0]->setCoefficients (firstCoefficients);
+    }
+}
+
+//==============================================================================
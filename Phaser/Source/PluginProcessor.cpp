@@ -45,11 +45,12 @@ PhaserAudioProcessor::PhaserAudioProcessor():
     , paramFeedback (parameters, "Feedback", "", 0.0f, 0.9f, 0.7f)
     , paramNumFilters (parameters, "Number of filters", {"2", "4", "6", "8", "10"}, 1,
                        [this](float value){ return paramNumFilters.items[(int)value].getFloatValue(); })
-    , paramMinFrequency (parameters, "Min. Frequency", "Hz", 50.0f, 1000.0f, 80.0f)
-    , paramSweepWidth (parameters, "Sweep width", "Hz", 50.0f, 3000.0f, 1000.0f)
+    , paramMinFrequency (parameters, "Min. Frequency", "Hz", PhaserDSP::minMinFrequency, PhaserDSP::maxMinFrequency, 80.0f)
+    , paramSweepWidth (parameters, "Sweep width", "Hz", PhaserDSP::minSweepWidth, PhaserDSP::maxSweepWidth, 1000.0f)
     , paramLFOfrequency (parameters, "LFO Frequency", "Hz", 0.0f, 2.0f, 0.05f)
     , paramLFOwaveform (parameters, "LFO Waveform", waveformItemsUI, waveformSine)
     , paramStereo (parameters, "Stereo", true)
+    , bypass (*this, parameters)
 {
     parameters.apvts.state = ValueTree (Identifier (getName().removeCharacters ("- ")));
 }
@@ -62,6 +63,8 @@ PhaserAudioProcessor::~PhaserAudioProcessor()
 
 void PhaserAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
+    TRACE_INSTANCE_SCOPE ("prepareToPlay", this);
+
     const double smoothTime = 1e-3;
     paramDepth.reset (sampleRate, smoothTime);
     paramFeedback.reset (sampleRate, smoothTime);
@@ -74,132 +77,67 @@ void PhaserAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock
 
     //======================================
 
-    numFiltersPerChannel = paramNumFilters.callback (paramNumFilters.items.size() - 1);
-
-    filters.clear();
-    for (int i = 0; i < getTotalNumInputChannels() * numFiltersPerChannel; ++i) {
-        Filter* filter;
-        filters.add (filter = new Filter());
-    }
+    jassert (paramNumFilters.callback (paramNumFilters.items.size() - 1) <= PhaserDSP::maxNumFilters);
 
-    filteredOutputs.clear();
-    for (int i = 0; i < getTotalNumInputChannels(); ++i)
-        filteredOutputs.add (0.0f);
+    updateDSPParameters();
+    phaser.prepare (sampleRate, getTotalNumInputChannels(), smoothTime);
 
-    sampleCountToUpdateFilters = 0;
-    updateFiltersInterval = 32;
-
-    lfoPhase = 0.0f;
-    inverseSampleRate = 1.0f / (float)sampleRate;
-    twoPi = 2.0f * M_PI;
+    profiler.prepare (sampleRate);
+    silenceDetector.prepare (sampleRate);
+    bypass.prepare (sampleRate, samplesPerBlock, 0);
 }
 
 void PhaserAudioProcessor::releaseResources()
 {
 }
 
+void PhaserAudioProcessor::reset()
+{
+    phaser.reset();
+}
+
 void PhaserAudioProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
 {
+    const ProcessBlockProfiler::ScopedMeasurement measurement (profiler, buffer.getNumSamples(), isNonRealtime());
+    TRACE_INSTANCE_SCOPE ("processBlock", this);
     ScopedNoDenormals noDenormals;
 
+    parameters.applySnapshotMorph();
+
     const int numInputChannels = getTotalNumInputChannels();
     const int numOutputChannels = getTotalNumOutputChannels();
     const int numSamples = buffer.getNumSamples();
 
     //======================================
 
-    float phase;
-    float phaseMain;
-    unsigned int sampleCount;
-
-    for (int channel = 0; channel < numInputChannels; ++channel) {
-        float* channelData = buffer.getWritePointer (channel);
-        sampleCount = sampleCountToUpdateFilters;
-        phase = lfoPhase;
-        if ((bool)paramStereo.getTargetValue() && channel != 0)
-            phase = fmodf (phase + 0.25f, 1.0f);
+    if (silenceDetector.skipBlock (*this, buffer))
+        return;
 
-        for (int sample = 0; sample < numSamples; ++sample) {
-            float in = channelData[sample];
+    if (bypass.begin (buffer))
+        return;
 
-            float centreFrequency = lfo (phase, (int)paramLFOwaveform.getTargetValue());
-            centreFrequency *= paramSweepWidth.getNextValue();
-            centreFrequency += paramMinFrequency.getNextValue();
-
-            phase += paramLFOfrequency.getNextValue() * inverseSampleRate;
-            if (phase >= 1.0f)
-                phase -= 1.0f;
-
-            if (sampleCount++ % updateFiltersInterval == 0)
-                updateFilters (centreFrequency);
-
-            float filtered = in + paramFeedback.getNextValue() * filteredOutputs[channel];
-            for (int i = 0; i < paramNumFilters.getTargetValue(); ++i)
-                filtered = filters[channel * paramNumFilters.getTargetValue() + i]->processSingleSampleRaw (filtered);
-
-            filteredOutputs.set (channel, filtered);
-            float out = in + paramDepth.getNextValue() * (filtered - in) * 0.5f;
-            channelData[sample] = out;
-        }
-
-        if (channel == 0)
-            phaseMain = phase;
-    }
-
-    sampleCountToUpdateFilters = sampleCount;
-    lfoPhase = phaseMain;
+    phaser.setQualityReduction (profiler.getQualityReduction());
+    updateDSPParameters();
+    phaser.process (buffer.getArrayOfWritePointers(), numInputChannels, numSamples);
 
     for (int channel = numInputChannels; channel < numOutputChannels; ++channel)
         buffer.clear (channel, 0, numSamples);
-}
-
-//==============================================================================
-
-void PhaserAudioProcessor::updateFilters (double centreFrequency)
-{
-    double discreteFrequency = twoPi * centreFrequency * inverseSampleRate;
 
-    for (int i = 0; i < filters.size(); ++i)
-        filters[i]->updateCoefficients (discreteFrequency);
+    bypass.end (buffer);
 }
 
 //==============================================================================
 
-float PhaserAudioProcessor::lfo (float phase, int waveform)
+void PhaserAudioProcessor::updateDSPParameters() noexcept
 {
-    float out = 0.0f;
-
-    switch (waveform) {
-        case waveformSine: {
-            out = 0.5f + 0.5f * sinf (twoPi * phase);
-            break;
-        }
-        case waveformTriangle: {
-            if (phase < 0.25f)
-                out = 0.5f + 2.0f * phase;
-            else if (phase < 0.75f)
-                out = 1.0f - 2.0f * (phase - 0.25f);
-            else
-                out = 2.0f * (phase - 0.75f);
-            break;
-        }
-        case waveformSquare: {
-            if (phase < 0.5f)
-                out = 1.0f;
-            else
-                out = 0.0f;
-            break;
-        }
-        case waveformSawtooth: {
-            if (phase < 0.5f)
-                out = 0.5f + phase;
-            else
-                out = phase - 0.5f;
-            break;
-        }
-    }
-
-    return out;
+    phaser.setParameter (PhaserDSP::parameterDepth, paramDepth.getTargetValue());
+    phaser.setParameter (PhaserDSP::parameterFeedback, paramFeedback.getTargetValue());
+    phaser.setParameter (PhaserDSP::parameterNumFilters, paramNumFilters.getTargetValue());
+    phaser.setParameter (PhaserDSP::parameterMinFrequency, paramMinFrequency.getTargetValue());
+    phaser.setParameter (PhaserDSP::parameterSweepWidth, paramSweepWidth.getTargetValue());
+    phaser.setParameter (PhaserDSP::parameterLFOfrequency, paramLFOfrequency.getTargetValue());
+    phaser.setParameter (PhaserDSP::parameterLFOwaveform, paramLFOwaveform.getTargetValue());
+    phaser.setParameter (PhaserDSP::parameterStereo, paramStereo.getTargetValue());
 }
 
 //==============================================================================
@@ -213,13 +151,17 @@ float PhaserAudioProcessor::lfo (float phase, int waveform)
 
 void PhaserAudioProcessor::getStateInformation (MemoryBlock& destData)
 {
-    auto state = parameters.apvts.copyState();
-    std::unique_ptr<XmlElement> xml (state.createXml());
-    copyXmlToBinary (*xml, destData);
+    MemoryOutputStream stream (destData, false);
+    parameters.writeState (stream);
 }
 
 void PhaserAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
+    MemoryInputStream stream (data, (size_t)sizeInBytes, false);
+    if (parameters.readState (stream))
+        return;
+
+    // Sessions saved in the XML format of older versions
     std::unique_ptr<XmlElement> xmlState (getXmlFromBinary (data, sizeInBytes));
 
     if (xmlState.get() != nullptr)
@@ -248,10 +190,9 @@ bool PhaserAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) c
     ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    if (layouts.getMainOutputChannelSet() != AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != AudioChannelSet::stereo())
+    // The channels are processed independently, so any layout with at least one
+    // channel is supported, from mono to surround sets or ambisonic stems.
+    if (layouts.getMainOutputChannelSet().isDisabled())
         return false;
 
     // This checks if the input layout matches the output layout
@@ -301,7 +242,18 @@ bool PhaserAudioProcessor::isMidiEffect() const
 
 double PhaserAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // The all-pass filters ring longest at the lowest frequency of the sweep, where
+    // each of them delays by 1 / (pi * frequency) and decays with 1 / (2 pi * frequency)
+    const double minFrequency = jmax (1.0, (double)paramMinFrequency.getTargetValue());
+    const double loopSeconds = (double)paramNumFilters.getTargetValue() / (M_PI * minFrequency);
+
+    return SilenceDetector::getFeedbackTailSeconds (paramFeedback.getTargetValue(), loopSeconds)
+         + SilenceDetector::getDecayTailSeconds (1.0 / (2.0 * M_PI * minFrequency));
+}
+
+AudioProcessorParameter* PhaserAudioProcessor::getBypassParameter() const
+{
+    return bypass.getParameter();
 }
 
 //==============================================================================
@@ -332,6 +284,21 @@ void PhaserAudioProcessor::changeProgramName (int index, const String& newName)
 
 //==============================================================================
 
+MemoryFootprint PhaserAudioProcessor::getMemoryFootprint() const
+{
+    const ScopedLock lock (parameters.deferredCallbackLock);
+
+    MemoryFootprint footprint;
+    footprint.add (MemoryFootprint::other, sizeof (*this));
+    bypass.addMemoryFootprint (footprint);
+
+    phaser.addMemoryFootprint (footprint);
+
+    return footprint;
+}
+
+//==============================================================================
+
 // This creates new instances of the plugin..
 AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
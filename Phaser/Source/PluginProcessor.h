@@ -30,10 +30,15 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "PluginParameter.h"
+#include "ProcessBlockProfiler.h"
+#include "SilenceDetector.h"
+#include "PluginBypass.h"
+#include "MemoryFootprint.h"
+#include "PhaserDSP.h"
 
 //==============================================================================
 
-class PhaserAudioProcessor : public AudioProcessor
+class PhaserAudioProcessor : public AudioProcessor, public MemoryFootprintSource
 {
 public:
     //==============================================================================
@@ -45,6 +50,7 @@ public:
 
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
+    void reset() override;
     void processBlock (AudioSampleBuffer&, MidiBuffer&) override;
 
     //==============================================================================
@@ -78,6 +84,7 @@ public:
     bool producesMidi() const override;
     bool isMidiEffect () const override;
     double getTailLengthSeconds() const override;
+    AudioProcessorParameter* getBypassParameter() const override;
 
     //==============================================================================
 
@@ -89,10 +96,7 @@ public:
 
     //==============================================================================
 
-
-
-
-
+    MemoryFootprint getMemoryFootprint() const override;
 
     //==============================================================================
 
@@ -104,47 +108,23 @@ public:
     };
 
     enum waveformIndex {
-        waveformSine = 0,
-        waveformTriangle,
-        waveformSquare,
-        waveformSawtooth,
+        waveformSine = PhaserDSP::waveformSine,
+        waveformTriangle = PhaserDSP::waveformTriangle,
+        waveformSquare = PhaserDSP::waveformSquare,
+        waveformSawtooth = PhaserDSP::waveformSawtooth,
     };
 
     //======================================
 
-    class Filter : public IIRFilter
-    {
-    public:
-        void updateCoefficients (const double discreteFrequency) noexcept
-        {
-            jassert (discreteFrequency > 0);
-
-            double wc = jmin (discreteFrequency, M_PI * 0.99);
-            double tan_half_wc = tan (wc / 2.0);
-
-            coefficients = IIRCoefficients (/* b0 */ tan_half_wc - 1.0,
-                                            /* b1 */ tan_half_wc + 1.0,
-                                            /* b2 */ 0.0,
-                                            /* a0 */ tan_half_wc + 1.0,
-                                            /* a1 */ tan_half_wc - 1.0,
-                                            /* a2 */ 0.0);
-
-            setCoefficients (coefficients);
-        }
-    };
+    /** Hands the values of the parameters to the core, once a block. */
+    void updateDSPParameters() noexcept;
 
-    OwnedArray<Filter> filters;
-    Array<float> filteredOutputs;
-    void updateFilters (double centreFrequency);
-    int numFiltersPerChannel;
-    unsigned int sampleCountToUpdateFilters;
-    unsigned int updateFiltersInterval;
+    PhaserDSP phaser;
 
-    float lfoPhase;
-    float inverseSampleRate;
-    float twoPi;
+    //======================================
 
-    float lfo (float phase, int waveform);
+    ProcessBlockProfiler profiler;
+    SilenceDetector silenceDetector;
 
     //======================================
 
@@ -159,6 +139,8 @@ public:
     PluginParameterComboBox paramLFOwaveform;
     PluginParameterToggle paramStereo;
 
+    PluginBypass bypass;
+
 private:
     //==============================================================================
 
@@ -0,0 +1,154 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "DelayMemoryArena.h"
+#include <atomic>
+#include <cstring>
+
+//==============================================================================
+
+/** Moves the history of a delay buffer into a larger or smaller one while the audio
+    thread keeps writing the old one, so that changing the maximum delay keeps the
+    echoes and does not hold the audio thread up.
+
+    Both buffers are rings of a power of two frames, of frameSize samples in each
+    of their channels. The audio thread counts the frames it writes with advance(),
+    so the frame at some position of that count sits at position & (frames - 1) in
+    either ring. copy() runs on the thread that allocated the new buffer: it copies
+    the history, then what the audio thread wrote meanwhile, again and again until
+    that is short. finish() copies the rest and returns the write position in the
+    new buffer. It belongs under the lock that keeps the audio thread out during
+    the swap, which then only waits for a few blocks worth of samples.
+*/
+class DelayHistoryTransfer
+{
+public:
+    /** Called by the audio thread after every block with the frames it wrote. */
+    void advance (const int numFrames) noexcept
+    {
+        position.store (position.load (std::memory_order_relaxed) + numFrames, std::memory_order_release);
+    }
+
+    /** For a buffer that starts again from position 0, while the audio thread is
+        kept out.
+    */
+    void reset() noexcept
+    {
+        position.store (0, std::memory_order_relaxed);
+    }
+
+    template <typename SampleType>
+    void copy (const DelayBuffer<SampleType>& source, const int sourceFrames,
+               DelayBuffer<SampleType>& destination, const int destinationFrames, const int frameSize) noexcept
+    {
+        const int64 end = position.load (std::memory_order_acquire);
+        copiedBegin = jmax ((int64)0, end - (int64)jmin (sourceFrames, destinationFrames));
+        copiedEnd = copiedBegin;
+
+        for (int pass = 0; pass < maxPasses; ++pass) {
+            const int64 written = position.load (std::memory_order_acquire);
+            if (pass > 0 && written - copiedEnd <= maxFinishFrames)
+                break;
+
+            copyFrames (source, sourceFrames, destination, destinationFrames, frameSize, copiedEnd, written);
+            copiedEnd = written;
+        }
+    }
+
+    template <typename SampleType>
+    int finish (const DelayBuffer<SampleType>& source, const int sourceFrames,
+                DelayBuffer<SampleType>& destination, const int destinationFrames, const int frameSize) noexcept
+    {
+        const int64 written = position.load (std::memory_order_acquire);
+        copyFrames (source, sourceFrames, destination, destinationFrames, frameSize, copiedEnd, written);
+
+        // A frame the audio thread wrote over in the source before it was copied
+        // is older than the source held, so it is silence rather than a newer frame
+        // in the wrong place. The frames kept by a smaller destination never are.
+        const int64 clearBegin = jmax (copiedBegin, written - (int64)destinationFrames);
+        const int64 clearEnd = written - (int64)sourceFrames;
+        if (clearEnd > clearBegin)
+            clearFrames (destination, destinationFrames, frameSize, clearBegin, clearEnd);
+
+        return (int)(written & (int64)(destinationFrames - 1));
+    }
+
+private:
+    //==============================================================================
+
+    template <typename SampleType>
+    static void copyFrames (const DelayBuffer<SampleType>& source, const int sourceFrames,
+                            DelayBuffer<SampleType>& destination, const int destinationFrames, const int frameSize,
+                            int64 begin, const int64 end) noexcept
+    {
+        const int numChannels = jmin (source.getNumChannels(), destination.getNumChannels());
+
+        while (begin < end) {
+            const int sourcePosition = (int)(begin & (int64)(sourceFrames - 1));
+            const int destinationPosition = (int)(begin & (int64)(destinationFrames - 1));
+            const int numFrames = (int)jmin (end - begin, (int64)(sourceFrames - sourcePosition),
+                                             (int64)(destinationFrames - destinationPosition));
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                std::memcpy (destination.getWritePointer (channel) + (size_t)destinationPosition * (size_t)frameSize,
+                             source.getReadPointer (channel) + (size_t)sourcePosition * (size_t)frameSize,
+                             sizeof (SampleType) * (size_t)numFrames * (size_t)frameSize);
+
+            begin += numFrames;
+        }
+    }
+
+    template <typename SampleType>
+    static void clearFrames (DelayBuffer<SampleType>& destination, const int destinationFrames, const int frameSize,
+                             int64 begin, const int64 end) noexcept
+    {
+        while (begin < end) {
+            const int destinationPosition = (int)(begin & (int64)(destinationFrames - 1));
+            const int numFrames = (int)jmin (end - begin, (int64)(destinationFrames - destinationPosition));
+
+            for (int channel = 0; channel < destination.getNumChannels(); ++channel)
+                std::memset (destination.getWritePointer (channel) + (size_t)destinationPosition * (size_t)frameSize,
+                             0, sizeof (SampleType) * (size_t)numFrames * (size_t)frameSize);
+
+            begin += numFrames;
+        }
+    }
+
+    /** The frames left for finish(), and how many times copy() tries to get there
+        before leaving more of them.
+    */
+    enum {
+        maxFinishFrames = 8192,
+        maxPasses = 8,
+    };
+
+    std::atomic<int64> position { 0 };
+
+    // Only used by the thread that resizes
+    int64 copiedBegin = 0;
+    int64 copiedEnd = 0;
+};
+
+//==============================================================================
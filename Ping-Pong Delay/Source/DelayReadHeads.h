@@ -0,0 +1,108 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+
+/** Read offsets of a delay line that reads at whole samples, and crossfades from
+    one offset to the next when the delay time changes instead of jumping to it.
+
+    Once a block, setTarget() is given the delay in samples. When it differs from
+    the current offset, the current one becomes the previous offset and the line
+    reads from both over fadeTime, with the gain of the new one going from 0 to 1.
+    A change that comes while a crossfade is running waits for it to end, so the
+    line steps after automation at most once every fadeTime, and never reads more
+    than two heads. Outside of crossfades there is a single head at a whole number
+    of samples, so reading it is a plain copy.
+
+    An offset of 0 means no delay, which the effects leave as their dry input, so
+    changes from or to it jump, as there is no line to fade from or to.
+*/
+class DelayReadHeads
+{
+public:
+    static constexpr double fadeTime = 20e-3;
+
+    void prepare (const double sampleRate) noexcept
+    {
+        fadeSamples = jmax (1, roundToInt (sampleRate * fadeTime));
+        reset();
+    }
+
+    /** Takes the next target without a crossfade, for a new or cleared line. */
+    void reset() noexcept
+    {
+        offset = -1;
+        previousOffset = 0;
+        fadeSamplesLeft = 0;
+    }
+
+    void setTarget (const int targetOffset) noexcept
+    {
+        if (offset <= 0 || (targetOffset == 0 && fadeSamplesLeft == 0)) {
+            offset = targetOffset;
+        } else if (fadeSamplesLeft == 0 && targetOffset != offset) {
+            previousOffset = offset;
+            offset = targetOffset;
+            fadeSamplesLeft = fadeSamples;
+        }
+    }
+
+    /** Moves the crossfade on by one block, after all the channels have read it. */
+    void advance (const int numSamples) noexcept
+    {
+        fadeSamplesLeft = jmax (0, fadeSamplesLeft - numSamples);
+    }
+
+    int getOffset() const noexcept { return offset; }
+    int getPreviousOffset() const noexcept { return previousOffset; }
+
+    /** Samples of the crossfade left from sample of the current block, 0 once it is over. */
+    int getFadeSamplesLeft (const int sample) const noexcept
+    {
+        return jmax (0, fadeSamplesLeft - sample);
+    }
+
+    /** Gain of the current offset at sample of the current block, and its step per sample. */
+    template <typename SampleType>
+    SampleType getFadeGain (const int sample) const noexcept
+    {
+        return (SampleType)1 - (SampleType)getFadeSamplesLeft (sample) / (SampleType)fadeSamples;
+    }
+
+    template <typename SampleType>
+    SampleType getFadeStep() const noexcept
+    {
+        return (SampleType)1 / (SampleType)fadeSamples;
+    }
+
+private:
+    int fadeSamples = 1;
+    int offset = -1;
+    int previousOffset = 0;
+    int fadeSamplesLeft = 0;
+};
+
+//==============================================================================
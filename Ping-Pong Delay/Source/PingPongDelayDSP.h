@@ -0,0 +1,530 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "MemoryFootprint.h"
+#include "DelayMemoryArena.h"
+#include "DelayHistoryTransfer.h"
+#include "DelayReadHeads.h"
+#include "TempoSync.h"
+
+//==============================================================================
+
+/** The audio processing of the Ping-Pong Delay, without the parameters, state,
+    editor or buses of the plugin, for hosts that only need the audio and run many
+    instances. PingPongDelayAudioProcessor wraps one and hands it the values of its
+    parameters once a block, in their natural units: the balance of the input, the
+    feedback and the mix from 0 to 1, the delay time and the maximum delay time in
+    seconds, the indices of the delay time changes and of the note division, and
+    the tempo sync as 0 or 1. The tempo of the host comes through setHostTempo().
+
+    The maximum delay time reallocates the buffer, so setParameter() is not
+    real-time safe for it. It is meant for another thread than process(), which
+    only waits for the swap of the new buffer. The configuration is kept under a
+    lock of its own, so that several threads can change it.
+*/
+class PingPongDelayDSP
+{
+public:
+    enum parameterIndex {
+        parameterBalance = 0,
+        parameterDelayTime,
+        parameterFeedback,
+        parameterMix,
+        parameterMaxDelayTime,
+        parameterDelayTimeChanges,
+        parameterTempoSync,
+        parameterNoteDivision,
+        numParameters,
+    };
+
+    enum delayTimeChangesIndex {
+        delayTimeChangesJump = 0,
+        delayTimeChangesCrossfade,
+    };
+
+    /** The longest delay that the buffer holds, and the highest feedback. */
+    static constexpr float maxDelayTimeLimit = 5.0f;
+    static constexpr float maxFeedback = 0.9f;
+
+    /** Allocates the buffer for processing in double precision or not. Preparing
+        again with the same settings neither allocates nor frees. Not real-time safe.
+    */
+    void prepare (const double newSampleRate, const bool newDoublePrecision);
+
+    /** The buffer may be swapped by then, so the next block clears it, under
+        delayBufferLock. Real-time safe.
+    */
+    void reset() noexcept
+    {
+        clearPending = true;
+    }
+
+    /** Real-time safe, except for the maximum delay time, which reallocates the
+        buffer.
+    */
+    void setParameter (const int index, const float value)
+    {
+        switch (index) {
+            case parameterBalance:          currentBalance = value; return;
+            case parameterDelayTime:        currentDelayTime = value; return;
+            case parameterFeedback:         currentFeedback = value; return;
+            case parameterMix:              currentMix = value; return;
+            case parameterDelayTimeChanges: currentDelayTimeChanges = jlimit ((int)delayTimeChangesJump,
+                                                                       (int)delayTimeChangesCrossfade, (int)value); return;
+            case parameterTempoSync:        currentSyncToTempo = (value != 0.0f); return;
+            case parameterNoteDivision:     currentNoteDivision = jlimit (0, TempoSync::numNoteDivisions - 1, (int)value); return;
+
+            case parameterMaxDelayTime: {
+                const ScopedLock lock (configurationLock);
+                maxDelayTime = value;
+                updateDelayBuffer();
+                return;
+            }
+        }
+    }
+
+    /** The tempo of the host in BPM, for the tempo sync, from the thread of
+        process(). Tempos of 0 or less, from hosts that do not report one, keep the
+        last tempo, 120 BPM at first.
+    */
+    void setHostTempo (const double bpm) noexcept
+    {
+        hostBpm = bpm;
+    }
+
+    /** Processes numSamples samples of the two channels in place. With double
+        precision the delay buffer holds doubles, so the cross-feedback loop does not
+        round to float.
+    */
+    template <typename SampleType>
+    void process (SampleType* const* channels, const int numChannels, const int numSamples) noexcept;
+
+    /** The delay in seconds that the current settings use, up to the maximum delay
+        time.
+    */
+    float getDelayTime() const noexcept
+    {
+        const float delayTime = currentSyncToTempo ? (float)tempoSync.getDelaySeconds() : currentDelayTime;
+        return jmin (delayTime, maxDelayTime);
+    }
+
+    void addMemoryFootprint (MemoryFootprint& footprint) const
+    {
+        const ScopedLock lock (configurationLock);
+
+        footprint.add (MemoryFootprint::delayLines, delayBuffer);
+        footprint.add (MemoryFootprint::delayLines, doubleDelayBuffer);
+    }
+
+private:
+    //==============================================================================
+
+    /** Processes a stretch of samples over which neither the write position nor
+        the two read positions wrap around the delay buffer, and that does not
+        read any of the frames it writes. The delay data is interleaved, so every
+        frame holds the left and right samples side by side.
+    */
+    template <typename SampleType>
+    static void processSegment (SampleType* channelDataL,
+                                SampleType* channelDataR,
+                                SampleType* writeData,
+                                const SampleType* readData1,
+                                const SampleType* readData2,
+                                const int numSamples,
+                                const SampleType balance,
+                                const SampleType fraction,
+                                const SampleType feedback,
+                                const SampleType mix) noexcept;
+
+    /** Same as processSegment(), with a delay of whole samples that the buffer reads
+        from two heads, the gain of the second one going up by gainStep per sample.
+        Without a crossfade, readDataPrevious is null and readData is mixed as it is.
+    */
+    template <typename SampleType>
+    static void processCrossfadeSegment (SampleType* channelDataL,
+                                         SampleType* channelDataR,
+                                         SampleType* writeData,
+                                         const SampleType* readDataPrevious,
+                                         const SampleType* readData,
+                                         const int numSamples,
+                                         const SampleType balance,
+                                         SampleType gain,
+                                         const SampleType gainStep,
+                                         const SampleType feedback,
+                                         const SampleType mix) noexcept;
+
+    /** Mixes a stretch of delayed frames into the output and writes the frames of
+        the cross-feedback loop.
+    */
+    template <typename SampleType>
+    static void mixSegment (SampleType* channelDataL,
+                            SampleType* channelDataR,
+                            SampleType* writeData,
+                            const SampleType* delayedFrames,
+                            const int numSamples,
+                            const SampleType balance,
+                            const SampleType feedback,
+                            const SampleType mix) noexcept;
+
+    enum {
+        numDelayChannels = 2,
+        maxSegmentSamples = 256
+    };
+
+    DelayReadHeads readHeads;
+    TempoSync tempoSync;
+
+    float currentBalance = 0.25f;
+    float currentDelayTime = 0.1f;
+    float currentFeedback = 0.7f;
+    float currentMix = 1.0f;
+    int currentDelayTimeChanges = delayTimeChangesJump;
+    bool currentSyncToTempo = false;
+    int currentNoteDivision = TempoSync::noteDivisionQuarter;
+    double hostBpm = 0.0;
+
+    //======================================
+
+    /** Allocates the delay buffer and swaps it in under delayBufferLock. It only
+        holds delays up to maxDelayTime, when that is below maxDelayTimeLimit, so
+        sessions with many instances can keep their buffers to what they use.
+        Longer delays are clamped to it. Called under configurationLock.
+
+        The history is copied into the new buffer before the swap, as much of it
+        as fits, so changing maxDelayTime while playing keeps the echoes going.
+    */
+    void updateDelayBuffer();
+
+    /** Only the buffer of the current processing precision is allocated, as one
+        channel of interleaved frames.
+    */
+    template <typename SampleType>
+    DelayBuffer<SampleType>& getDelayBuffer() noexcept;
+
+    /** The configuration of the buffer, only changed under configurationLock. */
+    CriticalSection configurationLock;
+    double sampleRate = 0.0;
+    bool doublePrecision = false;
+    float maxDelayTime = maxDelayTimeLimit;
+
+    SpinLock delayBufferLock;
+    std::atomic<bool> clearPending { false };
+
+    DelayBuffer<float> delayBuffer;
+    DelayBuffer<double> doubleDelayBuffer;
+    int delayBufferSamples = 0;
+    int delayBufferMask = -1;
+    int delayWritePosition = 0;
+
+    // Counts the frames written, for updateDelayBuffer()
+    DelayHistoryTransfer historyTransfer;
+    double delayBufferSampleRate = 0.0;
+};
+
+//==============================================================================
+
+inline void PingPongDelayDSP::prepare (const double newSampleRate, const bool newDoublePrecision)
+{
+    const ScopedLock lock (configurationLock);
+    sampleRate = newSampleRate;
+    doublePrecision = newDoublePrecision;
+
+    {
+        const SpinLock::ScopedLockType bufferLock (delayBufferLock);
+
+        // The audio thread is stopped, so the buffer in use is resized in place: it
+        // only allocates if the history grows or the precision changed
+        const float bufferMaxDelayTime = jmin (maxDelayTimeLimit, maxDelayTime);
+        delayBufferSamples = nextPowerOfTwo ((int)(bufferMaxDelayTime * (float)sampleRate) + 2);
+        delayBufferMask = delayBufferSamples - 1;
+
+        if (doublePrecision) {
+            doubleDelayBuffer.setSize (1, numDelayChannels * delayBufferSamples);
+            delayBuffer.free();
+        } else {
+            delayBuffer.setSize (1, numDelayChannels * delayBufferSamples);
+            doubleDelayBuffer.free();
+        }
+
+        delayWritePosition = 0;
+        delayBufferSampleRate = sampleRate;
+        historyTransfer.reset();
+        readHeads.reset();
+    }
+
+    readHeads.prepare (sampleRate);
+    tempoSync.prepare (sampleRate);
+}
+
+template <>
+inline DelayBuffer<float>& PingPongDelayDSP::getDelayBuffer<float>() noexcept
+{
+    return delayBuffer;
+}
+
+template <>
+inline DelayBuffer<double>& PingPongDelayDSP::getDelayBuffer<double>() noexcept
+{
+    return doubleDelayBuffer;
+}
+
+template <typename SampleType>
+void PingPongDelayDSP::process (SampleType* const* channels, const int numChannels, const int numSamples) noexcept
+{
+    ignoreUnused (numChannels);
+
+    const SpinLock::ScopedLockType lock (delayBufferLock);
+    DelayBuffer<SampleType>& typedDelayBuffer = getDelayBuffer<SampleType>();
+    if (clearPending.exchange (false)) {
+        typedDelayBuffer.clear();
+        readHeads.reset();
+    }
+
+    SampleType* delayData = (typedDelayBuffer.getNumChannels() > 0) ? typedDelayBuffer.getWritePointer (0) : nullptr;
+
+    const bool syncToTempo = currentSyncToTempo;
+    if (syncToTempo)
+        tempoSync.update (hostBpm, currentNoteDivision);
+
+    const SampleType typedBalance = (SampleType)currentBalance;
+    const SampleType delaySamples = syncToTempo ? (SampleType)tempoSync.getDelaySamples()
+                                                : (SampleType)currentDelayTime * (SampleType)sampleRate;
+    const SampleType typedFeedback = (SampleType)currentFeedback;
+    const SampleType typedMix = (SampleType)currentMix;
+
+    // With crossfades, the heads read at whole samples and take the new delay
+    // time over DelayReadHeads::fadeTime. Otherwise they are left to start again
+    // from the next delay time. The tempo changes the delay time without any
+    // automation, so it always takes the crossfade.
+    const bool crossfadeDelayTime = syncToTempo
+        || currentDelayTimeChanges == delayTimeChangesCrossfade;
+    if (crossfadeDelayTime)
+        readHeads.setTarget (jlimit (0, delayBufferMask, roundToInt (delaySamples)));
+    else
+        readHeads.reset();
+
+    // The delay time is constant over the block, so the read position trails
+    // the write position by a fixed offset and only the wrap-arounds of the
+    // buffer have to be found, once per segment instead of once per sample.
+    const int readOffset = crossfadeDelayTime ? readHeads.getOffset()
+                                              : jlimit (0, delayBufferMask, (int)std::ceil (delaySamples));
+    const SampleType fraction = crossfadeDelayTime ? (SampleType)0 : (SampleType)readOffset - delaySamples;
+
+    SampleType* channelDataL = channels[0];
+    SampleType* channelDataR = channels[1];
+
+    // Each segment reads all of its delayed frames before writing any of them,
+    // from both heads while they crossfade
+    const int maxSamples = jlimit (1, (int)maxSegmentSamples, readOffset - 1);
+    const int maxFadeSamples = jlimit (1, maxSamples, readHeads.getPreviousOffset() - 1);
+
+    int localWritePosition = delayWritePosition;
+
+    for (int sample = 0; sample < numSamples && readOffset > 0 && delayData != nullptr;) {
+        const int readPosition1 = (localWritePosition - readOffset) & delayBufferMask;
+        const int readPosition2 = (readPosition1 + 1) & delayBufferMask;
+        int segmentSamples = jmin (jmin (numSamples - sample, maxSamples),
+                                   delayBufferSamples - localWritePosition,
+                                   delayBufferSamples - readPosition1);
+
+        if (crossfadeDelayTime) {
+            const int fadeSamples = readHeads.getFadeSamplesLeft (sample);
+            const SampleType* readDataPrevious = nullptr;
+
+            // The segment ends with the crossfade, so the rest of the block reads
+            // a single head
+            if (fadeSamples > 0) {
+                const int previousReadPosition = (localWritePosition - readHeads.getPreviousOffset()) & delayBufferMask;
+                segmentSamples = jmin (segmentSamples, fadeSamples, maxFadeSamples,
+                                       delayBufferSamples - previousReadPosition);
+                readDataPrevious = delayData + numDelayChannels * previousReadPosition;
+            }
+
+            processCrossfadeSegment (channelDataL + sample,
+                                     channelDataR + sample,
+                                     delayData + numDelayChannels * localWritePosition,
+                                     readDataPrevious,
+                                     delayData + numDelayChannels * readPosition1,
+                                     segmentSamples, typedBalance,
+                                     readHeads.getFadeGain<SampleType> (sample), readHeads.getFadeStep<SampleType>(),
+                                     typedFeedback, typedMix);
+        } else {
+            segmentSamples = jmin (segmentSamples, delayBufferSamples - readPosition2);
+
+            processSegment (channelDataL + sample,
+                            channelDataR + sample,
+                            delayData + numDelayChannels * localWritePosition,
+                            delayData + numDelayChannels * readPosition1,
+                            delayData + numDelayChannels * readPosition2,
+                            segmentSamples, typedBalance, fraction, typedFeedback, typedMix);
+        }
+
+        sample += segmentSamples;
+        localWritePosition = (localWritePosition + segmentSamples) & delayBufferMask;
+    }
+
+    readHeads.advance (numSamples);
+    delayWritePosition = (delayWritePosition + numSamples) & delayBufferMask;
+    historyTransfer.advance (numSamples);
+}
+
+template <typename SampleType>
+void PingPongDelayDSP::processSegment (SampleType* channelDataL,
+                                       SampleType* channelDataR,
+                                       SampleType* writeData,
+                                       const SampleType* readData1,
+                                       const SampleType* readData2,
+                                       const int numSamples,
+                                       const SampleType balance,
+                                       const SampleType fraction,
+                                       const SampleType feedback,
+                                       const SampleType mix) noexcept
+{
+    SampleType delayedFrames[numDelayChannels * maxSegmentSamples];
+
+    // Both channels interpolate with the same fraction, so the taps are read
+    // as one contiguous run of interleaved samples
+    for (int i = 0; i < numDelayChannels * numSamples; ++i)
+        delayedFrames[i] = readData1[i] + fraction * (readData2[i] - readData1[i]);
+
+    mixSegment (channelDataL, channelDataR, writeData, delayedFrames, numSamples, balance, feedback, mix);
+}
+
+template <typename SampleType>
+void PingPongDelayDSP::processCrossfadeSegment (SampleType* channelDataL,
+                                                SampleType* channelDataR,
+                                                SampleType* writeData,
+                                                const SampleType* readDataPrevious,
+                                                const SampleType* readData,
+                                                const int numSamples,
+                                                const SampleType balance,
+                                                SampleType gain,
+                                                const SampleType gainStep,
+                                                const SampleType feedback,
+                                                const SampleType mix) noexcept
+{
+    // A single head is not interpolated, so its frames are mixed straight from
+    // the buffer
+    if (readDataPrevious == nullptr) {
+        mixSegment (channelDataL, channelDataR, writeData, readData, numSamples, balance, feedback, mix);
+        return;
+    }
+
+    SampleType delayedFrames[numDelayChannels * maxSegmentSamples];
+
+    for (int sample = 0; sample < numSamples; ++sample) {
+        for (int channel = 0; channel < numDelayChannels; ++channel) {
+ const int i = numDelayChannels * sample + channel;
+            delayedFrames[i] = readDataPrevious[i] + gain * (readData[i] - readDataPrevious[i]);
+        }
+
+        gain += gainStep;
+    }
+
+    mixSegment (channelDataL, channelDataR, writeData, delayedFrames, numSamples, balance, feedback, mix);
+}
+
+template <typename SampleType>
+void PingPongDelayDSP::mixSegment (SampleType* channelDataL,
+                                   SampleType* channelDataR,
+                                   SampleType* writeData,
+                                   const SampleType* delayedFrames,
+                                   const int numSamples,
+                                   const SampleType balance,
+                                   const SampleType feedback,
+                                   const SampleType mix) noexcept
+{
+    for (int sample = 0; sample < numSamples; ++sample) {
+        const int frame = numDelayChannels * sample;
+
+        const SampleType inL = ((SampleType)1 - balance) * channelDataL[sample];
+        const SampleType inR = balance * channelDataR[sample];
+        const SampleType outL = delayedFrames[frame + 0];
+        const SampleType outR = delayedFrames[frame + 1];
+
+        channelDataL[sample] = inL + mix * (outL - inL);
+        channelDataR[sample] = inR + mix * (outR - inR);
+        writeData[frame + 0] = inL + outR * feedback;
+        writeData[frame + 1] = inR + outL * feedback;
+    }
+}
+
+inline void PingPongDelayDSP::updateDelayBuffer()
+{
+    // Called from setParameter() before prepare() too
+    if (sampleRate <= 0.0)
+        return;
+
+    const float bufferMaxDelayTime = jmin (maxDelayTimeLimit, maxDelayTime);
+    const int newDelayBufferSamples = nextPowerOfTwo ((int)(bufferMaxDelayTime * (float)sampleRate) + 2);
+
+    DelayBuffer<float> newDelayBuffer;
+    DelayBuffer<double> newDoubleDelayBuffer;
+
+    if (doublePrecision)
+        newDoubleDelayBuffer.setSize (1, numDelayChannels * newDelayBufferSamples);
+    else
+        newDelayBuffer.setSize (1, numDelayChannels * newDelayBufferSamples);
+
+    // The history is copied while the echoes go on, and the audio thread only
+    // waits for the last few blocks of it
+    const bool keepHistory = sampleRate == delayBufferSampleRate && delayBufferSamples > 0;
+
+    if (keepHistory) {
+        if (doublePrecision)
+            historyTransfer.copy (doubleDelayBuffer, delayBufferSamples, newDoubleDelayBuffer, newDelayBufferSamples, numDelayChannels);
+        else
+            historyTransfer.copy (delayBuffer, delayBufferSamples, newDelayBuffer, newDelayBufferSamples, numDelayChannels);
+    }
+
+    // The previous storage is freed after the lock is released
+    const SpinLock::ScopedLockType lock (delayBufferLock);
+
+    if (keepHistory) {
+        if (doublePrecision)
+            delayWritePosition = historyTransfer.finish (doubleDelayBuffer, delayBufferSamples, newDoubleDelayBuffer, newDelayBufferSamples, numDelayChannels);
+        else
+            delayWritePosition = historyTransfer.finish (delayBuffer, delayBufferSamples, newDelayBuffer, newDelayBufferSamples, numDelayChannels);
+
+        // The heads keep their delays unless the new buffer is too short for them
+        if (newDelayBufferSamples < delayBufferSamples)
+            readHeads.reset();
+    } else {
+        delayWritePosition = 0;
+        historyTransfer.reset();
+        readHeads.reset();
+    }
+
+    std::swap (delayBuffer, newDelayBuffer);
+    std::swap (doubleDelayBuffer, newDoubleDelayBuffer);
+
+    delayBufferSamples = newDelayBufferSamples;
+    delayBufferMask = delayBufferSamples - 1;
+    delayBufferSampleRate = sampleRate;
+}
+
+//==============================================================================
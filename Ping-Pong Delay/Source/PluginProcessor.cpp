@@ -42,10 +42,19 @@ PingPongDelayAudioProcessor::PingPongDelayAudioProcessor():
 #endif
     parameters (*this)
     , paramBalance (parameters, "Balance input", "", 0.0f, 1.0f, 0.25f)
-    , paramDelayTime (parameters, "Delay time", "s", 0.0f, 5.0f, 0.1f)
-    , paramFeedback (parameters, "Feedback", "", 0.0f, 0.9f, 0.7f)
+    , paramDelayTime (parameters, "Delay time", "s", 0.0f, PingPongDelayDSP::maxDelayTimeLimit, 0.1f)
+    , paramFeedback (parameters, "Feedback", "", 0.0f, PingPongDelayDSP::maxFeedback, 0.7f)
     , paramMix (parameters, "Mix", "", 0.0f, 1.0f, 1.0f)
+    , paramMaxDelayTime (parameters, "Max delay time", "s", 0.1f, PingPongDelayDSP::maxDelayTimeLimit, PingPongDelayDSP::maxDelayTimeLimit,
+                         [this](float value){ pingPongDelay.setParameter (PingPongDelayDSP::parameterMaxDelayTime, value); return value; })
+    , paramDelayTimeChanges (parameters, "Delay time changes", delayTimeChangesItemsUI, delayTimeChangesJump)
+    , paramTempoSync (parameters, "Tempo sync", false)
+    , paramNoteDivision (parameters, "Note division", TempoSync::getNoteDivisionItems(), TempoSync::noteDivisionQuarter)
+    , bypass (*this, parameters)
 {
+    // It reallocates the delay buffer
+    paramMaxDelayTime.deferCallback();
+
     parameters.apvts.state = ValueTree (Identifier (getName().removeCharacters ("- ")));
 }
 
@@ -57,32 +66,59 @@ PingPongDelayAudioProcessor::~PingPongDelayAudioProcessor()
 
 void PingPongDelayAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
+    TRACE_INSTANCE_SCOPE ("prepareToPlay", this);
+
     const double smoothTime = 1e-3;
     paramBalance.reset (sampleRate, smoothTime);
     paramDelayTime.reset (sampleRate, smoothTime);
     paramFeedback.reset (sampleRate, smoothTime);
     paramMix.reset (sampleRate, smoothTime);
+    paramMaxDelayTime.reset (sampleRate, smoothTime);
+    paramDelayTimeChanges.reset (sampleRate, smoothTime);
+    paramTempoSync.reset (sampleRate, smoothTime);
+    paramNoteDivision.reset (sampleRate, smoothTime);
 
     //======================================
 
-    float maxDelayTime = paramDelayTime.maxValue;
-    delayBufferSamples = (int)(maxDelayTime * (float)sampleRate) + 1;
-    if (delayBufferSamples < 1)
-        delayBufferSamples = 1;
+    parameters.flushDeferredCallbacks();
 
-    delayBufferChannels = getTotalNumInputChannels();
-    delayBuffer.setSize (delayBufferChannels, delayBufferSamples);
-    delayBuffer.clear();
+    updateDSPParameters();
+    pingPongDelay.prepare (sampleRate, isUsingDoublePrecision());
 
-    delayWritePosition = 0;
+    profiler.prepare (sampleRate);
+    silenceDetector.prepare (sampleRate);
+    bypass.prepare (sampleRate, samplesPerBlock, 0);
 }
 
 void PingPongDelayAudioProcessor::releaseResources()
 {
 }
 
+void PingPongDelayAudioProcessor::reset()
+{
+    pingPongDelay.reset();
+}
+
 void PingPongDelayAudioProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
 {
+    process (buffer);
+}
+
+void PingPongDelayAudioProcessor::processBlock (AudioBuffer<double>& buffer, MidiBuffer& midiMessages)
+{
+    process (buffer);
+}
+
+bool PingPongDelayAudioProcessor::supportsDoublePrecisionProcessing() const
+{
+    return true;
+}
+
+template <typename SampleType>
+void PingPongDelayAudioProcessor::process (AudioBuffer<SampleType>& buffer)
+{
+    const ProcessBlockProfiler::ScopedMeasurement measurement (profiler, buffer.getNumSamples(), isNonRealtime());
+    TRACE_INSTANCE_SCOPE ("processBlock", this);
     ScopedNoDenormals noDenormals;
 
     const int numInputChannels = getTotalNumInputChannels();
@@ -91,53 +127,45 @@ void PingPongDelayAudioProcessor::processBlock (AudioSampleBuffer& buffer, MidiB
 
     //======================================
 
-    float currentBalance = paramBalance.getNextValue();
-    float currentDelayTime = paramDelayTime.getTargetValue() * (float)getSampleRate();
-    float currentFeedback = paramFeedback.getNextValue();
-    float currentMix = paramMix.getNextValue();
-
-    int localWritePosition = delayWritePosition;
-
-    float* channelDataL = buffer.getWritePointer (0);
-    float* channelDataR = buffer.getWritePointer (1);
-    float* delayDataL = delayBuffer.getWritePointer (0);
-    float* delayDataR = delayBuffer.getWritePointer (1);
-
-    for (int sample = 0; sample < numSamples; ++sample) {
-        const float inL = (1.0f - currentBalance) * channelDataL[sample];
-        const float inR = currentBalance * channelDataR[sample];
-        float outL = 0.0f;
-        float outR = 0.0f;
-
-        float readPosition =
-            fmodf ((float)localWritePosition - currentDelayTime + (float)delayBufferSamples, delayBufferSamples);
-        int localReadPosition = floorf (readPosition);
-
-        if (localReadPosition != localWritePosition) {
-            float fraction = readPosition - (float)localReadPosition;
-            float delayed1L = delayDataL[(localReadPosition + 0)];
-            float delayed1R = delayDataR[(localReadPosition + 0)];
-            float delayed2L = delayDataL[(localReadPosition + 1) % delayBufferSamples];
-            float delayed2R = delayDataR[(localReadPosition + 1) % delayBufferSamples];
-            outL = delayed1L + fraction * (delayed2L - delayed1L);
-            outR = delayed1R + fraction * (delayed2R - delayed1R);
-
-            channelDataL[sample] = inL + currentMix * (outL - inL);
-            channelDataR[sample] = inR + currentMix * (outR - inR);
-            delayDataL[localWritePosition] = inL + outR * currentFeedback;
-            delayDataR[localWritePosition] = inR + outL * currentFeedback;
-        }
-
-        if (++localWritePosition >= delayBufferSamples)
-            localWritePosition -= delayBufferSamples;
+    parameters.applyDeferredValues();
+    parameters.applySnapshotMorph();
+
+    if (silenceDetector.skipBlock (*this, buffer))
+        return;
+
+    if (bypass.begin (buffer))
+        return;
+
+    // The tempo sync follows the tempo of the host, read once a block
+    if ((bool)paramTempoSync.getTargetValue()) {
+        AudioPlayHead::CurrentPositionInfo position;
+        AudioPlayHead* playHead = getPlayHead();
+        if (playHead != nullptr && playHead->getCurrentPosition (position))
+            pingPongDelay.setHostTempo (position.bpm);
     }
 
-    delayWritePosition = localWritePosition;
+    updateDSPParameters();
+    pingPongDelay.process (buffer.getArrayOfWritePointers(), numInputChannels, numSamples);
 
     //======================================
 
     for (int channel = numInputChannels; channel < numOutputChannels; ++channel)
         buffer.clear (channel, 0, numSamples);
+
+    bypass.end (buffer);
+}
+
+//==============================================================================
+
+void PingPongDelayAudioProcessor::updateDSPParameters() noexcept
+{
+    pingPongDelay.setParameter (PingPongDelayDSP::parameterBalance, paramBalance.getTargetValue());
+    pingPongDelay.setParameter (PingPongDelayDSP::parameterDelayTime, paramDelayTime.getTargetValue());
+    pingPongDelay.setParameter (PingPongDelayDSP::parameterFeedback, paramFeedback.getTargetValue());
+    pingPongDelay.setParameter (PingPongDelayDSP::parameterMix, paramMix.getTargetValue());
+    pingPongDelay.setParameter (PingPongDelayDSP::parameterDelayTimeChanges, paramDelayTimeChanges.getTargetValue());
+    pingPongDelay.setParameter (PingPongDelayDSP::parameterTempoSync, paramTempoSync.getTargetValue());
+    pingPongDelay.setParameter (PingPongDelayDSP::parameterNoteDivision, paramNoteDivision.getTargetValue());
 }
 
 //==============================================================================
@@ -151,13 +179,17 @@ void PingPongDelayAudioProcessor::processBlock (AudioSampleBuffer& buffer, MidiB
 
 void PingPongDelayAudioProcessor::getStateInformation (MemoryBlock& destData)
 {
-    auto state = parameters.apvts.copyState();
-    std::unique_ptr<XmlElement> xml (state.createXml());
-    copyXmlToBinary (*xml, destData);
+    MemoryOutputStream stream (destData, false);
+    parameters.writeState (stream);
 }
 
 void PingPongDelayAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
+    MemoryInputStream stream (data, (size_t)sizeInBytes, false);
+    if (parameters.readState (stream))
+        return;
+
+    // Sessions saved in the XML format of older versions
     std::unique_ptr<XmlElement> xmlState (getXmlFromBinary (data, sizeInBytes));
 
     if (xmlState.get() != nullptr)
@@ -239,7 +271,13 @@ bool PingPongDelayAudioProcessor::isMidiEffect() const
 
 double PingPongDelayAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // Each crossing between the channels goes through the feedback gain once
+    return SilenceDetector::getFeedbackTailSeconds (paramFeedback.getTargetValue(), pingPongDelay.getDelayTime());
+}
+
+AudioProcessorParameter* PingPongDelayAudioProcessor::getBypassParameter() const
+{
+    return bypass.getParameter();
 }
 
 //==============================================================================
@@ -270,6 +308,31 @@ void PingPongDelayAudioProcessor::changeProgramName (int index, const String& ne
 
 //==============================================================================
 
+MemoryFootprint PingPongDelayAudioProcessor::getMemoryFootprint() const
+{
+    const ScopedLock lock (parameters.deferredCallbackLock);
+
+    MemoryFootprint footprint;
+    footprint.add (MemoryFootprint::other, sizeof (*this));
+    bypass.addMemoryFootprint (footprint);
+
+    pingPongDelay.addMemoryFootprint (footprint);
+
+    return footprint;
+}
+
+void PingPongDelayAudioProcessor::trimMemory()
+{
+    const float delayTime = pingPongDelay.getDelayTime();
+    const float newMaxDelayTime = jlimit (paramMaxDelayTime.minValue, paramMaxDelayTime.maxValue,
+                                          std::ceil (delayTime * 10.0f) / 10.0f);
+    if (newMaxDelayTime < paramMaxDelayTime.getTargetValue())
+        if (RangedAudioParameter* parameter = parameters.apvts.getParameter (paramMaxDelayTime.paramID))
+            parameter->setValueNotifyingHost (parameter->convertTo0to1 (newMaxDelayTime));
+}
+
+//==============================================================================
+
 // This creates new instances of the plugin..
 AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
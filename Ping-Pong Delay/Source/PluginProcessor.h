@@ -30,10 +30,15 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "PluginParameter.h"
+#include "ProcessBlockProfiler.h"
+#include "SilenceDetector.h"
+#include "PluginBypass.h"
+#include "MemoryFootprint.h"
+#include "PingPongDelayDSP.h"
 
 //==============================================================================
 
-class PingPongDelayAudioProcessor : public AudioProcessor
+class PingPongDelayAudioProcessor : public AudioProcessor, public MemoryFootprintSource
 {
 public:
     //==============================================================================
@@ -45,7 +50,10 @@ public:
 
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
+    void reset() override;
     void processBlock (AudioSampleBuffer&, MidiBuffer&) override;
+    void processBlock (AudioBuffer<double>&, MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override;
 
     //==============================================================================
 
@@ -78,6 +86,7 @@ public:
     bool producesMidi() const override;
     bool isMidiEffect () const override;
     double getTailLengthSeconds() const override;
+    AudioProcessorParameter* getBypassParameter() const override;
 
     //==============================================================================
 
@@ -89,17 +98,45 @@ public:
 
     //==============================================================================
 
+    MemoryFootprint getMemoryFootprint() const override;
 
+    /** Lowers the maximum delay time to the current delay time, or the synced one, so
+        the buffer is reallocated to it, with its history, by the deferred callback of
+        paramMaxDelayTime. Longer delays set later are clamped to it until the maximum
+        is raised again.
+    */
+    void trimMemory() override;
 
+    //==============================================================================
 
+    StringArray delayTimeChangesItemsUI = {
+        "Jump",
+        "Crossfade"
+    };
 
+    enum delayTimeChangesIndex {
+        delayTimeChangesJump = PingPongDelayDSP::delayTimeChangesJump,
+        delayTimeChangesCrossfade = PingPongDelayDSP::delayTimeChangesCrossfade,
+    };
 
-    //==============================================================================
+    //======================================
+
+    /** Runs both processBlock() overloads. */
+    template <typename SampleType>
+    void process (AudioBuffer<SampleType>& buffer);
+
+    /** Hands the values of the parameters to the core, once a block. The maximum
+        delay time reallocates the buffer, so its deferred callback hands it over
+        instead.
+    */
+    void updateDSPParameters() noexcept;
 
-    AudioSampleBuffer delayBuffer;
-    int delayBufferSamples;
-    int delayBufferChannels;
-    int delayWritePosition;
+    PingPongDelayDSP pingPongDelay;
+
+    //======================================
+
+    ProcessBlockProfiler profiler;
+    SilenceDetector silenceDetector;
 
     //======================================
 
@@ -109,6 +146,12 @@ public:
     PluginParameterLinSlider paramDelayTime;
     PluginParameterLinSlider paramFeedback;
     PluginParameterLinSlider paramMix;
+    PluginParameterLinSlider paramMaxDelayTime;
+    PluginParameterComboBox paramDelayTimeChanges;
+    PluginParameterToggle paramTempoSync;
+    PluginParameterComboBox paramNoteDivision;
+
+    PluginBypass bypass;
 
 private:
     //==============================================================================
@@ -0,0 +1,126 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+
+/** Delay of a note division at the tempo of the host, in whole samples.
+
+    update() reads the position of the play head once a block. The delay is only
+    worked out again when the tempo or the division changes, so the blocks in
+    between return the cached offset. Hosts that do not report a tempo, and
+    renders without a play head, keep the last tempo, 120 BPM at first.
+*/
+class TempoSync
+{
+public:
+    enum noteDivisionIndex {
+        noteDivisionWhole = 0,
+        noteDivisionHalf,
+        noteDivisionHalfDotted,
+        noteDivisionHalfTriplet,
+        noteDivisionQuarter,
+        noteDivisionQuarterDotted,
+        noteDivisionQuarterTriplet,
+        noteDivisionEighth,
+        noteDivisionEighthDotted,
+        noteDivisionEighthTriplet,
+        noteDivisionSixteenth,
+        noteDivisionSixteenthDotted,
+        noteDivisionSixteenthTriplet,
+        noteDivisionThirtySecond,
+        numNoteDivisions
+    };
+
+    static StringArray getNoteDivisionItems()
+    {
+        return {
+            "1/1",
+            "1/2", "1/2 dotted", "1/2 triplet",
+            "1/4", "1/4 dotted", "1/4 triplet",
+            "1/8", "1/8 dotted", "1/8 triplet",
+            "1/16", "1/16 dotted", "1/16 triplet",
+            "1/32"
+        };
+    }
+
+    /** Length of a note division in quarter notes. */
+    static double getNoteDivisionBeats (const int noteDivision) noexcept
+    {
+        if (noteDivision <= noteDivisionWhole)
+            return 4.0;
+        if (noteDivision >= noteDivisionThirtySecond)
+            return 0.125;
+
+        // From the half notes on, every note has a dotted and a triplet version
+        const int note = (noteDivision - noteDivisionHalf) / 3;
+        const int variant = (noteDivision - noteDivisionHalf) % 3;
+        const double beats = 2.0 / (double)(1 << note);
+
+        return (variant == 1) ? beats * 1.5 : (variant == 2) ? beats * 2.0 / 3.0 : beats;
+    }
+
+    void prepare (const double newSampleRate) noexcept
+    {
+        sampleRate = newSampleRate;
+        cachedBpm = 0.0;
+        cachedNoteDivision = -1;
+    }
+
+    void update (AudioPlayHead* playHead, const int noteDivision) noexcept
+    {
+        AudioPlayHead::CurrentPositionInfo position;
+        const bool hasPosition = playHead != nullptr && playHead->getCurrentPosition (position);
+        update (hasPosition ? position.bpm : 0.0, noteDivision);
+    }
+
+    /** Same as above, for callers that read the tempo of the host themselves. A
+        tempo of 0 or less keeps the last one.
+    */
+    void update (const double hostBpm, const int noteDivision) noexcept
+    {
+        if (hostBpm > 0.0)
+            bpm = hostBpm;
+
+        if (bpm == cachedBpm && noteDivision == cachedNoteDivision)
+            return;
+
+        cachedBpm = bpm;
+        cachedNoteDivision = noteDivision;
+        delaySamples = roundToInt (getNoteDivisionBeats (noteDivision) * 60.0 / bpm * sampleRate);
+    }
+
+    int getDelaySamples() const noexcept { return delaySamples; }
+    double getDelaySeconds() const noexcept { return (double)delaySamples / sampleRate; }
+
+private:
+    double sampleRate = 44100.0;
+    double bpm = 120.0;
+    double cachedBpm = 0.0;
+    int cachedNoteDivision = -1;
+    int delaySamples = 0;
+};
+
+//==============================================================================
@@ -0,0 +1,163 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "MeteringFifo.h"
+
+//==============================================================================
+
+/** Horizontal bars for the input and output peaks, in dB, and the gain reduction.
+    The bars jump up to new peaks and fall back at a fixed rate, and the component
+    only repaints while a bar moves.
+*/
+class LevelMeterDisplay : public Component
+{
+public:
+    enum {
+        rowHeight = 16,
+        numRows = 3,
+        preferredHeight = numRows * rowHeight,
+    };
+
+    /** Called on every refresh, with nullptr if no new frame arrived. */
+    void update (const LevelFrame* frame, const float secondsSinceLastUpdate)
+    {
+        const float fall = fallDecibelsPerSecond * secondsSinceLastUpdate;
+        float newValues[numRows] = {
+            jmax (minDecibels, values[0] - fall),
+            jmax (minDecibels, values[1] - fall),
+            jmax (0.0f, values[2] - fall),
+        };
+
+        if (frame != nullptr) {
+            newValues[0] = jmax (newValues[0], Decibels::gainToDecibels (frame->inputPeak, minDecibels));
+            newValues[1] = jmax (newValues[1], Decibels::gainToDecibels (frame->outputPeak, minDecibels));
+            newValues[2] = jmax (newValues[2], jmin (frame->gainReduction, maxGainReduction));
+        }
+
+        for (int row = 0; row < numRows; ++row) {
+            if (newValues[row] != values[row]) {
+                values[row] = newValues[row];
+                repaint (0, row * rowHeight, getWidth(), rowHeight);
+            }
+        }
+    }
+
+    void paint (Graphics& g) override
+    {
+        const char* const names[numRows] = { "Input", "Output", "Reduction" };
+        const Colour barColour = findColour (Slider::thumbColourId);
+        const Colour trackColour = findColour (Slider::backgroundColourId);
+
+        for (int row = 0; row < numRows; ++row) {
+            Rectangle<int> r (0, row * rowHeight, getWidth(), rowHeight);
+            g.setColour (findColour (Label::textColourId));
+            g.drawText (names[row], r.removeFromLeft (labelWidth), Justification::centredLeft);
+
+            r.reduce (0, 3);
+            g.setColour (trackColour);
+            g.fillRect (r);
+
+            const float proportion = (row < 2) ? 1.0f - values[row] / minDecibels
+                                               : values[row] / maxGainReduction;
+            g.setColour (barColour);
+            g.fillRect (r.withWidth (roundToInt (proportion * (float)r.getWidth())));
+        }
+    }
+
+private:
+    enum { labelWidth = 100 };
+
+    const float minDecibels = -60.0f;
+    const float maxGainReduction = 24.0f;
+    const float fallDecibelsPerSecond = 24.0f;
+
+    float values[numRows] = { -60.0f, -60.0f, 0.0f };
+};
+
+//==============================================================================
+
+/** Power spectrum in dB over the bands of a SpectrumFrame, low frequencies on the
+    left. Like the level meters, it falls back at a fixed rate and only repaints
+    while it moves.
+*/
+class SpectrumDisplay : public Component
+{
+public:
+    enum { preferredHeight = 100 };
+
+    SpectrumDisplay()
+    {
+        for (auto& value : values)
+            value = minDecibels;
+    }
+
+    /** Called on every refresh, with nullptr if no new frame arrived. */
+    void update (const SpectrumFrame* frame, const float secondsSinceLastUpdate)
+    {
+        const float fall = fallDecibelsPerSecond * secondsSinceLastUpdate;
+        bool moved = false;
+
+        for (int band = 0; band < SpectrumFrame::numBands; ++band) {
+            float value = jmax (minDecibels, values[band] - fall);
+            if (frame != nullptr)
+                value = jmax (value, Decibels::gainToDecibels (frame->power[band], minDecibels * 2.0f) * 0.5f);
+
+            moved = moved || value != values[band];
+            values[band] = value;
+        }
+
+        if (moved)
+            repaint();
+    }
+
+    void paint (Graphics& g) override
+    {
+        const Rectangle<float> r = getLocalBounds().toFloat();
+        g.setColour (findColour (Slider::backgroundColourId));
+        g.fillRect (r);
+
+        Path spectrum;
+        spectrum.startNewSubPath (r.getBottomLeft());
+        for (int band = 0; band < SpectrumFrame::numBands; ++band) {
+            const float x = r.getX() + r.getWidth() * ((float)band + 0.5f) / (float)SpectrumFrame::numBands;
+            const float y = r.getY() + r.getHeight() * values[band] / minDecibels;
+            spectrum.lineTo (x, y);
+        }
+        spectrum.lineTo (r.getBottomRight());
+        spectrum.closeSubPath();
+
+        g.setColour (findColour (Slider::thumbColourId));
+        g.fillPath (spectrum);
+    }
+
+private:
+    const float minDecibels = -90.0f;
+    const float fallDecibelsPerSecond = 60.0f;
+
+    float values[SpectrumFrame::numBands];
+};
+
+//==============================================================================
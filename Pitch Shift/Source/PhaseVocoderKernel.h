@@ -0,0 +1,233 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <limits>
+
+//==============================================================================
+
+/** Phase vocoder bin update, numLanes bins at a time in SIMD registers.
+
+    For every bin the phase is measured, its deviation from the advance expected for
+    the bin over a hop is wrapped, and the output phase moves on by the true advance
+    times the ratio. The bin is then rotated by the difference between the output
+    and the measured phase, so its magnitude is never computed. atan2, sin and cos are
+    polynomial approximations, accurate to about 2e-6, and the phases are wrapped by
+    rounding instead of fmod, so every lane takes the same path.
+
+    The measurement is split from the output phases, in analyse() and synthesise(),
+    so that several voices can share one analysis.
+*/
+struct PhaseVocoderKernel
+{
+    typedef dsp::SIMDRegister<float> Lanes;
+    typedef Lanes::vMaskType Mask;
+
+    enum { numLanes = (int)Lanes::SIMDNumElements };
+
+    //==============================================================================
+
+    /** Measures the phases of numBins bins, and their true advance over a hop: the
+        expected advance of the bin plus the wrapped deviation from it. inputPhase
+        holds the phases of the previous frame, and gets the ones of this frame.
+    */
+    static void analyse (const dsp::Complex<float>* bins, float* inputPhase, float* advance,
+                         const float* omega, const int hopSize, const int numBins) noexcept
+    {
+        const Lanes hop = Lanes::expand ((float)hopSize);
+
+        for (int start = 0; start < numBins; start += numLanes) {
+            const int numValidLanes = jmin ((int)numLanes, numBins - start);
+
+            // Deinterleaves the bins, the lanes past the last one repeat it. The ratio
+            // of the smaller to the larger coordinate is divided here, as the
+            // registers cannot divide.
+            alignas (Lanes::SIMDRegisterSize) float real[numLanes];
+            alignas (Lanes::SIMDRegisterSize) float imag[numLanes];
+            alignas (Lanes::SIMDRegisterSize) float tangent[numLanes];
+            alignas (Lanes::SIMDRegisterSize) float previousInput[numLanes];
+            alignas (Lanes::SIMDRegisterSize) float binOmega[numLanes];
+            alignas (Lanes::SIMDRegisterSize) float binAdvance[numLanes];
+
+            for (int lane = 0; lane < numLanes; ++lane) {
+                const int index = start + jmin (lane, numValidLanes - 1);
+                real[lane] = bins[index].real();
+                imag[lane] = bins[index].imag();
+                previousInput[lane] = inputPhase[index];
+                binOmega[lane] = omega[index];
+
+                const float absReal = std::abs (real[lane]);
+                const float absImag = std::abs (imag[lane]);
+                tangent[lane] = jmin (absReal, absImag) / jmax (absReal, absImag, std::numeric_limits<float>::min());
+            }
+
+            const Lanes phase = atan2 (Lanes::fromRawArray (imag), Lanes::fromRawArray (real),
+                                       Lanes::fromRawArray (tangent));
+
+            const Lanes expectedAdvance = Lanes::fromRawArray (binOmega) * hop;
+            const Lanes deviation = wrapPhase (phase - Lanes::fromRawArray (previousInput) - expectedAdvance);
+
+            phase.copyToRawArray (previousInput);
+            (expectedAdvance + deviation).copyToRawArray (binAdvance);
+
+            for (int lane = 0; lane < numValidLanes; ++lane) {
+                inputPhase[start + lane] = previousInput[lane];
+                advance[start + lane] = binAdvance[lane];
+            }
+        }
+    }
+
+    /** Moves the numBins phases of outputPhase on by the advance times the ratio,
+        and writes into output the bins of input rotated from their measured phase,
+        in inputPhase, to the new one. output may be input, and every voice of the
+        same analysis calls this with its own ratio and outputPhase.
+    */
+    static void synthesise (const dsp::Complex<float>* input, dsp::Complex<float>* output,
+                            const float* inputPhase, const float* advance, float* outputPhase,
+                            const int numBins, const float ratio) noexcept
+    {
+        const Lanes lanesRatio = Lanes::expand (ratio);
+
+        for (int start = 0; start < numBins; start += numLanes) {
+            const int numValidLanes = jmin ((int)numLanes, numBins - start);
+
+            alignas (Lanes::SIMDRegisterSize) float real[numLanes];
+            alignas (Lanes::SIMDRegisterSize) float imag[numLanes];
+            alignas (Lanes::SIMDRegisterSize) float phase[numLanes];
+            alignas (Lanes::SIMDRegisterSize) float binAdvance[numLanes];
+            alignas (Lanes::SIMDRegisterSize) float previousOutput[numLanes];
+
+            for (int lane = 0; lane < numLanes; ++lane) {
+                const int index = start + jmin (lane, numValidLanes - 1);
+                real[lane] = input[index].real();
+                imag[lane] = input[index].imag();
+                phase[lane] = inputPhase[index];
+                binAdvance[lane] = advance[index];
+                previousOutput[lane] = outputPhase[index];
+            }
+
+            const Lanes x = Lanes::fromRawArray (real);
+            const Lanes y = Lanes::fromRawArray (imag);
+            const Lanes newPhase = wrapPhase (Lanes::fromRawArray (previousOutput)
+                                              + Lanes::fromRawArray (binAdvance) * lanesRatio);
+
+            Lanes sine, cosine;
+            sinCos (newPhase - Lanes::fromRawArray (phase), sine, cosine);
+
+            newPhase.copyToRawArray (previousOutput);
+            (x * cosine - y * sine).copyToRawArray (real);
+            (x * sine + y * cosine).copyToRawArray (imag);
+
+            for (int lane = 0; lane < numValidLanes; ++lane) {
+                const int index = start + lane;
+                outputPhase[index] = previousOutput[lane];
+                output[index] = dsp::Complex<float> (real[lane], imag[lane]);
+            }
+        }
+    }
+
+    //==============================================================================
+
+    static Lanes select (const Mask mask, const Lanes whenTrue, const Lanes whenFalse) noexcept
+    {
+        // One of the two is always zero
+        return (whenTrue & mask) + (whenFalse & ~mask);
+    }
+
+    static Lanes negateWhere (const Mask mask, const Lanes value) noexcept
+    {
+        return value ^ (mask & Mask::expand (0x80000000u));
+    }
+
+    static Lanes floor (const Lanes value) noexcept
+    {
+        const Lanes truncated = Lanes::truncate (value);
+        return truncated - (Lanes::expand (1.0f) & Lanes::greaterThan (truncated, value));
+    }
+
+    /** Wraps any phase into [-pi, pi). */
+    static Lanes wrapPhase (const Lanes phase) noexcept
+    {
+        const Lanes turns = floor (phase * Lanes::expand (0.159154943f) + Lanes::expand (0.5f));
+        return phase - turns * Lanes::expand (6.28318531f);
+    }
+
+    /** Angle of (x, y) in [-pi, pi], given the ratio of the smaller to the larger of
+        their absolute values.
+    */
+    static Lanes atan2 (const Lanes y, const Lanes x, const Lanes tangent) noexcept
+    {
+        // Minimax polynomial of atan for tangents in [0, 1]
+        const Lanes s = tangent * tangent;
+        Lanes angle = Lanes::expand (-0.01172120f);
+        angle = angle * s + Lanes::expand (0.05265332f);
+        angle = angle * s + Lanes::expand (-0.11643287f);
+        angle = angle * s + Lanes::expand (0.19354346f);
+        angle = angle * s + Lanes::expand (-0.33262347f);
+        angle = angle * s + Lanes::expand (0.99997726f);
+        angle = angle * tangent;
+
+        const Mask absMask = Mask::expand (0x7fffffffu);
+        const Lanes zero = Lanes::expand (0.0f);
+
+        angle = select (Lanes::greaterThan (y & absMask, x & absMask), Lanes::expand (1.57079633f) - angle, angle);
+        angle = select (Lanes::lessThan (x, zero), Lanes::expand (3.14159265f) - angle, angle);
+        return negateWhere (Lanes::lessThan (y, zero), angle);
+    }
+
+    /** Sine and cosine of phases up to a few hundred radians. */
+    static void sinCos (const Lanes phase, Lanes& sine, Lanes& cosine) noexcept
+    {
+        // Splits the phase into quarter turns, in quadrant 0 to 3, and a remainder in
+        // [-pi / 4, pi / 4]
+        const Lanes quarterTurns = floor (phase * Lanes::expand (0.636619772f) + Lanes::expand (0.5f));
+        const Lanes r = (phase - quarterTurns * Lanes::expand (1.57079625f))
+                        - quarterTurns * Lanes::expand (7.54978995e-8f);
+        const Lanes quadrant = quarterTurns - floor (quarterTurns * Lanes::expand (0.25f)) * Lanes::expand (4.0f);
+
+        // Taylor series of sin and cos
+        const Lanes r2 = r * r;
+        Lanes sinR = Lanes::expand (-1.0f / 5040.0f);
+        sinR = sinR * r2 + Lanes::expand (1.0f / 120.0f);
+        sinR = sinR * r2 + Lanes::expand (-1.0f / 6.0f);
+        sinR = sinR * r2 * r + r;
+
+        Lanes cosR = Lanes::expand (1.0f / 40320.0f);
+        cosR = cosR * r2 + Lanes::expand (-1.0f / 720.0f);
+        cosR = cosR * r2 + Lanes::expand (1.0f / 24.0f);
+        cosR = cosR * r2 + Lanes::expand (-0.5f);
+        cosR = cosR * r2 + Lanes::expand (1.0f);
+
+        const Mask quadrant1 = Lanes::equal (quadrant, Lanes::expand (1.0f));
+        const Mask quadrant2 = Lanes::equal (quadrant, Lanes::expand (2.0f));
+        const Mask quadrant3 = Lanes::equal (quadrant, Lanes::expand (3.0f));
+
+        const Mask swap = quadrant1 | quadrant3;
+        sine = negateWhere (quadrant2 | quadrant3, select (swap, cosR, sinR));
+        cosine = negateWhere (quadrant1 | quadrant2, select (swap, sinR, cosR));
+    }
+};
+
+//==============================================================================
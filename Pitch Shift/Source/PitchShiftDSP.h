@@ -0,0 +1,742 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+
+
+#pragma once
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "ChannelWorkerPool.h"
+#include "MemoryFootprint.h"
+#include "STFT.h"
+#include "PhaseVocoderKernel.h"
+#include "ModulatedDelayLine.h"
+#include <atomic>
+
+//==============================================================================
+
+/** The audio processing of the Pitch Shift, without the parameters, state, editor
+    or buses of the plugin, for hosts that only need the audio and run many
+    instances. PitchShiftAudioProcessor wraps one and hands it the values of its
+    parameters in their natural units: the shift of every voice as a ratio of
+    frequencies, from 0.5 to 2, the index of the mode, the number of voices, the
+    parallel channels as 0 or 1, the FFT size in samples, the overlap as the
+    number of hops in a window, and the index of the STFT window type.
+
+    The FFT size, overlap and window type build a new phase vocoder, so
+    setParameter() is not real-time safe for them. It is meant for another thread
+    than process(), which picks the new engine up without locks through a
+    DoubleBufferedSTFT. The configuration is kept under a lock of its own, so that
+    several threads can change it.
+*/
+class PitchShiftDSP
+{
+public:
+    enum parameterIndex {
+        parameterShift = 0,
+        parameterShift2,
+        parameterShift3,
+        parameterMode,
+        parameterVoices,
+        parameterParallelChannels,
+        parameterFftSize,
+        parameterOverlap,
+        parameterWindowType,
+        numParameters,
+    };
+
+    enum modeIndex {
+        modePhaseVocoder = 0,
+        modeTimeDomain,
+    };
+
+    enum { maxNumVoices = 3 };
+
+    //======================================
+
+    class PhaseVocoder : public STFT
+    {
+    public:
+        PhaseVocoder (PitchShiftDSP& p)
+            : STFT (true)
+            , parent (p)
+            , numVoices (1)
+            , resamplingCacheCounter (0)
+        {
+        }
+
+        /** Every frame is analysed once, then each voice moves its own output phases
+            on by its ratio, and is transformed back, resampled and overlap-added at
+            a gain of 1 / numVoices.
+        */
+        void setNumVoices (const int newNumVoices);
+        void updateShift (const int voice, const float newShift);
+
+        /** Runs the channels of every frame on the parent's ChannelWorkerPool. Each
+            channel has its own FFT buffer and scratch, and the frame returns once all
+            of them are done. Only layouts of ChannelWorkerPool::minChannelsForWorkers
+            channels or more go to the workers.
+        */
+        void setParallelChannels (const bool parallel) noexcept { parallelChannels = parallel; }
+
+        /** Adds the phases, the scratch of the channels and the resampling cache. */
+        void addMemoryFootprint (MemoryFootprint& footprint) const override;
+
+    private:
+        int getOutputBufferLength() const override;
+        void updateFftSize (const int newFftSize) override;
+        void updateWindow (const int newWindowType) override;
+        void processFrames() override;
+        void processFrame (const int channel) override;
+
+        void realignPhases (const int voice);
+        void synthesiseVoice (const int channel, const int voice, const float gain, const float* frame);
+        struct CachedResampling;
+        const CachedResampling* getResampling (const int length);
+
+        PitchShiftDSP& parent;
+
+        struct Voice
+        {
+            float shift = 0.0f;
+            float ratio = 1.0f;
+            int resampledLength = 0;
+            const CachedResampling* resampling = nullptr;
+            AudioSampleBuffer outputPhase;
+            bool needToResetPhases = true;
+        };
+
+        Voice voices[maxNumVoices];
+        int numVoices;
+
+        /** Square root of the synthesis window times windowScaleFactor, and the two
+            frame samples and the fraction that every resampled sample interpolates,
+            kept for the last few resampled lengths so that a steady or slowly moving
+            shift does not recompute them. The length only changes with the quantised
+            ratio. Every slot is allocated to the longest possible length in
+            updateFftSize, so processBlock never allocates.
+        */
+        struct CachedResampling
+        {
+            int length = 0;
+            int windowType = -1;
+            uint32 lastUsed = 0;
+            HeapBlock<float> window;
+            HeapBlock<int> indices1;
+            HeapBlock<int> indices2;
+            HeapBlock<float> fractions;
+        };
+
+        enum { numCachedResamplings = 8 };
+        CachedResampling resamplingCache[numCachedResamplings];
+        uint32 resamplingCacheCounter;
+
+        // Shared by all the voices: the measured phases, and for every channel, the
+        // frame, the true advance of the phases over the last hop and a copy of the
+        // bins, which every inverse transform overwrites
+        struct ChannelScratch
+        {
+            HeapBlock<float> fftBuffer;
+            HeapBlock<float> advance;
+            HeapBlock<dsp::Complex<float>> analysedBins;
+        };
+
+        HeapBlock<float> omega;
+        AudioSampleBuffer inputPhase;
+        OwnedArray<ChannelScratch> channelScratch;
+        bool parallelChannels = false;
+    };
+
+    //======================================
+
+    /** Builds the first phase vocoder and the delay line of the time domain mode,
+        for blocks of up to maxBlockSize samples. Not real-time safe.
+    */
+    void prepare (const double sampleRate, const int numChannels, const int maxBlockSize)
+    {
+        {
+            const ScopedLock lock (configurationLock);
+            stftNumChannels = numChannels;
+            stft.prepare (stftNumChannels, maxBlockSize, sampleRate);
+            updateStft();
+        }
+
+        timeDomainWindowSamples = jmax (4, (int)(timeDomainWindowTime * (float)sampleRate));
+        timeDomainCrossfadeSamples = jmax (1, timeDomainWindowSamples / 8);
+
+        // Far enough from the ends of the window for a whole crossfade at a ratio of 2
+        // or 0.5, so neither head ever leaves it
+        timeDomainMinDelay = ModulatedDelayLine::getLookahead (timeDomainInterpolation) + timeDomainCrossfadeSamples;
+        timeDomainMaxDelay = timeDomainMinDelay + timeDomainWindowSamples - 2 * timeDomainCrossfadeSamples;
+        delayLine.prepare (numChannels,
+                           timeDomainWindowSamples + ModulatedDelayLine::getLookahead (timeDomainInterpolation) + 1);
+
+        channelWorkers->prepare (numChannels);
+    }
+
+    /** Clears the delay line and the active phase vocoder. Real-time safe. */
+    void reset() noexcept
+    {
+        delayLine.clear();
+        stft.reset();
+    }
+
+    /** Real-time safe for the shifts, the mode, the voices and the parallel
+        channels. The other settings build a new phase vocoder, which is not.
+    */
+    void setParameter (const int index, const float value)
+    {
+        switch (index) {
+            case parameterShift:            shifts[0] = value; return;
+            case parameterShift2:           shifts[1] = value; return;
+            case parameterShift3:           shifts[2] = value; return;
+            case parameterMode:             mode = jlimit ((int)modePhaseVocoder, (int)modeTimeDomain, (int)value); return;
+            case parameterVoices:           numVoices = jlimit (1, (int)maxNumVoices, (int)value); return;
+            case parameterParallelChannels: parallelChannels = (value > 0.5f); return;
+        }
+
+        const ScopedLock lock (configurationLock);
+
+        switch (index) {
+            case parameterFftSize:    stftFftSize = (int)value; break;
+            case parameterOverlap:    stftHopSize = (int)value; break;
+            case parameterWindowType: stftWindowType = (int)value; break;
+        }
+
+        updateStft();
+    }
+
+    /** Set by the audio thread from the quality governor, which halves the overlap
+        of the frames for every step of reduction, down to the 4 frames that the
+        phase vocoder needs to keep its phases coherent. Offline renders set it to -1,
+        which doubles the overlap up to 8, as a smaller hop quantises the shift more.
+        Returns true when it changes, for the caller to set the overlap again from
+        another thread, which builds an engine with it.
+    */
+    bool setQualityReduction (const int newQualityReduction) noexcept
+    {
+        return stftQualityReduction.exchange (newQualityReduction, std::memory_order_relaxed) != newQualityReduction;
+    }
+
+    /** Where the engines send the spectrum of their frames. To be set before
+        prepare().
+    */
+    void setSpectrumMeter (MeterSource<SpectrumFrame>* newSpectrumMeter)
+    {
+        spectrumMeter = newSpectrumMeter;
+    }
+
+    /** The latency of the mode. For the phase vocoder, the one of the last engine
+        built: exact without a shift, as otherwise the resampled frames are centred
+        (fftSize - resampledLength) / 2 samples earlier or later. The time domain
+        heads are on average half a window behind the input.
+    */
+    int getLatencySamples (const int forMode) const noexcept
+    {
+        if (forMode == modeTimeDomain)
+            return ModulatedDelayLine::getLookahead (timeDomainInterpolation) + timeDomainWindowSamples / 2;
+
+        return stftLatency.load();
+    }
+
+    /** The FFT size of the last engine built, and the longest delay of the time
+        domain heads, in samples.
+    */
+    int getFftSize() const noexcept             { return stftFftSize; }
+    int getTimeDomainMaxDelay() const noexcept  { return timeDomainMaxDelay; }
+
+    /** Processes numSamples samples of numChannels channels in place. */
+    void process (float* const* channels, const int numChannels, const int numSamples) noexcept
+    {
+        AudioSampleBuffer block (channels, numChannels, numSamples);
+
+        if (mode == modeTimeDomain) {
+            // Drops what was left in the history when the mode was last used
+            if (lastMode != modeTimeDomain) {
+                delayLine.clear();
+                activeHeadDelay = (float)(ModulatedDelayLine::getLookahead (timeDomainInterpolation)
+                                          + timeDomainWindowSamples / 2);
+                crossfadePosition = -1;
+            }
+
+            processTimeDomain (block);
+        } else {
+            const int currentNumVoices = numVoices;
+            const bool currentParallelChannels = parallelChannels;
+            const float* currentShifts = shifts;
+
+            stft.processBlock (block, [currentNumVoices, currentParallelChannels, currentShifts] (PhaseVocoder& phaseVocoder) {
+                phaseVocoder.setNumVoices (currentNumVoices);
+                phaseVocoder.setParallelChannels (currentParallelChannels);
+                for (int voice = 0; voice < maxNumVoices; ++voice)
+                    phaseVocoder.updateShift (voice, currentShifts[voice]);
+            });
+        }
+        lastMode = mode;
+    }
+
+    void addMemoryFootprint (MemoryFootprint& footprint) const
+    {
+        {
+            const ScopedLock lock (configurationLock);
+            stft.addMemoryFootprint (footprint);
+        }
+
+        delayLine.addMemoryFootprint (footprint);
+    }
+
+    /** Frees the engine that the last change of the FFT settings retired. */
+    void trimMemory()
+    {
+        const ScopedLock lock (configurationLock);
+        stft.trim();
+    }
+
+private:
+    //==============================================================================
+
+    void updateStft()
+    {
+        // Called by setParameter() before prepare() too, when there is nothing to
+        // configure yet
+        if (stftNumChannels == 0)
+            return;
+
+        PhaseVocoder* newStft = new PhaseVocoder (*this);
+        newStft->setup (stftNumChannels);
+        newStft->setSpectrumMeter (spectrumMeter);
+        const int qualityReduction = stftQualityReduction.load (std::memory_order_relaxed);
+        const int overlap = (qualityReduction < 0) ? jmin (8, stftHopSize << 1)
+                                                   : jmax (jmin (stftHopSize, 4), stftHopSize >> qualityReduction);
+        newStft->updateParameters (stftFftSize,
+                                   overlap,
+                                   stftWindowType);
+        stftLatency = newStft->getLatencySamples();
+        stft.publish (newStft);
+    }
+
+    //==============================================================================
+
+    /** Low latency pitch shifting for live monitoring. A read head sweeps a short
+        delay line at the speed that shifts the pitch by the ratio: its delay grows by
+        1 - ratio every sample. Before it leaves the window, a second head takes over
+        with a raised cosine crossfade. The second head starts at least a quarter of
+        a window away, back where the first one came from, at the delay whose recent
+        past correlates best with the one of the first head. For periodic input the
+        splice then lands a whole number of periods away and the phase of the tone
+        carries on through it.
+    */
+    void processTimeDomain (AudioSampleBuffer& buffer) noexcept;
+    float findSpliceDelay (const int numChannels, const int position, const float delay, const float drift) const noexcept;
+
+    enum {
+        numHeads = 2,
+        timeDomainInterpolation = ModulatedDelayLine::interpolationCubic,
+    };
+
+    const float timeDomainWindowTime = 0.01f;
+    int timeDomainWindowSamples = 0;
+    int timeDomainCrossfadeSamples = 1;
+    int timeDomainMinDelay = 0;
+    int timeDomainMaxDelay = 0;
+    float activeHeadDelay = 0.0f;
+    float spliceHeadDelay = 0.0f;
+    int crossfadePosition = -1;
+    int lastMode = modePhaseVocoder;
+
+    ModulatedDelayLine delayLine;
+    ModulatedDelayLine::ReadPositions readPositions;
+    alignas (ModulatedDelayLine::Lanes::SIMDRegisterSize)
+        float heads[ModulatedDelayLine::maxBlockSize * ModulatedDelayLine::numLanes];
+
+    //==============================================================================
+
+    /** The configuration of the engines that updateStft() builds, only touched
+        under configurationLock.
+    */
+    CriticalSection configurationLock;
+    int stftNumChannels = 0;
+    int stftFftSize = 512;
+    int stftHopSize = 8;
+    int stftWindowType = STFT::windowTypeHann;
+    DoubleBufferedSTFT<PhaseVocoder> stft;
+    std::atomic<int> stftLatency { 0 };
+
+    std::atomic<int> stftQualityReduction { 0 };
+
+    // The lowest shift, an octave down, which sets the length of the output buffer
+    static constexpr float minShift = 0.5f;
+
+    float shifts[maxNumVoices] = { 1.0f, 1.0f, 1.0f };
+    int mode = modePhaseVocoder;
+    int numVoices = 1;
+    bool parallelChannels = false;
+
+    MeterSource<SpectrumFrame>* spectrumMeter = nullptr;
+    SharedResourcePointer<ChannelWorkerPool> channelWorkers;
+};
+
+//==============================================================================
+
+inline void PitchShiftDSP::processTimeDomain (AudioSampleBuffer& buffer) noexcept
+{
+    const int numChannels = jmin (buffer.getNumChannels(), delayLine.getNumChannels());
+    const int numSamples = buffer.getNumSamples();
+
+    // The shift holds for the whole block
+    const float drift = 1.0f - shifts[0];
+
+    float delays[ModulatedDelayLine::maxBlockSize * numHeads];
+    float gains[ModulatedDelayLine::maxBlockSize];
+
+    for (int start = 0; start < numSamples; start += ModulatedDelayLine::maxBlockSize) {
+        const int blockSamples = jmin (numSamples - start, (int)ModulatedDelayLine::maxBlockSize);
+
+        // The whole block goes in first, so the splice search can see up to its last sample
+        const int position = delayLine.getWritePosition();
+        for (int channel = 0; channel < numChannels; ++channel)
+            delayLine.write (channel, buffer.getReadPointer (channel, start), blockSamples, position);
+
+        for (int sample = 0; sample < blockSamples; ++sample) {
+            if (crossfadePosition < 0 && (activeHeadDelay < (float)timeDomainMinDelay
+                                          || activeHeadDelay > (float)timeDomainMaxDelay)) {
+                spliceHeadDelay = findSpliceDelay (numChannels, delayLine.wrap (position + sample),
+                                                   activeHeadDelay, drift);
+                crossfadePosition = 0;
+            }
+
+            delays[sample * numHeads] = activeHeadDelay;
+            if (crossfadePosition < 0) {
+                delays[sample * numHeads + 1] = activeHeadDelay;
+                gains[sample] = 0.0f;
+            } else {
+                delays[sample * numHeads + 1] = spliceHeadDelay;
+                gains[sample] = 0.5f - 0.5f * cosf (M_PI * (float)crossfadePosition / (float)timeDomainCrossfadeSamples);
+            }
+
+            activeHeadDelay += drift;
+            spliceHeadDelay += drift;
+
+            if (crossfadePosition >= 0 && ++crossfadePosition >= timeDomainCrossfadeSamples) {
+                activeHeadDelay = spliceHeadDelay;
+                crossfadePosition = -1;
+            }
+        }
+
+        delayLine.computeReadPositions (readPositions, delays, blockSamples, numHeads, position, timeDomainInterpolation);
+
+        for (int channel = 0; channel < numChannels; ++channel) {
+            float* channelData = buffer.getWritePointer (channel, start);
+            delayLine.read (channel, readPositions, heads, timeDomainInterpolation);
+
+            for (int sample = 0; sample < blockSamples; ++sample) {
+                const float* sampleHeads = heads + sample * readPositions.tapStride;
+                channelData[sample] = sampleHeads[0] + gains[sample] * (sampleHeads[1] - sampleHeads[0]);
+            }
+        }
+
+        delayLine.advance (blockSamples);
+    }
+}
+
+inline float PitchShiftDSP::findSpliceDelay (const int numChannels, const int position,
+                                             const float delay, const float drift) const noexcept
+{
+    const int delaySamples = (int)delay;
+    const int minJump = timeDomainWindowSamples / 4;
+    const int firstCandidate = (drift < 0.0f) ? delaySamples + minJump : timeDomainMinDelay;
+    const int lastCandidate = (drift < 0.0f) ? timeDomainMaxDelay : delaySamples - minJump;
+
+    // Compares the crossfade length of history before each head, on all the channels
+    const int length = timeDomainCrossfadeSamples;
+
+    int bestCandidate = (firstCandidate + lastCandidate) / 2;
+    float bestScore = 0.0f;
+
+    for (int candidate = firstCandidate; candidate <= lastCandidate; ++candidate) {
+        float correlation = 0.0f;
+        float energy = 0.0f;
+
+        for (int channel = 0; channel < numChannels; ++channel) {
+            const float* data = delayLine.getReadPointer (channel);
+            for (int i = 1; i <= length; ++i) {
+                const float active = data[delayLine.wrap (position - delaySamples - i)];
+                const float splice = data[delayLine.wrap (position - candidate - i)];
+                correlation += active * splice;
+                energy += splice * splice;
+            }
+        }
+
+        // Normalised by the energy of the candidate only, the one of the active head
+        // being the same for all of them
+        const float score = (correlation > 0.0f) ? correlation * correlation / (energy + 1e-20f) : 0.0f;
+        if (score > bestScore) {
+            bestScore = score;
+            bestCandidate = candidate;
+        }
+    }
+
+    return (float)bestCandidate + (delay - (float)delaySamples);
+}
+
+//==============================================================================
+
+inline void PitchShiftDSP::PhaseVocoder::setNumVoices (const int newNumVoices)
+{
+    const int clampedNumVoices = jlimit (1, (int)maxNumVoices, newNumVoices);
+
+    // The output phases of a voice that was not synthesised are stale
+    for (int voice = numVoices; voice < clampedNumVoices; ++voice)
+        voices[voice].needToResetPhases = true;
+
+    numVoices = clampedNumVoices;
+}
+
+inline void PitchShiftDSP::PhaseVocoder::updateShift (const int voice, const float newShift)
+{
+    Voice& v = voices[voice];
+    v.shift = newShift;
+    v.ratio = roundf (v.shift * (float)hopSize) / (float)hopSize;
+
+    const int newResampledLength = jmin ((int)floorf ((float)fftSize / v.ratio), outputBufferLength);
+    if (newResampledLength != v.resampledLength || v.resampling == nullptr) {
+        v.resampledLength = newResampledLength;
+        v.resampling = getResampling (v.resampledLength);
+    }
+}
+
+inline const PitchShiftDSP::PhaseVocoder::CachedResampling*
+PitchShiftDSP::PhaseVocoder::getResampling (const int length)
+{
+    ++resamplingCacheCounter;
+
+    CachedResampling* leastRecentlyUsed = &resamplingCache[0];
+    for (auto& cachedResampling : resamplingCache) {
+        if (cachedResampling.length == length && cachedResampling.windowType == windowType) {
+            cachedResampling.lastUsed = resamplingCacheCounter;
+            return &cachedResampling;
+        }
+        if (cachedResampling.lastUsed < leastRecentlyUsed->lastUsed)
+            leastRecentlyUsed = &cachedResampling;
+    }
+
+    float* window = leastRecentlyUsed->window;
+    fillWindow (window, length, windowType);
+    for (int index = 0; index < length; ++index)
+        window[index] = sqrtf (window[index]) * windowScaleFactor;
+
+    // Same arithmetic as reading the frame directly, so the output does not change
+    for (int index = 0; index < length; ++index) {
+        const float x = (float)index * (float)fftSize / (float)length;
+        const int ix = (int)floorf (x);
+        leastRecentlyUsed->indices1[index] = ix;
+        leastRecentlyUsed->indices2[index] = (ix + 1) % fftSize;
+        leastRecentlyUsed->fractions[index] = x - (float)ix;
+    }
+
+    leastRecentlyUsed->length = length;
+    leastRecentlyUsed->windowType = windowType;
+    leastRecentlyUsed->lastUsed = resamplingCacheCounter;
+    return leastRecentlyUsed;
+}
+
+inline int PitchShiftDSP::PhaseVocoder::getOutputBufferLength() const
+{
+    return (int)floorf ((float)fftSize / minShift);
+}
+
+inline void PitchShiftDSP::PhaseVocoder::updateFftSize (const int newFftSize)
+{
+    STFT::updateFftSize (newFftSize);
+
+    omega.realloc (numBins);
+    for (int index = 0; index < numBins; ++index)
+        omega[index] = 2.0f * M_PI * index / (float)fftSize;
+
+    inputPhase.clear();
+    inputPhase.setSize (numChannels, numBins);
+
+    channelScratch.clear();
+    for (int channel = 0; channel < numChannels; ++channel) {
+        ChannelScratch* scratch = channelScratch.add (new ChannelScratch());
+        scratch->fftBuffer.calloc (2 * fftSize);
+        scratch->advance.calloc (numBins);
+        scratch->analysedBins.calloc (numBins);
+    }
+
+    for (auto& voice : voices) {
+        voice.outputPhase.clear();
+        voice.outputPhase.setSize (numChannels, numBins);
+    }
+
+    for (auto& cachedResampling : resamplingCache) {
+        cachedResampling.window.realloc (outputBufferLength);
+        cachedResampling.window.clear (outputBufferLength);
+        cachedResampling.indices1.calloc (outputBufferLength);
+        cachedResampling.indices2.calloc (outputBufferLength);
+        cachedResampling.fractions.calloc (outputBufferLength);
+    }
+}
+
+inline void PitchShiftDSP::PhaseVocoder::updateWindow (const int newWindowType)
+{
+    STFT::updateWindow (newWindowType);
+
+    // windowScaleFactor is baked into the cached windows
+    for (auto& cachedResampling : resamplingCache) {
+        cachedResampling.length = 0;
+        cachedResampling.lastUsed = 0;
+    }
+    resamplingCacheCounter = 0;
+    for (auto& voice : voices)
+        voice.resampling = nullptr;
+}
+
+inline void PitchShiftDSP::PhaseVocoder::addMemoryFootprint (MemoryFootprint& footprint) const
+{
+    STFT::addMemoryFootprint (footprint);
+
+    footprint.add (MemoryFootprint::spectralBuffers, sizeof (float) * (size_t)numBins);
+    footprint.add (MemoryFootprint::spectralBuffers, inputPhase);
+    for (auto& voice : voices)
+        footprint.add (MemoryFootprint::spectralBuffers, voice.outputPhase);
+    footprint.add (MemoryFootprint::spectralBuffers, (size_t)channelScratch.size() * (sizeof (float) * (size_t)(2 * fftSize + numBins)
+                                                                                       + sizeof (dsp::Complex<float>) * (size_t)numBins));
+
+    // Every slot is allocated to the longest length
+    footprint.add (MemoryFootprint::windows, (size_t)numCachedResamplings * (size_t)outputBufferLength * 2 * (sizeof (float) + sizeof (int)));
+}
+
+inline void PitchShiftDSP::PhaseVocoder::processFrames()
+{
+    TRACE_SCOPE ("STFT frames");
+
+    // The channels only read the positions, and write their own rows of the buffers
+    currentInputBufferWritePosition = frameInputBufferWritePosition;
+    currentOutputBufferWritePosition = frameOutputBufferWritePosition;
+
+    // Resets the output phases of every channel, so it runs before any of them
+    for (int voice = 0; voice < numVoices; ++voice)
+        realignPhases (voice);
+
+   #if JUCE_IPP_AVAILABLE
+    // The IPP engine transforms in a buffer of the plan, so one channel at a time
+    const bool parallel = false;
+   #else
+    const bool parallel = parallelChannels;
+   #endif
+
+    if (parallel) {
+        parent.channelWorkers->forEachChannel (numChannels, [this] (const int channel) {
+            processFrame (channel);
+        });
+    } else {
+        for (int channel = 0; channel < numChannels; ++channel)
+            processFrame (channel);
+    }
+
+    publishFeatures();
+}
+
+inline void PitchShiftDSP::PhaseVocoder::processFrame (const int channel)
+{
+    ChannelScratch& scratch = *channelScratch.getUnchecked (channel);
+    float* frame = scratch.fftBuffer;
+    dsp::Complex<float>* frameBins = reinterpret_cast<dsp::Complex<float>*> (frame);
+
+    analysis (channel, frame);
+    fft->performRealOnlyForwardTransform (frame, true);
+    meterSpectrum (channel, frameBins);
+    extractFeatures (channel, frameBins);
+
+    float* channelInputPhase = inputPhase.getWritePointer (channel);
+    PhaseVocoderKernel::analyse (frameBins, channelInputPhase, scratch.advance, omega, hopSize, numBins);
+
+    const dsp::Complex<float>* bins = frameBins;
+    if (numVoices > 1) {
+        memcpy (scratch.analysedBins.getData(), frameBins, (size_t)numBins * sizeof (dsp::Complex<float>));
+        bins = scratch.analysedBins;
+    }
+
+    const float gain = 1.0f / (float)numVoices;
+    for (int voice = 0; voice < numVoices; ++voice) {
+        PhaseVocoderKernel::synthesise (bins, frameBins, channelInputPhase, scratch.advance,
+                                        voices[voice].outputPhase.getWritePointer (channel),
+                                        numBins, voices[voice].ratio);
+        fft->performRealOnlyInverseTransform (frame);
+        synthesiseVoice (channel, voice, gain, frame);
+    }
+}
+
+inline void PitchShiftDSP::PhaseVocoder::realignPhases (const int voice)
+{
+    Voice& v = voices[voice];
+    if (v.shift != parent.shifts[voice] || ! v.needToResetPhases)
+        return;
+
+    // Once the shift settles, the output phases of every channel are put back at the
+    // ratio times the input ones of the previous frame, the relation between the
+    // bins that a steady ratio keeps from the start
+    for (int channel = 0; channel < numChannels; ++channel) {
+        const float* channelInputPhase = inputPhase.getReadPointer (channel);
+        float* channelOutputPhase = v.outputPhase.getWritePointer (channel);
+        for (int index = 0; index < numBins; ++index)
+            channelOutputPhase[index] = channelInputPhase[index] * v.ratio;
+    }
+    v.needToResetPhases = false;
+}
+
+inline void PitchShiftDSP::PhaseVocoder::synthesiseVoice (const int channel, const int voice, const float gain,
+                                                         const float* frame)
+{
+    const Voice& v = voices[voice];
+    const CachedResampling& resampling = *v.resampling;
+    float* outputData = outputBuffer.getWritePointer (channel);
+
+    // The resampling, the window and the overlap-add in one pass over the tables,
+    // split where the output buffer wraps around
+    int outputBufferIndex = currentOutputBufferWritePosition;
+    for (int start = 0; start < v.resampledLength;) {
+        const int numSamples = jmin (v.resampledLength - start, outputBufferLength - outputBufferIndex);
+        const int* indices1 = resampling.indices1 + start;
+        const int* indices2 = resampling.indices2 + start;
+        const float* fractions = resampling.fractions + start;
+        const float* window = resampling.window + start;
+        float* output = outputData + outputBufferIndex;
+
+        for (int index = 0; index < numSamples; ++index) {
+            const float sample1 = frame[indices1[index]];
+            const float sample2 = frame[indices2[index]];
+            output[index] += (sample1 + fractions[index] * (sample2 - sample1)) * window[index] * gain;
+        }
+
+        start += numSamples;
+        outputBufferIndex += numSamples;
+        if (outputBufferIndex >= outputBufferLength)
+            outputBufferIndex = 0;
+    }
+}
+
+//==============================================================================
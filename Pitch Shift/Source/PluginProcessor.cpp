@@ -43,40 +43,43 @@ PitchShiftAudioProcessor::PitchShiftAudioProcessor():
     parameters (*this)
     , paramShift (parameters, "Shift", " Semitone(s)", -12.0f, 12.0f, 0.0f,
                   [this](float value){ return powf (2.0f, value / 12.0f); })
+    , paramMode (parameters, "Mode", modeItemsUI, modePhaseVocoder,
+                 [this](float value){ paramMode.setCurrentAndTargetValue (value); updateLatency(); return value; })
+    , paramVoices (parameters, "Voices", voicesItemsUI, 0)
+    , paramShift2 (parameters, "Shift 2", " Semitone(s)", -12.0f, 12.0f, 4.0f,
+                   [this](float value){ return powf (2.0f, value / 12.0f); })
+    , paramShift3 (parameters, "Shift 3", " Semitone(s)", -12.0f, 12.0f, 7.0f,
+                   [this](float value){ return powf (2.0f, value / 12.0f); })
     , paramFftSize (parameters, "FFT size", fftSizeItemsUI, fftSize512,
                     [this](float value){
-                        const ScopedLock sl (lock);
                         value = (float)(1 << ((int)value + 5));
-                        paramFftSize.setCurrentAndTargetValue (value);
-                        updateFftSize();
-                        updateHopSize();
-                        updateAnalysisWindow();
-                        updateWindowScaleFactor();
+                        setEngineParameter (PitchShiftDSP::parameterFftSize, value);
                         return value;
                     })
     , paramHopSize (parameters, "Hop size", hopSizeItemsUI, hopSize8,
                     [this](float value){
-                        const ScopedLock sl (lock);
                         value = (float)(1 << ((int)value + 1));
-                        paramHopSize.setCurrentAndTargetValue (value);
-                        updateFftSize();
-                        updateHopSize();
-                        updateAnalysisWindow();
-                        updateWindowScaleFactor();
+                        setEngineParameter (PitchShiftDSP::parameterOverlap, value);
                         return value;
                     })
     , paramWindowType (parameters, "Window type", windowTypeItemsUI, windowTypeHann,
                        [this](float value){
-                           const ScopedLock sl (lock);
-                           paramWindowType.setCurrentAndTargetValue (value);
-                           updateFftSize();
-                           updateHopSize();
-                           updateAnalysisWindow();
-                           updateWindowScaleFactor();
+                           setEngineParameter (PitchShiftDSP::parameterWindowType, value + STFT::windowTypeBartlett);
                            return value;
                        })
+    , paramParallelChannels (parameters, "Parallel channels", false)
+    , bypass (*this, parameters)
 {
     parameters.apvts.state = ValueTree (Identifier (getName().removeCharacters ("- ")));
+
+    // Each of these builds a new STFT engine
+    paramFftSize.deferCallback();
+    paramHopSize.deferCallback();
+    paramWindowType.deferCallback();
+
+    voiceShifts[0] = &paramShift;
+    voiceShifts[1] = &paramShift2;
+    voiceShifts[2] = &paramShift3;
 }
 
 PitchShiftAudioProcessor::~PitchShiftAudioProcessor()
@@ -87,24 +90,50 @@ PitchShiftAudioProcessor::~PitchShiftAudioProcessor()
 
 void PitchShiftAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
+    TRACE_INSTANCE_SCOPE ("prepareToPlay", this);
+
     const double smoothTime = 1e-3;
     paramShift.reset (sampleRate, smoothTime);
+    paramMode.reset (sampleRate, smoothTime);
+    paramVoices.reset (sampleRate, smoothTime);
+    paramShift2.reset (sampleRate, smoothTime);
+    paramShift3.reset (sampleRate, smoothTime);
     paramFftSize.reset (sampleRate, smoothTime);
     paramHopSize.reset (sampleRate, smoothTime);
     paramWindowType.reset (sampleRate, smoothTime);
+    paramParallelChannels.reset (sampleRate, smoothTime);
 
     //======================================
 
-    needToResetPhases = true;
+    parameters.flushDeferredCallbacks();
+
+    {
+        // In the order of the latencies that the deferred callbacks report
+        const ScopedLock lock (parameters.deferredCallbackLock);
+        pitchShift.setSpectrumMeter (&spectrumMeter);
+        pitchShift.setQualityReduction (isNonRealtime() ? -1 : 0);
+        pitchShift.prepare (sampleRate, getTotalNumInputChannels(), samplesPerBlock);
+        updateLatency();
+    }
+
+    profiler.prepare (sampleRate);
+    silenceDetector.prepare (sampleRate);
+    bypass.prepare (sampleRate, samplesPerBlock, 2 * (1 << (fftSize8192 + 5)));
 }
 
 void PitchShiftAudioProcessor::releaseResources()
 {
 }
 
+void PitchShiftAudioProcessor::reset()
+{
+    pitchShift.reset();
+}
+
 void PitchShiftAudioProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
 {
-    const ScopedLock sl (lock);
+    const ProcessBlockProfiler::ScopedMeasurement measurement (profiler, buffer.getNumSamples(), isNonRealtime());
+    TRACE_INSTANCE_SCOPE ("processBlock", this);
 
     ScopedNoDenormals noDenormals;
 
@@ -114,248 +143,67 @@ void PitchShiftAudioProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuff
 
     //======================================
 
-    int currentInputBufferWritePosition;
-    int currentOutputBufferWritePosition;
-    int currentOutputBufferReadPosition;
-    int currentSamplesSinceLastFFT;
-
-    float shift = paramShift.getNextValue();
-    float ratio = roundf (shift * (float)hopSize) / (float)hopSize;
-    int resampledLength = floorf ((float)fftSize / ratio);
-    HeapBlock<float> resampledOutput (resampledLength, true);
-    HeapBlock<float> synthesisWindow (resampledLength, true);
-    updateWindow (synthesisWindow, resampledLength);
-
-    for (int channel = 0; channel < numInputChannels; ++channel) {
-        float* channelData = buffer.getWritePointer (channel);
-
-        currentInputBufferWritePosition = inputBufferWritePosition;
-        currentOutputBufferWritePosition = outputBufferWritePosition;
-        currentOutputBufferReadPosition = outputBufferReadPosition;
-        currentSamplesSinceLastFFT = samplesSinceLastFFT;
-
-        for (int sample = 0; sample < numSamples; ++sample) {
-
-            //======================================
-
-            const float in = channelData[sample];
-            channelData[sample] = outputBuffer.getSample (channel, currentOutputBufferReadPosition);
-
-            //======================================
-
-            outputBuffer.setSample (channel, currentOutputBufferReadPosition, 0.0f);
-            if (++currentOutputBufferReadPosition >= outputBufferLength)
-                currentOutputBufferReadPosition = 0;
-
-            //======================================
-
-            inputBuffer.setSample (channel, currentInputBufferWritePosition, in);
-            if (++currentInputBufferWritePosition >= inputBufferLength)
-                currentInputBufferWritePosition = 0;
-
-            //======================================
-
-            if (++currentSamplesSinceLastFFT >= hopSize) {
-                currentSamplesSinceLastFFT = 0;
-
-                //======================================
+    parameters.applyDeferredValues();
+    parameters.applySnapshotMorph();
 
-                int inputBufferIndex = currentInputBufferWritePosition;
-                for (int index = 0; index < fftSize; ++index) {
-                    fftTimeDomain[index].real (sqrtf (fftWindow[index]) * inputBuffer.getSample (channel, inputBufferIndex));
-                    fftTimeDomain[index].imag (0.0f);
+    if (silenceDetector.skipBlock (*this, buffer))
+        return;
 
-                    if (++inputBufferIndex >= inputBufferLength)
-                        inputBufferIndex = 0;
-                }
+    if (bypass.begin (buffer))
+        return;
 
-                //======================================
-
-                fft->perform (fftTimeDomain, fftFrequencyDomain, false);
-
-                if (paramShift.isSmoothing())
-                    needToResetPhases = true;
-                if (shift == paramShift.getTargetValue() && needToResetPhases) {
-                    inputPhase.clear();
-                    outputPhase.clear();
-                    needToResetPhases = false;
-                }
-
-                for (int index = 0; index < fftSize; ++index) {
-                    float magnitude = abs (fftFrequencyDomain[index]);
-                    float phase = arg (fftFrequencyDomain[index]);
-
-                    float phaseDeviation = phase - inputPhase.getSample (channel, index) - omega[index] * (float)hopSize;
-                    float deltaPhi = omega[index] * hopSize + princArg (phaseDeviation);
-                    float newPhase = princArg (outputPhase.getSample (channel, index) + deltaPhi * ratio);
-
-                    inputPhase.setSample (channel, index, phase);
-                    outputPhase.setSample (channel, index, newPhase);
-                    fftFrequencyDomain[index] = std::polar (magnitude, newPhase);
-                }
-
-                fft->perform (fftFrequencyDomain, fftTimeDomain, true);
-
-                for (int index = 0; index < resampledLength; ++index) {
-                    float x = (float)index * (float)fftSize / (float)resampledLength;
-                    int ix = (int)floorf (x);
-                    float dx = x - (float)ix;
-
-                    float sample1 = fftTimeDomain[ix].real();
-                    float sample2 = fftTimeDomain[(ix + 1) % fftSize].real();
-                    resampledOutput[index] = sample1 + dx * (sample2 - sample1);
-                    resampledOutput[index] *= sqrtf (synthesisWindow[index]);
-                }
-
-                //======================================
-
-                int outputBufferIndex = currentOutputBufferWritePosition;
-                for (int index = 0; index < resampledLength; ++index) {
-                    float out = outputBuffer.getSample (channel, outputBufferIndex);
-                    out += resampledOutput[index] * windowScaleFactor;
-                    outputBuffer.setSample (channel, outputBufferIndex, out);
-
-                    if (++outputBufferIndex >= outputBufferLength)
-                        outputBufferIndex = 0;
-                }
-
-                //======================================
-
-                currentOutputBufferWritePosition += hopSize;
-                if (currentOutputBufferWritePosition >= outputBufferLength)
-                    currentOutputBufferWritePosition = 0;
-            }
-
-            //======================================
-        }
+    // A new reduction rebuilds the phase vocoder on the parameters' worker, and the
+    // STFT crossfades to it
+    const int mode = (int)paramMode.getTargetValue();
+    if (mode != modeTimeDomain) {
+        const int qualityReduction = isNonRealtime() ? -1 : profiler.getQualityReduction();
+        if (pitchShift.setQualityReduction (qualityReduction))
+            paramHopSize.retriggerDeferredCallback();
     }
 
-    inputBufferWritePosition = currentInputBufferWritePosition;
-    outputBufferWritePosition = currentOutputBufferWritePosition;
-    outputBufferReadPosition = currentOutputBufferReadPosition;
-    samplesSinceLastFFT = currentSamplesSinceLastFFT;
+    for (int voice = 0; voice < PitchShiftDSP::maxNumVoices; ++voice)
+        pitchShift.setParameter (PitchShiftDSP::parameterShift + voice, voiceShifts[voice]->getNextValue());
+    pitchShift.setParameter (PitchShiftDSP::parameterMode, (float)mode);
+    pitchShift.setParameter (PitchShiftDSP::parameterVoices, paramVoices.getTargetValue() + 1.0f);
+    pitchShift.setParameter (PitchShiftDSP::parameterParallelChannels, paramParallelChannels.getTargetValue());
+    pitchShift.process (buffer.getArrayOfWritePointers(), numInputChannels, numSamples);
 
     //======================================
 
     for (int channel = numInputChannels; channel < numOutputChannels; ++channel)
         buffer.clear (channel, 0, numSamples);
-}
-
-//==============================================================================
-
-void PitchShiftAudioProcessor::updateFftSize()
-{
-    fftSize = (int)paramFftSize.getTargetValue();
-    fft = std::make_unique<dsp::FFT>(log2 (fftSize));
-
-    inputBufferLength = fftSize;
-    inputBufferWritePosition = 0;
-    inputBuffer.clear();
-    inputBuffer.setSize (getTotalNumInputChannels(), inputBufferLength);
-
-    float maxRatio = powf (2.0f, paramShift.minValue / 12.0f);
-    outputBufferLength = (int)floorf ((float)fftSize / maxRatio);
-    outputBufferWritePosition = 0;
-    outputBufferReadPosition = 0;
-    outputBuffer.clear();
-    outputBuffer.setSize (getTotalNumInputChannels(), outputBufferLength);
-
-    fftWindow.realloc (fftSize);
-    fftWindow.clear (fftSize);
 
-    fftTimeDomain.realloc (fftSize);
-    fftTimeDomain.clear (fftSize);
-
-    fftFrequencyDomain.realloc (fftSize);
-    fftFrequencyDomain.clear (fftSize);
-
-    samplesSinceLastFFT = 0;
-
-    //======================================
-
-    omega.realloc (fftSize);
-    for (int index = 0; index < fftSize; ++index)
-        omega[index] = 2.0f * M_PI * index / (float)fftSize;
-
-    inputPhase.clear();
-    inputPhase.setSize (getTotalNumInputChannels(), outputBufferLength);
-
-    outputPhase.clear();
-    outputPhase.setSize (getTotalNumInputChannels(), outputBufferLength);
-}
-
-void PitchShiftAudioProcessor::updateHopSize()
-{
-    overlap = (int)paramHopSize.getTargetValue();
-    if (overlap != 0) {
-        hopSize = fftSize / overlap;
-        outputBufferWritePosition = hopSize % outputBufferLength;
-    }
+    bypass.end (buffer);
 }
 
-void PitchShiftAudioProcessor::updateAnalysisWindow()
-{
-    updateWindow (fftWindow, fftSize);
-}
-
-void PitchShiftAudioProcessor::updateWindow (const HeapBlock<float>& window, const int windowLength)
-{
-    switch ((int)paramWindowType.getTargetValue()) {
-        case windowTypeBartlett: {
-            for (int sample = 0; sample < windowLength; ++sample)
-                window[sample] = 1.0f - fabs (2.0f * (float)sample / (float)(windowLength - 1) - 1.0f);
-            break;
-        }
-        case windowTypeHann: {
-            for (int sample = 0; sample < windowLength; ++sample)
-                window[sample] = 0.5f - 0.5f * cosf (2.0f * M_PI * (float)sample / (float)(windowLength - 1));
-            break;
-        }
-        case windowTypeHamming: {
-            for (int sample = 0; sample < windowLength; ++sample)
-                window[sample] = 0.54f - 0.46f * cosf (2.0f * M_PI * (float)sample / (float)(windowLength - 1));
-            break;
-        }
-    }
-}
+//==============================================================================
 
-void PitchShiftAudioProcessor::updateWindowScaleFactor()
+void PitchShiftAudioProcessor::setEngineParameter (const int index, const float value)
 {
-    float windowSum = 0.0f;
-    for (int sample = 0; sample < fftSize; ++sample)
-        windowSum += fftWindow[sample];
-
-    windowScaleFactor = 0.0f;
-    if (overlap != 0 && windowSum != 0.0f)
-        windowScaleFactor = 1.0f / (float)overlap / windowSum * (float)fftSize;
+    pitchShift.setParameter (index, value);
+    updateLatency();
 }
 
-float PitchShiftAudioProcessor::princArg (const float phase)
+void PitchShiftAudioProcessor::updateLatency()
 {
-    if (phase >= 0.0f)
-        return fmod (phase + M_PI,  2.0f * M_PI) - M_PI;
-    else
-        return fmod (phase + M_PI, -2.0f * M_PI) + M_PI;
+    setLatencySamples (pitchShift.getLatencySamples ((int)paramMode.getTargetValue()));
 }
 
-//==============================================================================
-
-
-
-
-
-
 //==============================================================================
 
 void PitchShiftAudioProcessor::getStateInformation (MemoryBlock& destData)
 {
-    auto state = parameters.apvts.copyState();
-    std::unique_ptr<XmlElement> xml (state.createXml());
-    copyXmlToBinary (*xml, destData);
+    MemoryOutputStream stream (destData, false);
+    parameters.writeState (stream);
 }
 
 void PitchShiftAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
+    MemoryInputStream stream (data, (size_t)sizeInBytes, false);
+    if (parameters.readState (stream))
+        return;
+
+    // Sessions saved in the XML format of older versions
     std::unique_ptr<XmlElement> xmlState (getXmlFromBinary (data, sizeInBytes));
 
     if (xmlState.get() != nullptr)
@@ -384,10 +232,9 @@ bool PitchShiftAudioProcessor::isBusesLayoutSupported (const BusesLayout& layout
     ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    if (layouts.getMainOutputChannelSet() != AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != AudioChannelSet::stereo())
+    // The channels are processed independently, so any layout with at least one
+    // channel is supported, from mono to surround sets or ambisonic stems.
+    if (layouts.getMainOutputChannelSet().isDisabled())
         return false;
 
     // This checks if the input layout matches the output layout
@@ -437,7 +284,19 @@ bool PitchShiftAudioProcessor::isMidiEffect() const
 
 double PitchShiftAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    const double sampleRate = jmax (1.0, getSampleRate());
+
+    if ((int)paramMode.getTargetValue() == modeTimeDomain)
+        return (double)pitchShift.getTimeDomainMaxDelay() / sampleRate;
+
+    // Past the latency, the last frame that saw the input still has to be overlapped,
+    // and one octave down it is resampled to twice its length
+    return 2.0 * (double)pitchShift.getFftSize() / sampleRate;
+}
+
+AudioProcessorParameter* PitchShiftAudioProcessor::getBypassParameter() const
+{
+    return bypass.getParameter();
 }
 
 //==============================================================================
@@ -468,6 +327,26 @@ void PitchShiftAudioProcessor::changeProgramName (int index, const String& newNa
 
 //==============================================================================
 
+MemoryFootprint PitchShiftAudioProcessor::getMemoryFootprint() const
+{
+    const ScopedLock lock (parameters.deferredCallbackLock);
+
+    MemoryFootprint footprint;
+    footprint.add (MemoryFootprint::other, sizeof (*this));
+    bypass.addMemoryFootprint (footprint);
+
+    pitchShift.addMemoryFootprint (footprint);
+
+    return footprint;
+}
+
+void PitchShiftAudioProcessor::trimMemory()
+{
+    pitchShift.trimMemory();
+}
+
+//==============================================================================
+
 // This creates new instances of the plugin..
 AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
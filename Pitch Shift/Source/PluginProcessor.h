@@ -30,10 +30,15 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "PluginParameter.h"
+#include "ProcessBlockProfiler.h"
+#include "SilenceDetector.h"
+#include "PluginBypass.h"
+#include "MemoryFootprint.h"
+#include "PitchShiftDSP.h"
 
 //==============================================================================
 
-class PitchShiftAudioProcessor : public AudioProcessor
+class PitchShiftAudioProcessor : public AudioProcessor, public MemoryFootprintSource
 {
 public:
     //==============================================================================
@@ -45,6 +50,7 @@ public:
 
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
+    void reset() override;
     void processBlock (AudioSampleBuffer&, MidiBuffer&) override;
 
     //==============================================================================
@@ -78,6 +84,7 @@ public:
     bool producesMidi() const override;
     bool isMidiEffect () const override;
     double getTailLengthSeconds() const override;
+    AudioProcessorParameter* getBypassParameter() const override;
 
     //==============================================================================
 
@@ -89,12 +96,32 @@ public:
 
     //==============================================================================
 
+    MemoryFootprint getMemoryFootprint() const override;
 
+    /** Frees the engine that the last change of the FFT settings retired. */
+    void trimMemory() override;
 
+    //==============================================================================
 
+    StringArray modeItemsUI = {
+        "Phase vocoder",
+        "Time domain",
+    };
 
+    enum modeIndex {
+        modePhaseVocoder = PitchShiftDSP::modePhaseVocoder,
+        modeTimeDomain = PitchShiftDSP::modeTimeDomain,
+    };
 
-    //==============================================================================
+    //======================================
+
+    StringArray voicesItemsUI = {
+        "1",
+        "2",
+        "3",
+    };
+
+    //======================================
 
     StringArray fftSizeItemsUI = {
         "32",
@@ -150,55 +177,43 @@ public:
 
     //======================================
 
-    void updateFftSize();
-    void updateHopSize();
-    void updateAnalysisWindow();
-    void updateWindow (const HeapBlock<float>& window, const int windowLength);
-    void updateWindowScaleFactor();
+    /** Hands a setting of the phase vocoder to the core, which builds a new one,
+        and reports the latency. The FFT size, hop size and window type callbacks are
+        deferred to the parameters' background worker.
+    */
+    void setEngineParameter (const int index, const float value);
+    void updateLatency();
 
-    float princArg (const float phase);
+    PitchShiftDSP pitchShift;
 
     //======================================
 
-    CriticalSection lock;
-
-    int fftSize;
-    std::unique_ptr<dsp::FFT> fft;
-
-    int inputBufferLength;
-    int inputBufferWritePosition;
-    AudioSampleBuffer inputBuffer;
-
-    int outputBufferLength;
-    int outputBufferWritePosition;
-    int outputBufferReadPosition;
-    AudioSampleBuffer outputBuffer;
-
-    HeapBlock<float> fftWindow;
-    HeapBlock<dsp::Complex<float>> fftTimeDomain;
-    HeapBlock<dsp::Complex<float>> fftFrequencyDomain;
-
-    int samplesSinceLastFFT;
-
-    int overlap;
-    int hopSize;
-    float windowScaleFactor;
+    // Input spectrum for the editor, from the frames of every STFT engine
+    MeterSource<SpectrumFrame> spectrumMeter;
 
     //======================================
 
-    HeapBlock<float> omega;
-    AudioSampleBuffer inputPhase;
-    AudioSampleBuffer outputPhase;
-    bool needToResetPhases;
+    ProcessBlockProfiler profiler;
+    SilenceDetector silenceDetector;
 
     //======================================
 
     PluginParametersManager parameters;
 
     PluginParameterLinSlider paramShift;
+    PluginParameterComboBox paramMode;
+    PluginParameterComboBox paramVoices;
+    PluginParameterLinSlider paramShift2;
+    PluginParameterLinSlider paramShift3;
+
+    // The shift of every phase vocoder voice, paramShift being the one of the first
+    PluginParameterLinSlider* voiceShifts[PitchShiftDSP::maxNumVoices];
     PluginParameterComboBox paramFftSize;
     PluginParameterComboBox paramHopSize;
     PluginParameterComboBox paramWindowType;
+    PluginParameterToggle paramParallelChannels;
+
+    PluginBypass bypass;
 
 private:
     //==============================================================================
@@ -0,0 +1,1064 @@
+/*
+ ==============================================================================
+
+ Code by Juan Gil <https://juangil.com/>.
+ Copyright (C) 2017-2020 Juan Gil.
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "MeteringFifo.h"
+#include "MemoryFootprint.h"
+#include "SpectralFeatures.h"
+#include "RealtimeSafety.h"
+#include "TraceMarkers.h"
+#include <atomic>
+#include <map>
+#include <tuple>
+
+//==============================================================================
+
+/** Short-time Fourier transform engine shared by the spectral effects.
+
+    Every frame is transformed with a real-only FFT, so subclasses only see the
+    fftSize / 2 + 1 non-negative frequency bins in frequencyDomainBuffer. The
+    negative frequencies are implied by the conjugate symmetry of a real signal
+    and are never stored or mirrored by hand. Modifications that treat every bin
+    the same way can take them as separate arrays instead, from getSpectralFrame().
+
+    The output trails the input by getLatencySamples() samples: a whole frame, or
+    only two hops in the low latency mode, see updateAsymmetricWindows().
+
+    With the worker thread mode the frames are processed on a thread of their own,
+    for one more hop of latency. The audio thread then only copies the samples in
+    and out of the ring buffers, so every block costs about the same, instead of
+    the blocks that cross a hop taking all the transforms of all the channels.
+*/
+class STFT
+{
+public:
+    enum windowTypeIndex {
+        windowTypeRectangular = 0,
+        windowTypeBartlett,
+        windowTypeHann,
+        windowTypeHamming,
+    };
+
+    //======================================
+
+    /** With useSynthesisWindow the square root of the window is applied both
+        before the analysis and after the synthesis, instead of only once before
+        the analysis.
+    */
+    STFT (const bool useSynthesisWindow = false)
+        : numChannels (1)
+        , synthesisWindowEnabled (useSynthesisWindow)
+        , lowLatencyEnabled (false)
+        , workerThreadEnabled (false)
+        , synthesisLength (0)
+        , framesLaunched (false)
+    {
+    }
+
+    virtual ~STFT()
+    {
+        jassert (frameWorker == nullptr);   // see stopFrameWorker()
+    }
+
+    //======================================
+
+    void setup (const int numInputChannels)
+    {
+        numChannels = (numInputChannels > 0) ? numInputChannels : 1;
+    }
+
+    /** With lowLatency the frames are analysed with the same fftSize, but only their
+        last two hops are synthesised, which is also the latency, as long as the hop
+        is at most a quarter of the window. With workerThread the frames are processed
+        on a thread started here, one hop later. Subclasses that use it must only read
+        state of their own from modification() and synthesis().
+    */
+    void updateParameters (const int newFftSize, const int newOverlap, const int newWindowType,
+                           const bool lowLatency = false, const bool workerThread = false)
+    {
+        stopFrameWorker();
+
+        lowLatencyEnabled = lowLatency;
+        workerThreadEnabled = workerThread;
+        updateFftSize (newFftSize);
+        updateHopSize (newOverlap);
+        updateWindow (newWindowType);
+
+        float analysisWindowSum = 0.0f;
+        for (int sample = 0; sample < fftSize; ++sample)
+            analysisWindowSum += analysisWindow[sample];
+        const float powerScale = (analysisWindowSum > 0.0f) ? 4.0f / (analysisWindowSum * analysisWindowSum) : 0.0f;
+        spectrumReducer.prepare (numBins, powerScale);
+        featureExtractor.prepare (numBins, powerScale);
+
+        channelFeatures.calloc (numChannels);
+        channelFeaturesReady.calloc (numChannels);
+
+        if (workerThreadEnabled) {
+            frameWorker = std::make_unique<FrameWorker> (*this);
+            frameWorker->startThread (10);
+        }
+    }
+
+    /** Has to be called before deleting a subclass that uses the worker thread, so
+        that no frame is still running in it. DoubleBufferedSTFT does it.
+    */
+    void stopFrameWorker()
+    {
+        frameWorker.reset();
+        framesLaunched = false;
+    }
+
+    /** Gets the power spectrum of the analysis frames of the first channel while it
+        is active. To be set before the engine processes any block.
+    */
+    void setSpectrumMeter (MeterSource<SpectrumFrame>* newSpectrumMeter)
+    {
+        spectrumMeter = newSpectrumMeter;
+    }
+
+    /** Streams the features of the analysis frames of every channel while the stream
+        is enabled, once a hop. To be set before the engine processes any block, the
+        engine fading out for another is stopped by DoubleBufferedSTFT.
+    */
+    void setFeatureStream (SpectralFeatureStream* newFeatureStream) noexcept
+    {
+        featureStream.store (newFeatureStream, std::memory_order_release);
+    }
+
+    /** Clears the input and output ring buffers, after the frames on the worker
+        thread are done, so no earlier input reaches the output. Real-time safe.
+    */
+    void reset() noexcept
+    {
+        if (framesLaunched) {
+            frameWorker->finish();
+            framesLaunched = false;
+        }
+
+        // The rings are written through inputChannels and outputChannels, which
+        // AudioBuffer::clear() does not know about once it has flagged them clear
+        for (int channel = 0; channel < numChannels; ++channel) {
+            FloatVectorOperations::clear (inputChannels[channel], inputBufferLength);
+            FloatVectorOperations::clear (outputChannels[channel], outputBufferLength);
+        }
+    }
+
+    /** The ring buffers, frame and windows of the engine, with its FFT plan and the
+        window it shares. Engines with buffers of their own add them after these.
+    */
+    virtual void addMemoryFootprint (MemoryFootprint& footprint) const
+    {
+        footprint.add (MemoryFootprint::spectralBuffers, inputBuffer);
+        footprint.add (MemoryFootprint::spectralBuffers, outputBuffer);
+        footprint.add (MemoryFootprint::spectralBuffers, sizeof (float) * (size_t)(2 * fftSize + 2 * numBins));
+        footprint.add (MemoryFootprint::spectralBuffers, (sizeof (SpectralFeatureFrame) + sizeof (bool)) * (size_t)numChannels);
+
+        footprint.add (MemoryFootprint::windows, sizeof (float) * (size_t)fftSize);
+        if (lowLatencyAnalysisWindow != nullptr)
+            footprint.add (MemoryFootprint::windows, sizeof (float) * (size_t)fftSize);
+        if (window != nullptr)
+            footprint.add (MemoryFootprint::windows, sizeof (float) * (size_t)synthesisLength);
+
+        if (fft != nullptr)
+            footprint.addFftPlan (fftSize);
+    }
+
+    /** Samples from an input sample to its output, to report to the host. */
+    int getLatencySamples() const noexcept
+    {
+        return synthesisLength + (workerThreadEnabled ? hopSize : 0);
+    }
+
+    //======================================
+
+    /** The block is split where the hops end. The samples of every part are copied
+        in and out of the ring buffers in bulk, then the frames are processed, or
+        handed to the worker thread, if the part ends a hop.
+    */
+    void processBlock (AudioSampleBuffer& block)
+    {
+        numSamples = block.getNumSamples();
+
+        for (int start = 0; start < numSamples;) {
+            const int segmentSamples = jmin (numSamples - start, hopSize - samplesSinceLastFFT);
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                transferSamples (channel, block.getWritePointer (channel, start), segmentSamples);
+
+            inputBufferWritePosition = (inputBufferWritePosition + segmentSamples) % inputBufferLength;
+            outputBufferReadPosition = (outputBufferReadPosition + segmentSamples) % outputBufferLength;
+            samplesSinceLastFFT += segmentSamples;
+            start += segmentSamples;
+
+            if (samplesSinceLastFFT >= hopSize) {
+                samplesSinceLastFFT = 0;
+
+                if (framesLaunched)
+                    frameWorker->finish();
+
+                frameInputBufferWritePosition = inputBufferWritePosition;
+                frameOutputBufferWritePosition = outputBufferWritePosition;
+                outputBufferWritePosition = (outputBufferWritePosition + hopSize) % outputBufferLength;
+
+                if (frameWorker != nullptr) {
+                    frameWorker->launch();
+                    framesLaunched = true;
+                } else {
+                    processFrames();
+                }
+            }
+        }
+    }
+
+    //======================================
+
+    static void fillWindow (float* window, const int windowLength, const int windowType)
+    {
+        switch (windowType) {
+            case windowTypeRectangular: {
+                for (int sample = 0; sample < windowLength; ++sample)
+                    window[sample] = 1.0f;
+                break;
+            }
+            case windowTypeBartlett: {
+                for (int sample = 0; sample < windowLength; ++sample)
+                    window[sample] = 1.0f - fabs (2.0f * (float)sample / (float)(windowLength - 1) - 1.0f);
+                break;
+            }
+            case windowTypeHann: {
+                for (int sample = 0; sample < windowLength; ++sample)
+                    window[sample] = 0.5f - 0.5f * cosf (2.0f * M_PI * (float)sample / (float)(windowLength - 1));
+                break;
+            }
+            case windowTypeHamming: {
+                for (int sample = 0; sample < windowLength; ++sample)
+                    window[sample] = 0.54f - 0.46f * cosf (2.0f * M_PI * (float)sample / (float)(windowLength - 1));
+                break;
+            }
+        }
+    }
+
+    //======================================
+
+    /** FFT plans and windows shared by all the STFT instances of the process, through
+        a SharedResourcePointer. Each one is built the first time it is asked for and
+        freed with its last user, so a session with many spectral effects of the same
+        settings computes and keeps a single copy of them. The requests come from
+        updateParameters(), never from the audio thread, so they can take the lock.
+
+        The plans are only used through the const transforms of dsp::FFT, which keep
+        their scratch space on the stack with the engines a default build uses.
+    */
+    class SharedTables
+    {
+    public:
+        struct Window
+        {
+            HeapBlock<float> samples;
+            float sum;  // of the window before any square root
+        };
+
+        std::shared_ptr<const dsp::FFT> getFFT (const int order)
+        {
+           #if JUCE_IPP_AVAILABLE
+            // The IPP engine works in a buffer of the plan, so it cannot be shared
+            return std::make_shared<dsp::FFT> (order);
+           #else
+            const ScopedLock lock (tablesLock);
+
+            std::weak_ptr<const dsp::FFT>& entry = fftPlans[order];
+            std::shared_ptr<const dsp::FFT> plan = entry.lock();
+            if (plan == nullptr) {
+                plan = std::make_shared<dsp::FFT> (order);
+                entry = plan;
+            }
+            return plan;
+           #endif
+        }
+
+        /** windowLength samples of fillWindow(), or of their square root. */
+        std::shared_ptr<const Window> getWindow (const int windowLength, const int windowType, const bool squareRoot)
+        {
+            const ScopedLock lock (tablesLock);
+
+            std::weak_ptr<const Window>& entry = windows[std::make_tuple (windowLength, windowType, squareRoot)];
+            std::shared_ptr<const Window> window = entry.lock();
+            if (window == nullptr) {
+                auto newWindow = std::make_shared<Window>();
+                newWindow->samples.malloc (windowLength);
+                fillWindow (newWindow->samples, windowLength, windowType);
+
+                newWindow->sum = 0.0f;
+                for (int sample = 0; sample < windowLength; ++sample) {
+                    newWindow->sum += newWindow->samples[sample];
+                    if (squareRoot)
+                        newWindow->samples[sample] = sqrtf (newWindow->samples[sample]);
+                }
+
+                window = newWindow;
+                entry = window;
+            }
+            return window;
+        }
+
+    private:
+        CriticalSection tablesLock;
+        std::map<int, std::weak_ptr<const dsp::FFT>> fftPlans;
+        std::map<std::tuple<int, int, bool>, std::weak_ptr<const Window>> windows;
+    };
+
+    //======================================
+
+    /** Spectrum of a frame in structure-of-arrays form: either the real and the
+        imaginary parts, or the magnitudes and the phases, of the numBins bins in
+        two separate arrays, aligned to alignmentBytes. The frame converts between
+        both forms only when a modification asks for the other one, and every loop
+        runs over contiguous floats, so the compiler can vectorise it.
+    */
+    class SpectralFrame
+    {
+    public:
+        enum { alignmentBytes = 32 };
+
+        int getNumBins() const noexcept { return numBins; }
+        bool isPolar() const noexcept { return polar; }
+
+        float* getReal() noexcept { toCartesian(); return first; }
+        float* getImag() noexcept { toCartesian(); return second; }
+        float* getMagnitude() noexcept { toPolar(); return first; }
+        float* getPhase() noexcept { toPolar(); return second; }
+
+        /** Not to be called from the audio thread. */
+        void prepare (const int newNumBins)
+        {
+            numBins = newNumBins;
+
+            // Each array is padded to a whole number of alignment blocks
+            const int floatsPerBlock = (int)alignmentBytes / (int)sizeof (float);
+            const int paddedBins = (numBins + floatsPerBlock - 1) / floatsPerBlock * floatsPerBlock;
+            storage.calloc (2 * paddedBins + floatsPerBlock);
+
+            const pointer_sized_int address = reinterpret_cast<pointer_sized_int> (storage.getData());
+            first = reinterpret_cast<float*> ((address + alignmentBytes - 1) & ~(pointer_sized_int)(alignmentBytes - 1));
+            second = first + paddedBins;
+            polar = false;
+        }
+
+        /** Splits the interleaved bins of a real-only transform into the real and the
+            imaginary arrays.
+        */
+        void load (const dsp::Complex<float>* bins) noexcept
+        {
+            const float* interleaved = reinterpret_cast<const float*> (bins);
+            for (int bin = 0; bin < numBins; ++bin) {
+                first[bin] = interleaved[2 * bin];
+                second[bin] = interleaved[2 * bin + 1];
+            }
+            polar = false;
+        }
+
+        /** Interleaves the bins back, from the polar form if the frame is in it. */
+        void store (dsp::Complex<float>* bins) noexcept
+        {
+            toCartesian();
+
+            float* interleaved = reinterpret_cast<float*> (bins);
+            for (int bin = 0; bin < numBins; ++bin) {
+                interleaved[2 * bin] = first[bin];
+                interleaved[2 * bin + 1] = second[bin];
+            }
+        }
+
+    private:
+        void toPolar() noexcept
+        {
+            if (polar)
+                return;
+
+            for (int bin = 0; bin < numBins; ++bin) {
+                const float real = first[bin];
+                const float imag = second[bin];
+                first[bin] = std::sqrt (real * real + imag * imag);
+                second[bin] = std::atan2 (imag, real);
+            }
+            polar = true;
+        }
+
+        void toCartesian() noexcept
+        {
+            if (! polar)
+                return;
+
+            for (int bin = 0; bin < numBins; ++bin) {
+                const float magnitude = first[bin];
+                const float phase = second[bin];
+                first[bin] = magnitude * std::cos (phase);
+                second[bin] = magnitude * std::sin (phase);
+            }
+            polar = false;
+        }
+
+        HeapBlock<float> storage;
+        float* first = nullptr;
+        float* second = nullptr;
+        int numBins = 0;
+        bool polar = false;
+    };
+
+protected:
+    //======================================
+
+    virtual int getOutputBufferLength() const
+    {
+        return fftSize;
+    }
+
+    virtual void updateFftSize (const int newFftSize)
+    {
+        fftSize = newFftSize;
+        numBins = fftSize / 2 + 1;
+        fft = sharedTables->getFFT ((int)log2 (fftSize));
+
+        // With the worker thread, the audio thread writes the next hop of input while
+        // the last frame is analysed, and reads the last hop of output while the next
+        // one is overlap-added, so both need room for them. Any hop is at most half
+        // the frame.
+        inputBufferLength = workerThreadEnabled ? 2 * fftSize : fftSize;
+        inputBuffer.clear();
+        inputBuffer.setSize (numChannels, inputBufferLength);
+
+        outputBufferLength = getOutputBufferLength() + (workerThreadEnabled ? fftSize : 0);
+        outputBuffer.clear();
+        outputBuffer.setSize (numChannels, outputBufferLength);
+
+        inputChannels = inputBuffer.getArrayOfWritePointers();
+        outputChannels = outputBuffer.getArrayOfWritePointers();
+
+        synthesisWindow.realloc (fftSize);
+        synthesisWindow.clear (fftSize);
+
+        // The real-only transforms work in place on 2 * fftSize floats: the first
+        // fftSize are the time domain frame, the spectrum is numBins interleaved
+        // complex values over the same memory.
+        fftBuffer.realloc (2 * fftSize);
+        fftBuffer.clear (2 * fftSize);
+        timeDomainBuffer = fftBuffer.getData();
+        frequencyDomainBuffer = reinterpret_cast<dsp::Complex<float>*> (fftBuffer.getData());
+        spectralFrame.prepare (numBins);
+        spectralFrameLoaded = false;
+
+        inputBufferWritePosition = 0;
+        outputBufferWritePosition = 0;
+        outputBufferReadPosition = 0;
+        samplesSinceLastFFT = 0;
+    }
+
+    virtual void updateHopSize (const int newOverlap)
+    {
+        overlap = newOverlap;
+        if (overlap != 0) {
+            hopSize = fftSize / overlap;
+            outputBufferWritePosition = (workerThreadEnabled ? 2 * hopSize : hopSize) % outputBufferLength;
+        }
+    }
+
+    virtual void updateWindow (const int newWindowType)
+    {
+        windowType = newWindowType;
+
+        synthesisLength = (lowLatencyEnabled && 2 * hopSize < fftSize) ? 2 * hopSize : fftSize;
+        if (synthesisLength < fftSize) {
+            updateAsymmetricWindows();
+            return;
+        }
+
+        lowLatencyAnalysisWindow.free();
+        window = sharedTables->getWindow (fftSize, windowType, synthesisWindowEnabled);
+        analysisWindow = window->samples;
+
+        windowScaleFactor = 0.0f;
+        if (overlap != 0 && window->sum != 0.0f)
+            windowScaleFactor = 1.0f / (float)overlap / window->sum * (float)fftSize;
+
+        if (synthesisWindowEnabled)
+            FloatVectorOperations::multiply (synthesisWindow.getData(), analysisWindow, windowScaleFactor, fftSize);
+        else
+            FloatVectorOperations::fill (synthesisWindow.getData(), windowScaleFactor, fftSize);
+    }
+
+    /** Low latency windows, after Mauler and Martin. The analysis window still spans
+        the whole frame, for the same frequency resolution, but it rises over most of
+        it and falls over the last half of the synthesis length only. The synthesis
+        window is zero but for the last synthesisLength samples, where the product of
+        both windows is the chosen window, of synthesisLength samples. Only that part
+        of every frame is overlap-added, so the latency is synthesisLength.
+    */
+    void updateAsymmetricWindows()
+    {
+        const int synthesisStart = fftSize - synthesisLength;
+        const int fallStart = fftSize - synthesisLength / 2;
+
+        // The product of both windows, over the last synthesisLength samples
+        window = sharedTables->getWindow (synthesisLength, windowType, false);
+        const float* productWindow = window->samples;
+
+        windowScaleFactor = 0.0f;
+        if (window->sum != 0.0f)
+            windowScaleFactor = (float)hopSize / window->sum;
+
+        // Square root of the rising half of a Hann window, then of the falling half
+        // of the product window. Only this instance has it, as it depends on the hop.
+        lowLatencyAnalysisWindow.realloc (fftSize);
+        for (int sample = 0; sample < fallStart; ++sample)
+            lowLatencyAnalysisWindow[sample] = sinf (0.5f * M_PI * (float)sample / (float)fallStart);
+        for (int sample = fallStart; sample < fftSize; ++sample)
+            lowLatencyAnalysisWindow[sample] = sqrtf (productWindow[sample - synthesisStart]);
+        analysisWindow = lowLatencyAnalysisWindow;
+
+        // With a hop of at most a quarter of the frame, synthesisStart is at least
+        // half of it, where the rising analysis window is far from zero
+        FloatVectorOperations::clear (synthesisWindow.getData(), synthesisStart);
+        for (int sample = synthesisStart; sample < fallStart; ++sample)
+            synthesisWindow[sample] = productWindow[sample - synthesisStart] / analysisWindow[sample] * windowScaleFactor;
+        for (int sample = fallStart; sample < fftSize; ++sample)
+            synthesisWindow[sample] = analysisWindow[sample] * windowScaleFactor;
+    }
+
+    //======================================
+
+    /** analysis -> modification -> synthesis of the frame that ends at
+        currentInputBufferWritePosition, overlap-added at currentOutputBufferWritePosition.
+        Overridden by engines that synthesise several frames from one analysis.
+    */
+    virtual void processFrame (const int channel)
+    {
+        analysis (channel);
+        fft->performRealOnlyForwardTransform (fftBuffer, true);
+        meterSpectrum (channel);
+        extractFeatures (channel);
+        modification (channel);
+        storeSpectralFrame();
+        fft->performRealOnlyInverseTransform (fftBuffer);
+        synthesis (channel);
+    }
+
+    void analysis (const int channel)
+    {
+        analysis (channel, timeDomainBuffer);
+    }
+
+    /** Windows the frame of the channel into frame, for engines that give every
+        channel a buffer of its own.
+    */
+    void analysis (const int channel, float* frame) const
+    {
+        int inputBufferIndex = currentInputBufferWritePosition + inputBufferLength - fftSize;
+        if (inputBufferIndex >= inputBufferLength)
+            inputBufferIndex -= inputBufferLength;
+
+        for (int index = 0; index < fftSize; ++index) {
+            frame[index] = analysisWindow[index] * inputBuffer.getSample (channel, inputBufferIndex);
+
+            if (++inputBufferIndex >= inputBufferLength)
+                inputBufferIndex = 0;
+        }
+    }
+
+    void meterSpectrum (const int channel)
+    {
+        meterSpectrum (channel, frequencyDomainBuffer);
+    }
+
+    void meterSpectrum (const int channel, const dsp::Complex<float>* bins)
+    {
+        if (channel == 0 && spectrumMeter != nullptr && spectrumMeter->isActive()) {
+            SpectrumFrame frame;
+            spectrumReducer.reduce (bins, frame);
+            spectrumMeter->add (frame);
+        }
+    }
+
+    void extractFeatures (const int channel)
+    {
+        extractFeatures (channel, frequencyDomainBuffer);
+    }
+
+    /** Fills the features of the channel from the bins of its analysis frame. Every
+        channel only writes its own, so the channels can run in parallel, and
+        publishFeatures() pushes them all once they are done.
+    */
+    void extractFeatures (const int channel, const dsp::Complex<float>* bins)
+    {
+        SpectralFeatureStream* stream = featureStream.load (std::memory_order_acquire);
+        if (stream == nullptr || ! stream->isEnabled())
+            return;
+
+        SpectralFeatureFrame& frame = channelFeatures[channel];
+        frame.frameIndex = featureFrameIndex;
+        frame.channel = channel;
+        frame.hopSize = hopSize;
+        featureExtractor.extract (bins, frame);
+        channelFeaturesReady[channel] = true;
+    }
+
+    /** Called once a hop after the frames of all the channels. */
+    void publishFeatures()
+    {
+        if (SpectralFeatureStream* stream = featureStream.load (std::memory_order_acquire)) {
+            for (int channel = 0; channel < numChannels; ++channel) {
+                if (channelFeaturesReady[channel]) {
+                    stream->push (channelFeatures[channel]);
+                    channelFeaturesReady[channel] = false;
+                }
+            }
+        }
+
+        ++featureFrameIndex;
+    }
+
+    /** Called for every frame once frequencyDomainBuffer holds its numBins bins. */
+    virtual void modification (const int channel)
+    {
+    }
+
+    /** The bins of the current frame as a SpectralFrame, for modification(). The
+        first call of a frame splits frequencyDomainBuffer into it, and processFrame()
+        interleaves it back after modification(), so a modification works either on
+        the frame or on frequencyDomainBuffer, not on both. Engines that override
+        processFrame() call storeSpectralFrame() themselves.
+    */
+    SpectralFrame& getSpectralFrame() noexcept
+    {
+        if (! spectralFrameLoaded) {
+            spectralFrame.load (frequencyDomainBuffer);
+            spectralFrameLoaded = true;
+        }
+        return spectralFrame;
+    }
+
+    void storeSpectralFrame() noexcept
+    {
+        if (spectralFrameLoaded) {
+            spectralFrame.store (frequencyDomainBuffer);
+            spectralFrameLoaded = false;
+        }
+    }
+
+    /** Overlap-adds the last synthesisLength samples of timeDomainBuffer into the
+        output buffer and moves on by one hop.
+    */
+    virtual void synthesis (const int channel)
+    {
+        synthesis (channel, timeDomainBuffer);
+        advanceOutputBufferWritePosition();
+    }
+
+    /** Overlap-adds the last synthesisLength samples of frame at
+        currentOutputBufferWritePosition, for engines that give every channel a
+        buffer of its own. The position is left where it is.
+    */
+    void synthesis (const int channel, const float* frame)
+    {
+        int outputBufferIndex = currentOutputBufferWritePosition;
+        for (int index = fftSize - synthesisLength; index < fftSize; ++index) {
+            float outputSample = outputBuffer.getSample (channel, outputBufferIndex);
+            outputSample += frame[index] * synthesisWindow[index];
+            outputBuffer.setSample (channel, outputBufferIndex, outputSample);
+
+            if (++outputBufferIndex >= outputBufferLength)
+                outputBufferIndex = 0;
+        }
+    }
+
+    void advanceOutputBufferWritePosition()
+    {
+        currentOutputBufferWritePosition += hopSize;
+        if (currentOutputBufferWritePosition >= outputBufferLength)
+            currentOutputBufferWritePosition -= outputBufferLength;
+    }
+
+    //======================================
+
+    /** Processes the frames of all the channels when the audio thread has launched
+        them, at the end of a hop. That is one hop before the first of their samples
+        is read, since in this mode the frames are overlap-added two hops ahead of the
+        read position. At the end of the next hop the audio thread waits for them, or
+        runs them itself if the worker has not started them yet.
+    */
+    class FrameWorker : public Thread
+    {
+    public:
+        FrameWorker (STFT& owner)
+            : Thread ("STFT frames")
+            , owner (owner)
+        {
+        }
+
+        ~FrameWorker()
+        {
+            signalThreadShouldExit();
+            wake.signal();
+            stopThread (-1);
+        }
+
+        void run() override
+        {
+            ScopedNoDenormals noDenormals;
+
+            while (! threadShouldExit()) {
+                wake.wait (-1);
+                if (launched.exchange (false, std::memory_order_acq_rel)) {
+                    const RealtimeSafety::ScopedRealtimeSection realtimeSection;
+                    owner.processFrames();
+                    done.store (true, std::memory_order_release);
+                }
+            }
+        }
+
+        void launch() noexcept
+        {
+            done.store (false, std::memory_order_relaxed);
+            launched.store (true, std::memory_order_release);
+
+            // Waking the worker locks its event for a moment
+            const RealtimeSafety::ScopedExemption exemption;
+            wake.signal();
+        }
+
+        /** Waits for the last launched frames, or runs them here if the worker has
+            not started them yet.
+        */
+        void finish() noexcept
+        {
+            if (launched.exchange (false, std::memory_order_acq_rel)) {
+                owner.processFrames();
+                return;
+            }
+
+            while (! done.load (std::memory_order_acquire))
+                Thread::yield();
+        }
+
+        WaitableEvent wake;
+
+    private:
+        STFT& owner;
+        std::atomic<bool> launched { false };
+        std::atomic<bool> done { false };
+    };
+
+    /** Overridden by engines that process the channels of a frame in parallel. */
+    virtual void processFrames()
+    {
+        TRACE_SCOPE ("STFT frames");
+        currentInputBufferWritePosition = frameInputBufferWritePosition;
+        for (int channel = 0; channel < numChannels; ++channel) {
+            currentOutputBufferWritePosition = frameOutputBufferWritePosition;
+            processFrame (channel);
+        }
+
+        publishFeatures();
+    }
+
+    /** Copies numSamplesToTransfer samples of channelData into the input ring buffer
+        and replaces them with as many from the output ring buffer, which are cleared
+        after them. The copies are split where either ring wraps.
+    */
+    void transferSamples (const int channel, float* channelData, const int numSamplesToTransfer)
+    {
+        float* inputData = inputChannels[channel];
+        float* outputData = outputChannels[channel];
+
+        int inputBufferIndex = inputBufferWritePosition;
+        int outputBufferIndex = outputBufferReadPosition;
+        for (int sample = 0; sample < numSamplesToTransfer;) {
+            const int count = jmin (numSamplesToTransfer - sample,
+                                    inputBufferLength - inputBufferIndex,
+                                    outputBufferLength - outputBufferIndex);
+
+            FloatVectorOperations::copy (inputData + inputBufferIndex, channelData + sample, count);
+            FloatVectorOperations::copy (channelData + sample, outputData + outputBufferIndex, count);
+            FloatVectorOperations::clear (outputData + outputBufferIndex, count);
+
+            if ((inputBufferIndex += count) >= inputBufferLength)
+                inputBufferIndex = 0;
+            if ((outputBufferIndex += count) >= outputBufferLength)
+                outputBufferIndex = 0;
+            sample += count;
+        }
+    }
+
+    //======================================
+    int numChannels;
+    int numSamples;
+
+    int fftSize;
+    int numBins;
+    SharedResourcePointer<SharedTables> sharedTables;
+    std::shared_ptr<const dsp::FFT> fft;
+
+    int inputBufferLength;
+    AudioSampleBuffer inputBuffer;
+
+    int outputBufferLength;
+    AudioSampleBuffer outputBuffer;
+
+    // Taken once in updateFftSize for the copies of processBlock, which then never
+    // touches the state of the buffers while the worker thread writes into them
+    float* const* inputChannels;
+    float* const* outputChannels;
+
+    const bool synthesisWindowEnabled;
+    bool lowLatencyEnabled;
+    bool workerThreadEnabled;
+    int synthesisLength;
+    int windowType;
+    std::shared_ptr<const SharedTables::Window> window;
+    const float* analysisWindow = nullptr;
+    HeapBlock<float> lowLatencyAnalysisWindow;
+    HeapBlock<float> synthesisWindow;
+
+    HeapBlock<float> fftBuffer;
+    float* timeDomainBuffer;
+    dsp::Complex<float>* frequencyDomainBuffer;
+    SpectralFrame spectralFrame;
+    bool spectralFrameLoaded = false;
+
+    int overlap;
+    int hopSize;
+    float windowScaleFactor;
+
+    int inputBufferWritePosition;
+    int outputBufferWritePosition;
+    int outputBufferReadPosition;
+    int samplesSinceLastFFT;
+
+    int currentInputBufferWritePosition;
+    int currentOutputBufferWritePosition;
+
+    MeterSource<SpectrumFrame>* spectrumMeter = nullptr;
+    SpectrumReducer spectrumReducer;
+
+    std::atomic<SpectralFeatureStream*> featureStream { nullptr };
+    SpectralFeatureExtractor featureExtractor;
+    HeapBlock<SpectralFeatureFrame> channelFeatures;
+    HeapBlock<bool> channelFeaturesReady;
+    uint32 featureFrameIndex = 0;
+
+    std::unique_ptr<FrameWorker> frameWorker;
+    bool framesLaunched;
+    int frameInputBufferWritePosition;
+    int frameOutputBufferWritePosition;
+};
+
+//==============================================================================
+
+/** Hands freshly configured engines from the message thread to the audio thread
+    without locks.
+
+    Reconfiguring an STFT reallocates its FFT plan and all its buffers, so instead
+    of touching the engine in use a complete new one is built and configured off
+    the audio thread, then published. At the start of the next block the audio
+    thread picks it up with one atomic exchange. The engine it replaces keeps
+    running on a copy of the input until the new one has filled its first frames,
+    then fades out over crossfadeTime, so that the switch does not click. After
+    that it is parked until the next publish, which deletes it on the publishing
+    thread, so the audio thread never blocks, allocates or frees.
+*/
+template <class EngineType>
+class DoubleBufferedSTFT
+{
+public:
+    static constexpr double crossfadeTime = 10e-3;
+
+    DoubleBufferedSTFT()
+        : active (nullptr)
+        , pending (nullptr)
+        , retired (nullptr)
+        , fadingOut (nullptr)
+    {
+    }
+
+    ~DoubleBufferedSTFT()
+    {
+        destroy (active);
+        destroy (fadingOut);
+        destroy (pending.exchange (nullptr));
+        destroy (retired.exchange (nullptr));
+    }
+
+    /** Makes room for the copy of the input of blocks of up to maxBlockSize samples,
+        that an engine fading out runs on. Not real-time safe.
+    */
+    void prepare (const int numChannels, const int maxBlockSize, const double sampleRate)
+    {
+        fadeBuffer.setSize (numChannels, jmax (1, maxBlockSize));
+        fadeSamples = jmax (1, roundToInt (crossfadeTime * sampleRate));
+    }
+
+    /** Takes ownership of a configured engine. Not to be called from the audio thread. */
+    void publish (EngineType* newEngine)
+    {
+        destroy (retired.exchange (nullptr));
+        destroy (pending.exchange (newEngine));
+        latest = newEngine;
+    }
+
+    /** The last engine published, the one parked since the last switch if there is
+        one, and the copy of the input for the crossfades. From the thread that
+        publishes, never at the same time as publish().
+    */
+    void addMemoryFootprint (MemoryFootprint& footprint) const
+    {
+        if (latest != nullptr)
+            latest->addMemoryFootprint (footprint);
+        if (EngineType* engine = retired.load())
+            engine->addMemoryFootprint (footprint);
+
+        footprint.add (MemoryFootprint::spectralBuffers, fadeBuffer);
+    }
+
+    /** Deletes the engine parked since the last switch, which the next publish()
+        would delete anyway. From the thread that publishes.
+    */
+    void trim()
+    {
+        destroy (retired.exchange (nullptr));
+    }
+
+    /** Called by the audio thread at the start of every block. Returns nullptr until
+        the first engine has been published.
+    */
+    EngineType* acquire() noexcept
+    {
+        if (fadingOut == nullptr && retired.load() == nullptr) {
+            if (EngineType* newEngine = pending.exchange (nullptr)) {
+                fadingOut = active;
+                active = newEngine;
+
+                // Only the new engine streams its features from now on
+                if (fadingOut != nullptr)
+                    fadingOut->setFeatureStream (nullptr);
+
+                // The first frames of the new engine only overlap partially
+                fadePosition = -newEngine->getLatencySamples();
+            }
+        }
+
+        return active;
+    }
+
+    /** Processes buffer with the active engine, and while another one fades out, also
+        processes a copy of the input with that one and crossfades the two. setUp
+        (engine) is called on every engine before it processes the block.
+    */
+    template <typename Function>
+    void processBlock (AudioSampleBuffer& buffer, Function&& setUp)
+    {
+        EngineType* engine = acquire();
+        if (engine == nullptr)
+            return;
+
+        const int numChannels = jmin (buffer.getNumChannels(), fadeBuffer.getNumChannels());
+        const int numSamples = buffer.getNumSamples();
+
+        // Without room for the copy of the input, the crossfade is cut short
+        if (fadingOut != nullptr && numSamples > fadeBuffer.getNumSamples())
+            finishFade();
+
+        if (fadingOut == nullptr) {
+            setUp (*engine);
+            engine->processBlock (buffer);
+            return;
+        }
+
+        AudioSampleBuffer fadeBlock (fadeBuffer.getArrayOfWritePointers(), numChannels, numSamples);
+        for (int channel = 0; channel < numChannels; ++channel)
+            fadeBlock.copyFrom (channel, 0, buffer, channel, 0, numSamples);
+
+        setUp (*fadingOut);
+        fadingOut->processBlock (fadeBlock);
+        setUp (*engine);
+        engine->processBlock (buffer);
+
+        const float fadeStep = 1.0f / (float)fadeSamples;
+        for (int channel = 0; channel < numChannels; ++channel) {
+            const float* previous = fadeBlock.getReadPointer (channel);
+            float* channelData = buffer.getWritePointer (channel);
+
+            for (int sample = 0; sample < numSamples; ++sample) {
+                const float fade = jlimit (0.0f, 1.0f, (float)(fadePosition + sample + 1) * fadeStep);
+                channelData[sample] = previous[sample] + fade * (channelData[sample] - previous[sample]);
+            }
+        }
+
+        fadePosition += numSamples;
+        if (fadePosition >= fadeSamples)
+            finishFade();
+    }
+
+    /** Resets the active engine and drops the one fading out. From the audio thread. */
+    void reset() noexcept
+    {
+        if (EngineType* engine = acquire())
+            engine->reset();
+
+        finishFade();
+    }
+
+private:
+    void finishFade() noexcept
+    {
+        if (fadingOut != nullptr) {
+            retired.store (fadingOut);
+            fadingOut = nullptr;
+        }
+    }
+
+    static void destroy (EngineType* engine)
+    {
+        if (engine != nullptr) {
+            engine->stopFrameWorker();
+            delete engine;
+        }
+    }
+
+    EngineType* active;
+    std::atomic<EngineType*> pending;
+    std::atomic<EngineType*> retired;
+
+    // Only touched by the thread that publishes
+    EngineType* latest = nullptr;
+
+    // Only touched by the audio thread
+    EngineType* fadingOut;
+    AudioSampleBuffer fadeBuffer;
+    int fadeSamples = 1;
+    int fadePosition = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (DoubleBufferedSTFT)
+};
+
+//==============================================================================
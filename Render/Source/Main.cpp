@@ -0,0 +1,328 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "../../Benchmark/Source/Effects.h"
+
+#include <atomic>
+#include <iostream>
+
+//==============================================================================
+
+struct RenderSettings
+{
+    const EffectDescription* effect = nullptr;
+    MemoryBlock state;      // as written by getStateInformation, empty for the defaults
+    File outputDirectory;
+    int blockSize = 8192;
+    int numJobs = SystemStats::getNumCpus();
+    double tailSeconds = 0.0;
+};
+
+static CriticalSection outputLock;
+
+static void printLine (const String& line, const bool isError = false)
+{
+    const ScopedLock lock (outputLock);
+    (isError ? std::cerr : std::cout) << line << std::endl;
+}
+
+//==============================================================================
+
+/** Streams one file through its own instance of the effect, one block at a time,
+    so that memory use does not depend on the length of the file.
+*/
+class RenderJob : public ThreadPoolJob
+{
+public:
+    RenderJob (const RenderSettings& settings, AudioFormatManager& formatManager,
+               const File& inputFile, std::atomic<int>& numFailures)
+        : ThreadPoolJob (inputFile.getFileName())
+        , settings (settings)
+        , formatManager (formatManager)
+        , inputFile (inputFile)
+        , numFailures (numFailures)
+    {
+    }
+
+    JobStatus runJob() override
+    {
+        const String error = render();
+        if (error.isNotEmpty()) {
+            printLine (inputFile.getFullPathName() + ": " + error, true);
+            ++numFailures;
+        }
+
+        return jobHasFinished;
+    }
+
+private:
+    String render()
+    {
+        std::unique_ptr<AudioFormatReader> reader (formatManager.createReaderFor (inputFile));
+        if (reader == nullptr)
+            return "cannot read the file";
+
+        const int numChannels = (int)reader->numChannels;
+        const double sampleRate = reader->sampleRate;
+        const int blockSize = settings.blockSize;
+
+        //======================================
+
+        std::unique_ptr<AudioProcessor> processor (settings.effect->create());
+
+        AudioProcessor::BusesLayout layout;
+        layout.inputBuses.add (AudioChannelSet::canonicalChannelSet (numChannels));
+        layout.outputBuses.add (AudioChannelSet::canonicalChannelSet (numChannels));
+        if (! processor->checkBusesLayoutSupported (layout))
+            return settings.effect->name + " does not support " + String (numChannels) + " channels";
+
+        // Applies parameter changes straight away, see PluginParameter::parameterChanged()
+        processor->setNonRealtime (true);
+        processor->setPlayConfigDetails (numChannels, numChannels, sampleRate, blockSize);
+        if (settings.state.getSize() > 0)
+            processor->setStateInformation (settings.state.getData(), (int)settings.state.getSize());
+        processor->prepareToPlay (sampleRate, blockSize);
+
+        //======================================
+
+        const File outputFile = settings.outputDirectory.getChildFile (inputFile.getFileName());
+        AudioFormat* format = formatManager.findFormatForFileExtension (outputFile.getFileExtension());
+        if (format == nullptr)
+            return "unknown output format";
+        if (outputFile == inputFile)
+            return "the output folder is the folder of the input";
+
+        outputFile.deleteFile();
+        std::unique_ptr<FileOutputStream> outputStream (outputFile.createOutputStream());
+        if (outputStream == nullptr)
+            return "cannot create " + outputFile.getFullPathName();
+
+        const Array<int> bitDepths = format->getPossibleBitDepths();
+        const int bitsPerSample = bitDepths.contains ((int)reader->bitsPerSample) ? (int)reader->bitsPerSample
+                                                                                  : bitDepths.getLast();
+
+        std::unique_ptr<AudioFormatWriter> writer (format->createWriterFor (outputStream.get(), sampleRate,
+                                                                            (unsigned int)numChannels,
+                                                                            bitsPerSample, reader->metadataValues, 0));
+        if (writer == nullptr)
+            return "cannot write " + String (numChannels) + " channels at " + String (bitsPerSample) + " bits";
+        outputStream.release();   // owned by the writer from now on
+
+        //======================================
+
+        // The output is shifted back by the latency of the effect, and extended by its tail
+        const int64 numInputSamples = reader->lengthInSamples;
+        const double tailSeconds = settings.tailSeconds + processor->getTailLengthSeconds();
+        const int64 numOutputSamples = numInputSamples + (int64)(tailSeconds * sampleRate);
+        int64 numSamplesToSkip = processor->getLatencySamples();
+
+        AudioSampleBuffer buffer (numChannels, blockSize);
+        MidiBuffer midiMessages;
+        int64 readPosition = 0;
+        int64 numWrittenSamples = 0;
+        const int64 startTicks = Time::getHighResolutionTicks();
+
+        while (numWrittenSamples < numOutputSamples) {
+            if (shouldExit())
+                return "cancelled";
+
+            buffer.clear();
+            const int numSamplesToRead = (int)jlimit ((int64)0, (int64)blockSize, numInputSamples - readPosition);
+            if (numSamplesToRead > 0)
+                reader->read (&buffer, 0, numSamplesToRead, readPosition, true, true);
+            readPosition += blockSize;
+
+            midiMessages.clear();
+            processor->processBlock (buffer, midiMessages);
+
+            const int skipped = (int)jmin (numSamplesToSkip, (int64)blockSize);
+            numSamplesToSkip -= skipped;
+
+            const int numSamplesToWrite = (int)jmin ((int64)(blockSize - skipped), numOutputSamples - numWrittenSamples);
+            if (numSamplesToWrite > 0 && ! writer->writeFromAudioSampleBuffer (buffer, skipped, numSamplesToWrite))
+                return "cannot write " + outputFile.getFullPathName();
+            numWrittenSamples += jmax (0, numSamplesToWrite);
+        }
+
+        processor->releaseResources();
+        writer.reset();
+
+        //======================================
+
+        const double seconds = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - startTicks);
+        const double realtimeFactor = (seconds > 0.0) ? ((double)numOutputSamples / sampleRate) / seconds : 0.0;
+        printLine (inputFile.getFileName() + " -> " + outputFile.getFullPathName()
+                   + " (" + String (realtimeFactor, 1) + "x realtime)");
+        return {};
+    }
+
+    const RenderSettings& settings;
+    AudioFormatManager& formatManager;
+    const File inputFile;
+    std::atomic<int>& numFailures;
+};
+
+//==============================================================================
+
+static const EffectDescription* findEffect (const String& name)
+{
+    for (auto& effect : getAllEffects())
+        if (effect.name.equalsIgnoreCase (name))
+            return &effect;
+
+    return nullptr;
+}
+
+/** Reads a preset saved with --save-preset, that is, the XML of the parameter tree
+    that setStateInformation still accepts from sessions of older versions.
+*/
+static bool loadPreset (const File& file, MemoryBlock& state)
+{
+    std::unique_ptr<XmlElement> xml (XmlDocument::parse (file));
+    if (xml == nullptr)
+        return false;
+
+    AudioProcessor::copyXmlToBinary (*xml, state);
+    return true;
+}
+
+/** getStateInformation writes a binary table, so the XML is built here from
+    the parameters, in the layout of AudioProcessorValueTreeState.
+*/
+static bool savePreset (const EffectDescription& effect, const File& file)
+{
+    std::unique_ptr<AudioProcessor> processor (effect.create());
+
+    XmlElement xml (processor->getName().removeCharacters ("- "));
+    for (AudioProcessorParameter* processorParameter : processor->getParameters()) {
+        if (auto* parameter = dynamic_cast<RangedAudioParameter*> (processorParameter)) {
+            XmlElement* parameterXml = xml.createNewChildElement ("PARAM");
+            parameterXml->setAttribute ("id", parameter->paramID);
+            parameterXml->setAttribute ("value", parameter->convertFrom0to1 (parameter->getValue()));
+        }
+    }
+
+    return xml.writeToFile (file, {});
+}
+
+static void printUsage()
+{
+    std::cout << "Usage: Render --effect=Delay --output=dir [options] files..." << std::endl
+              << "  --effect=Delay                Effect to apply" << std::endl
+              << "  --preset=preset.xml           Effect state, as saved by --save-preset (default: defaults)" << std::endl
+              << "  --output=dir                  Folder for the rendered files, named as the inputs" << std::endl
+              << "  --block-size=8192             Samples per processBlock call" << std::endl
+              << "  --jobs=8                      Files rendered at the same time (default: one per core)" << std::endl
+              << "  --tail=2                      Seconds rendered after the end of each file" << std::endl
+              << "  --save-preset=preset.xml      Write the default state of the effect and exit" << std::endl
+              << "  --list                        List effects" << std::endl;
+}
+
+//==============================================================================
+
+int main (int argc, char* argv[])
+{
+    ScopedJuceInitialiser_GUI juceInitialiser;
+    ArgumentList args (argc, argv);
+
+    if (args.containsOption ("--help|-h") || args.size() == 0) {
+        printUsage();
+        return 0;
+    }
+
+    if (args.containsOption ("--list")) {
+        for (auto& effect : getAllEffects())
+            std::cout << effect.name << std::endl;
+        return 0;
+    }
+
+    RenderSettings settings;
+    settings.effect = findEffect (args.getValueForOption ("--effect"));
+    if (settings.effect == nullptr) {
+        printLine ("Unknown effect, see --list", true);
+        return 1;
+    }
+
+    if (args.containsOption ("--save-preset")) {
+        const File presetFile = args.getFileForOption ("--save-preset");
+        if (! savePreset (*settings.effect, presetFile)) {
+            printLine ("Cannot write " + presetFile.getFullPathName(), true);
+            return 1;
+        }
+        return 0;
+    }
+
+    if (args.containsOption ("--preset") && ! loadPreset (args.getFileForOption ("--preset"), settings.state)) {
+        printLine ("Cannot read the preset", true);
+        return 1;
+    }
+
+    if (! args.containsOption ("--output")) {
+        printLine ("Missing --output", true);
+        return 1;
+    }
+
+    settings.outputDirectory = args.getFileForOption ("--output");
+    if (! settings.outputDirectory.createDirectory()) {
+        printLine ("Cannot create " + settings.outputDirectory.getFullPathName(), true);
+        return 1;
+    }
+
+    if (args.containsOption ("--block-size"))
+        settings.blockSize = jlimit (16, 1 << 20, args.getValueForOption ("--block-size").getIntValue());
+
+    if (args.containsOption ("--jobs"))
+        settings.numJobs = jmax (1, args.getValueForOption ("--jobs").getIntValue());
+
+    if (args.containsOption ("--tail"))
+        settings.tailSeconds = jmax (0.0, args.getValueForOption ("--tail").getDoubleValue());
+
+    //======================================
+
+    AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    std::atomic<int> numFailures { 0 };
+    int numFiles = 0;
+    {
+        ThreadPool pool (settings.numJobs);
+
+        for (int i = 0; i < args.size(); ++i) {
+            if (args[i].isOption())
+                continue;
+
+            pool.addJob (new RenderJob (settings, formatManager, args[i].resolveAsFile(), numFailures), true);
+            ++numFiles;
+        }
+
+        while (pool.getNumJobs() > 0)
+            Thread::sleep (100);
+    }
+
+    if (numFiles == 0)
+        printLine ("No input files", true);
+
+    return (numFiles == 0 || numFailures > 0) ? 1 : 0;
+}
+
+//==============================================================================
@@ -0,0 +1,124 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+
+/** Polyphase IIR Hilbert transformer, after Olli Niemitalo: two chains of four
+    second-order all-pass sections whose outputs stay about 90 degrees apart from
+    0.002 to 0.498 of the sample rate, with the first chain one sample late.
+
+    Each channel takes two SIMD lanes, the even one for the in-phase chain and the
+    odd one for the quadrature chain, so both chains of channelsPerRegister channels
+    run in parallel. Every stage is y[n] = a^2 (x[n] + y[n-2]) - x[n-2].
+*/
+class HilbertTransformer
+{
+public:
+    typedef dsp::SIMDRegister<float> Lanes;
+
+    enum {
+        numLanes = (int)Lanes::SIMDNumElements,
+        channelsPerRegister = numLanes / 2,
+        numStages = 4,
+    };
+
+    static_assert (channelsPerRegister > 0, "Both chains of a channel must fit in a register");
+
+    HilbertTransformer()
+    {
+        static const double inPhase[numStages] = {
+            0.6923878, 0.9360654322959, 0.9882295226860, 0.9987488452737
+        };
+        static const double quadrature[numStages] = {
+            0.4021921162426, 0.8561710882420, 0.9722909545651, 0.9952884791278
+        };
+
+        for (int stage = 0; stage < numStages; ++stage) {
+            coefficients[stage] = Lanes::expand (0.0f);
+            for (int lane = 0; lane < numLanes; ++lane) {
+                const double a = (lane % 2 == 0) ? inPhase[stage] : quadrature[stage];
+                coefficients[stage].set ((size_t)lane, (float)(a * a));
+            }
+        }
+
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        for (int i = 0; i <= numStages; ++i)
+            history1[i] = history2[i] = Lanes::expand (0.0f);
+
+        current = previous = Lanes::expand (0.0f);
+    }
+
+    /** Filters the next sample of every channel, set in both of its lanes. */
+    void processSample (const Lanes in) noexcept
+    {
+        // history1[i] and history2[i] are the last two inputs of stage i, which are
+        // the last two outputs of stage i - 1
+        Lanes x = in;
+        for (int stage = 0; stage < numStages; ++stage) {
+            const Lanes y = coefficients[stage] * (x + history2[stage + 1]) - history2[stage];
+            history2[stage] = history1[stage];
+            history1[stage] = x;
+            x = y;
+        }
+        history2[numStages] = history1[numStages];
+        history1[numStages] = x;
+
+        previous = current;
+        current = x;
+    }
+
+    /** Time constant, in samples, of the slowest decay of the chains. Every stage
+        has its poles at plus and minus a, so the largest a sets how long they ring.
+    */
+    static double getTimeConstantSamples() noexcept
+    {
+        return -1.0 / std::log (0.9987488452737);
+    }
+
+    float getInPhase (const int channel) const noexcept
+    {
+        return previous.get ((size_t)(2 * channel));
+    }
+
+    float getQuadrature (const int channel) const noexcept
+    {
+        return current.get ((size_t)(2 * channel + 1));
+    }
+
+private:
+    Lanes coefficients[numStages];
+    Lanes history1[numStages + 1];
+    Lanes history2[numStages + 1];
+    Lanes current;
+    Lanes previous;
+};
+
+//==============================================================================
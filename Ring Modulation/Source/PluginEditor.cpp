@@ -102,10 +102,15 @@ RingModulationAudioProcessorEditor::RingModulationAudioProcessorEditor (RingModu
 
     editorHeight += components.size() * editorPadding;
     setSize (editorWidth, editorHeight);
+    setOpaque (true);
+    setLookAndFeel (lookAndFeel);
+    renderingContext.attachTo (*this);
 }
 
 RingModulationAudioProcessorEditor::~RingModulationAudioProcessorEditor()
 {
+    renderingContext.detach();
+    setLookAndFeel (nullptr);
 }
 
 //==============================================================================
@@ -0,0 +1,369 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "RealtimeSafety.h"
+#include <atomic>
+
+/** Set to 1 to enable the QualityGovernor by default. */
+#ifndef AUDIO_EFFECTS_QUALITY_GOVERNOR
+ #define AUDIO_EFFECTS_QUALITY_GOVERNOR 0
+#endif
+
+//==============================================================================
+
+/** Trades quality for time when the effects get close to their deadline.
+
+    Every ProcessBlockProfiler reports the time of its processBlock calls here,
+    whether or not its own statistics are enabled, and their sum is compared with
+    the wall time that passed, over windows of windowTime. Above highLoad the
+    reduction goes up by one, and the effects switch to cheaper configurations,
+    crossfading so that it does not click. It comes back down once the load has
+    stayed below lowLoad for a while, and that wait doubles every time the load
+    comes back soon after, so a load that fits one level but not the next does
+    not make it oscillate.
+
+    There is one governor for all the instances of a plugin binary in a process,
+    held in a SharedResourcePointer. While it is disabled the reduction stays at 0.
+*/
+class QualityGovernor
+{
+public:
+    enum {
+        maxReduction = 2,
+        minHoldWindows = 10,
+        maxHoldWindows = 160,
+    };
+
+    static constexpr double windowTime = 0.1;
+    static constexpr double highLoad = 0.7;
+    static constexpr double lowLoad = 0.35;
+
+    QualityGovernor()
+        : enabled (AUDIO_EFFECTS_QUALITY_GOVERNOR != 0)
+    {
+    }
+
+    void setEnabled (const bool shouldBeEnabled)
+    {
+        enabled = shouldBeEnabled;
+        if (! shouldBeEnabled)
+            reduction = 0;
+    }
+
+    bool isEnabled() const noexcept { return enabled.load (std::memory_order_relaxed); }
+
+    /** From 0 for full quality up to maxReduction. Read by the effects on the audio
+        thread, once per block.
+    */
+    int getReduction() const noexcept { return reduction.load (std::memory_order_relaxed); }
+
+    /** Called by the audio threads after every block, with the time it took. */
+    void record (const int64 elapsedTicks) noexcept
+    {
+        const int64 now = Time::getHighResolutionTicks();
+        const int64 windowTicks = Time::secondsToHighResolutionTicks (windowTime);
+        busyTicks.fetch_add (elapsedTicks, std::memory_order_relaxed);
+
+        // Only the thread that moves the window on evaluates it
+        int64 start = windowStart.load (std::memory_order_relaxed);
+        if (now - start < windowTicks || ! windowStart.compare_exchange_strong (start, now, std::memory_order_relaxed))
+            return;
+
+        const int64 busy = busyTicks.exchange (0, std::memory_order_relaxed);
+
+        // A window that spans a gap in the processing, like a stopped transport, says nothing
+        if (now - start > 4 * windowTicks)
+            return;
+
+        update ((double)busy / (double)(now - start));
+    }
+
+private:
+    void update (const double load) noexcept
+    {
+        const int currentReduction = reduction.load (std::memory_order_relaxed);
+        const int sinceLowered = jmin (windowsSinceLowered.load (std::memory_order_relaxed) + 1, (int)maxHoldWindows * 2);
+        windowsSinceLowered.store (sinceLowered, std::memory_order_relaxed);
+
+        if (load > highLoad) {
+            lowWindows.store (0, std::memory_order_relaxed);
+            if (currentReduction < maxReduction) {
+                reduction.store (currentReduction + 1, std::memory_order_relaxed);
+
+                // The lower reduction did not hold, so the next attempt waits longer
+                const int hold = holdWindows.load (std::memory_order_relaxed);
+                if (sinceLowered < 2 * hold)
+                    holdWindows.store (jmin (2 * hold, (int)maxHoldWindows), std::memory_order_relaxed);
+                else
+                    holdWindows.store ((int)minHoldWindows, std::memory_order_relaxed);
+            }
+        } else if (load < lowLoad && currentReduction > 0) {
+            const int windows = lowWindows.load (std::memory_order_relaxed) + 1;
+            if (windows >= holdWindows.load (std::memory_order_relaxed)) {
+                reduction.store (currentReduction - 1, std::memory_order_relaxed);
+                windowsSinceLowered.store (0, std::memory_order_relaxed);
+                lowWindows.store (0, std::memory_order_relaxed);
+            } else {
+                lowWindows.store (windows, std::memory_order_relaxed);
+            }
+        } else {
+            lowWindows.store (0, std::memory_order_relaxed);
+        }
+    }
+
+    std::atomic<bool> enabled;
+    std::atomic<int> reduction { 0 };
+
+    std::atomic<int64> windowStart { 0 };
+    std::atomic<int64> busyTicks { 0 };
+
+    // Written by whichever audio thread evaluates a window
+    std::atomic<int> lowWindows { 0 };
+    std::atomic<int> holdWindows { minHoldWindows };
+    std::atomic<int> windowsSinceLowered { maxHoldWindows * 2 };
+
+    JUCE_DECLARE_NON_COPYABLE (QualityGovernor)
+};
+
+//==============================================================================
+
+/** Measures the wall time of every processBlock call and collects it in a
+    logarithmic histogram. Only the audio thread writes, any other thread can
+    read the statistics at any time without locks. Disabled by default.
+*/
+class ProcessBlockProfiler
+{
+public:
+    enum {
+        binsPerOctave = 4,
+        numOctaves = 24,    // from 1 us up to about 16 s
+        numBins = binsPerOctave * numOctaves,
+    };
+
+    struct Statistics
+    {
+        int64 numCalls = 0;
+        int64 numOverruns = 0;
+        double p50Milliseconds = 0.0;
+        double p99Milliseconds = 0.0;
+        double maxMilliseconds = 0.0;
+        double averageLoad = 0.0;   // time spent processing / duration of the audio processed
+
+        String toString() const
+        {
+            return String::formatted ("calls: %lld, p50: %.3f ms, p99: %.3f ms, max: %.3f ms, "
+                                      "load: %.1f%%, overruns: %lld",
+                                      (long long)numCalls, p50Milliseconds, p99Milliseconds,
+                                      maxMilliseconds, 100.0 * averageLoad, (long long)numOverruns);
+        }
+    };
+
+    //======================================
+
+    ProcessBlockProfiler()
+    {
+        clearHistogram();
+    }
+
+    void prepare (const double sampleRate)
+    {
+        inverseSampleRate = (sampleRate > 0.0) ? 1.0 / sampleRate : 0.0;
+        resetRequested = true;
+    }
+
+    void setEnabled (const bool shouldBeEnabled) { enabled = shouldBeEnabled; }
+    bool isEnabled() const { return enabled; }
+
+    /** Can be called from any thread, the audio thread clears the histogram on the next block. */
+    void reset() { resetRequested = true; }
+
+    /** The reduction of the QualityGovernor, for the effects to read once per block
+        while a ScopedMeasurement is running. Offline renders get full quality.
+    */
+    int getQualityReduction() const noexcept { return measuringNonRealtime ? 0 : governor->getReduction(); }
+
+    QualityGovernor& getQualityGovernor() noexcept { return *governor; }
+
+    //======================================
+
+    class ScopedMeasurement
+    {
+    public:
+        ScopedMeasurement (ProcessBlockProfiler& p, const int numSamples, const bool nonRealtime)
+            : profiler (p)
+            , numSamples (numSamples)
+            , outermost (getNestingDepth()++ == 0)
+            , governed (outermost && ! nonRealtime && p.governor->isEnabled())
+            , measuring (p.isEnabled() || governed)
+            , startTicks (measuring ? Time::getHighResolutionTicks() : 0)
+        {
+            p.measuringNonRealtime = nonRealtime;
+        }
+
+        ~ScopedMeasurement()
+        {
+            --getNestingDepth();
+            if (! measuring)
+                return;
+
+            const int64 elapsedTicks = Time::getHighResolutionTicks() - startTicks;
+            if (profiler.isEnabled())
+                profiler.record (elapsedTicks, numSamples);
+
+            // The processors run inside another one, like the effects of the Chain, are
+            // already part of its time, and offline renders do not take a deadline
+            if (governed)
+                profiler.governor->record (elapsedTicks);
+        }
+
+    private:
+        static int& getNestingDepth() noexcept
+        {
+            static thread_local int depth = 0;
+            return depth;
+        }
+
+        ProcessBlockProfiler& profiler;
+        const int numSamples;
+        const bool outermost;
+        const bool governed;
+        const bool measuring;
+        const int64 startTicks;
+        const RealtimeSafety::ScopedRealtimeSection realtimeSection;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedMeasurement)
+    };
+
+    //======================================
+
+    Statistics getStatistics() const
+    {
+        Statistics statistics;
+
+        uint32 counts[numBins];
+        int64 numCalls = 0;
+        for (int bin = 0; bin < numBins; ++bin) {
+            counts[bin] = histogram[bin].load (std::memory_order_relaxed);
+            numCalls += counts[bin];
+        }
+
+        statistics.numCalls = numCalls;
+        statistics.numOverruns = numOverruns.load (std::memory_order_relaxed);
+        statistics.maxMilliseconds = 1e3 * maxSeconds.load (std::memory_order_relaxed);
+        statistics.p50Milliseconds = getPercentileMilliseconds (counts, numCalls, 0.50);
+        statistics.p99Milliseconds = getPercentileMilliseconds (counts, numCalls, 0.99);
+
+        const double audioSeconds = processedAudioSeconds.load (std::memory_order_relaxed);
+        if (audioSeconds > 0.0)
+            statistics.averageLoad = processingSeconds.load (std::memory_order_relaxed) / audioSeconds;
+
+        return statistics;
+    }
+
+private:
+    //======================================
+
+    void record (const int64 elapsedTicks, const int numSamples) noexcept
+    {
+        if (resetRequested.exchange (false))
+            clearHistogram();
+
+        const double seconds = Time::highResolutionTicksToSeconds (elapsedTicks);
+        const double deadline = (double)numSamples * inverseSampleRate;
+
+        const int bin = getBinIndex (seconds);
+        histogram[bin].store (histogram[bin].load (std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+        if (seconds > deadline)
+            numOverruns.store (numOverruns.load (std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+        if (seconds > maxSeconds.load (std::memory_order_relaxed))
+            maxSeconds.store (seconds, std::memory_order_relaxed);
+
+        processingSeconds.store (processingSeconds.load (std::memory_order_relaxed) + seconds, std::memory_order_relaxed);
+        processedAudioSeconds.store (processedAudioSeconds.load (std::memory_order_relaxed) + deadline, std::memory_order_relaxed);
+    }
+
+    void clearHistogram() noexcept
+    {
+        for (int bin = 0; bin < numBins; ++bin)
+            histogram[bin].store (0, std::memory_order_relaxed);
+
+        numOverruns.store (0, std::memory_order_relaxed);
+        maxSeconds.store (0.0, std::memory_order_relaxed);
+        processingSeconds.store (0.0, std::memory_order_relaxed);
+        processedAudioSeconds.store (0.0, std::memory_order_relaxed);
+    }
+
+    static int getBinIndex (const double seconds) noexcept
+    {
+        const double microseconds = seconds * 1e6;
+        if (microseconds <= 1.0)
+            return 0;
+
+        const int bin = (int)(std::log2 (microseconds) * (double)binsPerOctave);
+        return jlimit (0, numBins - 1, bin);
+    }
+
+    static double getBinUpperEdgeMilliseconds (const int bin) noexcept
+    {
+        return 1e-3 * std::exp2 ((double)(bin + 1) / (double)binsPerOctave);
+    }
+
+    static double getPercentileMilliseconds (const uint32* counts, const int64 numCalls, const double percentile)
+    {
+        if (numCalls == 0)
+            return 0.0;
+
+        const int64 target = (int64)std::ceil (percentile * (double)numCalls);
+        int64 cumulative = 0;
+        for (int bin = 0; bin < numBins; ++bin) {
+            cumulative += counts[bin];
+            if (cumulative >= target)
+                return getBinUpperEdgeMilliseconds (bin);
+        }
+
+        return getBinUpperEdgeMilliseconds (numBins - 1);
+    }
+
+    //======================================
+
+    SharedResourcePointer<QualityGovernor> governor;
+    bool measuringNonRealtime = false;
+
+    std::atomic<bool> enabled { false };
+    std::atomic<bool> resetRequested { false };
+    double inverseSampleRate = 0.0;
+
+    std::atomic<uint32> histogram[numBins];
+    std::atomic<int64> numOverruns { 0 };
+    std::atomic<double> maxSeconds { 0.0 };
+    std::atomic<double> processingSeconds { 0.0 };
+    std::atomic<double> processedAudioSeconds { 0.0 };
+
+    JUCE_DECLARE_NON_COPYABLE (ProcessBlockProfiler)
+};
+
+//==============================================================================
@@ -0,0 +1,260 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "WavetableLFO.h"
+#include "HilbertTransformer.h"
+
+//==============================================================================
+
+/** The audio processing of the Ring Modulation, without the parameters, state,
+    editor or buses of the plugin, for hosts that only need the audio and run many
+    instances. RingModulationAudioProcessor wraps one and hands it the values of its
+    parameters once a block, in their natural units: the depth from 0 to 1, the
+    carrier frequency in Hz, the index of the waveform and the index of the mode.
+
+    The frequency shift mode moves every component of the input up by the carrier
+    frequency, instead of into a sum and a difference: the input and its Hilbert
+    transform are multiplied by a cosine and a sine carrier, and the lower sideband
+    cancels when they are added. The dry part of the mix is the in-phase chain, an
+    all-pass of the input with the same phase as the shifted signal. The waveform
+    is not used in this mode, and the channels past maxNumChannels are left dry.
+*/
+class RingModulationDSP
+{
+public:
+    enum parameterIndex {
+        parameterDepth = 0,
+        parameterFrequency,
+        parameterWaveform,
+        parameterMode,
+        numParameters,
+    };
+
+    enum modeIndex {
+        modeRingModulation = 0,
+        modeFrequencyShift,
+    };
+
+    enum {
+        maxNumChannels = 8,
+    };
+
+    void prepare (const double sampleRate) noexcept
+    {
+        inverseSampleRate = 1.0f / (float)sampleRate;
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        lfo.setPhase (0.0f);
+
+        carrierCos = 1.0f;
+        carrierSin = 0.0f;
+        for (int group = 0; group < numHilbertTransformers; ++group)
+            hilbertTransformers[group].reset();
+    }
+
+    void setParameter (const int index, const float value) noexcept
+    {
+        switch (index) {
+            case parameterDepth:     depth = value; break;
+            case parameterFrequency: frequency = value; break;
+            case parameterWaveform:  waveform = jlimit (0, WavetableLFO::numWaveforms - 1, (int)value); break;
+            case parameterMode:      mode = jlimit ((int)modeRingModulation, (int)modeFrequencyShift, (int)value); break;
+        }
+    }
+
+    /** Processes numSamples samples of numChannels channels in place. */
+    void process (float* const* channels, const int numChannels, const int numSamples) noexcept
+    {
+        const float phaseIncrement = frequency * inverseSampleRate;
+
+        if (mode == modeFrequencyShift) {
+            processFrequencyShift (channels, jmin (numChannels, (int)maxNumChannels), numSamples, phaseIncrement);
+            return;
+        }
+
+        lfo.setWaveform (waveform);
+        lfo.setFrequency (frequency, inverseSampleRate);
+
+        for (int blockStart = 0; blockStart < numSamples; blockStart += maxBlockSize) {
+            const int blockSamples = jmin ((int)maxBlockSize, numSamples - blockStart);
+
+            renderCarrier (gains, blockSamples, phaseIncrement);
+            for (int sample = 0; sample < blockSamples; ++sample)
+                gains[sample] = 1 - depth + depth * (2.0f * gains[sample] - 1.0f);
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                FloatVectorOperations::multiply (channels[channel] + blockStart, gains, blockSamples);
+        }
+    }
+
+private:
+    //==============================================================================
+
+    /** The carrier is the same on every channel, so it is rendered once per sub-block
+        of maxBlockSize samples and turned into a gain that all the channels share.
+    */
+    enum {
+        maxBlockSize = 256,
+    };
+
+    enum {
+        numHilbertTransformers = (maxNumChannels + HilbertTransformer::channelsPerRegister - 1)
+                                 / HilbertTransformer::channelsPerRegister,
+    };
+
+    void processFrequencyShift (float* const* channels, const int numChannels,
+                                const int numSamples, const float phaseIncrement) noexcept
+    {
+        // The carrier turns by the same angle every sample, so it is rotated instead
+        // of calling cos and sin for every sample
+        const double angle = 2.0 * M_PI * (double)phaseIncrement;
+        const float rotationCos = (float)std::cos (angle);
+        const float rotationSin = (float)std::sin (angle);
+
+        for (int blockStart = 0; blockStart < numSamples; blockStart += maxBlockSize) {
+            const int blockSamples = jmin ((int)maxBlockSize, numSamples - blockStart);
+
+            for (int sample = 0; sample < blockSamples; ++sample) {
+                gains[sample] = carrierCos;
+                sines[sample] = carrierSin;
+
+                const float nextCos = carrierCos * rotationCos - carrierSin * rotationSin;
+                carrierSin = carrierSin * rotationCos + carrierCos * rotationSin;
+                carrierCos = nextCos;
+            }
+
+            // The rounding errors of the rotation would slowly change its amplitude
+            const float norm = 1.5f - 0.5f * (carrierCos * carrierCos + carrierSin * carrierSin);
+            carrierCos *= norm;
+            carrierSin *= norm;
+
+            for (int firstChannel = 0; firstChannel < numChannels; firstChannel += HilbertTransformer::channelsPerRegister) {
+                HilbertTransformer& hilbert = hilbertTransformers[firstChannel / HilbertTransformer::channelsPerRegister];
+                const int numGroupChannels = jmin ((int)HilbertTransformer::channelsPerRegister, numChannels - firstChannel);
+
+                for (int sample = 0; sample < blockSamples; ++sample) {
+                    HilbertTransformer::Lanes in = HilbertTransformer::Lanes::expand (0.0f);
+                    for (int channel = 0; channel < numGroupChannels; ++channel) {
+                        const float x = channels[firstChannel + channel][blockStart + sample];
+                        in.set ((size_t)(2 * channel), x);
+                        in.set ((size_t)(2 * channel + 1), x);
+                    }
+
+                    hilbert.processSample (in);
+
+                    // The dry signal is the in-phase chain, which is aligned with the
+                    // shifted one, unlike the input
+                    for (int channel = 0; channel < numGroupChannels; ++channel) {
+                        const float dry = hilbert.getInPhase (channel);
+                        const float shifted = dry * gains[sample]
+                                            + hilbert.getQuadrature (channel) * sines[sample];
+                        channels[firstChannel + channel][blockStart + sample] = dry + depth * (shifted - dry);
+                    }
+                }
+            }
+        }
+    }
+
+    /** Renders the carrier between 0 and 1. The sawtooth and square waveforms have
+        their steps smoothed with polyBLEP residuals, so that they do not alias at
+        audio rate. The continuous waveforms are read from the wavetable.
+    */
+    void renderCarrier (float* carrier, const int numSamples, const float phaseIncrement) noexcept
+    {
+        if (waveform != WavetableLFO::waveformSawtooth
+            && waveform != WavetableLFO::waveformInverseSawtooth
+            && waveform != WavetableLFO::waveformSquare) {
+            lfo.fill (carrier, numSamples);
+            return;
+        }
+
+        // The naive waveforms and their steps are worked out from the phase, as the
+        // wavetable spreads every step over one table point
+        const float dt = jmin (phaseIncrement, 0.5f);
+        float phase = lfo.getPhase();
+
+        for (int sample = 0; sample < numSamples; ++sample) {
+            const float halfCyclePhase = (phase < 0.5f) ? phase + 0.5f : phase - 0.5f;
+
+            switch (waveform) {
+                case WavetableLFO::waveformSawtooth: {
+                    carrier[sample] = halfCyclePhase - 0.5f * polyBlep (halfCyclePhase, dt);
+                    break;
+                }
+                case WavetableLFO::waveformInverseSawtooth: {
+                    carrier[sample] = 1.0f - halfCyclePhase + 0.5f * polyBlep (halfCyclePhase, dt);
+                    break;
+                }
+                case WavetableLFO::waveformSquare: {
+                    const float naive = (phase < 0.5f) ? 0.0f : 1.0f;
+                    carrier[sample] = naive + 0.5f * (polyBlep (halfCyclePhase, dt) - polyBlep (phase, dt));
+                    break;
+                }
+            }
+
+            phase += phaseIncrement;
+            if (phase >= 1.0f)
+                phase -= 1.0f;
+        }
+
+        lfo.setPhase (phase);
+    }
+
+    static float polyBlep (float t, const float dt) noexcept
+    {
+        // Difference between a naive and a band-limited downward step of 2 at t = 0,
+        // spread over the samples on either side of the step
+        if (t < dt) {
+            t /= dt;
+            return t + t - t * t - 1.0f;
+        } else if (t > 1.0f - dt) {
+            t = (t - 1.0f) / dt;
+            return t * t + t + t + 1.0f;
+        }
+
+        return 0.0f;
+    }
+
+    WavetableLFO lfo;
+    float gains[maxBlockSize];
+
+    // In the frequency shift mode, gains holds the cosine carrier
+    HilbertTransformer hilbertTransformers[numHilbertTransformers];
+    float sines[maxBlockSize];
+    float carrierCos = 1.0f;
+    float carrierSin = 0.0f;
+    float inverseSampleRate = 1.0f / 44100.0f;
+
+    float depth = 0.5f;
+    float frequency = 200.0f;
+    int waveform = WavetableLFO::waveformSine;
+    int mode = modeRingModulation;
+};
+
+//==============================================================================
@@ -100,12 +100,24 @@ RobotizationWhisperizationAudioProcessorEditor::RobotizationWhisperizationAudioP
 
     //======================================
 
+    addAndMakeVisible (spectrumDisplay);
+    editorHeight += SpectrumDisplay::preferredHeight + editorPadding;
+
     editorHeight += components.size() * editorPadding;
     setSize (editorWidth, editorHeight);
+    setOpaque (true);
+    setLookAndFeel (lookAndFeel);
+    renderingContext.attachTo (*this);
+
+    processor.spectrumMeter.setEnabled (true);
+    startTimerHz (30);
 }
 
 RobotizationWhisperizationAudioProcessorEditor::~RobotizationWhisperizationAudioProcessorEditor()
 {
+    processor.spectrumMeter.setEnabled (false);
+    renderingContext.detach();
+    setLookAndFeel (nullptr);
 }
 
 //==============================================================================
@@ -132,6 +144,17 @@ void RobotizationWhisperizationAudioProcessorEditor::resized()
 
         r = r.removeFromBottom (r.getHeight() - editorPadding);
     }
+
+    spectrumDisplay.setBounds (getLocalBounds().reduced (editorMargin).removeFromBottom (SpectrumDisplay::preferredHeight));
+}
+
+//==============================================================================
+
+void RobotizationWhisperizationAudioProcessorEditor::timerCallback()
+{
+    SpectrumFrame frame;
+    const bool received = processor.spectrumMeter.collect (frame);
+    spectrumDisplay.update (received ? &frame : nullptr, 0.001f * (float)getTimerInterval());
 }
 
 //==============================================================================
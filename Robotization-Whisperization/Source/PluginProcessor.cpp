@@ -40,39 +40,45 @@ RobotizationWhisperizationAudioProcessor::RobotizationWhisperizationAudioProcess
                     #endif
                    ),
 #endif
-    stft (*this), parameters (*this)
+    parameters (*this)
     , paramEffect (parameters, "Effect", effectItemsUI, effectPassThrough)
     , paramFftSize (parameters, "FFT size", fftSizeItemsUI, fftSize512,
                     [this](float value){
-                        const ScopedLock sl (lock);
                         value = (float)(1 << ((int)value + 5));
-                        paramFftSize.setCurrentAndTargetValue (value);
-                        stft.updateParameters((int)paramFftSize.getTargetValue(),
-                                              (int)paramHopSize.getTargetValue(),
-                                              (int)paramWindowType.getTargetValue());
+                        setEngineParameter (RobotizationWhisperizationDSP::parameterFftSize, value);
                         return value;
                     })
     , paramHopSize (parameters, "Hop size", hopSizeItemsUI, hopSize8,
                     [this](float value){
-                        const ScopedLock sl (lock);
                         value = (float)(1 << ((int)value + 1));
-                        paramHopSize.setCurrentAndTargetValue (value);
-                        stft.updateParameters((int)paramFftSize.getTargetValue(),
-                                              (int)paramHopSize.getTargetValue(),
-                                              (int)paramWindowType.getTargetValue());
+                        setEngineParameter (RobotizationWhisperizationDSP::parameterOverlap, value);
                         return value;
                     })
     , paramWindowType (parameters, "Window type", windowTypeItemsUI, STFT::windowTypeHann,
                        [this](float value){
-                           const ScopedLock sl (lock);
-                           paramWindowType.setCurrentAndTargetValue (value);
-                           stft.updateParameters((int)paramFftSize.getTargetValue(),
-                                                 (int)paramHopSize.getTargetValue(),
-                                                 (int)paramWindowType.getTargetValue());
+                           setEngineParameter (RobotizationWhisperizationDSP::parameterWindowType, value);
                            return value;
                        })
+    , paramLowLatency (parameters, "Low latency", false,
+                       [this](float value){
+                           setEngineParameter (RobotizationWhisperizationDSP::parameterLowLatency, value);
+                           return value;
+                       })
+    , paramWorkerThread (parameters, "Worker thread", false,
+                         [this](float value){
+                             setEngineParameter (RobotizationWhisperizationDSP::parameterWorkerThread, value);
+                             return value;
+                         })
+    , bypass (*this, parameters)
 {
     parameters.apvts.state = ValueTree (Identifier (getName().removeCharacters ("- ")));
+
+    // Each of these builds a new STFT engine
+    paramFftSize.deferCallback();
+    paramHopSize.deferCallback();
+    paramWindowType.deferCallback();
+    paramLowLatency.deferCallback();
+    paramWorkerThread.deferCallback();
 }
 
 RobotizationWhisperizationAudioProcessor::~RobotizationWhisperizationAudioProcessor()
@@ -83,27 +89,47 @@ RobotizationWhisperizationAudioProcessor::~RobotizationWhisperizationAudioProces
 
 void RobotizationWhisperizationAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
+    TRACE_INSTANCE_SCOPE ("prepareToPlay", this);
+
     const double smoothTime = 1e-3;
     paramEffect.reset (sampleRate, smoothTime);
     paramFftSize.reset (sampleRate, smoothTime);
     paramHopSize.reset (sampleRate, smoothTime);
     paramWindowType.reset (sampleRate, smoothTime);
+    paramLowLatency.reset (sampleRate, smoothTime);
+    paramWorkerThread.reset (sampleRate, smoothTime);
 
     //======================================
 
-    stft.setup (getTotalNumInputChannels());
-    stft.updateParameters((int)paramFftSize.getTargetValue(),
-                          (int)paramHopSize.getTargetValue(),
-                          (int)paramWindowType.getTargetValue());
+    parameters.flushDeferredCallbacks();
+
+    {
+        // In the order of the latencies that the deferred callbacks report
+        const ScopedLock lock (parameters.deferredCallbackLock);
+        robotizationWhisperization.setSpectrumMeter (&spectrumMeter);
+        robotizationWhisperization.setQualityReduction (isNonRealtime() ? -1 : 0);
+        robotizationWhisperization.prepare (sampleRate, getTotalNumInputChannels(), samplesPerBlock);
+        setLatencySamples (robotizationWhisperization.getLatencySamples());
+    }
+
+    profiler.prepare (sampleRate);
+    silenceDetector.prepare (sampleRate);
+    bypass.prepare (sampleRate, samplesPerBlock, 2 * (1 << (fftSize8192 + 5)));
 }
 
 void RobotizationWhisperizationAudioProcessor::releaseResources()
 {
 }
 
+void RobotizationWhisperizationAudioProcessor::reset()
+{
+    robotizationWhisperization.reset();
+}
+
 void RobotizationWhisperizationAudioProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
 {
-    const ScopedLock sl (lock);
+    const ProcessBlockProfiler::ScopedMeasurement measurement (profiler, buffer.getNumSamples(), isNonRealtime());
+    TRACE_INSTANCE_SCOPE ("processBlock", this);
 
     ScopedNoDenormals noDenormals;
 
@@ -113,12 +139,38 @@ void RobotizationWhisperizationAudioProcessor::processBlock (AudioSampleBuffer&
 
     //======================================
 
-    stft.processBlock (buffer);
+    parameters.applyDeferredValues();
+    parameters.applySnapshotMorph();
+
+    if (silenceDetector.skipBlock (*this, buffer))
+        return;
+
+    if (bypass.begin (buffer))
+        return;
+
+    // A new reduction rebuilds the engine on the parameters' worker, and the STFT
+    // crossfades to it
+    const int qualityReduction = isNonRealtime() ? -1 : profiler.getQualityReduction();
+    if (robotizationWhisperization.setQualityReduction (qualityReduction))
+        paramHopSize.retriggerDeferredCallback();
+
+    robotizationWhisperization.setParameter (RobotizationWhisperizationDSP::parameterEffect, paramEffect.getTargetValue());
+    robotizationWhisperization.process (buffer.getArrayOfWritePointers(), numInputChannels, numSamples);
 
     //======================================
 
     for (int channel = numInputChannels; channel < numOutputChannels; ++channel)
         buffer.clear (channel, 0, numSamples);
+
+    bypass.end (buffer);
+}
+
+//==============================================================================
+
+void RobotizationWhisperizationAudioProcessor::setEngineParameter (const int index, const float value)
+{
+    robotizationWhisperization.setParameter (index, value);
+    setLatencySamples (robotizationWhisperization.getLatencySamples());
 }
 
 //==============================================================================
@@ -132,13 +184,17 @@ void RobotizationWhisperizationAudioProcessor::processBlock (AudioSampleBuffer&
 
 void RobotizationWhisperizationAudioProcessor::getStateInformation (MemoryBlock& destData)
 {
-    auto state = parameters.apvts.copyState();
-    std::unique_ptr<XmlElement> xml (state.createXml());
-    copyXmlToBinary (*xml, destData);
+    MemoryOutputStream stream (destData, false);
+    parameters.writeState (stream);
 }
 
 void RobotizationWhisperizationAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
+    MemoryInputStream stream (data, (size_t)sizeInBytes, false);
+    if (parameters.readState (stream))
+        return;
+
+    // Sessions saved in the XML format of older versions
     std::unique_ptr<XmlElement> xmlState (getXmlFromBinary (data, sizeInBytes));
 
     if (xmlState.get() != nullptr)
@@ -167,10 +223,9 @@ bool RobotizationWhisperizationAudioProcessor::isBusesLayoutSupported (const Bus
     ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    if (layouts.getMainOutputChannelSet() != AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != AudioChannelSet::stereo())
+    // The channels are processed independently, so any layout with at least one
+    // channel is supported, from mono to surround sets or ambisonic stems.
+    if (layouts.getMainOutputChannelSet().isDisabled())
         return false;
 
     // This checks if the input layout matches the output layout
@@ -220,7 +275,13 @@ bool RobotizationWhisperizationAudioProcessor::isMidiEffect() const
 
 double RobotizationWhisperizationAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // Past the latency, the last frame that saw the input still has to be overlapped
+    return (double)robotizationWhisperization.getFftSize() / jmax (1.0, getSampleRate());
+}
+
+AudioProcessorParameter* RobotizationWhisperizationAudioProcessor::getBypassParameter() const
+{
+    return bypass.getParameter();
 }
 
 //==============================================================================
@@ -251,6 +312,26 @@ void RobotizationWhisperizationAudioProcessor::changeProgramName (int index, con
 
 //==============================================================================
 
+MemoryFootprint RobotizationWhisperizationAudioProcessor::getMemoryFootprint() const
+{
+    const ScopedLock lock (parameters.deferredCallbackLock);
+
+    MemoryFootprint footprint;
+    footprint.add (MemoryFootprint::other, sizeof (*this));
+    bypass.addMemoryFootprint (footprint);
+
+    robotizationWhisperization.addMemoryFootprint (footprint);
+
+    return footprint;
+}
+
+void RobotizationWhisperizationAudioProcessor::trimMemory()
+{
+    robotizationWhisperization.trimMemory();
+}
+
+//==============================================================================
+
 // This creates new instances of the plugin..
 AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
@@ -30,11 +30,15 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "PluginParameter.h"
-#include "STFT.h"
+#include "ProcessBlockProfiler.h"
+#include "SilenceDetector.h"
+#include "PluginBypass.h"
+#include "MemoryFootprint.h"
+#include "RobotizationWhisperizationDSP.h"
 
 //==============================================================================
 
-class RobotizationWhisperizationAudioProcessor : public AudioProcessor
+class RobotizationWhisperizationAudioProcessor : public AudioProcessor, public MemoryFootprintSource
 {
 public:
     //==============================================================================
@@ -46,6 +50,7 @@ public:
 
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
+    void reset() override;
     void processBlock (AudioSampleBuffer&, MidiBuffer&) override;
 
     //==============================================================================
@@ -79,6 +84,7 @@ public:
     bool producesMidi() const override;
     bool isMidiEffect () const override;
     double getTailLengthSeconds() const override;
+    AudioProcessorParameter* getBypassParameter() const override;
 
     //==============================================================================
 
@@ -90,10 +96,10 @@ public:
 
     //==============================================================================
 
+    MemoryFootprint getMemoryFootprint() const override;
 
-
-
-
+    /** Frees the engine that the last change of the FFT settings retired. */
+    void trimMemory() override;
 
     //==============================================================================
 
@@ -104,9 +110,9 @@ public:
     };
 
     enum effectIndex {
-        effectPassThrough = 0,
-        effectRobotization,
-        effectWhisperization,
+        effectPassThrough = RobotizationWhisperizationDSP::effectPassThrough,
+        effectRobotization = RobotizationWhisperizationDSP::effectRobotization,
+        effectWhisperization = RobotizationWhisperizationDSP::effectWhisperization,
     };
 
     //======================================
@@ -160,57 +166,23 @@ public:
 
     //======================================
 
-    class RobotizationWhisperization : public STFT
-    {
-    public:
-        RobotizationWhisperization (RobotizationWhisperizationAudioProcessor& p) : parent (p)
-        {
-        }
-
-    private:
-        void modification() override
-        {
-            fft->perform (timeDomainBuffer, frequencyDomainBuffer, false);
-
-            switch ((int)parent.paramEffect.getTargetValue()) {
-                case effectPassThrough: {
-                    // nothing
-                    break;
-                }
-                case effectRobotization: {
-                    for (int index = 0; index < fftSize; ++index) {
-                        float magnitude = abs (frequencyDomainBuffer[index]);
-                        frequencyDomainBuffer[index].real (magnitude);
-                        frequencyDomainBuffer[index].imag (0.0f);
-                    }
-                    break;
-                }
-                case effectWhisperization: {
-                    for (int index = 0; index < fftSize / 2 + 1; ++index) {
-                        float magnitude = abs (frequencyDomainBuffer[index]);
-                        float phase = 2.0f * M_PI * (float)rand() / (float)RAND_MAX;
-
-                        frequencyDomainBuffer[index].real (magnitude * cosf (phase));
-                        frequencyDomainBuffer[index].imag (magnitude * sinf (phase));
-                        if (index > 0 && index < fftSize / 2) {
-                            frequencyDomainBuffer[fftSize - index].real (magnitude * cosf (phase));
-                            frequencyDomainBuffer[fftSize - index].imag (magnitude * sinf (-phase));
-                        }
-                    }
-                    break;
-                }
-            }
-
-            fft->perform (frequencyDomainBuffer, timeDomainBuffer, true);
-        }
-
-        RobotizationWhisperizationAudioProcessor& parent;
-    };
+    /** Hands a setting of the engines to the core, which builds a new one, and
+        reports its latency. The FFT size, hop size, window type, low latency and
+        worker thread callbacks are deferred to the parameters' background worker.
+    */
+    void setEngineParameter (const int index, const float value);
+
+    RobotizationWhisperizationDSP robotizationWhisperization;
 
     //======================================
 
-    CriticalSection lock;
-    RobotizationWhisperization stft;
+    // Input spectrum for the editor, from the frames of every STFT engine
+    MeterSource<SpectrumFrame> spectrumMeter;
+
+    //======================================
+
+    ProcessBlockProfiler profiler;
+    SilenceDetector silenceDetector;
 
     //======================================
 
@@ -220,6 +192,10 @@ public:
     PluginParameterComboBox paramFftSize;
     PluginParameterComboBox paramHopSize;
     PluginParameterComboBox paramWindowType;
+    PluginParameterToggle paramLowLatency;
+    PluginParameterToggle paramWorkerThread;
+
+    PluginBypass bypass;
 
 private:
     //==============================================================================
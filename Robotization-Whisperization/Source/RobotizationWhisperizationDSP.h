@@ -0,0 +1,442 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+
+#pragma once
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "MemoryFootprint.h"
+#include "STFT.h"
+
+//==============================================================================
+
+/** The audio processing of the Robotization-Whisperization, without the
+    parameters, state, editor or buses of the plugin, for hosts that only need the
+    audio and run many instances. RobotizationWhisperizationAudioProcessor wraps
+    one and hands it the values of its parameters in their natural units: the index
+    of the effect, the FFT size in samples, the overlap as the number of hops in a
+    window, the index of the window type, and the low latency and worker thread
+    modes as 0 or 1.
+
+    The effect can change at any time. The other settings build a new STFT engine,
+    so setParameter() is not real-time safe for them. It is meant for another
+    thread than process(), which picks the new engine up without locks through a
+    DoubleBufferedSTFT. The configuration is kept under a lock of its own, so that
+    several threads can change it.
+*/
+class RobotizationWhisperizationDSP
+{
+public:
+    enum parameterIndex {
+        parameterEffect = 0,
+        parameterFftSize,
+        parameterOverlap,
+        parameterWindowType,
+        parameterLowLatency,
+        parameterWorkerThread,
+        numParameters,
+    };
+
+    enum effectIndex {
+        effectPassThrough = 0,
+        effectRobotization,
+        effectWhisperization,
+    };
+
+    //======================================
+
+    class RobotizationWhisperization : public STFT
+    {
+    public:
+        RobotizationWhisperization()
+            : effect (effectPassThrough)
+        {
+            for (int index = 0; index < phasorTableSize; ++index)
+                unitPhasors[index] = std::polar (1.0f, 2.0f * (float)M_PI * (float)index / (float)phasorTableSize);
+        }
+
+        /** Called by the audio thread before every block. modification() can run on
+            the worker thread, so it reads the effect from here, not from the parameter.
+        */
+        void setEffect (const int newEffect) noexcept
+        {
+            effect.store (newEffect, std::memory_order_relaxed);
+        }
+
+        /** Adds the buffers of the paired transform. */
+        void addMemoryFootprint (MemoryFootprint& footprint) const override
+        {
+            STFT::addMemoryFootprint (footprint);
+
+            if (pairedFftSize > 0) {
+                footprint.add (MemoryFootprint::spectralBuffers, channelFrames);
+                footprint.add (MemoryFootprint::spectralBuffers, sizeof (dsp::Complex<float>) * (size_t)(2 * numBins + 2 * pairedFftSize));
+            }
+        }
+
+    private:
+        /** Whisperization draws its random phases from a fixed table of unit phasors,
+            indexed by a xorshift generator with its own state for every channel.
+            Unlike rand(), nothing is shared between instances or threads.
+        */
+        enum {
+            phasorTableBits = 10,
+            phasorTableSize = 1 << phasorTableBits,
+        };
+
+        void updateFftSize (const int newFftSize) override
+        {
+            STFT::updateFftSize (newFftSize);
+
+            randomState.realloc (numChannels);
+            for (int channel = 0; channel < numChannels; ++channel)
+                randomState[channel] = 0x9e3779b9u * (uint32)(channel + 1);
+
+            // Only stereo layouts pair their channels
+            pairedFftSize = (numChannels == 2) ? fftSize : 0;
+            channelFrames.setSize (pairedFftSize > 0 ? 2 : 0, pairedFftSize);
+            channelBins.calloc (pairedFftSize > 0 ? 2 * numBins : 0);
+            pairedFrame.calloc (pairedFftSize);
+            pairedSpectrum.calloc (pairedFftSize);
+        }
+
+        /** With two channels, both frames go through one complex FFT, the left one
+            in the real parts and the right one in the imaginary parts, and the
+            spectra are split apart by their conjugate symmetry. The modified bins are
+            joined again the same way for one inverse transform, whose real and
+            imaginary parts are the two output frames. That is one transform each way
+            for both channels instead of one per channel.
+        */
+        void processFrames() override;
+        void splitPairedSpectrum() noexcept;
+        void joinPairedSpectrum() noexcept;
+
+        static inline uint32 nextRandom (uint32& state) noexcept
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return state;
+        }
+
+        /** Magnitude from the squared norm. std::abs() goes through hypot(), which
+            guards against overflows that the spectrum of an audio frame never reaches.
+        */
+        static inline float getMagnitude (const float real, const float imag) noexcept
+        {
+            return std::sqrt (real * real + imag * imag);
+        }
+
+        void modification (const int channel) override
+        {
+            modifyBins (channel, reinterpret_cast<float*> (frequencyDomainBuffer));
+        }
+
+        /** Modifies the numBins interleaved bins of the frame of the channel. */
+        void modifyBins (const int channel, float* bins) noexcept
+        {
+            switch (effect.load (std::memory_order_relaxed)) {
+                case effectPassThrough: {
+                    // nothing
+                    break;
+                }
+                case effectRobotization: {
+                    // Every phase goes to zero, so only the magnitudes are computed, in
+                    // place over the interleaved real and imaginary parts of the bins
+                    for (int index = 0; index < 2 * numBins; index += 2) {
+                        bins[index] = getMagnitude (bins[index], bins[index + 1]);
+                        bins[index + 1] = 0.0f;
+                    }
+                    break;
+                }
+                case effectWhisperization: {
+                    uint32 state = randomState[channel];
+                    for (int index = 0; index < 2 * numBins; index += 2) {
+                        const float magnitude = getMagnitude (bins[index], bins[index + 1]);
+                        const dsp::Complex<float>& phasor = unitPhasors[nextRandom (state) >> (32 - phasorTableBits)];
+
+                        bins[index] = magnitude * phasor.real();
+                        bins[index + 1] = magnitude * phasor.imag();
+                    }
+                    randomState[channel] = state;
+                    break;
+                }
+            }
+        }
+
+        std::atomic<int> effect;
+
+        dsp::Complex<float> unitPhasors[phasorTableSize];
+        HeapBlock<uint32> randomState;
+
+        // The windowed frame and the numBins bins of each channel, and the complex
+        // frame and spectrum that carry both, of pairedFftSize values, zero when the
+        // channels are not paired
+        int pairedFftSize = 0;
+        AudioSampleBuffer channelFrames;
+        HeapBlock<dsp::Complex<float>> channelBins;
+        HeapBlock<dsp::Complex<float>> pairedFrame;
+        HeapBlock<dsp::Complex<float>> pairedSpectrum;
+    };
+
+    //======================================
+
+    /** Builds the first engine, for blocks of up to maxBlockSize samples. Not
+        real-time safe.
+    */
+    void prepare (const double sampleRate, const int numChannels, const int maxBlockSize)
+    {
+        const ScopedLock lock (configurationLock);
+        stftNumChannels = numChannels;
+        stft.prepare (stftNumChannels, maxBlockSize, sampleRate);
+        updateStft();
+    }
+
+    /** Clears the active engine. Real-time safe. */
+    void reset() noexcept
+    {
+        stft.reset();
+    }
+
+    /** Real-time safe for the effect. The other settings build a new engine, which
+        is not.
+    */
+    void setParameter (const int index, const float value)
+    {
+        if (index == parameterEffect) {
+            effect = jlimit ((int)effectPassThrough, (int)effectWhisperization, (int)value);
+            return;
+        }
+
+        const ScopedLock lock (configurationLock);
+
+        switch (index) {
+            case parameterFftSize:      stftFftSize = (int)value; break;
+            case parameterOverlap:      stftHopSize = (int)value; break;
+            case parameterWindowType:   stftWindowType = (int)value; break;
+            case parameterLowLatency:   stftLowLatency = (value != 0.0f); break;
+            case parameterWorkerThread: stftWorkerThread = (value != 0.0f); break;
+        }
+
+        updateStft();
+    }
+
+    /** Set by the audio thread from the quality governor, which halves the overlap
+        of the frames for every step of reduction. Not in the low latency and worker
+        thread modes, where the latency depends on the hop size. Offline renders set
+        it to -1, which doubles the overlap up to 16. Returns true when it changes,
+        for the caller to set the overlap again from another thread, which builds an
+        engine with it.
+    */
+    bool setQualityReduction (const int newQualityReduction) noexcept
+    {
+        return stftQualityReduction.exchange (newQualityReduction, std::memory_order_relaxed) != newQualityReduction;
+    }
+
+    /** Where the engines send the spectrum of their frames. To be set before
+        prepare().
+    */
+    void setSpectrumMeter (MeterSource<SpectrumFrame>* newSpectrumMeter)
+    {
+        spectrumMeter = newSpectrumMeter;
+    }
+
+    /** The latency of the last engine built, and its FFT size. */
+    int getLatencySamples() const noexcept  { return latencySamples; }
+    int getFftSize() const noexcept         { return stftFftSize; }
+
+    /** Processes numSamples samples of numChannels channels in place. */
+    void process (float* const* channels, const int numChannels, const int numSamples) noexcept
+    {
+        AudioSampleBuffer block (channels, numChannels, numSamples);
+
+        const int currentEffect = effect;
+        stft.processBlock (block, [currentEffect] (RobotizationWhisperization& engine) {
+            engine.setEffect (currentEffect);
+        });
+    }
+
+    void addMemoryFootprint (MemoryFootprint& footprint) const
+    {
+        const ScopedLock lock (configurationLock);
+        stft.addMemoryFootprint (footprint);
+    }
+
+    /** Frees the engine that the last change of the FFT settings retired. */
+    void trimMemory()
+    {
+        const ScopedLock lock (configurationLock);
+        stft.trim();
+    }
+
+private:
+    //==============================================================================
+
+    void updateStft()
+    {
+        // Called by setParameter() before prepare() too, when there is nothing to
+        // configure yet
+        if (stftNumChannels == 0)
+            return;
+
+        RobotizationWhisperization* newStft = new RobotizationWhisperization;
+        newStft->setup (stftNumChannels);
+        newStft->setSpectrumMeter (spectrumMeter);
+        int overlap = stftHopSize;
+        if (! stftLowLatency && ! stftWorkerThread) {
+            const int qualityReduction = stftQualityReduction.load (std::memory_order_relaxed);
+            overlap = (qualityReduction < 0) ? jmin (16, overlap << 1) : jmax (2, overlap >> qualityReduction);
+        }
+
+        newStft->updateParameters (stftFftSize,
+                                   overlap,
+                                   stftWindowType,
+                                   stftLowLatency,
+                                   stftWorkerThread);
+        latencySamples = newStft->getLatencySamples();
+        stft.publish (newStft);
+    }
+
+    //==============================================================================
+
+    /** The configuration of the engines that updateStft() builds, only touched
+        under configurationLock.
+    */
+    CriticalSection configurationLock;
+    int stftNumChannels = 0;
+    int stftFftSize = 512;
+    int stftHopSize = 8;
+    int stftWindowType = STFT::windowTypeHann;
+    bool stftLowLatency = false;
+    bool stftWorkerThread = false;
+    int latencySamples = 0;
+    DoubleBufferedSTFT<RobotizationWhisperization> stft;
+
+    std::atomic<int> stftQualityReduction { 0 };
+    int effect = effectPassThrough;
+
+    MeterSource<SpectrumFrame>* spectrumMeter = nullptr;
+};
+
+//==============================================================================
+
+inline void RobotizationWhisperizationDSP::RobotizationWhisperization::processFrames()
+{
+    if (pairedFftSize == 0) {
+        STFT::processFrames();
+        return;
+    }
+
+    TRACE_SCOPE ("STFT frames");
+    currentInputBufferWritePosition = frameInputBufferWritePosition;
+    currentOutputBufferWritePosition = frameOutputBufferWritePosition;
+
+    float* leftFrame = channelFrames.getWritePointer (0);
+    float* rightFrame = channelFrames.getWritePointer (1);
+
+    analysis (0, leftFrame);
+    analysis (1, rightFrame);
+    for (int index = 0; index < fftSize; ++index)
+        pairedFrame[index] = dsp::Complex<float> (leftFrame[index], rightFrame[index]);
+
+    fft->perform (pairedFrame, pairedSpectrum, false);
+    splitPairedSpectrum();
+
+    for (int channel = 0; channel < 2; ++channel) {
+        dsp::Complex<float>* bins = channelBins + channel * numBins;
+        meterSpectrum (channel, bins);
+        extractFeatures (channel, bins);
+        modifyBins (channel, reinterpret_cast<float*> (bins));
+    }
+
+    joinPairedSpectrum();
+    fft->perform (pairedSpectrum, pairedFrame, true);
+
+    for (int index = 0; index < fftSize; ++index) {
+        leftFrame[index] = pairedFrame[index].real();
+        rightFrame[index] = pairedFrame[index].imag();
+    }
+
+    synthesis (0, leftFrame);
+    synthesis (1, rightFrame);
+    advanceOutputBufferWritePosition();
+
+    publishFeatures();
+}
+
+inline void RobotizationWhisperizationDSP::RobotizationWhisperization::splitPairedSpectrum() noexcept
+{
+    // With Z the spectrum of l + i r, L[k] = (Z[k] + conj (Z[N - k])) / 2 and
+    // R[k] = (Z[k] - conj (Z[N - k])) / 2i
+    const float* spectrum = reinterpret_cast<const float*> (pairedSpectrum.getData());
+    float* left = reinterpret_cast<float*> (channelBins.getData());
+    float* right = left + 2 * numBins;
+
+    for (int bin = 0; bin < numBins; ++bin) {
+        const int mirror = (bin == 0) ? 0 : fftSize - bin;
+        const float real = spectrum[2 * bin];
+        const float imag = spectrum[2 * bin + 1];
+        const float mirrorReal = spectrum[2 * mirror];
+        const float mirrorImag = spectrum[2 * mirror + 1];
+
+        left[2 * bin] = 0.5f * (real + mirrorReal);
+        left[2 * bin + 1] = 0.5f * (imag - mirrorImag);
+        right[2 * bin] = 0.5f * (imag + mirrorImag);
+        right[2 * bin + 1] = 0.5f * (mirrorReal - real);
+    }
+}
+
+inline void RobotizationWhisperizationDSP::RobotizationWhisperization::joinPairedSpectrum() noexcept
+{
+    // The inverse of the real-only transform keeps only the real parts of the bins
+    // at 0 and fftSize / 2, so both channels drop the imaginary ones there too.
+    // Every other bin k of L + i R, and its mirror N - k from the conjugates, is
+    // (a - d, b + c) and (a + d, c - b) with L[k] = (a, b) and R[k] = (c, d).
+    float* left = reinterpret_cast<float*> (channelBins.getData());
+    float* right = left + 2 * numBins;
+    float* spectrum = reinterpret_cast<float*> (pairedSpectrum.getData());
+
+    const int nyquist = numBins - 1;
+    left[1] = right[1] = 0.0f;
+    left[2 * nyquist + 1] = right[2 * nyquist + 1] = 0.0f;
+
+    for (int bin = 0; bin < numBins; ++bin) {
+        const float a = left[2 * bin];
+        const float b = left[2 * bin + 1];
+        const float c = right[2 * bin];
+        const float d = right[2 * bin + 1];
+
+        spectrum[2 * bin] = a - d;
+        spectrum[2 * bin + 1] = b + c;
+
+        if (bin > 0 && bin < nyquist) {
+            const int mirror = fftSize - bin;
+            spectrum[2 * mirror] = a + d;
+            spectrum[2 * mirror + 1] = c - b;
+        }
+    }
+}
+
+//==============================================================================
@@ -0,0 +1,136 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+
+/** Bytes of memory held by an instance of an effect, by what they are for.
+
+    The effects fill it from getMemoryFootprint() with the sizes of their heap
+    buffers, and their instance itself as other. Tables shared between instances,
+    such as FFT plans and windows, are counted in full by every instance that uses
+    them, so the sum over a session overestimates them.
+*/
+class MemoryFootprint
+{
+public:
+    enum Category {
+        delayLines = 0,
+        spectralBuffers,
+        fftPlans,
+        windows,
+        filters,
+        other,
+        numCategories
+    };
+
+    static String getCategoryName (const Category category)
+    {
+        switch (category) {
+            case delayLines: return "Delay lines";
+            case spectralBuffers: return "Spectral buffers";
+            case fftPlans: return "FFT plans";
+            case windows: return "Windows";
+            case filters: return "Filters";
+            default: return "Other";
+        }
+    }
+
+    //======================================
+
+    void add (const Category category, const size_t numBytes) noexcept
+    {
+        bytes[category] += numBytes;
+    }
+
+    /** Any buffer of channels of samples, an AudioBuffer or a DelayBuffer. */
+    template <template <typename> class BufferType, typename SampleType>
+    void add (const Category category, const BufferType<SampleType>& buffer) noexcept
+    {
+        add (category, (size_t)buffer.getNumChannels() * (size_t)buffer.getNumSamples() * sizeof (SampleType));
+    }
+
+    /** JUCE does not tell how much a dsp::FFT holds, so this counts its tables as
+        about twice as many complex values as the transform has points.
+    */
+    void addFftPlan (const int fftSize) noexcept
+    {
+        add (fftPlans, 2 * (size_t)fftSize * sizeof (dsp::Complex<float>));
+    }
+
+    void add (const MemoryFootprint& other) noexcept
+    {
+        for (int category = 0; category < numCategories; ++category)
+            bytes[category] += other.bytes[category];
+    }
+
+    size_t getBytes (const Category category) const noexcept
+    {
+        return bytes[category];
+    }
+
+    size_t getTotalBytes() const noexcept
+    {
+        size_t total = 0;
+        for (int category = 0; category < numCategories; ++category)
+            total += bytes[category];
+        return total;
+    }
+
+    /** One line of the categories that hold anything, and the total. */
+    String toString() const
+    {
+        String text;
+        for (int category = 0; category < numCategories; ++category)
+            if (bytes[category] > 0)
+                text << getCategoryName ((Category)category) << ": " << File::descriptionOfSizeInBytes ((int64)bytes[category]) << ", ";
+
+        return text + "total: " + File::descriptionOfSizeInBytes ((int64)getTotalBytes());
+    }
+
+private:
+    size_t bytes[numCategories] = {};
+};
+
+//==============================================================================
+
+/** Implemented by the processors of the effects, so a host that builds them in,
+    such as Chain or the benchmark, can find it with a dynamic_cast.
+*/
+class MemoryFootprintSource
+{
+public:
+    virtual ~MemoryFootprintSource() {}
+
+    /** Not to be called from the audio thread. */
+    virtual MemoryFootprint getMemoryFootprint() const = 0;
+
+    /** Frees what the current settings do not need, from the message thread. What
+        is trimmed depends on the effect, and nothing is by default.
+    */
+    virtual void trimMemory() {}
+};
+
+//==============================================================================
@@ -0,0 +1,234 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+#include <cmath>
+
+//==============================================================================
+
+/** Wait-free queue of metering frames from one producer, the audio thread, to one
+    consumer, the timer of the editor. push() and pop() never lock or allocate, and
+    push() drops the frame when the queue is full.
+
+    Metering is off until the editor enables it, and the producer checks
+    isEnabled() first, so without an editor the audio path only pays for that one
+    relaxed load.
+*/
+template <typename Frame, int capacity = 8>
+class MeteringFifo
+{
+public:
+    static_assert ((capacity & (capacity - 1)) == 0, "The capacity must be a power of two");
+
+    /** Called by the consumer. Whatever was queued before is discarded. */
+    void setEnabled (const bool shouldBeEnabled) noexcept
+    {
+        readCount.store (writeCount.load (std::memory_order_acquire), std::memory_order_release);
+        enabled.store (shouldBeEnabled, std::memory_order_release);
+    }
+
+    bool isEnabled() const noexcept
+    {
+        return enabled.load (std::memory_order_relaxed);
+    }
+
+    int getNumReady() const noexcept
+    {
+        return (int)(writeCount.load (std::memory_order_acquire) - readCount.load (std::memory_order_acquire));
+    }
+
+    bool push (const Frame& frame) noexcept
+    {
+        const uint32 write = writeCount.load (std::memory_order_relaxed);
+        if (write - readCount.load (std::memory_order_acquire) >= (uint32)capacity)
+            return false;
+
+        frames[write & (capacity - 1)] = frame;
+        writeCount.store (write + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop (Frame& frame) noexcept
+    {
+        const uint32 read = readCount.load (std::memory_order_relaxed);
+        if (read == writeCount.load (std::memory_order_acquire))
+            return false;
+
+        frame = frames[read & (capacity - 1)];
+        readCount.store (read + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    Frame frames[capacity];
+    std::atomic<uint32> writeCount { 0 };
+    std::atomic<uint32> readCount { 0 };
+    std::atomic<bool> enabled { false };
+};
+
+//==============================================================================
+
+/** Producer end of a metering FIFO that decimates to the pace of its consumer. The
+    frames added while the editor has not taken the last one are merged into a
+    pending frame, keeping their maximum values, so no peak is lost however short
+    the blocks are, and at most one frame is queued per editor refresh.
+*/
+template <typename Frame>
+class MeterSource
+{
+public:
+    /** Called by the editor when it opens and closes. */
+    void setEnabled (const bool shouldBeEnabled) noexcept
+    {
+        fifo.setEnabled (shouldBeEnabled);
+    }
+
+    /** Called by the producer before add(). A frame left pending from before the
+        editor closed is dropped here.
+    */
+    bool isActive() noexcept
+    {
+        const bool active = fifo.isEnabled();
+        if (! active)
+            hasPending = false;
+        return active;
+    }
+
+    /** Called by the producer only while isActive(). */
+    void add (const Frame& frame) noexcept
+    {
+        if (hasPending)
+            pending.merge (frame);
+        else
+            pending = frame;
+
+        hasPending = ! (fifo.getNumReady() == 0 && fifo.push (pending));
+    }
+
+    /** Called by the consumer. Merges all the queued frames into frame, and returns
+        false if there were none.
+    */
+    bool collect (Frame& frame) noexcept
+    {
+        Frame next;
+        if (! fifo.pop (frame))
+            return false;
+
+        while (fifo.pop (next))
+            frame.merge (next);
+        return true;
+    }
+
+private:
+    MeteringFifo<Frame> fifo;
+    Frame pending;
+    bool hasPending = false;
+};
+
+//==============================================================================
+
+/** Peak levels of a block before and after processing, and the largest gain
+    reduction in dB.
+*/
+struct LevelFrame
+{
+    float inputPeak = 0.0f;
+    float outputPeak = 0.0f;
+    float gainReduction = 0.0f;
+
+    void merge (const LevelFrame& other) noexcept
+    {
+        inputPeak = jmax (inputPeak, other.inputPeak);
+        outputPeak = jmax (outputPeak, other.outputPeak);
+        gainReduction = jmax (gainReduction, other.gainReduction);
+    }
+};
+
+//==============================================================================
+
+/** Power spectrum of an analysis frame in numBands bands, spaced logarithmically
+    over the ten octaves below Nyquist. A bin of a full scale sinusoid reads 1.
+*/
+struct SpectrumFrame
+{
+    enum {
+        numBands = 64,
+        numOctaves = 10,
+    };
+
+    float power[numBands] = {};
+
+    void merge (const SpectrumFrame& other) noexcept
+    {
+        for (int band = 0; band < numBands; ++band)
+            power[band] = jmax (power[band], other.power[band]);
+    }
+
+    /** Lower edge of a band as a fraction of Nyquist, band numBands being Nyquist. */
+    static float getBandEdge (const int band) noexcept
+    {
+        return std::exp2 ((float)numOctaves * ((float)band / (float)numBands - 1.0f));
+    }
+};
+
+/** Reduces the numBins bins of a real-only transform to the bands of a
+    SpectrumFrame, keeping the strongest bin of each band. A band narrower than a
+    bin takes the bin it falls in.
+*/
+class SpectrumReducer
+{
+public:
+    /** Not to be called from the audio thread. */
+    void prepare (const int newNumBins, const float newScale)
+    {
+        numBins = newNumBins;
+        scale = newScale;
+
+        for (int band = 0; band <= SpectrumFrame::numBands; ++band)
+            firstBins[band] = (int)std::ceil (SpectrumFrame::getBandEdge (band) * (float)(numBins - 1));
+    }
+
+    void reduce (const dsp::Complex<float>* bins, SpectrumFrame& frame) const noexcept
+    {
+        for (int band = 0; band < SpectrumFrame::numBands; ++band) {
+            const int first = jmin (firstBins[band], numBins - 1);
+            const int last = jmax (first + 1, jmin (firstBins[band + 1], numBins));
+
+            float power = 0.0f;
+            for (int bin = first; bin < last; ++bin)
+                power = jmax (power, std::norm (bins[bin]));
+
+            frame.power[band] = power * scale;
+        }
+    }
+
+private:
+    int numBins = 1;
+    float scale = 1.0f;
+    int firstBins[SpectrumFrame::numBands + 1] = {};
+};
+
+//==============================================================================
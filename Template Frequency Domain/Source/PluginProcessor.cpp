@@ -43,35 +43,41 @@ TemplateFrequencyDomainAudioProcessor::TemplateFrequencyDomainAudioProcessor():
     parameters (*this)
     , paramFftSize (parameters, "FFT size", fftSizeItemsUI, fftSize512,
                     [this](float value){
-                        const ScopedLock sl (lock);
                         value = (float)(1 << ((int)value + 5));
-                        paramFftSize.setCurrentAndTargetValue (value);
-                        stft.updateParameters((int)paramFftSize.getTargetValue(),
-                                              (int)paramHopSize.getTargetValue(),
-                                              (int)paramWindowType.getTargetValue());
+                        setEngineParameter (TemplateFrequencyDomainDSP::parameterFftSize, value);
                         return value;
                     })
     , paramHopSize (parameters, "Hop size", hopSizeItemsUI, hopSize8,
                     [this](float value){
-                        const ScopedLock sl (lock);
                         value = (float)(1 << ((int)value + 1));
-                        paramHopSize.setCurrentAndTargetValue (value);
-                        stft.updateParameters((int)paramFftSize.getTargetValue(),
-                                              (int)paramHopSize.getTargetValue(),
-                                              (int)paramWindowType.getTargetValue());
+                        setEngineParameter (TemplateFrequencyDomainDSP::parameterOverlap, value);
                         return value;
                     })
     , paramWindowType (parameters, "Window type", windowTypeItemsUI, STFT::windowTypeHann,
                        [this](float value){
-                           const ScopedLock sl (lock);
-                           paramWindowType.setCurrentAndTargetValue (value);
-                           stft.updateParameters((int)paramFftSize.getTargetValue(),
-                                                 (int)paramHopSize.getTargetValue(),
-                                                 (int)paramWindowType.getTargetValue());
+                           setEngineParameter (TemplateFrequencyDomainDSP::parameterWindowType, value);
                            return value;
                        })
+    , paramLowLatency (parameters, "Low latency", false,
+                       [this](float value){
+                           setEngineParameter (TemplateFrequencyDomainDSP::parameterLowLatency, value);
+                           return value;
+                       })
+    , paramWorkerThread (parameters, "Worker thread", false,
+                         [this](float value){
+                             setEngineParameter (TemplateFrequencyDomainDSP::parameterWorkerThread, value);
+                             return value;
+                         })
+    , bypass (*this, parameters)
 {
     parameters.apvts.state = ValueTree (Identifier (getName().removeCharacters ("- ")));
+
+    // Each of these builds a new STFT engine
+    paramFftSize.deferCallback();
+    paramHopSize.deferCallback();
+    paramWindowType.deferCallback();
+    paramLowLatency.deferCallback();
+    paramWorkerThread.deferCallback();
 }
 
 TemplateFrequencyDomainAudioProcessor::~TemplateFrequencyDomainAudioProcessor()
@@ -82,26 +88,46 @@ TemplateFrequencyDomainAudioProcessor::~TemplateFrequencyDomainAudioProcessor()
 
 void TemplateFrequencyDomainAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
+    TRACE_INSTANCE_SCOPE ("prepareToPlay", this);
+
     const double smoothTime = 1e-3;
     paramFftSize.reset (sampleRate, smoothTime);
     paramHopSize.reset (sampleRate, smoothTime);
     paramWindowType.reset (sampleRate, smoothTime);
+    paramLowLatency.reset (sampleRate, smoothTime);
+    paramWorkerThread.reset (sampleRate, smoothTime);
 
     //======================================
 
-    stft.setup (getTotalNumInputChannels());
-    stft.updateParameters((int)paramFftSize.getTargetValue(),
-                          (int)paramHopSize.getTargetValue(),
-                          (int)paramWindowType.getTargetValue());
+    parameters.flushDeferredCallbacks();
+
+    {
+        // In the order of the latencies that the deferred callbacks report
+        const ScopedLock lock (parameters.deferredCallbackLock);
+        templateFrequencyDomain.setSpectrumMeter (&spectrumMeter);
+        templateFrequencyDomain.setFeatureStream (&spectralFeatures);
+        templateFrequencyDomain.prepare (sampleRate, getTotalNumInputChannels(), samplesPerBlock);
+        setLatencySamples (templateFrequencyDomain.getLatencySamples());
+    }
+
+    profiler.prepare (sampleRate);
+    silenceDetector.prepare (sampleRate);
+    bypass.prepare (sampleRate, samplesPerBlock, 2 * (1 << (fftSize8192 + 5)));
 }
 
 void TemplateFrequencyDomainAudioProcessor::releaseResources()
 {
 }
 
+void TemplateFrequencyDomainAudioProcessor::reset()
+{
+    templateFrequencyDomain.reset();
+}
+
 void TemplateFrequencyDomainAudioProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
 {
-    const ScopedLock sl (lock);
+    const ProcessBlockProfiler::ScopedMeasurement measurement (profiler, buffer.getNumSamples(), isNonRealtime());
+    TRACE_INSTANCE_SCOPE ("processBlock", this);
 
     ScopedNoDenormals noDenormals;
 
@@ -111,12 +137,31 @@ void TemplateFrequencyDomainAudioProcessor::processBlock (AudioSampleBuffer& buf
 
     //======================================
 
-    stft.processBlock (buffer);
+    parameters.applyDeferredValues();
+    parameters.applySnapshotMorph();
+
+    if (silenceDetector.skipBlock (*this, buffer))
+        return;
+
+    if (bypass.begin (buffer))
+        return;
+
+    templateFrequencyDomain.process (buffer.getArrayOfWritePointers(), numInputChannels, numSamples);
 
     //======================================
 
     for (int channel = numInputChannels; channel < numOutputChannels; ++channel)
         buffer.clear (channel, 0, numSamples);
+
+    bypass.end (buffer);
+}
+
+//==============================================================================
+
+void TemplateFrequencyDomainAudioProcessor::setEngineParameter (const int index, const float value)
+{
+    templateFrequencyDomain.setParameter (index, value);
+    setLatencySamples (templateFrequencyDomain.getLatencySamples());
 }
 
 //==============================================================================
@@ -130,13 +175,17 @@ void TemplateFrequencyDomainAudioProcessor::processBlock (AudioSampleBuffer& buf
 
 void TemplateFrequencyDomainAudioProcessor::getStateInformation (MemoryBlock& destData)
 {
-    auto state = parameters.apvts.copyState();
-    std::unique_ptr<XmlElement> xml (state.createXml());
-    copyXmlToBinary (*xml, destData);
+    MemoryOutputStream stream (destData, false);
+    parameters.writeState (stream);
 }
 
 void TemplateFrequencyDomainAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
+    MemoryInputStream stream (data, (size_t)sizeInBytes, false);
+    if (parameters.readState (stream))
+        return;
+
+    // Sessions saved in the XML format of older versions
     std::unique_ptr<XmlElement> xmlState (getXmlFromBinary (data, sizeInBytes));
 
     if (xmlState.get() != nullptr)
@@ -165,10 +214,9 @@ bool TemplateFrequencyDomainAudioProcessor::isBusesLayoutSupported (const BusesL
     ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    if (layouts.getMainOutputChannelSet() != AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != AudioChannelSet::stereo())
+    // The channels are processed independently, so any layout with at least one
+    // channel is supported, from mono to surround sets or ambisonic stems.
+    if (layouts.getMainOutputChannelSet().isDisabled())
         return false;
 
     // This checks if the input layout matches the output layout
@@ -218,7 +266,13 @@ bool TemplateFrequencyDomainAudioProcessor::isMidiEffect() const
 
 double TemplateFrequencyDomainAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // Past the latency, the last frame that saw the input still has to be overlapped
+    return (double)templateFrequencyDomain.getFftSize() / jmax (1.0, getSampleRate());
+}
+
+AudioProcessorParameter* TemplateFrequencyDomainAudioProcessor::getBypassParameter() const
+{
+    return bypass.getParameter();
 }
 
 //==============================================================================
@@ -249,6 +303,26 @@ void TemplateFrequencyDomainAudioProcessor::changeProgramName (int index, const
 
 //==============================================================================
 
+MemoryFootprint TemplateFrequencyDomainAudioProcessor::getMemoryFootprint() const
+{
+    const ScopedLock lock (parameters.deferredCallbackLock);
+
+    MemoryFootprint footprint;
+    footprint.add (MemoryFootprint::other, sizeof (*this));
+    bypass.addMemoryFootprint (footprint);
+
+    templateFrequencyDomain.addMemoryFootprint (footprint);
+
+    return footprint;
+}
+
+void TemplateFrequencyDomainAudioProcessor::trimMemory()
+{
+    templateFrequencyDomain.trimMemory();
+}
+
+//==============================================================================
+
 // This creates new instances of the plugin..
 AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
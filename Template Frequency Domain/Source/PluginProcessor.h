@@ -30,11 +30,15 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "PluginParameter.h"
-#include "STFT.h"
+#include "ProcessBlockProfiler.h"
+#include "SilenceDetector.h"
+#include "PluginBypass.h"
+#include "MemoryFootprint.h"
+#include "TemplateFrequencyDomainDSP.h"
 
 //==============================================================================
 
-class TemplateFrequencyDomainAudioProcessor : public AudioProcessor
+class TemplateFrequencyDomainAudioProcessor : public AudioProcessor, public MemoryFootprintSource
 {
 public:
     //==============================================================================
@@ -46,6 +50,7 @@ public:
 
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
+    void reset() override;
     void processBlock (AudioSampleBuffer&, MidiBuffer&) override;
 
     //==============================================================================
@@ -79,6 +84,7 @@ public:
     bool producesMidi() const override;
     bool isMidiEffect () const override;
     double getTailLengthSeconds() const override;
+    AudioProcessorParameter* getBypassParameter() const override;
 
     //==============================================================================
 
@@ -90,10 +96,10 @@ public:
 
     //==============================================================================
 
+    MemoryFootprint getMemoryFootprint() const override;
 
-
-
-
+    /** Frees the engine that the last change of the FFT settings retired. */
+    void trimMemory() override;
 
     //==============================================================================
 
@@ -146,33 +152,27 @@ public:
 
     //======================================
 
-    class PassThrough : public STFT
-    {
-    private:
-        void modification() override
-        {
-            fft->perform (timeDomainBuffer, frequencyDomainBuffer, false);
-
-            for (int index = 0; index < fftSize / 2 + 1; ++index) {
-                float magnitude = abs (frequencyDomainBuffer[index]);
-                float phase = arg (frequencyDomainBuffer[index]);
-
-                frequencyDomainBuffer[index].real (magnitude * cosf (phase));
-                frequencyDomainBuffer[index].imag (magnitude * sinf (phase));
-                if (index > 0 && index < fftSize / 2) {
-                    frequencyDomainBuffer[fftSize - index].real (magnitude * cosf (phase));
-                    frequencyDomainBuffer[fftSize - index].imag (magnitude * sinf (-phase));
-                }
-            }
-
-            fft->perform (frequencyDomainBuffer, timeDomainBuffer, true);
-        }
-    };
+    /** Hands a setting of the engines to the core, which builds a new one, and
+        reports its latency. The FFT size, hop size, window type, low latency and
+        worker thread callbacks are deferred to the parameters' background worker.
+    */
+    void setEngineParameter (const int index, const float value);
+
+    TemplateFrequencyDomainDSP templateFrequencyDomain;
 
     //======================================
 
-    CriticalSection lock;
-    PassThrough stft;
+    // Input spectrum for the editor, from the frames of every STFT engine
+    MeterSource<SpectrumFrame> spectrumMeter;
+
+    // Band energies and centroid of every analysis frame, for a consumer thread
+    // that enables it and pops them, such as an analytics pipeline
+    SpectralFeatureStream spectralFeatures;
+
+    //======================================
+
+    ProcessBlockProfiler profiler;
+    SilenceDetector silenceDetector;
 
     //======================================
 
@@ -181,6 +181,10 @@ public:
     PluginParameterComboBox paramFftSize;
     PluginParameterComboBox paramHopSize;
     PluginParameterComboBox paramWindowType;
+    PluginParameterToggle paramLowLatency;
+    PluginParameterToggle paramWorkerThread;
+
+    PluginBypass bypass;
 
 private:
     //==============================================================================
@@ -0,0 +1,167 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "MeteringFifo.h"
+#include <atomic>
+#include <cmath>
+
+//==============================================================================
+
+/** Spectral features of the analysis frame of one channel, for consumers such as
+    an analytics pipeline that would otherwise transform the signal again.
+
+    The energies are in the scale of SpectrumFrame, where a bin of a full scale
+    sinusoid reads 1. The bands are spaced logarithmically over the ten octaves
+    below Nyquist, the first one down to DC. The centroid is a fraction of Nyquist,
+    zero for a silent frame.
+*/
+struct SpectralFeatureFrame
+{
+    enum {
+        numBands = 20,
+        numOctaves = 10,
+    };
+
+    /** Hops since the engine started. A new engine starts again from zero. */
+    uint32 frameIndex = 0;
+    int channel = 0;
+    int hopSize = 0;
+
+    float bandEnergy[numBands] = {};
+    float totalEnergy = 0.0f;
+    float centroid = 0.0f;
+
+    /** Lower edge of a band as a fraction of Nyquist, band numBands being Nyquist. */
+    static float getBandEdge (const int band) noexcept
+    {
+        return std::exp2 ((float)numOctaves * ((float)band / (float)numBands - 1.0f));
+    }
+};
+
+//==============================================================================
+
+/** Wait-free stream of feature frames from an STFT engine to one consumer thread,
+    at the frame rate. Nothing is extracted until the consumer enables it, and the
+    frames it does not pop in time are dropped and counted, never waited for.
+*/
+class SpectralFeatureStream
+{
+public:
+    enum { capacity = 256 };
+
+    /** Called by the consumer. Whatever was queued before is discarded. */
+    void setEnabled (const bool shouldBeEnabled) noexcept
+    {
+        fifo.setEnabled (shouldBeEnabled);
+    }
+
+    bool isEnabled() const noexcept
+    {
+        return fifo.isEnabled();
+    }
+
+    /** Called by the engine that processes the frames. While one engine fades out
+        for another, a frame pushed by both at once is dropped rather than waited for.
+    */
+    void push (const SpectralFeatureFrame& frame) noexcept
+    {
+        if (pushing.exchange (true, std::memory_order_acquire)) {
+            numDropped.fetch_add (1, std::memory_order_relaxed);
+            return;
+        }
+
+        if (! fifo.push (frame))
+            numDropped.fetch_add (1, std::memory_order_relaxed);
+
+        pushing.store (false, std::memory_order_release);
+    }
+
+    /** Called by the consumer, until it returns false. */
+    bool pop (SpectralFeatureFrame& frame) noexcept
+    {
+        return fifo.pop (frame);
+    }
+
+    uint32 getNumDropped() const noexcept
+    {
+        return numDropped.load (std::memory_order_relaxed);
+    }
+
+private:
+    MeteringFifo<SpectralFeatureFrame, capacity> fifo;
+    std::atomic<bool> pushing { false };
+    std::atomic<uint32> numDropped { 0 };
+};
+
+//==============================================================================
+
+/** Works out the features of a SpectralFeatureFrame from the numBins bins of a
+    real-only transform, in one pass over them.
+*/
+class SpectralFeatureExtractor
+{
+public:
+    /** Not to be called from the audio thread. */
+    void prepare (const int newNumBins, const float newScale)
+    {
+        numBins = newNumBins;
+        scale = newScale;
+
+        firstBins[0] = 0;
+        for (int band = 1; band <= SpectralFeatureFrame::numBands; ++band)
+            firstBins[band] = jmin (numBins, (int)std::ceil (SpectralFeatureFrame::getBandEdge (band) * (float)(numBins - 1)));
+        firstBins[SpectralFeatureFrame::numBands] = numBins;
+    }
+
+    void extract (const dsp::Complex<float>* bins, SpectralFeatureFrame& frame) const noexcept
+    {
+        float totalEnergy = 0.0f;
+        float weightedEnergy = 0.0f;
+
+        for (int band = 0; band < SpectralFeatureFrame::numBands; ++band) {
+            float energy = 0.0f;
+            for (int bin = firstBins[band]; bin < firstBins[band + 1]; ++bin) {
+                const float power = std::norm (bins[bin]);
+                energy += power;
+                weightedEnergy += (float)bin * power;
+            }
+
+            frame.bandEnergy[band] = energy * scale;
+            totalEnergy += energy;
+        }
+
+        frame.totalEnergy = totalEnergy * scale;
+        frame.centroid = (totalEnergy > 0.0f && numBins > 1)
+                       ? weightedEnergy / (totalEnergy * (float)(numBins - 1))
+                       : 0.0f;
+    }
+
+private:
+    int numBins = 1;
+    float scale = 1.0f;
+    int firstBins[SpectralFeatureFrame::numBands + 1] = {};
+};
+
+//==============================================================================
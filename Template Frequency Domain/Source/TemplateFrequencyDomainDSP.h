@@ -0,0 +1,188 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "MemoryFootprint.h"
+#include "STFT.h"
+
+//==============================================================================
+
+/** The audio processing of the Template Frequency Domain, without the parameters,
+    state, editor or buses of the plugin, for hosts that only need the audio and run
+    many instances. TemplateFrequencyDomainAudioProcessor wraps one and hands it the
+    values of its parameters in their natural units: the FFT size in samples, the
+    overlap as the number of hops in a window, the index of the window type, and the
+    low latency and worker thread modes as 0 or 1.
+
+    All of them build a new STFT engine, so setParameter() is not real-time safe.
+    It is meant for another thread than process(), which picks the new engine up
+    without locks through a DoubleBufferedSTFT. The configuration is kept under a
+    lock of its own, so that several threads can change it.
+*/
+class TemplateFrequencyDomainDSP
+{
+public:
+    enum parameterIndex {
+        parameterFftSize = 0,
+        parameterOverlap,
+        parameterWindowType,
+        parameterLowLatency,
+        parameterWorkerThread,
+        numParameters,
+    };
+
+    //======================================
+
+    class PassThrough : public STFT
+    {
+    private:
+        void modification (const int channel) override
+        {
+            // Magnitudes and phases in separate arrays, converted back after this
+            SpectralFrame& frame = getSpectralFrame();
+            float* magnitude = frame.getMagnitude();
+            float* phase = frame.getPhase();
+            for (int index = 0; index < frame.getNumBins(); ++index) {
+                magnitude[index] = magnitude[index];
+                phase[index] = phase[index];
+            }
+        }
+    };
+
+    //======================================
+
+    /** Builds the first engine, for blocks of up to maxBlockSize samples. Not
+        real-time safe.
+    */
+    void prepare (const double sampleRate, const int numChannels, const int maxBlockSize)
+    {
+        const ScopedLock lock (configurationLock);
+        stftNumChannels = numChannels;
+        stft.prepare (stftNumChannels, maxBlockSize, sampleRate);
+        updateStft();
+    }
+
+    /** Clears the active engine. Real-time safe. */
+    void reset() noexcept
+    {
+        stft.reset();
+    }
+
+    /** Builds a new engine. Not real-time safe. */
+    void setParameter (const int index, const float value)
+    {
+        const ScopedLock lock (configurationLock);
+
+        switch (index) {
+            case parameterFftSize:      stftFftSize = (int)value; break;
+            case parameterOverlap:      stftHopSize = (int)value; break;
+            case parameterWindowType:   stftWindowType = (int)value; break;
+            case parameterLowLatency:   stftLowLatency = (value != 0.0f); break;
+            case parameterWorkerThread: stftWorkerThread = (value != 0.0f); break;
+        }
+
+        updateStft();
+    }
+
+    /** Where the engines send the spectrum and the features of their frames. To be
+        set before prepare().
+    */
+    void setSpectrumMeter (MeterSource<SpectrumFrame>* newSpectrumMeter)
+    {
+        spectrumMeter = newSpectrumMeter;
+    }
+
+    void setFeatureStream (SpectralFeatureStream* newFeatureStream)
+    {
+        featureStream = newFeatureStream;
+    }
+
+    /** The latency of the last engine built, and its FFT size. */
+    int getLatencySamples() const noexcept  { return latencySamples; }
+    int getFftSize() const noexcept         { return stftFftSize; }
+
+    /** Processes numSamples samples of numChannels channels in place. */
+    void process (float* const* channels, const int numChannels, const int numSamples) noexcept
+    {
+        AudioSampleBuffer block (channels, numChannels, numSamples);
+        stft.processBlock (block, [] (PassThrough&) {});
+    }
+
+    void addMemoryFootprint (MemoryFootprint& footprint) const
+    {
+        const ScopedLock lock (configurationLock);
+        stft.addMemoryFootprint (footprint);
+    }
+
+    /** Frees the engine that the last change of the FFT settings retired. */
+    void trimMemory()
+    {
+        const ScopedLock lock (configurationLock);
+        stft.trim();
+    }
+
+private:
+    //==============================================================================
+
+    void updateStft()
+    {
+        // Called by setParameter() before prepare() too, when there is nothing to
+        // configure yet
+        if (stftNumChannels == 0)
+            return;
+
+        PassThrough* newStft = new PassThrough;
+        newStft->setup (stftNumChannels);
+        newStft->setSpectrumMeter (spectrumMeter);
+        newStft->setFeatureStream (featureStream);
+        newStft->updateParameters (stftFftSize,
+                                   stftHopSize,
+                                   stftWindowType,
+                                   stftLowLatency,
+                                   stftWorkerThread);
+        latencySamples = newStft->getLatencySamples();
+        stft.publish (newStft);
+    }
+
+    //==============================================================================
+
+    /** The configuration of the engines that updateStft() builds, only touched
+        under configurationLock.
+    */
+    CriticalSection configurationLock;
+    int stftNumChannels = 0;
+    int stftFftSize = 512;
+    int stftHopSize = 8;
+    int stftWindowType = STFT::windowTypeHann;
+    bool stftLowLatency = false;
+    bool stftWorkerThread = false;
+    int latencySamples = 0;
+    DoubleBufferedSTFT<PassThrough> stft;
+
+    MeterSource<SpectrumFrame>* spectrumMeter = nullptr;
+    SpectralFeatureStream* featureStream = nullptr;
+};
+
+//==============================================================================
@@ -102,10 +102,15 @@ TemplateTimeDomainAudioProcessorEditor::TemplateTimeDomainAudioProcessorEditor (
 
     editorHeight += components.size() * editorPadding;
     setSize (editorWidth, editorHeight);
+    setOpaque (true);
+    setLookAndFeel (lookAndFeel);
+    renderingContext.attachTo (*this);
 }
 
 TemplateTimeDomainAudioProcessorEditor::~TemplateTimeDomainAudioProcessorEditor()
 {
+    renderingContext.detach();
+    setLookAndFeel (nullptr);
 }
 
 //==============================================================================
@@ -45,6 +45,7 @@ TemplateTimeDomainAudioProcessor::TemplateTimeDomainAudioProcessor():
     , parameter2 (parameters, "Parameter 2", "", 0.0f, 1.0f, 0.5f)
     , parameter3 (parameters, "Parameter 3", false, [](float value){ return value * (-2.0f) + 1.0f; })
     , parameter4 (parameters, "Parameter 4", {"Option A", "Option B"}, 1)
+    , bypass (*this, parameters)
 {
     parameters.apvts.state = ValueTree (Identifier (getName().removeCharacters ("- ")));
 }
@@ -57,11 +58,20 @@ TemplateTimeDomainAudioProcessor::~TemplateTimeDomainAudioProcessor()
 
 void TemplateTimeDomainAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
+    TRACE_INSTANCE_SCOPE ("prepareToPlay", this);
+
     const double smoothTime = 1e-3;
     parameter1.reset (sampleRate, smoothTime);
     parameter2.reset (sampleRate, smoothTime);
     parameter3.reset (sampleRate, smoothTime);
     parameter4.reset (sampleRate, smoothTime);
+
+    updateDSPParameters();
+    templateTimeDomain.prepare (sampleRate, smoothTime);
+
+    profiler.prepare (sampleRate);
+    silenceDetector.prepare (sampleRate);
+    bypass.prepare (sampleRate, samplesPerBlock, 0);
 }
 
 void TemplateTimeDomainAudioProcessor::releaseResources()
@@ -70,36 +80,19 @@ void TemplateTimeDomainAudioProcessor::releaseResources()
 
 void TemplateTimeDomainAudioProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
 {
+    const ProcessBlockProfiler::ScopedMeasurement measurement (profiler, buffer.getNumSamples(), isNonRealtime());
+    TRACE_INSTANCE_SCOPE ("processBlock", this);
     ScopedNoDenormals noDenormals;
 
+    parameters.applySnapshotMorph();
+
     const int numInputChannels = getTotalNumInputChannels();
     const int numOutputChannels = getTotalNumOutputChannels();
     const int numSamples = buffer.getNumSamples();
 
     //======================================
 
-    float currentParameter2 = parameter2.getNextValue();
-    float currentParameter3 = parameter3.getNextValue();
-    float currentParameter4 = parameter4.getNextValue();
-
-    float factor = currentParameter2 * currentParameter3 * currentParameter4;
-
-    for (int channel = 0; channel < numInputChannels; ++channel) {
-        float* channelData = buffer.getWritePointer (channel);
-
-        for (int sample = 0; sample < numSamples; ++sample) {
-            const float in = channelData[sample];
-            float out = in * factor;
-
-            channelData[sample] = out;
-        }
-    }
-
-    for (int channel = numInputChannels; channel < numOutputChannels; ++channel)
-        buffer.clear (channel, 0, numSamples);
-
-    //======================================
-
+    // Ahead of the audio, which returns early when it is silent or bypassed
     MidiBuffer processedMidi;
     for (const MidiMessageMetadata meta : midiMessages) {
         MidiMessage message = meta.getMessage();
@@ -113,6 +106,31 @@ void TemplateTimeDomainAudioProcessor::processBlock (AudioSampleBuffer& buffer,
     }
 
     midiMessages.swapWith (processedMidi);
+
+    //======================================
+
+    if (silenceDetector.skipBlock (*this, buffer))
+        return;
+
+    if (bypass.begin (buffer))
+        return;
+
+    updateDSPParameters();
+    templateTimeDomain.process (buffer.getArrayOfWritePointers(), numInputChannels, numSamples);
+
+    for (int channel = numInputChannels; channel < numOutputChannels; ++channel)
+        buffer.clear (channel, 0, numSamples);
+
+    bypass.end (buffer);
+}
+
+//==============================================================================
+
+void TemplateTimeDomainAudioProcessor::updateDSPParameters() noexcept
+{
+    templateTimeDomain.setParameter (TemplateTimeDomainDSP::parameterGain, parameter2.getTargetValue());
+    templateTimeDomain.setParameter (TemplateTimeDomainDSP::parameterSign, parameter3.getTargetValue());
+    templateTimeDomain.setParameter (TemplateTimeDomainDSP::parameterOption, parameter4.getTargetValue());
 }
 
 //==============================================================================
@@ -126,13 +144,17 @@ void TemplateTimeDomainAudioProcessor::processBlock (AudioSampleBuffer& buffer,
 
 void TemplateTimeDomainAudioProcessor::getStateInformation (MemoryBlock& destData)
 {
-    auto state = parameters.apvts.copyState();
-    std::unique_ptr<XmlElement> xml (state.createXml());
-    copyXmlToBinary (*xml, destData);
+    MemoryOutputStream stream (destData, false);
+    parameters.writeState (stream);
 }
 
 void TemplateTimeDomainAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
+    MemoryInputStream stream (data, (size_t)sizeInBytes, false);
+    if (parameters.readState (stream))
+        return;
+
+    // Sessions saved in the XML format of older versions
     std::unique_ptr<XmlElement> xmlState (getXmlFromBinary (data, sizeInBytes));
 
     if (xmlState.get() != nullptr)
@@ -161,10 +183,9 @@ bool TemplateTimeDomainAudioProcessor::isBusesLayoutSupported (const BusesLayout
     ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    if (layouts.getMainOutputChannelSet() != AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != AudioChannelSet::stereo())
+    // The channels are processed independently, so any layout with at least one
+    // channel is supported, from mono to surround sets or ambisonic stems.
+    if (layouts.getMainOutputChannelSet().isDisabled())
         return false;
 
     // This checks if the input layout matches the output layout
@@ -217,6 +238,11 @@ double TemplateTimeDomainAudioProcessor::getTailLengthSeconds() const
     return 0.0;
 }
 
+AudioProcessorParameter* TemplateTimeDomainAudioProcessor::getBypassParameter() const
+{
+    return bypass.getParameter();
+}
+
 //==============================================================================
 
 int TemplateTimeDomainAudioProcessor::getNumPrograms()
@@ -245,6 +271,19 @@ void TemplateTimeDomainAudioProcessor::changeProgramName (int index, const Strin
 
 //==============================================================================
 
+MemoryFootprint TemplateTimeDomainAudioProcessor::getMemoryFootprint() const
+{
+    const ScopedLock lock (parameters.deferredCallbackLock);
+
+    MemoryFootprint footprint;
+    footprint.add (MemoryFootprint::other, sizeof (*this));
+    bypass.addMemoryFootprint (footprint);
+
+    return footprint;
+}
+
+//==============================================================================
+
 // This creates new instances of the plugin..
 AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
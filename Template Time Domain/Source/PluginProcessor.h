@@ -30,10 +30,15 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "PluginParameter.h"
+#include "ProcessBlockProfiler.h"
+#include "SilenceDetector.h"
+#include "PluginBypass.h"
+#include "MemoryFootprint.h"
+#include "TemplateTimeDomainDSP.h"
 
 //==============================================================================
 
-class TemplateTimeDomainAudioProcessor : public AudioProcessor
+class TemplateTimeDomainAudioProcessor : public AudioProcessor, public MemoryFootprintSource
 {
 public:
     //==============================================================================
@@ -78,6 +83,7 @@ public:
     bool producesMidi() const override;
     bool isMidiEffect () const override;
     double getTailLengthSeconds() const override;
+    AudioProcessorParameter* getBypassParameter() const override;
 
     //==============================================================================
 
@@ -89,12 +95,21 @@ public:
 
     //==============================================================================
 
+    MemoryFootprint getMemoryFootprint() const override;
 
+    //==============================================================================
 
+    /** Hands the values of the parameters to the core, which ramps the gain. */
+    void updateDSPParameters() noexcept;
 
+    TemplateTimeDomainDSP templateTimeDomain;
 
+    //======================================
 
-    //==============================================================================
+    ProcessBlockProfiler profiler;
+    SilenceDetector silenceDetector;
+
+    //======================================
 
     PluginParametersManager parameters;
 
@@ -103,6 +118,8 @@ public:
     PluginParameterToggle parameter3;
     PluginParameterComboBox parameter4;
 
+    PluginBypass bypass;
+
 private:
     //==============================================================================
 
@@ -0,0 +1,140 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+/** Set to 1 to check the realtime safety of processBlock in release builds too,
+    or to 0 to leave it out of debug builds.
+*/
+#ifndef AUDIO_EFFECTS_REALTIME_CHECKS
+ #define AUDIO_EFFECTS_REALTIME_CHECKS JUCE_DEBUG
+#endif
+
+//==============================================================================
+
+/** Reports the heap allocations and mutex locks made by the audio thread.
+
+    ProcessBlockProfiler::ScopedMeasurement marks the thread as realtime for the
+    whole of every processBlock, and so do the workers that run parts of a block.
+    The operator new and delete of RealtimeSafety.cpp, and its pthread_mutex_lock on
+    Linux and macOS, call check() before they do their job, and the first violation
+    of every block is logged with the stack that made it and stops in the debugger.
+    Locks taken through a CriticalSection on Windows are not seen.
+
+    Operations that lock for a bounded time by design, like waking a worker thread,
+    run inside a ScopedExemption.
+*/
+class RealtimeSafety
+{
+public:
+    /** Marks the calling thread as realtime for the lifetime of the object. */
+    class ScopedRealtimeSection
+    {
+    public:
+        ScopedRealtimeSection() noexcept
+        {
+           #if AUDIO_EFFECTS_REALTIME_CHECKS
+            State& state = getState();
+            if (state.depth++ == 0)
+                state.reported = false;
+           #endif
+        }
+
+        ~ScopedRealtimeSection()
+        {
+           #if AUDIO_EFFECTS_REALTIME_CHECKS
+            --getState().depth;
+           #endif
+        }
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedRealtimeSection)
+    };
+
+    /** Lets the calling thread allocate and lock for the lifetime of the object. */
+    class ScopedExemption
+    {
+    public:
+        ScopedExemption() noexcept
+        {
+           #if AUDIO_EFFECTS_REALTIME_CHECKS
+            ++getState().exemptions;
+           #endif
+        }
+
+        ~ScopedExemption()
+        {
+           #if AUDIO_EFFECTS_REALTIME_CHECKS
+            --getState().exemptions;
+           #endif
+        }
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedExemption)
+    };
+
+    //======================================
+
+    /** Reports the operation if the calling thread is realtime. */
+    static void check (const char* operation) noexcept
+    {
+       #if AUDIO_EFFECTS_REALTIME_CHECKS
+        State& state = getState();
+        if (state.depth > 0 && state.exemptions == 0 && ! state.reported)
+            report (state, operation);
+       #else
+        ignoreUnused (operation);
+       #endif
+    }
+
+private:
+    //======================================
+
+   #if AUDIO_EFFECTS_REALTIME_CHECKS
+    struct State
+    {
+        int depth;
+        int exemptions;
+        bool reported;
+    };
+
+    static State& getState() noexcept
+    {
+        // Constant initialised, so that the allocator can use it before main()
+        static thread_local State state = { 0, 0, false };
+        return state;
+    }
+
+    static void report (State& state, const char* operation) noexcept
+    {
+        // The report allocates and locks too
+        state.reported = true;
+        const ScopedExemption exemption;
+
+        Logger::writeToLog (String ("Realtime safety: ") + operation + " in processBlock\n"
+                            + SystemStats::getStackBacktrace());
+        jassertfalse;
+    }
+   #endif
+};
+
+//==============================================================================
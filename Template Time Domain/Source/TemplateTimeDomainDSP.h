@@ -0,0 +1,169 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+
+/** The audio processing of the Template Time Domain, without the parameters,
+    state, editor or buses of the plugin, for hosts that only need the audio and run
+    many instances. TemplateTimeDomainAudioProcessor wraps one and hands it the
+    values of its parameters once a block: the gain of parameter 2 from 0 to 1, the
+    sign of parameter 3 as -1 or 1, and the index of the option of parameter 4. The
+    gain and the sign ramp over the smoothing time given to prepare().
+
+    The per-sample work is written once, in processKernel(), and compiled for every
+    combination of its template parameters: the number of channels (mono, stereo or
+    any other), the option of parameter 4, and whether the gain is smoothing.
+    process() selects the combination once per block, so that the loop has no
+    runtime branches on them. Effects based on this template replace the body of
+    the kernel, and add the settings they want specialised to getKernel().
+*/
+class TemplateTimeDomainDSP
+{
+public:
+    enum parameterIndex {
+        parameterGain = 0,
+        parameterSign,
+        parameterOption,
+        numParameters,
+    };
+
+    enum optionIndex {
+        optionA = 0,
+        optionB,
+    };
+
+    void prepare (const double sampleRate, const double smoothTime) noexcept
+    {
+        gain.reset (sampleRate, smoothTime);
+        sign.reset (sampleRate, smoothTime);
+    }
+
+    void reset() noexcept
+    {
+        gain.setCurrentAndTargetValue (gain.getTargetValue());
+        sign.setCurrentAndTargetValue (sign.getTargetValue());
+    }
+
+    void setParameter (const int index, const float value) noexcept
+    {
+        switch (index) {
+            case parameterGain:   gain.setTargetValue (value); break;
+            case parameterSign:   sign.setTargetValue (value); break;
+            case parameterOption: option = jlimit ((int)optionA, (int)optionB, (int)value); break;
+        }
+    }
+
+    /** Processes numSamples samples of numChannels channels in place. */
+    void process (float* const* channels, const int numChannels, const int numSamples) noexcept
+    {
+        const Kernel smoothingKernel = getKernel (numChannels, option, true);
+        const Kernel kernel = getKernel (numChannels, option, false);
+
+        // The samples up to the end of the ramps take the smoothing kernel, and the
+        // rest of the block the constant one
+        int blockStart = 0;
+        while (blockStart < numSamples && (gain.isSmoothing() || sign.isSmoothing())) {
+            const int blockSamples = jmin ((int)maxBlockSize, numSamples - blockStart);
+
+            for (int sample = 0; sample < blockSamples; ++sample)
+                gains[sample] = gain.getNextValue() * sign.getNextValue();
+
+            (this->*smoothingKernel) (channels, blockStart, blockSamples, numChannels, 0.0f);
+            blockStart += blockSamples;
+        }
+
+        if (blockStart < numSamples)
+            (this->*kernel) (channels, blockStart, numSamples - blockStart, numChannels,
+                             gain.getTargetValue() * sign.getTargetValue());
+    }
+
+private:
+    //==============================================================================
+
+    enum {
+        anyNumChannels = 0,
+        maxBlockSize = 256,
+    };
+
+    typedef void (TemplateTimeDomainDSP::*Kernel) (float* const* channelData,
+                                                   const int startSample,
+                                                   const int numSamples,
+                                                   const int numChannels,
+                                                   const float gain);
+
+    static Kernel getKernel (const int numChannels, const int option, const bool smoothing) noexcept
+    {
+        typedef TemplateTimeDomainDSP D;
+
+        // Indexed by [mono, stereo or any other][option][smoothing]
+        static const Kernel kernels[3][2][2] = {
+            { { &D::processKernel<1, optionA, false>,              &D::processKernel<1, optionA, true> },
+              { &D::processKernel<1, optionB, false>,              &D::processKernel<1, optionB, true> } },
+            { { &D::processKernel<2, optionA, false>,              &D::processKernel<2, optionA, true> },
+              { &D::processKernel<2, optionB, false>,              &D::processKernel<2, optionB, true> } },
+            { { &D::processKernel<anyNumChannels, optionA, false>, &D::processKernel<anyNumChannels, optionA, true> },
+              { &D::processKernel<anyNumChannels, optionB, false>, &D::processKernel<anyNumChannels, optionB, true> } },
+        };
+
+        const int layout = (numChannels == 1 || numChannels == 2) ? numChannels - 1 : 2;
+        return kernels[layout][jlimit (0, 1, option)][smoothing ? 1 : 0];
+    }
+
+    template <int numChannels, int option, bool smoothing>
+    void processKernel (float* const* channelData,
+                        const int startSample,
+                        const int numSamples,
+                        const int numChannelsInBuffer,
+                        const float constantGain) noexcept
+    {
+        // A constant in the mono and stereo kernels, so the channel loop is unrolled
+        const int channelCount = (numChannels == anyNumChannels) ? numChannelsInBuffer : numChannels;
+
+        for (int sample = startSample; sample < startSample + numSamples; ++sample) {
+            const float sampleGain = smoothing ? gains[sample - startSample] : constantGain;
+
+            for (int channel = 0; channel < channelCount; ++channel) {
+                const float in = channelData[channel][sample];
+
+                // Parameter 4 scales the output by the index of its option, a constant here
+                float out = in * sampleGain * (float)option;
+
+                channelData[channel][sample] = out;
+            }
+        }
+    }
+
+    //==============================================================================
+
+    LinearSmoothedValue<float> gain { 0.5f };
+    LinearSmoothedValue<float> sign { 1.0f };
+    int option = optionB;
+
+    float gains[maxBlockSize];
+};
+
+//==============================================================================
@@ -0,0 +1,282 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "PluginParameter.h"
+#include "MemoryFootprint.h"
+
+//==============================================================================
+
+/** Bypass shared by all the effects, and handed to the host by getBypassParameter().
+
+    Switching it crossfades between the output of the effect and its input over
+    crossfadeTime. Once the effect has faded out, begin() writes the input to the
+    output itself and the effect returns before running any of its DSP. The input
+    is delayed by the latency of the effect, so the latency the host compensates
+    for still holds while it is bypassed.
+
+    The mode sets what the effect comes back to. With "Keep state" its delay lines,
+    filters and STFT frames are left as they were when it faded out, so it picks
+    up where it stopped. With "Reset" it is reset() once it has faded out, from the
+    audio thread, so that override has to be real-time safe.
+
+    processBlock calls begin() before its DSP and returns if it is true, then calls
+    end() once the effect has written its output to the buffer.
+*/
+class PluginBypass
+{
+public:
+    StringArray modeItemsUI = {
+        "Keep state",
+        "Reset"
+    };
+
+    enum modeIndex {
+        modeKeepState = 0,
+        modeReset,
+    };
+
+    static constexpr double crossfadeTime = 10e-3;
+
+    //======================================
+
+    PluginBypass (AudioProcessor& processor, PluginParametersManager& parametersManager)
+        : paramBypass (parametersManager, "Bypass")
+        , paramMode (parametersManager, "Bypass mode", modeItemsUI, modeKeepState)
+        , processor (processor)
+        , parametersManager (parametersManager)
+    {
+    }
+
+    AudioProcessorParameter* getParameter() const
+    {
+        return parametersManager.apvts.getParameter (paramBypass.paramID);
+    }
+
+    /** Makes room for blocks of up to maxBlockSize samples with up to
+        maxLatencySamples of latency, in the precision the processor uses. Not
+        real-time safe.
+    */
+    void prepare (const double sampleRate, const int maxBlockSize, const int maxLatencySamples)
+    {
+        const int numChannels = processor.getTotalNumInputChannels();
+
+        maxLatency = jmax (0, maxLatencySamples);
+        historyMask = nextPowerOfTwo (jmax (1, maxBlockSize) + maxLatency) - 1;
+
+        const bool doublePrecision = processor.isUsingDoublePrecision();
+        floatHistory.setSize (doublePrecision ? 0 : numChannels, doublePrecision ? 0 : historyMask + 1);
+        doubleHistory.setSize (doublePrecision ? numChannels : 0, doublePrecision ? historyMask + 1 : 0);
+        floatHistory.clear();
+        doubleHistory.clear();
+        historyWritePosition = 0;
+        historyLatency = 0;
+
+        gainStep = (float)(1.0 / jmax (1.0, crossfadeTime * sampleRate));
+        gain = getTargetGain();
+        fading = false;
+    }
+
+    /** The input history, as a delay line. */
+    void addMemoryFootprint (MemoryFootprint& footprint) const noexcept
+    {
+        footprint.add (MemoryFootprint::delayLines, floatHistory);
+        footprint.add (MemoryFootprint::delayLines, doubleHistory);
+    }
+
+    //======================================
+
+    /** Returns true if the effect is bypassed and faded out, with the output already
+        in buffer, so that its DSP has to be skipped.
+    */
+    template <typename SampleType>
+    bool begin (AudioBuffer<SampleType>& buffer) noexcept
+    {
+        AudioBuffer<SampleType>& history = getHistory (SampleType());
+        const int numChannels = jmin (processor.getTotalNumInputChannels(), buffer.getNumChannels());
+        const int numSamples = buffer.getNumSamples();
+        const float targetGain = getTargetGain();
+
+        // The earlier input is not delayed by the same latency, so it is dropped
+        const int latency = jlimit (0, maxLatency, processor.getLatencySamples());
+        if (latency != historyLatency) {
+            history.clear();
+            historyLatency = latency;
+        }
+
+        fading = (gain != targetGain);
+
+        // Without room for the input, for blocks longer than the processor was
+        // prepared for or in the other precision, it switches without a crossfade
+        historyValid = (history.getNumChannels() >= numChannels && numSamples + latency <= historyMask + 1);
+        if (! historyValid) {
+            setGain (targetGain);
+            return targetGain == 0.0f;
+        }
+
+        if (latency > 0 || fading)
+            writeHistory (history, buffer, numChannels, numSamples);
+
+        if (fading || targetGain != 0.0f)
+            return false;
+
+        if (latency > 0)
+            for (int channel = 0; channel < numChannels; ++channel)
+                readHistory (history, channel, buffer.getWritePointer (channel), numSamples);
+
+        for (int channel = processor.getTotalNumInputChannels(); channel < buffer.getNumChannels(); ++channel)
+            buffer.clear (channel, 0, buffer.getNumSamples());
+
+        return true;
+    }
+
+    /** Crossfades the output of the effect in buffer with its delayed input, while
+        the bypass is switching.
+    */
+    template <typename SampleType>
+    void end (AudioBuffer<SampleType>& buffer) noexcept
+    {
+        if (! fading || ! historyValid)
+            return;
+
+        AudioBuffer<SampleType>& history = getHistory (SampleType());
+        const int numChannels = jmin (processor.getTotalNumInputChannels(), buffer.getNumChannels());
+        const int numSamples = buffer.getNumSamples();
+        const float targetGain = getTargetGain();
+        const float step = (targetGain > gain) ? gainStep : -gainStep;
+
+        SampleType dry[maxBlockSize];
+        float endGain = targetGain;
+
+        // The outputs without an input fade to silence
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel) {
+            SampleType* channelData = buffer.getWritePointer (channel);
+            float localGain = gain;
+
+            for (int blockStart = 0; blockStart < numSamples; blockStart += maxBlockSize) {
+                const int blockSamples = jmin ((int)maxBlockSize, numSamples - blockStart);
+                if (channel < numChannels)
+                    readHistory (history, channel, dry, blockSamples, numSamples - blockStart);
+                else
+                    FloatVectorOperations::clear (dry, blockSamples);
+
+                for (int sample = 0; sample < blockSamples; ++sample) {
+                    localGain = (step > 0.0f) ? jmin (localGain + step, targetGain) : jmax (localGain + step, targetGain);
+                    SampleType& out = channelData[blockStart + sample];
+                    out = dry[sample] + (SampleType)localGain * (out - dry[sample]);
+                }
+            }
+
+            endGain = localGain;
+        }
+
+        setGain (endGain);
+    }
+
+    //======================================
+
+    PluginParameterToggle paramBypass;
+    PluginParameterComboBox paramMode;
+
+private:
+    //======================================
+
+    enum { maxBlockSize = 256 };
+
+    float getTargetGain() const noexcept
+    {
+        return (bool)paramBypass.getTargetValue() ? 0.0f : 1.0f;
+    }
+
+    void setGain (const float newGain) noexcept
+    {
+        const bool fadedOut = (gain != 0.0f && newGain == 0.0f);
+        gain = newGain;
+        fading = false;
+
+        if (fadedOut && (int)paramMode.getTargetValue() == modeReset)
+            processor.reset();
+    }
+
+    AudioBuffer<float>& getHistory (float) noexcept { return floatHistory; }
+    AudioBuffer<double>& getHistory (double) noexcept { return doubleHistory; }
+
+    template <typename SampleType>
+    void writeHistory (AudioBuffer<SampleType>& history, const AudioBuffer<SampleType>& buffer,
+                       const int numChannels, const int numSamples) noexcept
+    {
+        const int historySize = historyMask + 1;
+        const int firstSamples = jmin (numSamples, historySize - historyWritePosition);
+
+        for (int channel = 0; channel < numChannels; ++channel) {
+            const SampleType* input = buffer.getReadPointer (channel);
+            SampleType* historyData = history.getWritePointer (channel);
+            FloatVectorOperations::copy (historyData + historyWritePosition, input, firstSamples);
+            FloatVectorOperations::copy (historyData, input + firstSamples, numSamples - firstSamples);
+        }
+
+        historyWritePosition = (historyWritePosition + numSamples) & historyMask;
+    }
+
+    /** Copies numSamples of input, delayed by the latency, that start samplesFromEnd
+        samples before the end of the last block written.
+    */
+    template <typename SampleType>
+    void readHistory (const AudioBuffer<SampleType>& history, const int channel, SampleType* output,
+                      const int numSamples, int samplesFromEnd = -1) const noexcept
+    {
+        if (samplesFromEnd < 0)
+            samplesFromEnd = numSamples;
+
+        const int historySize = historyMask + 1;
+        const int readPosition = (historyWritePosition - samplesFromEnd - historyLatency) & historyMask;
+        const int firstSamples = jmin (numSamples, historySize - readPosition);
+
+        const SampleType* historyData = history.getReadPointer (channel);
+        FloatVectorOperations::copy (output, historyData + readPosition, firstSamples);
+        FloatVectorOperations::copy (output + firstSamples, historyData, numSamples - firstSamples);
+    }
+
+    //======================================
+
+    AudioProcessor& processor;
+    PluginParametersManager& parametersManager;
+
+    AudioBuffer<float> floatHistory;
+    AudioBuffer<double> doubleHistory;
+    int historyMask = 0;
+    int historyWritePosition = 0;
+    int historyLatency = 0;
+    int maxLatency = 0;
+    bool historyValid = false;
+
+    float gain = 1.0f;
+    float gainStep = 1.0f;
+    bool fading = false;
+
+    JUCE_DECLARE_NON_COPYABLE (PluginBypass)
+};
+
+//==============================================================================
@@ -44,6 +44,8 @@ TremoloAudioProcessor::TremoloAudioProcessor():
     , paramDepth (parameters, "Depth", "", 0.0f, 1.0f, 0.5f)
     , paramFrequency (parameters, "LFO Frequency", "Hz", 0.0f, 10.0f, 2.0f)
     , paramWaveform (parameters, "LFO Waveform", waveformItemsUI, waveformSine)
+    , paramMode (parameters, "Mode", modeItemsUI, TremoloDSP::modeTremolo)
+    , bypass (*this, parameters)
 {
     parameters.apvts.state = ValueTree (Identifier (getName().removeCharacters ("- ")));
 }
@@ -56,16 +58,21 @@ TremoloAudioProcessor::~TremoloAudioProcessor()
 
 void TremoloAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
+    TRACE_INSTANCE_SCOPE ("prepareToPlay", this);
+
     const double smoothTime = 1e-3;
     paramDepth.reset (sampleRate, smoothTime);
     paramFrequency.reset (sampleRate, smoothTime);
     paramWaveform.reset (sampleRate, smoothTime);
+    paramMode.reset (sampleRate, smoothTime);
 
     //======================================
 
-    lfoPhase = 0.0f;
-    inverseSampleRate = 1.0f / (float)sampleRate;
-    twoPi = 2.0f * M_PI;
+    tremolo.prepare (sampleRate);
+
+    profiler.prepare (sampleRate);
+    silenceDetector.prepare (sampleRate);
+    bypass.prepare (sampleRate, samplesPerBlock, 0);
 }
 
 void TremoloAudioProcessor::releaseResources()
@@ -74,98 +81,36 @@ void TremoloAudioProcessor::releaseResources()
 
 void TremoloAudioProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
 {
+    const ProcessBlockProfiler::ScopedMeasurement measurement (profiler, buffer.getNumSamples(), isNonRealtime());
+    TRACE_INSTANCE_SCOPE ("processBlock", this);
     ScopedNoDenormals noDenormals;
 
+    parameters.applySnapshotMorph();
+
     const int numInputChannels = getTotalNumInputChannels();
     const int numOutputChannels = getTotalNumOutputChannels();
     const int numSamples = buffer.getNumSamples();
 
     //======================================
 
-    float currentDepth = paramDepth.getNextValue();
-    float currentFrequency = paramFrequency.getNextValue();
-    float phase;
-
-    for (int channel = 0; channel < numInputChannels; ++channel) {
-        float* channelData = buffer.getWritePointer (channel);
-        phase = lfoPhase;
-
-        for (int sample = 0; sample < numSamples; ++sample) {
-            const float in = channelData[sample];
-            float modulation = lfo (phase, (int)paramWaveform.getTargetValue());
-            float out = in * (1 - currentDepth + currentDepth * modulation);
-
-            channelData[sample] = out;
+    if (silenceDetector.skipBlock (*this, buffer))
+        return;
 
-            phase += currentFrequency * inverseSampleRate;
-            if (phase >= 1.0f)
-                phase -= 1.0f;
-        }
-    }
+    if (bypass.begin (buffer))
+        return;
 
-    lfoPhase = phase;
+    tremolo.setParameter (TremoloDSP::parameterDepth, paramDepth.getNextValue());
+    tremolo.setParameter (TremoloDSP::parameterFrequency, paramFrequency.getNextValue());
+    tremolo.setParameter (TremoloDSP::parameterWaveform, paramWaveform.getTargetValue());
+    tremolo.setParameter (TremoloDSP::parameterMode, paramMode.getTargetValue());
+    tremolo.process (buffer.getArrayOfWritePointers(), numInputChannels, numSamples);
 
     //======================================
 
     for (int channel = numInputChannels; channel < numOutputChannels; ++channel)
         buffer.clear (channel, 0, numSamples);
-}
-
-//==============================================================================
 
-float TremoloAudioProcessor::lfo (float phase, int waveform)
-{
-    float out = 0.0f;
-
-    switch (waveform) {
-        case waveformSine: {
-            out = 0.5f + 0.5f * sinf (twoPi * phase);
-            break;
-        }
-        case waveformTriangle: {
-            if (phase < 0.25f)
-                out = 0.5f + 2.0f * phase;
-            else if (phase < 0.75f)
-                out = 1.0f - 2.0f * (phase - 0.25f);
-            else
-                out = 2.0f * (phase - 0.75f);
-            break;
-        }
-        case waveformSawtooth: {
-            if (phase < 0.5f)
-                out = 0.5f + phase;
-            else
-                out = phase - 0.5f;
-            break;
-        }
-        case waveformInverseSawtooth: {
-            if (phase < 0.5f)
-                out = 0.5f - phase;
-            else
-                out = 1.5f - phase;
-            break;
-        }
-        case waveformSquare: {
-            if (phase < 0.5f)
-                out = 0.0f;
-            else
-                out = 1.0f;
-            break;
-        }
-        case waveformSquareSlopedEdges: {
-            if (phase < 0.48f)
-                out = 1.0f;
-            else if (phase < 0.5f)
-                out = 1.0f - 50.0f * (phase - 0.48f);
-            else if (phase < 0.98f)
-                out = 0.0f;
-            else
-                out = 50.0f * (phase - 0.98f);
-            break;
-        }
-    }
-
-    return out;
+    bypass.end (buffer);
 }
 
 //==============================================================================
@@ -179,13 +124,17 @@ float TremoloAudioProcessor::lfo (float phase, int waveform)
 
 void TremoloAudioProcessor::getStateInformation (MemoryBlock& destData)
 {
-    auto state = parameters.apvts.copyState();
-    std::unique_ptr<XmlElement> xml (state.createXml());
-    copyXmlToBinary (*xml, destData);
+    MemoryOutputStream stream (destData, false);
+    parameters.writeState (stream);
 }
 
 void TremoloAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
+    MemoryInputStream stream (data, (size_t)sizeInBytes, false);
+    if (parameters.readState (stream))
+        return;
+
+    // Sessions saved in the XML format of older versions
     std::unique_ptr<XmlElement> xmlState (getXmlFromBinary (data, sizeInBytes));
 
     if (xmlState.get() != nullptr)
@@ -214,10 +163,9 @@ bool TremoloAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
     ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    if (layouts.getMainOutputChannelSet() != AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != AudioChannelSet::stereo())
+    // Every channel is multiplied by the same gain, so any layout with at least one
+    // channel is supported.
+    if (layouts.getMainOutputChannelSet().isDisabled())
         return false;
 
     // This checks if the input layout matches the output layout
@@ -270,6 +218,11 @@ double TremoloAudioProcessor::getTailLengthSeconds() const
     return 0.0;
 }
 
+AudioProcessorParameter* TremoloAudioProcessor::getBypassParameter() const
+{
+    return bypass.getParameter();
+}
+
 //==============================================================================
 
 int TremoloAudioProcessor::getNumPrograms()
@@ -298,6 +251,19 @@ void TremoloAudioProcessor::changeProgramName (int index, const String& newName)
 
 //==============================================================================
 
+MemoryFootprint TremoloAudioProcessor::getMemoryFootprint() const
+{
+    const ScopedLock lock (parameters.deferredCallbackLock);
+
+    MemoryFootprint footprint;
+    footprint.add (MemoryFootprint::other, sizeof (*this));
+    bypass.addMemoryFootprint (footprint);
+
+    return footprint;
+}
+
+//==============================================================================
+
 // This creates new instances of the plugin..
 AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
@@ -30,10 +30,15 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "PluginParameter.h"
+#include "ProcessBlockProfiler.h"
+#include "SilenceDetector.h"
+#include "PluginBypass.h"
+#include "MemoryFootprint.h"
+#include "TremoloDSP.h"
 
 //==============================================================================
 
-class TremoloAudioProcessor : public AudioProcessor
+class TremoloAudioProcessor : public AudioProcessor, public MemoryFootprintSource
 {
 public:
     //==============================================================================
@@ -78,6 +83,7 @@ public:
     bool producesMidi() const override;
     bool isMidiEffect () const override;
     double getTailLengthSeconds() const override;
+    AudioProcessorParameter* getBypassParameter() const override;
 
     //==============================================================================
 
@@ -89,10 +95,7 @@ public:
 
     //==============================================================================
 
-
-
-
-
+    MemoryFootprint getMemoryFootprint() const override;
 
     //==============================================================================
 
@@ -114,13 +117,19 @@ public:
         waveformSquareSlopedEdges,
     };
 
+    StringArray modeItemsUI = {
+        "Tremolo",
+        "Auto-pan",
+    };
+
     //======================================
 
-    float lfoPhase;
-    float inverseSampleRate;
-    float twoPi;
+    TremoloDSP tremolo;
+
+    //======================================
 
-    float lfo (float phase, int waveform);
+    ProcessBlockProfiler profiler;
+    SilenceDetector silenceDetector;
 
     //======================================
 
@@ -129,6 +138,9 @@ public:
     PluginParameterLinSlider paramDepth;
     PluginParameterLinSlider paramFrequency;
     PluginParameterComboBox paramWaveform;
+    PluginParameterComboBox paramMode;
+
+    PluginBypass bypass;
 
 private:
     //==============================================================================
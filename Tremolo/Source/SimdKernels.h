@@ -0,0 +1,644 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "FixedPoint.h"
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+ #if JUCE_GCC || JUCE_CLANG
+  #define SIMD_KERNELS_TARGET(instructionSet) __attribute__ ((target (instructionSet)))
+ #else
+  #define SIMD_KERNELS_TARGET(instructionSet)
+ #endif
+#elif JUCE_ARM && (defined (__ARM_NEON) || defined (__ARM_NEON__) || defined (_M_ARM64))
+ #include <arm_neon.h>
+ #define SIMD_KERNELS_NEON 1
+#endif
+
+//==============================================================================
+
+/** Element-wise loops over blocks of samples, written out with the intrinsics of
+    every instruction set instead of left to the auto-vectoriser.
+
+    The builds target the baseline of their architecture, so dsp::SIMDRegister and
+    the compiler only ever use SSE2 on x86. The wider versions here are compiled
+    with a target attribute, and get() picks the widest one the CPU runs the first
+    time it is called, which the processors do from their constructor. Every
+    version matches the scalar one to within rounding, and the scalar one handles
+    the samples left over at the end of a block. Builds with
+    AUDIO_EFFECTS_FIXED_POINT take the versions of FixedPointKernels instead.
+
+    Only the waveshapers, the crossfade and the gains are here. The interpolated
+    delay reads (ModulatedDelayLine, SincInterpolator), the all-pass and biquad
+    cascades (PhaserDSP, ParametricEQDSP) and the phase vocoder bins
+    (PhaseVocoderKernel) are templates on dsp::SIMDRegister in the plugins that
+    use them, with the channels or filters in its lanes, and stay at the width
+    of the baseline: giving them a version per instruction set would mean
+    compiling each of those templates once per target attribute.
+*/
+class SimdKernels
+{
+public:
+    enum instructionSetIndex {
+        instructionSetScalar = 0,
+        instructionSetSSE2,
+        instructionSetAVX2,
+        instructionSetAVX512,
+        instructionSetNEON,
+        instructionSetFixedPoint,
+    };
+
+    static const SimdKernels& get() noexcept
+    {
+        static const SimdKernels kernels;
+        return kernels;
+    }
+
+    static const char* getInstructionSetName (const int instructionSet) noexcept
+    {
+        switch (instructionSet) {
+            case instructionSetSSE2:   return "SSE2";
+            case instructionSetAVX2:   return "AVX2";
+            case instructionSetAVX512: return "AVX-512";
+            case instructionSetNEON:   return "NEON";
+            case instructionSetFixedPoint: return "Fixed point";
+        }
+
+        return "Scalar";
+    }
+
+    //==============================================================================
+
+    /** Clips the samples to [-threshold, threshold]. */
+    void (*hardClip) (float* samples, int numSamples, float threshold) noexcept;
+
+    /** Odd symmetric quadratic soft clipping, times scale: 2x up to 1/3,
+        1 - (2 - 3x)^2 / 3 up to 2/3, then 1.
+    */
+    void (*softClip) (float* samples, int numSamples, float scale) noexcept;
+
+    void (*fullWaveRectify) (float* samples, int numSamples) noexcept;
+    void (*halfWaveRectify) (float* samples, int numSamples) noexcept;
+
+    /** samples = offset + scale * samples, such as for a gain from an LFO and a depth. */
+    void (*scaleAndOffset) (float* samples, int numSamples, float scale, float offset) noexcept;
+
+    /** Fades samples in over previous, from fade on in steps of step up to 1, and
+        returns the fade at the end of the block.
+    */
+    float (*crossfade) (float* samples, const float* previous, int numSamples, float fade, float step) noexcept;
+
+    int instructionSet;
+
+private:
+    //==============================================================================
+
+    SimdKernels() noexcept
+    {
+        use<Scalar> (instructionSetScalar);
+
+       #if AUDIO_EFFECTS_FIXED_POINT
+        use<FixedPointKernels> (instructionSetFixedPoint);
+       #elif JUCE_INTEL
+        if (SystemStats::hasSSE2())
+            use<SSE2> (instructionSetSSE2);
+        if (SystemStats::hasAVX2())
+            use<AVX2> (instructionSetAVX2);
+        if (SystemStats::hasAVX512F())
+            use<AVX512> (instructionSetAVX512);
+       #elif SIMD_KERNELS_NEON
+        use<NEON> (instructionSetNEON);
+       #endif
+    }
+
+    template <class Kernels>
+    void use (const int newInstructionSet) noexcept
+    {
+        hardClip = Kernels::hardClip;
+        softClip = Kernels::softClip;
+        fullWaveRectify = Kernels::fullWaveRectify;
+        halfWaveRectify = Kernels::halfWaveRectify;
+        scaleAndOffset = Kernels::scaleAndOffset;
+        crossfade = Kernels::crossfade;
+        instructionSet = newInstructionSet;
+    }
+
+    //==============================================================================
+
+    struct Scalar
+    {
+        static void hardClip (float* samples, const int numSamples, const float threshold) noexcept
+        {
+            for (int sample = 0; sample < numSamples; ++sample)
+                samples[sample] = jmin (jmax (samples[sample], -threshold), threshold);
+        }
+
+        static void softClip (float* samples, const int numSamples, const float scale) noexcept
+        {
+            for (int sample = 0; sample < numSamples; ++sample) {
+                const float x = jmin (std::abs (samples[sample]), 2.0f / 3.0f);
+                const float quadratic = 2.0f - 3.0f * x;
+                const float shaped = (x > 1.0f / 3.0f) ? 1.0f - quadratic * quadratic * (1.0f / 3.0f) : 2.0f * x;
+                samples[sample] = std::copysign (shaped * scale, samples[sample]);
+            }
+        }
+
+        static void fullWaveRectify (float* samples, const int numSamples) noexcept
+        {
+            for (int sample = 0; sample < numSamples; ++sample)
+                samples[sample] = std::abs (samples[sample]);
+        }
+
+        static void halfWaveRectify (float* samples, const int numSamples) noexcept
+        {
+            for (int sample = 0; sample < numSamples; ++sample)
+                samples[sample] = jmax (0.0f, samples[sample]);
+        }
+
+        static void scaleAndOffset (float* samples, const int numSamples, const float scale, const float offset) noexcept
+        {
+            for (int sample = 0; sample < numSamples; ++sample)
+                samples[sample] = offset + scale * samples[sample];
+        }
+
+        static float crossfade (float* samples, const float* previous, const int numSamples,
+                                const float fade, const float step) noexcept
+        {
+            // The fades are worked out from the index rather than summed, so that
+            // the wider versions, which step several samples at a time, match
+            for (int sample = 0; sample < numSamples; ++sample) {
+                const float gain = jmin (1.0f, fade + step * (float)(sample + 1));
+                samples[sample] = previous[sample] + gain * (samples[sample] - previous[sample]);
+            }
+
+            return jmin (1.0f, fade + step * (float)numSamples);
+        }
+    };
+
+    //==============================================================================
+
+   #if JUCE_INTEL
+    struct SSE2
+    {
+        enum { numLanes = 4 };
+
+        static __m128 absolute (const __m128 x) noexcept { return _mm_andnot_ps (_mm_set1_ps (-0.0f), x); }
+        static __m128 sign (const __m128 x) noexcept     { return _mm_and_ps (_mm_set1_ps (-0.0f), x); }
+
+        static __m128 select (const __m128 mask, const __m128 whenTrue, const __m128 whenFalse) noexcept
+        {
+            return _mm_or_ps (_mm_and_ps (mask, whenTrue), _mm_andnot_ps (mask, whenFalse));
+        }
+
+        SIMD_KERNELS_TARGET ("sse2")
+        static void hardClip (float* samples, const int numSamples, const float threshold) noexcept
+        {
+            const __m128 upper = _mm_set1_ps (threshold);
+            const __m128 lower = _mm_set1_ps (-threshold);
+
+            int sample = 0;
+            for (; sample <= numSamples - numLanes; sample += numLanes)
+                _mm_storeu_ps (samples + sample, _mm_min_ps (_mm_max_ps (_mm_loadu_ps (samples + sample), lower), upper));
+
+            Scalar::hardClip (samples + sample, numSamples - sample, threshold);
+        }
+
+        SIMD_KERNELS_TARGET ("sse2")
+        static void softClip (float* samples, const int numSamples, const float scale) noexcept
+        {
+            const __m128 one = _mm_set1_ps (1.0f);
+            const __m128 two = _mm_set1_ps (2.0f);
+            const __m128 three = _mm_set1_ps (3.0f);
+            const __m128 oneThird = _mm_set1_ps (1.0f / 3.0f);
+            const __m128 twoThirds = _mm_set1_ps (2.0f / 3.0f);
+            const __m128 lanesScale = _mm_set1_ps (scale);
+
+            int sample = 0;
+            for (; sample <= numSamples - numLanes; sample += numLanes) {
+                const __m128 in = _mm_loadu_ps (samples + sample);
+                const __m128 x = _mm_min_ps (absolute (in), twoThirds);
+                const __m128 quadratic = _mm_sub_ps (two, _mm_mul_ps (three, x));
+                const __m128 curve = _mm_sub_ps (one, _mm_mul_ps (_mm_mul_ps (quadratic, quadratic), oneThird));
+                const __m128 shaped = select (_mm_cmpgt_ps (x, oneThird), curve, _mm_mul_ps (two, x));
+                _mm_storeu_ps (samples + sample, _mm_or_ps (_mm_mul_ps (shaped, lanesScale), sign (in)));
+            }
+
+            Scalar::softClip (samples + sample, numSamples - sample, scale);
+        }
+
+        SIMD_KERNELS_TARGET ("sse2")
+        static void fullWaveRectify (float* samples, const int numSamples) noexcept
+        {
+            int sample = 0;
+            for (; sample <= numSamples - numLanes; sample += numLanes)
+                _mm_storeu_ps (samples + sample, absolute (_mm_loadu_ps (samples + sample)));
+
+            Scalar::fullWaveRectify (samples + sample, numSamples - sample);
+        }
+
+        SIMD_KERNELS_TARGET ("sse2")
+        static void halfWaveRectify (float* samples, const int numSamples) noexcept
+        {
+            const __m128 zero = _mm_setzero_ps();
+
+            int sample = 0;
+            for (; sample <= numSamples - numLanes; sample += numLanes)
+                _mm_storeu_ps (samples + sample, _mm_max_ps (_mm_loadu_ps (samples + sample), zero));
+
+            Scalar::halfWaveRectify (samples + sample, numSamples - sample);
+        }
+
+        SIMD_KERNELS_TARGET ("sse2")
+        static void scaleAndOffset (float* samples, const int numSamples, const float scale, const float offset) noexcept
+        {
+            const __m128 lanesScale = _mm_set1_ps (scale);
+            const __m128 lanesOffset = _mm_set1_ps (offset);
+
+            int sample = 0;
+            for (; sample <= numSamples - numLanes; sample += numLanes)
+                _mm_storeu_ps (samples + sample, _mm_add_ps (lanesOffset, _mm_mul_ps (lanesScale, _mm_loadu_ps (samples + sample))));
+
+            Scalar::scaleAndOffset (samples + sample, numSamples - sample, scale, offset);
+        }
+
+        SIMD_KERNELS_TARGET ("sse2")
+        static float crossfade (float* samples, const float* previous, const int numSamples,
+                                const float fade, const float step) noexcept
+        {
+            const __m128 one = _mm_set1_ps (1.0f);
+            const __m128 lanesFade = _mm_set1_ps (fade);
+            const __m128 lanesStep = _mm_set1_ps (step);
+            __m128 index = _mm_setr_ps (1.0f, 2.0f, 3.0f, 4.0f);
+
+            int sample = 0;
+            for (; sample <= numSamples - numLanes; sample += numLanes) {
+                const __m128 gain = _mm_min_ps (one, _mm_add_ps (lanesFade, _mm_mul_ps (lanesStep, index)));
+                const __m128 from = _mm_loadu_ps (previous + sample);
+                const __m128 to = _mm_loadu_ps (samples + sample);
+                _mm_storeu_ps (samples + sample, _mm_add_ps (from, _mm_mul_ps (gain, _mm_sub_ps (to, from))));
+                index = _mm_add_ps (index, _mm_set1_ps ((float)numLanes));
+            }
+
+            Scalar::crossfade (samples + sample, previous + sample, numSamples - sample,
+                               fade + step * (float)sample, step);
+            return jmin (1.0f, fade + step * (float)numSamples);
+        }
+    };
+
+    //==============================================================================
+
+    struct AVX2
+    {
+        enum { numLanes = 8 };
+
+        SIMD_KERNELS_TARGET ("avx2")
+        static __m256 absolute (const __m256 x) noexcept { return _mm256_andnot_ps (_mm256_set1_ps (-0.0f), x); }
+
+        SIMD_KERNELS_TARGET ("avx2")
+        static __m256 sign (const __m256 x) noexcept     { return _mm256_and_ps (_mm256_set1_ps (-0.0f), x); }
+
+        SIMD_KERNELS_TARGET ("avx2")
+        static void hardClip (float* samples, const int numSamples, const float threshold) noexcept
+        {
+            const __m256 upper = _mm256_set1_ps (threshold);
+            const __m256 lower = _mm256_set1_ps (-threshold);
+
+            int sample = 0;
+            for (; sample <= numSamples - numLanes; sample += numLanes)
+                _mm256_storeu_ps (samples + sample, _mm256_min_ps (_mm256_max_ps (_mm256_loadu_ps (samples + sample), lower), upper));
+
+            Scalar::hardClip (samples + sample, numSamples - sample, threshold);
+        }
+
+        SIMD_KERNELS_TARGET ("avx2")
+        static void softClip (float* samples, const int numSamples, const float scale) noexcept
+        {
+            const __m256 one = _mm256_set1_ps (1.0f);
+            const __m256 two = _mm256_set1_ps (2.0f);
+            const __m256 three = _mm256_set1_ps (3.0f);
+            const __m256 oneThird = _mm256_set1_ps (1.0f / 3.0f);
+            const __m256 twoThirds = _mm256_set1_ps (2.0f / 3.0f);
+            const __m256 lanesScale = _mm256_set1_ps (scale);
+
+            int sample = 0;
+            for (; sample <= numSamples - numLanes; sample += numLanes) {
+                const __m256 in = _mm256_loadu_ps (samples + sample);
+                const __m256 x = _mm256_min_ps (absolute (in), twoThirds);
+                const __m256 quadratic = _mm256_sub_ps (two, _mm256_mul_ps (three, x));
+                const __m256 curve = _mm256_sub_ps (one, _mm256_mul_ps (_mm256_mul_ps (quadratic, quadratic), oneThird));
+                const __m256 shaped = _mm256_blendv_ps (_mm256_mul_ps (two, x), curve, _mm256_cmp_ps (x, oneThird, _CMP_GT_OQ));
+                _mm256_storeu_ps (samples + sample, _mm256_or_ps (_mm256_mul_ps (shaped, lanesScale), sign (in)));
+            }
+
+            Scalar::softClip (samples + sample, numSamples - sample, scale);
+        }
+
+        SIMD_KERNELS_TARGET ("avx2")
+        static void fullWaveRectify (float* samples, const int numSamples) noexcept
+        {
+            int sample = 0;
+            for (; sample <= numSamples - numLanes; sample += numLanes)
+                _mm256_storeu_ps (samples + sample, absolute (_mm256_loadu_ps (samples + sample)));
+
+            Scalar::fullWaveRectify (samples + sample, numSamples - sample);
+        }
+
+        SIMD_KERNELS_TARGET ("avx2")
+        static void halfWaveRectify (float* samples, const int numSamples) noexcept
+        {
+            const __m256 zero = _mm256_setzero_ps();
+
+            int sample = 0;
+            for (; sample <= numSamples - numLanes; sample += numLanes)
+                _mm256_storeu_ps (samples + sample, _mm256_max_ps (_mm256_loadu_ps (samples + sample), zero));
+
+            Scalar::halfWaveRectify (samples + sample, numSamples - sample);
+        }
+
+        SIMD_KERNELS_TARGET ("avx2")
+        static void scaleAndOffset (float* samples, const int numSamples, const float scale, const float offset) noexcept
+        {
+            const __m256 lanesScale = _mm256_set1_ps (scale);
+            const __m256 lanesOffset = _mm256_set1_ps (offset);
+
+            int sample = 0;
+            for (; sample <= numSamples - numLanes; sample += numLanes)
+                _mm256_storeu_ps (samples + sample, _mm256_add_ps (lanesOffset, _mm256_mul_ps (lanesScale, _mm256_loadu_ps (samples + sample))));
+
+            Scalar::scaleAndOffset (samples + sample, numSamples - sample, scale, offset);
+        }
+
+        SIMD_KERNELS_TARGET ("avx2")
+        static float crossfade (float* samples, const float* previous, const int numSamples,
+                                const float fade, const float step) noexcept
+        {
+            const __m256 one = _mm256_set1_ps (1.0f);
+            const __m256 lanesFade = _mm256_set1_ps (fade);
+            const __m256 lanesStep = _mm256_set1_ps (step);
+            __m256 index = _mm256_setr_ps (1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f);
+
+            int sample = 0;
+            for (; sample <= numSamples - numLanes; sample += numLanes) {
+                const __m256 gain = _mm256_min_ps (one, _mm256_add_ps (lanesFade, _mm256_mul_ps (lanesStep, index)));
+                const __m256 from = _mm256_loadu_ps (previous + sample);
+                const __m256 to = _mm256_loadu_ps (samples + sample);
+                _mm256_storeu_ps (samples + sample, _mm256_add_ps (from, _mm256_mul_ps (gain, _mm256_sub_ps (to, from))));
+                index = _mm256_add_ps (index, _mm256_set1_ps ((float)numLanes));
+            }
+
+            Scalar::crossfade (samples + sample, previous + sample, numSamples - sample,
+                               fade + step * (float)sample, step);
+            return jmin (1.0f, fade + step * (float)numSamples);
+        }
+    };
+
+    //==============================================================================
+
+    /** The samples left over are handled with masked loads and stores, so these
+        never fall back to the scalar version.
+    */
+    struct AVX512
+    {
+        enum { numLanes = 16 };
+
+        static __mmask16 getMask (const int numValidLanes) noexcept
+        {
+            return (__mmask16)((1u << jmin ((int)numLanes, numValidLanes)) - 1u);
+        }
+
+        SIMD_KERNELS_TARGET ("avx512f")
+        static __m512 absolute (const __m512 x) noexcept
+        {
+            return _mm512_castsi512_ps (_mm512_and_epi32 (_mm512_castps_si512 (x), _mm512_set1_epi32 (0x7fffffff)));
+        }
+
+        SIMD_KERNELS_TARGET ("avx512f")
+        static __m512 copySign (const __m512 magnitude, const __m512 x) noexcept
+        {
+            const __m512i signBits = _mm512_and_epi32 (_mm512_castps_si512 (x), _mm512_set1_epi32 ((int)0x80000000u));
+            return _mm512_castsi512_ps (_mm512_or_epi32 (_mm512_castps_si512 (magnitude), signBits));
+        }
+
+        SIMD_KERNELS_TARGET ("avx512f")
+        static void hardClip (float* samples, const int numSamples, const float threshold) noexcept
+        {
+            const __m512 upper = _mm512_set1_ps (threshold);
+            const __m512 lower = _mm512_set1_ps (-threshold);
+
+            for (int sample = 0; sample < numSamples; sample += numLanes) {
+                const __mmask16 mask = getMask (numSamples - sample);
+                const __m512 in = _mm512_maskz_loadu_ps (mask, samples + sample);
+                _mm512_mask_storeu_ps (samples + sample, mask, _mm512_min_ps (_mm512_max_ps (in, lower), upper));
+            }
+        }
+
+        SIMD_KERNELS_TARGET ("avx512f")
+        static void softClip (float* samples, const int numSamples, const float scale) noexcept
+        {
+            const __m512 one = _mm512_set1_ps (1.0f);
+            const __m512 two = _mm512_set1_ps (2.0f);
+            const __m512 three = _mm512_set1_ps (3.0f);
+            const __m512 oneThird = _mm512_set1_ps (1.0f / 3.0f);
+            const __m512 twoThirds = _mm512_set1_ps (2.0f / 3.0f);
+            const __m512 lanesScale = _mm512_set1_ps (scale);
+
+            for (int sample = 0; sample < numSamples; sample += numLanes) {
+                const __mmask16 mask = getMask (numSamples - sample);
+                const __m512 in = _mm512_maskz_loadu_ps (mask, samples + sample);
+                const __m512 x = _mm512_min_ps (absolute (in), twoThirds);
+                const __m512 quadratic = _mm512_sub_ps (two, _mm512_mul_ps (three, x));
+                const __m512 curve = _mm512_sub_ps (one, _mm512_mul_ps (_mm512_mul_ps (quadratic, quadratic), oneThird));
+                const __m512 shaped = _mm512_mask_blend_ps (_mm512_cmp_ps_mask (x, oneThird, _CMP_GT_OQ),
+                                                            _mm512_mul_ps (two, x), curve);
+                _mm512_mask_storeu_ps (samples + sample, mask, copySign (_mm512_mul_ps (shaped, lanesScale), in));
+            }
+        }
+
+        SIMD_KERNELS_TARGET ("avx512f")
+        static void fullWaveRectify (float* samples, const int numSamples) noexcept
+        {
+            for (int sample = 0; sample < numSamples; sample += numLanes) {
+                const __mmask16 mask = getMask (numSamples - sample);
+                _mm512_mask_storeu_ps (samples + sample, mask, absolute (_mm512_maskz_loadu_ps (mask, samples + sample)));
+            }
+        }
+
+        SIMD_KERNELS_TARGET ("avx512f")
+        static void halfWaveRectify (float* samples, const int numSamples) noexcept
+        {
+            const __m512 zero = _mm512_setzero_ps();
+
+            for (int sample = 0; sample < numSamples; sample += numLanes) {
+                const __mmask16 mask = getMask (numSamples - sample);
+                _mm512_mask_storeu_ps (samples + sample, mask, _mm512_max_ps (_mm512_maskz_loadu_ps (mask, samples + sample), zero));
+            }
+        }
+
+        SIMD_KERNELS_TARGET ("avx512f")
+        static void scaleAndOffset (float* samples, const int numSamples, const float scale, const float offset) noexcept
+        {
+            const __m512 lanesScale = _mm512_set1_ps (scale);
+            const __m512 lanesOffset = _mm512_set1_ps (offset);
+
+            for (int sample = 0; sample < numSamples; sample += numLanes) {
+                const __mmask16 mask = getMask (numSamples - sample);
+                const __m512 in = _mm512_maskz_loadu_ps (mask, samples + sample);
+                _mm512_mask_storeu_ps (samples + sample, mask, _mm512_add_ps (lanesOffset, _mm512_mul_ps (lanesScale, in)));
+            }
+        }
+
+        SIMD_KERNELS_TARGET ("avx512f")
+        static float crossfade (float* samples, const float* previous, const int numSamples,
+                                const float fade, const float step) noexcept
+        {
+            const __m512 one = _mm512_set1_ps (1.0f);
+            const __m512 lanesFade = _mm512_set1_ps (fade);
+            const __m512 lanesStep = _mm512_set1_ps (step);
+            __m512 index = _mm512_setr_ps (1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f,
+                                           9.0f, 10.0f, 11.0f, 12.0f, 13.0f, 14.0f, 15.0f, 16.0f);
+
+            for (int sample = 0; sample < numSamples; sample += numLanes) {
+                const __mmask16 mask = getMask (numSamples - sample);
+                const __m512 gain = _mm512_min_ps (one, _mm512_add_ps (lanesFade, _mm512_mul_ps (lanesStep, index)));
+                const __m512 from = _mm512_maskz_loadu_ps (mask, previous + sample);
+                const __m512 to = _mm512_maskz_loadu_ps (mask, samples + sample);
+                _mm512_mask_storeu_ps (samples + sample, mask, _mm512_add_ps (from, _mm512_mul_ps (gain, _mm512_sub_ps (to, from))));
+                index = _mm512_add_ps (index, _mm512_set1_ps ((float)numLanes));
+            }
+
+            return jmin (1.0f, fade + step * (float)numSamples);
+        }
+    };
+   #endif
+
+    //==============================================================================
+
+   #if SIMD_KERNELS_NEON
+    struct NEON
+    {
+        enum { numLanes = 4 };
+
+        static float32x4_t copySign (const float32x4_t magnitude, const float32x4_t x) noexcept
+        {
+            return vbslq_f32 (vdupq_n_u32 (0x80000000u), x, magnitude);
+        }
+
+        static void hardClip (float* samples, const int numSamples, const float threshold) noexcept
+        {
+            const float32x4_t upper = vdupq_n_f32 (threshold);
+            const float32x4_t lower = vdupq_n_f32 (-threshold);
+
+            int sample = 0;
+            for (; sample <= numSamples - numLanes; sample += numLanes)
+                vst1q_f32 (samples + sample, vminq_f32 (vmaxq_f32 (vld1q_f32 (samples + sample), lower), upper));
+
+            Scalar::hardClip (samples + sample, numSamples - sample, threshold);
+        }
+
+        static void softClip (float* samples, const int numSamples, const float scale) noexcept
+        {
+            const float32x4_t one = vdupq_n_f32 (1.0f);
+            const float32x4_t two = vdupq_n_f32 (2.0f);
+            const float32x4_t three = vdupq_n_f32 (3.0f);
+            const float32x4_t oneThird = vdupq_n_f32 (1.0f / 3.0f);
+            const float32x4_t twoThirds = vdupq_n_f32 (2.0f / 3.0f);
+            const float32x4_t lanesScale = vdupq_n_f32 (scale);
+
+            int sample = 0;
+            for (; sample <= numSamples - numLanes; sample += numLanes) {
+                const float32x4_t in = vld1q_f32 (samples + sample);
+                const float32x4_t x = vminq_f32 (vabsq_f32 (in), twoThirds);
+                const float32x4_t quadratic = vsubq_f32 (two, vmulq_f32 (three, x));
+                const float32x4_t curve = vsubq_f32 (one, vmulq_f32 (vmulq_f32 (quadratic, quadratic), oneThird));
+                const float32x4_t shaped = vbslq_f32 (vcgtq_f32 (x, oneThird), curve, vmulq_f32 (two, x));
+                vst1q_f32 (samples + sample, copySign (vmulq_f32 (shaped, lanesScale), in));
+            }
+
+            Scalar::softClip (samples + sample, numSamples - sample, scale);
+        }
+
+        static void fullWaveRectify (float* samples, const int numSamples) noexcept
+        {
+            int sample = 0;
+            for (; sample <= numSamples - numLanes; sample += numLanes)
+                vst1q_f32 (samples + sample, vabsq_f32 (vld1q_f32 (samples + sample)));
+
+            Scalar::fullWaveRectify (samples + sample, numSamples - sample);
+        }
+
+        static void halfWaveRectify (float* samples, const int numSamples) noexcept
+        {
+            const float32x4_t zero = vdupq_n_f32 (0.0f);
+
+            int sample = 0;
+            for (; sample <= numSamples - numLanes; sample += numLanes)
+                vst1q_f32 (samples + sample, vmaxq_f32 (vld1q_f32 (samples + sample), zero));
+
+            Scalar::halfWaveRectify (samples + sample, numSamples - sample);
+        }
+
+        static void scaleAndOffset (float* samples, const int numSamples, const float scale, const float offset) noexcept
+        {
+            const float32x4_t lanesScale = vdupq_n_f32 (scale);
+            const float32x4_t lanesOffset = vdupq_n_f32 (offset);
+
+            int sample = 0;
+            for (; sample <= numSamples - numLanes; sample += numLanes)
+                vst1q_f32 (samples + sample, vaddq_f32 (lanesOffset, vmulq_f32 (lanesScale, vld1q_f32 (samples + sample))));
+
+            Scalar::scaleAndOffset (samples + sample, numSamples - sample, scale, offset);
+        }
+
+        static float crossfade (float* samples, const float* previous, const int numSamples,
+                                const float fade, const float step) noexcept
+        {
+            const float32x4_t one = vdupq_n_f32 (1.0f);
+            const float32x4_t lanesFade = vdupq_n_f32 (fade);
+            const float32x4_t lanesStep = vdupq_n_f32 (step);
+            const float firstIndices[numLanes] = { 1.0f, 2.0f, 3.0f, 4.0f };
+            float32x4_t index = vld1q_f32 (firstIndices);
+
+            int sample = 0;
+            for (; sample <= numSamples - numLanes; sample += numLanes) {
+                const float32x4_t gain = vminq_f32 (one, vaddq_f32 (lanesFade, vmulq_f32 (lanesStep, index)));
+                const float32x4_t from = vld1q_f32 (previous + sample);
+                const float32x4_t to = vld1q_f32 (samples + sample);
+                vst1q_f32 (samples + sample, vaddq_f32 (from, vmulq_f32 (gain, vsubq_f32 (to, from))));
+                index = vaddq_f32 (index, vdupq_n_f32 ((float)numLanes));
+            }
+
+            Scalar::crossfade (samples + sample, previous + sample, numSamples - sample,
+                               fade + step * (float)sample, step);
+            return jmin (1.0f, fade + step * (float)numSamples);
+        }
+    };
+   #endif
+
+    //==============================================================================
+
+    JUCE_DECLARE_NON_COPYABLE (SimdKernels)
+};
+
+//==============================================================================
@@ -0,0 +1,160 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "WavetableLFO.h"
+#include "SimdKernels.h"
+
+//==============================================================================
+
+/** The audio processing of the Tremolo, without the parameters, state, editor or
+    buses of the plugin, for hosts that only need the audio and run many instances.
+    TremoloAudioProcessor wraps one and hands it the values of its parameters once
+    a block, in their natural units: the depth from 0 to 1, the frequency in Hz, the
+    index of the waveform and the index of the mode.
+
+    The auto-pan mode moves a stereo signal between the channels with equal power
+    gains, so the depth sets how far it swings from the centre. Layouts other than
+    stereo keep the tremolo.
+*/
+class TremoloDSP
+{
+public:
+    enum parameterIndex {
+        parameterDepth = 0,
+        parameterFrequency,
+        parameterWaveform,
+        parameterMode,
+        numParameters,
+    };
+
+    enum modeIndex {
+        modeTremolo = 0,
+        modeAutoPan,
+    };
+
+    void prepare (const double sampleRate) noexcept
+    {
+        inverseSampleRate = 1.0f / (float)sampleRate;
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        lfo.setPhase (0.0f);
+    }
+
+    void setParameter (const int index, const float value) noexcept
+    {
+        switch (index) {
+            case parameterDepth:     depth = value; break;
+            case parameterFrequency: frequency = value; break;
+            case parameterWaveform:  waveform = jlimit (0, WavetableLFO::numWaveforms - 1, (int)value); break;
+            case parameterMode:      mode = jlimit ((int)modeTremolo, (int)modeAutoPan, (int)value); break;
+        }
+    }
+
+    /** Processes numSamples samples of numChannels channels in place. */
+    void process (float* const* channels, const int numChannels, const int numSamples) noexcept
+    {
+        lfo.setWaveform (waveform);
+        lfo.setFrequency (frequency, inverseSampleRate);
+
+        if (mode == modeAutoPan && numChannels == 2) {
+            processAutoPan (channels[0], channels[1], numSamples);
+            return;
+        }
+
+        for (int blockStart = 0; blockStart < numSamples; blockStart += maxBlockSize) {
+            const int blockSamples = jmin ((int)maxBlockSize, numSamples - blockStart);
+
+            lfo.fill (gains, blockSamples);
+            kernels.scaleAndOffset (gains, blockSamples, depth, 1.0f - depth);
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                applyGains (channels[channel] + blockStart, gains, blockSamples);
+        }
+    }
+
+private:
+    //==============================================================================
+
+    void processAutoPan (float* left, float* right, const int numSamples) noexcept
+    {
+        for (int blockStart = 0; blockStart < numSamples; blockStart += maxBlockSize) {
+            const int blockSamples = jmin ((int)maxBlockSize, numSamples - blockStart);
+
+            // Position from 0 (left) to 1 (right), around the centre
+            lfo.fill (gains, blockSamples);
+            kernels.scaleAndOffset (gains, blockSamples, depth, 0.5f * (1.0f - depth));
+
+            // cos and sin of a quarter turn times the position, read from the table
+            // of the sine instead of calling them for every sample
+            for (int sample = 0; sample < blockSamples; ++sample) {
+                const float position = gains[sample];
+                rightGains[sample] = 2.0f * panLaw.getValue (0.25f * position) - 1.0f;
+                gains[sample] = 2.0f * panLaw.getValue (0.25f * (1.0f - position)) - 1.0f;
+            }
+
+            applyGains (left + blockStart, gains, blockSamples);
+            applyGains (right + blockStart, rightGains, blockSamples);
+        }
+    }
+
+    static void applyGains (float* samples, const float* gainsToApply, const int numSamples) noexcept
+    {
+       #if AUDIO_EFFECTS_FIXED_POINT
+        FixedPointKernels::multiply (samples, gainsToApply, numSamples);
+       #else
+        FloatVectorOperations::multiply (samples, gainsToApply, numSamples);
+       #endif
+    }
+
+    //==============================================================================
+
+    /** The LFO is the same on every channel, so it is filled once per sub-block of
+        maxBlockSize samples and turned into a gain that all the channels share.
+    */
+    enum {
+        maxBlockSize = 256,
+    };
+
+    WavetableLFO lfo;
+    float gains[maxBlockSize];
+    float rightGains[maxBlockSize];
+
+    /** Only read, for the sine of the equal power gains. */
+    WavetableLFO panLaw;
+
+    const SimdKernels& kernels = SimdKernels::get();
+    float inverseSampleRate = 1.0f / 44100.0f;
+
+    float depth = 0.5f;
+    float frequency = 2.0f;
+    int waveform = WavetableLFO::waveformSine;
+    int mode = modeTremolo;
+};
+
+//==============================================================================
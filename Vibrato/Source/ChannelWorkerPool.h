@@ -0,0 +1,217 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "RealtimeSafety.h"
+#include <atomic>
+
+//==============================================================================
+
+/** Pool of worker threads that processes independent channels of one block at the
+    same time, for layouts with many channels.
+
+    Hold it in a SharedResourcePointer, so that all the plugin instances of a process
+    share one pool. forEachChannel() runs on the audio thread with the workers: the
+    channels are claimed one at a time from an atomic counter, and the call returns
+    once all of them are done. It does not allocate or lock. When another instance is
+    using the pool, or there are only a few channels, the channels run one after
+    another on the calling thread instead, so an audio thread never waits for another.
+
+    The threads are only started by the first prepare() with enough channels to use
+    them, so the usual stereo sessions never start any.
+*/
+class ChannelWorkerPool
+{
+public:
+    enum {
+        maxNumWorkers = 15,
+        minChannelsForWorkers = 4,
+    };
+
+    ChannelWorkerPool()
+    {
+        const int numWorkers = jlimit (0, (int)maxNumWorkers, SystemStats::getNumCpus() - 1);
+        for (int i = 0; i < numWorkers; ++i)
+            workers.add (new Worker (*this));
+    }
+
+    ~ChannelWorkerPool()
+    {
+        for (Worker* worker : workers)
+            worker->signalThreadShouldExit();
+        for (Worker* worker : workers)
+            worker->wake.signal();
+        workers.clear();
+    }
+
+    //======================================
+
+    /** Called from prepareToPlay with the number of channels the instance processes.
+        Starts the threads the first time they can be used. Not real-time safe.
+    */
+    void prepare (const int numChannels)
+    {
+        if (numChannels < (int)minChannelsForWorkers || started.load (std::memory_order_acquire))
+            return;
+
+        const ScopedLock lock (startLock);
+        if (started.load (std::memory_order_relaxed))
+            return;
+
+        for (Worker* worker : workers)
+            worker->startThread (10);
+        started.store (true, std::memory_order_release);
+    }
+
+    /** Calls function (channel) once for every channel in [0, numChannels). The calls
+        may run at the same time on different threads, so they must only touch the
+        state of their own channel.
+    */
+    template <typename Function>
+    void forEachChannel (const int numChannels, Function&& function) noexcept
+    {
+        if (numChannels < (int)minChannelsForWorkers || workers.size() == 0
+            || ! started.load (std::memory_order_acquire) || busy.exchange (true)) {
+            for (int channel = 0; channel < numChannels; ++channel)
+                function (channel);
+            return;
+        }
+
+        ScopedNoDenormals noDenormals;
+
+        // Closes the previous job before its description is overwritten, so that no
+        // late claim on it can succeed
+        const uint64 generation = (nextChannel.load (std::memory_order_relaxed) >> 32) + 1;
+        nextChannel.exchange ((generation << 32) | closedJob, std::memory_order_acq_rel);
+
+        jobFunction.store (&callFunction<Function>, std::memory_order_release);
+        jobContext.store (&function, std::memory_order_release);
+        jobNumChannels.store (numChannels, std::memory_order_release);
+        numDoneChannels.store (0, std::memory_order_relaxed);
+
+        // The first channel of the new generation releases the job to the workers
+        nextChannel.store (generation << 32, std::memory_order_release);
+
+        {
+            // Waking the workers locks their events for a moment
+            const RealtimeSafety::ScopedExemption exemption;
+            for (Worker* worker : workers)
+                worker->wake.signal();
+        }
+
+        runChannels();
+        while (numDoneChannels.load (std::memory_order_acquire) < numChannels)
+            Thread::yield();
+
+        busy.store (false, std::memory_order_release);
+    }
+
+private:
+    //======================================
+
+    class Worker : public Thread
+    {
+    public:
+        Worker (ChannelWorkerPool& owner)
+            : Thread ("Channel worker")
+            , owner (owner)
+        {
+        }
+
+        ~Worker()
+        {
+            stopThread (-1);
+        }
+
+        void run() override
+        {
+            ScopedNoDenormals noDenormals;
+
+            while (! threadShouldExit()) {
+                wake.wait (-1);
+
+                const RealtimeSafety::ScopedRealtimeSection realtimeSection;
+                owner.runChannels();
+            }
+        }
+
+        WaitableEvent wake;
+
+    private:
+        ChannelWorkerPool& owner;
+    };
+
+    //======================================
+
+    typedef void (*JobFunction) (void* context, int channel);
+
+    template <typename Function>
+    static void callFunction (void* context, int channel)
+    {
+        (*static_cast<typename std::remove_reference<Function>::type*> (context)) (channel);
+    }
+
+    /** Claims and runs channels of the current job until there are none left. A
+        claim only succeeds while the generation it read the job with is current,
+        so a thread that wakes up late cannot run a channel of the wrong job.
+    */
+    void runChannels() noexcept
+    {
+        for (;;) {
+            uint64 claim = nextChannel.load (std::memory_order_acquire);
+            const JobFunction function = jobFunction.load (std::memory_order_acquire);
+            void* const context = jobContext.load (std::memory_order_acquire);
+            const int numChannels = jobNumChannels.load (std::memory_order_acquire);
+
+            const uint32 channel = (uint32)(claim & closedJob);
+            if (channel >= (uint32)numChannels)
+                return;
+
+            if (! nextChannel.compare_exchange_weak (claim, claim + 1, std::memory_order_acq_rel))
+                continue;
+
+            function (context, (int)channel);
+            numDoneChannels.fetch_add (1, std::memory_order_release);
+        }
+    }
+
+    //======================================
+
+    OwnedArray<Worker> workers;
+    CriticalSection startLock;
+    std::atomic<bool> started { false };
+    std::atomic<bool> busy { false };
+
+    // Generation in the high 32 bits, next channel to claim in the low ones
+    static constexpr uint64 closedJob = 0xffffffff;
+    std::atomic<uint64> nextChannel { 0 };
+    std::atomic<JobFunction> jobFunction { nullptr };
+    std::atomic<void*> jobContext { nullptr };
+    std::atomic<int> jobNumChannels { 0 };
+    std::atomic<int> numDoneChannels { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE (ChannelWorkerPool)
+};
+
+//==============================================================================
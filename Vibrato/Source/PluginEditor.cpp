@@ -105,11 +105,16 @@ VibratoAudioProcessorEditor::VibratoAudioProcessorEditor (VibratoAudioProcessor&
 
     editorHeight += components.size() * editorPadding;
     setSize (editorWidth, editorHeight);
+    setOpaque (true);
+    setLookAndFeel (lookAndFeel);
+    renderingContext.attachTo (*this);
     startTimer (50);
 }
 
 VibratoAudioProcessorEditor::~VibratoAudioProcessorEditor()
 {
+    renderingContext.detach();
+    setLookAndFeel (nullptr);
 }
 
 //==============================================================================
@@ -144,7 +149,12 @@ void VibratoAudioProcessorEditor::resized()
 
 void VibratoAudioProcessorEditor::timerCallback()
 {
-    updateUIcomponents();
+    // Only touches the components when something they show changed
+    if (uiValues.generationChanged (processor.parameters.getChangeGeneration())
+        && uiValues.changed ({ processor.paramWidth.getTargetValue(),
+                               processor.paramFrequency.getTargetValue(),
+                               processor.paramWaveform.getTargetValue() }))
+        updateUIcomponents();
 }
 
 void VibratoAudioProcessorEditor::updateUIcomponents()
@@ -24,6 +24,7 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "PluginProcessor.h"
+#include "EditorRendering.h"
 
 //==============================================================================
 
@@ -80,6 +81,12 @@ private:
     void timerCallback() override;
     void updateUIcomponents();
     Label pitchShiftLabel;
+    EditorValueSnapshot uiValues;
+
+    //======================================
+
+    EditorRenderingContext renderingContext;
+    SharedResourcePointer<EditorLookAndFeel> lookAndFeel;
 
     //==============================================================================
 
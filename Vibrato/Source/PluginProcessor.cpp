@@ -45,6 +45,7 @@ VibratoAudioProcessor::VibratoAudioProcessor():
     , paramFrequency (parameters, "LFO Frequency", "Hz", 0.0f, 10.0f, 2.0f)
     , paramWaveform (parameters, "LFO Waveform", waveformItemsUI, waveformSine)
     , paramInterpolation (parameters, "Interpolation", interpolationItemsUI, interpolationLinear)
+    , bypass (*this, parameters)
 {
     parameters.apvts.state = ValueTree (Identifier (getName().removeCharacters ("- ")));
 }
@@ -57,6 +58,8 @@ VibratoAudioProcessor::~VibratoAudioProcessor()
 
 void VibratoAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
+    TRACE_INSTANCE_SCOPE ("prepareToPlay", this);
+
     const double smoothTime = 1e-3;
     paramWidth.reset (sampleRate, smoothTime);
     paramFrequency.reset (sampleRate, smoothTime);
@@ -65,147 +68,55 @@ void VibratoAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBloc
 
     //======================================
 
-    float maxDelayTime = paramWidth.maxValue;
-    delayBufferSamples = (int)(maxDelayTime * (float)sampleRate) + 1;
-    if (delayBufferSamples < 1)
-        delayBufferSamples = 1;
-
-    delayBufferChannels = getTotalNumInputChannels();
-    delayBuffer.setSize (delayBufferChannels, delayBufferSamples);
-    delayBuffer.clear();
+    vibrato.prepare (sampleRate, getTotalNumInputChannels(), paramWidth.maxValue);
 
-    delayWritePosition = 0;
-    lfoPhase = 0.0f;
-    inverseSampleRate = 1.0f / (float)sampleRate;
-    twoPi = 2.0f * M_PI;
+    profiler.prepare (sampleRate);
+    silenceDetector.prepare (sampleRate);
+    bypass.prepare (sampleRate, samplesPerBlock, 0);
 }
 
 void VibratoAudioProcessor::releaseResources()
 {
 }
 
+void VibratoAudioProcessor::reset()
+{
+    vibrato.reset();
+}
+
 void VibratoAudioProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
 {
+    const ProcessBlockProfiler::ScopedMeasurement measurement (profiler, buffer.getNumSamples(), isNonRealtime());
+    TRACE_INSTANCE_SCOPE ("processBlock", this);
     ScopedNoDenormals noDenormals;
 
+    parameters.applySnapshotMorph();
+
     const int numInputChannels = getTotalNumInputChannels();
     const int numOutputChannels = getTotalNumOutputChannels();
     const int numSamples = buffer.getNumSamples();
 
     //======================================
 
-    float currentWidth = paramWidth.getNextValue();
-    float currentFrequency = paramFrequency.getNextValue();
-
-    int localWritePosition;
-    float phase;
-
-    for (int channel = 0; channel < numInputChannels; ++channel) {
-        float* channelData = buffer.getWritePointer (channel);
-        float* delayData = delayBuffer.getWritePointer (channel);
-        localWritePosition = delayWritePosition;
-        phase = lfoPhase;
-
-        for (int sample = 0; sample < numSamples; ++sample) {
-            const float in = channelData[sample];
-            float out = 0.0f;
-
-            float localDelayTime = currentWidth * lfo (phase, (int)paramWaveform.getTargetValue()) * (float)getSampleRate();
-
-            float readPosition =
-                fmodf ((float)localWritePosition - localDelayTime + (float)delayBufferSamples - 1.0f, delayBufferSamples);
-            int localReadPosition = floorf (readPosition);
-
-            switch ((int)paramInterpolation.getTargetValue()) {
-                case interpolationNearestNeighbour: {
-                    float closestSample = delayData[localReadPosition % delayBufferSamples];
-                    out = closestSample;
-                    break;
-                }
-                case interpolationLinear: {
-                    float fraction = readPosition - (float)localReadPosition;
-                    float delayed0 = delayData[(localReadPosition + 0)];
-                    float delayed1 = delayData[(localReadPosition + 1) % delayBufferSamples];
-                    out = delayed0 + fraction * (delayed1 - delayed0);
-                    break;
-                }
-                case interpolationCubic: {
-                    float fraction = readPosition - (float)localReadPosition;
-                    float fractionSqrt = fraction * fraction;
-                    float fractionCube = fractionSqrt * fraction;
-
-                    float sample0 = delayData[(localReadPosition - 1 + delayBufferSamples) % delayBufferSamples];
-                    float sample1 = delayData[(localReadPosition + 0)];
-                    float sample2 = delayData[(localReadPosition + 1) % delayBufferSamples];
-                    float sample3 = delayData[(localReadPosition + 2) % delayBufferSamples];
-
-                    float a0 = - 0.5f * sample0 + 1.5f * sample1 - 1.5f * sample2 + 0.5f * sample3;
-                    float a1 = sample0 - 2.5f * sample1 + 2.0f * sample2 - 0.5f * sample3;
-                    float a2 = - 0.5f * sample0 + 0.5f * sample2;
-                    float a3 = sample1;
-                    out = a0 * fractionCube + a1 * fractionSqrt + a2 * fraction + a3;
-                    break;
-                }
-            }
-
-            channelData[sample] = out;
-            delayData[localWritePosition] = in;
-
-            if (++localWritePosition >= delayBufferSamples)
-                localWritePosition -= delayBufferSamples;
-
-            phase += currentFrequency * inverseSampleRate;
-            if (phase >= 1.0f)
-                phase -= 1.0f;
-        }
-    }
-
-    delayWritePosition = localWritePosition;
-    lfoPhase = phase;
+    if (silenceDetector.skipBlock (*this, buffer))
+        return;
+
+    if (bypass.begin (buffer))
+        return;
+
+    vibrato.setParameter (VibratoDSP::parameterWidth, paramWidth.getNextValue());
+    vibrato.setParameter (VibratoDSP::parameterFrequency, paramFrequency.getNextValue());
+    vibrato.setParameter (VibratoDSP::parameterWaveform, paramWaveform.getTargetValue());
+    vibrato.setParameter (VibratoDSP::parameterInterpolation, (float)getInterpolation());
+    vibrato.setQualityReduction (profiler.getQualityReduction());
+    vibrato.process (buffer.getArrayOfWritePointers(), numInputChannels, numSamples);
 
     //======================================
 
     for (int channel = numInputChannels; channel < numOutputChannels; ++channel)
         buffer.clear (channel, 0, numSamples);
-}
-
-//==============================================================================
 
-float VibratoAudioProcessor::lfo (float phase, int waveform)
-{
-    float out = 0.0f;
-
-    switch (waveform) {
-        case waveformSine: {
-            out = 0.5f + 0.5f * sinf (twoPi * phase);
-            break;
-        }
-        case waveformTriangle: {
-            if (phase < 0.25f)
-                out = 0.5f + 2.0f * phase;
-            else if (phase < 0.75f)
-                out = 1.0f - 2.0f * (phase - 0.25f);
-            else
-                out = 2.0f * (phase - 0.75f);
-            break;
-        }
-        case waveformSawtooth: {
-            if (phase < 0.5f)
-                out = 0.5f + phase;
-            else
-                out = phase - 0.5f;
-            break;
-        }
-        case waveformInverseSawtooth: {
-            if (phase < 0.5f)
-                out = 0.5f - phase;
-            else
-                out = 1.5f - phase;
-            break;
-        }
-    }
-
-    return out;
+    bypass.end (buffer);
 }
 
 //==============================================================================
@@ -219,13 +130,17 @@ float VibratoAudioProcessor::lfo (float phase, int waveform)
 
 void VibratoAudioProcessor::getStateInformation (MemoryBlock& destData)
 {
-    auto state = parameters.apvts.copyState();
-    std::unique_ptr<XmlElement> xml (state.createXml());
-    copyXmlToBinary (*xml, destData);
+    MemoryOutputStream stream (destData, false);
+    parameters.writeState (stream);
 }
 
 void VibratoAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
+    MemoryInputStream stream (data, (size_t)sizeInBytes, false);
+    if (parameters.readState (stream))
+        return;
+
+    // Sessions saved in the XML format of older versions
     std::unique_ptr<XmlElement> xmlState (getXmlFromBinary (data, sizeInBytes));
 
     if (xmlState.get() != nullptr)
@@ -254,10 +169,9 @@ bool VibratoAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
     ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    if (layouts.getMainOutputChannelSet() != AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != AudioChannelSet::stereo())
+    // The channels are processed independently, so any layout with at least one
+    // channel is supported, from mono to surround sets or ambisonic stems.
+    if (layouts.getMainOutputChannelSet().isDisabled())
         return false;
 
     // This checks if the input layout matches the output layout
@@ -307,7 +221,15 @@ bool VibratoAudioProcessor::isMidiEffect() const
 
 double VibratoAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    const int interpolation = getInterpolation();
+    const int minDelay = jmax (1, ModulatedDelayLine::getLookahead (interpolation));
+
+    return paramWidth.getTargetValue() + (double)minDelay / jmax (1.0, getSampleRate());
+}
+
+AudioProcessorParameter* VibratoAudioProcessor::getBypassParameter() const
+{
+    return bypass.getParameter();
 }
 
 //==============================================================================
@@ -338,6 +260,21 @@ void VibratoAudioProcessor::changeProgramName (int index, const String& newName)
 
 //==============================================================================
 
+MemoryFootprint VibratoAudioProcessor::getMemoryFootprint() const
+{
+    const ScopedLock lock (parameters.deferredCallbackLock);
+
+    MemoryFootprint footprint;
+    footprint.add (MemoryFootprint::other, sizeof (*this));
+    bypass.addMemoryFootprint (footprint);
+
+    vibrato.addMemoryFootprint (footprint);
+
+    return footprint;
+}
+
+//==============================================================================
+
 // This creates new instances of the plugin..
 AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
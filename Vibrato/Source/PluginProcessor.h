@@ -30,10 +30,15 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "PluginParameter.h"
+#include "ProcessBlockProfiler.h"
+#include "SilenceDetector.h"
+#include "PluginBypass.h"
+#include "MemoryFootprint.h"
+#include "VibratoDSP.h"
 
 //==============================================================================
 
-class VibratoAudioProcessor : public AudioProcessor
+class VibratoAudioProcessor : public AudioProcessor, public MemoryFootprintSource
 {
 public:
     //==============================================================================
@@ -45,6 +50,7 @@ public:
 
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
+    void reset() override;
     void processBlock (AudioSampleBuffer&, MidiBuffer&) override;
 
     //==============================================================================
@@ -78,6 +84,7 @@ public:
     bool producesMidi() const override;
     bool isMidiEffect () const override;
     double getTailLengthSeconds() const override;
+    AudioProcessorParameter* getBypassParameter() const override;
 
     //==============================================================================
 
@@ -89,10 +96,7 @@ public:
 
     //==============================================================================
 
-
-
-
-
+    MemoryFootprint getMemoryFootprint() const override;
 
     //==============================================================================
 
@@ -115,27 +119,34 @@ public:
     StringArray interpolationItemsUI = {
         "None",
         "Linear",
-        "Cubic"
+        "Cubic",
+        "Windowed sinc"
     };
 
     enum interpolationIndex {
-        interpolationNearestNeighbour = 0,
-        interpolationLinear,
-        interpolationCubic,
+        interpolationNearestNeighbour = ModulatedDelayLine::interpolationNearestNeighbour,
+        interpolationLinear = ModulatedDelayLine::interpolationLinear,
+        interpolationCubic = ModulatedDelayLine::interpolationCubic,
+        interpolationSinc = ModulatedDelayLine::interpolationSinc,
     };
 
+    /** The interpolation chosen, raised to the windowed sinc in offline renders.
+        The delays keep its lookahead, as with the one chosen.
+    */
+    int getInterpolation() const noexcept
+    {
+        const int interpolation = (int)paramInterpolation.getTargetValue();
+        return isNonRealtime() ? ModulatedDelayLine::getRenderInterpolation (interpolation) : interpolation;
+    }
+
     //======================================
 
-    AudioSampleBuffer delayBuffer;
-    int delayBufferSamples;
-    int delayBufferChannels;
-    int delayWritePosition;
+    VibratoDSP vibrato;
 
-    float lfoPhase;
-    float inverseSampleRate;
-    float twoPi;
+    //======================================
 
-    float lfo (float phase, int waveform);
+    ProcessBlockProfiler profiler;
+    SilenceDetector silenceDetector;
 
     //======================================
 
@@ -146,6 +157,8 @@ public:
     PluginParameterComboBox paramWaveform;
     PluginParameterComboBox paramInterpolation;
 
+    PluginBypass bypass;
+
 private:
     //==============================================================================
 
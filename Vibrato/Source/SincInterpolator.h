@@ -0,0 +1,151 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//==============================================================================
+
+/** Fractional delay interpolator with a windowed-sinc kernel of numTaps taps.
+
+    The kernel is sampled at numPhases fractions between 0 and 1 into a table shared
+    by all the instances, and the coefficients of a fraction are blended linearly
+    from its two nearest phases. Every read is then one dot product of numTaps
+    samples, done in SIMD registers, at the same cost for any fraction. The cutoff
+    sits a little below Nyquist and every phase has unity gain at DC, so sweeping
+    the fraction does not modulate the level.
+
+    The taps reach latencySamples samples past the read position, so it has to
+    trail the newest sample in the buffer by at least that many.
+*/
+class SincInterpolator
+{
+public:
+    //==============================================================================
+
+    typedef dsp::SIMDRegister<float> Lanes;
+
+    enum {
+        numPhases = 256,
+        numTaps = 8,
+        latencySamples = numTaps / 2,
+        numLanes = (int)Lanes::SIMDNumElements,
+    };
+
+    static_assert (numTaps % numLanes == 0, "The taps must fill whole SIMD registers");
+
+    SincInterpolator()
+    {
+        // Builds the table, if this is the first instance, outside of the audio thread
+        getTable();
+    }
+
+    //==============================================================================
+
+    /** Value at position + fraction of a circular buffer of bufferSamples samples.
+        The position must be inside the buffer and the fraction between 0 and 1.
+    */
+    float read (const float* data, const int bufferSamples, const int position, const float fraction) const noexcept
+    {
+        jassert (bufferSamples >= numTaps);
+
+        alignas (Lanes::SIMDRegisterSize) float taps[numTaps];
+        const int firstTap = position - (latencySamples - 1);
+
+        if (firstTap >= 0 && firstTap + numTaps <= bufferSamples) {
+            for (int tap = 0; tap < numTaps; ++tap)
+                taps[tap] = data[firstTap + tap];
+        } else {
+            for (int tap = 0; tap < numTaps; ++tap) {
+                int index = firstTap + tap;
+                if (index < 0)
+                    index += bufferSamples;
+                else if (index >= bufferSamples)
+                    index -= bufferSamples;
+
+                taps[tap] = data[index];
+            }
+        }
+
+        const float phasePosition = fraction * (float)numPhases;
+        const int phase = jmin ((int)phasePosition, (int)numPhases - 1);
+        const float blend = phasePosition - (float)phase;
+
+        const float* coefficients0 = getTable().data[phase];
+        const float* coefficients1 = getTable().data[phase + 1];
+
+        Lanes sum = Lanes::expand (0.0f);
+        for (int tap = 0; tap < numTaps; tap += numLanes) {
+            const Lanes c0 = Lanes::fromRawArray (coefficients0 + tap);
+            const Lanes c1 = Lanes::fromRawArray (coefficients1 + tap);
+            sum = sum + Lanes::fromRawArray (taps + tap) * (c0 + (c1 - c0) * blend);
+        }
+
+        return sum.sum();
+    }
+
+private:
+    //==============================================================================
+
+    struct Table
+    {
+        Table()
+        {
+            const double cutoff = 0.9;
+            const double halfLength = 0.5 * (double)numTaps;
+
+            // One more phase than needed, at a fraction of 1, so the blend never wraps
+            for (int phase = 0; phase <= numPhases; ++phase) {
+                const double fraction = (double)phase / (double)numPhases;
+                double kernel[numTaps];
+                double sum = 0.0;
+
+                for (int tap = 0; tap < numTaps; ++tap) {
+                    const double x = (double)(tap - (latencySamples - 1)) - fraction;
+                    const double sinc = (x == 0.0) ? 1.0 : sin (M_PI * cutoff * x) / (M_PI * cutoff * x);
+                    const double window = 0.42 + 0.5 * cos (M_PI * x / halfLength)
+                                               + 0.08 * cos (2.0 * M_PI * x / halfLength);
+
+                    kernel[tap] = sinc * window;
+                    sum += kernel[tap];
+                }
+
+                for (int tap = 0; tap < numTaps; ++tap)
+                    data[phase][tap] = (float)(kernel[tap] / sum);
+            }
+        }
+
+        alignas (Lanes::SIMDRegisterSize) float data[numPhases + 1][numTaps];
+    };
+
+    static const Table& getTable()
+    {
+        static const Table table;
+        return table;
+    }
+};
+
+//==============================================================================
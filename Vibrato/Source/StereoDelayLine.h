@@ -0,0 +1,221 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "ModulatedDelayLine.h"
+#include "SincInterpolator.h"
+#include "DelayMemoryArena.h"
+#include "MemoryFootprint.h"
+
+//==============================================================================
+
+/** Delay line of a stereo pair whose two channels are modulated together, with
+    the channels interleaved: every frame holds the left and the right sample of
+    the same instant, so the taps of both channels, which read at the same delay
+    or near it, fall on the same cache lines.
+
+    Every call handles the pair at once. The delays, read positions and
+    interpolation of the two channels run in the two lanes of a frame, in loops
+    over the lanes that the compiler packs together. The interpolations and their
+    lookahead are those of ModulatedDelayLine, and so is the room left in the
+    buffer, so a stereo pair gives the same output through either line.
+*/
+class StereoDelayLine
+{
+public:
+    //==============================================================================
+
+    enum { numLanes = 2 };
+
+    /** Clears the history, with room for delays of up to maxDelaySamples with any
+        interpolation. It only allocates if the history grows. Not for the audio
+        thread.
+    */
+    void prepare (const int maxDelaySamples)
+    {
+        bufferSamples = jmax (1, maxDelaySamples) + ModulatedDelayLine::maxBlockSize + 2 * SincInterpolator::numTaps;
+        maxDelay = (float)(bufferSamples - ModulatedDelayLine::maxBlockSize - SincInterpolator::numTaps);
+
+        // Also clears it
+        buffer.setSize (1, numLanes * bufferSamples);
+        writePosition = 0;
+    }
+
+    void clear() noexcept
+    {
+        buffer.clear();
+        writePosition = 0;
+    }
+
+    int getWritePosition() const noexcept
+    {
+        return writePosition;
+    }
+
+    void advance (const int numSamples) noexcept
+    {
+        writePosition = (writePosition + numSamples) % bufferSamples;
+    }
+
+    /** Wraps a position that is at most one buffer length out of range. */
+    int wrap (const int position) const noexcept
+    {
+        if (position >= bufferSamples)
+            return position - bufferSamples;
+        if (position < 0)
+            return position + bufferSamples;
+        return position;
+    }
+
+    void addMemoryFootprint (MemoryFootprint& footprint) const noexcept
+    {
+        footprint.add (MemoryFootprint::delayLines, buffer);
+    }
+
+    //==============================================================================
+
+    /** Interleaves a block of the two channels that starts at position. */
+    void write (const float* left, const float* right, const int numSamples, const int position) noexcept
+    {
+        float* data = buffer.getWritePointer (0);
+        int frame = position;
+
+        for (int sample = 0; sample < numSamples; ++sample) {
+            data[numLanes * frame] = left[sample];
+            data[numLanes * frame + 1] = right[sample];
+            frame = (frame + 1 < bufferSamples) ? frame + 1 : 0;
+        }
+    }
+
+    void writeFrame (const int position, const float* frame) noexcept
+    {
+        float* data = buffer.getWritePointer (0) + numLanes * position;
+        for (int lane = 0; lane < numLanes; ++lane)
+            data[lane] = frame[lane];
+    }
+
+    /** Reads every channel delays[lane] samples behind position into frame[lane].
+        The delays are kept to the lookahead of the interpolation, as in
+        ModulatedDelayLine::computeReadPositions(), so a delay shorter than one
+        sample more than that reads the frame at position, which then has to be
+        written first.
+    */
+    void readFrame (const int position, const float* delays, float* frame, const int interpolation) const noexcept
+    {
+        switch (interpolation) {
+            case ModulatedDelayLine::interpolationLinear:
+                read<ModulatedDelayLine::interpolationLinear> (position, delays, frame);
+                break;
+            case ModulatedDelayLine::interpolationCubic:
+                read<ModulatedDelayLine::interpolationCubic> (position, delays, frame);
+                break;
+            case ModulatedDelayLine::interpolationSinc:
+                read<ModulatedDelayLine::interpolationSinc> (position, delays, frame);
+                break;
+            default:
+                read<ModulatedDelayLine::interpolationNearestNeighbour> (position, delays, frame);
+                break;
+        }
+    }
+
+private:
+    //==============================================================================
+
+    template <int interpolation>
+    void read (const int position, const float* delays, float* frame) const noexcept
+    {
+        const float minDelay = (float)ModulatedDelayLine::getLookahead (interpolation);
+        const float* data = buffer.getReadPointer (0);
+
+        int indices[numLanes];
+        float fractions[numLanes];
+
+        for (int lane = 0; lane < numLanes; ++lane) {
+            float readPosition = (float)position - jlimit (minDelay, maxDelay, delays[lane]);
+            if (readPosition < 0.0f)
+                readPosition += (float)bufferSamples;
+
+            const int index = (int)readPosition;
+            indices[lane] = (index < bufferSamples) ? index : index - bufferSamples;
+            fractions[lane] = readPosition - (float)index;
+        }
+
+        for (int lane = 0; lane < numLanes; ++lane) {
+            const float* channelData = data + lane;
+            const int index = indices[lane];
+            const float fraction = fractions[lane];
+
+            switch (interpolation) {
+                case ModulatedDelayLine::interpolationLinear: {
+                    const float sample1 = channelData[numLanes * index];
+                    const float sample2 = channelData[numLanes * ((index + 1 < bufferSamples) ? index + 1 : 0)];
+                    frame[lane] = sample1 + fraction * (sample2 - sample1);
+                    break;
+                }
+                case ModulatedDelayLine::interpolationCubic: {
+                    const float fractionSqrt = fraction * fraction;
+                    const float fractionCube = fractionSqrt * fraction;
+
+                    const float sample0 = channelData[numLanes * ((index > 0) ? index - 1 : bufferSamples - 1)];
+                    const float sample1 = channelData[numLanes * index];
+                    const float sample2 = channelData[numLanes * wrap (index + 1)];
+                    const float sample3 = channelData[numLanes * wrap (index + 2)];
+
+                    const float a0 = - 0.5f * sample0 + 1.5f * sample1 - 1.5f * sample2 + 0.5f * sample3;
+                    const float a1 = sample0 - 2.5f * sample1 + 2.0f * sample2 - 0.5f * sample3;
+                    const float a2 = - 0.5f * sample0 + 0.5f * sample2;
+                    const float a3 = sample1;
+                    frame[lane] = a0 * fractionCube + a1 * fractionSqrt + a2 * fraction + a3;
+                    break;
+                }
+                case ModulatedDelayLine::interpolationSinc: {
+                    // The taps of the channel, gathered out of the frames
+                    float taps[SincInterpolator::numTaps];
+                    const int firstTap = index - ((int)SincInterpolator::latencySamples - 1);
+                    for (int tap = 0; tap < (int)SincInterpolator::numTaps; ++tap)
+                        taps[tap] = channelData[numLanes * wrap (firstTap + tap)];
+
+                    frame[lane] = sincInterpolator.read (taps, (int)SincInterpolator::numTaps,
+                                                         (int)SincInterpolator::latencySamples - 1, fraction);
+                    break;
+                }
+                default: {
+                    frame[lane] = channelData[numLanes * index];
+                    break;
+                }
+            }
+        }
+    }
+
+    //==============================================================================
+
+    DelayBuffer<float> buffer;
+    int bufferSamples = 1;
+    int writePosition = 0;
+    float maxDelay = 0.0f;
+
+    SincInterpolator sincInterpolator;
+};
+
+//==============================================================================
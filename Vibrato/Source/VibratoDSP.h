@@ -0,0 +1,204 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "MemoryFootprint.h"
+#include "ChannelWorkerPool.h"
+#include "WavetableLFO.h"
+#include "ModulatedDelayLine.h"
+#include "StereoDelayLine.h"
+
+//==============================================================================
+
+/** The audio processing of the Vibrato, without the parameters, state, editor or
+    buses of the plugin, for hosts that only need the audio and run many instances.
+    VibratoAudioProcessor wraps one and hands it the values of its parameters once
+    a block, in their natural units: the width in seconds, the frequency in Hz, and
+    the indices of the waveform and of the interpolation.
+*/
+class VibratoDSP
+{
+public:
+    enum parameterIndex {
+        parameterWidth = 0,
+        parameterFrequency,
+        parameterWaveform,
+        parameterInterpolation,
+        numParameters,
+    };
+
+    /** Allocates the delay line of the layout, of maxDelayTime seconds. */
+    void prepare (const double newSampleRate, const int numChannels, const float maxDelayTime)
+    {
+        sampleRate = newSampleRate;
+        inverseSampleRate = 1.0f / (float)sampleRate;
+
+        // Only the line of the layout is allocated
+        stereoLinked = (numChannels == StereoDelayLine::numLanes);
+        if (stereoLinked)
+            stereoDelayLine.prepare ((int)(maxDelayTime * (float)sampleRate) + 1);
+        else
+            delayLine.prepare (numChannels, (int)(maxDelayTime * (float)sampleRate) + 1);
+
+        lfo.setPhase (0.0f);
+        channelWorkers->prepare (numChannels);
+    }
+
+    void reset() noexcept
+    {
+        delayLine.clear();
+        stereoDelayLine.clear();
+    }
+
+    void setParameter (const int index, const float value) noexcept
+    {
+        switch (index) {
+            case parameterWidth:         width = value; break;
+            case parameterFrequency:     frequency = value; break;
+            case parameterWaveform:      waveform = jlimit (0, WavetableLFO::numWaveforms - 1, (int)value); break;
+            case parameterInterpolation: interpolation = jlimit ((int)ModulatedDelayLine::interpolationNearestNeighbour,
+                                                                 (int)ModulatedDelayLine::interpolationSinc, (int)value); break;
+        }
+    }
+
+    /** The steps of reduction of a quality governor, under which the taps are read
+        with a cheaper interpolation.
+    */
+    void setQualityReduction (const int newQualityReduction) noexcept
+    {
+        qualityReduction = newQualityReduction;
+    }
+
+    /** Processes numSamples samples of numChannels channels in place. */
+    void process (float* const* channels, const int numChannels, const int numSamples) noexcept
+    {
+        float phaseMain = lfo.getPhase();
+
+        lfo.setWaveform (waveform);
+        lfo.setFrequency (frequency, inverseSampleRate);
+
+        // The input is written before it is read, so the LFO sweeps the delay from one
+        // sample behind it, or from the lookahead of the cubic and sinc interpolations
+        const float minDelay = (float)jmax (1, ModulatedDelayLine::getLookahead (interpolation));
+        const float widthSamples = width * (float)sampleRate;
+
+        // Under a reduction of the quality governor the taps are read with a cheaper
+        // interpolation, but the delays keep the lookahead of the one chosen
+        const int readInterpolation = ModulatedDelayLine::getReducedInterpolation (interpolation, qualityReduction);
+
+        if (stereoLinked && numChannels == StereoDelayLine::numLanes) {
+            // Both channels read at the delays of one LFO, a frame at a time
+            int localWritePosition = stereoDelayLine.getWritePosition();
+            float delays[ModulatedDelayLine::maxBlockSize];
+
+            for (int blockStart = 0; blockStart < numSamples; blockStart += ModulatedDelayLine::maxBlockSize) {
+                const int blockSamples = jmin ((int)ModulatedDelayLine::maxBlockSize, numSamples - blockStart);
+
+                lfo.fill (delays, blockSamples);
+                for (int sample = 0; sample < blockSamples; ++sample)
+                    delays[sample] = minDelay + widthSamples * delays[sample];
+
+                stereoDelayLine.write (channels[0] + blockStart, channels[1] + blockStart, blockSamples, localWritePosition);
+
+                for (int sample = 0; sample < blockSamples; ++sample) {
+                    const float frameDelays[StereoDelayLine::numLanes] = { delays[sample], delays[sample] };
+                    float out[StereoDelayLine::numLanes];
+
+                    stereoDelayLine.readFrame (stereoDelayLine.wrap (localWritePosition + sample), frameDelays, out, readInterpolation);
+                    for (int lane = 0; lane < StereoDelayLine::numLanes; ++lane)
+                        channels[lane][blockStart + sample] = out[lane];
+                }
+
+                localWritePosition = stereoDelayLine.wrap (localWritePosition + blockSamples);
+            }
+
+            stereoDelayLine.advance (numSamples);
+            phaseMain = lfo.getPhase();
+        } else {
+            channelWorkers->forEachChannel (jmin (numChannels, delayLine.getNumChannels()), [&] (const int channel) {
+                float* channelData = channels[channel];
+                int localWritePosition = delayLine.getWritePosition();
+                WavetableLFO channelLfo (lfo);
+                float delays[ModulatedDelayLine::maxBlockSize];
+                ModulatedDelayLine::ReadPositions positions;
+
+                for (int blockStart = 0; blockStart < numSamples; blockStart += ModulatedDelayLine::maxBlockSize) {
+                    const int blockSamples = jmin ((int)ModulatedDelayLine::maxBlockSize, numSamples - blockStart);
+
+                    channelLfo.fill (delays, blockSamples);
+                    for (int sample = 0; sample < blockSamples; ++sample)
+                        delays[sample] = minDelay + widthSamples * delays[sample];
+
+                    delayLine.computeReadPositions (positions, delays, blockSamples, 1, localWritePosition, interpolation);
+                    delayLine.write (channel, channelData + blockStart, blockSamples, localWritePosition);
+                    delayLine.read (channel, positions, channelData + blockStart, readInterpolation);
+
+                    localWritePosition = delayLine.wrap (localWritePosition + blockSamples);
+                }
+
+                if (channel == 0)
+                    phaseMain = channelLfo.getPhase();
+            });
+
+            delayLine.advance (numSamples);
+        }
+
+        lfo.setPhase (phaseMain);
+    }
+
+    void addMemoryFootprint (MemoryFootprint& footprint) const
+    {
+        delayLine.addMemoryFootprint (footprint);
+        stereoDelayLine.addMemoryFootprint (footprint);
+    }
+
+private:
+    //==============================================================================
+
+    /** Each channel fills its own copy of the LFO one block of the delay line at a
+        time, so that the channels can run on the workers.
+    */
+    ModulatedDelayLine delayLine;
+
+    /** A stereo pair runs through stereoDelayLine in one pass instead, both
+        channels reading at the delays of a single LFO.
+    */
+    StereoDelayLine stereoDelayLine;
+    bool stereoLinked = false;
+
+    WavetableLFO lfo;
+    double sampleRate = 44100.0;
+    float inverseSampleRate = 1.0f / 44100.0f;
+
+    SharedResourcePointer<ChannelWorkerPool> channelWorkers;
+
+    float width = 0.01f;
+    float frequency = 2.0f;
+    int waveform = WavetableLFO::waveformSine;
+    int interpolation = ModulatedDelayLine::interpolationLinear;
+    int qualityReduction = 0;
+};
+
+//==============================================================================
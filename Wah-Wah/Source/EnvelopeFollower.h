@@ -0,0 +1,149 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <cmath>
+
+//==============================================================================
+
+/** One pole envelope follower with separate attack and release times.
+
+    The envelope moves towards the input with the attack coefficient while the input
+    is above it, and with the release coefficient otherwise, or the other way around
+    for an envelope that attacks on its way down, like the gain of an expander. The
+    coefficients live in a Coefficients object, which many followers can share, and
+    are only computed again when one of the times changes. process() runs a whole
+    block with the envelope in a local variable, so that it stays in a register, and
+    stores it back once at the end.
+*/
+class EnvelopeFollower
+{
+public:
+    //==============================================================================
+
+    class Coefficients
+    {
+    public:
+        Coefficients()
+            : sampleRate (44100.0)
+            , attackTime (0.0f)
+            , releaseTime (0.0f)
+            , attack (0.0f)
+            , release (0.0f)
+        {
+        }
+
+        void prepare (const double newSampleRate) noexcept
+        {
+            sampleRate = newSampleRate;
+            attack = calculateCoefficient (attackTime);
+            release = calculateCoefficient (releaseTime);
+        }
+
+        /** Times in seconds to move 1 - 1/e of the way to a new input level. */
+        void setTimes (const float newAttackTime, const float newReleaseTime) noexcept
+        {
+            if (newAttackTime != attackTime) {
+                attackTime = newAttackTime;
+                attack = calculateCoefficient (attackTime);
+            }
+            if (newReleaseTime != releaseTime) {
+                releaseTime = newReleaseTime;
+                release = calculateCoefficient (releaseTime);
+            }
+        }
+
+        float getAttack() const noexcept
+        {
+            return attack;
+        }
+
+        float getRelease() const noexcept
+        {
+            return release;
+        }
+
+    private:
+        float calculateCoefficient (const float time) const noexcept
+        {
+            if (time <= 0.0f)
+                return 0.0f;
+            else
+                return (float)std::exp (-1.0 / ((double)time * sampleRate));
+        }
+
+        double sampleRate;
+        float attackTime;
+        float releaseTime;
+        float attack;
+        float release;
+    };
+
+    //==============================================================================
+
+    EnvelopeFollower()
+        : envelope (0.0)
+    {
+    }
+
+    void reset (const double value = 0.0) noexcept
+    {
+        envelope = value;
+    }
+
+    double getEnvelope() const noexcept
+    {
+        return envelope;
+    }
+
+    /** Follows numSamples samples of input, and writes the envelope to output, which
+        can be the same array.
+    */
+    template <typename SampleType>
+    void process (const Coefficients& coefficients, const SampleType* input, SampleType* output,
+                  const int numSamples, const bool attackWhenFalling = false) noexcept
+    {
+        const SampleType attack = (SampleType)coefficients.getAttack();
+        const SampleType release = (SampleType)coefficients.getRelease();
+        SampleType localEnvelope = (SampleType)envelope;
+
+        for (int sample = 0; sample < numSamples; ++sample) {
+            const SampleType in = input[sample];
+            const SampleType alpha = ((in > localEnvelope) != attackWhenFalling) ? attack : release;
+
+            localEnvelope = alpha * localEnvelope + ((SampleType)1 - alpha) * in;
+            output[sample] = localEnvelope;
+        }
+
+        envelope = (double)localEnvelope;
+    }
+
+private:
+    //==============================================================================
+
+    // Kept as a double, which holds the float state exactly, for either precision
+    double envelope;
+};
+
+//==============================================================================
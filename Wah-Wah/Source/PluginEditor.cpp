@@ -100,13 +100,21 @@ WahWahAudioProcessorEditor::WahWahAudioProcessorEditor (WahWahAudioProcessor& p)
 
     //======================================
 
+    addAndMakeVisible (responseCurve);
+    editorHeight += ResponseCurveDisplay::preferredHeight + editorPadding;
+
     editorHeight += components.size() * editorPadding;
     setSize (editorWidth, editorHeight);
+    setOpaque (true);
+    setLookAndFeel (lookAndFeel);
+    renderingContext.attachTo (*this);
     startTimer (50);
 }
 
 WahWahAudioProcessorEditor::~WahWahAudioProcessorEditor()
 {
+    renderingContext.detach();
+    setLookAndFeel (nullptr);
 }
 
 //==============================================================================
@@ -133,31 +141,50 @@ void WahWahAudioProcessorEditor::resized()
 
         r = r.removeFromBottom (r.getHeight() - editorPadding);
     }
+
+    responseCurve.setBounds (getLocalBounds().reduced (editorMargin).removeFromBottom (ResponseCurveDisplay::preferredHeight));
 }
 
 //==============================================================================
 
 void WahWahAudioProcessorEditor::timerCallback()
 {
-    updateUIcomponents();
+    // Only touches the components when something they show changed. The automatic
+    // mode moves the centre frequency without changing any parameter.
+    if ((uiValues.generationChanged (processor.parameters.getChangeGeneration())
+         || processor.paramMode.getTargetValue() == processor.modeAutomatic)
+        && uiValues.changed ({ processor.paramMode.getTargetValue(), processor.paramPedal.getTargetValue(), processor.wahWah.getCentreFrequency() }))
+        updateUIcomponents();
+
+    // The response only changes with the parameters, or while the automatic mode
+    // moves the centre frequency
+    const uint32 generation = processor.wahWah.getResponseGeneration();
+    if (responseCurve.needsUpdate (generation) && processor.getSampleRate() > 0.0) {
+        const IIRCoefficients coefficients = processor.wahWah.getFilterCoefficients (processor.wahWah.getCentreFrequency());
+        responseCurve.setResponse (generation, processor.getSampleRate(), &coefficients, 1);
+    }
 }
 
 void WahWahAudioProcessorEditor::updateUIcomponents()
 {
     if (processor.paramMode.getTargetValue() == processor.modeAutomatic) {
         if (Slider* aSlider = dynamic_cast<Slider*> (findChildWithID (processor.paramFrequency.paramID)))
-            aSlider->setValue (processor.centreFrequency);
+            aSlider->setValue (processor.wahWah.getCentreFrequency());
         findChildWithID (processor.paramFrequency.paramID)->setEnabled (false);
         findChildWithID (processor.paramLFOfrequency.paramID)->setEnabled (true);
         findChildWithID (processor.paramMixLFOandEnvelope.paramID)->setEnabled (true);
         findChildWithID (processor.paramEnvelopeAttack.paramID)->setEnabled (true);
         findChildWithID (processor.paramEnvelopeRelease.paramID)->setEnabled (true);
+        findChildWithID (processor.paramControlRate.paramID)->setEnabled (true);
+        findChildWithID (processor.paramPedal.paramID)->setEnabled (false);
     } else {
         findChildWithID (processor.paramFrequency.paramID)->setEnabled (true);
         findChildWithID (processor.paramLFOfrequency.paramID)->setEnabled (false);
         findChildWithID (processor.paramMixLFOandEnvelope.paramID)->setEnabled (false);
         findChildWithID (processor.paramEnvelopeAttack.paramID)->setEnabled (false);
         findChildWithID (processor.paramEnvelopeRelease.paramID)->setEnabled (false);
+        findChildWithID (processor.paramControlRate.paramID)->setEnabled (processor.paramPedal.getTargetValue() != processor.pedalOff);
+        findChildWithID (processor.paramPedal.paramID)->setEnabled (true);
     }
 }
 
@@ -24,6 +24,8 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "PluginProcessor.h"
+#include "EditorRendering.h"
+#include "ResponseCurveDisplay.h"
 
 //==============================================================================
 
@@ -79,6 +81,14 @@ private:
 
     void timerCallback() override;
     void updateUIcomponents();
+    EditorValueSnapshot uiValues;
+
+    ResponseCurveDisplay responseCurve;
+
+    //======================================
+
+    EditorRenderingContext renderingContext;
+    SharedResourcePointer<EditorLookAndFeel> lookAndFeel;
 
     //==============================================================================
 
@@ -43,20 +43,24 @@ WahWahAudioProcessor::WahWahAudioProcessor():
     parameters (*this)
     , paramMode (parameters, "Mode", modeItemsUI, modeManual)
     , paramMix (parameters, "Mix", "", 0.0f, 1.0f, 0.5f)
-    , paramFrequency (parameters, "Frequency", "Hz", 200.0f, 1300.0f, 300.0f,
-                      [this](float value){ paramFrequency.setCurrentAndTargetValue (value); updateFilters(); return value; })
+    , paramFrequency (parameters, "Frequency", "Hz", WahWahDSP::minFrequency, WahWahDSP::maxFrequency, 300.0f,
+                      [this](float value){ wahWah.setParameter (WahWahDSP::parameterFrequency, value); return value; })
     , paramQfactor (parameters, "Q Factor", "", 0.1f, 20.0f, 10.0f,
-                    [this](float value){ paramQfactor.setCurrentAndTargetValue (value); updateFilters(); return value; })
+                    [this](float value){ wahWah.setParameter (WahWahDSP::parameterQfactor, value); return value; })
     , paramGain (parameters, "Gain", "dB", 0.0f, 20.0f, 20.0f,
-                 [this](float value){ paramGain.setCurrentAndTargetValue (value); updateFilters(); return value; })
+                 [this](float value){ wahWah.setParameter (WahWahDSP::parameterGain, value); return value; })
     , paramFilterType (parameters, "Filter type", filterTypeItemsUI, filterTypeResonantLowPass,
-                       [this](float value){ paramFilterType.setCurrentAndTargetValue (value); updateFilters(); return value; })
+                       [this](float value){ wahWah.setParameter (WahWahDSP::parameterFilterType, value); return value; })
     , paramLFOfrequency (parameters, "LFO Frequency", "Hz", 0.0f, 5.0f, 2.0f)
     , paramMixLFOandEnvelope (parameters, "LFO/Env", "", 0.0f, 1.0f, 0.8f)
     , paramEnvelopeAttack (parameters, "Env. Attack", "ms", 0.1f, 100.0f, 2.0f, [](float value){ return value * 0.001f; })
     , paramEnvelopeRelease (parameters, "Env. Release", "ms", 10.0f, 1000.0f, 300.0f, [](float value){ return value * 0.001f; })
+    , paramControlRate (parameters, "Control rate", controlRateItemsUI, controlRate32,
+                        [](float value){ return (value == 0.0f) ? 1.0f : (float)(1 << ((int)value + 2)); })
+    , paramTopology (parameters, "Topology", topologyItemsUI, topologyDirectForm)
+    , paramPedal (parameters, "Pedal", pedalItemsUI, pedalOff)
+    , bypass (*this, parameters)
 {
-    centreFrequency = paramFrequency.getTargetValue();
     parameters.apvts.state = ValueTree (Identifier (getName().removeCharacters ("- ")));
 }
 
@@ -68,6 +72,8 @@ WahWahAudioProcessor::~WahWahAudioProcessor()
 
 void WahWahAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
+    TRACE_INSTANCE_SCOPE ("prepareToPlay", this);
+
     const double smoothTime = 1e-3;
     paramMode.reset (sampleRate, smoothTime);
     paramMix.reset (sampleRate, smoothTime);
@@ -79,108 +85,102 @@ void WahWahAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock
     paramMixLFOandEnvelope.reset (sampleRate, smoothTime);
     paramEnvelopeAttack.reset (sampleRate, smoothTime);
     paramEnvelopeRelease.reset (sampleRate, smoothTime);
+    paramControlRate.reset (sampleRate, smoothTime);
+    paramTopology.reset (sampleRate, smoothTime);
+    paramPedal.reset (sampleRate, smoothTime);
 
     //======================================
 
-    filters.clear();
-    for (int i = 0; i < getTotalNumInputChannels(); ++i) {
-        Filter* filter;
-        filters.add (filter = new Filter());
-    }
-    updateFilters();
-
-    lfoPhase = 0.0f;
-    inverseSampleRate = 1.0f / (float)sampleRate;
-    twoPi = 2.0f * M_PI;
+    updateDSPParameters();
+    wahWah.prepare (sampleRate, getTotalNumInputChannels(), smoothTime);
 
-    for (int i = 0; i < getTotalNumInputChannels(); ++i)
-        envelopes.add (0.0f);
-    inverseE = 1.0f / M_E;
+    profiler.prepare (sampleRate);
+    silenceDetector.prepare (sampleRate);
+    bypass.prepare (sampleRate, samplesPerBlock, 0);
 }
 
 void WahWahAudioProcessor::releaseResources()
 {
 }
 
+void WahWahAudioProcessor::reset()
+{
+    wahWah.reset();
+}
+
 void WahWahAudioProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
 {
+    const ProcessBlockProfiler::ScopedMeasurement measurement (profiler, buffer.getNumSamples(), isNonRealtime());
+    TRACE_INSTANCE_SCOPE ("processBlock", this);
     ScopedNoDenormals noDenormals;
 
+    parameters.applySnapshotMorph();
+
     const int numInputChannels = getTotalNumInputChannels();
     const int numOutputChannels = getTotalNumOutputChannels();
     const int numSamples = buffer.getNumSamples();
 
     //======================================
 
-    float phase;
-
-    for (int channel = 0; channel < numInputChannels; ++channel) {
-        float* channelData = buffer.getWritePointer (channel);
-        phase = lfoPhase;
-
-        for (int sample = 0; sample < numSamples; ++sample) {
-            float in = channelData[sample];
-
-            float absIn = fabs (in);
-            float envelope;
-            float attack = calculateAttackOrRelease (paramEnvelopeAttack.getNextValue());
-            float release = calculateAttackOrRelease (paramEnvelopeRelease.getNextValue());
+    if (silenceDetector.skipBlock (*this, buffer))
+        return;
 
-            if (absIn > envelopes[channel])
-                envelope = attack * envelopes[channel] + (1.0f - attack) * absIn;
-            else
-                envelope = release * envelopes[channel] + (1.0f - release) * absIn;
+    if (bypass.begin (buffer))
+        return;
 
-            envelopes.set (channel, envelope);
+    if (paramMode.getTargetValue() == modeManual && (int)paramPedal.getTargetValue() != pedalOff)
+        collectPedalEvents (midiMessages, numSamples);
 
-            if (paramMode.getTargetValue() == modeAutomatic) {
-                float centreFrequencyLFO = 0.5f + 0.5f * sinf (twoPi * phase);
-                float centreFrequencyEnv = envelopes[channel];
-                centreFrequency =
-                    centreFrequencyLFO + paramMixLFOandEnvelope.getNextValue() * (centreFrequencyEnv - centreFrequencyLFO);
-
-                centreFrequency *= paramFrequency.maxValue - paramFrequency.minValue;
-                centreFrequency += paramFrequency.minValue;
-
-                phase += paramLFOfrequency.getNextValue() * inverseSampleRate;
-                if (phase >= 1.0f)
-                    phase -= 1.0f;
-
-                paramFrequency.setCurrentAndTargetValue (centreFrequency);
-                updateFilters();
-            }
-
-            float filtered = filters[channel]->processSingleSampleRaw (in);
-            float out = in + paramMix.getNextValue() * (filtered - in);
-            channelData[sample] = out;
-        }
-    }
-
-    lfoPhase = phase;
+    updateDSPParameters();
+    wahWah.process (buffer.getArrayOfWritePointers(), numInputChannels, numSamples);
 
     for (int channel = numInputChannels; channel < numOutputChannels; ++channel)
         buffer.clear (channel, 0, numSamples);
+
+    bypass.end (buffer);
 }
 
 //==============================================================================
 
-void WahWahAudioProcessor::updateFilters()
+void WahWahAudioProcessor::updateDSPParameters() noexcept
 {
-    double discreteFrequency = 2.0 * M_PI * (double)paramFrequency.getTargetValue() / getSampleRate();
-    double qFactor = (double)paramQfactor.getTargetValue();
-    double gain = pow (10.0, (double)paramGain.getTargetValue() * 0.05);
-    int type = (int)paramFilterType.getTargetValue();
+    wahWah.setParameter (WahWahDSP::parameterMode, paramMode.getTargetValue());
+    wahWah.setParameter (WahWahDSP::parameterMix, paramMix.getTargetValue());
+    wahWah.setParameter (WahWahDSP::parameterLFOfrequency, paramLFOfrequency.getTargetValue());
+    wahWah.setParameter (WahWahDSP::parameterMixLFOandEnvelope, paramMixLFOandEnvelope.getTargetValue());
+    wahWah.setParameter (WahWahDSP::parameterEnvelopeAttack, paramEnvelopeAttack.getTargetValue());
+    wahWah.setParameter (WahWahDSP::parameterEnvelopeRelease, paramEnvelopeRelease.getTargetValue());
+    wahWah.setParameter (WahWahDSP::parameterControlRate, paramControlRate.getTargetValue());
+    wahWah.setParameter (WahWahDSP::parameterTopology, paramTopology.getTargetValue());
+    wahWah.setParameter (WahWahDSP::parameterPedal, (int)paramPedal.getTargetValue() != pedalOff ? 1.0f : 0.0f);
+}
 
-    for (int i = 0; i < filters.size(); ++i)
-        filters[i]->updateCoefficients (discreteFrequency, qFactor, gain, type);
+void WahWahAudioProcessor::collectPedalEvents (const MidiBuffer& midiMessages, const int numSamples) noexcept
+{
+    const int controller = getPedalController ((int)paramPedal.getTargetValue());
+
+    MidiBuffer::Iterator iterator (midiMessages);
+    MidiMessage message;
+    int sample;
+
+    while (iterator.getNextEvent (message, sample)) {
+        if (! message.isControllerOfType (controller))
+            continue;
+
+        wahWah.addPedalEvent (jlimit (0, numSamples - 1, sample), (float)message.getControllerValue() / 127.0f);
+    }
 }
 
-float WahWahAudioProcessor::calculateAttackOrRelease (float value)
+int WahWahAudioProcessor::getPedalController (const int pedal) noexcept
 {
-    if (value == 0.0f)
-        return 0.0f;
-    else
-        return pow (inverseE, inverseSampleRate / value);
+    switch (pedal) {
+        case pedalModulation:
+            return 1;
+        case pedalFootController:
+            return 4;
+        default:
+            return 11;
+    }
 }
 
 //==============================================================================
@@ -194,13 +194,17 @@ float WahWahAudioProcessor::calculateAttackOrRelease (float value)
 
 void WahWahAudioProcessor::getStateInformation (MemoryBlock& destData)
 {
-    auto state = parameters.apvts.copyState();
-    std::unique_ptr<XmlElement> xml (state.createXml());
-    copyXmlToBinary (*xml, destData);
+    MemoryOutputStream stream (destData, false);
+    parameters.writeState (stream);
 }
 
 void WahWahAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
+    MemoryInputStream stream (data, (size_t)sizeInBytes, false);
+    if (parameters.readState (stream))
+        return;
+
+    // Sessions saved in the XML format of older versions
     std::unique_ptr<XmlElement> xmlState (getXmlFromBinary (data, sizeInBytes));
 
     if (xmlState.get() != nullptr)
@@ -229,10 +233,9 @@ bool WahWahAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) c
     ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    if (layouts.getMainOutputChannelSet() != AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != AudioChannelSet::stereo())
+    // The channels are processed independently, so any layout with at least one
+    // channel is supported, from mono to surround sets or ambisonic stems.
+    if (layouts.getMainOutputChannelSet().isDisabled())
         return false;
 
     // This checks if the input layout matches the output layout
@@ -282,7 +285,18 @@ bool WahWahAudioProcessor::isMidiEffect() const
 
 double WahWahAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    if (paramMode.getTargetValue() != modeAutomatic)
+        return SilenceDetector::getResonanceTailSeconds (wahWah.getCentreFrequency(), paramQfactor.getTargetValue());
+
+    // The sweep may leave the filter at its lowest frequency, and the envelope
+    // follower has to release before the sweep is back where it would be
+    return jmax (SilenceDetector::getResonanceTailSeconds (WahWahDSP::minFrequency, paramQfactor.getTargetValue()),
+                 SilenceDetector::getDecayTailSeconds (paramEnvelopeRelease.getTargetValue()));
+}
+
+AudioProcessorParameter* WahWahAudioProcessor::getBypassParameter() const
+{
+    return bypass.getParameter();
 }
 
 //==============================================================================
@@ -313,6 +327,21 @@ void WahWahAudioProcessor::changeProgramName (int index, const String& newName)
 
 //==============================================================================
 
+MemoryFootprint WahWahAudioProcessor::getMemoryFootprint() const
+{
+    const ScopedLock lock (parameters.deferredCallbackLock);
+
+    MemoryFootprint footprint;
+    footprint.add (MemoryFootprint::other, sizeof (*this));
+    bypass.addMemoryFootprint (footprint);
+
+    wahWah.addMemoryFootprint (footprint);
+
+    return footprint;
+}
+
+//==============================================================================
+
 // This creates new instances of the plugin..
 AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
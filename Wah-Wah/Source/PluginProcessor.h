@@ -30,10 +30,15 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "PluginParameter.h"
+#include "ProcessBlockProfiler.h"
+#include "SilenceDetector.h"
+#include "PluginBypass.h"
+#include "MemoryFootprint.h"
+#include "WahWahDSP.h"
 
 //==============================================================================
 
-class WahWahAudioProcessor : public AudioProcessor
+class WahWahAudioProcessor : public AudioProcessor, public MemoryFootprintSource
 {
 public:
     //==============================================================================
@@ -45,6 +50,7 @@ public:
 
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
+    void reset() override;
     void processBlock (AudioSampleBuffer&, MidiBuffer&) override;
 
     //==============================================================================
@@ -78,6 +84,7 @@ public:
     bool producesMidi() const override;
     bool isMidiEffect () const override;
     double getTailLengthSeconds() const override;
+    AudioProcessorParameter* getBypassParameter() const override;
 
     //==============================================================================
 
@@ -89,10 +96,7 @@ public:
 
     //==============================================================================
 
-
-
-
-
+    MemoryFootprint getMemoryFootprint() const override;
 
     //==============================================================================
 
@@ -102,8 +106,8 @@ public:
     };
 
     enum modeIndex {
-        modeManual = 0,
-        modeAutomatic,
+        modeManual = WahWahDSP::modeManual,
+        modeAutomatic = WahWahDSP::modeAutomatic,
     };
 
     StringArray filterTypeItemsUI = {
@@ -113,76 +117,71 @@ public:
     };
 
     enum filterTypeIndex {
-        filterTypeResonantLowPass = 0,
-        filterTypeBandPass,
-        filterTypePeakingNotch,
+        filterTypeResonantLowPass = WahWahDSP::filterTypeResonantLowPass,
+        filterTypeBandPass = WahWahDSP::filterTypeBandPass,
+        filterTypePeakingNotch = WahWahDSP::filterTypePeakingNotch,
     };
 
-    //======================================
+    StringArray topologyItemsUI = {
+        "Direct form",
+        "State variable"
+    };
+
+    enum topologyIndex {
+        topologyDirectForm = WahWahDSP::topologyDirectForm,
+        topologyStateVariable = WahWahDSP::topologyStateVariable,
+    };
+
+    StringArray controlRateItemsUI = {
+        "Every sample",
+        "Every 8 samples",
+        "Every 16 samples",
+        "Every 32 samples",
+        "Every 64 samples"
+    };
 
-    class Filter : public IIRFilter
-    {
-    public:
-        void updateCoefficients (const double discreteFrequency,
-                                 const double qFactor,
-                                 const double gain,
-                                 const int filterType) noexcept
-        {
-            jassert (discreteFrequency > 0);
-            jassert (qFactor > 0);
-
-            double bandwidth = jmin (discreteFrequency / qFactor, M_PI * 0.99);
-            double two_cos_wc = -2.0 * cos (discreteFrequency);
-            double tan_half_bw = tan (bandwidth / 2.0);
-            double tan_half_wc = tan (discreteFrequency / 2.0);
-            double tan_half_wc_2 = tan_half_wc * tan_half_wc;
-            double sqrt_gain = sqrt (gain);
-
-            switch (filterType) {
-                case filterTypeResonantLowPass: {
-                    coefficients = IIRCoefficients (/* b0 */ tan_half_wc_2,
-                                                    /* b1 */ tan_half_wc_2 * 2,
-                                                    /* b2 */ tan_half_wc_2,
-                                                    /* a0 */ tan_half_wc_2 + tan_half_wc / gain + 1.0,
-                                                    /* a1 */ 2 * tan_half_wc_2 - 2.0,
-                                                    /* a2 */ tan_half_wc_2 - tan_half_wc / gain + 1.0);
-                    break;
-                }
-                case filterTypeBandPass: {
-                    coefficients = IIRCoefficients (/* b0 */ tan_half_bw,
-                                                    /* b1 */ 0.0,
-                                                    /* b2 */ -tan_half_bw,
-                                                    /* a0 */ 1.0 + tan_half_bw,
-                                                    /* a1 */ two_cos_wc,
-                                                    /* a2 */ 1.0 - tan_half_bw);
-                    break;
-                }
-                case filterTypePeakingNotch: {
-                    coefficients = IIRCoefficients (/* b0 */ sqrt_gain + gain * tan_half_bw,
-                                                    /* b1 */ sqrt_gain * two_cos_wc,
-                                                    /* b2 */ sqrt_gain - gain * tan_half_bw,
-                                                    /* a0 */ sqrt_gain + tan_half_bw,
-                                                    /* a1 */ sqrt_gain * two_cos_wc,
-                                                    /* a2 */ sqrt_gain - tan_half_bw);
-                    break;
-                }
-            }
-
-            setCoefficients (coefficients);
-        }
+    enum controlRateIndex {
+        controlRate1 = 0,
+        controlRate8,
+        controlRate16,
+        controlRate32,
+        controlRate64,
     };
 
-    OwnedArray<Filter> filters;
-    void updateFilters();
+    StringArray pedalItemsUI = {
+        "Off",
+        "CC 1 (Modulation)",
+        "CC 4 (Foot controller)",
+        "CC 11 (Expression)"
+    };
+
+    enum pedalIndex {
+        pedalOff = 0,
+        pedalModulation,
+        pedalFootController,
+        pedalExpression,
+    };
+
+    //======================================
 
-    float centreFrequency;
-    float lfoPhase;
-    float inverseSampleRate;
-    float twoPi;
+    /** Hands the values of the parameters to the core, once a block. The
+        frequency, Q factor, gain and filter type compute the coefficients again, so
+        their callbacks hand them over as they change instead.
+    */
+    void updateDSPParameters() noexcept;
 
-    Array<float> envelopes;
-    float inverseE;
-    float calculateAttackOrRelease (float value);
+    /** Hands the values of the controller in midiMessages to the core, as positions
+        of the pedal.
+    */
+    void collectPedalEvents (const MidiBuffer& midiMessages, const int numSamples) noexcept;
+    static int getPedalController (const int pedal) noexcept;
+
+    WahWahDSP wahWah;
+
+    //======================================
+
+    ProcessBlockProfiler profiler;
+    SilenceDetector silenceDetector;
 
     //======================================
 
@@ -198,6 +197,11 @@ public:
     PluginParameterLinSlider paramMixLFOandEnvelope;
     PluginParameterLinSlider paramEnvelopeAttack;
     PluginParameterLinSlider paramEnvelopeRelease;
+    PluginParameterComboBox paramControlRate;
+    PluginParameterComboBox paramTopology;
+    PluginParameterComboBox paramPedal;
+
+    PluginBypass bypass;
 
 private:
     //==============================================================================
@@ -0,0 +1,225 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <cmath>
+
+//==============================================================================
+
+/** Filter in topology-preserving transform (TPT) form: a state variable filter
+    with trapezoidal integrators, or a single integrator for the first order
+    responses. The output is a mix of the input and the integrator outputs, set
+    by setResponse().
+
+    The cutoff only enters through g = tan (wc / 2), so moving it takes one tan(),
+    or a value from a table, and a division. The state lives in the integrators
+    rather than in past outputs, so the filter stays stable and quiet while the
+    cutoff moves at every sample, which a direct form biquad does not.
+*/
+class StateVariableFilter
+{
+public:
+    //==============================================================================
+
+    enum responseIndex {
+        responseLowPass = 0,
+        responseHighPass,
+        responseBandPass,
+        responseBandStop,
+        responsePeaking,
+        responseLowShelf,
+        responseHighShelf,
+        responseFirstOrderLowPass,
+        responseFirstOrderHighPass,
+        responseFirstOrderLowShelf,
+        responseFirstOrderHighShelf,
+    };
+
+    /** Sets the shape of the response, with a linear gain for the shelves and the
+        peaking filter. The shelves scale the cutoff, so setCutoff() has to be called
+        after this.
+    */
+    void setResponse (const int newResponse, const double qFactor, const double gain) noexcept
+    {
+        jassert (qFactor > 0);
+        jassert (gain > 0);
+
+        const double sqrtGain = sqrt (gain);
+
+        firstOrder = (newResponse >= responseFirstOrderLowPass);
+        cutoffScale = 1.0;
+        k = (float)(1.0 / qFactor);
+        m0 = m1 = m2 = 0.0f;
+
+        switch (newResponse) {
+            case responseLowPass: {
+                m2 = 1.0f;
+                break;
+            }
+            case responseHighPass: {
+                m0 = 1.0f;
+                m1 = -k;
+                m2 = -1.0f;
+                break;
+            }
+            case responseBandPass: {
+                m1 = k;
+                break;
+            }
+            case responseBandStop: {
+                m0 = 1.0f;
+                m1 = -k;
+                break;
+            }
+            case responsePeaking: {
+                k = (float)(1.0 / (qFactor * sqrtGain));
+                m0 = 1.0f;
+                m1 = (float)((double)k * (gain - 1.0));
+                break;
+            }
+            case responseLowShelf: {
+                cutoffScale = 1.0 / sqrt (sqrtGain);
+                m0 = 1.0f;
+                m1 = (float)((double)k * (sqrtGain - 1.0));
+                m2 = (float)(gain - 1.0);
+                break;
+            }
+            case responseHighShelf: {
+                cutoffScale = sqrt (sqrtGain);
+                m0 = (float)gain;
+                m1 = (float)((double)k * (1.0 - sqrtGain) * sqrtGain);
+                m2 = (float)(1.0 - gain);
+                break;
+            }
+            case responseFirstOrderLowPass: {
+                m2 = 1.0f;
+                break;
+            }
+            case responseFirstOrderHighPass: {
+                m0 = 1.0f;
+                m2 = -1.0f;
+                break;
+            }
+            case responseFirstOrderLowShelf: {
+                cutoffScale = 1.0 / sqrtGain;
+                m0 = 1.0f;
+                m2 = (float)(gain - 1.0);
+                break;
+            }
+            case responseFirstOrderHighShelf: {
+                cutoffScale = sqrtGain;
+                m0 = (float)gain;
+                m2 = (float)(1.0 - gain);
+                break;
+            }
+        }
+
+        updateGains();
+    }
+
+    /** Moves the cutoff to a discrete frequency in radians per sample. With
+        numSteps > 0, g glides linearly to its new value over the next numSteps
+        calls to processSample, which keeps the filter stable all the way.
+    */
+    void setCutoff (const double discreteFrequency, const int numSteps = 0) noexcept
+    {
+        jassert (discreteFrequency > 0);
+        setCutoffTan (tan (jmin (discreteFrequency, M_PI * 0.99) * 0.5), numSteps);
+    }
+
+    /** Same as setCutoff(), for callers that already have tan (wc / 2). */
+    void setCutoffTan (const double tanHalfFrequency, const int numSteps = 0) noexcept
+    {
+        targetG = (float)(tanHalfFrequency * cutoffScale);
+
+        if (numSteps > 0 && active) {
+            gIncrement = (targetG - g) / (float)numSteps;
+            rampSamplesRemaining = numSteps;
+        } else {
+            g = targetG;
+            rampSamplesRemaining = 0;
+            updateGains();
+        }
+
+        active = true;
+    }
+
+    float processSample (const float in) noexcept
+    {
+        if (rampSamplesRemaining > 0) {
+            g = (--rampSamplesRemaining == 0) ? targetG : g + gIncrement;
+            updateGains();
+        }
+
+        if (firstOrder) {
+            const float v = a1 * (in - ic1eq);
+            const float low = v + ic1eq;
+            ic1eq = low + v;
+            return m0 * in + m2 * low;
+        }
+
+        const float v3 = in - ic2eq;
+        const float band = a1 * ic1eq + a2 * v3;
+        const float low = ic2eq + a2 * ic1eq + a3 * v3;
+        ic1eq = 2.0f * band - ic1eq;
+        ic2eq = 2.0f * low - ic2eq;
+        return m0 * in + m1 * band + m2 * low;
+    }
+
+    void reset() noexcept
+    {
+        ic1eq = ic2eq = 0.0f;
+    }
+
+private:
+    //==============================================================================
+
+    void updateGains() noexcept
+    {
+        if (firstOrder) {
+            a1 = g / (1.0f + g);
+        } else {
+            a1 = 1.0f / (1.0f + g * (g + k));
+            a2 = g * a1;
+            a3 = g * a2;
+        }
+    }
+
+    bool firstOrder = false;
+    bool active = false;
+    double cutoffScale = 1.0;
+
+    float k = 1.0f;
+    float m0 = 0.0f, m1 = 0.0f, m2 = 1.0f;
+
+    float g = 0.0f;
+    float targetG = 0.0f;
+    float gIncrement = 0.0f;
+    int rampSamplesRemaining = 0;
+    float a1 = 1.0f, a2 = 0.0f, a3 = 0.0f;
+
+    float ic1eq = 0.0f, ic2eq = 0.0f;
+};
+
+//==============================================================================
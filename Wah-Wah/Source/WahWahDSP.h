@@ -0,0 +1,601 @@
+/*
+  ==============================================================================
+
+    Code by Juan Gil <https://juangil.com/>.
+    Copyright (C) 2017-2020 Juan Gil.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+  ==============================================================================
+*/
+
+
+
+#pragma once
+
+#define _USE_MATH_DEFINES
+#include <cmath>
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "MemoryFootprint.h"
+#include "TraceMarkers.h"
+#include "EnvelopeFollower.h"
+#include "StateVariableFilter.h"
+
+//==============================================================================
+
+/** The audio processing of the Wah-Wah, without the parameters, state, editor or
+    buses of the plugin, for hosts that only need the audio and run many instances.
+    WahWahAudioProcessor wraps one and hands it the values of its parameters once a
+    block, in their natural units: the indices of the mode, filter type and
+    topology, the mix and the mix between the LFO and the envelope from 0 to 1, the
+    frequency and the frequency of the LFO in Hz, the Q factor, the gain in dB, the
+    attack and release of the envelope in seconds, the control rate in samples and
+    the pedal as 0 or 1. The positions of the pedal come through addPedalEvent().
+
+    The frequency, Q factor, gain and filter type compute the coefficients again
+    when they change, so the processor hands them over from the callbacks of its
+    parameters too, for the editor to draw the response without audio running.
+*/
+class WahWahDSP
+{
+public:
+    enum parameterIndex {
+        parameterMode = 0,
+        parameterMix,
+        parameterFrequency,
+        parameterQfactor,
+        parameterGain,
+        parameterFilterType,
+        parameterLFOfrequency,
+        parameterMixLFOandEnvelope,
+        parameterEnvelopeAttack,
+        parameterEnvelopeRelease,
+        parameterControlRate,
+        parameterTopology,
+        parameterPedal,
+        numParameters,
+    };
+
+    enum modeIndex {
+        modeManual = 0,
+        modeAutomatic,
+    };
+
+    enum filterTypeIndex {
+        filterTypeResonantLowPass = 0,
+        filterTypeBandPass,
+        filterTypePeakingNotch,
+    };
+
+    enum topologyIndex {
+        topologyDirectForm = 0,
+        topologyStateVariable,
+    };
+
+    /** The range of the frequency, in Hz, which the automatic mode sweeps and the
+        pedal moves over.
+    */
+    static constexpr float minFrequency = 200.0f;
+    static constexpr float maxFrequency = 1300.0f;
+
+    void prepare (const double newSampleRate, const int numChannels, const double smoothTime);
+
+    void reset() noexcept;
+
+    void setParameter (const int index, const float value) noexcept
+    {
+        switch (index) {
+            case parameterMode:              currentMode = jlimit ((int)modeManual, (int)modeAutomatic, (int)value); break;
+            case parameterMix:               smoothedMix.setTargetValue (value); break;
+            case parameterLFOfrequency:      smoothedLFOfrequency.setTargetValue (value); break;
+            case parameterMixLFOandEnvelope: smoothedMixLFOandEnvelope.setTargetValue (value); break;
+            case parameterEnvelopeAttack:    currentEnvelopeAttack = value; break;
+            case parameterEnvelopeRelease:   currentEnvelopeRelease = value; break;
+            case parameterControlRate:       currentControlRate = jlimit (1, 64, (int)value); break;
+            case parameterTopology:          selectedTopology = jlimit ((int)topologyDirectForm, (int)topologyStateVariable, (int)value); break;
+            case parameterPedal:             currentPedal = (value != 0.0f); break;
+
+            case parameterFrequency:
+            case parameterQfactor:
+            case parameterGain:
+            case parameterFilterType:
+                setFilterParameter (index, value);
+                break;
+        }
+    }
+
+    /** A position of the pedal, from 0 to 1 over the range of the frequency with the
+        skew of the Frequency slider, at a sample of the next block. The positions
+        are only followed in manual mode with the pedal on, and are added in the
+        order of their samples. When there are more than maxPedalEvents, the last
+        one keeps the latest position.
+    */
+    void addPedalEvent (const int sample, const float position) noexcept
+    {
+        if (numPedalEvents == maxPedalEvents)
+            --numPedalEvents;
+
+        pedalEvents[numPedalEvents++] = { sample, position };
+    }
+
+    /** Processes numSamples samples of numChannels channels in place. */
+    void process (float* const* channels, const int numChannels, const int numSamples) noexcept;
+
+    /** The frequency the filters are at, which the LFO, the envelope and the pedal
+        move away from the one of the parameter.
+    */
+    float getCentreFrequency() const noexcept
+    {
+        return centreFrequency;
+    }
+
+    /** The coefficients of the direct form filter at frequency, for the editor. */
+    IIRCoefficients getFilterCoefficients (const float frequency) const;
+
+    /** Incremented whenever the parameters of the filter change, and once a block
+        while the centre frequency moves, so that the editor knows when to draw the
+        response again.
+    */
+    uint32 getResponseGeneration() const noexcept
+    {
+        return responseGeneration.load();
+    }
+
+    void addMemoryFootprint (MemoryFootprint& footprint) const
+    {
+        footprint.add (MemoryFootprint::filters, sizeof (Filter) * (size_t)filters.size()
+                                                 + sizeof (StateVariableFilter) * (size_t)stateVariableFilters.size()
+                                                 + sizeof (EnvelopeFollower) * (size_t)envelopes.size());
+    }
+
+private:
+    //==============================================================================
+
+    class Filter : public IIRFilter
+    {
+    public:
+        /** With numSteps > 0 the coefficients glide linearly from their current
+            values to the new ones over the next numSteps calls to processSample,
+            instead of jumping there at once.
+        */
+        void updateCoefficients (const double discreteFrequency,
+                                 const double qFactor,
+                                 const double gain,
+                                 const int filterType,
+                                 const int numSteps = 0) noexcept
+        {
+            targetCoefficients = makeCoefficients (discreteFrequency, qFactor, gain, filterType);
+
+            if (numSteps > 0 && active) {
+                for (int i = 0; i < numCoefficients; ++i)
+                    coefficientIncrements[i] = (targetCoefficients.coefficients[i] - currentCoefficients.coefficients[i]) / (float)numSteps;
+                rampSamplesRemaining = numSteps;
+            } else {
+                currentCoefficients = targetCoefficients;
+                rampSamplesRemaining = 0;
+                setCoefficients (targetCoefficients);
+            }
+        }
+
+        static IIRCoefficients makeCoefficients (const double discreteFrequency,
+                                                 const double qFactor,
+                                                 const double gain,
+                                                 const int filterType) noexcept
+        {
+            jassert (discreteFrequency > 0);
+            jassert (qFactor > 0);
+
+            IIRCoefficients newCoefficients;
+
+            double bandwidth = jmin (discreteFrequency / qFactor, M_PI * 0.99);
+            double two_cos_wc = -2.0 * cos (discreteFrequency);
+            double tan_half_bw = tan (bandwidth / 2.0);
+            double tan_half_wc = tan (discreteFrequency / 2.0);
+            double tan_half_wc_2 = tan_half_wc * tan_half_wc;
+            double sqrt_gain = sqrt (gain);
+
+            switch (filterType) {
+                case filterTypeResonantLowPass: {
+                    newCoefficients = IIRCoefficients (/* b0 */ tan_half_wc_2,
+                                                       /* b1 */ tan_half_wc_2 * 2,
+                                                       /* b2 */ tan_half_wc_2,
+                                                       /* a0 */ tan_half_wc_2 + tan_half_wc / gain + 1.0,
+                                                       /* a1 */ 2 * tan_half_wc_2 - 2.0,
+                                                       /* a2 */ tan_half_wc_2 - tan_half_wc / gain + 1.0);
+                    break;
+                }
+                case filterTypeBandPass: {
+                    newCoefficients = IIRCoefficients (/* b0 */ tan_half_bw,
+                                                       /* b1 */ 0.0,
+                                                       /* b2 */ -tan_half_bw,
+                                                       /* a0 */ 1.0 + tan_half_bw,
+                                                       /* a1 */ two_cos_wc,
+                                                       /* a2 */ 1.0 - tan_half_bw);
+                    break;
+                }
+                case filterTypePeakingNotch: {
+                    newCoefficients = IIRCoefficients (/* b0 */ sqrt_gain + gain * tan_half_bw,
+                                                       /* b1 */ sqrt_gain * two_cos_wc,
+                                                       /* b2 */ sqrt_gain - gain * tan_half_bw,
+                                                       /* a0 */ sqrt_gain + tan_half_bw,
+                                                       /* a1 */ sqrt_gain * two_cos_wc,
+                                                       /* a2 */ sqrt_gain - tan_half_bw);
+                    break;
+                }
+            }
+
+            return newCoefficients;
+        }
+
+        float processSample (const float in) noexcept
+        {
+            if (rampSamplesRemaining > 0) {
+                if (--rampSamplesRemaining == 0)
+                    currentCoefficients = targetCoefficients;
+                else
+                    for (int i = 0; i < numCoefficients; ++i)
+                        currentCoefficients.coefficients[i] += coefficientIncrements[i];
+                coefficients = currentCoefficients;
+            }
+
+            return processSingleSampleRaw (in);
+        }
+
+        int samplesUntilUpdate = 0;
+
+    private:
+        enum { numCoefficients = 5 };
+
+        IIRCoefficients currentCoefficients;
+        IIRCoefficients targetCoefficients;
+        float coefficientIncrements[numCoefficients];
+        int rampSamplesRemaining = 0;
+    };
+
+    OwnedArray<Filter> filters;
+    void setFilterParameter (const int index, const float value) noexcept;
+    void updateFilters() noexcept;
+    void updateFilter (const int channel, const float frequency, const int numSteps) noexcept;
+
+    std::atomic<uint32> responseGeneration { 0 };
+
+    /** Same filters in TPT form. Both sets follow the parameters, so that switching
+        topology does not wait for an update, but only the active one is moved by
+        the LFO and the envelope.
+    */
+    OwnedArray<StateVariableFilter> stateVariableFilters;
+    static int getStateVariableResponse (const int filterType) noexcept;
+    int selectedTopology = topologyDirectForm;
+    int currentTopology = topologyDirectForm;
+
+    double sampleRate = 0.0;
+    int currentMode = modeManual;
+    float selectedFrequency = 300.0f;
+    float currentQfactor = 10.0f;
+    float currentGain = 20.0f;
+    int currentFilterType = filterTypeResonantLowPass;
+    float currentEnvelopeAttack = 0.002f;
+    float currentEnvelopeRelease = 0.3f;
+    int currentControlRate = 32;
+    bool currentPedal = false;
+
+    LinearSmoothedValue<float> smoothedMix { 0.5f };
+    LinearSmoothedValue<float> smoothedLFOfrequency { 2.0f };
+    LinearSmoothedValue<float> smoothedMixLFOandEnvelope { 0.8f };
+
+    float centreFrequency = 300.0f;
+    float lfoPhase = 0.0f;
+    float inverseSampleRate = 0.0f;
+    float twoPi = 2.0f * M_PI;
+
+    /** The envelope is followed maxBlockSize samples at a time, ahead of the filter. */
+    enum { maxBlockSize = 64 };
+
+    //======================================
+
+    /** In manual mode, a MIDI controller can move the centre frequency as an
+        expression pedal, over the range and skew of the Frequency slider. Every
+        channel replays the positions of a block: each one starts a ramp of the
+        pedal position at its own sample, and from then on, at the control rate, the
+        coefficients glide towards the position that the ramp reaches at the next
+        control point.
+    */
+    struct PedalEvent
+    {
+        int sample;
+        float position;
+    };
+
+    enum { maxPedalEvents = 128 };
+    static constexpr double pedalRampTime = 20e-3;
+
+    /** The range and skew of the Frequency slider, as PluginParameterLogSlider sets
+        them, for the positions of the pedal.
+    */
+    static NormalisableRange<float> getFrequencyRange() noexcept
+    {
+        NormalisableRange<float> range (minFrequency, maxFrequency);
+        range.setSkewForCentre (sqrt (minFrequency * maxFrequency));
+        return range;
+    }
+
+    PedalEvent pedalEvents[maxPedalEvents];
+    int numPedalEvents = 0;
+    LinearSmoothedValue<float> pedalPosition;
+    const NormalisableRange<float> frequencyRange { getFrequencyRange() };
+
+    OwnedArray<EnvelopeFollower> envelopes;
+    EnvelopeFollower::Coefficients envelopeCoefficients;
+};
+
+//==============================================================================
+
+inline void WahWahDSP::prepare (const double newSampleRate, const int numChannels, const double smoothTime)
+{
+    sampleRate = newSampleRate;
+
+    smoothedMix.reset (sampleRate, smoothTime);
+    smoothedLFOfrequency.reset (sampleRate, smoothTime);
+    smoothedMixLFOandEnvelope.reset (sampleRate, smoothTime);
+
+    filters.clear();
+    for (int i = 0; i < numChannels; ++i)
+        filters.add (new Filter());
+    stateVariableFilters.clear();
+    for (int i = 0; i < numChannels; ++i)
+        stateVariableFilters.add (new StateVariableFilter());
+    centreFrequency = selectedFrequency;
+    updateFilters();
+    currentTopology = selectedTopology;
+
+    lfoPhase = 0.0f;
+    inverseSampleRate = 1.0f / (float)sampleRate;
+
+    envelopes.clear();
+    for (int i = 0; i < numChannels; ++i)
+        envelopes.add (new EnvelopeFollower());
+    envelopeCoefficients.prepare (sampleRate);
+
+    pedalPosition.reset (sampleRate, pedalRampTime);
+    pedalPosition.setCurrentAndTargetValue (frequencyRange.convertTo0to1 (selectedFrequency));
+    numPedalEvents = 0;
+}
+
+inline void WahWahDSP::reset() noexcept
+{
+    for (int i = 0; i < filters.size(); ++i)
+        filters[i]->reset();
+    for (int i = 0; i < stateVariableFilters.size(); ++i)
+        stateVariableFilters[i]->reset();
+    for (int i = 0; i < envelopes.size(); ++i)
+        envelopes[i]->reset();
+}
+
+inline void WahWahDSP::process (float* const* channels, const int numChannels, const int numSamples) noexcept
+{
+    float phase;
+    const int controlRate = currentControlRate;
+
+    const int topology = selectedTopology;
+    if (topology != currentTopology) {
+        reset();
+        currentTopology = topology;
+    }
+
+    // The coefficients are only computed again when the times change. The times set
+    // the speed of the envelope, so following them once per block is smooth enough.
+    envelopeCoefficients.setTimes (currentEnvelopeAttack, currentEnvelopeRelease);
+
+    const bool pedal = currentMode == modeManual && currentPedal;
+    if (! pedal)
+        numPedalEvents = 0;
+    const bool pedalMoving = pedal && (numPedalEvents > 0 || pedalPosition.isSmoothing());
+    LinearSmoothedValue<float> pedalRamp;
+    int pedalLag = 0;
+
+    for (int channel = 0; channel < numChannels; ++channel) {
+        float* channelData = channels[channel];
+        Filter* filter = filters[channel];
+        StateVariableFilter* stateVariableFilter = stateVariableFilters[channel];
+        float envelope[maxBlockSize];
+        phase = lfoPhase;
+
+        // The ramp is only moved on at the events and the control points
+        pedalRamp = pedalPosition;
+        pedalLag = 0;
+        int nextPedalEvent = 0;
+
+        for (int sample = 0; sample < numSamples; ++sample) {
+            float in = channelData[sample];
+
+            if (pedalMoving) {
+                // A new value starts its ramp at its own sample, with a control point there
+                for (; nextPedalEvent < numPedalEvents && pedalEvents[nextPedalEvent].sample == sample; ++nextPedalEvent) {
+                    pedalRamp.skip (pedalLag);
+                    pedalLag = 0;
+                    pedalRamp.setTargetValue (pedalEvents[nextPedalEvent].position);
+                    filter->samplesUntilUpdate = 0;
+                }
+
+                if (--filter->samplesUntilUpdate <= 0) {
+                    filter->samplesUntilUpdate = controlRate;
+                    pedalRamp.skip (pedalLag);
+                    pedalLag = 0;
+
+                    LinearSmoothedValue<float> glideEnd = pedalRamp;
+                    centreFrequency = frequencyRange.convertFrom0to1 (glideEnd.skip (controlRate));
+                    updateFilter (channel, centreFrequency, controlRate);
+                }
+                ++pedalLag;
+            }
+
+            const int blockSample = sample % maxBlockSize;
+            if (blockSample == 0) {
+                const int blockSamples = jmin ((int)maxBlockSize, numSamples - sample);
+                FloatVectorOperations::abs (envelope, channelData + sample, blockSamples);
+                envelopes[channel]->process (envelopeCoefficients, envelope, envelope, blockSamples);
+            }
+
+            if (currentMode == modeAutomatic) {
+                float mixLFOandEnvelope = smoothedMixLFOandEnvelope.getNextValue();
+
+                // The coefficients are only computed every controlRate samples and
+                // interpolated in between
+                if (--filter->samplesUntilUpdate <= 0) {
+                    filter->samplesUntilUpdate = controlRate;
+
+                    float centreFrequencyLFO = 0.5f + 0.5f * sinf (twoPi * phase);
+                    float centreFrequencyEnv = envelope[blockSample];
+                    centreFrequency =
+                        centreFrequencyLFO + mixLFOandEnvelope * (centreFrequencyEnv - centreFrequencyLFO);
+
+                    centreFrequency *= maxFrequency - minFrequency;
+                    centreFrequency += minFrequency;
+
+                    updateFilter (channel, centreFrequency, controlRate);
+                }
+
+                phase += smoothedLFOfrequency.getNextValue() * inverseSampleRate;
+                if (phase >= 1.0f)
+                    phase -= 1.0f;
+            }
+
+            float filtered = (topology == topologyStateVariable) ? stateVariableFilter->processSample (in)
+                                                                 : filter->processSample (in);
+            float out = in + smoothedMix.getNextValue() * (filtered - in);
+            channelData[sample] = out;
+        }
+    }
+
+    lfoPhase = phase;
+    if (currentMode == modeAutomatic)
+        ++responseGeneration;
+
+    // Every channel replayed the same events, so the ramp of the last one ends the block
+    if (pedalMoving) {
+        if (numChannels > 0) {
+            pedalPosition = pedalRamp;
+            pedalPosition.skip (pedalLag);
+        } else if (numPedalEvents > 0) {
+            pedalPosition.setTargetValue (pedalEvents[numPedalEvents - 1].position);
+            pedalPosition.skip (numSamples);
+        }
+        ++responseGeneration;
+    }
+
+    numPedalEvents = 0;
+}
+
+inline void WahWahDSP::setFilterParameter (const int index, const float value) noexcept
+{
+    switch (index) {
+        case parameterFrequency:
+            // The LFO, the envelope and the pedal move the centre frequency, which
+            // only follows the parameter when it changes
+            if (value == selectedFrequency)
+                return;
+            selectedFrequency = value;
+            centreFrequency = value;
+            break;
+
+        case parameterQfactor:
+            if (value == currentQfactor)
+                return;
+            currentQfactor = value;
+            break;
+
+        case parameterGain:
+            if (value == currentGain)
+                return;
+            currentGain = value;
+            break;
+
+        case parameterFilterType: {
+            const int filterType = jlimit ((int)filterTypeResonantLowPass, (int)filterTypePeakingNotch, (int)value);
+            if (filterType == currentFilterType)
+                return;
+            currentFilterType = filterType;
+            break;
+        }
+    }
+
+    updateFilters();
+}
+
+inline void WahWahDSP::updateFilters() noexcept
+{
+    TRACE_SCOPE ("updateFilters");
+
+    double discreteFrequency = 2.0 * M_PI * (double)centreFrequency / sampleRate;
+    double qFactor = (double)currentQfactor;
+    double gain = pow (10.0, (double)currentGain * 0.05);
+    int type = currentFilterType;
+
+    for (int i = 0; i < filters.size(); ++i)
+        filters[i]->updateCoefficients (discreteFrequency, qFactor, gain, type);
+
+    // The resonant low-pass takes its resonance from the gain, as in Filter
+    const double stateVariableQ = (type == filterTypeResonantLowPass) ? gain : qFactor;
+    for (int i = 0; i < stateVariableFilters.size(); ++i) {
+        stateVariableFilters[i]->setResponse (getStateVariableResponse (type), stateVariableQ, gain);
+        stateVariableFilters[i]->setCutoff (discreteFrequency);
+    }
+
+    ++responseGeneration;
+}
+
+inline void WahWahDSP::updateFilter (const int channel, const float frequency, const int numSteps) noexcept
+{
+    TRACE_SCOPE ("updateFilter");
+
+    double discreteFrequency = 2.0 * M_PI * (double)frequency / sampleRate;
+
+    // Only the cutoff moves here: one tan() for the state variable filter, against
+    // the whole design of the direct form
+    if (currentTopology == topologyStateVariable) {
+        stateVariableFilters[channel]->setCutoff (discreteFrequency, numSteps);
+        return;
+    }
+
+    double qFactor = (double)currentQfactor;
+    double gain = pow (10.0, (double)currentGain * 0.05);
+    int type = currentFilterType;
+
+    filters[channel]->updateCoefficients (discreteFrequency, qFactor, gain, type, numSteps);
+}
+
+inline IIRCoefficients WahWahDSP::getFilterCoefficients (const float frequency) const
+{
+    double discreteFrequency = 2.0 * M_PI * (double)frequency / sampleRate;
+    double qFactor = (double)currentQfactor;
+    double gain = pow (10.0, (double)currentGain * 0.05);
+    int type = currentFilterType;
+
+    return Filter::makeCoefficients (discreteFrequency, qFactor, gain, type);
+}
+
+inline int WahWahDSP::getStateVariableResponse (const int filterType) noexcept
+{
+    switch (filterType) {
+        case filterTypeBandPass:
+            return StateVariableFilter::responseBandPass;
+        case filterTypePeakingNotch:
+            return StateVariableFilter::responsePeaking;
+        default:
+            return StateVariableFilter::responseLowPass;
+    }
+}
+
+//==============================================================================